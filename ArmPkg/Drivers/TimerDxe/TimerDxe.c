@@ -135,8 +135,31 @@ TimerDriverSetTimerPeriod (
 {
   UINT64      CounterValue;
   UINT64      TimerTicks;
+  UINT64      LastTickValue;
   EFI_TPL     OriginalTPL;
 
+  // Reprogramming the timer restarts the current period, so report the time
+  // elapsed since the last timer tick to keep the DXE core system time
+  // accurate when the period is changed frequently, e.g. around idle.
+  // This is measured on the system counter, so it includes a period that
+  // ended while interrupts were disabled. Its interrupt is not counted twice:
+  // the new compare value below clears ISTATUS, and the interrupt handler
+  // ignores the pending interrupt when ISTATUS is clear.
+  if ((mTimerPeriod != 0) && (mTimerNotifyFunction != NULL)) {
+    OriginalTPL   = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    CounterValue  = ArmGenericTimerGetSystemCount ();
+    LastTickValue = ArmGenericTimerGetCompareVal () - mTimerTicks * mElapsedPeriod;
+    if (CounterValue > LastTickValue) {
+      mTimerNotifyFunction (
+        DivU64x32 (
+          MultU64x32 (CounterValue - LastTickValue, 10000000U),
+          ArmGenericTimerGetTimerFreq ()
+          )
+        );
+    }
+    gBS->RestoreTPL (OriginalTPL);
+  }
+
   // Always disable the timer
   ArmGenericTimerDisableTimer ();
 
@@ -0,0 +1,430 @@
+##
+# Decode the binary trace logs that MdeModulePkg TraceLib records.
+#
+# TRACE() messages are stored as the address of the format string and the raw
+# arguments. This tool finds the trace logs in a memory dump, looks up the
+# images of the modules that wrote them in the build directory, and renders
+# each message as DebugPrint() would have.
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+##
+
+from __future__ import print_function
+import os
+import re
+import struct
+import sys
+import uuid
+from optparse import OptionParser
+
+versionNumber = "1.0"
+__description__ = "Decode the binary trace logs that MdeModulePkg TraceLib records."
+
+#
+# Layout of the structures in MdeModulePkg/Include/Guid/TraceLog.h
+#
+TRACE_LOG_SIGNATURE   = b'TLOG'
+TRACE_LOG_HEADER      = struct.Struct('<4sIIIIIQ')
+TRACE_LOG_MODULE      = struct.Struct('<16sQ')
+TRACE_LOG_RECORD      = struct.Struct('<II16sQQII5Q')
+TRACE_LOG_MAX_ARGS    = 5
+TRACE_LOG_PHASE_NAMES = ['PEI', 'DXE']
+
+WarningStrings = [
+    "Success", "Warning Unknown Glyph", "Warning Delete Failure",
+    "Warning Write Failure", "Warning Buffer Too Small", "Warning Stale Data"
+    ]
+
+ErrorStrings = [
+    "Load Error", "Invalid Parameter", "Unsupported", "Bad Buffer Size",
+    "Buffer Too Small", "Not Ready", "Device Error", "Write Protected",
+    "Out of Resources", "Volume Corrupt", "Volume Full", "No Media",
+    "Media changed", "Not Found", "Access Denied", "No Response", "No mapping",
+    "Time out", "Not started", "Already started", "Aborted", "ICMP Error",
+    "TFTP Error", "Protocol Error", "Incompatible Version",
+    "Security Violation", "CRC Error", "End of Media", "Reserved (29)",
+    "Reserved (30)", "End of File", "Invalid Language", "Compromised Data"
+    ]
+
+class PeImage:
+    def __init__(self, fileName):
+        with open(fileName, 'rb') as f:
+            self.data = f.read()
+        self.sections = []
+        self.pointerSize = 8
+        self.sizeOfImage = len(self.data)
+        if self.data[0:2] != b'MZ':
+            return
+        peOffset = struct.unpack_from('<I', self.data, 0x3c)[0]
+        if self.data[peOffset:peOffset + 4] != b'PE\0\0':
+            return
+        machine, sectionCount = struct.unpack_from('<HH', self.data, peOffset + 4)
+        optionalSize = struct.unpack_from('<H', self.data, peOffset + 20)[0]
+        if machine in (0x014c, 0x01c2, 0x0ebc):
+            self.pointerSize = 4
+        self.sizeOfImage = struct.unpack_from('<I', self.data, peOffset + 24 + 56)[0]
+        sectionOffset = peOffset + 24 + optionalSize
+        for index in range(sectionCount):
+            virtualSize, virtualAddress, rawSize, rawOffset = struct.unpack_from('<IIII', self.data, sectionOffset + index * 40 + 8)
+            self.sections.append((virtualAddress, max(virtualSize, rawSize), rawOffset, rawSize))
+
+    def fileOffset(self, rva):
+        for (virtualAddress, size, rawOffset, rawSize) in self.sections:
+            if virtualAddress <= rva < virtualAddress + size:
+                if rva - virtualAddress >= rawSize:
+                    return None
+                return rawOffset + rva - virtualAddress
+        if rva < len(self.data) and not self.sections:
+            return rva
+        return None
+
+    def readBytes(self, rva, length):
+        offset = self.fileOffset(rva)
+        if offset is None:
+            return None
+        return self.data[offset:offset + length]
+
+    def readAsciiString(self, rva):
+        offset = self.fileOffset(rva)
+        if offset is None:
+            return None
+        end = self.data.find(b'\0', offset)
+        if end < 0:
+            return None
+        return self.data[offset:end].decode('latin-1')
+
+    def readUnicodeString(self, rva):
+        offset = self.fileOffset(rva)
+        if offset is None:
+            return None
+        end = offset
+        while end + 1 < len(self.data) and self.data[end:end + 2] != b'\0\0':
+            end += 2
+        return self.data[offset:end].decode('utf-16-le', 'replace')
+
+class BuildImages:
+    """Map module GUIDs to the .efi files in a build output directory."""
+    def __init__(self, buildDir):
+        self.fileNames = {}
+        self.images = {}
+        if buildDir is None:
+            return
+        guidPattern = re.compile(
+            r'GUID\s+gEfiCallerIdGuid\s*=\s*\{\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*\{([^}]*)\}'
+            )
+        for root, dirs, files in os.walk(buildDir):
+            if os.path.basename(root) != 'DEBUG' or 'AutoGen.c' not in files:
+                continue
+            with open(os.path.join(root, 'AutoGen.c'), 'r') as f:
+                match = guidPattern.search(f.read())
+            if match is None:
+                continue
+            efiFiles = [name for name in files if name.lower().endswith('.efi')]
+            if len(efiFiles) == 0:
+                continue
+            data4 = bytes(bytearray(int(x, 16) for x in match.group(4).split(',')))
+            guid = uuid.UUID(fields=(int(match.group(1), 16), int(match.group(2), 16), int(match.group(3), 16),
+                                     data4[0], data4[1], int.from_bytes(data4[2:8], 'big')))
+            self.fileNames[guid] = os.path.join(root, efiFiles[0])
+
+    def image(self, guid):
+        if guid not in self.images:
+            fileName = self.fileNames.get(guid)
+            self.images[guid] = PeImage(fileName) if fileName is not None else None
+        return self.images[guid]
+
+class TraceLog:
+    def __init__(self, dump, offset):
+        (self.signature, self.phase, self.moduleCount, self.moduleHead,
+         self.recordCount, self.head, self.frequency) = TRACE_LOG_HEADER.unpack_from(dump, offset)
+        self.offset = offset
+        self.modules = []
+        moduleOffset = offset + TRACE_LOG_HEADER.size
+        for index in range(min(self.moduleHead, self.moduleCount)):
+            guid, imageBase = TRACE_LOG_MODULE.unpack_from(dump, moduleOffset + index * TRACE_LOG_MODULE.size)
+            self.modules.append((uuid.UUID(bytes_le=guid), imageBase))
+        self.records = []
+        recordOffset = moduleOffset + self.moduleCount * TRACE_LOG_MODULE.size
+        for index in range(self.recordCount):
+            fields = TRACE_LOG_RECORD.unpack_from(dump, recordOffset + index * TRACE_LOG_RECORD.size)
+            sequence, errorLevel, guid, formatAddress, timeStamp, argCount = fields[0:6]
+            if sequence == 0 or sequence + self.recordCount <= self.head:
+                continue
+            self.records.append((sequence, errorLevel, uuid.UUID(bytes_le=guid), formatAddress, timeStamp,
+                                 argCount, list(fields[7:7 + TRACE_LOG_MAX_ARGS])))
+        self.records.sort()
+
+    @staticmethod
+    def isValid(dump, offset):
+        if offset + TRACE_LOG_HEADER.size > len(dump):
+            return False
+        (signature, phase, moduleCount, moduleHead, recordCount, head, frequency) = TRACE_LOG_HEADER.unpack_from(dump, offset)
+        if signature != TRACE_LOG_SIGNATURE or phase >= len(TRACE_LOG_PHASE_NAMES) or recordCount == 0:
+            return False
+        size = TRACE_LOG_HEADER.size + moduleCount * TRACE_LOG_MODULE.size + recordCount * TRACE_LOG_RECORD.size
+        return offset + size <= len(dump)
+
+class Decoder:
+    def __init__(self, images, log):
+        self.images = images
+        self.log = log
+
+    def findImage(self, guid, address):
+        """Return the image of module guid, and the address it was loaded at, that holds address."""
+        best = None
+        for (moduleGuid, imageBase) in self.log.modules:
+            if moduleGuid == guid and imageBase <= address and (best is None or imageBase > best):
+                best = imageBase
+        if best is None:
+            return (None, None)
+        return (self.images.image(guid), best)
+
+    def findAnyImage(self, address):
+        """Return the image of any module, and the address it was loaded at, that holds address."""
+        for (moduleGuid, imageBase) in self.log.modules:
+            image = self.images.image(moduleGuid)
+            if image is not None and imageBase <= address < imageBase + image.sizeOfImage:
+                return (image, imageBase)
+        return (None, None)
+
+    def pointerArgument(self, type, value):
+        if value is None:
+            return '<?>'
+        if value == 0:
+            return {'a': '<null string>', 's': '<null string>', 'S': '<null string>',
+                    'g': '<null guid>', 't': '<null time>'}[type]
+        image, imageBase = self.findAnyImage(value)
+        if image is not None:
+            if type == 'a':
+                string = image.readAsciiString(value - imageBase)
+            elif type in ('s', 'S'):
+                string = image.readUnicodeString(value - imageBase)
+            elif type == 'g':
+                data = image.readBytes(value - imageBase, 16)
+                string = str(uuid.UUID(bytes_le=data)).upper() if data is not None and len(data) == 16 else None
+            else:
+                string = None
+            if string is not None:
+                return string
+        return '<%s:0x%X>' % (type, value)
+
+    def render(self, format, args, argCount, pointerSize):
+        output = ''
+        argIndex = [0]
+
+        def nextArg():
+            index = argIndex[0]
+            argIndex[0] += 1
+            if index >= len(args) or index >= argCount:
+                return None
+            return args[index]
+
+        index = 0
+        while index < len(format):
+            character = format[index]
+            index += 1
+            if character != '%':
+                output += character
+                continue
+
+            leftJustify = prefixSign = prefixBlank = prefixZero = comma = long = precisionSet = padToWidth = False
+            width = 0
+            precision = 1
+            while index < len(format):
+                character = format[index]
+                if character == '.':
+                    precisionSet = True
+                elif character == '-':
+                    leftJustify = True
+                elif character == '+':
+                    prefixSign = True
+                elif character == ' ':
+                    prefixBlank = True
+                elif character == ',':
+                    comma = True
+                elif character in 'lL':
+                    long = True
+                elif character == '*':
+                    value = nextArg() or 0
+                    if not precisionSet:
+                        padToWidth = True
+                        width = value
+                    else:
+                        precision = value
+                elif character.isdigit():
+                    if character == '0' and not precisionSet:
+                        prefixZero = True
+                    count = 0
+                    while index < len(format) and format[index].isdigit():
+                        count = count * 10 + int(format[index])
+                        index += 1
+                    index -= 1
+                    if not precisionSet:
+                        padToWidth = True
+                        width = count
+                    else:
+                        precision = count
+                else:
+                    break
+                index += 1
+            if index >= len(format):
+                break
+            type = format[index]
+            index += 1
+
+            zeroPad = False
+            prefix = ''
+            if type in 'pXxud':
+                hexadecimal = type in 'pXx'
+                unsigned = type == 'u'
+                if type == 'p':
+                    prefixBlank = prefixSign = prefixZero = False
+                    long = pointerSize == 8
+                if type in 'pX':
+                    prefixZero = True
+                value = nextArg()
+                if value is None:
+                    output += '<?>'
+                    continue
+                if not long:
+                    value &= 0xFFFFFFFF
+                    if value & 0x80000000 and not unsigned and not hexadecimal:
+                        value -= 1 << 32
+                elif value & (1 << 63) and not unsigned and not hexadecimal:
+                    value -= 1 << 64
+                if prefixBlank:
+                    prefix = ' '
+                if prefixSign and not unsigned:
+                    prefix = '+'
+                if hexadecimal:
+                    digits = '%X' % value
+                    comma = False
+                else:
+                    if comma:
+                        prefixZero = False
+                        precision = 1
+                    if value < 0:
+                        prefix = '-'
+                        value = -value
+                    digits = '%d' % value
+                if value == 0 and precision == 0:
+                    digits = ''
+                if comma and digits:
+                    digits = '{:,}'.format(int(digits))
+                argument = digits
+                count = len(digits) + len(prefix)
+                if prefix:
+                    precision += 1
+                zeroPad = True
+                if prefixZero and not leftJustify and padToWidth and not precisionSet:
+                    precision = width
+            elif type in 'asSgt':
+                argument = self.pointerArgument(type, nextArg())
+                if not precisionSet:
+                    precision = 0
+                else:
+                    argument = argument[:precision]
+                count = len(argument)
+            elif type == 'c':
+                value = nextArg()
+                argument = chr(value & 0xFFFF) if value is not None else '<?>'
+                count = len(argument)
+            elif type == 'r':
+                value = nextArg()
+                if value is None:
+                    argument = '<?>'
+                elif value & (1 << 63) or (pointerSize == 4 and value & (1 << 31)):
+                    status = value & ~((1 << 63) if pointerSize == 8 else (1 << 31))
+                    argument = ErrorStrings[status - 1] if 0 < status <= len(ErrorStrings) else '%08X' % value
+                else:
+                    argument = WarningStrings[value] if value < len(WarningStrings) else '%08X' % value
+                count = len(argument)
+            else:
+                argument = type
+                count = 1
+
+            precision = max(precision, count)
+            if padToWidth and not leftJustify:
+                output += ' ' * (width - precision)
+            if zeroPad:
+                output += prefix
+                output += '0' * (precision - count)
+                output += argument
+            else:
+                output += ' ' * (precision - count) + argument
+            if padToWidth and leftJustify:
+                output += ' ' * (width - precision)
+
+        return output
+
+    def decode(self, record):
+        (sequence, errorLevel, guid, formatAddress, timeStamp, argCount, args) = record
+        image, imageBase = self.findImage(guid, formatAddress)
+        format = None
+        if image is not None:
+            format = image.readAsciiString(formatAddress - imageBase)
+        if format is None:
+            return '<%s format 0x%X> %s' % (guid, formatAddress, ' '.join('0x%X' % arg for arg in args[:argCount]))
+        message = self.render(format, args, argCount, image.pointerSize).rstrip('\r\n')
+        if argCount > TRACE_LOG_MAX_ARGS:
+            message += ' <%d more arguments>' % (argCount - TRACE_LOG_MAX_ARGS)
+        return message
+
+def findTraceLogs(dump):
+    logs = []
+    offset = dump.find(TRACE_LOG_SIGNATURE)
+    while offset >= 0:
+        if offset % 8 == 0 and TraceLog.isValid(dump, offset):
+            logs.append(TraceLog(dump, offset))
+        offset = dump.find(TRACE_LOG_SIGNATURE, offset + 1)
+    return logs
+
+def myOptionParser():
+    usage = "%prog [--version] [-h] [--help] -i dumpfile [-b builddir] [-o outputfile]"
+    Parser = OptionParser(usage=usage, description=__description__, version="%prog " + str(versionNumber))
+    Parser.add_option("-i", "--inputfile", dest="inputfilename", type="string", help="A memory dump that holds the PEI and DXE trace logs, for example the runtime memory at the address of the gEdkiiTraceLogTableGuid configuration table")
+    Parser.add_option("-b", "--builddir", dest="builddir", type="string", help="The build output directory of the firmware, for example Build/OvmfX64/DEBUG_GCC5, used to find the images of the modules that traced")
+    Parser.add_option("-o", "--outputfile", dest="outputfilename", type="string", help="The output file for the decoded messages, stdout if it is not specified")
+
+    (Options, args) = Parser.parse_args()
+    if Options.inputfilename is None:
+        Parser.error("no input file specified")
+    return Options
+
+def main():
+    Options = myOptionParser()
+
+    try:
+        with open(Options.inputfilename, 'rb') as f:
+            dump = f.read()
+    except Exception:
+        print('fail to open ' + Options.inputfilename)
+        return 1
+
+    logs = findTraceLogs(dump)
+    if len(logs) == 0:
+        print('no trace log found in ' + Options.inputfilename)
+        return 1
+
+    images = BuildImages(Options.builddir)
+    output = open(Options.outputfilename, 'w') if Options.outputfilename is not None else sys.stdout
+    for log in logs:
+        decoder = Decoder(images, log)
+        lost = max(log.head - log.recordCount, 0)
+        output.write('== %s trace log at offset 0x%X: %d records, %d overwritten\n' %
+                     (TRACE_LOG_PHASE_NAMES[log.phase], log.offset, log.head, lost))
+        for record in log.records:
+            timeStamp = record[4]
+            if log.frequency != 0:
+                stamp = '%12.6f' % (float(timeStamp) / log.frequency)
+            else:
+                stamp = '%12d' % timeStamp
+            message = decoder.decode(record).replace('\r\n', '\n')
+            output.write('[%s] %08X %s\n' % (stamp, record[1], message))
+    if output is not sys.stdout:
+        output.close()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
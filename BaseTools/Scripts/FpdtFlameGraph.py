@@ -0,0 +1,401 @@
+##
+# Render a flame graph and a critical path report from the boot performance
+# records that DxeCorePerformanceLib adds to the FPDT Firmware Basic Boot
+# Performance Table (FBPT).
+#
+# Begin and end records are paired into nested frames: images started by the
+# dispatcher, driver binding Supported()/Start()/Stop(), PERF_START/PERF_END
+# measurements and, with PcdPerformanceDeepProfileEnable, the event and
+# protocol notification functions that DxeCore dispatches. The frames are
+# written as folded stacks, which most flame graph tools read, and optionally
+# as a self-contained SVG flame graph.
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+##
+
+from __future__ import print_function
+import os
+import re
+import struct
+import sys
+import uuid
+from optparse import OptionParser
+
+versionNumber = "1.0"
+__description__ = "Render a flame graph and a critical path report from the FPDT boot performance records."
+
+#
+# Layout of the records in MdeModulePkg/Include/Guid/ExtendedFirmwarePerformance.h
+#
+FBPT_SIGNATURE                    = b'FBPT'
+FPDT_RECORD_HEADER                = struct.Struct('<HBB')
+FPDT_EVENT_COMMON                 = struct.Struct('<HIQ16s')
+FPDT_GUID_EVENT_TYPE              = 0x1010
+FPDT_DYNAMIC_STRING_EVENT_TYPE    = 0x1011
+FPDT_DUAL_GUID_STRING_EVENT_TYPE  = 0x1012
+FPDT_GUID_QWORD_EVENT_TYPE        = 0x1013
+FPDT_GUID_QWORD_STRING_EVENT_TYPE = 0x1014
+
+#
+# Progress identifiers in MdePkg/Include/Library/PerformanceLib.h and
+# MdeModulePkg/Include/Guid/ExtendedFirmwarePerformance.h
+#
+PERF_EVENT_ID              = 0x00
+MODULE_START_ID            = 0x01
+MODULE_END_ID              = 0x02
+MODULE_LOADIMAGE_START_ID  = 0x03
+MODULE_LOADIMAGE_END_ID    = 0x04
+MODULE_DB_START_ID         = 0x05
+MODULE_DB_END_ID           = 0x06
+MODULE_DB_SUPPORT_START_ID = 0x07
+MODULE_DB_SUPPORT_END_ID   = 0x08
+MODULE_DB_STOP_START_ID    = 0x09
+MODULE_DB_STOP_END_ID      = 0x0A
+PERF_EVENT_NOTIFY_START_ID = 0x60
+PERF_EVENT_NOTIFY_END_ID   = 0x61
+PERF_PROTOCOL_NOTIFY_ID    = 0x70
+
+#
+# Start identifier, end identifier and frame name prefix of the core measurements.
+#
+CoreFrames = [
+    (MODULE_START_ID,            MODULE_END_ID,            'StartImage'),
+    (MODULE_LOADIMAGE_START_ID,  MODULE_LOADIMAGE_END_ID,  'LoadImage'),
+    (MODULE_DB_START_ID,         MODULE_DB_END_ID,         'DB:Start'),
+    (MODULE_DB_SUPPORT_START_ID, MODULE_DB_SUPPORT_END_ID, 'DB:Support'),
+    (MODULE_DB_STOP_START_ID,    MODULE_DB_STOP_END_ID,    'DB:Stop'),
+    (PERF_EVENT_NOTIFY_START_ID, PERF_EVENT_NOTIFY_END_ID, 'Notify'),
+    ]
+
+class Record:
+    def __init__(self, type, progressId, timeStamp, guid, guid2=None, qword=None, string=None):
+        self.type       = type
+        self.progressId = progressId
+        self.timeStamp  = timeStamp
+        self.guid       = guid
+        self.guid2      = guid2
+        self.qword      = qword
+        self.string     = string
+
+def readString(data):
+    return data.split(b'\0', 1)[0].decode('ascii', 'replace')
+
+def parseRecords(data):
+    """Parse the FPDT records in a FBPT, or in a bare buffer of records."""
+    offset = 0
+    end    = len(data)
+    if data[0:4] == FBPT_SIGNATURE:
+        end    = min(struct.unpack_from('<I', data, 4)[0], len(data))
+        offset = 8
+    records = []
+    while offset + FPDT_RECORD_HEADER.size <= end:
+        type, length, revision = FPDT_RECORD_HEADER.unpack_from(data, offset)
+        if length < FPDT_RECORD_HEADER.size or offset + length > end:
+            break
+        body = data[offset + FPDT_RECORD_HEADER.size:offset + length]
+        offset += length
+        if type < FPDT_GUID_EVENT_TYPE or type > FPDT_GUID_QWORD_STRING_EVENT_TYPE or len(body) < FPDT_EVENT_COMMON.size:
+            continue
+        progressId, apicId, timeStamp, guid = FPDT_EVENT_COMMON.unpack_from(body, 0)
+        guid = uuid.UUID(bytes_le=guid)
+        rest = body[FPDT_EVENT_COMMON.size:]
+        if type == FPDT_GUID_EVENT_TYPE:
+            records.append(Record(type, progressId, timeStamp, guid))
+        elif type == FPDT_DYNAMIC_STRING_EVENT_TYPE:
+            records.append(Record(type, progressId, timeStamp, guid, string=readString(rest)))
+        elif type == FPDT_DUAL_GUID_STRING_EVENT_TYPE:
+            records.append(Record(type, progressId, timeStamp, guid, guid2=uuid.UUID(bytes_le=rest[0:16]), string=readString(rest[16:])))
+        elif type == FPDT_GUID_QWORD_EVENT_TYPE:
+            records.append(Record(type, progressId, timeStamp, guid, qword=struct.unpack_from('<Q', rest, 0)[0]))
+        else:
+            records.append(Record(type, progressId, timeStamp, guid, qword=struct.unpack_from('<Q', rest, 0)[0], string=readString(rest[8:])))
+    return records
+
+class ModuleNames:
+    """Map module GUIDs to the module names in a build output directory."""
+    def __init__(self, buildDir):
+        self.names = {}
+        if buildDir is None:
+            return
+        guidPattern = re.compile(
+            r'GUID\s+gEfiCallerIdGuid\s*=\s*\{\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*\{([^}]*)\}'
+            )
+        for root, dirs, files in os.walk(buildDir):
+            if os.path.basename(root) != 'DEBUG' or 'AutoGen.c' not in files:
+                continue
+            with open(os.path.join(root, 'AutoGen.c'), 'r') as f:
+                match = guidPattern.search(f.read())
+            if match is None:
+                continue
+            data4 = bytes(bytearray(int(x, 16) for x in match.group(4).split(',')))
+            guid = uuid.UUID(fields=(int(match.group(1), 16), int(match.group(2), 16), int(match.group(3), 16),
+                                     data4[0], data4[1], int.from_bytes(data4[2:8], 'big')))
+            self.names[guid] = os.path.basename(os.path.dirname(root))
+
+    def name(self, guid, string=None):
+        if guid in self.names:
+            return self.names[guid]
+        if string:
+            return string
+        return str(guid).upper()
+
+class Frame:
+    def __init__(self, name, key, start, parent):
+        self.name     = name
+        self.key      = key
+        self.start    = start
+        self.end      = None
+        self.parent   = parent
+        self.children = []
+        self.closed   = True
+
+    def total(self):
+        return self.end - self.start
+
+    def selfTime(self):
+        return self.total() - sum(child.total() for child in self.children)
+
+    def stack(self):
+        names = []
+        frame = self
+        while frame.parent is not None:
+            names.append(frame.name)
+            frame = frame.parent
+        return list(reversed(names))
+
+class FrameBuilder:
+    """Pair begin and end records into a tree of nested frames."""
+    def __init__(self, modules):
+        self.modules        = modules
+        self.protocolNotify = {}
+        self.coreStart      = dict((start, (end, prefix)) for (start, end, prefix) in CoreFrames)
+        self.coreEnd        = dict((end, (start, prefix)) for (start, end, prefix) in CoreFrames)
+
+    def identify(self, record):
+        """Return (kind, key, name, isStart) of a begin or end record, or None."""
+        id = record.progressId
+        if id in self.coreStart or id in self.coreEnd:
+            isStart = id in self.coreStart
+            startId = id if isStart else self.coreEnd[id][0]
+            prefix  = self.coreStart[startId][1]
+            module  = self.modules.name(record.guid, record.string)
+            if startId == PERF_EVENT_NOTIFY_START_ID:
+                name = '%s:%s@0x%X' % (prefix, module, record.qword)
+                if isStart and record.qword in self.protocolNotify:
+                    name = 'ProtocolNotify(%s):%s@0x%X' % (self.protocolNotify.pop(record.qword), module, record.qword)
+                return (startId, record.qword, name, isStart)
+            if startId in (MODULE_START_ID, MODULE_LOADIMAGE_START_ID):
+                #
+                # The end of StartImage and LoadImage may be logged without
+                # the module, so they can only be paired by nesting.
+                #
+                return (startId, None, '%s:%s' % (prefix, module), isStart)
+            return (startId, (record.guid, record.qword), '%s:%s' % (prefix, module), isStart)
+        if id == PERF_EVENT_ID or id == PERF_PROTOCOL_NOTIFY_ID:
+            return None
+        isStart = (id & 0xF) == 0
+        startId = id & 0xFFF0
+        module  = self.modules.name(record.guid)
+        if record.type == FPDT_DUAL_GUID_STRING_EVENT_TYPE:
+            name = '%s:%s(%s)' % (module, record.string, str(record.guid2).upper())
+            return (startId, (record.guid, record.guid2, record.string), name, isStart)
+        if record.string and record.string != module:
+            name = '%s:%s' % (module, record.string)
+        else:
+            name = module
+        return (startId, (record.guid, record.string), name, isStart)
+
+    def build(self, records):
+        #
+        # SMM records are appended at the end of boot, so put the records
+        # back in time order. Records without a time stamp are dropped.
+        #
+        records = sorted((record for record in records if record.timeStamp != 0), key=lambda record: record.timeStamp)
+        root = Frame('all', None, records[0].timeStamp if records else 0, None)
+        stack = [root]
+        for record in records:
+            if record.progressId == PERF_PROTOCOL_NOTIFY_ID:
+                self.protocolNotify[record.qword] = str(record.guid).upper()
+                continue
+            identity = self.identify(record)
+            if identity is None:
+                continue
+            kind, key, name, isStart = identity
+            if isStart:
+                frame = Frame(name, (kind, key), record.timeStamp, stack[-1])
+                stack[-1].children.append(frame)
+                stack.append(frame)
+                continue
+            for index in range(len(stack) - 1, 0, -1):
+                frameKind, frameKey = stack[index].key
+                if frameKind == kind and (key is None or frameKey is None or frameKey == key):
+                    break
+            else:
+                continue
+            #
+            # Frames above the matching one did not record their end.
+            #
+            while len(stack) > index:
+                frame = stack.pop()
+                frame.end = record.timeStamp
+                frame.closed = len(stack) == index
+        endTime = records[-1].timeStamp if records else 0
+        while len(stack) > 1:
+            frame = stack.pop()
+            frame.end = endTime
+            frame.closed = False
+        root.end = endTime
+        return root
+
+def walk(frame):
+    yield frame
+    for child in frame.children:
+        for descendant in walk(child):
+            yield descendant
+
+def writeFolded(root, output):
+    folded = {}
+    for frame in walk(root):
+        if frame is root:
+            continue
+        stack = ';'.join(name.replace(';', ':') for name in frame.stack())
+        folded[stack] = folded.get(stack, 0) + frame.selfTime()
+    for stack in sorted(folded):
+        #
+        # Folded stacks count samples, here microseconds.
+        #
+        if folded[stack] >= 1000:
+            output.write('%s %d\n' % (stack, folded[stack] // 1000))
+
+def escape(text):
+    return text.replace('&', '&amp;').replace('<', '&lt;').replace('>', '&gt;').replace('"', '&quot;')
+
+def writeSvg(root, output, width=1800, frameHeight=16):
+    #
+    # Merge frames with the same stack, as a flame graph shows totals and not
+    # a timeline.
+    #
+    merged = {'name': 'all', 'total': root.total(), 'children': {}}
+    for frame in walk(root):
+        if frame is root:
+            continue
+        node = merged
+        for name in frame.stack()[:-1]:
+            node = node['children'][name]
+        child = node['children'].setdefault(frame.name, {'name': frame.name, 'total': 0, 'children': {}})
+        child['total'] += frame.total()
+
+    def depth(node):
+        return 1 + max([depth(child) for child in node['children'].values()] or [0])
+
+    height = depth(merged) * frameHeight + 40
+    scale  = float(width - 20) / max(merged['total'], 1)
+    output.write('<?xml version="1.0" standalone="no"?>\n')
+    output.write('<svg version="1.1" width="%d" height="%d" xmlns="http://www.w3.org/2000/svg" font-family="Verdana" font-size="11">\n' % (width, height))
+    output.write('<rect x="0" y="0" width="%d" height="%d" fill="#eeeeee"/>\n' % (width, height))
+    output.write('<text x="%d" y="20" text-anchor="middle" font-size="15">Boot Performance Flame Graph</text>\n' % (width // 2))
+
+    def draw(node, x, level):
+        w = node['total'] * scale
+        if w < 0.5:
+            return
+        y = height - (level + 1) * frameHeight
+        color = 200 + (hash(node['name'].split(':')[0]) % 55)
+        label = '%s (%.3f ms, %.2f%%)' % (node['name'], node['total'] / 1e6, 100.0 * node['total'] / max(merged['total'], 1))
+        output.write('<g><title>%s</title><rect x="%.1f" y="%d" width="%.1f" height="%d" fill="rgb(%d,%d,60)" rx="2"/>' %
+                     (escape(label), x, y, w, frameHeight - 1, color, (color * 3) % 200))
+        characters = int(w / 7)
+        if characters > 3:
+            text = node['name'] if len(node['name']) <= characters else node['name'][:characters - 2] + '..'
+            output.write('<text x="%.1f" y="%d">%s</text>' % (x + 3, y + frameHeight - 4, escape(text)))
+        output.write('</g>\n')
+        for child in sorted(node['children'].values(), key=lambda child: child['name']):
+            draw(child, x, level + 1)
+            x += child['total'] * scale
+
+    draw(merged, 10, 0)
+    output.write('</svg>\n')
+
+def writeReport(root, output, count):
+    total = max(root.total(), 1)
+    output.write('Measured boot time: %.3f ms\n\n' % (root.total() / 1e6))
+
+    #
+    # The critical path follows the most expensive frame at each level down
+    # from the top of the boot.
+    #
+    output.write('Critical path:\n')
+    frame = root
+    level = 0
+    while frame.children:
+        frame = max(frame.children, key=lambda child: child.total())
+        output.write('  %s%-*s %12.3f ms %6.2f%% (self %.3f ms)%s\n' %
+                     ('  ' * level, max(60 - 2 * level, 1), frame.name, frame.total() / 1e6,
+                      100.0 * frame.total() / total, frame.selfTime() / 1e6, '' if frame.closed else ' [no end record]'))
+        level += 1
+
+    #
+    # Frames that are called many times, like notification functions, are
+    # added up by name.
+    #
+    selfTimes  = {}
+    callCounts = {}
+    for frame in walk(root):
+        if frame is root:
+            continue
+        selfTimes[frame.name]  = selfTimes.get(frame.name, 0) + frame.selfTime()
+        callCounts[frame.name] = callCounts.get(frame.name, 0) + 1
+    output.write('\nTop %d frames by self time:\n' % count)
+    for name in sorted(selfTimes, key=lambda name: selfTimes[name], reverse=True)[:count]:
+        output.write('  %-64s %12.3f ms %6.2f%% %6d calls\n' %
+                     (name, selfTimes[name] / 1e6, 100.0 * selfTimes[name] / total, callCounts[name]))
+
+    output.write('\nUnmeasured time between top level frames: %.3f ms\n' % (root.selfTime() / 1e6))
+
+def myOptionParser():
+    usage = "%prog [--version] [-h] [--help] -i fbptfile [-b builddir] [-f foldedfile] [-s svgfile] [-o reportfile] [-n count]"
+    Parser = OptionParser(usage=usage, description=__description__, version="%prog " + str(versionNumber))
+    Parser.add_option("-i", "--inputfile", dest="inputfilename", type="string", help="A dump of the FPDT Firmware Basic Boot Performance Table, or of the records in it")
+    Parser.add_option("-b", "--builddir", dest="builddir", type="string", help="The build output directory of the firmware, for example Build/OvmfX64/DEBUG_GCC5, used to name the modules")
+    Parser.add_option("-f", "--foldedfile", dest="foldedfilename", type="string", help="The output file for the folded stacks, in microseconds")
+    Parser.add_option("-s", "--svgfile", dest="svgfilename", type="string", help="The output file for the SVG flame graph")
+    Parser.add_option("-o", "--outputfile", dest="outputfilename", type="string", help="The output file for the critical path report, stdout if it is not specified")
+    Parser.add_option("-n", "--count", dest="count", type="int", default=20, help="The number of frames in the list of the most expensive frames")
+
+    (Options, args) = Parser.parse_args()
+    if Options.inputfilename is None:
+        Parser.error("no input file specified")
+    return Options
+
+def main():
+    Options = myOptionParser()
+
+    try:
+        with open(Options.inputfilename, 'rb') as f:
+            data = f.read()
+    except Exception:
+        print('fail to open ' + Options.inputfilename)
+        return 1
+
+    records = parseRecords(data)
+    if len(records) == 0:
+        print('no performance record found in ' + Options.inputfilename)
+        return 1
+
+    root = FrameBuilder(ModuleNames(Options.builddir)).build(records)
+
+    if Options.foldedfilename is not None:
+        with open(Options.foldedfilename, 'w') as output:
+            writeFolded(root, output)
+    if Options.svgfilename is not None:
+        with open(Options.svgfilename, 'w') as output:
+            writeSvg(root, output)
+    output = open(Options.outputfilename, 'w') if Options.outputfilename is not None else sys.stdout
+    writeReport(root, output, Options.count)
+    if output is not sys.stdout:
+        output.close()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
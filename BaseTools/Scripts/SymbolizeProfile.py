@@ -0,0 +1,235 @@
+##
+# Symbolize the instruction pointer samples that UefiCpuPkg SamplingProfilerDxe
+# writes to the debug log.
+#
+# At ReadyToBoot, the driver writes the load address, size and PDB path of
+# each loaded image, and the number of samples taken at each address. This
+# tool finds the linker map file of each image next to its PDB path, or in the
+# build output directory, and reports the samples by module and by function.
+#
+# For example, to profile OVMF in QEMU:
+#   build -p OvmfPkg/OvmfPkgX64.dsc -D SAMPLING_PROFILER_ENABLE
+#   qemu-system-x86_64 -bios Build/OvmfX64/DEBUG_GCC5/FV/OVMF.fd \
+#     -debugcon file:debug.log -global isa-debugcon.iobase=0x402 ...
+#   SymbolizeProfile.py -i debug.log -b Build/OvmfX64/DEBUG_GCC5
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+##
+
+from __future__ import print_function
+import bisect
+import os
+import re
+import sys
+from optparse import OptionParser
+
+versionNumber = "1.0"
+__description__ = "Symbolize the instruction pointer samples that SamplingProfilerDxe writes to the debug log."
+
+BeginPattern  = re.compile(r'SamplingProfiler: Begin (\d+) samples at (\d+) Hz, (\d+) lost')
+ImagePattern  = re.compile(r'SamplingProfiler: Image 0x([0-9a-fA-F]+) 0x([0-9a-fA-F]+) (.*?)\s*$')
+SamplePattern = re.compile(r'SamplingProfiler: Sample 0x([0-9a-fA-F]+) (\d+)')
+EndPattern    = re.compile(r'SamplingProfiler: End')
+
+#
+# GNU ld: an input section, with its address and size on the same line or on
+# the next one, and a symbol with its address.
+#
+GnuSectionPattern  = re.compile(r'^\s*\.text\.(\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+\S+)?\s*$')
+GnuAddressPattern  = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+\S+\s*$')
+GnuSymbolPattern   = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_][\w@]*)\s*$')
+
+#
+# Microsoft link: a public or static symbol with its address, and the address
+# the image was linked at.
+#
+MsSymbolPattern    = re.compile(r'^\s*[0-9a-fA-F]{4}:[0-9a-fA-F]{8}\s+(\S+)\s+([0-9a-fA-F]{8,16})\s+f\s')
+MsBasePattern      = re.compile(r'Preferred load address is ([0-9a-fA-F]+)')
+
+class Profile:
+    def __init__(self):
+        self.rate    = 0
+        self.lost    = 0
+        self.images  = []
+        self.samples = []
+
+def parseLog(fileName):
+    """Return the last profile in a debug log."""
+    profile = None
+    current = None
+    with open(fileName, 'r', errors='replace') as f:
+        for line in f:
+            match = BeginPattern.search(line)
+            if match is not None:
+                current = Profile()
+                current.rate = int(match.group(2))
+                current.lost = int(match.group(3))
+                continue
+            if current is None:
+                continue
+            match = ImagePattern.search(line)
+            if match is not None:
+                current.images.append((int(match.group(1), 16), int(match.group(2), 16), match.group(3)))
+                continue
+            match = SamplePattern.search(line)
+            if match is not None:
+                current.samples.append((int(match.group(1), 16), int(match.group(2))))
+                continue
+            if EndPattern.search(line) is not None:
+                profile = current
+                current = None
+    return profile if profile is not None else current
+
+class SymbolMap:
+    """The functions of an image, by RVA, from its linker map file."""
+    def __init__(self, fileName):
+        symbols = {}
+        base    = 0
+        pending = None
+        with open(fileName, 'r', errors='replace') as f:
+            for line in f:
+                match = MsBasePattern.search(line)
+                if match is not None:
+                    base = int(match.group(1), 16)
+                    continue
+                match = MsSymbolPattern.match(line)
+                if match is not None:
+                    symbols[int(match.group(2), 16) - base] = match.group(1)
+                    continue
+                match = GnuSectionPattern.match(line)
+                if match is not None:
+                    if match.group(2) is None:
+                        pending = match.group(1)
+                    elif int(match.group(3), 16) != 0:
+                        symbols.setdefault(int(match.group(2), 16), match.group(1))
+                    continue
+                if pending is not None:
+                    match = GnuAddressPattern.match(line)
+                    if match is not None and int(match.group(2), 16) != 0:
+                        symbols.setdefault(int(match.group(1), 16), pending)
+                    pending = None
+                    continue
+                match = GnuSymbolPattern.match(line)
+                if match is not None:
+                    symbols[int(match.group(1), 16)] = match.group(2)
+        self.addresses = sorted(symbols)
+        self.names     = [symbols[address] for address in self.addresses]
+
+    def lookup(self, rva):
+        index = bisect.bisect_right(self.addresses, rva) - 1
+        if index < 0:
+            return None
+        return self.names[index]
+
+class MapFiles:
+    """Find the linker map file of an image from its PDB path."""
+    def __init__(self, buildDir):
+        self.byName = {}
+        self.maps   = {}
+        if buildDir is None:
+            return
+        for root, dirs, files in os.walk(buildDir):
+            for name in files:
+                if name.lower().endswith('.map'):
+                    self.byName.setdefault(name.lower(), os.path.join(root, name))
+
+    def find(self, pdbPath):
+        if pdbPath in self.maps:
+            return self.maps[pdbPath]
+        #
+        # The PDB path is the .dll, .debug or .pdb file in the DEBUG directory
+        # of the module, where the map file is also written.
+        #
+        stem = os.path.splitext(pdbPath.replace('\\', '/'))[0]
+        fileName = None
+        if os.path.isfile(stem + '.map'):
+            fileName = stem + '.map'
+        else:
+            fileName = self.byName.get(os.path.basename(stem).lower() + '.map')
+        symbols = None
+        if fileName is not None:
+            try:
+                symbols = SymbolMap(fileName)
+            except IOError:
+                symbols = None
+        self.maps[pdbPath] = symbols
+        return symbols
+
+def moduleName(pdbPath):
+    return os.path.splitext(os.path.basename(pdbPath.replace('\\', '/')))[0]
+
+def symbolize(profile, mapFiles):
+    """Return a dictionary of (module, function) to sample count."""
+    images = sorted(profile.images)
+    bases  = [image[0] for image in images]
+    counts = {}
+    for (address, count) in profile.samples:
+        index = bisect.bisect_right(bases, address) - 1
+        if index < 0 or address >= images[index][0] + images[index][1]:
+            key = ('<unknown>', '0x%X' % address)
+        else:
+            base, size, pdbPath = images[index]
+            module  = moduleName(pdbPath)
+            symbols = mapFiles.find(pdbPath)
+            name    = symbols.lookup(address - base) if symbols is not None else None
+            key = (module, name if name is not None else '+0x%X' % (address - base))
+        counts[key] = counts.get(key, 0) + count
+    return counts
+
+def writeReport(profile, counts, output, count):
+    total = sum(counts.values())
+    output.write('%d samples at %d Hz (%.3f s), %d lost\n\n' %
+                 (total, profile.rate, float(total) / max(profile.rate, 1), profile.lost))
+
+    modules = {}
+    for (module, function), samples in counts.items():
+        modules[module] = modules.get(module, 0) + samples
+    output.write('Samples by module:\n')
+    for module in sorted(modules, key=lambda module: modules[module], reverse=True)[:count]:
+        output.write('  %8d %6.2f%%  %s\n' % (modules[module], 100.0 * modules[module] / max(total, 1), module))
+
+    output.write('\nSamples by function:\n')
+    for key in sorted(counts, key=lambda key: counts[key], reverse=True)[:count]:
+        output.write('  %8d %6.2f%%  %s!%s\n' % (counts[key], 100.0 * counts[key] / max(total, 1), key[0], key[1]))
+
+def myOptionParser():
+    usage = "%prog [--version] [-h] [--help] -i debuglog [-b builddir] [-f foldedfile] [-o outputfile] [-n count]"
+    Parser = OptionParser(usage=usage, description=__description__, version="%prog " + str(versionNumber))
+    Parser.add_option("-i", "--inputfile", dest="inputfilename", type="string", help="The debug log that holds the output of SamplingProfilerDxe")
+    Parser.add_option("-b", "--builddir", dest="builddir", type="string", help="The build output directory of the firmware, for example Build/OvmfX64/DEBUG_GCC5, searched for map files that are not at the PDB path")
+    Parser.add_option("-f", "--foldedfile", dest="foldedfilename", type="string", help="The output file for the samples as folded stacks of module and function, which flame graph tools read")
+    Parser.add_option("-o", "--outputfile", dest="outputfilename", type="string", help="The output file for the report, stdout if it is not specified")
+    Parser.add_option("-n", "--count", dest="count", type="int", default=30, help="The number of modules and functions in the report")
+
+    (Options, args) = Parser.parse_args()
+    if Options.inputfilename is None:
+        Parser.error("no input file specified")
+    return Options
+
+def main():
+    Options = myOptionParser()
+
+    try:
+        profile = parseLog(Options.inputfilename)
+    except IOError:
+        print('fail to open ' + Options.inputfilename)
+        return 1
+    if profile is None:
+        print('no sampling profile found in ' + Options.inputfilename)
+        return 1
+
+    counts = symbolize(profile, MapFiles(Options.builddir))
+
+    if Options.foldedfilename is not None:
+        with open(Options.foldedfilename, 'w') as output:
+            for key in sorted(counts):
+                output.write('%s;%s %d\n' % (key[0], key[1], counts[key]))
+    output = open(Options.outputfilename, 'w') if Options.outputfilename is not None else sys.stdout
+    writeReport(profile, counts, output, Options.count)
+    if output is not sys.stdout:
+        output.close()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,458 @@
+/** @file
+  A shell application to measure the sequential read throughput of block
+  devices through the Block I/O and Block I/O 2 protocols.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+#include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
+#include <Protocol/ShellParameters.h>
+
+//
+// String token ID of help message text.
+// Shell supports to find help message in the resource section of an application image if
+// .MAN file is not found. This global variable is added to make build tool recognizes
+// that the help string is consumed by user and then build tool will add the string into
+// the resource section. Thus the application can use '-?' option to show help message in
+// Shell.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED EFI_STRING_ID mStrBlockIoBenchmarkHelpTokenId = STRING_TOKEN (STR_BLOCK_IO_BENCHMARK_HELP_INFORMATION);
+
+#define DEFAULT_TRANSFER_SIZE   SIZE_1MB
+#define DEFAULT_TOTAL_SIZE      SIZE_256MB
+#define MAX_QUEUE_DEPTH         64
+
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN  Token;
+  BOOLEAN              Busy;
+} BENCHMARK_REQUEST;
+
+STATIC UINTN   mArgc;
+STATIC CHAR16  **mArgv;
+STATIC UINT64  mCounterStart;
+STATIC UINT64  mCounterEnd;
+
+/**
+  Display Usage and Help information.
+**/
+STATIC
+VOID
+ShowHelp (
+  VOID
+  )
+{
+  Print (L"Measure the sequential read throughput of block devices.\n");
+  Print (L"\n");
+  Print (L"BlockIoBenchmark [-s TransferKB] [-t TotalMB] [-q Depth] [Index]\n");
+  Print (L"\n");
+  Print (L"  Index      The index of the device to read, as listed when it is absent.\n");
+  Print (L"  -s         The size of each read in KB, 1024 by default.\n");
+  Print (L"  -t         The total size to read in MB, 256 by default.\n");
+  Print (L"  -q         The number of Block I/O 2 reads in flight, up to %d. The\n", MAX_QUEUE_DEPTH);
+  Print (L"             Block I/O protocol is used if it is absent.\n");
+}
+
+/**
+  Add the performance counter ticks since the last call to a running total.
+
+  The performance counter may wrap in a few seconds, so this is called after
+  every read to measure longer periods.
+
+  @param[in, out] Last    The performance counter value of the last call.
+  @param[in, out] Ticks   The running total of ticks.
+**/
+STATIC
+VOID
+UpdateElapsedTicks (
+  IN OUT UINT64  *Last,
+  IN OUT UINT64  *Ticks
+  )
+{
+  UINT64  Now;
+
+  Now = GetPerformanceCounter ();
+  if (mCounterEnd >= mCounterStart) {
+    if (Now >= *Last) {
+      *Ticks += Now - *Last;
+    } else {
+      *Ticks += (mCounterEnd - *Last) + (Now - mCounterStart) + 1;
+    }
+  } else {
+    if (Now <= *Last) {
+      *Ticks += *Last - Now;
+    } else {
+      *Ticks += (*Last - mCounterEnd) + (mCounterStart - Now) + 1;
+    }
+  }
+  *Last = Now;
+}
+
+/**
+  Read a device with the Block I/O protocol.
+
+  @param[in]  BlockIo       The Block I/O protocol of the device.
+  @param[in]  Buffer        The buffer of TransferSize bytes.
+  @param[in]  TransferSize  The size of each read.
+  @param[in]  TotalSize     The total size to read.
+  @param[out] Ticks         The performance counter ticks spent.
+
+  @return The status of the first read that failed, or EFI_SUCCESS.
+**/
+STATIC
+EFI_STATUS
+BenchmarkBlockIo (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  VOID                   *Buffer,
+  IN  UINTN                  TransferSize,
+  IN  UINT64                 TotalSize,
+  OUT UINT64                 *Ticks
+  )
+{
+  EFI_STATUS  Status;
+  EFI_LBA     Lba;
+  UINTN       Size;
+  UINT64      Last;
+
+  Status = EFI_SUCCESS;
+  Lba    = 0;
+  *Ticks = 0;
+  Last   = GetPerformanceCounter ();
+
+  while (TotalSize > 0) {
+    Size   = (UINTN)MIN (TotalSize, TransferSize);
+    Status = BlockIo->ReadBlocks (BlockIo, BlockIo->Media->MediaId, Lba, Size, Buffer);
+    UpdateElapsedTicks (&Last, Ticks);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    Lba       += Size / BlockIo->Media->BlockSize;
+    TotalSize -= Size;
+  }
+
+  return Status;
+}
+
+/**
+  Read a device with the Block I/O 2 protocol, keeping Depth reads in flight.
+
+  @param[in]  BlockIo2      The Block I/O 2 protocol of the device.
+  @param[in]  Buffer        The buffer of Depth times TransferSize bytes.
+  @param[in]  TransferSize  The size of each read.
+  @param[in]  TotalSize     The total size to read.
+  @param[in]  Depth         The number of reads in flight.
+  @param[out] Ticks         The performance counter ticks spent.
+
+  @return The status of the first read that failed, or EFI_SUCCESS.
+**/
+STATIC
+EFI_STATUS
+BenchmarkBlockIo2 (
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2,
+  IN  UINT8                   *Buffer,
+  IN  UINTN                   TransferSize,
+  IN  UINT64                  TotalSize,
+  IN  UINTN                   Depth,
+  OUT UINT64                  *Ticks
+  )
+{
+  BENCHMARK_REQUEST  Requests[MAX_QUEUE_DEPTH];
+  EFI_STATUS         Status;
+  EFI_LBA            Lba;
+  UINTN              Size;
+  UINTN              Index;
+  UINTN              Outstanding;
+  UINT64             Last;
+
+  ASSERT (Depth <= MAX_QUEUE_DEPTH);
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < Depth; Index++) {
+    Requests[Index].Busy = FALSE;
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Requests[Index].Token.Event);
+    if (EFI_ERROR (Status)) {
+      Depth = Index;
+      goto Exit;
+    }
+  }
+
+  Lba         = 0;
+  Outstanding = 0;
+  *Ticks      = 0;
+  Last        = GetPerformanceCounter ();
+
+  do {
+    for (Index = 0; Index < Depth; Index++) {
+      if (Requests[Index].Busy) {
+        if (EFI_ERROR (gBS->CheckEvent (Requests[Index].Token.Event))) {
+          continue;
+        }
+
+        Requests[Index].Busy = FALSE;
+        Outstanding--;
+        if (!EFI_ERROR (Status)) {
+          Status = Requests[Index].Token.TransactionStatus;
+        }
+      }
+
+      if ((TotalSize == 0) || EFI_ERROR (Status)) {
+        continue;
+      }
+
+      Size   = (UINTN)MIN (TotalSize, TransferSize);
+      Status = BlockIo2->ReadBlocksEx (
+                           BlockIo2,
+                           BlockIo2->Media->MediaId,
+                           Lba,
+                           &Requests[Index].Token,
+                           Size,
+                           Buffer + Index * TransferSize
+                           );
+      if (EFI_ERROR (Status)) {
+        continue;
+      }
+
+      Requests[Index].Busy = TRUE;
+      Outstanding++;
+      Lba       += Size / BlockIo2->Media->BlockSize;
+      TotalSize -= Size;
+    }
+
+    UpdateElapsedTicks (&Last, Ticks);
+  } while (Outstanding > 0);
+
+Exit:
+  for (Index = 0; Index < Depth; Index++) {
+    gBS->CloseEvent (Requests[Index].Token.Event);
+  }
+
+  return Status;
+}
+
+/**
+  Get the handles of the Block I/O protocols of the devices with media,
+  skipping partitions.
+
+  @param[out] Handles   The handles, to be freed by the caller.
+  @param[out] Count     The number of handles.
+
+  @return The status of locating the handles.
+**/
+STATIC
+EFI_STATUS
+GetBlockIoHandles (
+  OUT EFI_HANDLE  **Handles,
+  OUT UINTN       *Count
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  UINTN                  HandleCount;
+  UINTN                  Index;
+
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, Handles);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *Count = 0;
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol ((*Handles)[Index], &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
+    if (EFI_ERROR (Status) || BlockIo->Media->LogicalPartition || !BlockIo->Media->MediaPresent) {
+      continue;
+    }
+    (*Handles)[(*Count)++] = (*Handles)[Index];
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  List the devices that can be read.
+
+  @param[in] Handles    The handles of the devices.
+  @param[in] Count      The number of handles.
+**/
+STATIC
+VOID
+ListDevices (
+  IN EFI_HANDLE  *Handles,
+  IN UINTN       Count
+  )
+{
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  CHAR16                 *Text;
+  UINTN                  Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    gBS->HandleProtocol (Handles[Index], &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
+    Text = ConvertDevicePathToText (DevicePathFromHandle (Handles[Index]), FALSE, FALSE);
+    Print (
+      L"%2d: %8ld MB, %4d byte blocks  %s\n",
+      Index,
+      RShiftU64 (MultU64x32 (BlockIo->Media->LastBlock + 1, BlockIo->Media->BlockSize), 20),
+      BlockIo->Media->BlockSize,
+      (Text != NULL) ? Text : L"?"
+      );
+    if (Text != NULL) {
+      FreePool (Text);
+    }
+  }
+}
+
+/**
+  The entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The measurement completed.
+  @retval EFI_INVALID_PARAMETER The arguments are not valid.
+  @retval Others                The device could not be read.
+**/
+EFI_STATUS
+EFIAPI
+BlockIoBenchmarkMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  EFI_HANDLE                     *Handles;
+  UINTN                          Count;
+  UINTN                          Arg;
+  UINTN                          Device;
+  UINTN                          TransferSize;
+  UINT64                         TotalSize;
+  UINTN                          Depth;
+  EFI_BLOCK_IO_PROTOCOL          *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL         *BlockIo2;
+  UINT64                         MediaSize;
+  UINTN                          Alignment;
+  UINTN                          Pages;
+  VOID                           *Buffer;
+  UINT64                         Ticks;
+  UINT64                         Microseconds;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **)&ShellParameters);
+  if (EFI_ERROR (Status)) {
+    Print (L"BlockIoBenchmark: %EError. %NThe input parameters are not recognized.\n");
+    return EFI_INVALID_PARAMETER;
+  }
+  mArgc = ShellParameters->Argc;
+  mArgv = ShellParameters->Argv;
+
+  Device       = MAX_UINTN;
+  TransferSize = DEFAULT_TRANSFER_SIZE;
+  TotalSize    = DEFAULT_TOTAL_SIZE;
+  Depth        = 0;
+
+  for (Arg = 1; Arg < mArgc; Arg++) {
+    if ((StrCmp (mArgv[Arg], L"-?") == 0) || (StrCmp (mArgv[Arg], L"-h") == 0)) {
+      ShowHelp ();
+      return EFI_SUCCESS;
+    } else if ((StrCmp (mArgv[Arg], L"-s") == 0) && (Arg + 1 < mArgc)) {
+      TransferSize = StrDecimalToUintn (mArgv[++Arg]) * SIZE_1KB;
+    } else if ((StrCmp (mArgv[Arg], L"-t") == 0) && (Arg + 1 < mArgc)) {
+      TotalSize = MultU64x32 (StrDecimalToUint64 (mArgv[++Arg]), SIZE_1MB);
+    } else if ((StrCmp (mArgv[Arg], L"-q") == 0) && (Arg + 1 < mArgc)) {
+      Depth = StrDecimalToUintn (mArgv[++Arg]);
+    } else if ((mArgv[Arg][0] >= L'0') && (mArgv[Arg][0] <= L'9')) {
+      Device = StrDecimalToUintn (mArgv[Arg]);
+    } else {
+      Print (L"BlockIoBenchmark: %EError. %NThe argument '%B%s%N' is invalid.\n", mArgv[Arg]);
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if ((TransferSize == 0) || (TotalSize == 0) || (Depth > MAX_QUEUE_DEPTH)) {
+    Print (L"BlockIoBenchmark: %EError. %NThe sizes must not be zero and the depth must be at most %d.\n", MAX_QUEUE_DEPTH);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = GetBlockIoHandles (&Handles, &Count);
+  if (EFI_ERROR (Status)) {
+    Print (L"BlockIoBenchmark: No block device is found.\n");
+    return Status;
+  }
+
+  if (Device == MAX_UINTN) {
+    ListDevices (Handles, Count);
+    FreePool (Handles);
+    return EFI_SUCCESS;
+  }
+
+  if (Device >= Count) {
+    Print (L"BlockIoBenchmark: %EError. %NThere is no device %d.\n", Device);
+    FreePool (Handles);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  gBS->HandleProtocol (Handles[Device], &gEfiBlockIoProtocolGuid, (VOID **)&BlockIo);
+  BlockIo2 = NULL;
+  if (Depth > 0) {
+    Status = gBS->HandleProtocol (Handles[Device], &gEfiBlockIo2ProtocolGuid, (VOID **)&BlockIo2);
+    if (EFI_ERROR (Status)) {
+      Print (L"BlockIoBenchmark: %EError. %NThe device does not support Block I/O 2.\n");
+      FreePool (Handles);
+      return Status;
+    }
+  }
+  FreePool (Handles);
+
+  //
+  // Read whole blocks, and no more than the media holds.
+  //
+  TransferSize = ALIGN_VALUE (TransferSize, BlockIo->Media->BlockSize);
+  MediaSize    = MultU64x32 (BlockIo->Media->LastBlock + 1, BlockIo->Media->BlockSize);
+  TotalSize    = MIN (TotalSize, MediaSize);
+  TotalSize   -= ModU64x32 (TotalSize, BlockIo->Media->BlockSize);
+
+  Alignment = (BlockIo->Media->IoAlign > EFI_PAGE_SIZE) ? BlockIo->Media->IoAlign : 0;
+  Pages     = EFI_SIZE_TO_PAGES (TransferSize * MAX (Depth, 1));
+  Buffer    = AllocateAlignedPages (Pages, Alignment);
+  if (Buffer == NULL) {
+    Print (L"BlockIoBenchmark: %EError. %NThe read buffer cannot be allocated.\n");
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  GetPerformanceCounterProperties (&mCounterStart, &mCounterEnd);
+
+  if (Depth > 0) {
+    Status = BenchmarkBlockIo2 (BlockIo2, Buffer, TransferSize, TotalSize, Depth, &Ticks);
+  } else {
+    Status = BenchmarkBlockIo (BlockIo, Buffer, TransferSize, TotalSize, &Ticks);
+  }
+
+  FreeAlignedPages (Buffer, Pages);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"BlockIoBenchmark: %EError. %NThe read failed: %r.\n", Status);
+    return Status;
+  }
+
+  Microseconds = DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+  Print (
+    L"Read %ld MB in %d KB reads (%a, depth %d) in %ld ms: %ld MB/s\n",
+    RShiftU64 (TotalSize, 20),
+    TransferSize / SIZE_1KB,
+    (Depth > 0) ? "Block I/O 2" : "Block I/O",
+    MAX (Depth, 1),
+    DivU64x32 (Microseconds, 1000),
+    (Microseconds != 0) ? DivU64x64Remainder (MultU64x32 (RShiftU64 (TotalSize, 10), 1000000), MultU64x32 (Microseconds, SIZE_1KB), NULL) : 0
+    );
+
+  return EFI_SUCCESS;
+}
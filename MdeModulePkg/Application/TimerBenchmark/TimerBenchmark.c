@@ -0,0 +1,291 @@
+/** @file
+  A shell application to measure the cost of timer events: arming and
+  cancelling periodic timers, and the CPU time the DXE core takes from the
+  foreground to process them while they run.
+
+  The foreground cost is measured by counting the iterations of a busy loop
+  for a fixed time, first without timers and then with the timers armed.
+  The loop runs at TPL_APPLICATION, so the timer interrupts and the timer
+  notify functions take their time from it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+#include <Protocol/ShellParameters.h>
+
+//
+// String token ID of help message text.
+// Shell supports to find help message in the resource section of an application image if
+// .MAN file is not found. This global variable is added to make build tool recognizes
+// that the help string is consumed by user and then build tool will add the string into
+// the resource section. Thus the application can use '-?' option to show help message in
+// Shell.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED EFI_STRING_ID mStrTimerBenchmarkHelpTokenId = STRING_TOKEN (STR_TIMER_BENCHMARK_HELP_INFORMATION);
+
+#define DEFAULT_TIMER_COUNT     256
+#define DEFAULT_DURATION        5
+
+//
+// The periods of the timers cycle through 1 ms to 100 ms, so that many
+// timers share a period and expire together, as the timers of drivers do.
+//
+#define TIMER_PERIOD(Index)     (((Index) % 100 + 1) * 10000)
+
+STATIC UINTN   mArgc;
+STATIC CHAR16  **mArgv;
+STATIC UINT64  mCounterStart;
+STATIC UINT64  mCounterEnd;
+
+/**
+  Display Usage and Help information.
+**/
+STATIC
+VOID
+ShowHelp (
+  VOID
+  )
+{
+  Print (L"Measure the cost of timer events.\n");
+  Print (L"\n");
+  Print (L"TimerBenchmark [-n Count] [-t Seconds]\n");
+  Print (L"\n");
+  Print (L"  -n         The number of periodic timers, %d by default.\n", DEFAULT_TIMER_COUNT);
+  Print (L"  -t         The duration of each run in seconds, %d by default.\n", DEFAULT_DURATION);
+}
+
+/**
+  Add the performance counter ticks since the last call to a running total.
+
+  The performance counter may wrap in a few seconds, so this is called often
+  to measure longer periods.
+
+  @param[in, out] Last    The performance counter value of the last call.
+  @param[in, out] Ticks   The running total of ticks.
+**/
+STATIC
+VOID
+UpdateElapsedTicks (
+  IN OUT UINT64  *Last,
+  IN OUT UINT64  *Ticks
+  )
+{
+  UINT64  Now;
+
+  Now = GetPerformanceCounter ();
+  if (mCounterEnd >= mCounterStart) {
+    if (Now >= *Last) {
+      *Ticks += Now - *Last;
+    } else {
+      *Ticks += (mCounterEnd - *Last) + (Now - mCounterStart) + 1;
+    }
+  } else {
+    if (Now <= *Last) {
+      *Ticks += *Last - Now;
+    } else {
+      *Ticks += (*Last - mCounterEnd) + (mCounterStart - Now) + 1;
+    }
+  }
+  *Last = Now;
+}
+
+/**
+  Count the timer signals.
+
+  @param[in] Event      The timer event.
+  @param[in] Context    The signal counter.
+**/
+STATIC
+VOID
+EFIAPI
+TimerBenchmarkNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  (*(UINT64 *)Context)++;
+}
+
+/**
+  Run a busy loop for a given time.
+
+  @param[in] Duration   The time to run, in nanoseconds.
+
+  @return The number of iterations of the loop.
+**/
+STATIC
+UINT64
+BusyLoop (
+  IN UINT64  Duration
+  )
+{
+  UINT64  Iterations;
+  UINT64  Ticks;
+  UINT64  Last;
+
+  Iterations = 0;
+  Ticks      = 0;
+  Last       = GetPerformanceCounter ();
+  do {
+    Iterations++;
+    UpdateElapsedTicks (&Last, &Ticks);
+  } while (GetTimeInNanoSecond (Ticks) < Duration);
+
+  return Iterations;
+}
+
+/**
+  The entry point for the application.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The measurement completed.
+  @retval EFI_INVALID_PARAMETER The arguments are not valid.
+  @retval Others                The timers could not be created.
+**/
+EFI_STATUS
+EFIAPI
+TimerBenchmarkMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  UINTN                          Arg;
+  UINTN                          Count;
+  UINT64                         Duration;
+  EFI_EVENT                      *Events;
+  UINT64                         Signals;
+  UINT64                         Expected;
+  UINTN                          Index;
+  UINT64                         Last;
+  UINT64                         SetTicks;
+  UINT64                         CancelTicks;
+  UINT64                         IdleIterations;
+  UINT64                         TimerIterations;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid, (VOID **)&ShellParameters);
+  if (EFI_ERROR (Status)) {
+    Print (L"TimerBenchmark: %EError. %NThe input parameters are not recognized.\n");
+    return EFI_INVALID_PARAMETER;
+  }
+  mArgc = ShellParameters->Argc;
+  mArgv = ShellParameters->Argv;
+
+  Count    = DEFAULT_TIMER_COUNT;
+  Duration = DEFAULT_DURATION;
+
+  for (Arg = 1; Arg < mArgc; Arg++) {
+    if ((StrCmp (mArgv[Arg], L"-?") == 0) || (StrCmp (mArgv[Arg], L"-h") == 0)) {
+      ShowHelp ();
+      return EFI_SUCCESS;
+    } else if ((StrCmp (mArgv[Arg], L"-n") == 0) && (Arg + 1 < mArgc)) {
+      Count = StrDecimalToUintn (mArgv[++Arg]);
+    } else if ((StrCmp (mArgv[Arg], L"-t") == 0) && (Arg + 1 < mArgc)) {
+      Duration = StrDecimalToUint64 (mArgv[++Arg]);
+    } else {
+      Print (L"TimerBenchmark: %EError. %NThe argument '%B%s%N' is invalid.\n", mArgv[Arg]);
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if ((Count == 0) || (Duration == 0)) {
+    Print (L"TimerBenchmark: %EError. %NThe count and the duration must not be zero.\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Events = AllocateZeroPool (Count * sizeof (EFI_EVENT));
+  if (Events == NULL) {
+    Print (L"TimerBenchmark: %EError. %NThe events cannot be allocated.\n");
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Signals = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Status = gBS->CreateEvent (
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    TimerBenchmarkNotify,
+                    &Signals,
+                    &Events[Index]
+                    );
+    if (EFI_ERROR (Status)) {
+      Print (L"TimerBenchmark: %EError. %NThe timer events cannot be created: %r.\n", Status);
+      goto Exit;
+    }
+  }
+
+  GetPerformanceCounterProperties (&mCounterStart, &mCounterEnd);
+  Duration = MultU64x32 (Duration, 1000000000);
+
+  //
+  // The foreground speed without timers.
+  //
+  IdleIterations = BusyLoop (Duration);
+
+  //
+  // Arm the timers, then measure the foreground speed while they run.
+  //
+  SetTicks = 0;
+  Last     = GetPerformanceCounter ();
+  for (Index = 0; Index < Count; Index++) {
+    gBS->SetTimer (Events[Index], TimerPeriodic, TIMER_PERIOD (Index));
+  }
+  UpdateElapsedTicks (&Last, &SetTicks);
+
+  TimerIterations = BusyLoop (Duration);
+
+  CancelTicks = 0;
+  Last        = GetPerformanceCounter ();
+  for (Index = 0; Index < Count; Index++) {
+    gBS->SetTimer (Events[Index], TimerCancel, 0);
+  }
+  UpdateElapsedTicks (&Last, &CancelTicks);
+
+  Expected = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Expected += DivU64x32 (Duration, TIMER_PERIOD (Index) * 100);
+  }
+
+  Print (L"%d periodic timers of 1 to 100 ms for %ld s:\n", Count, DivU64x32 (Duration, 1000000000));
+  Print (L"  SetTimer:    %ld ns per call to arm, %ld ns per call to cancel\n",
+    DivU64x32 (GetTimeInNanoSecond (SetTicks), (UINT32)Count),
+    DivU64x32 (GetTimeInNanoSecond (CancelTicks), (UINT32)Count)
+    );
+  Print (L"  Signals:     %ld of %ld expected\n", Signals, Expected);
+  Print (L"  Foreground:  %ld iterations without timers, %ld with timers",
+    IdleIterations,
+    TimerIterations
+    );
+  if ((IdleIterations != 0) && (TimerIterations <= IdleIterations)) {
+    Print (L", %ld.%02ld%% taken by the timers\n",
+      DivU64x64Remainder (MultU64x32 (IdleIterations - TimerIterations, 100), IdleIterations, NULL),
+      ModU64x32 (DivU64x64Remainder (MultU64x32 (IdleIterations - TimerIterations, 10000), IdleIterations, NULL), 100)
+      );
+  } else {
+    Print (L"\n");
+  }
+
+  Status = EFI_SUCCESS;
+
+Exit:
+  for (Index = 0; Index < Count; Index++) {
+    if (Events[Index] != NULL) {
+      gBS->CloseEvent (Events[Index]);
+    }
+  }
+  FreePool (Events);
+
+  return Status;
+}
@@ -1484,28 +1484,24 @@ AhciStopCommand (
 }
 
 /**
-  Start command for give slot on specific port.
+  Start the command list processing of specific port.
 
   @param  PciIo              The PCI IO protocol instance.
   @param  Port               The number of port.
-  @param  CommandSlot        The number of Command Slot.
   @param  Timeout            The timeout value of start, uses 100ns as a unit.
 
-  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_DEVICE_ERROR   The port start unsuccessfully.
   @retval EFI_TIMEOUT        The operation is time out.
-  @retval EFI_SUCCESS        The command start successfully.
+  @retval EFI_SUCCESS        The port start successfully.
 
 **/
 EFI_STATUS
-EFIAPI
-AhciStartCommand (
+AhciStartPort (
   IN  EFI_PCI_IO_PROTOCOL       *PciIo,
   IN  UINT8                     Port,
-  IN  UINT8                     CommandSlot,
   IN  UINT64                    Timeout
   )
 {
-  UINT32     CmdSlotBit;
   EFI_STATUS Status;
   UINT32     PortStatus;
   UINT32     StartCmd;
@@ -1518,8 +1514,6 @@ AhciStartCommand (
   //
   Capability = AhciReadReg(PciIo, EFI_AHCI_CAPABILITY_OFFSET);
 
-  CmdSlotBit = (UINT32) (1 << CommandSlot);
-
   AhciClearPortStatus (
     PciIo,
     Port
@@ -1566,6 +1560,42 @@ AhciStartCommand (
   Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CMD;
   AhciOrReg (PciIo, Offset, EFI_AHCI_PORT_CMD_ST | StartCmd);
 
+  return EFI_SUCCESS;
+}
+
+/**
+  Start command for give slot on specific port.
+
+  @param  PciIo              The PCI IO protocol instance.
+  @param  Port               The number of port.
+  @param  CommandSlot        The number of Command Slot.
+  @param  Timeout            The timeout value of start, uses 100ns as a unit.
+
+  @retval EFI_DEVICE_ERROR   The command start unsuccessfully.
+  @retval EFI_TIMEOUT        The operation is time out.
+  @retval EFI_SUCCESS        The command start successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciStartCommand (
+  IN  EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN  UINT8                     Port,
+  IN  UINT8                     CommandSlot,
+  IN  UINT64                    Timeout
+  )
+{
+  UINT32     CmdSlotBit;
+  EFI_STATUS Status;
+  UINT32     Offset;
+
+  CmdSlotBit = (UINT32) (1 << CommandSlot);
+
+  Status = AhciStartPort (PciIo, Port, Timeout);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   //
   // Setting the command
   //
@@ -2425,6 +2455,481 @@ AhciReadLogExt (
            );
 }
 
+/**
+  Allocate the command tables of queued commands, if Native Command Queuing
+  is enabled by PcdAhciNcqEnable and the HBA supports it.
+
+  @param  PciIo                 The PCI IO protocol instance.
+  @param  AhciRegisters         The pointer to the EFI_AHCI_REGISTERS.
+
+  @retval EFI_SUCCESS           The command tables are allocated, or NCQ is
+                                not used.
+  @retval EFI_OUT_OF_RESOURCES  The command tables cannot be allocated.
+  @retval EFI_DEVICE_ERROR      The command tables are above 4GB and the HBA
+                                does not support 64-bit addressing.
+**/
+EFI_STATUS
+AhciCreateNcqTransferDescriptor (
+  IN     EFI_PCI_IO_PROTOCOL    *PciIo,
+  IN OUT EFI_AHCI_REGISTERS     *AhciRegisters
+  )
+{
+  EFI_STATUS            Status;
+  UINT32                Capability;
+  UINT32                MaxCommandSlot;
+  UINTN                 Size;
+  UINTN                 Bytes;
+  VOID                  *Buffer;
+  VOID                  *Map;
+  EFI_PHYSICAL_ADDRESS  PciAddr;
+
+  AhciRegisters->NcqTagMask = 0;
+  if (!FeaturePcdGet (PcdAhciNcqEnable)) {
+    return EFI_SUCCESS;
+  }
+
+  Capability     = AhciReadReg (PciIo, EFI_AHCI_CAPABILITY_OFFSET);
+  MaxCommandSlot = (Capability & 0x1F00) >> 8;
+  if (((Capability & EFI_AHCI_CAP_SNCQ) == 0) || (MaxCommandSlot == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  Size   = AHCI_NCQ_MAX_TAGS * sizeof (AHCI_NCQ_COMMAND_TABLE);
+  Buffer = NULL;
+  Status = PciIo->AllocateBuffer (
+                    PciIo,
+                    AllocateAnyPages,
+                    EfiBootServicesData,
+                    EFI_SIZE_TO_PAGES (Size),
+                    &Buffer,
+                    0
+                    );
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Bytes  = Size;
+  Status = PciIo->Map (
+                    PciIo,
+                    EfiPciIoOperationBusMasterCommonBuffer,
+                    Buffer,
+                    &Bytes,
+                    &PciAddr,
+                    &Map
+                    );
+  if (EFI_ERROR (Status) || (Bytes != Size)) {
+    if (!EFI_ERROR (Status)) {
+      PciIo->Unmap (PciIo, Map);
+    }
+    PciIo->FreeBuffer (PciIo, EFI_SIZE_TO_PAGES (Size), Buffer);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (((Capability & EFI_AHCI_CAP_S64A) == 0) && (PciAddr + Size > 0x100000000ULL)) {
+    PciIo->Unmap (PciIo, Map);
+    PciIo->FreeBuffer (PciIo, EFI_SIZE_TO_PAGES (Size), Buffer);
+    return EFI_DEVICE_ERROR;
+  }
+
+  ZeroMem (Buffer, Size);
+
+  AhciRegisters->AhciNcqCommandTable        = Buffer;
+  AhciRegisters->AhciNcqCommandTablePciAddr = (AHCI_NCQ_COMMAND_TABLE *)(UINTN)PciAddr;
+  AhciRegisters->MapNcqCommandTable         = Map;
+  //
+  // Slots 1 to MaxCommandSlot. Slot 0 is left to the non-queued commands.
+  //
+  AhciRegisters->NcqTagMask = (UINT32)(LShiftU64 (1, MaxCommandSlot + 1) - 2);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Build the command list entry and the command table of a queued command.
+
+  @param  AhciRegisters         The pointer to the EFI_AHCI_REGISTERS.
+  @param  Tag                   The command slot and NCQ tag of the command.
+  @param  Read                  The transfer direction.
+  @param  AtaCommandBlock       The EFI_ATA_COMMAND_BLOCK data.
+  @param  DataPhysicalAddr      The data buffer pci bus master address.
+  @param  DataLength            The data count to be transferred.
+  @param  PrdtNumber            The number of PRDT entries for the data buffer.
+
+**/
+VOID
+AhciBuildNcqCommand (
+  IN EFI_AHCI_REGISTERS         *AhciRegisters,
+  IN UINT8                      Tag,
+  IN BOOLEAN                    Read,
+  IN EFI_ATA_COMMAND_BLOCK      *AtaCommandBlock,
+  IN EFI_PHYSICAL_ADDRESS       DataPhysicalAddr,
+  IN UINT32                     DataLength,
+  IN UINT32                     PrdtNumber
+  )
+{
+  AHCI_NCQ_COMMAND_TABLE        *CommandTable;
+  EFI_AHCI_COMMAND_LIST         *CommandList;
+  UINT32                        PrdtIndex;
+  UINTN                         RemainedData;
+  DATA_64                       Data64;
+
+  CommandTable = &AhciRegisters->AhciNcqCommandTable[Tag];
+  ZeroMem (
+    CommandTable,
+    OFFSET_OF (AHCI_NCQ_COMMAND_TABLE, PrdtTable) + PrdtNumber * sizeof (EFI_AHCI_COMMAND_PRDT)
+    );
+
+  //
+  // For FPDMA commands, the sector count is in the Features field, the tag
+  // goes in bits 7:3 of the Count field, and the Device field only holds the
+  // FUA bit and the LBA bit.
+  //
+  AhciBuildCommandFis (&CommandTable->CommandFis, AtaCommandBlock);
+  CommandTable->CommandFis.AhciCFisSecCount = (UINT8) ((AtaCommandBlock->AtaSectorCount & 0x07) | (Tag << 3));
+  CommandTable->CommandFis.AhciCFisDevHead  = (UINT8) ((AtaCommandBlock->AtaDeviceHead & BIT7) | BIT6);
+
+  RemainedData = (UINTN) DataLength;
+  for (PrdtIndex = 0; PrdtIndex < PrdtNumber; PrdtIndex++) {
+    if (RemainedData < EFI_AHCI_MAX_DATA_PER_PRDT) {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = (UINT32)RemainedData - 1;
+    } else {
+      CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbc = EFI_AHCI_MAX_DATA_PER_PRDT - 1;
+    }
+
+    Data64.Uint64 = DataPhysicalAddr;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDba  = Data64.Uint32.Lower32;
+    CommandTable->PrdtTable[PrdtIndex].AhciPrdtDbau = Data64.Uint32.Upper32;
+    RemainedData     -= EFI_AHCI_MAX_DATA_PER_PRDT;
+    DataPhysicalAddr += EFI_AHCI_MAX_DATA_PER_PRDT;
+  }
+
+  CommandList = &AhciRegisters->AhciCmdList[Tag];
+  ZeroMem (CommandList, sizeof (EFI_AHCI_COMMAND_LIST));
+  CommandList->AhciCmdCfl   = EFI_AHCI_FIS_REGISTER_H2D_LENGTH / 4;
+  CommandList->AhciCmdW     = Read ? 0 : 1;
+  CommandList->AhciCmdPrdtl = PrdtNumber;
+
+  Data64.Uint64 = (UINT64)(UINTN) &AhciRegisters->AhciNcqCommandTablePciAddr[Tag];
+  CommandList->AhciCmdCtba  = Data64.Uint32.Lower32;
+  CommandList->AhciCmdCtbau = Data64.Uint32.Upper32;
+}
+
+/**
+  Recover a port after a queued command failed or timed out.
+
+  The device aborts every outstanding queued command when one of them fails,
+  and then waits for the host to read the NCQ Command Error log.
+
+  @param  PciIo               The PCI IO protocol instance.
+  @param  AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param  Port                The number of port.
+
+**/
+VOID
+AhciNcqRecoverPort (
+  IN EFI_PCI_IO_PROTOCOL       *PciIo,
+  IN EFI_AHCI_REGISTERS        *AhciRegisters,
+  IN UINT8                     Port
+  )
+{
+  EFI_STATUS                   Status;
+  UINT8                        LogBuffer[512];
+
+  Status = AhciRecoverPortError (PciIo, Port);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+
+  Status = AhciReadLogExt (PciIo, AhciRegisters, Port, 0, LogBuffer, AHCI_NCQ_ERROR_LOG, 0);
+  if (!EFI_ERROR (Status)) {
+    DEBUG ((
+      DEBUG_ERROR, "NCQ command error log: tag %d, status 0x%x, error 0x%x\n",
+      LogBuffer[0] & 0x1F, LogBuffer[2], LogBuffer[3]
+      ));
+  }
+}
+
+/**
+  Release the command slot and the data buffer mapping of a queued command.
+
+  If the command is still outstanding, the port is stopped first, which aborts
+  every queued command on the port.
+
+  @param[in]  Instance   The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Task       Pointer to the ATA_NONBLOCK_TASK of the started
+                         queued command.
+
+**/
+VOID
+EFIAPI
+AhciNcqReleaseTask (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     ATA_NONBLOCK_TASK            *Task
+  )
+{
+  EFI_PCI_IO_PROTOCOL          *PciIo;
+  EFI_AHCI_REGISTERS           *AhciRegisters;
+  UINT8                        Port;
+  UINT32                       TagBit;
+  UINT32                       Outstanding;
+  UINT32                       Offset;
+
+  PciIo         = Instance->PciIo;
+  AhciRegisters = &Instance->AhciRegisters;
+  Port          = (UINT8) Task->Port;
+  TagBit        = ((UINT32)BIT0) << Task->NcqTag;
+
+  Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+  Outstanding = AhciReadReg (PciIo, Offset);
+  Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+  Outstanding |= AhciReadReg (PciIo, Offset);
+  if ((Outstanding & TagBit) != 0) {
+    AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+  }
+
+  AhciRegisters->NcqTagsInUse      &= ~TagBit;
+  AhciRegisters->NcqPortTags[Port] &= ~TagBit;
+
+  //
+  // The port runs while it has queued commands outstanding. Stop it with the
+  // last one, as the non-queued commands expect.
+  //
+  if (AhciRegisters->NcqPortTags[Port] == 0) {
+    AhciStopCommand (PciIo, Port, ATA_ATAPI_TIMEOUT);
+    AhciDisableFisReceive (PciIo, Port, ATA_ATAPI_TIMEOUT);
+  }
+
+  PciIo->Unmap (PciIo, Task->Map);
+  Task->Map     = NULL;
+  Task->IsStart = FALSE;
+}
+
+/**
+  Start or check a queued (FPDMA) data transfer on specific port.
+
+  In non-blocking mode, the first call issues the command in a free command
+  slot below the queue depth of the device, and later calls check whether it
+  has completed. Several commands can be outstanding on a port at the same
+  time, and they may complete in any order.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]       Port                The number of port.
+  @param[in]       Read                The transfer direction.
+  @param[in]       AtaCommandBlock     The EFI_ATA_COMMAND_BLOCK data.
+  @param[in, out]  AtaStatusBlock      The EFI_ATA_STATUS_BLOCK data.
+  @param[in, out]  MemoryAddr          The pointer to the data buffer.
+  @param[in]       DataCount           The data count to be transferred.
+  @param[in]       Timeout             The timeout value of data transfer, uses 100ns as a unit.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_NOT_READY       The command is waiting for a command slot, or has
+                              not completed yet.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer cannot be mapped, or needs too
+                              many PRDT entries.
+  @retval EFI_DEVICE_ERROR    The queued data transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_SUCCESS         The queued data transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     EFI_AHCI_REGISTERS           *AhciRegisters,
+  IN     UINT8                        Port,
+  IN     BOOLEAN                      Read,
+  IN     EFI_ATA_COMMAND_BLOCK        *AtaCommandBlock,
+  IN OUT EFI_ATA_STATUS_BLOCK         *AtaStatusBlock,
+  IN OUT VOID                         *MemoryAddr,
+  IN     UINT32                       DataCount,
+  IN     UINT64                       Timeout,
+  IN     ATA_NONBLOCK_TASK            *Task
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_PCI_IO_PROTOCOL           *PciIo;
+  EFI_PCI_IO_PROTOCOL_OPERATION Flag;
+  EFI_PHYSICAL_ADDRESS          PhyAddr;
+  VOID                          *Map;
+  UINTN                         MapLength;
+  UINT32                        PrdtNumber;
+  UINT32                        FreeTags;
+  UINT32                        TagBit;
+  UINT32                        Offset;
+  UINT32                        PortInterrupt;
+  UINT32                        Outstanding;
+  UINT8                         Tag;
+  ATA_NONBLOCK_TASK             BlockingTask;
+  EFI_TPL                       OldTpl;
+
+  PciIo = Instance->PciIo;
+
+  if (Task == NULL) {
+    //
+    // For blocking mode, run the command as a private task and poll it to the
+    // end. The caller has finished the outstanding queued commands already,
+    // and TPL_NOTIFY keeps the non-blocking timer from issuing new ones.
+    //
+    ZeroMem (&BlockingTask, sizeof (ATA_NONBLOCK_TASK));
+    BlockingTask.Port         = Port;
+    BlockingTask.RetryTimes   = DivU64x32 (Timeout, 1000) + 1;
+    BlockingTask.InfiniteWait = (BOOLEAN) (Timeout == 0);
+
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    do {
+      Status = AhciNcqTransfer (
+                 Instance,
+                 AhciRegisters,
+                 Port,
+                 Read,
+                 AtaCommandBlock,
+                 AtaStatusBlock,
+                 MemoryAddr,
+                 DataCount,
+                 Timeout,
+                 &BlockingTask
+                 );
+      if (Status == EFI_NOT_READY) {
+        //
+        // Stall for 100us.
+        //
+        MicroSecondDelay (100);
+      }
+    } while (Status == EFI_NOT_READY);
+    gBS->RestoreTPL (OldTpl);
+
+    return Status;
+  }
+
+  if (!Task->IsStart) {
+    if (AhciRegisters->NcqDepth[Port] == 0) {
+      return EFI_UNSUPPORTED;
+    }
+
+    //
+    // Wait for a free command slot whose number the device accepts as a tag.
+    // The ports share the command list, so a slot used by any port is busy.
+    //
+    FreeTags = AhciRegisters->NcqTagMask & ~AhciRegisters->NcqTagsInUse &
+               AHCI_NCQ_DEPTH_TAGS (AhciRegisters->NcqDepth[Port]);
+    if (FreeTags == 0) {
+      return EFI_NOT_READY;
+    }
+
+    Tag    = (UINT8) LowBitSet32 (FreeTags);
+    TagBit = ((UINT32)BIT0) << Tag;
+
+    PrdtNumber = (UINT32)DivU64x32 (((UINT64)DataCount + EFI_AHCI_MAX_DATA_PER_PRDT - 1), EFI_AHCI_MAX_DATA_PER_PRDT);
+    if (PrdtNumber > AHCI_NCQ_MAX_PRDT) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+
+    if (Read) {
+      Flag = EfiPciIoOperationBusMasterWrite;
+    } else {
+      Flag = EfiPciIoOperationBusMasterRead;
+    }
+
+    MapLength = DataCount;
+    Status = PciIo->Map (
+                      PciIo,
+                      Flag,
+                      MemoryAddr,
+                      &MapLength,
+                      &PhyAddr,
+                      &Map
+                      );
+    if (EFI_ERROR (Status) || (DataCount != MapLength)) {
+      if (!EFI_ERROR (Status)) {
+        PciIo->Unmap (PciIo, Map);
+      }
+      return EFI_BAD_BUFFER_SIZE;
+    }
+
+    if (AhciRegisters->NcqPortTags[Port] == 0) {
+      Status = AhciStartPort (PciIo, Port, Timeout);
+      if (EFI_ERROR (Status)) {
+        PciIo->Unmap (PciIo, Map);
+        return Status;
+      }
+    }
+
+    AhciBuildNcqCommand (AhciRegisters, Tag, Read, AtaCommandBlock, PhyAddr, DataCount, PrdtNumber);
+
+    DEBUG ((DEBUG_VERBOSE, "Starting queued command in slot %d:\n", Tag));
+    AhciPrintCommandBlock (AtaCommandBlock, DEBUG_VERBOSE);
+
+    //
+    // PxSACT must be set before PxCI for a queued command.
+    //
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+    AhciWriteReg (PciIo, Offset, TagBit);
+    Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+    AhciWriteReg (PciIo, Offset, TagBit);
+
+    AhciRegisters->NcqTagsInUse      |= TagBit;
+    AhciRegisters->NcqPortTags[Port] |= TagBit;
+    Task->NcqTag  = Tag;
+    Task->Map     = Map;
+    Task->IsStart = TRUE;
+
+    return EFI_NOT_READY;
+  }
+
+  //
+  // The device clears the PxSACT bit of a command with a Set Device Bits FIS
+  // when the command completes.
+  //
+  TagBit = ((UINT32)BIT0) << Task->NcqTag;
+  Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_IS;
+  PortInterrupt = AhciReadReg (PciIo, Offset);
+  if ((PortInterrupt & EFI_AHCI_PORT_IS_ERROR_MASK) != 0) {
+    DEBUG ((DEBUG_ERROR, "AHCI: Error interrupt reported PxIS: %X\n", PortInterrupt));
+    Status = EFI_DEVICE_ERROR;
+  } else {
+    Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_SACT;
+    Outstanding = AhciReadReg (PciIo, Offset);
+    Offset      = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_CI;
+    Outstanding |= AhciReadReg (PciIo, Offset);
+    if ((Outstanding & TagBit) == 0) {
+      Status = EFI_SUCCESS;
+    } else if (!Task->InfiniteWait && (Task->RetryTimes == 0)) {
+      Status = EFI_TIMEOUT;
+    } else {
+      Task->RetryTimes--;
+      return EFI_NOT_READY;
+    }
+  }
+
+  if (Status == EFI_SUCCESS) {
+    if (AtaStatusBlock != NULL) {
+      ZeroMem (AtaStatusBlock, sizeof (EFI_ATA_STATUS_BLOCK));
+      Offset = EFI_AHCI_PORT_START + Port * EFI_AHCI_PORT_REG_WIDTH + EFI_AHCI_PORT_TFD;
+      AtaStatusBlock->AtaStatus = (UINT8) AhciReadReg (PciIo, Offset);
+      AhciPrintStatusBlock (AtaStatusBlock, DEBUG_VERBOSE);
+    }
+  } else {
+    //
+    // An error or a timeout ends every queued command on the port.
+    //
+    AhciDumpPortStatus (PciIo, AhciRegisters, Port, AtaStatusBlock);
+    DEBUG ((DEBUG_ERROR, "Failed to execute queued command in slot %d - %r\n", Task->NcqTag, Status));
+    AhciPrintCommandBlock (AtaCommandBlock, DEBUG_ERROR);
+    if (AtaStatusBlock != NULL) {
+      AhciPrintStatusBlock (AtaStatusBlock, DEBUG_ERROR);
+    }
+    AhciNcqRecoverPort (PciIo, AhciRegisters, Port);
+  }
+
+  AhciNcqReleaseTask (Instance, Task);
+
+  return Status;
+}
+
 /**
   Enable DEVSLP of the disk if supported.
 
@@ -2734,6 +3239,7 @@ AhciModeInitialization (
   EFI_ATA_TRANSFER_MODE            TransferMode;
   UINT32                           PhyDetectDelay;
   UINT32                           Value;
+  UINT32                           NcqDepth;
 
   if (Instance == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -2798,6 +3304,11 @@ AhciModeInitialization (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  Status = AhciCreateNcqTransferDescriptor (PciIo, AhciRegisters);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "AhciModeInitialization: NCQ is disabled - %r\n", Status));
+  }
+
   for (Port = 0; Port < EFI_AHCI_MAX_PORTS; Port ++) {
     if ((PortImplementBitMap & (((UINT32)BIT0) << Port)) != 0) {
       //
@@ -3028,6 +3539,22 @@ AhciModeInitialization (
           0,
           &Buffer
           );
+
+        //
+        // Word 76 bit 8 reports NCQ support, and word 75 bits 4:0 the queue
+        // depth of the device minus one. The device only accepts the tags
+        // below its queue depth, so a device that leaves no free slot in that
+        // range can't queue commands.
+        //
+        if ((AhciRegisters->NcqTagMask != 0) &&
+            (Buffer.AtaData.serial_ata_capabilities != 0xFFFF) &&
+            ((Buffer.AtaData.serial_ata_capabilities & BIT8) != 0)) {
+          NcqDepth = (Buffer.AtaData.queue_depth & 0x1F) + 1;
+          if ((AhciRegisters->NcqTagMask & AHCI_NCQ_DEPTH_TAGS (NcqDepth)) != 0) {
+            AhciRegisters->NcqDepth[Port] = (UINT8) NcqDepth;
+            DEBUG ((DEBUG_INFO, "port [%d] supports NCQ, queue depth %d\n", Port, NcqDepth));
+          }
+        }
       }
 
       //
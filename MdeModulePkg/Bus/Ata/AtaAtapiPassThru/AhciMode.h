@@ -13,6 +13,7 @@
 #define EFI_AHCI_CAPABILITY_OFFSET             0x0000
 #define   EFI_AHCI_CAP_SAM                     BIT18
 #define   EFI_AHCI_CAP_SSS                     BIT27
+#define   EFI_AHCI_CAP_SNCQ                    BIT30
 #define   EFI_AHCI_CAP_S64A                    BIT31
 #define EFI_AHCI_GHC_OFFSET                    0x0004
 #define   EFI_AHCI_GHC_RESET                   BIT0
@@ -194,6 +195,21 @@ typedef union {
 
 #define AHCI_COMMAND_RETRIES  5
 
+//
+// Native Command Queuing. Queued commands use command slots 1 to 31, slot 0
+// stays with the non-queued commands. Each queued command has its own command
+// table, with enough PRDT entries for the largest FPDMA transfer: 65536
+// sectors of 4KB.
+//
+#define AHCI_NCQ_MAX_TAGS                      32
+
+//
+// The tags a device with a queue depth of Depth accepts, as a mask.
+//
+#define AHCI_NCQ_DEPTH_TAGS(Depth)             ((UINT32) (LShiftU64 (1, (Depth)) - 1))
+#define AHCI_NCQ_MAX_PRDT                      64
+#define AHCI_NCQ_ERROR_LOG                     0x10
+
 #pragma pack(1)
 //
 // Command List structure includes total 32 entries.
@@ -284,6 +300,16 @@ typedef struct {
   EFI_AHCI_COMMAND_PRDT     PrdtTable[65535];     // The scatter/gather list for data transfer
 } EFI_AHCI_COMMAND_TABLE;
 
+//
+// Command table of a queued command.
+//
+typedef struct {
+  EFI_AHCI_COMMAND_FIS      CommandFis;
+  EFI_AHCI_ATAPI_COMMAND    AtapiCmd;
+  UINT8                     Reserved[0x30];
+  EFI_AHCI_COMMAND_PRDT     PrdtTable[AHCI_NCQ_MAX_PRDT];
+} AHCI_NCQ_COMMAND_TABLE;
+
 //
 // Received FIS structure
 //
@@ -323,6 +349,19 @@ typedef struct {
   VOID                      *MapRFis;
   VOID                      *MapCmdList;
   VOID                      *MapCommandTable;
+  //
+  // Native Command Queuing. NcqTagMask is the set of command slots that can
+  // hold a queued command, and is zero if the HBA does not support NCQ.
+  // NcqDepth is the queue depth of the device on each port, which accepts the
+  // tags 0 to NcqDepth - 1, and is zero if the device does not support NCQ.
+  //
+  AHCI_NCQ_COMMAND_TABLE    *AhciNcqCommandTable;
+  AHCI_NCQ_COMMAND_TABLE    *AhciNcqCommandTablePciAddr;
+  VOID                      *MapNcqCommandTable;
+  UINT32                    NcqTagMask;
+  UINT32                    NcqTagsInUse;
+  UINT32                    NcqPortTags[EFI_AHCI_MAX_PORTS];
+  UINT8                     NcqDepth[EFI_AHCI_MAX_PORTS];
 } EFI_AHCI_REGISTERS;
 
 /**
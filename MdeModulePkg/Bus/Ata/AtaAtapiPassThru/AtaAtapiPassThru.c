@@ -193,6 +193,7 @@ AtaPassThruPassThruExecute (
   EFI_ATA_PASS_THRU_CMD_PROTOCOL  Protocol;
   EFI_ATA_HC_WORK_MODE            Mode;
   EFI_STATUS                      Status;
+  EFI_TPL                         OldTpl;
 
   Protocol = Packet->Protocol;
 
@@ -284,6 +285,25 @@ AtaPassThruPassThruExecute (
         //
         PortMultiplierPort = 0;
       }
+
+      //
+      // A command must not be issued to the device while queued commands are
+      // outstanding. Blocking commands wait for the queued commands to finish,
+      // and run at TPL_NOTIFY so that the non-blocking timer can't issue new
+      // ones before they are done.
+      //
+      OldTpl = TPL_APPLICATION;
+      if (Task == NULL) {
+        OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+        while (Instance->AhciRegisters.NcqTagsInUse != 0) {
+          AsyncNonBlockingTransferRoutine (NULL, Instance);
+          //
+          // Stall for 100us.
+          //
+          MicroSecondDelay (100);
+        }
+      }
+
       switch (Protocol) {
         case EFI_ATA_PASS_THRU_PROTOCOL_ATA_NON_DATA:
           Status = AhciNonDataTransfer (
@@ -367,8 +387,42 @@ AtaPassThruPassThruExecute (
                      Task
                      );
           break;
+        case EFI_ATA_PASS_THRU_PROTOCOL_FPDMA:
+          if (Packet->InTransferLength != 0) {
+            Status = AhciNcqTransfer (
+                       Instance,
+                       &Instance->AhciRegisters,
+                       (UINT8)Port,
+                       TRUE,
+                       Packet->Acb,
+                       Packet->Asb,
+                       Packet->InDataBuffer,
+                       Packet->InTransferLength,
+                       Packet->Timeout,
+                       Task
+                       );
+          } else {
+            Status = AhciNcqTransfer (
+                       Instance,
+                       &Instance->AhciRegisters,
+                       (UINT8)Port,
+                       FALSE,
+                       Packet->Acb,
+                       Packet->Asb,
+                       Packet->OutDataBuffer,
+                       Packet->OutTransferLength,
+                       Packet->Timeout,
+                       Task
+                       );
+          }
+          break;
         default :
-          return EFI_UNSUPPORTED;
+          Status = EFI_UNSUPPORTED;
+          break;
+      }
+
+      if (Task == NULL) {
+        gBS->RestoreTPL (OldTpl);
       }
       break;
 
@@ -396,23 +450,28 @@ AsyncNonBlockingTransferRoutine (
   )
 {
   LIST_ENTRY                   *Entry;
+  LIST_ENTRY                   *NextEntry;
   LIST_ENTRY                   *EntryHeader;
   ATA_NONBLOCK_TASK            *Task;
   EFI_STATUS                   Status;
   ATA_ATAPI_PASS_THRU_INSTANCE *Instance;
+  BOOLEAN                      IsQueued;
 
   Instance   = (ATA_ATAPI_PASS_THRU_INSTANCE *) Context;
   EntryHeader = &Instance->NonBlockingTaskList;
   //
   // Get the Tasks from the Tasks List and execute it, until there is
   // no task in the list or the device is busy with task (EFI_NOT_READY).
-  //
-  while (TRUE) {
-    if (!IsListEmpty (EntryHeader)) {
-      Entry = GetFirstNode (EntryHeader);
-      Task  = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
-    } else {
-      return;
+  // Queued (FPDMA) commands are issued and completed out of order, so the
+  // walk goes past those that are not finished. Any other command only runs
+  // from the head of the list, once the commands before it have completed.
+  //
+  for (Entry = GetFirstNode (EntryHeader); !IsNull (EntryHeader, Entry); Entry = NextEntry) {
+    NextEntry = GetNextNode (EntryHeader, Entry);
+    Task      = ATA_NON_BLOCK_TASK_FROM_ENTRY (Entry);
+    IsQueued  = (BOOLEAN) (Task->Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA);
+    if (!IsQueued && (Entry != GetFirstNode (EntryHeader))) {
+      break;
     }
 
     Status = AtaPassThruPassThruExecute (
@@ -437,7 +496,9 @@ AsyncNonBlockingTransferRoutine (
     // is not finished yet. Otherwise the operation is successful.
     //
     if (Status == EFI_NOT_READY) {
-      break;
+      if (!IsQueued) {
+        break;
+      }
     } else {
       RemoveEntryList (&Task->Link);
       gBS->SignalEvent (Task->Event);
@@ -941,6 +1002,17 @@ AtaAtapiPassThruStop (
   //
   if (Instance->Mode == EfiAtaAhciMode) {
     AhciRegisters = &Instance->AhciRegisters;
+    if (AhciRegisters->AhciNcqCommandTable != NULL) {
+      PciIo->Unmap (
+               PciIo,
+               AhciRegisters->MapNcqCommandTable
+               );
+      PciIo->FreeBuffer (
+               PciIo,
+               EFI_SIZE_TO_PAGES (AHCI_NCQ_MAX_TAGS * sizeof (AHCI_NCQ_COMMAND_TABLE)),
+               AhciRegisters->AhciNcqCommandTable
+               );
+    }
     PciIo->Unmap (
              PciIo,
              AhciRegisters->MapCommandTable
@@ -1151,6 +1223,10 @@ DestroyAsynTaskList (
       Task     = ATA_NON_BLOCK_TASK_FROM_ENTRY (DelEntry);
 
       RemoveEntryList (DelEntry);
+      if ((Instance->Mode == EfiAtaAhciMode) && Task->IsStart &&
+          (Task->Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA)) {
+        AhciNcqReleaseTask (Instance, Task);
+      }
       if (IsSigEvent) {
         Task->Packet->Asb->AtaStatus = 0x01;
         gBS->SignalEvent (Task->Event);
@@ -1257,6 +1333,9 @@ Done:
   @retval EFI_DEVICE_ERROR           A device error occurred while attempting to send the ATA command.
   @retval EFI_INVALID_PARAMETER      Port, PortMultiplierPort, or the contents of Acb are invalid. The ATA
                                      command was not sent, so no additional status information is available.
+  @retval EFI_UNSUPPORTED            The command described by the ATA command packet is not supported by the
+                                     host adapter. The command was not sent, so no additional status information
+                                     is available.
 
 **/
 EFI_STATUS
@@ -1352,6 +1431,19 @@ AtaPassThruPassThru (
   // is too big to be transferred in a single command, then no data is transferred and EFI_BAD_BUFFER_SIZE
   // is returned.
   //
+  if (Packet->Protocol == EFI_ATA_PASS_THRU_PROTOCOL_FPDMA) {
+    //
+    // Queued commands are only supported at AHCI mode, without a port
+    // multiplier, and when both the HBA and the device support NCQ. They
+    // always use 48-bit addressing and a 16-bit sector count.
+    //
+    if ((Instance->Mode != EfiAtaAhciMode) || (PortMultiplierPort != 0xFFFF) ||
+        (Port >= EFI_AHCI_MAX_PORTS) || (Instance->AhciRegisters.NcqDepth[Port] == 0)) {
+      return EFI_UNSUPPORTED;
+    }
+    MaxSectorCount = 0x10000;
+  }
+
   if (((Packet->InTransferLength != 0) && (Packet->InTransferLength > MaxSectorCount * BlockSize)) ||
       ((Packet->OutTransferLength != 0) && (Packet->OutTransferLength > MaxSectorCount * BlockSize))) {
     return EFI_BAD_BUFFER_SIZE;
@@ -138,6 +138,7 @@ struct _ATA_NONBLOCK_TASK {
   VOID                              *TableMap;       // Pointer to PRD table map.
   EFI_ATA_DMA_PRD                   *MapBaseAddress; //  Pointer to range Base address for Map.
   UINTN                             PageCount;       //  The page numbers used by PCIO freebuffer.
+  UINT8                             NcqTag;          //  Command slot of a queued (FPDMA) command.
 };
 
 //
@@ -562,6 +563,9 @@ AsyncNonBlockingTransferRoutine (
   @retval EFI_DEVICE_ERROR           A device error occurred while attempting to send the ATA command.
   @retval EFI_INVALID_PARAMETER      Port, PortMultiplierPort, or the contents of Acb are invalid. The ATA
                                      command was not sent, so no additional status information is available.
+  @retval EFI_UNSUPPORTED            The command described by the ATA command packet is not supported by the
+                                     host adapter. The command was not sent, so no additional status information
+                                     is available.
 
 **/
 EFI_STATUS
@@ -1149,6 +1153,68 @@ AhciDmaTransfer (
   IN     ATA_NONBLOCK_TASK            *Task
   );
 
+/**
+  Start or check a queued (FPDMA) data transfer on specific port.
+
+  In non-blocking mode, the first call issues the command in a free command
+  slot below the queue depth of the device, and later calls check whether it
+  has completed. Several commands can be outstanding on a port at the same
+  time, and they may complete in any order.
+
+  @param[in]       Instance            The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]       AhciRegisters       The pointer to the EFI_AHCI_REGISTERS.
+  @param[in]       Port                The number of port.
+  @param[in]       Read                The transfer direction.
+  @param[in]       AtaCommandBlock     The EFI_ATA_COMMAND_BLOCK data.
+  @param[in, out]  AtaStatusBlock      The EFI_ATA_STATUS_BLOCK data.
+  @param[in, out]  MemoryAddr          The pointer to the data buffer.
+  @param[in]       DataCount           The data count to be transferred.
+  @param[in]       Timeout             The timeout value of data transfer, uses 100ns as a unit.
+  @param[in]       Task                Optional. Pointer to the ATA_NONBLOCK_TASK
+                                       used by non-blocking mode.
+
+  @retval EFI_NOT_READY       The command is waiting for a command slot, or has
+                              not completed yet.
+  @retval EFI_BAD_BUFFER_SIZE The data buffer cannot be mapped, or needs too
+                              many PRDT entries.
+  @retval EFI_DEVICE_ERROR    The queued data transfer abort with error occurs.
+  @retval EFI_TIMEOUT         The operation is time out.
+  @retval EFI_SUCCESS         The queued data transfer executes successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+AhciNcqTransfer (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     EFI_AHCI_REGISTERS           *AhciRegisters,
+  IN     UINT8                        Port,
+  IN     BOOLEAN                      Read,
+  IN     EFI_ATA_COMMAND_BLOCK        *AtaCommandBlock,
+  IN OUT EFI_ATA_STATUS_BLOCK         *AtaStatusBlock,
+  IN OUT VOID                         *MemoryAddr,
+  IN     UINT32                       DataCount,
+  IN     UINT64                       Timeout,
+  IN     ATA_NONBLOCK_TASK            *Task
+  );
+
+/**
+  Release the command slot and the data buffer mapping of a queued command.
+
+  If the command is still outstanding, the port is stopped first, which aborts
+  every queued command on the port.
+
+  @param[in]  Instance   The ATA_ATAPI_PASS_THRU_INSTANCE protocol instance.
+  @param[in]  Task       Pointer to the ATA_NONBLOCK_TASK of the started
+                         queued command.
+
+**/
+VOID
+EFIAPI
+AhciNcqReleaseTask (
+  IN     ATA_ATAPI_PASS_THRU_INSTANCE *Instance,
+  IN     ATA_NONBLOCK_TASK            *Task
+  );
+
 /**
   Start a PIO data transfer on specific port.
 
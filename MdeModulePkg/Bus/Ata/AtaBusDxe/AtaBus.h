@@ -115,6 +115,11 @@ typedef struct {
 
   BOOLEAN                               UdmaValid;
   BOOLEAN                               Lba48Bit;
+  //
+  // Non-blocking I/O uses queued (FPDMA) commands when the device supports
+  // Native Command Queuing.
+  //
+  BOOLEAN                               NcqSupported;
 
   //
   // Cached data for ATA identify data
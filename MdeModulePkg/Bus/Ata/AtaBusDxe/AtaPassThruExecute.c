@@ -324,6 +324,16 @@ IdentifyAtaDevice (
     }
   }
 
+  //
+  // Check whether the WORD 76 (Serial ATA capabilities) reports Native Command
+  // Queuing support.
+  //
+  if (AtaDevice->UdmaValid &&
+      (IdentifyData->serial_ata_capabilities != 0xFFFF) &&
+      ((IdentifyData->serial_ata_capabilities & BIT8) != 0)) {
+    AtaDevice->NcqSupported = TRUE;
+  }
+
   Capacity = GetAtapi6Capacity (AtaDevice);
   if (Capacity > MAX_28BIT_ADDRESSING_CAPACITY) {
     //
@@ -472,8 +482,10 @@ TransferAtaDevice (
   IN EFI_EVENT                            Event OPTIONAL
   )
 {
+  EFI_STATUS                        Status;
   EFI_ATA_COMMAND_BLOCK             *Acb;
   EFI_ATA_PASS_THRU_COMMAND_PACKET  *Packet;
+  BOOLEAN                           IsQueued;
 
   //
   // Ensure AtaDevice->UdmaValid, AtaDevice->Lba48Bit and IsWrite are valid boolean values
@@ -481,23 +493,46 @@ TransferAtaDevice (
   ASSERT ((UINTN) AtaDevice->UdmaValid < 2);
   ASSERT ((UINTN) AtaDevice->Lba48Bit < 2);
   ASSERT ((UINTN) IsWrite < 2);
+
+  //
+  // Non-blocking transfers use queued commands if the device supports them.
+  //
+  IsQueued = (BOOLEAN) ((Event != NULL) && AtaDevice->NcqSupported);
+
   //
   // Prepare for ATA command block.
   //
   Acb = ZeroMem (&AtaDevice->Acb, sizeof (EFI_ATA_COMMAND_BLOCK));
-  Acb->AtaCommand = mAtaCommands[AtaDevice->UdmaValid][AtaDevice->Lba48Bit][IsWrite];
-  Acb->AtaSectorNumber = (UINT8) StartLba;
-  Acb->AtaCylinderLow = (UINT8) RShiftU64 (StartLba, 8);
-  Acb->AtaCylinderHigh = (UINT8) RShiftU64 (StartLba, 16);
-  Acb->AtaDeviceHead = (UINT8) (BIT7 | BIT6 | BIT5 | (AtaDevice->PortMultiplierPort == 0xFFFF ? 0 : (AtaDevice->PortMultiplierPort << 4)));
-  Acb->AtaSectorCount = (UINT8) TransferLength;
-  if (AtaDevice->Lba48Bit) {
+  if (IsQueued) {
+    //
+    // FPDMA commands always use 48-bit addressing, and take the sector count in
+    // the Features field. The ATA pass thru driver fills in the tag.
+    //
+    Acb->AtaCommand = IsWrite ? ATA_CMD_WRITE_FPDMA_QUEUED : ATA_CMD_READ_FPDMA_QUEUED;
+    Acb->AtaSectorNumber = (UINT8) StartLba;
+    Acb->AtaCylinderLow = (UINT8) RShiftU64 (StartLba, 8);
+    Acb->AtaCylinderHigh = (UINT8) RShiftU64 (StartLba, 16);
     Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
     Acb->AtaCylinderLowExp = (UINT8) RShiftU64 (StartLba, 32);
     Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
-    Acb->AtaSectorCountExp = (UINT8) (TransferLength >> 8);
+    Acb->AtaFeatures = (UINT8) TransferLength;
+    Acb->AtaFeaturesExp = (UINT8) (TransferLength >> 8);
+    Acb->AtaDeviceHead = BIT6;
   } else {
-    Acb->AtaDeviceHead = (UINT8) (Acb->AtaDeviceHead | RShiftU64 (StartLba, 24));
+    Acb->AtaCommand = mAtaCommands[AtaDevice->UdmaValid][AtaDevice->Lba48Bit][IsWrite];
+    Acb->AtaSectorNumber = (UINT8) StartLba;
+    Acb->AtaCylinderLow = (UINT8) RShiftU64 (StartLba, 8);
+    Acb->AtaCylinderHigh = (UINT8) RShiftU64 (StartLba, 16);
+    Acb->AtaDeviceHead = (UINT8) (BIT7 | BIT6 | BIT5 | (AtaDevice->PortMultiplierPort == 0xFFFF ? 0 : (AtaDevice->PortMultiplierPort << 4)));
+    Acb->AtaSectorCount = (UINT8) TransferLength;
+    if (AtaDevice->Lba48Bit) {
+      Acb->AtaSectorNumberExp = (UINT8) RShiftU64 (StartLba, 24);
+      Acb->AtaCylinderLowExp = (UINT8) RShiftU64 (StartLba, 32);
+      Acb->AtaCylinderHighExp = (UINT8) RShiftU64 (StartLba, 40);
+      Acb->AtaSectorCountExp = (UINT8) (TransferLength >> 8);
+    } else {
+      Acb->AtaDeviceHead = (UINT8) (Acb->AtaDeviceHead | RShiftU64 (StartLba, 24));
+    }
   }
 
   //
@@ -517,7 +552,11 @@ TransferAtaDevice (
     Packet->InTransferLength = TransferLength;
   }
 
-  Packet->Protocol = mAtaPassThruCmdProtocols[AtaDevice->UdmaValid][IsWrite];
+  if (IsQueued) {
+    Packet->Protocol = EFI_ATA_PASS_THRU_PROTOCOL_FPDMA;
+  } else {
+    Packet->Protocol = mAtaPassThruCmdProtocols[AtaDevice->UdmaValid][IsWrite];
+  }
   Packet->Length = EFI_ATA_PASS_THRU_LENGTH_SECTOR_COUNT;
   //
   // |------------------------|-----------------|------------------------|-----------------|
@@ -552,7 +591,23 @@ TransferAtaDevice (
     Packet->Timeout  = EFI_TIMER_PERIOD_SECONDS (DivU64x32 (MultU64x32 (TransferLength, AtaDevice->BlockMedia.BlockSize), 3300000) + 31);
   }
 
-  return AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+  Status = AtaDevicePassThru (AtaDevice, TaskPacket, Event);
+  if (IsQueued && (Status == EFI_UNSUPPORTED)) {
+    //
+    // The ATA pass thru driver cannot queue commands to this device. Free the
+    // packet buffers, and use the non-queued commands from now on.
+    //
+    if (Packet->Asb != NULL) {
+      FreeAlignedBuffer (Packet->Asb, sizeof (EFI_ATA_STATUS_BLOCK));
+    }
+    if (Packet->Acb != NULL) {
+      FreePool (Packet->Acb);
+    }
+    AtaDevice->NcqSupported = FALSE;
+    Status = TransferAtaDevice (AtaDevice, TaskPacket, Buffer, StartLba, TransferLength, IsWrite, Event);
+  }
+
+  return Status;
 }
 
 /**
@@ -807,7 +862,12 @@ AccessAtaDevice(
   if ((Token != NULL) && (Token->Event != NULL)) {
     OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
 
-    if (!IsListEmpty (&AtaDevice->AtaSubTaskList)) {
+    //
+    // Without queued commands, a new request waits for the subtasks of the
+    // earlier requests to complete. Queued commands of several requests can be
+    // outstanding at the same time.
+    //
+    if (!AtaDevice->NcqSupported && !IsListEmpty (&AtaDevice->AtaSubTaskList)) {
       AtaTask = AllocateZeroPool (sizeof (ATA_BUS_ASYN_TASK));
       if (AtaTask == NULL) {
         gBS->RestoreTPL (OldTpl);
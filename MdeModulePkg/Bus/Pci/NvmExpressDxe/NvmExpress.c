@@ -648,15 +648,13 @@ ProcessAsyncTaskList (
         if (AsyncRequest->MapMeta != NULL) {
           PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
         }
-        if (AsyncRequest->MapPrpList != NULL) {
-          PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
-        }
         if (AsyncRequest->PrpListHost != NULL) {
-          PciIo->FreeBuffer (
-                   PciIo,
-                   AsyncRequest->PrpListNo,
-                   AsyncRequest->PrpListHost
-                   );
+          NvmeFreePrpList (
+            Private,
+            AsyncRequest->PrpListHost,
+            AsyncRequest->PrpListNo,
+            AsyncRequest->MapPrpList
+            );
         }
 
         RemoveEntryList (Link);
@@ -957,14 +955,15 @@ NvmExpressDriverBindingStart (
     // 4th 4kB boundary is the start of I/O completion queue #1.
     // 5th 4kB boundary is the start of I/O submission queue #2.
     // 6th 4kB boundary is the start of I/O completion queue #2.
+    // The NVME_PRP_LIST_POOL_SIZE pages of the PRP list pool follow.
     //
-    // Allocate 6 pages of memory, then map it for bus master read and write.
+    // Allocate NVME_BUFFER_PAGES pages of memory, then map it for bus master read and write.
     //
     Status = PciIo->AllocateBuffer (
                       PciIo,
                       AllocateAnyPages,
                       EfiBootServicesData,
-                      6,
+                      NVME_BUFFER_PAGES,
                       (VOID**)&Private->Buffer,
                       0
                       );
@@ -972,7 +971,7 @@ NvmExpressDriverBindingStart (
       goto Exit;
     }
 
-    Bytes = EFI_PAGES_TO_SIZE (6);
+    Bytes = EFI_PAGES_TO_SIZE (NVME_BUFFER_PAGES);
     Status = PciIo->Map (
                       PciIo,
                       EfiPciIoOperationBusMasterCommonBuffer,
@@ -982,11 +981,13 @@ NvmExpressDriverBindingStart (
                       &Private->Mapping
                       );
 
-    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (6))) {
+    if (EFI_ERROR (Status) || (Bytes != EFI_PAGES_TO_SIZE (NVME_BUFFER_PAGES))) {
       goto Exit;
     }
 
-    Private->BufferPciAddr = (UINT8 *)(UINTN)MappedAddr;
+    Private->BufferPciAddr      = (UINT8 *)(UINTN)MappedAddr;
+    Private->PrpListPool        = Private->Buffer + EFI_PAGES_TO_SIZE (6);
+    Private->PrpListPoolPciAddr = Private->BufferPciAddr + EFI_PAGES_TO_SIZE (6);
 
     Private->Signature = NVME_CONTROLLER_PRIVATE_DATA_SIGNATURE;
     Private->ControllerHandle          = Controller;
@@ -1093,7 +1094,7 @@ Exit:
   }
 
   if ((Private != NULL) && (Private->Buffer != NULL)) {
-    PciIo->FreeBuffer (PciIo, 6, Private->Buffer);
+    PciIo->FreeBuffer (PciIo, NVME_BUFFER_PAGES, Private->Buffer);
   }
 
   if ((Private != NULL) && (Private->ControllerData != NULL)) {
@@ -1216,7 +1217,7 @@ NvmExpressDriverBindingStop (
       }
 
       if (Private->Buffer != NULL) {
-        Private->PciIo->FreeBuffer (Private->PciIo, 6, Private->Buffer);
+        Private->PciIo->FreeBuffer (Private->PciIo, NVME_BUFFER_PAGES, Private->Buffer);
       }
 
       FreePool (Private->ControllerData);
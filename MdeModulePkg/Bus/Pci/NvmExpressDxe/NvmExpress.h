@@ -40,6 +40,7 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/ReportStatusCodeLib.h>
+#include <Library/PcdLib.h>
 
 typedef struct _NVME_CONTROLLER_PRIVATE_DATA NVME_CONTROLLER_PRIVATE_DATA;
 typedef struct _NVME_DEVICE_PRIVATE_DATA     NVME_DEVICE_PRIVATE_DATA;
@@ -75,6 +76,17 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 
 #define NVME_MAX_QUEUES                           3     // Number of queues supported by the driver
 
+//
+// Number of one page PRP lists kept in a pool for the commands in flight, at
+// most 64. A PRP list of one page describes a transfer of up to 2MB.
+//
+#define NVME_PRP_LIST_POOL_SIZE                   64
+
+//
+// Number of pages of the queues and PRP list pool buffer.
+//
+#define NVME_BUFFER_PAGES                         (6 + NVME_PRP_LIST_POOL_SIZE)
+
 #define NVME_CONTROLLER_ID                        0
 
 //
@@ -123,10 +135,18 @@ struct _NVME_CONTROLLER_PRIVATE_DATA {
   // 4th 4kB boundary is the start of I/O completion queue #1.
   // 5th 4kB boundary is the start of I/O submission queue #2.
   // 6th 4kB boundary is the start of I/O completion queue #2.
+  // The PRP list pool follows the queues.
   //
   UINT8                               *Buffer;
   UINT8                               *BufferPciAddr;
 
+  //
+  // Pool of PRP lists and the bitmap of the PRP lists in use.
+  //
+  UINT8                               *PrpListPool;
+  UINT8                               *PrpListPoolPciAddr;
+  UINT64                              PrpListPoolUsed;
+
   //
   // Pointers to 4kB aligned submission & completion queues.
   //
@@ -722,6 +742,55 @@ NvmeDumpStatus (
   IN NVME_CQ             *Cq
   );
 
+/**
+  Free the PRP lists created by NvmeCreatePrpList().
+
+  @param[in] Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                              data structure.
+  @param[in] PrpListHost      The host base address of the PRP lists.
+  @param[in] PrpListNo        The number of PRP lists.
+  @param[in] Mapping          The mapping value returned from PciIo.Map(), or
+                              NULL if the PRP list is from the PRP list pool.
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA     *Private,
+  IN VOID                             *PrpListHost,
+  IN UINTN                            PrpListNo,
+  IN VOID                             *Mapping
+  );
+
+/**
+  Aborts the asynchronous PassThru requests.
+
+  @param[in] Private        The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                            data structure.
+
+  @retval EFI_SUCCESS       The asynchronous PassThru requests have been aborted.
+  @return EFI_DEVICE_ERROR  Fail to abort all the asynchronous PassThru requests.
+
+**/
+EFI_STATUS
+AbortAsyncPassThruTasks (
+  IN NVME_CONTROLLER_PRIVATE_DATA    *Private
+  );
+
+/**
+  Call back function when the timer event is signaled.
+
+  @param[in]  Event     The Event this notify function registered to.
+  @param[in]  Context   Pointer to the context data registered to the
+                        Event.
+
+**/
+VOID
+EFIAPI
+ProcessAsyncTaskList (
+  IN EFI_EVENT                    Event,
+  IN VOID*                        Context
+  );
+
 /**
   Register the shutdown notification through the ResetNotification protocol.
 
@@ -195,7 +195,21 @@ NvmeRead (
     MaxTransferBlocks = 1024;
   }
 
-  while (Blocks > 0) {
+  if (FeaturePcdGet (PcdNvmExpressQueuedTransferEnable) && (Blocks > MaxTransferBlocks)) {
+    //
+    // Keep the commands of a large transfer in flight together instead of
+    // sending them one at a time. Fall back to that if the resources for
+    // it cannot be allocated.
+    //
+    Status = NvmeQueuedTransfer (Device, Buffer, Lba, Blocks, TRUE);
+    if (!EFI_ERROR (Status)) {
+      Blocks = 0;
+    } else if (Status == EFI_OUT_OF_RESOURCES) {
+      Status = EFI_SUCCESS;
+    }
+  }
+
+  while ((Blocks > 0) && !EFI_ERROR (Status)) {
     if (Blocks > MaxTransferBlocks) {
       Status = ReadSectors (Device, (UINT64)(UINTN)Buffer, Lba, MaxTransferBlocks);
 
@@ -273,7 +287,21 @@ NvmeWrite (
     MaxTransferBlocks = 1024;
   }
 
-  while (Blocks > 0) {
+  if (FeaturePcdGet (PcdNvmExpressQueuedTransferEnable) && (Blocks > MaxTransferBlocks)) {
+    //
+    // Keep the commands of a large transfer in flight together instead of
+    // sending them one at a time. Fall back to that if the resources for
+    // it cannot be allocated.
+    //
+    Status = NvmeQueuedTransfer (Device, Buffer, Lba, Blocks, FALSE);
+    if (!EFI_ERROR (Status)) {
+      Blocks = 0;
+    } else if (Status == EFI_OUT_OF_RESOURCES) {
+      Status = EFI_SUCCESS;
+    }
+  }
+
+  while ((Blocks > 0) && !EFI_ERROR (Status)) {
     if (Blocks > MaxTransferBlocks) {
       Status = WriteSectors (Device, (UINT64)(UINTN)Buffer, Lba, MaxTransferBlocks);
 
@@ -923,6 +951,104 @@ NvmeAsyncWrite (
   return Status;
 }
 
+/**
+  Read or write some blocks with the commands of the transfer in flight
+  together on the asynchronous I/O queue, and wait for all of them to
+  complete.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  Buffer                 The buffer of the data.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to be transferred.
+  @param  IsRead                 TRUE to read the blocks, FALSE to write them.
+
+  @retval EFI_SUCCESS            The blocks were transferred.
+  @retval EFI_OUT_OF_RESOURCES   The transfer was not started due to a lack of
+                                 resources.
+  @retval EFI_TIMEOUT            A command did not complete in time and the
+                                 controller was reset.
+  @retval Others                 Fail to transfer all the blocks.
+
+**/
+EFI_STATUS
+NvmeQueuedTransfer (
+  IN NVME_DEVICE_PRIVATE_DATA           *Device,
+  IN VOID                               *Buffer,
+  IN UINT64                             Lba,
+  IN UINTN                              Blocks,
+  IN BOOLEAN                            IsRead
+  )
+{
+  NVME_CONTROLLER_PRIVATE_DATA     *Private;
+  EFI_BLOCK_IO2_TOKEN              Token;
+  EFI_EVENT                        TimerEvent;
+  EFI_STATUS                       Status;
+  EFI_TPL                          OldTpl;
+  UINT16                           Cqh;
+  BOOLEAN                          TimedOut;
+
+  Private  = Device->Controller;
+  TimedOut = FALSE;
+
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Token.Event);
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->CreateEvent (EVT_TIMER, TPL_CALLBACK, NULL, NULL, &TimerEvent);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Token.Event);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Token.TransactionStatus = EFI_SUCCESS;
+  if (IsRead) {
+    Status = NvmeAsyncRead (Device, Buffer, Lba, Blocks, &Token);
+  } else {
+    Status = NvmeAsyncWrite (Device, Buffer, Lba, Blocks, &Token);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    //
+    // Submit the commands and reap their completions here instead of waiting
+    // for the asynchronous I/O timer. Reset the controller as the blocking
+    // PassThru does if no command completes within NVME_GENERIC_TIMEOUT.
+    //
+    Cqh = Private->CqHdbl[2].Cqh;
+    gBS->SetTimer (TimerEvent, TimerRelative, NVME_GENERIC_TIMEOUT);
+
+    while (EFI_ERROR (gBS->CheckEvent (Token.Event))) {
+      OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+      ProcessAsyncTaskList (Private->TimerEvent, Private);
+      gBS->RestoreTPL (OldTpl);
+
+      if (Private->CqHdbl[2].Cqh != Cqh) {
+        Cqh = Private->CqHdbl[2].Cqh;
+        gBS->SetTimer (TimerEvent, TimerRelative, NVME_GENERIC_TIMEOUT);
+      } else if (!TimedOut && !EFI_ERROR (gBS->CheckEvent (TimerEvent))) {
+        DEBUG ((DEBUG_ERROR, "%a: Timeout occurs for an NVMe command.\n", __FUNCTION__));
+        TimedOut = TRUE;
+
+        //
+        // Aborting the asynchronous requests completes the subtasks of this
+        // transfer, even if the controller cannot be initialized again.
+        //
+        gBS->SetTimer (Private->TimerEvent, TimerCancel, 0);
+        NvmeControllerInit (Private);
+        AbortAsyncPassThruTasks (Private);
+        gBS->SetTimer (Private->TimerEvent, TimerPeriodic, NVME_HC_ASYNC_TIMER);
+      }
+    }
+
+    Status = TimedOut ? EFI_TIMEOUT : Token.TransactionStatus;
+  }
+
+  gBS->CloseEvent (TimerEvent);
+  gBS->CloseEvent (Token.Event);
+
+  return Status;
+}
+
 /**
   Reset the Block Device.
 
@@ -250,6 +250,34 @@ NvmeBlockIoFlushBlocksEx (
   IN OUT EFI_BLOCK_IO2_TOKEN      *Token
   );
 
+/**
+  Read or write some blocks with the commands of the transfer in flight
+  together on the asynchronous I/O queue, and wait for all of them to
+  complete.
+
+  @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
+  @param  Buffer                 The buffer of the data.
+  @param  Lba                    The start block number.
+  @param  Blocks                 Total block number to be transferred.
+  @param  IsRead                 TRUE to read the blocks, FALSE to write them.
+
+  @retval EFI_SUCCESS            The blocks were transferred.
+  @retval EFI_OUT_OF_RESOURCES   The transfer was not started due to a lack of
+                                 resources.
+  @retval EFI_TIMEOUT            A command did not complete in time and the
+                                 controller was reset.
+  @retval Others                 Fail to transfer all the blocks.
+
+**/
+EFI_STATUS
+NvmeQueuedTransfer (
+  IN NVME_DEVICE_PRIVATE_DATA           *Device,
+  IN VOID                               *Buffer,
+  IN UINT64                             Lba,
+  IN UINTN                              Blocks,
+  IN BOOLEAN                            IsRead
+  );
+
 /**
   Send a security protocol command to a device that receives data and/or the result
   of one or more commands sent by SendData.
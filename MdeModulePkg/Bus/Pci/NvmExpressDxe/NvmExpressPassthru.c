@@ -195,20 +195,22 @@ NvmeDumpStatus (
 /**
   Create PRP lists for data transfer which is larger than 2 memory pages.
   Note here we calcuate the number of required PRP lists and allocate them at one time.
+  A single PRP list is taken from the PRP list pool of the controller if one is free.
 
-  @param[in]     PciIo               A pointer to the EFI_PCI_IO_PROTOCOL instance.
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
   @param[in]     PhysicalAddr        The physical base address of data buffer.
   @param[in]     Pages               The number of pages to be transfered.
   @param[out]    PrpListHost         The host base address of PRP lists.
   @param[in,out] PrpListNo           The number of PRP List.
-  @param[out]    Mapping             The mapping value returned from PciIo.Map().
+  @param[out]    Mapping             The mapping value returned from PciIo.Map(), or NULL
+                                     if the PRP list is taken from the PRP list pool.
 
   @retval The pointer to the first PRP List of the PRP lists.
 
 **/
 VOID*
 NvmeCreatePrpList (
-  IN     EFI_PCI_IO_PROTOCOL          *PciIo,
+  IN     NVME_CONTROLLER_PRIVATE_DATA *Private,
   IN     EFI_PHYSICAL_ADDRESS         PhysicalAddr,
   IN     UINTN                        Pages,
      OUT VOID                         **PrpListHost,
@@ -224,6 +226,12 @@ NvmeCreatePrpList (
   EFI_PHYSICAL_ADDRESS        PrpListPhyAddr;
   UINTN                       Bytes;
   EFI_STATUS                  Status;
+  EFI_PCI_IO_PROTOCOL         *PciIo;
+  UINT64                      Free;
+  UINTN                       PoolIndex;
+  EFI_TPL                     OldTpl;
+
+  PciIo = Private->PciIo;
 
   //
   // The number of Prp Entry in a memory page.
@@ -244,6 +252,28 @@ NvmeCreatePrpList (
     Remainder = PrpEntryNo - 1;
   }
 
+  if (*PrpListNo == 1) {
+    //
+    // Take the PRP list from the pool, which is already mapped for bus master
+    // access, to save the allocation and mapping of a page per command.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    Free   = ~Private->PrpListPoolUsed & RShiftU64 (MAX_UINT64, 64 - NVME_PRP_LIST_POOL_SIZE);
+    if (Free != 0) {
+      PoolIndex = (UINTN)LowBitSet64 (Free);
+      Private->PrpListPoolUsed |= LShiftU64 (1, PoolIndex);
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    if (Free != 0) {
+      *PrpListHost   = Private->PrpListPool + EFI_PAGES_TO_SIZE (PoolIndex);
+      *Mapping       = NULL;
+      PrpListPhyAddr = (EFI_PHYSICAL_ADDRESS)(UINTN)(Private->PrpListPoolPciAddr + EFI_PAGES_TO_SIZE (PoolIndex));
+      Bytes          = EFI_PAGE_SIZE;
+      goto FILL;
+    }
+  }
+
   Status = PciIo->AllocateBuffer (
                     PciIo,
                     AllocateAnyPages,
@@ -271,6 +301,8 @@ NvmeCreatePrpList (
     DEBUG ((EFI_D_ERROR, "NvmeCreatePrpList: create PrpList failure!\n"));
     goto EXIT;
   }
+
+FILL:
   //
   // Fill all PRP lists except of last one.
   //
@@ -309,6 +341,42 @@ EXIT:
   return NULL;
 }
 
+/**
+  Free the PRP lists created by NvmeCreatePrpList().
+
+  @param[in] Private          The pointer to the NVME_CONTROLLER_PRIVATE_DATA
+                              data structure.
+  @param[in] PrpListHost      The host base address of the PRP lists.
+  @param[in] PrpListNo        The number of PRP lists.
+  @param[in] Mapping          The mapping value returned from PciIo.Map(), or
+                              NULL if the PRP list is from the PRP list pool.
+
+**/
+VOID
+NvmeFreePrpList (
+  IN NVME_CONTROLLER_PRIVATE_DATA     *Private,
+  IN VOID                             *PrpListHost,
+  IN UINTN                            PrpListNo,
+  IN VOID                             *Mapping
+  )
+{
+  UINTN                       PoolIndex;
+  EFI_TPL                     OldTpl;
+
+  if (Mapping != NULL) {
+    Private->PciIo->Unmap (Private->PciIo, Mapping);
+    Private->PciIo->FreeBuffer (Private->PciIo, PrpListNo, PrpListHost);
+    return;
+  }
+
+  PoolIndex = EFI_SIZE_TO_PAGES ((UINTN)PrpListHost - (UINTN)Private->PrpListPool);
+  ASSERT (PoolIndex < NVME_PRP_LIST_POOL_SIZE);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Private->PrpListPoolUsed &= ~LShiftU64 (1, PoolIndex);
+  gBS->RestoreTPL (OldTpl);
+}
+
 
 /**
   Aborts the asynchronous PassThru requests.
@@ -375,15 +443,13 @@ AbortAsyncPassThruTasks (
     if (AsyncRequest->MapMeta != NULL) {
       PciIo->Unmap (PciIo, AsyncRequest->MapMeta);
     }
-    if (AsyncRequest->MapPrpList != NULL) {
-      PciIo->Unmap (PciIo, AsyncRequest->MapPrpList);
-    }
     if (AsyncRequest->PrpListHost != NULL) {
-      PciIo->FreeBuffer (
-               PciIo,
-               AsyncRequest->PrpListNo,
-               AsyncRequest->PrpListHost
-               );
+      NvmeFreePrpList (
+        Private,
+        AsyncRequest->PrpListHost,
+        AsyncRequest->PrpListNo,
+        AsyncRequest->MapPrpList
+        );
     }
 
     RemoveEntryList (Link);
@@ -662,7 +728,7 @@ NvmExpressPassThru (
     // Create PrpList for remaining data buffer.
     //
     PhyAddr = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
-    Prp = NvmeCreatePrpList (PciIo, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
+    Prp = NvmeCreatePrpList (Private, PhyAddr, EFI_SIZE_TO_PAGES(Offset + Bytes) - 1, &PrpListHost, &PrpListNo, &MapPrpList);
     if (Prp == NULL) {
       Status = EFI_OUT_OF_RESOURCES;
       goto EXIT;
@@ -878,15 +944,8 @@ EXIT:
              );
   }
 
-  if (MapPrpList != NULL) {
-    PciIo->Unmap (
-             PciIo,
-             MapPrpList
-             );
-  }
-
   if (Prp != NULL) {
-    PciIo->FreeBuffer (PciIo, PrpListNo, PrpListHost);
+    NvmeFreePrpList (Private, PrpListHost, PrpListNo, MapPrpList);
   }
 
   if (TimerEvent != NULL) {
@@ -85,6 +85,17 @@ EFI_USB2_HC_PROTOCOL gXhciUsb2HcTemplate = {
   0x0
 };
 
+//
+// Template for Xhci's Usb2 Host Controller Streams Protocol Instance.
+//
+EDKII_USB2_HC_STREAMS_PROTOCOL gXhciUsb2HcStreamsTemplate = {
+  XhcAllocateStreams,
+  XhcFreeStreams,
+  XhcSubmitBulkTransfer,
+  XhcPollBulkTransfer,
+  XhcCancelBulkTransfer
+};
+
 /**
   Retrieves the capability of root hub ports.
 
@@ -201,6 +212,7 @@ XhcReset (
     // interrupt supports asynchronous operation.
     //
     XhciDelAllAsyncIntTransfers (Xhc);
+    XhcAbortQueuedTransfers (Xhc, 0, 0);
     XhcFreeSched (Xhc);
 
     XhcInitSched (Xhc);
@@ -1016,12 +1028,17 @@ XhcControlTransfer (
         }
     } else if (DescriptorType == USB_DESC_TYPE_CONFIG) {
       ASSERT (Data != NULL);
-      if (*DataLength == ((UINT16 *)Data)[1]) {
+      Index = (UINT8)Request->Value;
+      ASSERT (Index < Xhc->UsbDevContext[SlotId].DevDesc.NumConfigurations);
+      //
+      // A class driver may read the whole configuration again to find class
+      // specific descriptors. Only keep the copy read during enumeration, so
+      // the alternate settings selected since then are not forgotten.
+      //
+      if ((*DataLength == ((UINT16 *)Data)[1]) && (Xhc->UsbDevContext[SlotId].ConfDesc[Index] == NULL)) {
         //
         // Get configuration value from request, Store the configuration descriptor for Configure_Endpoint cmd.
         //
-        Index = (UINT8)Request->Value;
-        ASSERT (Index < Xhc->UsbDevContext[SlotId].DevDesc.NumConfigurations);
         Xhc->UsbDevContext[SlotId].ConfDesc[Index] = AllocateZeroPool(*DataLength);
         CopyMem (Xhc->UsbDevContext[SlotId].ConfDesc[Index], Data, *DataLength);
         //
@@ -1220,6 +1237,7 @@ XhcBulkTransfer (
 {
   USB_XHCI_INSTANCE       *Xhc;
   UINT8                   SlotId;
+  UINT8                   Dci;
   EFI_STATUS              Status;
   EFI_TPL                 OldTpl;
 
@@ -1262,6 +1280,15 @@ XhcBulkTransfer (
     goto ON_EXIT;
   }
 
+  //
+  // The transfers on an endpoint with streams are queued on one of its streams.
+  //
+  Dci = XhcEndpointToDci ((UINT8)(EndPointAddress & 0x0F), (UINT8)(XHCI_IS_DATAIN (EndPointAddress) ? EfiUsbDataIn : EfiUsbDataOut));
+  if (Xhc->UsbDevContext[SlotId].EndpointStreams[Dci - 1] != NULL) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
   //
   // Create a new URB, insert it into the asynchronous
   // schedule list, then poll the execution status.
@@ -1626,6 +1653,551 @@ XhcAsyncIsochronousTransfer (
   return EFI_UNSUPPORTED;
 }
 
+/**
+  Find the device context index of a bulk endpoint of a device.
+
+  @param  Xhc                 The XHCI Instance.
+  @param  SlotId              The slot id of the device.
+  @param  EndPointAddress     The endpoint address, with the direction in bit 7.
+
+  @return The device context index, or 0 if the endpoint is not a configured
+          bulk endpoint of the device.
+
+**/
+UINT8
+XhcGetBulkDci (
+  IN USB_XHCI_INSTANCE  *Xhc,
+  IN UINT8              SlotId,
+  IN UINT8              EndPointAddress
+  )
+{
+  UINT8                 Dci;
+  UINT8                 EPType;
+  VOID                  *OutputContext;
+
+  if ((EndPointAddress & 0x0F) == 0) {
+    return 0;
+  }
+
+  Dci = XhcEndpointToDci ((UINT8)(EndPointAddress & 0x0F), (UINT8)(XHCI_IS_DATAIN (EndPointAddress) ? EfiUsbDataIn : EfiUsbDataOut));
+  if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1] == NULL) {
+    return 0;
+  }
+
+  OutputContext = Xhc->UsbDevContext[SlotId].OutputContext;
+  if (Xhc->HcCParams.Data.Csz == 0) {
+    EPType = (UINT8) ((DEVICE_CONTEXT *)OutputContext)->EP[Dci - 1].EPType;
+  } else {
+    EPType = (UINT8) ((DEVICE_CONTEXT_64 *)OutputContext)->EP[Dci - 1].EPType;
+  }
+
+  if ((EPType != ED_BULK_IN) && (EPType != ED_BULK_OUT)) {
+    return 0;
+  }
+
+  return Dci;
+}
+
+/**
+  Allocate streams for bulk endpoints of a SuperSpeed device.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  DeviceSpeed           The device speed.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+  @param  StreamCount           On input, the number of streams the device
+                                supports on each endpoint. On output, the
+                                number of streams allocated.
+
+  @retval EFI_SUCCESS           The streams are allocated.
+  @retval EFI_UNSUPPORTED       The device is not a SuperSpeed device, or the
+                                host controller doesn't support streams.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid, or an endpoint already
+                                has streams.
+  @retval EFI_DEVICE_ERROR      The host controller failed to set up the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcAllocateStreams (
+  IN     EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN     UINT8                           DeviceAddress,
+  IN     UINT8                           DeviceSpeed,
+  IN     UINT8                           *EndpointAddresses,
+  IN     UINTN                           EndpointCount,
+  IN OUT UINT16                          *StreamCount
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  UINTN                   Index;
+  UINTN                   MaxArraySize;
+  UINT16                  Count;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  if ((EndpointAddresses == NULL) || (EndpointCount == 0) ||
+      (StreamCount == NULL) || (*StreamCount == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Xhc = XHC_FROM_STREAMS_THIS (This);
+
+  if ((DeviceSpeed != EFI_USB_SPEED_SUPER) || (Xhc->HcCParams.Data.MaxPsaSize == 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // The Primary Stream Array holds up to 2^(MaxPSASize + 1) entries, and
+  // its entry 0 is reserved.
+  //
+  MaxArraySize = (UINTN) 1 << (Xhc->HcCParams.Data.MaxPsaSize + 1);
+  Count        = (UINT16) MIN (MIN (*StreamCount, XHC_MAX_STREAMS), MaxArraySize - 1);
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Status = EFI_DEVICE_ERROR;
+  if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
+    goto ON_EXIT;
+  }
+
+  SlotId = XhcBusDevAddrToSlotId (Xhc, DeviceAddress);
+  if (SlotId == 0) {
+    goto ON_EXIT;
+  }
+
+  for (Index = 0; Index < EndpointCount; Index++) {
+    Dci = XhcGetBulkDci (Xhc, SlotId, EndpointAddresses[Index]);
+    if ((Dci == 0) || (Xhc->UsbDevContext[SlotId].EndpointStreams[Dci - 1] != NULL)) {
+      Status = EFI_INVALID_PARAMETER;
+    } else {
+      Status = XhcAllocateEndpointStreams (Xhc, SlotId, Dci, Count);
+    }
+
+    if (EFI_ERROR (Status)) {
+      //
+      // Return the endpoints done so far to normal bulk transfers.
+      //
+      while (Index-- > 0) {
+        Dci = XhcGetBulkDci (Xhc, SlotId, EndpointAddresses[Index]);
+        XhcFreeEndpointStreams (Xhc, SlotId, Dci, TRUE);
+      }
+      goto ON_EXIT;
+    }
+  }
+
+  *StreamCount = Count;
+
+ON_EXIT:
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "XhcAllocateStreams: error - %r\n", Status));
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Free the streams of bulk endpoints, and return the endpoints to normal
+  bulk transfers.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS           The streams are freed.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid.
+  @retval EFI_DEVICE_ERROR      The host controller failed to reconfigure the
+                                endpoints.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcFreeStreams (
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN UINT8                           DeviceAddress,
+  IN UINT8                           *EndpointAddresses,
+  IN UINTN                           EndpointCount
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  UINTN                   Index;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  if ((EndpointAddresses == NULL) || (EndpointCount == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Xhc    = XHC_FROM_STREAMS_THIS (This);
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Status = EFI_INVALID_PARAMETER;
+  SlotId = XhcBusDevAddrToSlotId (Xhc, DeviceAddress);
+  if (SlotId == 0) {
+    goto ON_EXIT;
+  }
+
+  for (Index = 0; Index < EndpointCount; Index++) {
+    Dci = XhcGetBulkDci (Xhc, SlotId, EndpointAddresses[Index]);
+    if ((Dci == 0) || (Xhc->UsbDevContext[SlotId].EndpointStreams[Dci - 1] == NULL)) {
+      goto ON_EXIT;
+    }
+  }
+
+  Status = EFI_SUCCESS;
+  for (Index = 0; Index < EndpointCount; Index++) {
+    Dci = XhcGetBulkDci (Xhc, SlotId, EndpointAddresses[Index]);
+    if (Xhc->UsbDevContext[SlotId].EndpointStreams[Dci - 1] == NULL) {
+      continue;
+    }
+
+    XhcAbortQueuedTransfers (Xhc, SlotId, Dci);
+    if (EFI_ERROR (XhcFreeEndpointStreams (Xhc, SlotId, Dci, TRUE))) {
+      Status = EFI_DEVICE_ERROR;
+    }
+  }
+
+ON_EXIT:
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "XhcFreeStreams: error - %r\n", Status));
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Queue a bulk transfer and return without waiting for it to complete.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  EndPointAddress       The bulk endpoint address, with the direction
+                                in bit 7.
+  @param  DeviceSpeed           The device speed.
+  @param  MaximumPacketLength   The maximum packet size of the endpoint.
+  @param  StreamId              The stream of the transfer, or 0 for an
+                                endpoint without streams.
+  @param  Data                  The data buffer.
+  @param  DataLength            The length of the data buffer, in bytes.
+  @param  Translator            The transaction translator of the device.
+  @param  Transfer              Returns the handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is queued.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid.
+  @retval EFI_NOT_READY         The transfer ring of the endpoint and stream
+                                is full. Without PcdUsbBulkTransferQueueEnable,
+                                a transfer is already queued on it.
+  @retval EFI_OUT_OF_RESOURCES  The transfer could not be queued.
+  @retval EFI_DEVICE_ERROR      The host controller or the device is not usable.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcSubmitBulkTransfer (
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL      *This,
+  IN  UINT8                               DeviceAddress,
+  IN  UINT8                               EndPointAddress,
+  IN  UINT8                               DeviceSpeed,
+  IN  UINTN                               MaximumPacketLength,
+  IN  UINT16                              StreamId,
+  IN  VOID                                *Data,
+  IN  UINTN                               DataLength,
+  IN  EFI_USB2_HC_TRANSACTION_TRANSLATOR  *Translator,
+  OUT VOID                                **Transfer
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  ENDPOINT_STREAMS        *Streams;
+  TRANSFER_RING           *Ring;
+  LIST_ENTRY              *Entry;
+  URB                     *Urb;
+  UINTN                   TrbNeeded;
+  UINTN                   TrbUsed;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+  EFI_STATUS              Status;
+  EFI_TPL                 OldTpl;
+
+  if ((Data == NULL) || (DataLength == 0) || (Transfer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((DeviceSpeed == EFI_USB_SPEED_LOW) ||
+      ((DeviceSpeed == EFI_USB_SPEED_FULL) && (MaximumPacketLength > 64)) ||
+      ((EFI_USB_SPEED_HIGH == DeviceSpeed) && (MaximumPacketLength > 512)) ||
+      ((EFI_USB_SPEED_SUPER == DeviceSpeed) && (MaximumPacketLength > 1024))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Xhc    = XHC_FROM_STREAMS_THIS (This);
+  Status = EFI_DEVICE_ERROR;
+
+  if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
+    DEBUG ((EFI_D_ERROR, "XhcSubmitBulkTransfer: HC is halted\n"));
+    goto ON_EXIT;
+  }
+
+  SlotId = XhcBusDevAddrToSlotId (Xhc, DeviceAddress);
+  if (SlotId == 0) {
+    goto ON_EXIT;
+  }
+
+  Status = EFI_INVALID_PARAMETER;
+  Dci    = XhcGetBulkDci (Xhc, SlotId, EndPointAddress);
+  if (Dci == 0) {
+    goto ON_EXIT;
+  }
+
+  Streams = Xhc->UsbDevContext[SlotId].EndpointStreams[Dci - 1];
+  if (StreamId != 0) {
+    if ((Streams == NULL) || (StreamId > Streams->StreamCount)) {
+      goto ON_EXIT;
+    }
+    Ring = &Streams->StreamRing[StreamId - 1];
+  } else if (Streams != NULL) {
+    goto ON_EXIT;
+  } else {
+    Ring = Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1];
+  }
+
+  if (FeaturePcdGet (PcdUsbBulkTransferQueueEnable)) {
+    //
+    // The transfers queued on a ring follow each other, and each takes one TRB
+    // per 64KB of data. The new transfer must fit in the TRBs the transfers
+    // still in progress leave free, keeping room for the link TRB and a free
+    // slot.
+    //
+    TrbNeeded = DataLength / SIZE_64KB + 1;
+    if (TrbNeeded + 2 > Ring->TrbNumber) {
+      goto ON_EXIT;
+    }
+
+    TrbUsed = 0;
+    for (Entry = Xhc->QueuedTransfers.ForwardLink; Entry != &Xhc->QueuedTransfers; Entry = Entry->ForwardLink) {
+      Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+      if (!Urb->Finished && (Urb->Ring == Ring)) {
+        TrbUsed += Urb->TrbNum;
+      }
+    }
+
+    if (TrbUsed + TrbNeeded + 2 > Ring->TrbNumber) {
+      Status = EFI_NOT_READY;
+      goto ON_EXIT;
+    }
+  } else {
+    //
+    // A stream ring is smaller than the endpoint ring, so the data must fit in
+    // its TRBs, leaving room for the link TRB and a free slot.
+    //
+    if ((StreamId != 0) && (DataLength > (STREAM_RING_TRB_NUMBER - 2) * SIZE_64KB)) {
+      goto ON_EXIT;
+    }
+
+    Status = EFI_NOT_READY;
+    for (Entry = Xhc->QueuedTransfers.ForwardLink; Entry != &Xhc->QueuedTransfers; Entry = Entry->ForwardLink) {
+      Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+      if ((Urb->Ep.BusAddr == DeviceAddress) &&
+          (Urb->Ep.EpAddr == (EndPointAddress & 0x0F)) &&
+          (Urb->Ep.Direction == (XHCI_IS_DATAIN (EndPointAddress) ? EfiUsbDataIn : EfiUsbDataOut)) &&
+          (Urb->StreamId == StreamId)) {
+        goto ON_EXIT;
+      }
+    }
+  }
+
+  Urb = XhcCreateQueuedUrb (
+          Xhc,
+          DeviceAddress,
+          EndPointAddress,
+          DeviceSpeed,
+          MaximumPacketLength,
+          StreamId,
+          Data,
+          DataLength
+          );
+  if (Urb == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ON_EXIT;
+  }
+
+  InsertTailList (&Xhc->QueuedTransfers, &Urb->UrbList);
+  XhcRingStreamDoorBell (Xhc, SlotId, Dci, StreamId);
+
+  *Transfer = Urb;
+  Status    = EFI_SUCCESS;
+
+ON_EXIT:
+  if (EFI_ERROR (Status) && (Status != EFI_NOT_READY)) {
+    DEBUG ((EFI_D_ERROR, "XhcSubmitBulkTransfer: error - %r\n", Status));
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Check whether a queued bulk transfer is complete.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+  @param  DataLength            Returns the number of bytes transferred.
+  @param  TransferResult        Returns the result of the transfer.
+
+  @retval EFI_SUCCESS           The transfer completed successfully.
+  @retval EFI_NOT_READY         The transfer is still in progress.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The transfer failed.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcPollBulkTransfer (
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN  VOID                            *Transfer,
+  OUT UINTN                           *DataLength,
+  OUT UINT32                          *TransferResult
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  URB                     *Urb;
+  EFI_STATUS              Status;
+  EFI_STATUS              RecoveryStatus;
+  EFI_TPL                 OldTpl;
+
+  if ((Transfer == NULL) || (DataLength == NULL) || (TransferResult == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Xhc = XHC_FROM_STREAMS_THIS (This);
+  Urb = (URB *) Transfer;
+
+  if (!XhcIsQueuedUrb (Xhc, Urb)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  if (!Urb->Finished) {
+    if (XhcIsHalt (Xhc) || XhcIsSysError (Xhc)) {
+      Urb->Result  |= EFI_USB_ERR_SYSTEM;
+      Urb->Finished = TRUE;
+    } else {
+      XhcCheckUrbResult (Xhc, Urb);
+    }
+  }
+
+  if (!Urb->Finished) {
+    Status = EFI_NOT_READY;
+    goto ON_EXIT;
+  }
+
+  RemoveEntryList (&Urb->UrbList);
+
+  *DataLength     = Urb->Completed;
+  *TransferResult = Urb->Result;
+  Status          = (Urb->Result == EFI_USB_NOERROR) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+
+  if ((Urb->Result == EFI_USB_ERR_STALL) || (Urb->Result == EFI_USB_ERR_BABBLE)) {
+    //
+    // A halted endpoint stops all its streams, so the transfers still queued
+    // on the other streams are started again once it is recovered. The ones
+    // queued after the URB on its own ring are skipped by the recovery.
+    //
+    XhcAbortRingTransfers (Xhc, Urb);
+    RecoveryStatus = XhcRecoverHaltedEndpoint (Xhc, Urb);
+    if (EFI_ERROR (RecoveryStatus)) {
+      DEBUG ((EFI_D_ERROR, "XhcPollBulkTransfer: XhcRecoverHaltedEndpoint failed with %r\n", RecoveryStatus));
+    }
+    XhcRestartQueuedTransfers (Xhc, Urb);
+  }
+
+  Xhc->PciIo->Flush (Xhc->PciIo);
+  XhcFreeUrb (Xhc, Urb);
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/**
+  Cancel a queued bulk transfer, and free its handle.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is cancelled.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The host controller failed to stop the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcCancelBulkTransfer (
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN VOID                            *Transfer
+  )
+{
+  USB_XHCI_INSTANCE       *Xhc;
+  URB                     *Urb;
+  EFI_STATUS              Status;
+  EFI_STATUS              RecoveryStatus;
+  EFI_TPL                 OldTpl;
+
+  if (Transfer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl = gBS->RaiseTPL (XHC_TPL);
+
+  Xhc = XHC_FROM_STREAMS_THIS (This);
+  Urb = (URB *) Transfer;
+
+  if (!XhcIsQueuedUrb (Xhc, Urb)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  RemoveEntryList (&Urb->UrbList);
+  Status = EFI_SUCCESS;
+
+  if (!Urb->Finished) {
+    RecoveryStatus = XhcDequeueTrbFromEndpoint (Xhc, Urb);
+    if (EFI_ERROR (RecoveryStatus) && (RecoveryStatus != EFI_ALREADY_STARTED)) {
+      DEBUG ((EFI_D_ERROR, "XhcCancelBulkTransfer: XhcDequeueTrbFromEndpoint failed with %r\n", RecoveryStatus));
+      Status = EFI_DEVICE_ERROR;
+    }
+    if (RecoveryStatus != EFI_ALREADY_STARTED) {
+      XhcAbortRingTransfers (Xhc, Urb);
+    }
+    XhcRestartQueuedTransfers (Xhc, Urb);
+  } else if ((Urb->Result == EFI_USB_ERR_STALL) || (Urb->Result == EFI_USB_ERR_BABBLE)) {
+    XhcAbortRingTransfers (Xhc, Urb);
+    RecoveryStatus = XhcRecoverHaltedEndpoint (Xhc, Urb);
+    if (EFI_ERROR (RecoveryStatus)) {
+      DEBUG ((EFI_D_ERROR, "XhcCancelBulkTransfer: XhcRecoverHaltedEndpoint failed with %r\n", RecoveryStatus));
+    }
+    XhcRestartQueuedTransfers (Xhc, Urb);
+  }
+
+  Xhc->PciIo->Flush (Xhc->PciIo);
+  XhcFreeUrb (Xhc, Urb);
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
 /**
   Entry point for EFI drivers.
 
@@ -1766,6 +2338,7 @@ XhcCreateUsbHc (
   Xhc->DevicePath            = DevicePath;
   Xhc->OriginalPciAttributes = OriginalPciAttributes;
   CopyMem (&Xhc->Usb2Hc, &gXhciUsb2HcTemplate, sizeof (EFI_USB2_HC_PROTOCOL));
+  CopyMem (&Xhc->Usb2HcStreams, &gXhciUsb2HcStreamsTemplate, sizeof (EDKII_USB2_HC_STREAMS_PROTOCOL));
 
   Status = PciIo->Pci.Read (
                         PciIo,
@@ -1781,6 +2354,7 @@ XhcCreateUsbHc (
   }
 
   InitializeListHead (&Xhc->AsyncIntTransfers);
+  InitializeListHead (&Xhc->QueuedTransfers);
 
   //
   // Be caution that the Offset passed to XhcReadCapReg() should be Dword align
@@ -2071,11 +2645,13 @@ XhcDriverBindingStart (
     FALSE
     );
 
-  Status = gBS->InstallProtocolInterface (
+  Status = gBS->InstallMultipleProtocolInterfaces (
                   &Controller,
                   &gEfiUsb2HcProtocolGuid,
-                  EFI_NATIVE_INTERFACE,
-                  &Xhc->Usb2Hc
+                  &Xhc->Usb2Hc,
+                  &gEdkiiUsb2HcStreamsProtocolGuid,
+                  &Xhc->Usb2HcStreams,
+                  NULL
                   );
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "XhcDriverBindingStart: failed to install USB2_HC Protocol\n"));
@@ -2160,19 +2736,22 @@ XhcDriverBindingStop (
     return Status;
   }
 
-  Status = gBS->UninstallProtocolInterface (
+  Xhc   = XHC_FROM_THIS (Usb2Hc);
+  PciIo = Xhc->PciIo;
+
+  Status = gBS->UninstallMultipleProtocolInterfaces (
                   Controller,
                   &gEfiUsb2HcProtocolGuid,
-                  Usb2Hc
+                  Usb2Hc,
+                  &gEdkiiUsb2HcStreamsProtocolGuid,
+                  &Xhc->Usb2HcStreams,
+                  NULL
                   );
 
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  Xhc   = XHC_FROM_THIS (Usb2Hc);
-  PciIo = Xhc->PciIo;
-
   //
   // Stop AsyncRequest Polling timer then stop the XHCI driver
   // and uninstall the XHCI protocl.
@@ -2206,6 +2785,7 @@ XhcDriverBindingStop (
   XhcHaltHC (Xhc, XHC_GENERIC_TIMEOUT);
   XhcClearBiosOwnership (Xhc);
   XhciDelAllAsyncIntTransfers (Xhc);
+  XhciDelAllQueuedTransfers (Xhc);
   XhcFreeSched (Xhc);
 
   if (Xhc->ControllerNameTable) {
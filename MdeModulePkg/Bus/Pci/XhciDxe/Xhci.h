@@ -14,6 +14,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Uefi.h>
 
 #include <Protocol/Usb2HostController.h>
+#include <Protocol/Usb2HcStreams.h>
 #include <Protocol/PciIo.h>
 
 #include <Guid/EventGroup.h>
@@ -26,6 +27,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/DebugLib.h>
 #include <Library/ReportStatusCodeLib.h>
+#include <Library/PcdLib.h>
 
 #include <IndustryStandard/Pci.h>
 
@@ -74,9 +76,21 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 
 #define CMD_RING_TRB_NUMBER          0x100
 #define TR_RING_TRB_NUMBER           0x100
+//
+// When PcdUsbBulkTransferQueueEnable is set, a bulk endpoint ring holds several
+// queued transfers back to back, each of which takes one TRB per 64KB of data.
+//
+#define BULK_RING_TRB_NUMBER         0x400
+#define STREAM_RING_TRB_NUMBER       0x40
 #define ERST_NUMBER                  0x01
 #define EVENT_RING_TRB_NUMBER        0x200
 
+//
+// The maximum number of streams allocated for a bulk endpoint. Each stream
+// has its own transfer ring of STREAM_RING_TRB_NUMBER TRBs.
+//
+#define XHC_MAX_STREAMS              32
+
 #define CMD_INTER                    0
 #define CTRL_INTER                   1
 #define BULK_INTER                   2
@@ -96,6 +110,7 @@ typedef struct _USB_DEV_CONTEXT      USB_DEV_CONTEXT;
 
 #define XHCI_INSTANCE_SIG              SIGNATURE_32 ('x', 'h', 'c', 'i')
 #define XHC_FROM_THIS(a)               CR(a, USB_XHCI_INSTANCE, Usb2Hc, XHCI_INSTANCE_SIG)
+#define XHC_FROM_STREAMS_THIS(a)       CR(a, USB_XHCI_INSTANCE, Usb2HcStreams, XHCI_INSTANCE_SIG)
 
 #define USB_DESC_TYPE_HUB              0x29
 #define USB_DESC_TYPE_HUB_SUPER_SPEED  0x2a
@@ -172,6 +187,10 @@ struct _USB_DEV_CONTEXT {
   //
   VOID                      *EndpointTransferRing[31];
   //
+  // The streams of every bulk endpoint that has them, as ENDPOINT_STREAMS.
+  //
+  VOID                      *EndpointStreams[31];
+  //
   // The device descriptor which is stored to support XHCI's Evaluate_Context cmd.
   //
   EFI_USB_DEVICE_DESCRIPTOR DevDesc;
@@ -200,6 +219,7 @@ struct _USB_XHCI_INSTANCE {
   USBHC_MEM_POOL            *MemPool;
 
   EFI_USB2_HC_PROTOCOL      Usb2Hc;
+  EDKII_USB2_HC_STREAMS_PROTOCOL Usb2HcStreams;
 
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
 
@@ -210,6 +230,10 @@ struct _USB_XHCI_INSTANCE {
   EFI_EVENT                 ExitBootServiceEvent;
   EFI_EVENT                 PollTimer;
   LIST_ENTRY                AsyncIntTransfers;
+  //
+  // The bulk transfers queued through EDKII_USB2_HC_STREAMS_PROTOCOL.
+  //
+  LIST_ENTRY                QueuedTransfers;
 
   UINT8                     CapLength;    ///< Capability Register Length
   XHC_HCSPARAMS1            HcSParams1;   ///< Structural Parameters 1
@@ -719,4 +743,136 @@ XhcAsyncIsochronousTransfer (
   IN     VOID                                *Context
   );
 
+/**
+  Allocate streams for bulk endpoints of a SuperSpeed device.
+
+  @param  This                  This EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  DeviceSpeed           Device speed.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+  @param  StreamCount           On input, the number of streams the device supports
+                                on each endpoint. On output, the number of streams
+                                allocated.
+
+  @retval EFI_SUCCESS           The streams are allocated.
+  @retval EFI_UNSUPPORTED       The device or the host controller doesn't support
+                                streams.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The host controller failed to set up the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcAllocateStreams (
+  IN     EDKII_USB2_HC_STREAMS_PROTOCOL      *This,
+  IN     UINT8                               DeviceAddress,
+  IN     UINT8                               DeviceSpeed,
+  IN     UINT8                               *EndpointAddresses,
+  IN     UINTN                               EndpointCount,
+  IN OUT UINT16                              *StreamCount
+  );
+
+/**
+  Free the streams of bulk endpoints.
+
+  @param  This                  This EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS           The streams are freed.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The host controller failed to reconfigure the
+                                endpoints.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcFreeStreams (
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL          *This,
+  IN UINT8                                   DeviceAddress,
+  IN UINT8                                   *EndpointAddresses,
+  IN UINTN                                   EndpointCount
+  );
+
+/**
+  Queue a bulk transfer without waiting for it to complete.
+
+  @param  This                  This EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         Target device address.
+  @param  EndPointAddress       Endpoint number and its direction in bit 7.
+  @param  DeviceSpeed           Device speed.
+  @param  MaximumPacketLength   Maximum packet size the endpoint is capable of
+                                sending or receiving.
+  @param  StreamId              The stream of the transfer, or 0.
+  @param  Data                  The data buffer.
+  @param  DataLength            The length of the data buffer.
+  @param  Translator            A pointr to the transaction translator data.
+  @param  Transfer              Returns the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is queued.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_NOT_READY         The transfer ring of the endpoint and stream is
+                                full.
+  @retval EFI_OUT_OF_RESOURCES  The transfer failed due to lack of resource.
+  @retval EFI_DEVICE_ERROR      The transfer failed due to host controller error.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcSubmitBulkTransfer (
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL         *This,
+  IN  UINT8                                  DeviceAddress,
+  IN  UINT8                                  EndPointAddress,
+  IN  UINT8                                  DeviceSpeed,
+  IN  UINTN                                  MaximumPacketLength,
+  IN  UINT16                                 StreamId,
+  IN  VOID                                   *Data,
+  IN  UINTN                                  DataLength,
+  IN  EFI_USB2_HC_TRANSACTION_TRANSLATOR     *Translator,
+  OUT VOID                                   **Transfer
+  );
+
+/**
+  Check whether a queued bulk transfer is complete, and free it if it is.
+
+  @param  This                  This EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The queued transfer.
+  @param  DataLength            Returns the number of bytes transferred.
+  @param  TransferResult        Returns the result of the transfer.
+
+  @retval EFI_SUCCESS           The transfer completed successfully.
+  @retval EFI_NOT_READY         The transfer is still in progress.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The transfer failed.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcPollBulkTransfer (
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL         *This,
+  IN  VOID                                   *Transfer,
+  OUT UINTN                                  *DataLength,
+  OUT UINT32                                 *TransferResult
+  );
+
+/**
+  Cancel a queued bulk transfer, and free it.
+
+  @param  This                  This EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is cancelled.
+  @retval EFI_INVALID_PARAMETER Some parameters are invalid.
+  @retval EFI_DEVICE_ERROR      The host controller failed to stop the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+XhcCancelBulkTransfer (
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL          *This,
+  IN VOID                                    *Transfer
+  );
+
 #endif
@@ -180,6 +180,67 @@ XhcCreateUrb (
   return Urb;
 }
 
+/**
+  Create a new URB for a queued bulk transfer.
+
+  @param  Xhc       The XHCI Instance
+  @param  BusAddr   The logical device address assigned by UsbBus driver
+  @param  EpAddr    Endpoint addrress
+  @param  DevSpeed  The device speed
+  @param  MaxPacket The max packet length of the endpoint
+  @param  StreamId  The stream of the transfer, or 0
+  @param  Data      The user data to transfer
+  @param  DataLen   The length of data buffer
+
+  @return Created URB or NULL
+
+**/
+URB*
+XhcCreateQueuedUrb (
+  IN USB_XHCI_INSTANCE                  *Xhc,
+  IN UINT8                              BusAddr,
+  IN UINT8                              EpAddr,
+  IN UINT8                              DevSpeed,
+  IN UINTN                              MaxPacket,
+  IN UINT16                             StreamId,
+  IN VOID                               *Data,
+  IN UINTN                              DataLen
+  )
+{
+  USB_ENDPOINT                  *Ep;
+  EFI_STATUS                    Status;
+  URB                           *Urb;
+
+  Urb = AllocateZeroPool (sizeof (URB));
+  if (Urb == NULL) {
+    return NULL;
+  }
+
+  Urb->Signature = XHC_URB_SIG;
+  InitializeListHead (&Urb->UrbList);
+
+  Ep            = &Urb->Ep;
+  Ep->BusAddr   = BusAddr;
+  Ep->EpAddr    = (UINT8)(EpAddr & 0x0F);
+  Ep->Direction = ((EpAddr & 0x80) != 0) ? EfiUsbDataIn : EfiUsbDataOut;
+  Ep->DevSpeed  = DevSpeed;
+  Ep->MaxPacket = MaxPacket;
+  Ep->Type      = XHC_BULK_TRANSFER;
+
+  Urb->Data     = Data;
+  Urb->DataLen  = DataLen;
+  Urb->StreamId = StreamId;
+
+  Status = XhcCreateTransferTrb (Xhc, Urb);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "XhcCreateQueuedUrb: XhcCreateTransferTrb Failed, Status = %r\n", Status));
+    FreePool (Urb);
+    Urb = NULL;
+  }
+
+  return Urb;
+}
+
 /**
   Free an allocated URB.
 
@@ -221,6 +282,7 @@ XhcCreateTransferTrb (
 {
   VOID                          *OutputContext;
   TRANSFER_RING                 *EPRing;
+  ENDPOINT_STREAMS              *Streams;
   UINT8                         EPType;
   UINT8                         SlotId;
   UINT8                         Dci;
@@ -246,7 +308,18 @@ XhcCreateTransferTrb (
 
   Dci       = XhcEndpointToDci (Urb->Ep.EpAddr, (UINT8)(Urb->Ep.Direction));
   ASSERT (Dci < 32);
-  EPRing    = (TRANSFER_RING *)(UINTN) Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1];
+  if (Urb->StreamId != 0) {
+    //
+    // Each stream of the endpoint has its own transfer ring.
+    //
+    Streams = (ENDPOINT_STREAMS *) Xhc->UsbDevContext[SlotId].EndpointStreams[Dci-1];
+    if ((Streams == NULL) || (Urb->StreamId > Streams->StreamCount)) {
+      return EFI_INVALID_PARAMETER;
+    }
+    EPRing  = &Streams->StreamRing[Urb->StreamId - 1];
+  } else {
+    EPRing  = (TRANSFER_RING *)(UINTN) Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1];
+  }
   Urb->Ring = EPRing;
   OutputContext = Xhc->UsbDevContext[SlotId].OutputContext;
   if (Xhc->HcCParams.Data.Csz == 0) {
@@ -678,7 +751,7 @@ XhcRecoverHaltedEndpoint (
   //
   // 3)Ring the doorbell to transit from stop to active
   //
-  XhcRingDoorBell (Xhc, SlotId, Dci);
+  XhcRingStreamDoorBell (Xhc, SlotId, Dci, Urb->StreamId);
 
 Done:
   return Status;
@@ -750,7 +823,7 @@ XhcDequeueTrbFromEndpoint (
   //
   // 3)Ring the doorbell to transit from stop to active
   //
-  XhcRingDoorBell (Xhc, SlotId, Dci);
+  XhcRingStreamDoorBell (Xhc, SlotId, Dci, Urb->StreamId);
 
 Done:
   return Status;
@@ -1063,6 +1136,39 @@ IsAsyncIntTrb (
   return FALSE;
 }
 
+/**
+  Check if the Trb is a transaction of the URBs in XHCI's queued transfer list
+  which are still in progress.
+
+  @param Xhc    The XHCI Instance.
+  @param Trb    The TRB to be checked.
+  @param Urb    The pointer to the matched Urb.
+
+  @retval TRUE  The Trb is matched with a transaction of the queued URBs.
+  @retval FALSE The Trb is not matched with any queued URBs.
+
+**/
+BOOLEAN
+IsQueuedTrb (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  TRB_TEMPLATE        *Trb,
+  OUT URB                 **Urb
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *CheckedUrb;
+
+  BASE_LIST_FOR_EACH (Entry, &Xhc->QueuedTransfers) {
+    CheckedUrb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if (!CheckedUrb->Finished && IsTransferRingTrb (Xhc, Trb, CheckedUrb)) {
+      *Urb = CheckedUrb;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 
 /**
   Check the URB's execution result and update the URB's
@@ -1086,7 +1192,9 @@ XhcCheckUrbResult (
   UINT8                   TRBType;
   EFI_STATUS              Status;
   URB                     *AsyncUrb;
+  URB                     *QueuedUrb;
   URB                     *CheckedUrb;
+  TRB_TEMPLATE            *EventRingDequeue;
   UINT64                  XhcDequeue;
   UINT32                  High;
   UINT32                  Low;
@@ -1094,8 +1202,10 @@ XhcCheckUrbResult (
 
   ASSERT ((Xhc != NULL) && (Urb != NULL));
 
-  Status   = EFI_SUCCESS;
-  AsyncUrb = NULL;
+  Status           = EFI_SUCCESS;
+  AsyncUrb         = NULL;
+  QueuedUrb        = NULL;
+  EventRingDequeue = Xhc->EventRing.EventRingDequeue;
 
   if (Urb->Finished) {
     goto EXIT;
@@ -1136,7 +1246,7 @@ XhcCheckUrbResult (
 
     //
     // Update the status of URB including the pending URB, the URB that is currently checked,
-    // and URBs in the XHCI's async interrupt transfer list.
+    // and URBs in the XHCI's async interrupt transfer and queued transfer lists.
     // This way is used to avoid that those completed async transfer events don't get
     // handled in time and are flushed by newer coming events.
     //
@@ -1146,6 +1256,8 @@ XhcCheckUrbResult (
       CheckedUrb = Urb;
     } else if (IsAsyncIntTrb (Xhc, TRBPtr, &AsyncUrb)) {
       CheckedUrb = AsyncUrb;
+    } else if (IsQueuedTrb (Xhc, TRBPtr, &QueuedUrb)) {
+      CheckedUrb = QueuedUrb;
     } else {
       continue;
     }
@@ -1177,6 +1289,13 @@ XhcCheckUrbResult (
 
       case TRB_COMPLETION_STOPPED:
       case TRB_COMPLETION_STOPPED_LENGTH_INVALID:
+        if ((CheckedUrb != Xhc->PendingUrb) && (CheckedUrb->StreamId != 0)) {
+          //
+          // Stopping an endpoint with streams only pauses the transfers on the
+          // other streams. They resume when the door bell of the stream is rung.
+          //
+          continue;
+        }
         CheckedUrb->Result  |= EFI_USB_ERR_TIMEOUT;
         CheckedUrb->Finished = TRUE;
         //
@@ -1226,6 +1345,16 @@ XhcCheckUrbResult (
 
 EXIT:
 
+  //
+  // The event ring dequeue pointer register is only written here, once per
+  // batch of events. When no event was handled, it is up to date already,
+  // which saves the register accesses while the queued transfers are polled.
+  //
+  if (FeaturePcdGet (PcdUsbBulkTransferQueueEnable) &&
+      (Xhc->EventRing.EventRingDequeue == EventRingDequeue)) {
+    return Urb->Finished;
+  }
+
   //
   // Advance event ring to last available entry
   //
@@ -1438,6 +1567,165 @@ XhciDelAllAsyncIntTransfers (
   }
 }
 
+/**
+  Check if the URB is in XHCI's queued transfer list.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB to be checked.
+
+  @retval TRUE      The URB is a queued transfer.
+  @retval FALSE     The URB is not a queued transfer.
+
+**/
+BOOLEAN
+XhcIsQueuedUrb (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  )
+{
+  LIST_ENTRY              *Entry;
+
+  BASE_LIST_FOR_EACH (Entry, &Xhc->QueuedTransfers) {
+    if (EFI_LIST_CONTAINER (Entry, URB, UrbList) == Urb) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Ring the door bells of the queued transfers which are still in progress
+  on the endpoint of the URB, after the endpoint was stopped or halted.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB of the endpoint.
+
+**/
+VOID
+XhcRestartQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *QueuedUrb;
+  UINT8                   SlotId;
+  UINT8                   Dci;
+
+  SlotId = XhcBusDevAddrToSlotId (Xhc, Urb->Ep.BusAddr);
+  if (SlotId == 0) {
+    return;
+  }
+  Dci = XhcEndpointToDci (Urb->Ep.EpAddr, (UINT8)(Urb->Ep.Direction));
+
+  BASE_LIST_FOR_EACH (Entry, &Xhc->QueuedTransfers) {
+    QueuedUrb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if ((QueuedUrb != Urb) && !QueuedUrb->Finished &&
+        (QueuedUrb->Ep.BusAddr == Urb->Ep.BusAddr) &&
+        (QueuedUrb->Ep.EpAddr == Urb->Ep.EpAddr) &&
+        (QueuedUrb->Ep.Direction == Urb->Ep.Direction)) {
+      XhcRingStreamDoorBell (Xhc, SlotId, Dci, QueuedUrb->StreamId);
+    }
+  }
+}
+
+/**
+  Finish the queued transfers which are still in progress on the transfer
+  ring of the URB, because the dequeue pointer of the ring is about to be
+  moved past them to recover the endpoint or to cancel the URB. Without
+  PcdUsbBulkTransferQueueEnable, there is no other transfer on the ring.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB which is recovered or cancelled.
+
+**/
+VOID
+XhcAbortRingTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *QueuedUrb;
+
+  if (!FeaturePcdGet (PcdUsbBulkTransferQueueEnable)) {
+    return;
+  }
+
+  BASE_LIST_FOR_EACH (Entry, &Xhc->QueuedTransfers) {
+    QueuedUrb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if ((QueuedUrb != Urb) && !QueuedUrb->Finished && (QueuedUrb->Ring == Urb->Ring)) {
+      QueuedUrb->Result  |= EFI_USB_ERR_NOTEXECUTE;
+      QueuedUrb->Finished = TRUE;
+    }
+  }
+}
+
+/**
+  Finish the queued transfers of a device with a system error, because the
+  transfer rings they use are going away. The transfers stay in the queued
+  transfer list until their owner polls or cancels them.
+
+  @param  Xhc       The XHCI Instance.
+  @param  SlotId    The slot id of the device, or 0 for all the devices.
+  @param  Dci       The device context index of the endpoint, or 0 for all
+                    the endpoints of the device.
+
+**/
+VOID
+XhcAbortQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci
+  )
+{
+  LIST_ENTRY              *Entry;
+  URB                     *Urb;
+
+  BASE_LIST_FOR_EACH (Entry, &Xhc->QueuedTransfers) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+    if (Urb->Finished) {
+      continue;
+    }
+
+    if (SlotId != 0) {
+      if (Urb->Ep.BusAddr != Xhc->UsbDevContext[SlotId].BusDevAddr) {
+        continue;
+      }
+      if ((Dci != 0) && (XhcEndpointToDci (Urb->Ep.EpAddr, (UINT8)(Urb->Ep.Direction)) != Dci)) {
+        continue;
+      }
+    }
+
+    Urb->Result  |= EFI_USB_ERR_SYSTEM;
+    Urb->Finished = TRUE;
+  }
+}
+
+/**
+  Remove all the queued transfers.
+
+  @param  Xhc    The XHCI Instance.
+
+**/
+VOID
+XhciDelAllQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  )
+{
+  LIST_ENTRY              *Entry;
+  LIST_ENTRY              *Next;
+  URB                     *Urb;
+
+  BASE_LIST_FOR_EACH_SAFE (Entry, Next, &Xhc->QueuedTransfers) {
+    Urb = EFI_LIST_CONTAINER (Entry, URB, UrbList);
+
+    RemoveEntryList (&Urb->UrbList);
+    XhcFreeUrb (Xhc, Urb);
+  }
+}
+
 /**
   Insert a single asynchronous interrupt transfer for
   the device and endpoint.
@@ -2088,6 +2376,29 @@ RingIntTransferDoorBell (
   return EFI_SUCCESS;
 }
 
+/**
+  Ring the door bell of a stream of an endpoint.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the target device.
+  @param  Dci           The device context index of the target endpoint.
+  @param  StreamId      The stream to ring, or 0 for an endpoint without streams.
+
+**/
+VOID
+XhcRingStreamDoorBell (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN UINT16               StreamId
+  )
+{
+  //
+  // 5.6 Doorbell Registers, the DB Stream ID is in bits 31:16.
+  //
+  XhcWriteDoorBellReg (Xhc, SlotId * sizeof (UINT32), Dci | ((UINT32) StreamId << 16));
+}
+
 /**
   Assign and initialize the device slot for a new device.
 
@@ -2583,11 +2894,12 @@ XhcDisableSlotCmd (
   //
   // Free the slot related data structure
   //
+  XhcFreeDeviceStreams (Xhc, SlotId);
   for (Index = 0; Index < 31; Index++) {
     if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index] != NULL) {
       RingSeg = ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index])->RingSeg0;
       if (RingSeg != NULL) {
-        UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER);
+        UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index])->TrbNumber);
       }
       FreePool (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index]);
       Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index] = NULL;
@@ -2690,11 +3002,12 @@ XhcDisableSlotCmd64 (
   //
   // Free the slot related data structure
   //
+  XhcFreeDeviceStreams (Xhc, SlotId);
   for (Index = 0; Index < 31; Index++) {
     if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index] != NULL) {
       RingSeg = ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index])->RingSeg0;
       if (RingSeg != NULL) {
-        UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER);
+        UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index])->TrbNumber);
       }
       FreePool (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index]);
       Xhc->UsbDevContext[SlotId].EndpointTransferRing[Index] = NULL;
@@ -2812,11 +3125,15 @@ XhcInitializeEndpointContext (
         if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1] == NULL) {
           EndpointTransferRing = AllocateZeroPool(sizeof (TRANSFER_RING));
           Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1] = (VOID *) EndpointTransferRing;
-          CreateTransferRing(Xhc, TR_RING_TRB_NUMBER, (TRANSFER_RING *)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1]);
+          CreateTransferRing (
+            Xhc,
+            FeaturePcdGet (PcdUsbBulkTransferQueueEnable) ? BULK_RING_TRB_NUMBER : TR_RING_TRB_NUMBER,
+            (TRANSFER_RING *)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1]
+            );
           DEBUG ((DEBUG_INFO, "Endpoint[%x]: Created BULK ring [%p~%p)\n",
                   EpDesc->EndpointAddress,
                   EndpointTransferRing->RingSeg0,
-                  (UINTN) EndpointTransferRing->RingSeg0 + TR_RING_TRB_NUMBER * sizeof (TRB_TEMPLATE)
+                  (UINTN) EndpointTransferRing->RingSeg0 + EndpointTransferRing->TrbNumber * sizeof (TRB_TEMPLATE)
                   ));
         }
 
@@ -2908,7 +3225,7 @@ XhcInitializeEndpointContext (
     PhyAddr = UsbHcGetPciAddrForHostAddr (
                 Xhc->MemPool,
                 ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->RingSeg0,
-                sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER
+                sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->TrbNumber
                 );
     PhyAddr &= ~((EFI_PHYSICAL_ADDRESS)0x0F);
     PhyAddr |= (EFI_PHYSICAL_ADDRESS)((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->RingPCS;
@@ -3004,11 +3321,15 @@ XhcInitializeEndpointContext64 (
         if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1] == NULL) {
           EndpointTransferRing = AllocateZeroPool(sizeof (TRANSFER_RING));
           Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1] = (VOID *) EndpointTransferRing;
-          CreateTransferRing(Xhc, TR_RING_TRB_NUMBER, (TRANSFER_RING *)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1]);
+          CreateTransferRing (
+            Xhc,
+            FeaturePcdGet (PcdUsbBulkTransferQueueEnable) ? BULK_RING_TRB_NUMBER : TR_RING_TRB_NUMBER,
+            (TRANSFER_RING *)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1]
+            );
           DEBUG ((DEBUG_INFO, "Endpoint64[%x]: Created BULK ring [%p~%p)\n",
                   EpDesc->EndpointAddress,
                   EndpointTransferRing->RingSeg0,
-                  (UINTN) EndpointTransferRing->RingSeg0 + TR_RING_TRB_NUMBER * sizeof (TRB_TEMPLATE)
+                  (UINTN) EndpointTransferRing->RingSeg0 + EndpointTransferRing->TrbNumber * sizeof (TRB_TEMPLATE)
                   ));
         }
 
@@ -3100,7 +3421,7 @@ XhcInitializeEndpointContext64 (
     PhyAddr = UsbHcGetPciAddrForHostAddr (
                 Xhc->MemPool,
                 ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->RingSeg0,
-                sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER
+                sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->TrbNumber
                 );
     PhyAddr &= ~((EFI_PHYSICAL_ADDRESS)0x0F);
     PhyAddr |= (EFI_PHYSICAL_ADDRESS)((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1])->RingPCS;
@@ -3144,6 +3465,11 @@ XhcSetConfigCmd (
   INPUT_CONTEXT               *InputContext;
   DEVICE_CONTEXT              *OutputContext;
   EVT_TRB_COMMAND_COMPLETION  *EvtTrb;
+  //
+  // The streams of the endpoints go away when they are configured again.
+  //
+  XhcFreeDeviceStreams (Xhc, SlotId);
+
   //
   // 4.6.6 Configure Endpoint
   //
@@ -3234,6 +3560,11 @@ XhcSetConfigCmd64 (
   INPUT_CONTEXT_64            *InputContext;
   DEVICE_CONTEXT_64           *OutputContext;
   EVT_TRB_COMMAND_COMPLETION  *EvtTrb;
+  //
+  // The streams of the endpoints go away when they are configured again.
+  //
+  XhcFreeDeviceStreams (Xhc, SlotId);
+
   //
   // 4.6.6 Configure Endpoint
   //
@@ -3452,6 +3783,10 @@ XhcSetTrDequeuePointer (
   CmdSetTRDeq.Type     = TRB_TYPE_SET_TR_DEQUE;
   CmdSetTRDeq.Endpoint = Dci;
   CmdSetTRDeq.SlotId   = SlotId;
+  if (Urb->StreamId != 0) {
+    CmdSetTRDeq.PtrLo   |= STREAM_CONTEXT_SCT_PRIMARY_TR;
+    CmdSetTRDeq.StreamID = Urb->StreamId;
+  }
   Status = XhcCmdTransfer (
              Xhc,
              (TRB_TEMPLATE *) (UINTN) &CmdSetTRDeq,
@@ -3600,7 +3935,7 @@ XhcSetInterface (
       if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1] != NULL) {
         RingSeg = ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1])->RingSeg0;
         if (RingSeg != NULL) {
-          UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER);
+          UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1])->TrbNumber);
         }
         FreePool (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1]);
         Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1] = NULL;
@@ -3802,7 +4137,7 @@ XhcSetInterface64 (
       if (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1] != NULL) {
         RingSeg = ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1])->RingSeg0;
         if (RingSeg != NULL) {
-          UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * TR_RING_TRB_NUMBER);
+          UsbHcFreeMem (Xhc->MemPool, RingSeg, sizeof (TRB_TEMPLATE) * ((TRANSFER_RING *)(UINTN)Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1])->TrbNumber);
         }
         FreePool (Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1]);
         Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci - 1] = NULL;
@@ -4116,4 +4451,259 @@ XhcConfigHubContext64 (
   return Status;
 }
 
+/**
+  Configure a bulk endpoint to use its streams, or its transfer ring, through
+  XHCI's Configure_Endpoint cmd.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+  @param  Dci           The device context index of the endpoint.
+  @param  Streams       The streams of the endpoint, or NULL to configure the
+                        endpoint back to its transfer ring.
+
+  @retval EFI_SUCCESS   Successfully configure the endpoint.
+
+**/
+EFI_STATUS
+XhcConfigureEndpointStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN ENDPOINT_STREAMS     *Streams  OPTIONAL
+  )
+{
+  EFI_STATUS                  Status;
+  VOID                        *InputContext;
+  VOID                        *OutputContext;
+  UINTN                       InputContextSize;
+  INPUT_CONTRL_CONTEXT        *InputControlContext;
+  ENDPOINT_CONTEXT            *EndpointContext;
+  TRANSFER_RING               *EndpointTransferRing;
+  EFI_PHYSICAL_ADDRESS        PhyAddr;
+  CMD_TRB_CONFIG_ENDPOINT     CmdTrbCfgEP;
+  EVT_TRB_COMMAND_COMPLETION  *EvtTrb;
+
+  //
+  // 4.6.6 Configure Endpoint
+  // The endpoint is dropped and added again with the same context, except
+  // for its TR Dequeue Pointer and MaxPStreams. The 64-byte contexts begin
+  // with the fields of the 32-byte ones.
+  //
+  InputContext  = Xhc->UsbDevContext[SlotId].InputContext;
+  OutputContext = Xhc->UsbDevContext[SlotId].OutputContext;
+  if (Xhc->HcCParams.Data.Csz == 0) {
+    InputContextSize = sizeof (INPUT_CONTEXT);
+    ZeroMem (InputContext, InputContextSize);
+    CopyMem (&((INPUT_CONTEXT *) InputContext)->Slot, &((DEVICE_CONTEXT *) OutputContext)->Slot, sizeof (SLOT_CONTEXT));
+    CopyMem (&((INPUT_CONTEXT *) InputContext)->EP[Dci-1], &((DEVICE_CONTEXT *) OutputContext)->EP[Dci-1], sizeof (ENDPOINT_CONTEXT));
+    InputControlContext = &((INPUT_CONTEXT *) InputContext)->InputControlContext;
+    EndpointContext     = &((INPUT_CONTEXT *) InputContext)->EP[Dci-1];
+  } else {
+    InputContextSize = sizeof (INPUT_CONTEXT_64);
+    ZeroMem (InputContext, InputContextSize);
+    CopyMem (&((INPUT_CONTEXT_64 *) InputContext)->Slot, &((DEVICE_CONTEXT_64 *) OutputContext)->Slot, sizeof (SLOT_CONTEXT_64));
+    CopyMem (&((INPUT_CONTEXT_64 *) InputContext)->EP[Dci-1], &((DEVICE_CONTEXT_64 *) OutputContext)->EP[Dci-1], sizeof (ENDPOINT_CONTEXT_64));
+    InputControlContext = (INPUT_CONTRL_CONTEXT *) &((INPUT_CONTEXT_64 *) InputContext)->InputControlContext;
+    EndpointContext     = (ENDPOINT_CONTEXT *) &((INPUT_CONTEXT_64 *) InputContext)->EP[Dci-1];
+  }
+
+  InputControlContext->Dword1 = (BIT0 << Dci);
+  InputControlContext->Dword2 = (BIT0 << Dci) | BIT0;
+  EndpointContext->EPState    = 0;
+  EndpointContext->HID        = 0;
+
+  if (Streams != NULL) {
+    //
+    // 6.2.3 Endpoint Context, a Primary Stream Array of 2^(MaxPStreams + 1)
+    // entries with Linear Stream Array addressing.
+    //
+    PhyAddr = UsbHcGetPciAddrForHostAddr (
+                Xhc->MemPool,
+                Streams->StreamContextArray,
+                sizeof (STREAM_CONTEXT) * Streams->ArraySize
+                );
+    EndpointContext->MaxPStreams = (UINT32) HighBitSet32 ((UINT32) Streams->ArraySize) - 1;
+    EndpointContext->LSA         = 1;
+  } else {
+    EndpointTransferRing = (TRANSFER_RING *) Xhc->UsbDevContext[SlotId].EndpointTransferRing[Dci-1];
+    PhyAddr  = UsbHcGetPciAddrForHostAddr (Xhc->MemPool, EndpointTransferRing->RingEnqueue, sizeof (TRB_TEMPLATE));
+    PhyAddr |= (EFI_PHYSICAL_ADDRESS) EndpointTransferRing->RingPCS;
+    EndpointContext->MaxPStreams = 0;
+    EndpointContext->LSA         = 0;
+  }
+  EndpointContext->PtrLo = XHC_LOW_32BIT (PhyAddr);
+  EndpointContext->PtrHi = XHC_HIGH_32BIT (PhyAddr);
+
+  ZeroMem (&CmdTrbCfgEP, sizeof (CmdTrbCfgEP));
+  PhyAddr = UsbHcGetPciAddrForHostAddr (Xhc->MemPool, InputContext, InputContextSize);
+  CmdTrbCfgEP.PtrLo    = XHC_LOW_32BIT (PhyAddr);
+  CmdTrbCfgEP.PtrHi    = XHC_HIGH_32BIT (PhyAddr);
+  CmdTrbCfgEP.CycleBit = 1;
+  CmdTrbCfgEP.Type     = TRB_TYPE_CON_ENDPOINT;
+  CmdTrbCfgEP.SlotId   = Xhc->UsbDevContext[SlotId].SlotId;
+  DEBUG ((DEBUG_INFO, "Configure Endpoint Streams: Slot = 0x%x, Dci = 0x%x\n", SlotId, Dci));
+  Status = XhcCmdTransfer (
+             Xhc,
+             (TRB_TEMPLATE *) (UINTN) &CmdTrbCfgEP,
+             XHC_GENERIC_TIMEOUT,
+             (TRB_TEMPLATE **) (UINTN) &EvtTrb
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "XhcConfigureEndpointStreams: Config Endpoint Failed, Status = %r\n", Status));
+  }
+
+  return Status;
+}
+
+/**
+  Allocate the streams of a bulk endpoint, and configure the endpoint to use
+  them through XHCI's Configure_Endpoint cmd.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+  @param  Dci           The device context index of the endpoint.
+  @param  StreamCount   The number of streams to allocate.
 
+  @retval EFI_SUCCESS   The streams are allocated.
+  @retval Others        Failed to configure the endpoint.
+
+**/
+EFI_STATUS
+XhcAllocateEndpointStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN UINT16               StreamCount
+  )
+{
+  ENDPOINT_STREAMS        *Streams;
+  TRANSFER_RING           *Ring;
+  EFI_PHYSICAL_ADDRESS    PhyAddr;
+  UINTN                   ArraySize;
+  UINT16                  Index;
+  EFI_STATUS              Status;
+
+  ASSERT (Xhc->UsbDevContext[SlotId].EndpointStreams[Dci-1] == NULL);
+  ASSERT ((StreamCount != 0) && (StreamCount <= XHC_MAX_STREAMS));
+
+  //
+  // The smallest Primary Stream Array has 4 entries. Entry 0 is reserved.
+  //
+  ArraySize = 4;
+  while (ArraySize < (UINTN) StreamCount + 1) {
+    ArraySize <<= 1;
+  }
+
+  Streams = AllocateZeroPool (sizeof (ENDPOINT_STREAMS));
+  if (Streams == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Streams->StreamRing         = AllocateZeroPool (sizeof (TRANSFER_RING) * StreamCount);
+  Streams->StreamContextArray = UsbHcAllocateMem (Xhc->MemPool, sizeof (STREAM_CONTEXT) * ArraySize);
+  if ((Streams->StreamRing == NULL) || (Streams->StreamContextArray == NULL)) {
+    if (Streams->StreamRing != NULL) {
+      FreePool (Streams->StreamRing);
+    }
+    if (Streams->StreamContextArray != NULL) {
+      UsbHcFreeMem (Xhc->MemPool, Streams->StreamContextArray, sizeof (STREAM_CONTEXT) * ArraySize);
+    }
+    FreePool (Streams);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem (Streams->StreamContextArray, sizeof (STREAM_CONTEXT) * ArraySize);
+  Streams->ArraySize   = ArraySize;
+  Streams->StreamCount = StreamCount;
+
+  for (Index = 1; Index <= StreamCount; Index++) {
+    Ring = &Streams->StreamRing[Index - 1];
+    CreateTransferRing (Xhc, STREAM_RING_TRB_NUMBER, Ring);
+    PhyAddr = UsbHcGetPciAddrForHostAddr (Xhc->MemPool, Ring->RingSeg0, sizeof (TRB_TEMPLATE) * STREAM_RING_TRB_NUMBER);
+    Streams->StreamContextArray[Index].PtrLo = XHC_LOW_32BIT (PhyAddr) | STREAM_CONTEXT_SCT_PRIMARY_TR | Ring->RingPCS;
+    Streams->StreamContextArray[Index].PtrHi = XHC_HIGH_32BIT (PhyAddr);
+  }
+
+  Xhc->UsbDevContext[SlotId].EndpointStreams[Dci-1] = Streams;
+
+  Status = XhcConfigureEndpointStreams (Xhc, SlotId, Dci, Streams);
+  if (EFI_ERROR (Status)) {
+    XhcFreeEndpointStreams (Xhc, SlotId, Dci, FALSE);
+  }
+
+  return Status;
+}
+
+/**
+  Free the streams of a bulk endpoint.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+  @param  Dci           The device context index of the endpoint.
+  @param  Reconfigure   Whether to configure the endpoint back to its transfer
+                        ring through XHCI's Configure_Endpoint cmd.
+
+  @retval EFI_SUCCESS   The streams are freed.
+  @retval Others        Failed to configure the endpoint. The streams are
+                        freed anyway.
+
+**/
+EFI_STATUS
+XhcFreeEndpointStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN BOOLEAN              Reconfigure
+  )
+{
+  ENDPOINT_STREAMS        *Streams;
+  UINT16                  Index;
+  EFI_STATUS              Status;
+
+  Streams = (ENDPOINT_STREAMS *) Xhc->UsbDevContext[SlotId].EndpointStreams[Dci-1];
+  if (Streams == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Status = EFI_SUCCESS;
+  if (Reconfigure) {
+    Status = XhcConfigureEndpointStreams (Xhc, SlotId, Dci, NULL);
+  }
+
+  for (Index = 0; Index < Streams->StreamCount; Index++) {
+    if (Streams->StreamRing[Index].RingSeg0 != NULL) {
+      UsbHcFreeMem (Xhc->MemPool, Streams->StreamRing[Index].RingSeg0, sizeof (TRB_TEMPLATE) * STREAM_RING_TRB_NUMBER);
+    }
+  }
+  UsbHcFreeMem (Xhc->MemPool, Streams->StreamContextArray, sizeof (STREAM_CONTEXT) * Streams->ArraySize);
+  FreePool (Streams->StreamRing);
+  FreePool (Streams);
+  Xhc->UsbDevContext[SlotId].EndpointStreams[Dci-1] = NULL;
+
+  return Status;
+}
+
+/**
+  Abort the queued transfers and free the streams of a device, before its
+  endpoints are configured again or its slot is disabled.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+
+**/
+VOID
+XhcFreeDeviceStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId
+  )
+{
+  UINT8                   Index;
+
+  XhcAbortQueuedTransfers (Xhc, SlotId, 0);
+
+  for (Index = 0; Index < 31; Index++) {
+    if (Xhc->UsbDevContext[SlotId].EndpointStreams[Index] != NULL) {
+      XhcFreeEndpointStreams (Xhc, SlotId, Index + 1, FALSE);
+    }
+  }
+}
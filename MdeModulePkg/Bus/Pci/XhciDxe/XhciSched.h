@@ -188,6 +188,10 @@ typedef struct _URB {
   TRB_TEMPLATE                    *TrbStart;
   TRB_TEMPLATE                    *TrbEnd;
   UINTN                           TrbNum;
+  //
+  // The stream of a bulk transfer, 0 if the endpoint has no streams
+  //
+  UINT16                          StreamId;
   BOOLEAN                         StartDone;
   BOOLEAN                         EndDone;
   BOOLEAN                         Finished;
@@ -696,6 +700,38 @@ typedef struct _ENDPOINT_CONTEXT_64 {
 
 } ENDPOINT_CONTEXT_64;
 
+//
+// 6.2.4.1 Stream Context
+// PtrLo holds the Dequeue Cycle State in bit 0 and the Stream Context Type
+// in bits 3:1.
+//
+typedef struct _STREAM_CONTEXT {
+  UINT32                  PtrLo;
+
+  UINT32                  PtrHi;
+
+  UINT32                  StoppedEDTLA:24;
+  UINT32                  RsvdZ1:8;
+
+  UINT32                  RsvdZ2;
+} STREAM_CONTEXT;
+
+//
+// Stream Context Type of a Primary Transfer Ring
+//
+#define STREAM_CONTEXT_SCT_PRIMARY_TR         (1 << 1)
+
+//
+// The streams of a bulk endpoint. Stream N, from 1 to StreamCount, uses
+// StreamRing[N - 1]. Entry 0 of the stream context array is reserved.
+//
+typedef struct _ENDPOINT_STREAMS {
+  STREAM_CONTEXT          *StreamContextArray;
+  UINTN                   ArraySize;
+  UINT16                  StreamCount;
+  TRANSFER_RING           *StreamRing;
+} ENDPOINT_STREAMS;
+
 
 //
 // 6.2.5.1 Input Control Context
@@ -1470,6 +1506,22 @@ XhcFreeUrb (
   IN URB                  *Urb
   );
 
+/**
+  Check the URB's execution result and update the URB's
+  result accordingly.
+
+  @param  Xhc             The XHCI Instance.
+  @param  Urb             The URB to check result.
+
+  @return Whether the result of URB transfer is finialized.
+
+**/
+BOOLEAN
+XhcCheckUrbResult (
+  IN  USB_XHCI_INSTANCE   *Xhc,
+  IN  URB                 *Urb
+  );
+
 /**
   Create a transfer TRB.
 
@@ -1485,4 +1537,179 @@ XhcCreateTransferTrb (
   IN URB                          *Urb
   );
 
+/**
+  Ring the door bell of a stream of an endpoint.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the target device.
+  @param  Dci           The device context index of the target endpoint.
+  @param  StreamId      The stream to ring, or 0 for an endpoint without streams.
+
+**/
+VOID
+XhcRingStreamDoorBell (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN UINT16               StreamId
+  );
+
+/**
+  Create a new URB for a queued bulk transfer.
+
+  @param  Xhc       The XHCI Instance
+  @param  BusAddr   The logical device address assigned by UsbBus driver
+  @param  EpAddr    Endpoint addrress
+  @param  DevSpeed  The device speed
+  @param  MaxPacket The max packet length of the endpoint
+  @param  StreamId  The stream of the transfer, or 0
+  @param  Data      The user data to transfer
+  @param  DataLen   The length of data buffer
+
+  @return Created URB or NULL
+
+**/
+URB*
+XhcCreateQueuedUrb (
+  IN USB_XHCI_INSTANCE                  *Xhc,
+  IN UINT8                              BusAddr,
+  IN UINT8                              EpAddr,
+  IN UINT8                              DevSpeed,
+  IN UINTN                              MaxPacket,
+  IN UINT16                             StreamId,
+  IN VOID                               *Data,
+  IN UINTN                              DataLen
+  );
+
+/**
+  Check if the URB is in XHCI's queued transfer list.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB to be checked.
+
+  @retval TRUE      The URB is a queued transfer.
+  @retval FALSE     The URB is not a queued transfer.
+
+**/
+BOOLEAN
+XhcIsQueuedUrb (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  );
+
+/**
+  Ring the door bells of the queued transfers which are still in progress
+  on the endpoint of the URB, after the endpoint was stopped or halted.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB of the endpoint.
+
+**/
+VOID
+XhcRestartQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  );
+
+/**
+  Finish the queued transfers which are still in progress on the transfer
+  ring of the URB, because the dequeue pointer of the ring is about to be
+  moved past them to recover the endpoint or to cancel the URB.
+
+  @param  Xhc       The XHCI Instance.
+  @param  Urb       The URB which is recovered or cancelled.
+
+**/
+VOID
+XhcAbortRingTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN URB                  *Urb
+  );
+
+/**
+  Finish the queued transfers of a device with a system error, because the
+  transfer rings they use are going away. The transfers stay in the queued
+  transfer list until their owner polls or cancels them.
+
+  @param  Xhc       The XHCI Instance.
+  @param  SlotId    The slot id of the device, or 0 for all the devices.
+  @param  Dci       The device context index of the endpoint, or 0 for all
+                    the endpoints of the device.
+
+**/
+VOID
+XhcAbortQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci
+  );
+
+/**
+  Remove all the queued transfers.
+
+  @param  Xhc    The XHCI Instance.
+
+**/
+VOID
+XhciDelAllQueuedTransfers (
+  IN USB_XHCI_INSTANCE    *Xhc
+  );
+
+/**
+  Allocate the streams of a bulk endpoint, and configure the endpoint to use
+  them through XHCI's Configure_Endpoint cmd.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+  @param  Dci           The device context index of the endpoint.
+  @param  StreamCount   The number of streams to allocate.
+
+  @retval EFI_SUCCESS   The streams are allocated.
+  @retval Others        Failed to configure the endpoint.
+
+**/
+EFI_STATUS
+XhcAllocateEndpointStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN UINT16               StreamCount
+  );
+
+/**
+  Free the streams of a bulk endpoint.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+  @param  Dci           The device context index of the endpoint.
+  @param  Reconfigure   Whether to configure the endpoint back to its transfer
+                        ring through XHCI's Configure_Endpoint cmd.
+
+  @retval EFI_SUCCESS   The streams are freed.
+  @retval Others        Failed to configure the endpoint. The streams are
+                        freed anyway.
+
+**/
+EFI_STATUS
+XhcFreeEndpointStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId,
+  IN UINT8                Dci,
+  IN BOOLEAN              Reconfigure
+  );
+
+/**
+  Abort the queued transfers and free the streams of a device, before its
+  endpoints are configured again or its slot is disabled.
+
+  @param  Xhc           The XHCI Instance.
+  @param  SlotId        The slot id of the device.
+
+**/
+VOID
+XhcFreeDeviceStreams (
+  IN USB_XHCI_INSTANCE    *Xhc,
+  IN UINT8                SlotId
+  );
+
 #endif
@@ -25,6 +25,14 @@ EFI_USB_IO_PROTOCOL mUsbIoProtocol = {
   UsbIoPortReset
 };
 
+EDKII_USB_IO_STREAMS_PROTOCOL mUsbIoStreamsProtocol = {
+  UsbIoAllocateStreams,
+  UsbIoFreeStreams,
+  UsbIoSubmitBulkTransfer,
+  UsbIoPollBulkTransfer,
+  UsbIoCancelBulkTransfer
+};
+
 EFI_DRIVER_BINDING_PROTOCOL mUsbBusDriverBinding = {
   UsbBusControllerDriverSupported,
   UsbBusControllerDriverStart,
@@ -888,6 +896,266 @@ ON_EXIT:
 }
 
 
+/**
+  Check that all the endpoints are bulk endpoints of the interface.
+
+  @param  UsbIf                  The USB interface.
+  @param  EndpointAddresses      The addresses of the endpoints.
+  @param  EndpointCount          The number of entries in EndpointAddresses.
+
+  @retval TRUE                   All the endpoints are bulk endpoints.
+  @retval FALSE                  An endpoint is not a bulk endpoint of the interface.
+
+**/
+BOOLEAN
+UsbIsBulkEndpoints (
+  IN USB_INTERFACE        *UsbIf,
+  IN UINT8                *EndpointAddresses,
+  IN UINTN                EndpointCount
+  )
+{
+  USB_ENDPOINT_DESC       *EpDesc;
+  UINTN                   Index;
+
+  for (Index = 0; Index < EndpointCount; Index++) {
+    if ((USB_ENDPOINT_ADDR (EndpointAddresses[Index]) == 0) ||
+        (USB_ENDPOINT_ADDR (EndpointAddresses[Index]) > 15)) {
+      return FALSE;
+    }
+
+    EpDesc = UsbGetEndpointDesc (UsbIf, EndpointAddresses[Index]);
+    if ((EpDesc == NULL) || (USB_ENDPOINT_TYPE (&EpDesc->Desc) != USB_ENDPOINT_BULK)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Allocate streams for bulk endpoints of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  EndpointAddresses      The addresses of the bulk endpoints.
+  @param  EndpointCount          The number of entries in EndpointAddresses.
+  @param  StreamCount            On input, the number of streams the device
+                                 supports on each endpoint. On output, the
+                                 number of streams allocated.
+
+  @retval EFI_SUCCESS            The streams are allocated.
+  @retval EFI_INVALID_PARAMETER  An endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to allocate the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoAllocateStreams (
+  IN     EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN     UINT8                          *EndpointAddresses,
+  IN     UINTN                          EndpointCount,
+  IN OUT UINT16                         *StreamCount
+  )
+{
+  USB_DEVICE              *Dev;
+  USB_INTERFACE           *UsbIf;
+  EFI_TPL                 OldTpl;
+  EFI_STATUS              Status;
+
+  if ((EndpointAddresses == NULL) || (EndpointCount == 0) || (StreamCount == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl  = gBS->RaiseTPL (USB_BUS_TPL);
+
+  UsbIf   = USB_INTERFACE_FROM_USBIO_STREAMS (This);
+  Dev     = UsbIf->Device;
+
+  if (!UsbIsBulkEndpoints (UsbIf, EndpointAddresses, EndpointCount)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  Status  = Dev->Bus->Usb2HcStreams->AllocateStreams (
+                                       Dev->Bus->Usb2HcStreams,
+                                       Dev->Address,
+                                       Dev->Speed,
+                                       EndpointAddresses,
+                                       EndpointCount,
+                                       StreamCount
+                                       );
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Free the streams of bulk endpoints of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  EndpointAddresses      The addresses of the bulk endpoints.
+  @param  EndpointCount          The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS            The streams are freed.
+  @retval EFI_INVALID_PARAMETER  An endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to free the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoFreeStreams (
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN UINT8                          *EndpointAddresses,
+  IN UINTN                          EndpointCount
+  )
+{
+  USB_DEVICE              *Dev;
+  USB_INTERFACE           *UsbIf;
+  EFI_TPL                 OldTpl;
+  EFI_STATUS              Status;
+
+  if ((EndpointAddresses == NULL) || (EndpointCount == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OldTpl  = gBS->RaiseTPL (USB_BUS_TPL);
+
+  UsbIf   = USB_INTERFACE_FROM_USBIO_STREAMS (This);
+  Dev     = UsbIf->Device;
+
+  if (!UsbIsBulkEndpoints (UsbIf, EndpointAddresses, EndpointCount)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  Status  = Dev->Bus->Usb2HcStreams->FreeStreams (
+                                       Dev->Bus->Usb2HcStreams,
+                                       Dev->Address,
+                                       EndpointAddresses,
+                                       EndpointCount
+                                       );
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Queue a bulk transfer on an endpoint of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  Endpoint               The bulk endpoint address.
+  @param  StreamId               The stream of the transfer, or 0.
+  @param  Data                   The data buffer.
+  @param  DataLength             The length of the data buffer.
+  @param  Transfer               Returns the handle of the queued transfer.
+
+  @retval EFI_SUCCESS            The transfer is queued.
+  @retval EFI_INVALID_PARAMETER  The endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to queue the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoSubmitBulkTransfer (
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  UINT8                          Endpoint,
+  IN  UINT16                         StreamId,
+  IN  VOID                           *Data,
+  IN  UINTN                          DataLength,
+  OUT VOID                           **Transfer
+  )
+{
+  USB_DEVICE              *Dev;
+  USB_INTERFACE           *UsbIf;
+  USB_ENDPOINT_DESC       *EpDesc;
+  EFI_TPL                 OldTpl;
+  EFI_STATUS              Status;
+
+  OldTpl  = gBS->RaiseTPL (USB_BUS_TPL);
+
+  UsbIf   = USB_INTERFACE_FROM_USBIO_STREAMS (This);
+  Dev     = UsbIf->Device;
+
+  if (!UsbIsBulkEndpoints (UsbIf, &Endpoint, 1)) {
+    Status = EFI_INVALID_PARAMETER;
+    goto ON_EXIT;
+  }
+
+  EpDesc  = UsbGetEndpointDesc (UsbIf, Endpoint);
+  Status  = Dev->Bus->Usb2HcStreams->SubmitBulkTransfer (
+                                       Dev->Bus->Usb2HcStreams,
+                                       Dev->Address,
+                                       Endpoint,
+                                       Dev->Speed,
+                                       EpDesc->Desc.MaxPacketSize,
+                                       StreamId,
+                                       Data,
+                                       DataLength,
+                                       &Dev->Translator,
+                                       Transfer
+                                       );
+
+ON_EXIT:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Check whether a queued bulk transfer is complete.
+
+  @param  This                   The USB IO streams instance.
+  @param  Transfer               The handle of the queued transfer.
+  @param  DataLength             Returns the number of bytes transferred.
+  @param  UsbStatus              Returns the result of the transfer.
+
+  @retval EFI_SUCCESS            The transfer completed successfully.
+  @retval EFI_NOT_READY          The transfer is still in progress.
+  @retval Others                 The transfer failed.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoPollBulkTransfer (
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  VOID                           *Transfer,
+  OUT UINTN                          *DataLength,
+  OUT UINT32                         *UsbStatus
+  )
+{
+  USB_INTERFACE           *UsbIf;
+  USB_BUS                 *Bus;
+
+  UsbIf = USB_INTERFACE_FROM_USBIO_STREAMS (This);
+  Bus   = UsbIf->Device->Bus;
+  return Bus->Usb2HcStreams->PollBulkTransfer (Bus->Usb2HcStreams, Transfer, DataLength, UsbStatus);
+}
+
+/**
+  Cancel a queued bulk transfer.
+
+  @param  This                   The USB IO streams instance.
+  @param  Transfer               The handle of the queued transfer.
+
+  @retval EFI_SUCCESS            The transfer is cancelled.
+  @retval Others                 Failed to cancel the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoCancelBulkTransfer (
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN VOID                           *Transfer
+  )
+{
+  USB_INTERFACE           *UsbIf;
+  USB_BUS                 *Bus;
+
+  UsbIf = USB_INTERFACE_FROM_USBIO_STREAMS (This);
+  Bus   = UsbIf->Device->Bus;
+  return Bus->Usb2HcStreams->CancelBulkTransfer (Bus->Usb2HcStreams, Transfer);
+}
+
 /**
   Install Usb Bus Protocol on host controller, and start the Usb bus.
 
@@ -982,6 +1250,21 @@ UsbBusBuildProtocol (
     if (UsbBus->Usb2Hc->MajorRevision == 0x3) {
       UsbBus->MaxDevices = 256;
     }
+
+    //
+    // The host controller may also queue bulk transfers on streams, which
+    // is produced to the USB interfaces as the USB IO streams protocol.
+    //
+    if (EFI_ERROR (gBS->OpenProtocol (
+                          Controller,
+                          &gEdkiiUsb2HcStreamsProtocolGuid,
+                          (VOID **) &UsbBus->Usb2HcStreams,
+                          This->DriverBindingHandle,
+                          Controller,
+                          EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                          ))) {
+      UsbBus->Usb2HcStreams = NULL;
+    }
   }
 
   //
@@ -16,6 +16,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Usb2HostController.h>
 #include <Protocol/UsbHostController.h>
 #include <Protocol/UsbIo.h>
+#include <Protocol/Usb2HcStreams.h>
+#include <Protocol/UsbIoStreams.h>
 #include <Protocol/DevicePath.h>
 
 #include <Library/BaseLib.h>
@@ -144,6 +146,9 @@ typedef struct _USB_HUB_API    USB_HUB_API;
 #define USB_INTERFACE_FROM_USBIO(a) \
           CR(a, USB_INTERFACE, UsbIo, USB_INTERFACE_SIGNATURE)
 
+#define USB_INTERFACE_FROM_USBIO_STREAMS(a) \
+          CR(a, USB_INTERFACE, UsbIoStreams, USB_INTERFACE_SIGNATURE)
+
 #define USB_BUS_FROM_THIS(a) \
           CR(a, USB_BUS, BusId, USB_BUS_SIGNATURE)
 
@@ -209,6 +214,7 @@ struct _USB_INTERFACE {
   //
   EFI_HANDLE                Handle;
   EFI_USB_IO_PROTOCOL       UsbIo;
+  EDKII_USB_IO_STREAMS_PROTOCOL UsbIoStreams;
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
   BOOLEAN                   IsManaged;
 
@@ -248,6 +254,7 @@ struct _USB_BUS {
   EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
   EFI_USB2_HC_PROTOCOL      *Usb2Hc;
   EFI_USB_HC_PROTOCOL       *UsbHc;
+  EDKII_USB2_HC_STREAMS_PROTOCOL *Usb2HcStreams;  // Optional
 
   //
   // Recorded the max supported usb devices.
@@ -657,6 +664,115 @@ UsbIoPortReset (
   IN EFI_USB_IO_PROTOCOL  *This
   );
 
+/**
+  Allocate streams for bulk endpoints of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  EndpointAddresses      The addresses of the bulk endpoints.
+  @param  EndpointCount          The number of entries in EndpointAddresses.
+  @param  StreamCount            On input, the number of streams the device
+                                 supports on each endpoint. On output, the
+                                 number of streams allocated.
+
+  @retval EFI_SUCCESS            The streams are allocated.
+  @retval EFI_INVALID_PARAMETER  An endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to allocate the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoAllocateStreams (
+  IN     EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN     UINT8                          *EndpointAddresses,
+  IN     UINTN                          EndpointCount,
+  IN OUT UINT16                         *StreamCount
+  );
+
+/**
+  Free the streams of bulk endpoints of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  EndpointAddresses      The addresses of the bulk endpoints.
+  @param  EndpointCount          The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS            The streams are freed.
+  @retval EFI_INVALID_PARAMETER  An endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to free the streams.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoFreeStreams (
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN UINT8                          *EndpointAddresses,
+  IN UINTN                          EndpointCount
+  );
+
+/**
+  Queue a bulk transfer on an endpoint of the USB interface.
+
+  @param  This                   The USB IO streams instance.
+  @param  Endpoint               The bulk endpoint address.
+  @param  StreamId               The stream of the transfer, or 0.
+  @param  Data                   The data buffer.
+  @param  DataLength             The length of the data buffer.
+  @param  Transfer               Returns the handle of the queued transfer.
+
+  @retval EFI_SUCCESS            The transfer is queued.
+  @retval EFI_INVALID_PARAMETER  The endpoint is not a bulk endpoint of the interface.
+  @retval Others                 Failed to queue the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoSubmitBulkTransfer (
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  UINT8                          Endpoint,
+  IN  UINT16                         StreamId,
+  IN  VOID                           *Data,
+  IN  UINTN                          DataLength,
+  OUT VOID                           **Transfer
+  );
+
+/**
+  Check whether a queued bulk transfer is complete.
+
+  @param  This                   The USB IO streams instance.
+  @param  Transfer               The handle of the queued transfer.
+  @param  DataLength             Returns the number of bytes transferred.
+  @param  UsbStatus              Returns the result of the transfer.
+
+  @retval EFI_SUCCESS            The transfer completed successfully.
+  @retval EFI_NOT_READY          The transfer is still in progress.
+  @retval Others                 The transfer failed.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoPollBulkTransfer (
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  VOID                           *Transfer,
+  OUT UINTN                          *DataLength,
+  OUT UINT32                         *UsbStatus
+  );
+
+/**
+  Cancel a queued bulk transfer.
+
+  @param  This                   The USB IO streams instance.
+  @param  Transfer               The handle of the queued transfer.
+
+  @retval EFI_SUCCESS            The transfer is cancelled.
+  @retval Others                 Failed to cancel the transfer.
+
+**/
+EFI_STATUS
+EFIAPI
+UsbIoCancelBulkTransfer (
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN VOID                           *Transfer
+  );
+
 /**
   Install Usb Bus Protocol on host controller, and start the Usb bus.
 
@@ -757,6 +873,7 @@ UsbBusControllerDriverStop (
   );
 
 extern EFI_USB_IO_PROTOCOL            mUsbIoProtocol;
+extern EDKII_USB_IO_STREAMS_PROTOCOL  mUsbIoStreamsProtocol;
 extern EFI_DRIVER_BINDING_PROTOCOL    mUsbBusDriverBinding;
 extern EFI_COMPONENT_NAME_PROTOCOL    mUsbBusComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL   mUsbBusComponentName2;
@@ -66,6 +66,13 @@ UsbFreeInterface (
                   NULL
                   );
   if (!EFI_ERROR (Status)) {
+    if (UsbIf->Device->Bus->Usb2HcStreams != NULL) {
+      gBS->UninstallProtocolInterface (
+             UsbIf->Handle,
+             &gEdkiiUsbIoStreamsProtocolGuid,
+             &UsbIf->UsbIoStreams
+             );
+    }
     if (UsbIf->DevicePath != NULL) {
       FreePool (UsbIf->DevicePath);
     }
@@ -116,6 +123,12 @@ UsbCreateInterface (
     sizeof (EFI_USB_IO_PROTOCOL)
     );
 
+  CopyMem (
+    &(UsbIf->UsbIoStreams),
+    &mUsbIoStreamsProtocol,
+    sizeof (EDKII_USB_IO_STREAMS_PROTOCOL)
+    );
+
   //
   // Install protocols for USBIO and device path
   //
@@ -152,12 +165,34 @@ UsbCreateInterface (
     goto ON_ERROR;
   }
 
+  //
+  // The USB IO streams protocol is only produced when the host controller
+  // can queue bulk transfers.
+  //
+  if (Device->Bus->Usb2HcStreams != NULL) {
+    Status = gBS->InstallProtocolInterface (
+                    &UsbIf->Handle,
+                    &gEdkiiUsbIoStreamsProtocolGuid,
+                    EFI_NATIVE_INTERFACE,
+                    &UsbIf->UsbIoStreams
+                    );
+  }
+
   //
   // Open USB Host Controller Protocol by Child
   //
-  Status = UsbOpenHostProtoByChild (Device->Bus, UsbIf->Handle);
+  if (!EFI_ERROR (Status)) {
+    Status = UsbOpenHostProtoByChild (Device->Bus, UsbIf->Handle);
+  }
 
   if (EFI_ERROR (Status)) {
+    if (Device->Bus->Usb2HcStreams != NULL) {
+      gBS->UninstallProtocolInterface (
+             UsbIf->Handle,
+             &gEdkiiUsbIoStreamsProtocolGuid,
+             &UsbIf->UsbIoStreams
+             );
+    }
     gBS->UninstallMultipleProtocolInterfaces (
            UsbIf->Handle,
            &gEfiDevicePathProtocolGuid,
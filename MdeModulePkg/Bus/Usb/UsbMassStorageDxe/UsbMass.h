@@ -15,6 +15,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <IndustryStandard/Scsi.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/UsbIo.h>
+#include <Protocol/UsbIoStreams.h>
 #include <Protocol/DevicePath.h>
 #include <Protocol/DiskInfo.h>
 #include <Library/BaseLib.h>
@@ -25,12 +26,26 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/PcdLib.h>
 
 typedef struct _USB_MASS_TRANSPORT USB_MASS_TRANSPORT;
 typedef struct _USB_MASS_DEVICE    USB_MASS_DEVICE;
 
+///
+/// A command of a batch passed to the ExecCommands() of a transport protocol.
+///
+typedef struct {
+  VOID                        *Cmd;
+  UINT8                       CmdLen;
+  EFI_USB_DATA_DIRECTION      DataDir;
+  VOID                        *Data;
+  UINT32                      DataLen;
+  UINT32                      CmdStatus;  ///< The result of the command execution
+} USB_MASS_COMMAND;
+
 #include "UsbMassBot.h"
 #include "UsbMassCbi.h"
+#include "UsbMassUas.h"
 #include "UsbMassBoot.h"
 #include "UsbMassDiskInfo.h"
 #include "UsbMassImpl.h"
@@ -150,10 +165,36 @@ EFI_STATUS
   IN  VOID                    *Context
   );
 
+/**
+  Execute several USB mass storage commands through the transport protocol,
+  letting the device work on them at the same time.
+
+  @param  Context               The instance of transport protocol.
+  @param  Commands              The commands to execute. Their CmdStatus is
+                                updated with the result of each command.
+  @param  Count                 The number of commands
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait for progress on the commands
+
+  @retval EFI_SUCCESS           The commands are executed.
+  @retval EFI_UNSUPPORTED       The device can't run commands at the same time.
+  @retval Other                 Failed to execute the commands.
+
+**/
+typedef
+EFI_STATUS
+(*USB_MASS_EXEC_COMMANDS) (
+  IN  VOID                    *Context,
+  IN  USB_MASS_COMMAND        *Commands,
+  IN  UINTN                   Count,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout
+  );
+
 ///
 /// This structure contains information necessary to select the
 /// proper transport protocol. The mass storage class defines
-/// two transport protocols. One is the CBI, and the other is BOT.
+/// three transport protocols: CBI, BOT and UAS.
 /// CBI is being obseleted. The design is made modular by this
 /// structure so that the CBI protocol can be easily removed when
 /// it is no longer necessary.
@@ -163,8 +204,9 @@ struct _USB_MASS_TRANSPORT {
   USB_MASS_INIT_TRANSPORT Init;        ///< Initialize the mass storage transport protocol
   USB_MASS_EXEC_COMMAND   ExecCommand; ///< Transport command to the device then get result
   USB_MASS_RESET          Reset;       ///< Reset the device
-  USB_MASS_GET_MAX_LUN    GetMaxLun;   ///< Get max lun, only for bot
+  USB_MASS_GET_MAX_LUN    GetMaxLun;   ///< Get max lun, only for bot and uas
   USB_MASS_CLEAN_UP       CleanUp;     ///< Clean up the resources.
+  USB_MASS_EXEC_COMMANDS  ExecCommands; ///< Execute commands at the same time, only for uas
 };
 
 struct _USB_MASS_DEVICE {
@@ -305,6 +305,76 @@ EXIT:
 }
 
 
+/**
+  Execute a batch of USB mass storage bootability commands.
+
+  If the transport can run commands at the same time, the batch is handed
+  to it at once. The commands that fail there, or all of them if the
+  transport can't, are executed one by one with retrial.
+
+  @param  UsbMass                The device to issue commands to
+  @param  Commands               The commands to execute
+  @param  Count                  The number of commands
+  @param  Timeout                The timeout used to transfer
+
+  @retval EFI_SUCCESS            All the commands are executed successfully.
+  @retval EFI_NO_MEDIA           The device media is removed.
+  @retval Others                 Command execution failed after retrial.
+
+**/
+EFI_STATUS
+UsbBootExecCmds (
+  IN USB_MASS_DEVICE          *UsbMass,
+  IN USB_MASS_COMMAND         *Commands,
+  IN UINTN                    Count,
+  IN UINT32                   Timeout
+  )
+{
+  USB_MASS_TRANSPORT          *Transport;
+  EFI_STATUS                  Status;
+  UINTN                       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Commands[Index].CmdStatus = USB_MASS_CMD_FAIL;
+  }
+
+  Transport = UsbMass->Transport;
+  if ((Transport->ExecCommands != NULL) && (Count > 1)) {
+    Status = Transport->ExecCommands (
+                          UsbMass->Context,
+                          Commands,
+                          Count,
+                          UsbMass->Lun,
+                          Timeout
+                          );
+    if (EFI_ERROR (Status) && (Status != EFI_UNSUPPORTED)) {
+      DEBUG ((EFI_D_ERROR, "UsbBootExecCmds: %r to Exec %d Cmds\n", Status, Count));
+    }
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    if (Commands[Index].CmdStatus == USB_MASS_CMD_SUCCESS) {
+      continue;
+    }
+
+    Status = UsbBootExecCmdWithRetry (
+               UsbMass,
+               Commands[Index].Cmd,
+               Commands[Index].CmdLen,
+               Commands[Index].DataDir,
+               Commands[Index].Data,
+               Commands[Index].DataLen,
+               Timeout
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Execute TEST UNIT READY command to check if the device is ready.
 
@@ -814,8 +884,10 @@ UsbBootReadWriteBlocks (
   IN OUT UINT8              *Buffer
   )
 {
-  USB_BOOT_READ_WRITE_10_CMD Cmd;
+  USB_BOOT_READ_WRITE_10_CMD Cmd[USB_BOOT_MAX_BATCH];
+  USB_MASS_COMMAND           Commands[USB_BOOT_MAX_BATCH];
   EFI_STATUS                 Status;
+  UINTN                      Batch;
   UINT32                     Count;
   UINT32                     CountMax;
   UINT32                     BlockSize;
@@ -826,51 +898,57 @@ UsbBootReadWriteBlocks (
   CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
   Status    = EFI_SUCCESS;
 
+  //
+  // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+  //
+  Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+
   while (TotalBlock > 0) {
     //
     // Split the total blocks into smaller pieces to ease the pressure
     // on the device. We must split the total block because the READ10
     // command only has 16 bit transfer length (in the unit of block).
+    // A transport that runs commands at the same time gets a batch of
+    // pieces at once.
     //
-    Count    = (UINT32)MIN (TotalBlock, CountMax);
-    Count    = MIN (MAX_UINT16, Count);
-    ByteSize = Count * BlockSize;
+    for (Batch = 0; (Batch < USB_BOOT_MAX_BATCH) && (TotalBlock > 0); Batch++) {
+      Count    = (UINT32)MIN (TotalBlock, CountMax);
+      Count    = MIN (MAX_UINT16, Count);
+      ByteSize = Count * BlockSize;
 
-    //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
-    //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+      //
+      // Fill in the command
+      //
+      ZeroMem (&Cmd[Batch], sizeof (USB_BOOT_READ_WRITE_10_CMD));
+
+      Cmd[Batch].OpCode = Write ? USB_BOOT_WRITE10_OPCODE : USB_BOOT_READ10_OPCODE;
+      Cmd[Batch].Lun    = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
+      WriteUnaligned32 ((UINT32 *) Cmd[Batch].Lba, SwapBytes32 (Lba));
+      WriteUnaligned16 ((UINT16 *) Cmd[Batch].TransferLen, SwapBytes16 ((UINT16)Count));
+
+      Commands[Batch].Cmd     = &Cmd[Batch];
+      Commands[Batch].CmdLen  = (UINT8) sizeof (USB_BOOT_READ_WRITE_10_CMD);
+      Commands[Batch].DataDir = Write ? EfiUsbDataOut : EfiUsbDataIn;
+      Commands[Batch].Data    = Buffer;
+      Commands[Batch].DataLen = ByteSize;
+
+      DEBUG ((
+        DEBUG_BLKIO, "UsbBoot%sBlocks: LBA (0x%lx), Blk (0x%x)\n",
+        Write ? L"Write" : L"Read",
+        Lba, Count
+        ));
+      Lba        += Count;
+      Buffer     += ByteSize;
+      TotalBlock -= Count;
+    }
 
     //
-    // Fill in the command then execute
+    // Execute the commands
     //
-    ZeroMem (&Cmd, sizeof (USB_BOOT_READ_WRITE_10_CMD));
-
-    Cmd.OpCode  = Write ? USB_BOOT_WRITE10_OPCODE : USB_BOOT_READ10_OPCODE;
-    Cmd.Lun     = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
-    WriteUnaligned32 ((UINT32 *) Cmd.Lba, SwapBytes32 (Lba));
-    WriteUnaligned16 ((UINT16 *) Cmd.TransferLen, SwapBytes16 ((UINT16)Count));
-
-    Status = UsbBootExecCmdWithRetry (
-               UsbMass,
-               &Cmd,
-               (UINT8) sizeof (USB_BOOT_READ_WRITE_10_CMD),
-               Write ? EfiUsbDataOut : EfiUsbDataIn,
-               Buffer,
-               ByteSize,
-               Timeout
-               );
+    Status = UsbBootExecCmds (UsbMass, Commands, Batch, Timeout);
     if (EFI_ERROR (Status)) {
       return Status;
     }
-    DEBUG ((
-      DEBUG_BLKIO, "UsbBoot%sBlocks: LBA (0x%lx), Blk (0x%x)\n",
-      Write ? L"Write" : L"Read",
-      Lba, Count
-      ));
-    Lba        += Count;
-    Buffer     += ByteSize;
-    TotalBlock -= Count;
   }
 
   return Status;
@@ -897,8 +975,10 @@ UsbBootReadWriteBlocks16 (
   IN OUT UINT8              *Buffer
   )
 {
-  UINT8                     Cmd[16];
+  UINT8                     Cmd[USB_BOOT_MAX_BATCH][16];
+  USB_MASS_COMMAND          Commands[USB_BOOT_MAX_BATCH];
   EFI_STATUS                Status;
+  UINTN                     Batch;
   UINT32                    Count;
   UINT32                    CountMax;
   UINT32                    BlockSize;
@@ -909,48 +989,53 @@ UsbBootReadWriteBlocks16 (
   CountMax  = USB_BOOT_MAX_CARRY_SIZE / BlockSize;
   Status    = EFI_SUCCESS;
 
+  //
+  // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+  //
+  Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces.
+    // Split the total blocks into smaller pieces, and hand a batch of
+    // pieces to the transport at once.
     //
-    Count    = (UINT32)MIN (TotalBlock, CountMax);
-    ByteSize = Count * BlockSize;
+    for (Batch = 0; (Batch < USB_BOOT_MAX_BATCH) && (TotalBlock > 0); Batch++) {
+      Count    = (UINT32)MIN (TotalBlock, CountMax);
+      ByteSize = Count * BlockSize;
 
-    //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
-    //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+      //
+      // Fill in the command
+      //
+      ZeroMem (Cmd[Batch], sizeof (Cmd[Batch]));
+
+      Cmd[Batch][0] = Write ? EFI_SCSI_OP_WRITE16 : EFI_SCSI_OP_READ16;
+      Cmd[Batch][1] = (UINT8) ((USB_BOOT_LUN (UsbMass->Lun) & 0xE0));
+      WriteUnaligned64 ((UINT64 *) &Cmd[Batch][2], SwapBytes64 (Lba));
+      WriteUnaligned32 ((UINT32 *) &Cmd[Batch][10], SwapBytes32 (Count));
+
+      Commands[Batch].Cmd     = Cmd[Batch];
+      Commands[Batch].CmdLen  = (UINT8) sizeof (Cmd[Batch]);
+      Commands[Batch].DataDir = Write ? EfiUsbDataOut : EfiUsbDataIn;
+      Commands[Batch].Data    = Buffer;
+      Commands[Batch].DataLen = ByteSize;
+
+      DEBUG ((
+        DEBUG_BLKIO, "UsbBoot%sBlocks16: LBA (0x%lx), Blk (0x%x)\n",
+        Write ? L"Write" : L"Read",
+        Lba, Count
+        ));
+      Lba        += Count;
+      Buffer     += ByteSize;
+      TotalBlock -= Count;
+    }
 
     //
-    // Fill in the command then execute
+    // Execute the commands
     //
-    ZeroMem (Cmd, sizeof (Cmd));
-
-    Cmd[0]  = Write ? EFI_SCSI_OP_WRITE16 : EFI_SCSI_OP_READ16;
-    Cmd[1]  = (UINT8) ((USB_BOOT_LUN (UsbMass->Lun) & 0xE0));
-    WriteUnaligned64 ((UINT64 *) &Cmd[2], SwapBytes64 (Lba));
-    WriteUnaligned32 ((UINT32 *) &Cmd[10], SwapBytes32 (Count));
-
-    Status = UsbBootExecCmdWithRetry (
-               UsbMass,
-               Cmd,
-               (UINT8) sizeof (Cmd),
-               Write ? EfiUsbDataOut : EfiUsbDataIn,
-               Buffer,
-               ByteSize,
-               Timeout
-               );
+    Status = UsbBootExecCmds (UsbMass, Commands, Batch, Timeout);
     if (EFI_ERROR (Status)) {
       return Status;
     }
-    DEBUG ((
-      DEBUG_BLKIO, "UsbBoot%sBlocks16: LBA (0x%lx), Blk (0x%x)\n",
-      Write ? L"Write" : L"Read",
-      Lba, Count
-      ));
-    Lba        += Count;
-    Buffer     += ByteSize;
-    TotalBlock -= Count;
   }
 
   return Status;
@@ -996,3 +1081,50 @@ UsbClearEndpointStall (
 
   return Status;
 }
+
+/**
+  Find the USB IO streams protocol installed next to a USB I/O protocol.
+
+  @param  UsbIo                 The USB I/O Protocol instance
+
+  @return The USB IO streams protocol of the interface, or NULL.
+
+**/
+EDKII_USB_IO_STREAMS_PROTOCOL *
+UsbGetStreamsProtocol (
+  IN EFI_USB_IO_PROTOCOL        *UsbIo
+  )
+{
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  EFI_USB_IO_PROTOCOL           *HandleUsbIo;
+  EFI_HANDLE                    *Handles;
+  UINTN                         HandleCount;
+  UINTN                         Index;
+  EFI_STATUS                    Status;
+
+  UsbIoStreams = NULL;
+  Status       = gBS->LocateHandleBuffer (
+                        ByProtocol,
+                        &gEdkiiUsbIoStreamsProtocolGuid,
+                        NULL,
+                        &HandleCount,
+                        &Handles
+                        );
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiUsbIoProtocolGuid, (VOID **) &HandleUsbIo);
+    if (!EFI_ERROR (Status) && (HandleUsbIo == UsbIo)) {
+      Status = gBS->HandleProtocol (Handles[Index], &gEdkiiUsbIoStreamsProtocolGuid, (VOID **) &UsbIoStreams);
+      if (EFI_ERROR (Status)) {
+        UsbIoStreams = NULL;
+      }
+      break;
+    }
+  }
+
+  FreePool (Handles);
+  return UsbIoStreams;
+}
@@ -63,6 +63,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 //
 #define USB_BOOT_MAX_CARRY_SIZE         SIZE_64KB
 
+//
+// The number of READ/WRITE commands handed to the transport at once, when the
+// transport can run commands at the same time.
+//
+#define USB_BOOT_MAX_BATCH              16
+
 //
 // Retry mass command times, set by experience
 //
@@ -334,5 +340,18 @@ UsbClearEndpointStall (
   IN UINT8                  EndpointAddr
   );
 
+/**
+  Find the USB IO streams protocol installed next to a USB I/O protocol.
+
+  @param  UsbIo                 The USB I/O Protocol instance
+
+  @return The USB IO streams protocol of the interface, or NULL.
+
+**/
+EDKII_USB_IO_STREAMS_PROTOCOL *
+UsbGetStreamsProtocol (
+  IN EFI_USB_IO_PROTOCOL        *UsbIo
+  );
+
 #endif
 
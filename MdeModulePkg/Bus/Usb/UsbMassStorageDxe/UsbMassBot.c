@@ -18,7 +18,8 @@ USB_MASS_TRANSPORT mUsbBotTransport = {
   UsbBotExecCommand,
   UsbBotResetDevice,
   UsbBotGetMaxLun,
-  UsbBotCleanUp
+  UsbBotCleanUp,
+  UsbBotExecCommands
 };
 
 /**
@@ -112,6 +113,9 @@ UsbBotInit (
   UsbBot->CbwTag = 0x01;
 
   if (Context != NULL) {
+    if (FeaturePcdGet (PcdUsbBulkTransferQueueEnable)) {
+      UsbBot->UsbIoStreams = UsbGetStreamsProtocol (UsbIo);
+    }
     *Context = UsbBot;
   } else {
     FreePool (UsbBot);
@@ -445,6 +449,196 @@ UsbBotExecCommand (
 }
 
 
+/**
+  Execute several commands through the USB Mass Storage Class BOT protocol.
+
+  The command, data and status phases of each command are queued on the
+  bulk endpoints together, so that the host controller moves from one phase
+  to the next without waiting for the driver. BOT doesn't allow a CBW to be
+  sent before the CSW of the previous command, so only one command is in
+  flight at a time.
+
+  @param  Context               The context of the BOT protocol, that is,
+                                USB_BOT_PROTOCOL
+  @param  Commands              The commands to execute. Their CmdStatus is
+                                updated with the result of each command.
+  @param  Count                 The number of commands
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait for progress on the commands
+
+  @retval EFI_SUCCESS           The commands are executed.
+  @retval EFI_UNSUPPORTED       The host controller can't queue transfers, or
+                                PcdUsbBulkTransferQueueEnable is not set.
+  @retval Other                 Failed to execute the commands. The device
+                                is reset.
+
+**/
+EFI_STATUS
+UsbBotExecCommands (
+  IN  VOID                    *Context,
+  IN  USB_MASS_COMMAND        *Commands,
+  IN  UINTN                   Count,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout
+  )
+{
+  USB_BOT_PROTOCOL              *UsbBot;
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  USB_MASS_COMMAND              *Command;
+  USB_BOT_CBW                   Cbw;
+  USB_BOT_CSW                   Csw;
+  VOID                          *Transfers[3];
+  UINT8                         Endpoint;
+  UINTN                         Index;
+  UINTN                         Phase;
+  UINT32                        Idle;
+  UINTN                         Length;
+  UINT32                        Result;
+  EFI_STATUS                    Status;
+
+  UsbBot       = (USB_BOT_PROTOCOL *) Context;
+  UsbIoStreams = UsbBot->UsbIoStreams;
+
+  if (UsbIoStreams == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  ZeroMem (Transfers, sizeof (Transfers));
+
+  for (Index = 0; Index < Count; Index++) {
+    Command = &Commands[Index];
+    ASSERT ((Command->CmdLen > 0) && (Command->CmdLen <= USB_BOT_MAX_CMDLEN));
+
+    Cbw.Signature = USB_BOT_CBW_SIGNATURE;
+    Cbw.Tag       = UsbBot->CbwTag++;
+    Cbw.DataLen   = Command->DataLen;
+    Cbw.Flag      = (UINT8) ((Command->DataDir == EfiUsbDataIn) ? BIT7 : 0);
+    Cbw.Lun       = Lun;
+    Cbw.CmdLen    = Command->CmdLen;
+
+    ZeroMem (Cbw.CmdBlock, USB_BOT_MAX_CMDLEN);
+    CopyMem (Cbw.CmdBlock, Command->Cmd, Command->CmdLen);
+    ZeroMem (&Csw, sizeof (USB_BOT_CSW));
+
+    //
+    // Queue the three phases. The data and the CSW of a Data-In command
+    // follow each other on the bulk-in endpoint.
+    //
+    Status = UsbIoStreams->SubmitBulkTransfer (
+                             UsbIoStreams,
+                             UsbBot->BulkOutEndpoint->EndpointAddress,
+                             0,
+                             &Cbw,
+                             sizeof (USB_BOT_CBW),
+                             &Transfers[0]
+                             );
+    if (EFI_ERROR (Status)) {
+      Transfers[0] = NULL;
+      goto ON_ERROR;
+    }
+
+    if ((Command->DataDir != EfiUsbNoData) && (Command->DataLen != 0)) {
+      if (Command->DataDir == EfiUsbDataIn) {
+        Endpoint = UsbBot->BulkInEndpoint->EndpointAddress;
+      } else {
+        Endpoint = UsbBot->BulkOutEndpoint->EndpointAddress;
+      }
+
+      Status = UsbIoStreams->SubmitBulkTransfer (
+                               UsbIoStreams,
+                               Endpoint,
+                               0,
+                               Command->Data,
+                               Command->DataLen,
+                               &Transfers[1]
+                               );
+      if (EFI_ERROR (Status)) {
+        Transfers[1] = NULL;
+        goto ON_ERROR;
+      }
+    }
+
+    Status = UsbIoStreams->SubmitBulkTransfer (
+                             UsbIoStreams,
+                             UsbBot->BulkInEndpoint->EndpointAddress,
+                             0,
+                             &Csw,
+                             sizeof (USB_BOT_CSW),
+                             &Transfers[2]
+                             );
+    if (EFI_ERROR (Status)) {
+      Transfers[2] = NULL;
+      goto ON_ERROR;
+    }
+
+    //
+    // Wait for the phases in order. The time out applies to each phase.
+    //
+    Idle  = 0;
+    Phase = 0;
+    while (Phase < ARRAY_SIZE (Transfers)) {
+      if (Transfers[Phase] == NULL) {
+        Phase++;
+        continue;
+      }
+
+      Status = UsbIoStreams->PollBulkTransfer (UsbIoStreams, Transfers[Phase], &Length, &Result);
+      if (Status == EFI_NOT_READY) {
+        if (Idle >= Timeout) {
+          Status = EFI_TIMEOUT;
+          goto ON_ERROR;
+        }
+        gBS->Stall (USB_BOT_POLL_INTERVAL);
+        Idle += USB_BOT_POLL_INTERVAL;
+        continue;
+      }
+
+      Transfers[Phase] = NULL;
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "UsbBotExecCommands: phase %d (%r) result 0x%x\n", Phase, Status, Result));
+        goto ON_ERROR;
+      }
+
+      Idle = 0;
+      Phase++;
+    }
+
+    //
+    // A phase error or an invalid CSW needs reset recovery. A failed command
+    // is left to the caller, which retries it and gets its sense data.
+    //
+    if ((Csw.Signature != USB_BOT_CSW_SIGNATURE) || (Csw.Tag != Cbw.Tag) ||
+        (Csw.CmdStatus == USB_BOT_COMMAND_ERROR)) {
+      DEBUG ((EFI_D_ERROR, "UsbBotExecCommands: invalid CSW, status 0x%x\n", Csw.CmdStatus));
+      Status = EFI_DEVICE_ERROR;
+      goto ON_ERROR;
+    }
+
+    if (Csw.CmdStatus == USB_BOT_COMMAND_OK) {
+      Command->CmdStatus = USB_MASS_CMD_SUCCESS;
+    } else {
+      Command->CmdStatus = USB_MASS_CMD_FAIL;
+    }
+  }
+
+  return EFI_SUCCESS;
+
+ON_ERROR:
+  for (Phase = 0; Phase < ARRAY_SIZE (Transfers); Phase++) {
+    if (Transfers[Phase] != NULL) {
+      UsbIoStreams->CancelBulkTransfer (UsbIoStreams, Transfers[Phase]);
+    }
+  }
+
+  //
+  // Reset recovery leaves the device waiting for a CBW, so that the caller
+  // can execute the commands one at a time.
+  //
+  UsbBotResetDevice (UsbBot, FALSE);
+  return Status;
+}
+
+
 /**
   Reset the USB mass storage device by BOT protocol.
 
@@ -47,6 +47,11 @@ extern USB_MASS_TRANSPORT mUsbBotTransport;
 #define USB_BOT_RECV_CSW_TIMEOUT     (3 * USB_MASS_1_SECOND)
 #define USB_BOT_RESET_DEVICE_TIMEOUT (3 * USB_MASS_1_SECOND)
 
+//
+// The interval, in microseconds, at which the queued transfers are polled
+//
+#define USB_BOT_POLL_INTERVAL        10
+
 #pragma pack(1)
 ///
 /// The CBW (Command Block Wrapper) structures used by the USB BOT protocol.
@@ -81,6 +86,7 @@ typedef struct {
   EFI_USB_ENDPOINT_DESCRIPTOR   *BulkOutEndpoint;
   UINT32                        CbwTag;
   EFI_USB_IO_PROTOCOL           *UsbIo;
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;  ///< NULL if the host controller can't queue transfers
 } USB_BOT_PROTOCOL;
 
 /**
@@ -136,6 +142,38 @@ UsbBotExecCommand (
   OUT UINT32                  *CmdStatus
   );
 
+/**
+  Execute several commands through the USB Mass Storage Class BOT protocol.
+
+  The command, data and status phases of each command are queued on the
+  bulk endpoints together, so that the host controller moves from one phase
+  to the next without waiting for the driver. BOT doesn't allow a CBW to be
+  sent before the CSW of the previous command, so only one command is in
+  flight at a time.
+
+  @param  Context               The context of the BOT protocol, that is,
+                                USB_BOT_PROTOCOL
+  @param  Commands              The commands to execute. Their CmdStatus is
+                                updated with the result of each command.
+  @param  Count                 The number of commands
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait for progress on the commands
+
+  @retval EFI_SUCCESS           The commands are executed.
+  @retval EFI_UNSUPPORTED       The host controller can't queue transfers.
+  @retval Other                 Failed to execute the commands. The device
+                                is reset.
+
+**/
+EFI_STATUS
+UsbBotExecCommands (
+  IN  VOID                    *Context,
+  IN  USB_MASS_COMMAND        *Commands,
+  IN  UINTN                   Count,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout
+  );
+
 /**
   Reset the USB mass storage device by BOT protocol.
 
@@ -20,7 +20,8 @@ USB_MASS_TRANSPORT mUsbCbi0Transport = {
   UsbCbiExecCommand,
   UsbCbiResetDevice,
   NULL,
-  UsbCbiCleanUp
+  UsbCbiCleanUp,
+  NULL
 };
 
 //
@@ -32,7 +33,8 @@ USB_MASS_TRANSPORT mUsbCbi1Transport = {
   UsbCbiExecCommand,
   UsbCbiResetDevice,
   NULL,
-  UsbCbiCleanUp
+  UsbCbiCleanUp,
+  NULL
 };
 
 /**
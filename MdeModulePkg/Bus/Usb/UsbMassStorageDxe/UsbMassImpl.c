@@ -8,7 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "UsbMass.h"
 
-#define USB_MASS_TRANSPORT_COUNT    3
+#define USB_MASS_TRANSPORT_COUNT    4
 //
 // Array of USB transport interfaces.
 //
@@ -16,6 +16,7 @@ USB_MASS_TRANSPORT *mUsbMassTransport[USB_MASS_TRANSPORT_COUNT] = {
   &mUsbCbi0Transport,
   &mUsbCbi1Transport,
   &mUsbBotTransport,
+  &mUsbUasTransport,
 };
 
 EFI_DRIVER_BINDING_PROTOCOL gUSBMassDriverBinding = {
@@ -417,13 +418,24 @@ UsbMassInitTransport (
 
   Status = EFI_UNSUPPORTED;
 
+  //
+  // A UAS device uses Bulk-Only Transport on the default setting of its
+  // interface. Switch it to the UAS alternate setting if it has one, and
+  // keep Bulk-Only Transport if UAS can't be set up.
+  //
+  if (FeaturePcdGet (PcdUsbMassStorageUasEnable) &&
+      (Interface.InterfaceProtocol == USB_MASS_STORE_BOT)) {
+    *Transport = &mUsbUasTransport;
+    Status     = mUsbUasTransport.Init (UsbIo, Context);
+  }
+
   //
   // Traverse the USB_MASS_TRANSPORT arrary and try to find the
   // matching transport protocol.
   // If not found, return EFI_UNSUPPORTED.
   // If found, execute USB_MASS_TRANSPORT.Init() to initialize the transport context.
   //
-  for (Index = 0; Index < USB_MASS_TRANSPORT_COUNT; Index++) {
+  for (Index = 0; EFI_ERROR (Status) && (Index < USB_MASS_TRANSPORT_COUNT); Index++) {
     *Transport = mUsbMassTransport[Index];
 
     if (Interface.InterfaceProtocol == (*Transport)->Protocol) {
@@ -437,11 +449,11 @@ UsbMassInitTransport (
   }
 
   //
-  // For BOT device, try to get its max LUN.
+  // For BOT and UAS device, try to get its max LUN.
   // If max LUN is 0, then it is a non-lun device.
   // Otherwise, it is a multi-lun device.
   //
-  if ((*Transport)->Protocol == USB_MASS_STORE_BOT) {
+  if ((*Transport)->GetMaxLun != NULL) {
     (*Transport)->GetMaxLun (*Context, MaxLun);
   }
 
@@ -742,6 +754,11 @@ USBMassDriverBindingSupported (
     goto ON_EXIT;
   }
 
+  if (!FeaturePcdGet (PcdUsbMassStorageUasEnable) &&
+      (Interface.InterfaceProtocol == USB_MASS_STORE_UAS)) {
+    goto ON_EXIT;
+  }
+
   //
   // Traverse the USB_MASS_TRANSPORT arrary and try to find the
   // matching transport method.
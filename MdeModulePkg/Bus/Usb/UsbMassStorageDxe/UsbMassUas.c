@@ -0,0 +1,1202 @@
+/** @file
+  Implementation of the USB mass storage USB Attached SCSI transport protocol,
+  according to USB Mass Storage Class USB Attached SCSI Protocol, Revision 1.0.
+
+  A SuperSpeed device moves the data and status of each command on the stream
+  of the command's tag, so several commands can be in flight at the same time.
+  A high-speed device has no streams, and announces the data phase of the
+  command with a Read Ready or Write Ready IU on the status pipe.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "UsbMass.h"
+
+//
+// Definition of USB UAS Transport Protocol
+//
+USB_MASS_TRANSPORT mUsbUasTransport = {
+  USB_MASS_STORE_UAS,
+  UsbUasInit,
+  UsbUasExecCommand,
+  UsbUasResetDevice,
+  UsbUasGetMaxLun,
+  UsbUasCleanUp,
+  UsbUasExecCommands
+};
+
+/**
+  Find the UAS setting of the interface and its pipes from the class specific
+  descriptors of the active configuration.
+
+  If the active setting is a UAS setting, it is used. Otherwise the first
+  alternate setting with the UAS protocol is used, and its descriptor is
+  saved in UsbUas->Interface.
+
+  @param  UsbUas                The USB UAS device
+  @param  SuperSpeed            Returns whether the endpoints have SuperSpeed
+                                Endpoint Companion descriptors.
+
+  @retval EFI_SUCCESS           The pipes are found.
+  @retval EFI_UNSUPPORTED       The interface doesn't have a UAS setting with
+                                the four UAS pipes.
+  @retval Others                Failed to read the configuration descriptor.
+
+**/
+EFI_STATUS
+UsbUasGetPipes (
+  IN  USB_UAS_PROTOCOL          *UsbUas,
+  OUT BOOLEAN                   *SuperSpeed
+  )
+{
+  EFI_USB_IO_PROTOCOL           *UsbIo;
+  EFI_USB_DEVICE_DESCRIPTOR     DevDesc;
+  EFI_USB_CONFIG_DESCRIPTOR     ConfigDesc;
+  EFI_USB_INTERFACE_DESCRIPTOR  *IfDesc;
+  EFI_USB_DEVICE_REQUEST        Request;
+  UINT8                         *Config;
+  UINT8                         ConfigIndex;
+  UINTN                         Offset;
+  UINT8                         Length;
+  UINT8                         EndpointAddress;
+  UINT8                         StreamsExp;
+  UINT8                         MinStreamsExp;
+  BOOLEAN                       InInterface;
+  BOOLEAN                       ActiveIsUas;
+  BOOLEAN                       SettingFound;
+  UINT32                        Result;
+  EFI_STATUS                    Status;
+
+  UsbIo       = UsbUas->UsbIo;
+  *SuperSpeed = FALSE;
+
+  Status = UsbIo->UsbGetDeviceDescriptor (UsbIo, &DevDesc);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = UsbIo->UsbGetConfigDescriptor (UsbIo, &ConfigDesc);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Config = AllocatePool (ConfigDesc.TotalLength);
+  if (Config == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // The USB I/O protocol only returns the standard descriptors, so read the
+  // whole active configuration from the device.
+  //
+  Status = EFI_NOT_FOUND;
+  for (ConfigIndex = 0; ConfigIndex < DevDesc.NumConfigurations; ConfigIndex++) {
+    Request.RequestType = USB_DEV_GET_DESCRIPTOR_REQ_TYPE;
+    Request.Request     = USB_REQ_GET_DESCRIPTOR;
+    Request.Value       = (UINT16) ((USB_DESC_TYPE_CONFIG << 8) | ConfigIndex);
+    Request.Index       = 0;
+    Request.Length      = ConfigDesc.TotalLength;
+
+    Status = UsbIo->UsbControlTransfer (
+                      UsbIo,
+                      &Request,
+                      EfiUsbDataIn,
+                      USB_UAS_DESCRIPTOR_TIMEOUT / USB_MASS_1_MILLISECOND,
+                      Config,
+                      ConfigDesc.TotalLength,
+                      &Result
+                      );
+    if (!EFI_ERROR (Status) &&
+        (((EFI_USB_CONFIG_DESCRIPTOR *) Config)->ConfigurationValue == ConfigDesc.ConfigurationValue)) {
+      break;
+    }
+    Status = EFI_NOT_FOUND;
+  }
+
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  InInterface     = FALSE;
+  EndpointAddress = 0;
+  MinStreamsExp   = 0;
+  ActiveIsUas     = (BOOLEAN) (UsbUas->Interface.InterfaceProtocol == USB_MASS_STORE_UAS);
+  SettingFound    = FALSE;
+
+  for (Offset = 0; Offset + 2 <= ConfigDesc.TotalLength; Offset += Length) {
+    Length = Config[Offset];
+    if ((Length < 2) || (Offset + Length > ConfigDesc.TotalLength)) {
+      break;
+    }
+
+    switch (Config[Offset + 1]) {
+    case USB_DESC_TYPE_INTERFACE:
+      IfDesc          = (EFI_USB_INTERFACE_DESCRIPTOR *) &Config[Offset];
+      InInterface     = (BOOLEAN) (!SettingFound &&
+                                   (Length >= sizeof (EFI_USB_INTERFACE_DESCRIPTOR)) &&
+                                   (IfDesc->InterfaceNumber == UsbUas->Interface.InterfaceNumber) &&
+                                   (IfDesc->InterfaceClass == USB_MASS_STORE_CLASS) &&
+                                   (IfDesc->InterfaceProtocol == USB_MASS_STORE_UAS) &&
+                                   (!ActiveIsUas || (IfDesc->AlternateSetting == UsbUas->Interface.AlternateSetting)));
+      if (InInterface) {
+        CopyMem (&UsbUas->Interface, IfDesc, sizeof (EFI_USB_INTERFACE_DESCRIPTOR));
+        SettingFound = TRUE;
+      }
+      EndpointAddress = 0;
+      break;
+
+    case USB_DESC_TYPE_ENDPOINT:
+      if (InInterface && (Length >= sizeof (EFI_USB_ENDPOINT_DESCRIPTOR))) {
+        EndpointAddress = ((EFI_USB_ENDPOINT_DESCRIPTOR *) &Config[Offset])->EndpointAddress;
+      }
+      break;
+
+    case USB_UAS_DESC_TYPE_SS_COMPANION:
+      if (InInterface && (EndpointAddress != 0) && (Length >= 6)) {
+        //
+        // Bits 0~4 of bmAttributes hold the streams of a bulk endpoint as a
+        // power of two. The command pipe has no streams.
+        //
+        *SuperSpeed = TRUE;
+        StreamsExp  = (UINT8) (Config[Offset + 3] & 0x1F);
+        if ((StreamsExp != 0) && ((MinStreamsExp == 0) || (StreamsExp < MinStreamsExp))) {
+          MinStreamsExp = StreamsExp;
+        }
+      }
+      break;
+
+    case USB_UAS_DESC_TYPE_PIPE_USAGE:
+      if (InInterface && (EndpointAddress != 0) && (Length >= 4)) {
+        switch (Config[Offset + 2]) {
+        case USB_UAS_PIPE_COMMAND:
+          UsbUas->CommandPipe = EndpointAddress;
+          break;
+        case USB_UAS_PIPE_STATUS:
+          UsbUas->StatusPipe  = EndpointAddress;
+          break;
+        case USB_UAS_PIPE_DATA_IN:
+          UsbUas->DataInPipe  = EndpointAddress;
+          break;
+        case USB_UAS_PIPE_DATA_OUT:
+          UsbUas->DataOutPipe = EndpointAddress;
+          break;
+        default:
+          break;
+        }
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  if (MinStreamsExp != 0) {
+    UsbUas->MaxStreams = (UINT16) MIN (1 << MinStreamsExp, MAX_UINT16);
+  }
+
+  if ((UsbUas->CommandPipe == 0) || (UsbUas->StatusPipe == 0) ||
+      (UsbUas->DataInPipe == 0) || (UsbUas->DataOutPipe == 0) ||
+      USB_IS_IN_ENDPOINT (UsbUas->CommandPipe) || USB_IS_OUT_ENDPOINT (UsbUas->StatusPipe) ||
+      USB_IS_OUT_ENDPOINT (UsbUas->DataInPipe) || USB_IS_IN_ENDPOINT (UsbUas->DataOutPipe)) {
+    Status = EFI_UNSUPPORTED;
+  }
+
+ON_EXIT:
+  FreePool (Config);
+  return Status;
+}
+
+/**
+  Allocate the streams of the status and data pipes.
+
+  @param  UsbUas                The USB UAS device
+
+  @retval EFI_SUCCESS           The streams are allocated.
+  @retval Others                Failed to allocate the streams.
+
+**/
+EFI_STATUS
+UsbUasAllocateStreams (
+  IN USB_UAS_PROTOCOL         *UsbUas
+  )
+{
+  UINT8                       Pipes[3];
+  UINT16                      StreamCount;
+  EFI_STATUS                  Status;
+
+  Pipes[0]    = UsbUas->StatusPipe;
+  Pipes[1]    = UsbUas->DataInPipe;
+  Pipes[2]    = UsbUas->DataOutPipe;
+  StreamCount = (UINT16) MIN (UsbUas->MaxStreams, USB_UAS_MAX_STREAMS);
+
+  Status = UsbUas->UsbIoStreams->AllocateStreams (
+                                   UsbUas->UsbIoStreams,
+                                   Pipes,
+                                   ARRAY_SIZE (Pipes),
+                                   &StreamCount
+                                   );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "UsbUasAllocateStreams: (%r)\n", Status));
+    UsbUas->StreamCount = 0;
+    return Status;
+  }
+
+  UsbUas->StreamCount = StreamCount;
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the streams of the status and data pipes.
+
+  @param  UsbUas                The USB UAS device
+
+**/
+VOID
+UsbUasFreeStreams (
+  IN USB_UAS_PROTOCOL         *UsbUas
+  )
+{
+  UINT8                       Pipes[3];
+
+  if (UsbUas->StreamCount == 0) {
+    return;
+  }
+
+  Pipes[0] = UsbUas->StatusPipe;
+  Pipes[1] = UsbUas->DataInPipe;
+  Pipes[2] = UsbUas->DataOutPipe;
+
+  UsbUas->UsbIoStreams->FreeStreams (UsbUas->UsbIoStreams, Pipes, ARRAY_SIZE (Pipes));
+  UsbUas->StreamCount = 0;
+}
+
+/**
+  Select an alternate setting of the UAS interface.
+
+  The USB bus driver follows the request, so the USB I/O protocol reports the
+  descriptors of the new setting afterwards.
+
+  @param  UsbUas                The USB UAS device
+  @param  AlternateSetting      The alternate setting to select
+
+  @retval EFI_SUCCESS           The alternate setting is selected.
+  @retval Others                Failed to select the alternate setting.
+
+**/
+EFI_STATUS
+UsbUasSelectSetting (
+  IN USB_UAS_PROTOCOL         *UsbUas,
+  IN UINT8                    AlternateSetting
+  )
+{
+  EFI_USB_DEVICE_REQUEST      Request;
+  UINT32                      Result;
+  EFI_STATUS                  Status;
+
+  Request.RequestType = USB_DEV_SET_INTERFACE_REQ_TYPE;
+  Request.Request     = USB_REQ_SET_INTERFACE;
+  Request.Value       = AlternateSetting;
+  Request.Index       = UsbUas->Interface.InterfaceNumber;
+  Request.Length      = 0;
+
+  Status = UsbUas->UsbIo->UsbControlTransfer (
+                            UsbUas->UsbIo,
+                            &Request,
+                            EfiUsbNoData,
+                            USB_UAS_DESCRIPTOR_TIMEOUT / USB_MASS_1_MILLISECOND,
+                            NULL,
+                            0,
+                            &Result
+                            );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "UsbUasSelectSetting: Setting %d (%r)\n", AlternateSetting, Status));
+  }
+
+  return Status;
+}
+
+/**
+  Initializes USB UAS protocol.
+
+  This function initializes the USB mass storage class UAS protocol.
+  It will save its context which is a USB_UAS_PROTOCOL structure
+  in the Context if Context isn't NULL.
+
+  A UAS device reports Bulk-Only Transport on the default setting of its
+  interface and offers UAS on an alternate setting. If Context isn't NULL,
+  that alternate setting is selected, and the previous setting is selected
+  again by UsbUasCleanUp().
+
+  @param  UsbIo                 The USB I/O Protocol instance
+  @param  Context               The buffer to save the context to
+
+  @retval EFI_SUCCESS           The device is successfully initialized.
+  @retval EFI_UNSUPPORTED       The transport protocol doesn't support the device.
+  @retval Other                 The USB UAS initialization fails.
+
+**/
+EFI_STATUS
+UsbUasInit (
+  IN  EFI_USB_IO_PROTOCOL       *UsbIo,
+  OUT VOID                      **Context OPTIONAL
+  )
+{
+  USB_UAS_PROTOCOL              *UsbUas;
+  BOOLEAN                       SuperSpeed;
+  EFI_STATUS                    Status;
+
+  UsbUas = AllocateZeroPool (sizeof (USB_UAS_PROTOCOL));
+  if (UsbUas == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  UsbUas->UsbIo = UsbIo;
+
+  //
+  // Get the interface descriptor and validate that it
+  // is a USB Mass Storage UAS interface.
+  //
+  Status = UsbIo->UsbGetInterfaceDescriptor (UsbIo, &UsbUas->Interface);
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  if ((UsbUas->Interface.InterfaceProtocol != USB_MASS_STORE_UAS) &&
+      (UsbUas->Interface.InterfaceProtocol != USB_MASS_STORE_BOT)) {
+    Status = EFI_UNSUPPORTED;
+    goto ON_ERROR;
+  }
+
+  UsbUas->DefaultSetting = UsbUas->Interface.AlternateSetting;
+
+  Status = UsbUasGetPipes (UsbUas, &SuperSpeed);
+  if (EFI_ERROR (Status)) {
+    goto ON_ERROR;
+  }
+
+  if (SuperSpeed) {
+    //
+    // A SuperSpeed device only moves data on streams, which are set up
+    // through the USB IO streams protocol.
+    //
+    UsbUas->UsbIoStreams = UsbGetStreamsProtocol (UsbIo);
+    if ((UsbUas->UsbIoStreams == NULL) || (UsbUas->MaxStreams == 0)) {
+      Status = EFI_UNSUPPORTED;
+      goto ON_ERROR;
+    }
+  }
+
+  if (Context == NULL) {
+    FreePool (UsbUas);
+    return EFI_SUCCESS;
+  }
+
+  if (UsbUas->Interface.AlternateSetting != UsbUas->DefaultSetting) {
+    Status = UsbUasSelectSetting (UsbUas, UsbUas->Interface.AlternateSetting);
+    if (EFI_ERROR (Status)) {
+      goto ON_ERROR;
+    }
+  }
+
+  if (UsbUas->UsbIoStreams != NULL) {
+    Status = UsbUasAllocateStreams (UsbUas);
+    if (EFI_ERROR (Status)) {
+      goto ON_RESTORE_SETTING;
+    }
+  }
+
+  *Context = UsbUas;
+  return EFI_SUCCESS;
+
+ON_RESTORE_SETTING:
+  if (UsbUas->Interface.AlternateSetting != UsbUas->DefaultSetting) {
+    UsbUasSelectSetting (UsbUas, UsbUas->DefaultSetting);
+  }
+
+ON_ERROR:
+  FreePool (UsbUas);
+  return Status;
+}
+
+/**
+  Fill in the Command IU of a command.
+
+  @param  Task                  The task of the command
+  @param  Tag                   The tag of the command
+  @param  Cmd                   The command to transfer to device
+  @param  CmdLen                The length of the command
+  @param  Lun                   The number of logic unit
+
+**/
+VOID
+UsbUasBuildCommandIu (
+  IN USB_UAS_TASK             *Task,
+  IN UINT16                   Tag,
+  IN VOID                     *Cmd,
+  IN UINT8                    CmdLen,
+  IN UINT8                    Lun
+  )
+{
+  ASSERT ((CmdLen > 0) && (CmdLen <= USB_UAS_MAX_CDB_LEN));
+
+  ZeroMem (&Task->CommandIu, sizeof (USB_UAS_COMMAND_IU));
+  Task->CommandIu.Header.IuId = USB_UAS_IU_COMMAND;
+  Task->CommandIu.Header.Tag  = SwapBytes16 (Tag);
+  Task->CommandIu.Lun[1]      = Lun;
+  CopyMem (Task->CommandIu.Cdb, Cmd, MIN (CmdLen, USB_UAS_MAX_CDB_LEN));
+}
+
+/**
+  Interpret the IU that ends a command.
+
+  The sense data of a failed command is saved, to answer the REQUEST SENSE
+  command that follows.
+
+  @param  UsbUas                The USB UAS device
+  @param  StatusIu              The IU received on the status pipe
+  @param  Length                The length of the IU
+  @param  Tag                   The tag of the command
+  @param  DataFailed            Whether the data phase of the command failed
+  @param  CmdStatus             The result of the command execution
+
+  @retval EFI_SUCCESS           The result of the command is in CmdStatus.
+  @retval EFI_DEVICE_ERROR      The IU is not valid.
+
+**/
+EFI_STATUS
+UsbUasCheckStatus (
+  IN  USB_UAS_PROTOCOL        *UsbUas,
+  IN  USB_UAS_STATUS_IU       *StatusIu,
+  IN  UINTN                   Length,
+  IN  UINT16                  Tag,
+  IN  BOOLEAN                 DataFailed,
+  OUT UINT32                  *CmdStatus
+  )
+{
+  *CmdStatus = USB_MASS_CMD_FAIL;
+
+  if ((Length < sizeof (USB_UAS_IU_HEADER)) || (SwapBytes16 (StatusIu->Header.Tag) != Tag)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (StatusIu->Header.IuId == USB_UAS_IU_RESPONSE) {
+    DEBUG ((EFI_D_ERROR, "UsbUasCheckStatus: command rejected with response code 0x%x\n", StatusIu->Response.ResponseCode));
+    UsbUas->SenseValid = FALSE;
+    return EFI_SUCCESS;
+  }
+
+  if ((StatusIu->Header.IuId != USB_UAS_IU_SENSE) || (Length < USB_UAS_SENSE_IU_HEADER_LEN)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (StatusIu->Sense.Status == USB_UAS_STATUS_GOOD) {
+    UsbUas->SenseValid = FALSE;
+    if (!DataFailed) {
+      *CmdStatus = USB_MASS_CMD_SUCCESS;
+    }
+    return EFI_SUCCESS;
+  }
+
+  UsbUas->SenseLength = (UINT8) MIN (
+                                  MIN (SwapBytes16 (StatusIu->Sense.SenseLength), Length - USB_UAS_SENSE_IU_HEADER_LEN),
+                                  USB_UAS_MAX_SENSE_LEN
+                                  );
+  UsbUas->SenseValid  = (BOOLEAN) (UsbUas->SenseLength != 0);
+  CopyMem (UsbUas->SenseData, StatusIu->Sense.SenseData, UsbUas->SenseLength);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Transfer data on a pipe of a device without streams.
+
+  @param  UsbUas                The USB UAS device
+  @param  Endpoint              The pipe of the transfer
+  @param  Data                  The buffer to hold data
+  @param  Length                The length of the data, updated with the
+                                length transferred
+  @param  Timeout               The time to wait the transfer to complete
+
+  @retval EFI_SUCCESS           The data is transferred.
+  @retval Others                Failed to transfer data.
+
+**/
+EFI_STATUS
+UsbUasBulkTransfer (
+  IN     USB_UAS_PROTOCOL     *UsbUas,
+  IN     UINT8                Endpoint,
+  IN OUT VOID                 *Data,
+  IN OUT UINTN                *Length,
+  IN     UINT32               Timeout
+  )
+{
+  EFI_STATUS                  Status;
+  UINT32                      Result;
+
+  Result = 0;
+  Status = UsbUas->UsbIo->UsbBulkTransfer (
+                            UsbUas->UsbIo,
+                            Endpoint,
+                            Data,
+                            Length,
+                            Timeout / USB_MASS_1_MILLISECOND,
+                            &Result
+                            );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "UsbUasBulkTransfer: endpoint 0x%x (%r) result 0x%x\n", Endpoint, Status, Result));
+    if (USB_IS_ERROR (Result, EFI_USB_ERR_STALL)) {
+      UsbClearEndpointStall (UsbUas->UsbIo, Endpoint);
+    }
+  }
+
+  return Status;
+}
+
+/**
+  Execute a command on a device without streams.
+
+  The device announces the data phase with a Read Ready or Write Ready IU
+  on the status pipe, then ends the command with a Sense or Response IU.
+
+  @param  UsbUas                The USB UAS device
+  @param  Cmd                   The command to transfer to device
+  @param  CmdLen                The length of the command
+  @param  DataDir               The direction of the data
+  @param  Data                  The buffer to hold data
+  @param  DataLen               The length of the data
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait the command to complete
+  @param  CmdStatus             The result of the command execution
+
+  @retval EFI_SUCCESS           The command is executed, and its result is in CmdStatus.
+  @retval Others                Failed to execute the command.
+
+**/
+EFI_STATUS
+UsbUasExecCommandWithoutStreams (
+  IN  USB_UAS_PROTOCOL        *UsbUas,
+  IN  VOID                    *Cmd,
+  IN  UINT8                   CmdLen,
+  IN  EFI_USB_DATA_DIRECTION  DataDir,
+  IN  VOID                    *Data,
+  IN  UINT32                  DataLen,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout,
+  OUT UINT32                  *CmdStatus
+  )
+{
+  USB_UAS_TASK                *Task;
+  BOOLEAN                     DataFailed;
+  UINTN                       Length;
+  UINT8                       IuId;
+  EFI_STATUS                  Status;
+
+  Task       = &UsbUas->Tasks[0];
+  DataFailed = FALSE;
+  UsbUasBuildCommandIu (Task, 1, Cmd, CmdLen, Lun);
+
+  Length = sizeof (USB_UAS_COMMAND_IU);
+  Status = UsbUasBulkTransfer (UsbUas, UsbUas->CommandPipe, &Task->CommandIu, &Length, USB_UAS_IU_TIMEOUT);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Length = sizeof (USB_UAS_STATUS_IU);
+  Status = UsbUasBulkTransfer (UsbUas, UsbUas->StatusPipe, &Task->StatusIu, &Length, Timeout);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  IuId = Task->StatusIu.Header.IuId;
+  if ((IuId == USB_UAS_IU_READ_READY) || (IuId == USB_UAS_IU_WRITE_READY)) {
+    if ((Length < sizeof (USB_UAS_IU_HEADER)) || (SwapBytes16 (Task->StatusIu.Header.Tag) != 1) ||
+        (DataDir != ((IuId == USB_UAS_IU_READ_READY) ? EfiUsbDataIn : EfiUsbDataOut))) {
+      return EFI_DEVICE_ERROR;
+    }
+
+    Length     = DataLen;
+    Status     = UsbUasBulkTransfer (
+                   UsbUas,
+                   (DataDir == EfiUsbDataIn) ? UsbUas->DataInPipe : UsbUas->DataOutPipe,
+                   Data,
+                   &Length,
+                   Timeout
+                   );
+    DataFailed = (BOOLEAN) EFI_ERROR (Status);
+
+    Length = sizeof (USB_UAS_STATUS_IU);
+    Status = UsbUasBulkTransfer (UsbUas, UsbUas->StatusPipe, &Task->StatusIu, &Length, Timeout);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return UsbUasCheckStatus (UsbUas, &Task->StatusIu, Length, 1, DataFailed, CmdStatus);
+}
+
+/**
+  Queue the status and data transfers of a command on the stream of its tag.
+
+  The Command IU is sent later, when the command pipe is free.
+
+  @param  UsbUas                The USB UAS device
+  @param  Tag                   The tag of the command
+  @param  Command               The command
+  @param  Lun                   The number of logic unit
+
+  @retval EFI_SUCCESS           The transfers are queued.
+  @retval Others                Failed to queue the transfers.
+
+**/
+EFI_STATUS
+UsbUasStartTask (
+  IN USB_UAS_PROTOCOL         *UsbUas,
+  IN UINT16                   Tag,
+  IN USB_MASS_COMMAND         *Command,
+  IN UINT8                    Lun
+  )
+{
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  USB_UAS_TASK                  *Task;
+  EFI_STATUS                    Status;
+
+  UsbIoStreams = UsbUas->UsbIoStreams;
+  Task         = &UsbUas->Tasks[Tag - 1];
+
+  UsbUasBuildCommandIu (Task, Tag, Command->Cmd, Command->CmdLen, Lun);
+  Task->CommandSent    = FALSE;
+  Task->DataFailed     = FALSE;
+  Task->StatusTransfer = NULL;
+  Task->DataTransfer   = NULL;
+  Command->CmdStatus   = USB_MASS_CMD_FAIL;
+
+  Status = UsbIoStreams->SubmitBulkTransfer (
+                           UsbIoStreams,
+                           UsbUas->StatusPipe,
+                           Tag,
+                           &Task->StatusIu,
+                           sizeof (USB_UAS_STATUS_IU),
+                           &Task->StatusTransfer
+                           );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((Command->DataDir != EfiUsbNoData) && (Command->DataLen != 0)) {
+    Status = UsbIoStreams->SubmitBulkTransfer (
+                             UsbIoStreams,
+                             (Command->DataDir == EfiUsbDataIn) ? UsbUas->DataInPipe : UsbUas->DataOutPipe,
+                             Tag,
+                             Command->Data,
+                             Command->DataLen,
+                             &Task->DataTransfer
+                             );
+    if (EFI_ERROR (Status)) {
+      UsbIoStreams->CancelBulkTransfer (UsbIoStreams, Task->StatusTransfer);
+      Task->StatusTransfer = NULL;
+      return Status;
+    }
+  }
+
+  Task->Command = Command;
+  return EFI_SUCCESS;
+}
+
+/**
+  Check whether the command of a tag is complete.
+
+  @param  UsbUas                The USB UAS device
+  @param  Tag                   The tag of the command
+  @param  Finished              Returns whether the command is complete, in
+                                which case the tag is free again.
+
+  @retval EFI_SUCCESS           The command is in progress, or complete and
+                                its result is in the CmdStatus of the command.
+  @retval Others                The status of the command couldn't be received.
+
+**/
+EFI_STATUS
+UsbUasPollTask (
+  IN  USB_UAS_PROTOCOL        *UsbUas,
+  IN  UINT16                  Tag,
+  OUT BOOLEAN                 *Finished
+  )
+{
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  USB_UAS_TASK                  *Task;
+  UINTN                         Length;
+  UINTN                         StatusLength;
+  UINT32                        Result;
+  EFI_STATUS                    Status;
+
+  UsbIoStreams = UsbUas->UsbIoStreams;
+  Task         = &UsbUas->Tasks[Tag - 1];
+  *Finished    = FALSE;
+
+  if (Task->DataTransfer != NULL) {
+    Status = UsbIoStreams->PollBulkTransfer (UsbIoStreams, Task->DataTransfer, &Length, &Result);
+    if (Status != EFI_NOT_READY) {
+      Task->DataTransfer = NULL;
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "UsbUasPollTask: data of tag %d (%r) result 0x%x\n", Tag, Status, Result));
+        Task->DataFailed = TRUE;
+      }
+    }
+  }
+
+  Status = UsbIoStreams->PollBulkTransfer (UsbIoStreams, Task->StatusTransfer, &StatusLength, &Result);
+  if (Status == EFI_NOT_READY) {
+    return EFI_SUCCESS;
+  }
+
+  Task->StatusTransfer = NULL;
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "UsbUasPollTask: status of tag %d (%r) result 0x%x\n", Tag, Status, Result));
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (Task->DataTransfer != NULL) {
+    //
+    // The device sends the status after the data, unless the command failed
+    // before its data phase. The data may have completed since it was
+    // polled, so poll it once more before dropping it.
+    //
+    Status = UsbIoStreams->PollBulkTransfer (UsbIoStreams, Task->DataTransfer, &Length, &Result);
+    if (Status == EFI_NOT_READY) {
+      UsbIoStreams->CancelBulkTransfer (UsbIoStreams, Task->DataTransfer);
+      Status = EFI_ABORTED;
+    }
+    Task->DataTransfer = NULL;
+    if (EFI_ERROR (Status)) {
+      Task->DataFailed = TRUE;
+    }
+  }
+
+  Status = UsbUasCheckStatus (
+             UsbUas,
+             &Task->StatusIu,
+             StatusLength,
+             Tag,
+             Task->DataFailed,
+             &Task->Command->CmdStatus
+             );
+
+  Task->Command = NULL;
+  *Finished     = TRUE;
+  return Status;
+}
+
+/**
+  Cancel the transfers of the command of a tag, and free the tag.
+
+  @param  UsbUas                The USB UAS device
+  @param  Tag                   The tag of the command
+
+**/
+VOID
+UsbUasCancelTask (
+  IN USB_UAS_PROTOCOL         *UsbUas,
+  IN UINT16                   Tag
+  )
+{
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  USB_UAS_TASK                  *Task;
+
+  UsbIoStreams = UsbUas->UsbIoStreams;
+  Task         = &UsbUas->Tasks[Tag - 1];
+
+  if (Task->DataTransfer != NULL) {
+    UsbIoStreams->CancelBulkTransfer (UsbIoStreams, Task->DataTransfer);
+    Task->DataTransfer = NULL;
+  }
+
+  if (Task->StatusTransfer != NULL) {
+    UsbIoStreams->CancelBulkTransfer (UsbIoStreams, Task->StatusTransfer);
+    Task->StatusTransfer = NULL;
+  }
+
+  Task->Command = NULL;
+}
+
+/**
+  Execute several commands through the USB Attached SCSI protocol, keeping
+  one command in flight on each stream.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL
+  @param  Commands              The commands to execute. Their CmdStatus is
+                                updated with the result of each command.
+  @param  Count                 The number of commands
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait for progress on the commands
+
+  @retval EFI_SUCCESS           The commands are executed.
+  @retval EFI_UNSUPPORTED       The device doesn't use streams.
+  @retval Other                 Failed to execute the commands.
+
+**/
+EFI_STATUS
+UsbUasExecCommands (
+  IN  VOID                    *Context,
+  IN  USB_MASS_COMMAND        *Commands,
+  IN  UINTN                   Count,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout
+  )
+{
+  USB_UAS_PROTOCOL              *UsbUas;
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;
+  USB_UAS_TASK                  *Task;
+  UINTN                         Next;
+  UINTN                         Done;
+  UINT32                        Idle;
+  UINT16                        Tag;
+  BOOLEAN                       Progress;
+  BOOLEAN                       Finished;
+  UINTN                         Length;
+  UINT32                        Result;
+  EFI_STATUS                    Status;
+
+  UsbUas       = (USB_UAS_PROTOCOL *) Context;
+  UsbIoStreams = UsbUas->UsbIoStreams;
+
+  if (UsbUas->StreamCount == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Next   = 0;
+  Done   = 0;
+  Idle   = 0;
+  Status = EFI_SUCCESS;
+
+  while (Done < Count) {
+    Progress = FALSE;
+
+    //
+    // Start the next commands on the free tags.
+    //
+    for (Tag = 1; (Tag <= UsbUas->StreamCount) && (Next < Count); Tag++) {
+      if (UsbUas->Tasks[Tag - 1].Command == NULL) {
+        Status = UsbUasStartTask (UsbUas, Tag, &Commands[Next], Lun);
+        if (EFI_ERROR (Status)) {
+          goto ON_ERROR;
+        }
+        Next++;
+        Progress = TRUE;
+      }
+    }
+
+    //
+    // The command pipe has no streams, so the Command IUs are sent one at
+    // a time, while the data of the earlier commands moves on their streams.
+    //
+    if (UsbUas->CommandTransfer != NULL) {
+      Status = UsbIoStreams->PollBulkTransfer (UsbIoStreams, UsbUas->CommandTransfer, &Length, &Result);
+      if (Status != EFI_NOT_READY) {
+        UsbUas->CommandTransfer = NULL;
+        Progress                = TRUE;
+        if (EFI_ERROR (Status)) {
+          DEBUG ((EFI_D_ERROR, "UsbUasExecCommands: command IU (%r) result 0x%x\n", Status, Result));
+          goto ON_ERROR;
+        }
+      }
+    }
+
+    for (Tag = 1; (Tag <= UsbUas->StreamCount) && (UsbUas->CommandTransfer == NULL); Tag++) {
+      Task = &UsbUas->Tasks[Tag - 1];
+      if ((Task->Command != NULL) && !Task->CommandSent) {
+        Status = UsbIoStreams->SubmitBulkTransfer (
+                                 UsbIoStreams,
+                                 UsbUas->CommandPipe,
+                                 0,
+                                 &Task->CommandIu,
+                                 sizeof (USB_UAS_COMMAND_IU),
+                                 &UsbUas->CommandTransfer
+                                 );
+        if (EFI_ERROR (Status)) {
+          UsbUas->CommandTransfer = NULL;
+          goto ON_ERROR;
+        }
+        Task->CommandSent = TRUE;
+        Progress          = TRUE;
+      }
+    }
+
+    //
+    // Collect the commands that are complete.
+    //
+    for (Tag = 1; Tag <= UsbUas->StreamCount; Tag++) {
+      Task = &UsbUas->Tasks[Tag - 1];
+      if ((Task->Command == NULL) || !Task->CommandSent) {
+        continue;
+      }
+
+      Status = UsbUasPollTask (UsbUas, Tag, &Finished);
+      if (EFI_ERROR (Status)) {
+        goto ON_ERROR;
+      }
+
+      if (Finished) {
+        Done++;
+        Progress = TRUE;
+      }
+    }
+
+    if (Progress) {
+      Idle = 0;
+    } else {
+      if (Idle >= Timeout) {
+        Status = EFI_TIMEOUT;
+        goto ON_ERROR;
+      }
+      gBS->Stall (USB_UAS_POLL_INTERVAL);
+      Idle += USB_UAS_POLL_INTERVAL;
+    }
+  }
+
+  return EFI_SUCCESS;
+
+ON_ERROR:
+  DEBUG ((EFI_D_ERROR, "UsbUasExecCommands: (%r) with %d of %d commands done\n", Status, Done, Count));
+  if (UsbUas->CommandTransfer != NULL) {
+    UsbIoStreams->CancelBulkTransfer (UsbIoStreams, UsbUas->CommandTransfer);
+    UsbUas->CommandTransfer = NULL;
+  }
+
+  for (Tag = 1; Tag <= UsbUas->StreamCount; Tag++) {
+    UsbUasCancelTask (UsbUas, Tag);
+  }
+
+  return Status;
+}
+
+/**
+  Execute a command through the USB Attached SCSI protocol.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL
+  @param  Cmd                   The high level command
+  @param  CmdLen                The command length
+  @param  DataDir               The direction of the data transfer
+  @param  Data                  The buffer to hold data
+  @param  DataLen               The length of the data
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait command
+  @param  CmdStatus             The result of high level command execution
+
+  @retval EFI_SUCCESS           The command is executed successfully.
+  @retval Other                 Failed to execute command
+
+**/
+EFI_STATUS
+UsbUasExecCommand (
+  IN  VOID                    *Context,
+  IN  VOID                    *Cmd,
+  IN  UINT8                   CmdLen,
+  IN  EFI_USB_DATA_DIRECTION  DataDir,
+  IN  VOID                    *Data,
+  IN  UINT32                  DataLen,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout,
+  OUT UINT32                  *CmdStatus
+  )
+{
+  USB_UAS_PROTOCOL            *UsbUas;
+  USB_MASS_COMMAND            Command;
+  EFI_STATUS                  Status;
+
+  *CmdStatus = USB_MASS_CMD_FAIL;
+  UsbUas     = (USB_UAS_PROTOCOL *) Context;
+
+  //
+  // The device returns the sense data of a failed command in its Sense IU,
+  // so the REQUEST SENSE command that follows is answered from the saved data.
+  //
+  if ((*(UINT8 *) Cmd == USB_BOOT_REQUEST_SENSE_OPCODE) && UsbUas->SenseValid && (DataDir == EfiUsbDataIn)) {
+    ZeroMem (Data, DataLen);
+    CopyMem (Data, UsbUas->SenseData, MIN (DataLen, UsbUas->SenseLength));
+    UsbUas->SenseValid = FALSE;
+    *CmdStatus         = USB_MASS_CMD_SUCCESS;
+    return EFI_SUCCESS;
+  }
+
+  if (UsbUas->StreamCount == 0) {
+    return UsbUasExecCommandWithoutStreams (UsbUas, Cmd, CmdLen, DataDir, Data, DataLen, Lun, Timeout, CmdStatus);
+  }
+
+  Command.Cmd     = Cmd;
+  Command.CmdLen  = CmdLen;
+  Command.DataDir = DataDir;
+  Command.Data    = Data;
+  Command.DataLen = DataLen;
+
+  Status     = UsbUasExecCommands (UsbUas, &Command, 1, Lun, Timeout);
+  *CmdStatus = Command.CmdStatus;
+
+  return Status;
+}
+
+/**
+  Reset the USB mass storage device by UAS protocol.
+
+  UAS has no class specific reset request, so the port of the device is reset
+  and the streams are allocated again.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL.
+  @param  ExtendedVerification  Not used.
+
+  @retval EFI_SUCCESS           The device is reset.
+  @retval Others                Failed to reset the device.
+
+**/
+EFI_STATUS
+UsbUasResetDevice (
+  IN  VOID                    *Context,
+  IN  BOOLEAN                 ExtendedVerification
+  )
+{
+  USB_UAS_PROTOCOL            *UsbUas;
+  EFI_STATUS                  Status;
+
+  UsbUas = (USB_UAS_PROTOCOL *) Context;
+
+  UsbUasFreeStreams (UsbUas);
+  UsbUas->SenseValid = FALSE;
+
+  Status = UsbUas->UsbIo->UsbPortReset (UsbUas->UsbIo);
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // The reset puts the device back on the default setting of the interface,
+  // while the USB bus driver and host controller keep the UAS setting.
+  //
+  if (UsbUas->Interface.AlternateSetting != 0) {
+    Status = UsbUasSelectSetting (UsbUas, UsbUas->Interface.AlternateSetting);
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (UsbUas->UsbIoStreams != NULL) {
+    Status = UsbUasAllocateStreams (UsbUas);
+  }
+
+  return Status;
+}
+
+/**
+  Get the max LUN (Logical Unit Number) of USB mass storage device.
+
+  UAS has no Get Max LUN request, so the LUNs are found with the REPORT LUNS
+  command.
+
+  @param  Context          The context of the UAS protocol, that is, USB_UAS_PROTOCOL
+  @param  MaxLun           Return pointer to the max number of LUN. (e.g. MaxLun=1 means LUN0 and
+                           LUN1 in all.)
+
+  @retval EFI_SUCCESS      Max LUN is got successfully.
+  @retval Others           Fail to execute this request.
+
+**/
+EFI_STATUS
+UsbUasGetMaxLun (
+  IN  VOID                    *Context,
+  OUT UINT8                   *MaxLun
+  )
+{
+  UINT8                       Cmd[12];
+  UINT8                       LunList[8 + 8 * (USB_UAS_MAX_LUN + 1)];
+  UINT8                       *Entry;
+  UINT32                      CmdStatus;
+  UINTN                       Count;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  if (Context == NULL || MaxLun == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *MaxLun = 0;
+
+  ZeroMem (Cmd, sizeof (Cmd));
+  Cmd[0] = USB_UAS_REPORT_LUNS_OPCODE;
+  WriteUnaligned32 ((UINT32 *) &Cmd[6], SwapBytes32 (sizeof (LunList)));
+
+  //
+  // The first command after a reset may fail with a unit attention.
+  //
+  for (Index = 0; Index < USB_UAS_REPORT_LUNS_RETRY; Index++) {
+    ZeroMem (LunList, sizeof (LunList));
+    Status = UsbUasExecCommand (
+               Context,
+               Cmd,
+               (UINT8) sizeof (Cmd),
+               EfiUsbDataIn,
+               LunList,
+               sizeof (LunList),
+               0,
+               USB_BOOT_GENERAL_CMD_TIMEOUT,
+               &CmdStatus
+               );
+    if (!EFI_ERROR (Status) && (CmdStatus == USB_MASS_CMD_SUCCESS)) {
+      break;
+    }
+  }
+
+  if (Index == USB_UAS_REPORT_LUNS_RETRY) {
+    //
+    // Like BOT, a device that doesn't report its LUNs has a single LUN.
+    //
+    return EFI_SUCCESS;
+  }
+
+  Count = MIN (SwapBytes32 (ReadUnaligned32 ((UINT32 *) LunList)) / 8, USB_UAS_MAX_LUN + 1);
+  for (Index = 0; Index < Count; Index++) {
+    //
+    // Only the single level LUNs of the peripheral device addressing method
+    // are used.
+    //
+    Entry = &LunList[8 + 8 * Index];
+    if ((Entry[0] == 0) && (Entry[1] <= USB_UAS_MAX_LUN) && (Entry[1] > *MaxLun)) {
+      *MaxLun = Entry[1];
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Clean up the resource used by this UAS protocol.
+
+  @param  Context         The context of the UAS protocol, that is, USB_UAS_PROTOCOL.
+
+  @retval EFI_SUCCESS     The resource is cleaned up.
+
+**/
+EFI_STATUS
+UsbUasCleanUp (
+  IN  VOID                    *Context
+  )
+{
+  USB_UAS_PROTOCOL            *UsbUas;
+
+  UsbUas = (USB_UAS_PROTOCOL *) Context;
+
+  UsbUasFreeStreams (UsbUas);
+
+  //
+  // Give the interface back on the setting it had, so Bulk-Only Transport
+  // works again for the next driver.
+  //
+  if (UsbUas->Interface.AlternateSetting != UsbUas->DefaultSetting) {
+    UsbUasSelectSetting (UsbUas, UsbUas->DefaultSetting);
+  }
+
+  FreePool (UsbUas);
+  return EFI_SUCCESS;
+}
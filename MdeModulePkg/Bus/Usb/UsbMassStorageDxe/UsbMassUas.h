@@ -0,0 +1,281 @@
+/** @file
+  Definition for the USB Attached SCSI transport protocol, based on the
+  "Universal Serial Bus Mass Storage Class USB Attached SCSI Protocol (UASP)"
+  Revision 1.0, and T10 SCSI "USB Attached SCSI (UAS)" r04.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _EFI_USBMASS_UAS_H_
+#define _EFI_USBMASS_UAS_H_
+
+extern USB_MASS_TRANSPORT mUsbUasTransport;
+
+//
+// UAS Information Unit IDs
+//
+#define USB_UAS_IU_COMMAND            0x01
+#define USB_UAS_IU_SENSE              0x03
+#define USB_UAS_IU_RESPONSE           0x04
+#define USB_UAS_IU_READ_READY         0x06
+#define USB_UAS_IU_WRITE_READY        0x07
+
+//
+// UAS class specific descriptors. Each endpoint of the interface is followed
+// by a Pipe Usage descriptor that gives the role of the pipe. SuperSpeed
+// endpoints also have a SuperSpeed Endpoint Companion descriptor, which holds
+// the number of streams of bulk endpoints.
+//
+#define USB_UAS_DESC_TYPE_PIPE_USAGE  0x24
+#define USB_UAS_DESC_TYPE_SS_COMPANION 0x30
+
+#define USB_UAS_PIPE_COMMAND          1
+#define USB_UAS_PIPE_STATUS           2
+#define USB_UAS_PIPE_DATA_IN          3
+#define USB_UAS_PIPE_DATA_OUT         4
+
+//
+// The number of commands the driver keeps in flight on a SuperSpeed device.
+// Each command uses the stream of the same number as its tag.
+//
+#define USB_UAS_MAX_STREAMS           16
+
+#define USB_UAS_STATUS_GOOD           0x00 ///< SCSI status of a command that passed
+#define USB_UAS_MAX_LUN               0x0F
+#define USB_UAS_MAX_CDB_LEN           16
+#define USB_UAS_MAX_SENSE_LEN         252
+#define USB_UAS_REPORT_LUNS_OPCODE    0xA0
+#define USB_UAS_REPORT_LUNS_RETRY     2
+
+//
+// Usb UAS transport timeout, set by experience
+//
+#define USB_UAS_IU_TIMEOUT            (3 * USB_MASS_1_SECOND)
+#define USB_UAS_DESCRIPTOR_TIMEOUT    (3 * USB_MASS_1_SECOND)
+
+//
+// The interval, in microseconds, at which the queued transfers are polled
+//
+#define USB_UAS_POLL_INTERVAL         10
+
+#pragma pack(1)
+///
+/// The header common to all the Information Units. The tag is big endian.
+///
+typedef struct {
+  UINT8               IuId;
+  UINT8               Reserved;
+  UINT16              Tag;
+} USB_UAS_IU_HEADER;
+
+///
+/// The Command IU, sent on the command pipe.
+///
+typedef struct {
+  USB_UAS_IU_HEADER   Header;
+  UINT8               TaskAttribute;  ///< Bits 0~2 are the task attribute
+  UINT8               Reserved1;
+  UINT8               AddCdbLength;   ///< Bits 2~7 are the additional CDB length
+  UINT8               Reserved2;
+  UINT8               Lun[8];
+  UINT8               Cdb[USB_UAS_MAX_CDB_LEN];
+} USB_UAS_COMMAND_IU;
+
+///
+/// The Sense IU, received on the status pipe when a command completes.
+///
+typedef struct {
+  USB_UAS_IU_HEADER   Header;
+  UINT16              StatusQualifier;
+  UINT8               Status;         ///< SCSI status of the command
+  UINT8               Reserved[7];
+  UINT16              SenseLength;    ///< Big endian
+  UINT8               SenseData[USB_UAS_MAX_SENSE_LEN];
+} USB_UAS_SENSE_IU;
+
+///
+/// The Response IU, received on the status pipe when a command is rejected.
+///
+typedef struct {
+  USB_UAS_IU_HEADER   Header;
+  UINT8               AddResponseInfo[3];
+  UINT8               ResponseCode;
+} USB_UAS_RESPONSE_IU;
+#pragma pack()
+
+///
+/// The status pipe receives a Read Ready, Write Ready, Sense or Response IU,
+/// all of which fit in a Sense IU.
+///
+typedef union {
+  USB_UAS_IU_HEADER   Header;
+  USB_UAS_SENSE_IU    Sense;
+  USB_UAS_RESPONSE_IU Response;
+} USB_UAS_STATUS_IU;
+
+#define USB_UAS_SENSE_IU_HEADER_LEN   OFFSET_OF (USB_UAS_SENSE_IU, SenseData)
+
+///
+/// A command in flight, on the stream of its tag.
+///
+typedef struct {
+  USB_MASS_COMMAND    *Command;       ///< NULL if the tag is free
+  BOOLEAN             CommandSent;
+  BOOLEAN             DataFailed;
+  VOID                *StatusTransfer;
+  VOID                *DataTransfer;
+  USB_UAS_COMMAND_IU  CommandIu;
+  USB_UAS_STATUS_IU   StatusIu;
+} USB_UAS_TASK;
+
+typedef struct {
+  //
+  // Put Interface at the first field to make it easy to distinguish BOT/CBI/UAS Protocol instance
+  //
+  EFI_USB_INTERFACE_DESCRIPTOR  Interface;     ///< The UAS setting of the interface
+  EFI_USB_IO_PROTOCOL           *UsbIo;
+  EDKII_USB_IO_STREAMS_PROTOCOL *UsbIoStreams;  ///< NULL unless the device is a SuperSpeed device
+  UINT8                         DefaultSetting; ///< The setting that was active before UAS was selected
+  UINT8                         CommandPipe;
+  UINT8                         StatusPipe;
+  UINT8                         DataInPipe;
+  UINT8                         DataOutPipe;
+  UINT16                        MaxStreams;     ///< Streams of the device, 0 for a high-speed device
+  UINT16                        StreamCount;    ///< Streams allocated on the status and data pipes
+  BOOLEAN                       SenseValid;
+  UINT8                         SenseLength;
+  UINT8                         SenseData[USB_UAS_MAX_SENSE_LEN];
+  VOID                          *CommandTransfer;
+  USB_UAS_TASK                  Tasks[USB_UAS_MAX_STREAMS];
+} USB_UAS_PROTOCOL;
+
+/**
+  Initializes USB UAS protocol.
+
+  This function initializes the USB mass storage class UAS protocol.
+  It will save its context which is a USB_UAS_PROTOCOL structure
+  in the Context if Context isn't NULL.
+
+  @param  UsbIo                 The USB I/O Protocol instance
+  @param  Context               The buffer to save the context to
+
+  @retval EFI_SUCCESS           The device is successfully initialized.
+  @retval EFI_UNSUPPORTED       The transport protocol doesn't support the device.
+  @retval Other                 The USB UAS initialization fails.
+
+**/
+EFI_STATUS
+UsbUasInit (
+  IN  EFI_USB_IO_PROTOCOL       *UsbIo,
+  OUT VOID                      **Context OPTIONAL
+  );
+
+/**
+  Execute a command through the USB Attached SCSI protocol.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL
+  @param  Cmd                   The high level command
+  @param  CmdLen                The command length
+  @param  DataDir               The direction of the data transfer
+  @param  Data                  The buffer to hold data
+  @param  DataLen               The length of the data
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait command
+  @param  CmdStatus             The result of high level command execution
+
+  @retval EFI_SUCCESS           The command is executed successfully.
+  @retval Other                 Failed to execute command
+
+**/
+EFI_STATUS
+UsbUasExecCommand (
+  IN  VOID                    *Context,
+  IN  VOID                    *Cmd,
+  IN  UINT8                   CmdLen,
+  IN  EFI_USB_DATA_DIRECTION  DataDir,
+  IN  VOID                    *Data,
+  IN  UINT32                  DataLen,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout,
+  OUT UINT32                  *CmdStatus
+  );
+
+/**
+  Execute several commands through the USB Attached SCSI protocol, keeping
+  one command in flight on each stream.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL
+  @param  Commands              The commands to execute. Their CmdStatus is
+                                updated with the result of each command.
+  @param  Count                 The number of commands
+  @param  Lun                   The number of logic unit
+  @param  Timeout               The time to wait for progress on the commands
+
+  @retval EFI_SUCCESS           The commands are executed.
+  @retval EFI_UNSUPPORTED       The device doesn't use streams.
+  @retval Other                 Failed to execute the commands.
+
+**/
+EFI_STATUS
+UsbUasExecCommands (
+  IN  VOID                    *Context,
+  IN  USB_MASS_COMMAND        *Commands,
+  IN  UINTN                   Count,
+  IN  UINT8                   Lun,
+  IN  UINT32                  Timeout
+  );
+
+/**
+  Reset the USB mass storage device by UAS protocol.
+
+  UAS has no class specific reset request, so the port of the device is reset
+  and the streams are allocated again.
+
+  @param  Context               The context of the UAS protocol, that is,
+                                USB_UAS_PROTOCOL.
+  @param  ExtendedVerification  Not used.
+
+  @retval EFI_SUCCESS           The device is reset.
+  @retval Others                Failed to reset the device.
+
+**/
+EFI_STATUS
+UsbUasResetDevice (
+  IN  VOID                    *Context,
+  IN  BOOLEAN                 ExtendedVerification
+  );
+
+/**
+  Get the max LUN (Logical Unit Number) of USB mass storage device.
+
+  @param  Context          The context of the UAS protocol, that is, USB_UAS_PROTOCOL
+  @param  MaxLun           Return pointer to the max number of LUN. (e.g. MaxLun=1 means LUN0 and
+                           LUN1 in all.)
+
+  @retval EFI_SUCCESS      Max LUN is got successfully.
+  @retval Others           Fail to execute this request.
+
+**/
+EFI_STATUS
+UsbUasGetMaxLun (
+  IN  VOID                    *Context,
+  OUT UINT8                   *MaxLun
+  );
+
+/**
+  Clean up the resource used by this UAS protocol.
+
+  @param  Context         The context of the UAS protocol, that is, USB_UAS_PROTOCOL.
+
+  @retval EFI_SUCCESS     The resource is cleaned up.
+
+**/
+EFI_STATUS
+UsbUasCleanUp (
+  IN  VOID                    *Context
+  );
+
+#endif
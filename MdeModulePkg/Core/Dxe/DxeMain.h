@@ -64,6 +64,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/VectorHandoffTable.h>
 #include <Ppi/VectorHandoffInfo.h>
 #include <Guid/MemoryProfile.h>
+#include <Guid/ExtendedFirmwarePerformance.h>
 
 #include <Library/DxeCoreEntryPoint.h>
 #include <Library/DebugLib.h>
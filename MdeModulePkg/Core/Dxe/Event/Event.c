@@ -160,13 +160,23 @@ CoreDispatchEventNotifies (
   IN EFI_TPL      Priority
   )
 {
-  IEVENT          *Event;
-  LIST_ENTRY      *Head;
+  IEVENT            *Event;
+  LIST_ENTRY        *Head;
+  EFI_EVENT_NOTIFY  NotifyFunction;
+  BOOLEAN           Measure;
 
   CoreAcquireEventLock ();
   ASSERT (gEventQueueLock.OwnerTpl == Priority);
   Head = &gEventQueue[Priority];
 
+  //
+  // Recording a measurement allocates memory, which cannot be done above
+  // TPL_NOTIFY.
+  //
+  Measure = (BOOLEAN) (PcdGetBool (PcdPerformanceDeepProfileEnable) &&
+                       Priority <= TPL_NOTIFY &&
+                       LogPerformanceMeasurementEnabled (PERF_GENERAL_TYPE));
+
   //
   // Dispatch all the pending notifications
   //
@@ -191,7 +201,17 @@ CoreDispatchEventNotifies (
     // Notify this event
     //
     ASSERT (Event->NotifyFunction != NULL);
-    Event->NotifyFunction (Event, Event->NotifyContext);
+    if (!Measure) {
+      Event->NotifyFunction (Event, Event->NotifyContext);
+    } else {
+      //
+      // The notification function may close the event.
+      //
+      NotifyFunction = Event->NotifyFunction;
+      LogPerformanceMeasurement (NotifyFunction, NULL, NULL, (UINT64) (UINTN) NotifyFunction, PERF_EVENT_NOTIFY_START_ID);
+      NotifyFunction (Event, Event->NotifyContext);
+      LogPerformanceMeasurement (NotifyFunction, NULL, NULL, (UINT64) (UINTN) NotifyFunction, PERF_EVENT_NOTIFY_END_ID);
+    }
 
     //
     // Check for next pending event
@@ -702,9 +722,12 @@ CoreWaitForEvent (
     }
 
     //
-    // Signal the Idle event
+    // Signal the Idle event, letting the timer interrupt sleep until the
+    // next timer deadline
     //
+    CoreTimerEnterIdle ();
     CoreSignalEvent (gIdleLoopEvent);
+    CoreTimerExitIdle ();
   }
 }
 
@@ -27,6 +27,18 @@ extern  UINTN                   gEventPending;
 // EFI_EVENT
 //
 
+///
+/// The timer database is a hashed timer wheel.  Each slot covers
+/// 2^TIMER_WHEEL_SLOT_SHIFT units of 100ns and holds the timers due in that
+/// window, sorted by trigger time.  The wheel spans one epoch of
+/// TIMER_WHEEL_SIZE slots; timers due in a later epoch are parked on an
+/// unsorted overflow list and moved into the wheel when their epoch starts.
+///
+#define TIMER_WHEEL_SLOT_SHIFT    17
+#define TIMER_WHEEL_SIZE_SHIFT    8
+#define TIMER_WHEEL_SIZE          (1 << TIMER_WHEEL_SIZE_SHIFT)
+#define TIMER_WHEEL_SLOT_MASK     (TIMER_WHEEL_SIZE - 1)
+
 ///
 /// Timer event information
 ///
@@ -88,4 +100,27 @@ CoreInitializeTimer (
   VOID
   );
 
+
+/**
+  Called before the core signals the idle event.  If no timer event is due
+  within the regular timer period, reprogram the timer interrupt to fire at
+  the next timer deadline.
+
+**/
+VOID
+CoreTimerEnterIdle (
+  VOID
+  );
+
+
+/**
+  Called after the idle event has been signaled.  Restores the regular timer
+  period if it was changed by CoreTimerEnterIdle().
+
+**/
+VOID
+CoreTimerExitIdle (
+  VOID
+  );
+
 #endif
@@ -14,16 +14,58 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_SIZE];
+UINT64           mEfiTimerWheelBitmap[TIMER_WHEEL_SIZE / 64];
+LIST_ENTRY       mEfiTimerOverflowList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerOverflowList);
+UINT64           mEfiTimerWheelCursor = 0;
+UINT64           mEfiTimerNextTrigger = MAX_UINT64;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// The regular timer period saved while the timer is reprogrammed for idle
+//
+UINT64           mEfiTicklessSavedPeriod = 0;
+
 //
 // Timer functions
 //
+/**
+  Inserts the timer event into one timer wheel slot, keeping the slot sorted
+  in ascending trigger time order.  Timers with equal trigger times are kept
+  in insertion order.
+
+  @param  Slot                   The list head of the timer wheel slot
+  @param  Event                  Points to the internal structure of timer event
+                                 to be installed
+
+**/
+VOID
+CoreInsertEventTimerInSlot (
+  IN LIST_ENTRY  *Slot,
+  IN IEVENT      *Event
+  )
+{
+  LIST_ENTRY      *Link;
+  IEVENT          *Event2;
+
+  //
+  // Search backward, new timers usually expire after the ones already queued
+  //
+  for (Link = Slot->BackLink; Link != Slot; Link = Link->BackLink) {
+    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+
+    if (Event2->Timer.TriggerTime <= Event->Timer.TriggerTime) {
+      break;
+    }
+  }
+
+  InsertHeadList (Link, &Event->Timer.Link);
+}
+
 /**
   Inserts the timer event.
 
@@ -37,8 +79,7 @@ CoreInsertEventTimer (
   )
 {
   UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINT64          Slot;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
@@ -48,17 +89,183 @@ CoreInsertEventTimer (
   TriggerTime = Event->Timer.TriggerTime;
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Timers that are already due go to the slot the wheel is currently at
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  Slot = RShiftU64 (TriggerTime, TIMER_WHEEL_SLOT_SHIFT);
+  if (Slot < mEfiTimerWheelCursor) {
+    Slot = mEfiTimerWheelCursor;
+  }
+
+  //
+  // Timers beyond the current epoch of the wheel are parked on the overflow list
+  //
+  if (RShiftU64 (Slot, TIMER_WHEEL_SIZE_SHIFT) != RShiftU64 (mEfiTimerWheelCursor, TIMER_WHEEL_SIZE_SHIFT)) {
+    InsertTailList (&mEfiTimerOverflowList, &Event->Timer.Link);
+  } else {
+    CoreInsertEventTimerInSlot (&mEfiTimerWheel[(UINTN)Slot & TIMER_WHEEL_SLOT_MASK], Event);
+    mEfiTimerWheelBitmap[((UINTN)Slot & TIMER_WHEEL_SLOT_MASK) / 64] |= LShiftU64 (1, (UINTN)Slot % 64);
+  }
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
+  //
+  // Keep a lower bound of the next trigger time for CoreTimerTick()
+  //
+  if (TriggerTime < mEfiTimerNextTrigger) {
+    mEfiTimerNextTrigger = TriggerTime;
+  }
+}
+
+/**
+  Finds the first slot of the timer wheel between two slots of the current
+  epoch that holds timers.  The bitmap of the wheel tells which slots may
+  hold timers; a cancelled timer leaves its bit set, so the bits of the slots
+  found empty on the way are cleared.
+
+  @param  From                   The first slot to look at
+  @param  To                     The last slot to look at, in the same epoch
+                                 as From
+
+  @return The slot, or MAX_UINT64 if no slot holds timers.
+
+**/
+UINT64
+CoreFindTimerWheelSlot (
+  IN UINT64  From,
+  IN UINT64  To
+  )
+{
+  UINTN           Index;
+  UINTN           Last;
+  INTN            Bit;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+  ASSERT (RShiftU64 (From, TIMER_WHEEL_SIZE_SHIFT) == RShiftU64 (To, TIMER_WHEEL_SIZE_SHIFT));
+
+  Index = (UINTN)From & TIMER_WHEEL_SLOT_MASK;
+  Last  = (UINTN)To & TIMER_WHEEL_SLOT_MASK;
+  while (Index <= Last) {
+    Bit = LowBitSet64 (RShiftU64 (mEfiTimerWheelBitmap[Index / 64], Index % 64));
+    if (Bit < 0) {
+      Index = (Index | 63) + 1;
+      continue;
+    }
+
+    Index += (UINTN)Bit;
+    if (Index > Last) {
       break;
     }
+
+    if (!IsListEmpty (&mEfiTimerWheel[Index])) {
+      return From + (Index - ((UINTN)From & TIMER_WHEEL_SLOT_MASK));
+    }
+
+    mEfiTimerWheelBitmap[Index / 64] &= ~LShiftU64 (1, Index % 64);
+    Index++;
   }
 
-  InsertTailList (Link, &Event->Timer.Link);
+  return MAX_UINT64;
+}
+
+/**
+  Advances the timer wheel to the next slot that holds timers, without going
+  past a given slot.  Empty slots and epochs are skipped at once, so catching
+  up after a long time without timer interrupts costs no more than the
+  timers that expired.  When the wheel enters a new epoch, the timers of that
+  epoch are moved from the overflow list into the wheel.
+
+  @param  LastSlot               The slot of the current system time, after
+                                 the slot the wheel is at
+
+**/
+VOID
+CoreAdvanceTimerWheel (
+  IN UINT64  LastSlot
+  )
+{
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+  UINT64          Epoch;
+  UINT64          EpochLast;
+  UINT64          Slot;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+  ASSERT (LastSlot > mEfiTimerWheelCursor);
+
+  EpochLast = mEfiTimerWheelCursor | TIMER_WHEEL_SLOT_MASK;
+  if (mEfiTimerWheelCursor < EpochLast) {
+    Slot = CoreFindTimerWheelSlot (mEfiTimerWheelCursor + 1, MIN (LastSlot, EpochLast));
+    if (Slot != MAX_UINT64) {
+      mEfiTimerWheelCursor = Slot;
+      return;
+    }
+
+    if (LastSlot <= EpochLast) {
+      mEfiTimerWheelCursor = LastSlot;
+      return;
+    }
+  }
+
+  //
+  // The rest of the epoch is empty.  Go to the epoch of the earliest
+  // overflow timer, or of LastSlot if it comes first.  Every overflow timer
+  // is due after the current epoch.
+  //
+  Slot = LastSlot;
+  for (Link = mEfiTimerOverflowList.ForwardLink; Link != &mEfiTimerOverflowList; Link = Link->ForwardLink) {
+    Event = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    if (RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_SLOT_SHIFT) < Slot) {
+      Slot = RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_SLOT_SHIFT);
+    }
+  }
+
+  mEfiTimerWheelCursor = Slot & ~(UINT64)TIMER_WHEEL_SLOT_MASK;
+
+  Epoch = RShiftU64 (mEfiTimerWheelCursor, TIMER_WHEEL_SIZE_SHIFT);
+  Link  = mEfiTimerOverflowList.ForwardLink;
+  while (Link != &mEfiTimerOverflowList) {
+    Event = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    Link  = Link->ForwardLink;
+
+    if (RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_SLOT_SHIFT + TIMER_WHEEL_SIZE_SHIFT) <= Epoch) {
+      RemoveEntryList (&Event->Timer.Link);
+      CoreInsertEventTimer (Event);
+    }
+  }
+}
+
+/**
+  Recomputes the trigger time of the earliest timer in the timer database.
+
+**/
+VOID
+CoreUpdateNextTimerTrigger (
+  VOID
+  )
+{
+  UINT64          Slot;
+  UINT64          NextEpoch;
+  LIST_ENTRY      *Head;
+  IEVENT          *Event;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+
+  NextEpoch = RShiftU64 (mEfiTimerWheelCursor, TIMER_WHEEL_SIZE_SHIFT) + 1;
+  Slot      = CoreFindTimerWheelSlot (mEfiTimerWheelCursor, mEfiTimerWheelCursor | TIMER_WHEEL_SLOT_MASK);
+  if (Slot != MAX_UINT64) {
+    Head  = &mEfiTimerWheel[(UINTN)Slot & TIMER_WHEEL_SLOT_MASK];
+    Event = CR (Head->ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    mEfiTimerNextTrigger = Event->Timer.TriggerTime;
+    return;
+  }
+
+  //
+  // Nothing is queued in the current epoch.  If there are overflow timers,
+  // wake up at the start of the next epoch to move them into the wheel.
+  //
+  if (IsListEmpty (&mEfiTimerOverflowList)) {
+    mEfiTimerNextTrigger = MAX_UINT64;
+  } else {
+    mEfiTimerNextTrigger = LShiftU64 (NextEpoch, TIMER_WHEEL_SLOT_SHIFT + TIMER_WHEEL_SIZE_SHIFT);
+  }
 }
 
 /**
@@ -82,7 +289,7 @@ CoreCurrentSystemTime (
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Checks the timer wheel against the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -97,61 +304,148 @@ CoreCheckTimers (
   )
 {
   UINT64                  SystemTime;
+  UINT64                  CurrentSlot;
+  LIST_ENTRY              *Head;
   IEVENT                  *Event;
 
   //
   // Check the timer database for expired timers
   //
   CoreAcquireLock (&mEfiTimerLock);
-  SystemTime = CoreCurrentSystemTime ();
+  SystemTime  = CoreCurrentSystemTime ();
+  CurrentSlot = RShiftU64 (SystemTime, TIMER_WHEEL_SLOT_SHIFT);
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  //
+  // Walk the slots that hold timers from the last processed slot up to the
+  // current time.  Every timer in a slot before the current one has expired,
+  // so the timers are signaled in ascending trigger time order.
+  //
+  while (TRUE) {
+    Head = &mEfiTimerWheel[(UINTN)mEfiTimerWheelCursor & TIMER_WHEEL_SLOT_MASK];
 
-    //
-    // If this timer is not expired, then we're done
-    //
-    if (Event->Timer.TriggerTime > SystemTime) {
-      break;
-    }
+    while (!IsListEmpty (Head)) {
+      Event = CR (Head->ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
-    //
-    // Remove this timer from the timer queue
-    //
+      //
+      // If this timer is not expired, then we're done
+      //
+      if (Event->Timer.TriggerTime > SystemTime) {
+        break;
+      }
 
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
+      //
+      // Remove this timer from the timer queue
+      //
 
-    //
-    // Signal it
-    //
-    CoreSignalEvent (Event);
+      RemoveEntryList (&Event->Timer.Link);
+      Event->Timer.Link.ForwardLink = NULL;
 
-    //
-    // If this is a periodic timer, set it
-    //
-    if (Event->Timer.Period != 0) {
       //
-      // Compute the timers new trigger time
+      // Signal it
       //
-      Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+      CoreSignalEvent (Event);
 
       //
-      // If that's before now, then reset the timer to start from now
+      // If this is a periodic timer, set it
       //
-      if (Event->Timer.TriggerTime <= SystemTime) {
-        Event->Timer.TriggerTime = SystemTime;
-        CoreSignalEvent (mEfiCheckTimerEvent);
+      if (Event->Timer.Period != 0) {
+        //
+        // Compute the timers new trigger time
+        //
+        Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+
+        //
+        // If that's before now, then reset the timer to start from now
+        //
+        if (Event->Timer.TriggerTime <= SystemTime) {
+          Event->Timer.TriggerTime = SystemTime;
+          CoreSignalEvent (mEfiCheckTimerEvent);
+        }
+
+        //
+        // Add the timer
+        //
+        CoreInsertEventTimer (Event);
       }
+    }
 
-      //
-      // Add the timer
-      //
-      CoreInsertEventTimer (Event);
+    if (mEfiTimerWheelCursor >= CurrentSlot) {
+      break;
     }
+
+    CoreAdvanceTimerWheel (CurrentSlot);
+  }
+
+  CoreUpdateNextTimerTrigger ();
+
+  CoreReleaseLock (&mEfiTimerLock);
+}
+
+
+/**
+  Called before the core signals the idle event.  If no timer event is due
+  within the regular timer period, reprogram the timer interrupt to fire at
+  the next timer deadline so that the idle CPU is not woken up by ticks that
+  have nothing to process.
+
+**/
+VOID
+CoreTimerEnterIdle (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Period;
+  UINT64      NextTrigger;
+  UINT64      SystemTime;
+  UINT64      IdlePeriod;
+
+  if (PcdGet32 (PcdDxeTicklessIdleMaxPeriod) == 0 || gTimer == NULL) {
+    return;
+  }
+
+  Status = gTimer->GetTimerPeriod (gTimer, &Period);
+  if (EFI_ERROR (Status) || Period == 0) {
+    return;
   }
 
+  CoreAcquireLock (&mEfiTimerLock);
+  NextTrigger = mEfiTimerNextTrigger;
+  SystemTime  = CoreCurrentSystemTime ();
   CoreReleaseLock (&mEfiTimerLock);
+
+  if (NextTrigger <= SystemTime + Period) {
+    return;
+  }
+
+  IdlePeriod = MIN (NextTrigger - SystemTime, PcdGet32 (PcdDxeTicklessIdleMaxPeriod));
+  if (IdlePeriod <= Period) {
+    return;
+  }
+
+  Status = gTimer->SetTimerPeriod (gTimer, IdlePeriod);
+  if (!EFI_ERROR (Status)) {
+    mEfiTicklessSavedPeriod = Period;
+  }
+}
+
+
+/**
+  Called after the idle event has been signaled.  Restores the regular timer
+  period if it was changed by CoreTimerEnterIdle().
+
+**/
+VOID
+CoreTimerExitIdle (
+  VOID
+  )
+{
+  if (mEfiTicklessSavedPeriod == 0) {
+    return;
+  }
+
+  gTimer->SetTimerPeriod (gTimer, mEfiTicklessSavedPeriod);
+  mEfiTicklessSavedPeriod = 0;
 }
 
 
@@ -165,6 +459,11 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < TIMER_WHEEL_SIZE; Index++) {
+    InitializeListHead (&mEfiTimerWheel[Index]);
+  }
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -191,8 +490,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -204,15 +501,11 @@ CoreTimerTick (
   mEfiSystemTime += Duration;
 
   //
-  // If the head of the list is expired, fire the timer event
+  // If the earliest timer may have expired, fire the timer event
   // to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
-    }
+  if (mEfiTimerNextTrigger <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -282,6 +575,21 @@ CoreSetTimer (
     }
 
     Event->Timer.TriggerTime = CoreCurrentSystemTime () + TriggerTime;
+
+    //
+    // Round the trigger time up to the timer slack, so that timers with
+    // nearby deadlines are coalesced into the same timer interrupt
+    //
+    if (TriggerTime != 0 && PcdGet32 (PcdDxeTimerSlack) != 0) {
+      Event->Timer.TriggerTime = MultU64x32 (
+                                   DivU64x32 (
+                                     Event->Timer.TriggerTime + PcdGet32 (PcdDxeTimerSlack) - 1,
+                                     PcdGet32 (PcdDxeTimerSlack)
+                                     ),
+                                   PcdGet32 (PcdDxeTimerSlack)
+                                   );
+    }
+
     CoreInsertEventTimer (Event);
 
     if (TriggerTime == 0) {
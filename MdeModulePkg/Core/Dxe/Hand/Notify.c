@@ -24,11 +24,27 @@ CoreNotifyProtocolEntry (
 {
   PROTOCOL_NOTIFY     *ProtNotify;
   LIST_ENTRY          *Link;
+  IEVENT              *Event;
 
   ASSERT_LOCKED (&gProtocolDatabaseLock);
 
   for (Link=ProtEntry->Notify.ForwardLink; Link != &ProtEntry->Notify; Link=Link->ForwardLink) {
     ProtNotify = CR(Link, PROTOCOL_NOTIFY, Link, PROTOCOL_NOTIFY_SIGNATURE);
+    if (PcdGetBool (PcdPerformanceDeepProfileEnable) &&
+        LogPerformanceMeasurementEnabled (PERF_GENERAL_TYPE)) {
+      //
+      // Tie the notification function, which is measured when the event is
+      // dispatched, to the protocol that triggered it.
+      //
+      Event = (IEVENT *) ProtNotify->Event;
+      LogPerformanceMeasurement (
+        Event->NotifyFunction,
+        &ProtEntry->ProtocolID,
+        NULL,
+        (UINT64) (UINTN) Event->NotifyFunction,
+        PERF_PROTOCOL_NOTIFY_ID
+        );
+    }
     CoreSignalEvent (ProtNotify->Event);
   }
 }
@@ -0,0 +1,83 @@
+/** @file
+  Debug log ring, an in-memory buffer that DEBUG() messages are written into
+  so that they can be sent to the serial port later.
+
+  The ring is allocated by DebugLogRingDxe and published in the EFI System
+  Configuration Table under gEdkiiDebugLogRingGuid. Installing it signals the
+  gEdkiiDebugLogRingGuid event group, so writers need not search the table
+  for every message. Any number of writers (DxeDebugLibBufferedSerialPort)
+  append records to it without taking a lock, and a single reader drains it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __DEBUG_LOG_RING_H__
+#define __DEBUG_LOG_RING_H__
+
+#define EDKII_DEBUG_LOG_RING_GUID \
+  { 0xa9e2bf63, 0x9dc9, 0x4970, { 0x9b, 0xf4, 0x46, 0x0f, 0x5e, 0xb0, 0x8f, 0x1f } }
+
+#define EDKII_DEBUG_LOG_RING_SIGNATURE  SIGNATURE_32 ('D', 'L', 'O', 'G')
+
+//
+// Each record starts with a UINT32 header holding the length of the message
+// that follows it. A writer first reserves the whole record by moving Head,
+// then copies the message, and sets EDKII_DEBUG_LOG_RING_RECORD_VALID in the
+// header last. The reader stops at the first header without the bit, and
+// clears each record it drained before moving Tail past it.
+//
+// Records are padded to a multiple of EDKII_DEBUG_LOG_RING_ALIGNMENT bytes so
+// that a header never wraps around the end of the ring. The message itself
+// may wrap.
+//
+#define EDKII_DEBUG_LOG_RING_RECORD_VALID  BIT31
+#define EDKII_DEBUG_LOG_RING_ALIGNMENT     sizeof (UINT32)
+
+/**
+  Copy all complete records in the ring to the serial port.
+
+  Only one caller drains the ring at a time. If the ring is already being
+  drained, for example by code that was interrupted, this returns at once.
+
+**/
+typedef
+VOID
+(EFIAPI *EDKII_DEBUG_LOG_RING_FLUSH) (
+  VOID
+  );
+
+typedef struct {
+  UINT32                      Signature;
+  ///
+  /// Size of the data area, in bytes. It is a power of two.
+  ///
+  UINT32                      Size;
+  ///
+  /// Free running byte offsets of the next record to reserve and of the next
+  /// record to drain. Head - Tail bytes of the data area are in use.
+  ///
+  volatile UINT32             Head;
+  volatile UINT32             Tail;
+  ///
+  /// Number of messages dropped because the ring was full.
+  ///
+  volatile UINT32             Dropped;
+  ///
+  /// Non-zero while the ring is being drained.
+  ///
+  volatile UINT32             Draining;
+  ///
+  /// Cleared once the ring may no longer be used, at ExitBootServices().
+  /// Writers then send their messages to the serial port directly.
+  ///
+  volatile BOOLEAN            Enabled;
+  EDKII_DEBUG_LOG_RING_FLUSH  Flush;
+  //
+  // UINT8                    Data[Size];
+  //
+} EDKII_DEBUG_LOG_RING;
+
+extern EFI_GUID gEdkiiDebugLogRingGuid;
+
+#endif
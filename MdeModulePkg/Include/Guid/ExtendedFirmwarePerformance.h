@@ -45,6 +45,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define FPDT_GUID_QWORD_EVENT_TYPE         0x1013
 #define FPDT_GUID_QWORD_STRING_EVENT_TYPE  0x1014
 
+//
+// Progress identifiers of the records that DxeCore adds when
+// PcdPerformanceDeepProfileEnable is TRUE.
+//
+#define PERF_EVENT_NOTIFY_START_ID      0x60  ///< Event notification function call
+#define PERF_EVENT_NOTIFY_END_ID        0x61
+#define PERF_PROTOCOL_NOTIFY_ID         0x70  ///< Protocol notification event signaled
+
 //
 // EDKII extended Fpdt record structures
 //
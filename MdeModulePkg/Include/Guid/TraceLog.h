@@ -0,0 +1,126 @@
+/** @file
+  Binary trace log, a ring of fixed size records that TRACE() writes into
+  without formatting the message.
+
+  Each record holds the GUID of the module that wrote it, the address of the
+  format string and the raw arguments. The message is only rendered later, on
+  the host, by BaseTools/Scripts/DecodeTraceLog.py, which reads the format
+  string from the module's image in the build directory.
+
+  There is one log for each boot phase. The PEI log lives in a GUIDed HOB
+  (gEdkiiTraceLogHobGuid). The first DXE module that traces copies it into
+  runtime memory, allocates the DXE log, and publishes both in the EFI System
+  Configuration Table under gEdkiiTraceLogTableGuid, so that they can still be
+  found after the OS has booted.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TRACE_LOG_H__
+#define __TRACE_LOG_H__
+
+#define EDKII_TRACE_LOG_HOB_GUID \
+  { 0x5f870959, 0xa09c, 0x446d, { 0x94, 0x99, 0x8e, 0x6b, 0xce, 0x1b, 0xd4, 0x6f } }
+
+#define EDKII_TRACE_LOG_TABLE_GUID \
+  { 0x495bd7e5, 0xe2ef, 0x436c, { 0xab, 0xe1, 0x38, 0xb5, 0xd3, 0x48, 0x7a, 0x3c } }
+
+#define TRACE_LOG_SIGNATURE        SIGNATURE_32 ('T', 'L', 'O', 'G')
+#define TRACE_LOG_TABLE_SIGNATURE  SIGNATURE_32 ('T', 'L', 'T', 'B')
+
+#define TRACE_LOG_PHASE_PEI    0
+#define TRACE_LOG_PHASE_DXE    1
+#define TRACE_LOG_PHASE_COUNT  2
+
+//
+// Number of arguments kept in each record. Arguments past this are dropped,
+// and ArgCount tells the decoder how many there were.
+//
+#define TRACE_LOG_MAX_ARGS  5
+
+typedef struct {
+  GUID                  ModuleGuid;
+  ///
+  /// Address that offset 0 of the module's .efi file was loaded at, so that
+  /// the offset of any string in the image is its address minus ImageBase.
+  /// For a TE image this is below the start of the TE header.
+  ///
+  EFI_PHYSICAL_ADDRESS  ImageBase;
+} TRACE_LOG_MODULE;
+
+//
+// A writer claims a record by incrementing Head, and owns record
+// (Head - 1) % RecordCount. It clears Sequence, fills in the record, and sets
+// Sequence to the new value of Head last, so a reader can tell a complete
+// record from one that is being written or was overwritten.
+//
+typedef struct {
+  volatile UINT32       Sequence;
+  UINT32                ErrorLevel;
+  GUID                  ModuleGuid;
+  ///
+  /// Address of the format string. The module that wrote the record is
+  /// listed in the log's module table with the address it was loaded at.
+  ///
+  EFI_PHYSICAL_ADDRESS  Format;
+  ///
+  /// Value of GetPerformanceCounter() when the record was written.
+  ///
+  UINT64                TimeStamp;
+  ///
+  /// Number of arguments the format string consumed. Only the first
+  /// TRACE_LOG_MAX_ARGS of them are kept.
+  ///
+  UINT32                ArgCount;
+  UINT32                Reserved;
+  ///
+  /// Arguments as the format string consumes them. Values narrower than
+  /// 64 bits are sign extended if they were passed as int.
+  ///
+  UINT64                Args[TRACE_LOG_MAX_ARGS];
+} TRACE_LOG_RECORD;
+
+//
+// Each module that links TraceLib adds itself to the module table of the log
+// when it starts, and again if it is started from another address, such as a
+// PEIM that is shadowed to memory. Modules that do not fit are not added, and
+// their records cannot be decoded.
+//
+typedef struct {
+  UINT32                Signature;
+  UINT32                Phase;
+  UINT32                ModuleCount;
+  volatile UINT32       ModuleHead;
+  UINT32                RecordCount;
+  ///
+  /// Number of records ever claimed. The latest RecordCount of them are in
+  /// the log.
+  ///
+  volatile UINT32       Head;
+  UINT64                PerformanceCounterFrequency;
+  //
+  // TRACE_LOG_MODULE   Modules[ModuleCount];
+  // TRACE_LOG_RECORD   Records[RecordCount];
+  //
+} TRACE_LOG_HEADER;
+
+#define TRACE_LOG_SIZE(ModuleCount, RecordCount) \
+  (sizeof (TRACE_LOG_HEADER) + \
+   (ModuleCount) * sizeof (TRACE_LOG_MODULE) + \
+   (RecordCount) * sizeof (TRACE_LOG_RECORD))
+
+typedef struct {
+  UINT32                Signature;
+  UINT32                LogCount;
+  ///
+  /// Address of the TRACE_LOG_HEADER of each phase, indexed by
+  /// TRACE_LOG_PHASE_*, or 0 if that phase did not trace.
+  ///
+  EFI_PHYSICAL_ADDRESS  Log[TRACE_LOG_PHASE_COUNT];
+} TRACE_LOG_TABLE;
+
+extern EFI_GUID gEdkiiTraceLogHobGuid;
+extern EFI_GUID gEdkiiTraceLogTableGuid;
+
+#endif
@@ -0,0 +1,70 @@
+/** @file
+  Binary trace log library class.
+
+  TRACE() takes the same arguments as DEBUG(), but instead of formatting the
+  message it stores the format string's location and the raw arguments in an
+  in-memory log. This costs about as much as a few memory writes, so it can be
+  left enabled in release builds. BaseTools/Scripts/DecodeTraceLog.py renders
+  the messages from a memory dump.
+
+  Only the format string is known to the decoder: arguments consumed by %a,
+  %s, %S, %g and %t are recorded as the pointer, not the data it points to.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TRACE_LIB_H__
+#define __TRACE_LIB_H__
+
+/**
+  Returns TRUE if TRACE() records messages.
+
+  @retval  TRUE    The trace log is enabled.
+  @retval  FALSE   The trace log is disabled.
+
+**/
+BOOLEAN
+EFIAPI
+TraceLogEnabled (
+  VOID
+  );
+
+/**
+  Records a message in the trace log of the current boot phase.
+
+  The message is recorded only if ErrorLevel has a bit set in
+  PcdTraceLogErrorLevel. Format must be a literal string in the calling module
+  because only its address is kept.
+
+  @param  ErrorLevel  The error level of the message.
+  @param  Format      Format string for the message, as for DebugPrint().
+  @param  ...         Variable argument list whose contents are accessed
+                      based on the format string specified by Format.
+
+**/
+VOID
+EFIAPI
+TraceLogWrite (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  );
+
+/**
+  Macro that records a message in the trace log.
+
+  For example: TRACE ((DEBUG_INFO, "Found %d devices\n", Count));
+
+  @param  Expression  Expression containing an error level, a format string,
+                      and a variable argument list based on the format string.
+
+**/
+#define TRACE(Expression)        \
+  do {                           \
+    if (TraceLogEnabled ()) {    \
+      TraceLogWrite Expression;  \
+    }                            \
+  } while (FALSE)
+
+#endif
@@ -0,0 +1,108 @@
+/** @file
+  EDKII Packed RAM Disk Protocol.
+
+  The RAM disk driver produces this protocol next to the EFI_RAM_DISK_PROTOCOL.
+  It creates RAM disks whose content is held by the driver in a packed form:
+  blocks that are all zero take no memory, and the other blocks are
+  compressed. This lets a large image be used as a RAM disk without a flat
+  copy of the image in memory.
+
+  A packed RAM disk is only visible to boot services, and is never published
+  in the NFIT. A RAM disk that the OS needs must be registered with the
+  EFI_RAM_DISK_PROTOCOL instead. Packed RAM disks are unregistered with the
+  EFI_RAM_DISK_PROTOCOL.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __PACKED_RAM_DISK_H__
+#define __PACKED_RAM_DISK_H__
+
+#include <Protocol/DevicePath.h>
+
+#define EDKII_PACKED_RAM_DISK_PROTOCOL_GUID \
+  { \
+    0x0c301c26, 0xa651, 0x4b7d, { 0x96, 0x3a, 0x31, 0xef, 0x24, 0xe9, 0x9f, 0x87 } \
+  }
+
+typedef struct _EDKII_PACKED_RAM_DISK_PROTOCOL EDKII_PACKED_RAM_DISK_PROTOCOL;
+
+/**
+  Register a packed RAM disk of the specified size and type.
+
+  The RAM disk reads as all zeros until data is written to it. It is not
+  connected: the caller writes the content of the disk with Write(), then
+  connects the handle of the returned device path.
+
+  @param  This                  The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param  RamDiskSize           The size of the RAM disk, in bytes.
+  @param  RamDiskType           The type of the RAM disk. The GUID can be any
+                                of the values defined in section 9.3.6.9, or a
+                                vendor defined GUID.
+  @param  ParentDevicePath      Pointer to the parent device path, or NULL if
+                                there is no parent device path.
+  @param  DevicePath            On return, points to the device path of the RAM
+                                disk, created the same way as by
+                                EFI_RAM_DISK_PROTOCOL.Register(). The buffer is
+                                allocated with the boot service AllocatePool().
+
+  @retval EFI_SUCCESS           The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER DevicePath or RamDiskType is NULL, or
+                                RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED   A RAM disk with the same device path is
+                                already registered.
+  @retval EFI_OUT_OF_RESOURCES  The RAM disk could not be registered.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PACKED_RAM_DISK_REGISTER)(
+  IN  EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  );
+
+/**
+  Write data to a packed RAM disk.
+
+  Unlike the EFI_BLOCK_IO_PROTOCOL of the RAM disk, the data does not have to
+  be aligned on blocks.
+
+  @param  This                  The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param  DevicePath            The device path of the RAM disk.
+  @param  Offset                The offset in the RAM disk to write to.
+  @param  Length                The number of bytes to write.
+  @param  Buffer                The data to write.
+
+  @retval EFI_SUCCESS           The data is written.
+  @retval EFI_INVALID_PARAMETER A parameter is NULL, or the data goes past the
+                                end of the RAM disk.
+  @retval EFI_NOT_FOUND         DevicePath is not a packed RAM disk.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory to hold the data.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PACKED_RAM_DISK_WRITE)(
+  IN EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN UINT64                          Offset,
+  IN UINTN                           Length,
+  IN VOID                            *Buffer
+  );
+
+///
+/// The EDKII_PACKED_RAM_DISK_PROTOCOL creates RAM disks that do not need a
+/// flat copy of their content in memory.
+///
+struct _EDKII_PACKED_RAM_DISK_PROTOCOL {
+  EDKII_PACKED_RAM_DISK_REGISTER  Register;
+  EDKII_PACKED_RAM_DISK_WRITE     Write;
+};
+
+extern EFI_GUID gEdkiiPackedRamDiskProtocolGuid;
+
+#endif
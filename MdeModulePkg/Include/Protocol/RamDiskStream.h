@@ -0,0 +1,151 @@
+/** @file
+  EDKII RAM Disk Stream Protocol.
+
+  The RAM disk driver produces this protocol next to the EFI_RAM_DISK_PROTOCOL.
+  It registers RAM disks whose content is still being produced, for example
+  while the image is downloaded. Reads and writes of the RAM disk wait for the
+  producer to fill the blocks they touch, so the boot loader on the RAM disk
+  can start before the whole image is there.
+
+  A streamed RAM disk is only published in the NFIT once EndStream() reports
+  its whole content, so the OS never gets a partial image. Streamed RAM disks
+  are unregistered with the EFI_RAM_DISK_PROTOCOL.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __RAM_DISK_STREAM_H__
+#define __RAM_DISK_STREAM_H__
+
+#include <Protocol/DevicePath.h>
+
+#define EDKII_RAM_DISK_STREAM_PROTOCOL_GUID \
+  { \
+    0x5b1f8e62, 0x3c0d, 0x4a59, { 0x8e, 0x27, 0xd4, 0x61, 0x0b, 0x9c, 0x7a, 0x13 } \
+  }
+
+typedef struct _EDKII_RAM_DISK_STREAM_PROTOCOL EDKII_RAM_DISK_STREAM_PROTOCOL;
+typedef struct _EDKII_RAM_DISK_PRODUCER        EDKII_RAM_DISK_PRODUCER;
+
+/**
+  Wait until a range of a streamed RAM disk holds its content.
+
+  The RAM disk driver calls this function before it reads or writes the range.
+  It may be called at TPL_CALLBACK or lower.
+
+  @param  This                  The producer of the RAM disk.
+  @param  Offset                The offset of the range in the RAM disk.
+  @param  Length                The length of the range, in bytes.
+
+  @retval EFI_SUCCESS           The range holds its content.
+  @retval Others                The content of the range can't be produced.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_RAM_DISK_PRODUCER_FILL)(
+  IN EDKII_RAM_DISK_PRODUCER  *This,
+  IN UINT64                   Offset,
+  IN UINT64                   Length
+  );
+
+/**
+  Tell the producer that its RAM disk is being unregistered.
+
+  The producer must stop writing to the memory of the RAM disk before it
+  returns. It is not called again for this RAM disk.
+
+  @param  This                  The producer of the RAM disk.
+
+**/
+typedef
+VOID
+(EFIAPI *EDKII_RAM_DISK_PRODUCER_RELEASE)(
+  IN EDKII_RAM_DISK_PRODUCER  *This
+  );
+
+///
+/// The producer of the content of a streamed RAM disk.
+///
+struct _EDKII_RAM_DISK_PRODUCER {
+  EDKII_RAM_DISK_PRODUCER_FILL     Fill;
+  EDKII_RAM_DISK_PRODUCER_RELEASE  Release;
+};
+
+/**
+  Register a flat RAM disk whose content is still being produced.
+
+  The RAM disk is registered and connected the same way as by
+  EFI_RAM_DISK_PROTOCOL.Register(), but its reads and writes first call
+  Producer->Fill() for the range they touch, and it is not published in the
+  NFIT yet. This goes on until EndStream() is called, or the RAM disk is
+  unregistered, in which case Producer->Release() is called first.
+
+  @param  This                  The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param  RamDiskBase           The base address of the RAM disk.
+  @param  RamDiskSize           The size of the RAM disk, in bytes.
+  @param  RamDiskType           The type of the RAM disk.
+  @param  ParentDevicePath      Pointer to the parent device path, or NULL if
+                                there is no parent device path.
+  @param  Producer              The producer of the content of the RAM disk.
+  @param  DevicePath            On return, points to the device path of the RAM
+                                disk. The buffer is allocated with the boot
+                                service AllocatePool().
+
+  @retval EFI_SUCCESS           The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER A parameter is NULL, or RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED   A RAM disk with the same device path is
+                                already registered.
+  @retval EFI_OUT_OF_RESOURCES  The RAM disk could not be registered.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_RAM_DISK_STREAM_REGISTER)(
+  IN  EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN  UINT64                          RamDiskBase,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  IN  EDKII_RAM_DISK_PRODUCER         *Producer,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  );
+
+/**
+  Detach the producer from a streamed RAM disk, once its whole content is
+  produced or when the producer goes away.
+
+  A complete RAM disk is published in the NFIT as by
+  EFI_RAM_DISK_PROTOCOL.Register(). The reads and writes of an incomplete RAM
+  disk fail from now on, and it is never published.
+
+  @param  This                  The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param  DevicePath            The device path of the RAM disk.
+  @param  Complete              TRUE if the whole content has been produced.
+
+  @retval EFI_SUCCESS           The producer is detached.
+  @retval EFI_INVALID_PARAMETER DevicePath is NULL.
+  @retval EFI_NOT_FOUND         DevicePath is not a streamed RAM disk.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_RAM_DISK_STREAM_END)(
+  IN EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN BOOLEAN                         Complete
+  );
+
+///
+/// The EDKII_RAM_DISK_STREAM_PROTOCOL registers RAM disks whose content is
+/// still being produced.
+///
+struct _EDKII_RAM_DISK_STREAM_PROTOCOL {
+  EDKII_RAM_DISK_STREAM_REGISTER  RegisterStream;
+  EDKII_RAM_DISK_STREAM_END       EndStream;
+};
+
+extern EFI_GUID gEdkiiRamDiskStreamProtocolGuid;
+
+#endif
@@ -0,0 +1,195 @@
+/** @file
+  EDKII USB2 Host Controller Streams Protocol.
+
+  A USB host controller driver produces this protocol next to the
+  EFI_USB2_HC_PROTOCOL when it can queue bulk transfers without waiting for
+  them, and can set up the bulk streams of USB 3.x devices.
+
+  Queued transfers are polled for completion by the caller, so that several
+  transfers can be in flight on different endpoints and streams at the same
+  time. This is used by the USB Attached SCSI transport.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __USB2_HC_STREAMS_H__
+#define __USB2_HC_STREAMS_H__
+
+#include <Protocol/Usb2HostController.h>
+
+#define EDKII_USB2_HC_STREAMS_PROTOCOL_GUID \
+  { \
+    0xe1eaa659, 0x7287, 0x4933, { 0x90, 0xae, 0x81, 0x97, 0xf4, 0xef, 0x78, 0xdc } \
+  }
+
+typedef struct _EDKII_USB2_HC_STREAMS_PROTOCOL EDKII_USB2_HC_STREAMS_PROTOCOL;
+
+/**
+  Allocate streams for bulk endpoints of a SuperSpeed device.
+
+  All the endpoints get the same number of streams. Stream IDs 1 to
+  *StreamCount are valid for SubmitBulkTransfer() once this function returns.
+  Synchronous bulk transfers are not allowed on the endpoints until the
+  streams are freed.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  DeviceSpeed           The device speed.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+  @param  StreamCount           On input, the number of streams the device
+                                supports on each endpoint. On output, the
+                                number of streams allocated, which may be
+                                smaller.
+
+  @retval EFI_SUCCESS           The streams are allocated.
+  @retval EFI_UNSUPPORTED       The device is not a SuperSpeed device, or the
+                                host controller doesn't support streams.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid, or an endpoint already
+                                has streams.
+  @retval EFI_DEVICE_ERROR      The host controller failed to set up the streams.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB2_HC_ALLOCATE_STREAMS)(
+  IN     EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN     UINT8                           DeviceAddress,
+  IN     UINT8                           DeviceSpeed,
+  IN     UINT8                           *EndpointAddresses,
+  IN     UINTN                           EndpointCount,
+  IN OUT UINT16                          *StreamCount
+  );
+
+/**
+  Free the streams of bulk endpoints, and return the endpoints to normal
+  bulk transfers.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS           The streams are freed.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid.
+  @retval EFI_DEVICE_ERROR      The host controller failed to reconfigure the
+                                endpoints.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB2_HC_FREE_STREAMS)(
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN UINT8                           DeviceAddress,
+  IN UINT8                           *EndpointAddresses,
+  IN UINTN                           EndpointCount
+  );
+
+/**
+  Queue a bulk transfer and return without waiting for it to complete.
+
+  Several transfers may be queued on the same endpoint and stream. They
+  complete in the order they are queued.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  DeviceAddress         The USB device address.
+  @param  EndPointAddress       The bulk endpoint address, with the direction
+                                in bit 7.
+  @param  DeviceSpeed           The device speed.
+  @param  MaximumPacketLength   The maximum packet size of the endpoint.
+  @param  StreamId              The stream of the transfer, or 0 for an
+                                endpoint without streams.
+  @param  Data                  The data buffer. It must stay valid until the
+                                transfer completes or is cancelled.
+  @param  DataLength            The length of the data buffer, in bytes.
+  @param  Translator            The transaction translator of the device.
+  @param  Transfer              Returns the handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is queued.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid.
+  @retval EFI_NOT_READY         The transfers already queued on the endpoint
+                                and stream leave no room for this one.
+  @retval EFI_OUT_OF_RESOURCES  The transfer could not be queued.
+  @retval EFI_DEVICE_ERROR      The host controller or the device is not usable.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB2_HC_SUBMIT_BULK_TRANSFER)(
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL      *This,
+  IN  UINT8                               DeviceAddress,
+  IN  UINT8                               EndPointAddress,
+  IN  UINT8                               DeviceSpeed,
+  IN  UINTN                               MaximumPacketLength,
+  IN  UINT16                              StreamId,
+  IN  VOID                                *Data,
+  IN  UINTN                               DataLength,
+  IN  EFI_USB2_HC_TRANSACTION_TRANSLATOR  *Translator,
+  OUT VOID                                **Transfer
+  );
+
+/**
+  Check whether a queued bulk transfer is complete.
+
+  The transfer handle is freed when this function returns any status other
+  than EFI_NOT_READY.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+  @param  DataLength            Returns the number of bytes transferred.
+  @param  TransferResult        Returns the result of the transfer, as the
+                                EFI_USB_ERR_* bits of EFI_USB2_HC_PROTOCOL.
+
+  @retval EFI_SUCCESS           The transfer completed successfully.
+  @retval EFI_NOT_READY         The transfer is still in progress.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The transfer failed.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB2_HC_POLL_BULK_TRANSFER)(
+  IN  EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN  VOID                            *Transfer,
+  OUT UINTN                           *DataLength,
+  OUT UINT32                          *TransferResult
+  );
+
+/**
+  Cancel a queued bulk transfer, and free its handle.
+
+  Cancelling a transfer also drops the other transfers still in progress on
+  the same endpoint and stream, as does a transfer that fails with a stall.
+  Those complete with EFI_USB_ERR_NOTEXECUTE.
+
+  @param  This                  The EDKII_USB2_HC_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is cancelled.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The host controller failed to stop the transfer.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB2_HC_CANCEL_BULK_TRANSFER)(
+  IN EDKII_USB2_HC_STREAMS_PROTOCOL  *This,
+  IN VOID                            *Transfer
+  );
+
+///
+/// The EDKII_USB2_HC_STREAMS_PROTOCOL queues bulk transfers on the endpoints
+/// and streams of the devices behind a USB host controller.
+///
+struct _EDKII_USB2_HC_STREAMS_PROTOCOL {
+  EDKII_USB2_HC_ALLOCATE_STREAMS      AllocateStreams;
+  EDKII_USB2_HC_FREE_STREAMS          FreeStreams;
+  EDKII_USB2_HC_SUBMIT_BULK_TRANSFER  SubmitBulkTransfer;
+  EDKII_USB2_HC_POLL_BULK_TRANSFER    PollBulkTransfer;
+  EDKII_USB2_HC_CANCEL_BULK_TRANSFER  CancelBulkTransfer;
+};
+
+extern EFI_GUID gEdkiiUsb2HcStreamsProtocolGuid;
+
+#endif
@@ -0,0 +1,176 @@
+/** @file
+  EDKII USB I/O Streams Protocol.
+
+  The USB bus driver produces this protocol next to the EFI_USB_IO_PROTOCOL
+  of a USB interface when the host controller produces the
+  EDKII_USB2_HC_STREAMS_PROTOCOL. It queues bulk transfers on the endpoints
+  of the interface without waiting for them, and sets up the bulk streams
+  of USB 3.x devices.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __USB_IO_STREAMS_H__
+#define __USB_IO_STREAMS_H__
+
+#define EDKII_USB_IO_STREAMS_PROTOCOL_GUID \
+  { \
+    0x93963e64, 0x6d0e, 0x43b3, { 0xab, 0xaf, 0x48, 0xfe, 0xa0, 0x35, 0x85, 0x67 } \
+  }
+
+typedef struct _EDKII_USB_IO_STREAMS_PROTOCOL EDKII_USB_IO_STREAMS_PROTOCOL;
+
+/**
+  Allocate streams for bulk endpoints of the USB interface.
+
+  All the endpoints get the same number of streams. Stream IDs 1 to
+  *StreamCount are valid for SubmitBulkTransfer() once this function returns.
+  UsbBulkTransfer() is not allowed on the endpoints until the streams are
+  freed.
+
+  @param  This                  The EDKII_USB_IO_STREAMS_PROTOCOL instance.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+  @param  StreamCount           On input, the number of streams the device
+                                supports on each endpoint. On output, the
+                                number of streams allocated, which may be
+                                smaller.
+
+  @retval EFI_SUCCESS           The streams are allocated.
+  @retval EFI_UNSUPPORTED       The device is not a SuperSpeed device, or the
+                                host controller doesn't support streams.
+  @retval EFI_INVALID_PARAMETER An endpoint is not a bulk endpoint of the
+                                interface, or already has streams.
+  @retval EFI_DEVICE_ERROR      The host controller failed to set up the streams.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_ALLOCATE_STREAMS)(
+  IN     EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN     UINT8                          *EndpointAddresses,
+  IN     UINTN                          EndpointCount,
+  IN OUT UINT16                         *StreamCount
+  );
+
+/**
+  Free the streams of bulk endpoints of the USB interface.
+
+  @param  This                  The EDKII_USB_IO_STREAMS_PROTOCOL instance.
+  @param  EndpointAddresses     The addresses of the bulk endpoints.
+  @param  EndpointCount         The number of entries in EndpointAddresses.
+
+  @retval EFI_SUCCESS           The streams are freed.
+  @retval EFI_INVALID_PARAMETER An endpoint is not a bulk endpoint of the interface.
+  @retval EFI_DEVICE_ERROR      The host controller failed to reconfigure the
+                                endpoints.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_FREE_STREAMS)(
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN UINT8                          *EndpointAddresses,
+  IN UINTN                          EndpointCount
+  );
+
+/**
+  Queue a bulk transfer and return without waiting for it to complete.
+
+  Several transfers may be queued on the same endpoint and stream. They
+  complete in the order they are queued.
+
+  @param  This                  The EDKII_USB_IO_STREAMS_PROTOCOL instance.
+  @param  Endpoint              The bulk endpoint address, with the direction
+                                in bit 7.
+  @param  StreamId              The stream of the transfer, or 0 for an
+                                endpoint without streams.
+  @param  Data                  The data buffer. It must stay valid until the
+                                transfer completes or is cancelled.
+  @param  DataLength            The length of the data buffer, in bytes.
+  @param  Transfer              Returns the handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is queued.
+  @retval EFI_INVALID_PARAMETER A parameter is invalid.
+  @retval EFI_NOT_READY         The transfers already queued on the endpoint
+                                and stream leave no room for this one.
+  @retval EFI_OUT_OF_RESOURCES  The transfer could not be queued.
+  @retval EFI_DEVICE_ERROR      The host controller or the device is not usable.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_SUBMIT_BULK_TRANSFER)(
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  UINT8                          Endpoint,
+  IN  UINT16                         StreamId,
+  IN  VOID                           *Data,
+  IN  UINTN                          DataLength,
+  OUT VOID                           **Transfer
+  );
+
+/**
+  Check whether a queued bulk transfer is complete.
+
+  The transfer handle is freed when this function returns any status other
+  than EFI_NOT_READY.
+
+  @param  This                  The EDKII_USB_IO_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+  @param  DataLength            Returns the number of bytes transferred.
+  @param  UsbStatus             Returns the result of the transfer, as the
+                                EFI_USB_ERR_* bits of EFI_USB_IO_PROTOCOL.
+
+  @retval EFI_SUCCESS           The transfer completed successfully.
+  @retval EFI_NOT_READY         The transfer is still in progress.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The transfer failed.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_POLL_BULK_TRANSFER)(
+  IN  EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN  VOID                           *Transfer,
+  OUT UINTN                          *DataLength,
+  OUT UINT32                         *UsbStatus
+  );
+
+/**
+  Cancel a queued bulk transfer, and free its handle.
+
+  Cancelling a transfer also drops the other transfers still in progress on
+  the same endpoint and stream, as does a transfer that fails with a stall.
+  Those complete with EFI_USB_ERR_NOTEXECUTE.
+
+  @param  This                  The EDKII_USB_IO_STREAMS_PROTOCOL instance.
+  @param  Transfer              The handle of the queued transfer.
+
+  @retval EFI_SUCCESS           The transfer is cancelled.
+  @retval EFI_INVALID_PARAMETER Transfer is not a queued transfer.
+  @retval EFI_DEVICE_ERROR      The host controller failed to stop the transfer.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_USB_IO_CANCEL_BULK_TRANSFER)(
+  IN EDKII_USB_IO_STREAMS_PROTOCOL  *This,
+  IN VOID                           *Transfer
+  );
+
+///
+/// The EDKII_USB_IO_STREAMS_PROTOCOL queues bulk transfers on the endpoints
+/// and streams of a USB interface.
+///
+struct _EDKII_USB_IO_STREAMS_PROTOCOL {
+  EDKII_USB_IO_ALLOCATE_STREAMS      AllocateStreams;
+  EDKII_USB_IO_FREE_STREAMS          FreeStreams;
+  EDKII_USB_IO_SUBMIT_BULK_TRANSFER  SubmitBulkTransfer;
+  EDKII_USB_IO_POLL_BULK_TRANSFER    PollBulkTransfer;
+  EDKII_USB_IO_CANCEL_BULK_TRANSFER  CancelBulkTransfer;
+};
+
+extern EFI_GUID gEdkiiUsbIoStreamsProtocolGuid;
+
+#endif
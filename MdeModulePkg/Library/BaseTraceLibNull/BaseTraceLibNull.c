@@ -0,0 +1,43 @@
+/** @file
+  Null instance of Trace Library. TRACE() does nothing.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+#include <Library/TraceLib.h>
+
+/**
+  Returns TRUE if TRACE() records messages.
+
+  @retval  FALSE   The trace log is disabled.
+
+**/
+BOOLEAN
+EFIAPI
+TraceLogEnabled (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Records a message in the trace log of the current boot phase.
+
+  @param  ErrorLevel  The error level of the message.
+  @param  Format      Format string for the message, as for DebugPrint().
+  @param  ...         Variable argument list whose contents are accessed
+                      based on the format string specified by Format.
+
+**/
+VOID
+EFIAPI
+TraceLogWrite (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+}
@@ -26,6 +26,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define STRING_SIZE             (FPDT_STRING_EVENT_RECORD_NAME_LENGTH * sizeof (CHAR8))
 #define FIRMWARE_RECORD_BUFFER  0x10000
 #define CACHE_HANDLE_GUID_COUNT 0x800
+#define CACHE_IMAGE_RANGE_COUNT 0x100
 
 BOOT_PERFORMANCE_TABLE          *mAcpiBootPerformanceTable = NULL;
 BOOT_PERFORMANCE_TABLE          mBootPerformanceTableTemplate = {
@@ -60,6 +61,15 @@ typedef struct {
 HANDLE_GUID_MAP mCacheHandleGuidTable[CACHE_HANDLE_GUID_COUNT];
 UINTN           mCachePairCount = 0;
 
+typedef struct {
+  UINT64        ImageBase;
+  UINT64        ImageSize;
+  EFI_HANDLE    Handle;
+} IMAGE_RANGE_MAP;
+
+IMAGE_RANGE_MAP mCacheImageRangeTable[CACHE_IMAGE_RANGE_COUNT];
+UINTN           mCacheImageRangeCount = 0;
+
 UINT32  mLoadImageCount       = 0;
 UINT32  mPerformanceLength    = 0;
 UINT32  mMaxPerformanceLength = 0;
@@ -636,6 +646,76 @@ Done:
   return Status;
 }
 
+/**
+  Get the image handle of the loaded image that contains the given address.
+
+  @param    Address       An address in a loaded image, such as a function address.
+
+  @return The image handle, or NULL if no loaded image contains the address.
+**/
+EFI_HANDLE
+GetImageHandleFromAddress (
+  IN UINT64  Address
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_HANDLE                  *HandleBuffer;
+  UINTN                       HandleCount;
+  UINTN                       Index;
+  EFI_LOADED_IMAGE_PROTOCOL   *LoadedImage;
+  EFI_HANDLE                  ImageHandle;
+
+  //
+  // Try to get the image handle from the cached image ranges.
+  //
+  for (Index = 0; Index < mCacheImageRangeCount; Index++) {
+    if (Address >= mCacheImageRangeTable[Index].ImageBase &&
+        Address - mCacheImageRangeTable[Index].ImageBase < mCacheImageRangeTable[Index].ImageSize) {
+      return mCacheImageRangeTable[Index].Handle;
+    }
+  }
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiLoadedImageProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &HandleBuffer
+                  );
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  ImageHandle = NULL;
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (
+                    HandleBuffer[Index],
+                    &gEfiLoadedImageProtocolGuid,
+                    (VOID **) &LoadedImage
+                    );
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    if (Address >= (UINTN) LoadedImage->ImageBase &&
+        Address - (UINTN) LoadedImage->ImageBase < LoadedImage->ImageSize) {
+      ImageHandle = HandleBuffer[Index];
+      //
+      // Cache the image range.
+      //
+      if (mCacheImageRangeCount < CACHE_IMAGE_RANGE_COUNT) {
+        mCacheImageRangeTable[mCacheImageRangeCount].ImageBase = (UINTN) LoadedImage->ImageBase;
+        mCacheImageRangeTable[mCacheImageRangeCount].ImageSize = LoadedImage->ImageSize;
+        mCacheImageRangeTable[mCacheImageRangeCount].Handle    = ImageHandle;
+        mCacheImageRangeCount ++;
+      }
+      break;
+    }
+  }
+
+  FreePool (HandleBuffer);
+  return ImageHandle;
+}
+
 /**
   Get the FPDT record identifier.
 
@@ -1124,6 +1204,49 @@ InsertFpdtRecord (
     }
     break;
 
+  case PERF_EVENT_NOTIFY_START_ID:
+  case PERF_EVENT_NOTIFY_END_ID:
+    //
+    // Address is the notification function, measured by DxeCore.
+    //
+    GetModuleInfoFromHandle (GetImageHandleFromAddress (Address), ModuleName, sizeof (ModuleName), &ModuleGuid);
+    StringPtr = ModuleName;
+    if (AsciiStrLen (StringPtr) == 0) {
+      StringPtr = "unknown name";
+    }
+    if (!PcdGetBool (PcdEdkiiFpdtStringRecordEnableOnly)) {
+      FpdtRecordPtr.GuidQwordStringEvent->Header.Type     = FPDT_GUID_QWORD_STRING_EVENT_TYPE;
+      FpdtRecordPtr.GuidQwordStringEvent->Header.Length   = sizeof (FPDT_GUID_QWORD_STRING_EVENT_RECORD);
+      FpdtRecordPtr.GuidQwordStringEvent->Header.Revision = FPDT_RECORD_REVISION_1;
+      FpdtRecordPtr.GuidQwordStringEvent->ProgressID      = PerfId;
+      FpdtRecordPtr.GuidQwordStringEvent->Timestamp       = TimeStamp;
+      FpdtRecordPtr.GuidQwordStringEvent->Qword           = Address;
+      CopyMem (&FpdtRecordPtr.GuidQwordStringEvent->Guid, &ModuleGuid, sizeof (FpdtRecordPtr.GuidQwordStringEvent->Guid));
+      CopyStringIntoPerfRecordAndUpdateLength (FpdtRecordPtr.GuidQwordStringEvent->String, StringPtr, &FpdtRecordPtr.GuidQwordStringEvent->Header.Length);
+    }
+    break;
+
+  case PERF_PROTOCOL_NOTIFY_ID:
+    //
+    // DxeCore holds the protocol database lock here, so the module of the
+    // notification function cannot be looked up. Its address is enough to
+    // match the PERF_EVENT_NOTIFY_START_ID record that follows.
+    //
+    if (Guid == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    StringPtr = "ProtocolNotify";
+    if (!PcdGetBool (PcdEdkiiFpdtStringRecordEnableOnly)) {
+      FpdtRecordPtr.GuidQwordEvent->Header.Type           = FPDT_GUID_QWORD_EVENT_TYPE;
+      FpdtRecordPtr.GuidQwordEvent->Header.Length         = sizeof (FPDT_GUID_QWORD_EVENT_RECORD);
+      FpdtRecordPtr.GuidQwordEvent->Header.Revision       = FPDT_RECORD_REVISION_1;
+      FpdtRecordPtr.GuidQwordEvent->ProgressID            = PerfId;
+      FpdtRecordPtr.GuidQwordEvent->Timestamp             = TimeStamp;
+      FpdtRecordPtr.GuidQwordEvent->Qword                 = Address;
+      CopyMem (&FpdtRecordPtr.GuidQwordEvent->Guid, Guid, sizeof (FpdtRecordPtr.GuidQwordEvent->Guid));
+    }
+    break;
+
   case PERF_EVENT_ID:
   case PERF_FUNCTION_START_ID:
   case PERF_FUNCTION_END_ID:
@@ -0,0 +1,250 @@
+/** @file
+  Constructor of the DXE Debug library instance that buffers DEBUG() messages
+  in the debug log ring, and access to that ring.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeDebugLibBufferedSerialPort.h"
+
+//
+// BOOLEAN value to indicate if it is at the post ExitBootServices phase, when
+// the ring must not be touched any more
+//
+BOOLEAN                 mPostEBS = FALSE;
+
+static EFI_EVENT        mExitBootServicesEvent;
+static EFI_EVENT        mDebugLogRingInstalledEvent;
+
+//
+// Pointer to SystemTable
+// This library instance may have a cycle consume with UefiBootServicesTableLib
+// because of the constructors.
+//
+EFI_SYSTEM_TABLE        *mDebugST;
+
+//
+// The debug log ring, once it has been installed in the EFI System
+// Configuration Table
+//
+EDKII_DEBUG_LOG_RING    *mDebugLogRing;
+
+/**
+  This routine sets the mPostEBS for exit boot servies true
+  to stop using the debug log ring, which is boot services memory.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+ExitBootServicesCallback (
+  EFI_EVENT   Event,
+  VOID*       Context
+  )
+{
+  mPostEBS = TRUE;
+  return;
+}
+
+/**
+  Look up the debug log ring in the EFI System Configuration Table.
+
+  This is called from the constructor, and whenever DebugLogRingDxe installs
+  the ring, which signals the gEdkiiDebugLogRingGuid event group. DEBUG()
+  itself never searches the table.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+DebugLogRingInstalledCallback (
+  EFI_EVENT   Event,
+  VOID*       Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mDebugST->NumberOfTableEntries; Index++) {
+    if (CompareGuid (&mDebugST->ConfigurationTable[Index].VendorGuid, &gEdkiiDebugLogRingGuid)) {
+      mDebugLogRing = mDebugST->ConfigurationTable[Index].VendorTable;
+      return;
+    }
+  }
+}
+
+/**
+  Return the debug log ring if it may be used.
+
+  @return The debug log ring, or NULL if there is no ring to use.
+
+**/
+EDKII_DEBUG_LOG_RING *
+GetDebugLogRing (
+  VOID
+  )
+{
+  if (mPostEBS || (mDebugLogRing == NULL) || !mDebugLogRing->Enabled) {
+    return NULL;
+  }
+
+  return mDebugLogRing;
+}
+
+/**
+  Append a message to the debug log ring.
+
+  If the ring is full, the message is dropped and counted in the ring.
+
+  @param  Message   The message to append. It does not need to be
+                    Null-terminated.
+  @param  Length    The number of characters in Message.
+
+  @retval TRUE      The message was appended to the ring, or dropped.
+  @retval FALSE     There is no ring to use. The caller must send the message
+                    to the serial port itself.
+
+**/
+BOOLEAN
+DebugLogRingWrite (
+  IN CONST CHAR8  *Message,
+  IN UINTN        Length
+  )
+{
+  EDKII_DEBUG_LOG_RING  *Ring;
+  UINT8                 *Data;
+  UINT32                RecordSize;
+  UINT32                Head;
+  UINT32                Offset;
+  UINT32                Chunk;
+
+  Ring = GetDebugLogRing ();
+  if (Ring == NULL) {
+    return FALSE;
+  }
+
+  RecordSize = (UINT32) ALIGN_VALUE (sizeof (UINT32) + Length, EDKII_DEBUG_LOG_RING_ALIGNMENT);
+  if (RecordSize > Ring->Size) {
+    return FALSE;
+  }
+
+  //
+  // Reserve the record. Tail only moves forward, so a stale Tail can only
+  // make the ring look fuller than it is.
+  //
+  do {
+    Head = Ring->Head;
+    if (Head - Ring->Tail + RecordSize > Ring->Size) {
+      InterlockedIncrement (&Ring->Dropped);
+      return TRUE;
+    }
+  } while (InterlockedCompareExchange32 (&Ring->Head, Head, Head + RecordSize) != Head);
+
+  //
+  // Copy the message, which may wrap around the end of the ring, and then
+  // publish it by writing its header.
+  //
+  Data   = (UINT8 *) (Ring + 1);
+  Offset = (Head + sizeof (UINT32)) & (Ring->Size - 1);
+  Chunk  = MIN ((UINT32) Length, Ring->Size - Offset);
+  CopyMem (Data + Offset, Message, Chunk);
+  CopyMem (Data, Message + Chunk, Length - Chunk);
+
+  MemoryFence ();
+  *(volatile UINT32 *) (Data + (Head & (Ring->Size - 1))) = (UINT32) Length | EDKII_DEBUG_LOG_RING_RECORD_VALID;
+  return TRUE;
+}
+
+/**
+  Send all messages in the debug log ring to the serial port, if there is a
+  ring to use.
+
+**/
+VOID
+DebugLogRingFlush (
+  VOID
+  )
+{
+  EDKII_DEBUG_LOG_RING  *Ring;
+
+  Ring = GetDebugLogRing ();
+  if (Ring != NULL) {
+    Ring->Flush ();
+  }
+}
+
+/**
+  The constructor initializes the Serial Port Library, gets the pointer to the
+  system table, creates an event to indicate it is after ExitBootServices, and
+  looks for the debug log ring now and whenever it is installed.
+
+  @param  ImageHandle     The firmware allocated handle for the EFI image.
+  @param  SystemTable     A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS     The constructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+DxeDebugLibBufferedSerialPortConstructor (
+  IN EFI_HANDLE                 ImageHandle,
+  IN EFI_SYSTEM_TABLE           *SystemTable
+  )
+{
+  SerialPortInitialize ();
+
+  mDebugST = SystemTable;
+
+  SystemTable->BootServices->CreateEvent (
+                                EVT_SIGNAL_EXIT_BOOT_SERVICES,
+                                TPL_NOTIFY,
+                                ExitBootServicesCallback,
+                                NULL,
+                                &mExitBootServicesEvent
+                                );
+
+  SystemTable->BootServices->CreateEventEx (
+                                EVT_NOTIFY_SIGNAL,
+                                TPL_NOTIFY,
+                                DebugLogRingInstalledCallback,
+                                NULL,
+                                &gEdkiiDebugLogRingGuid,
+                                &mDebugLogRingInstalledEvent
+                                );
+
+  DebugLogRingInstalledCallback (NULL, NULL);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  The destructor closes Exit Boot Services Event and the event that tracks the
+  installation of the debug log ring.
+
+  @param  ImageHandle   The firmware allocated handle for the EFI image.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   The destructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+DxeDebugLibBufferedSerialPortDestructor (
+  IN EFI_HANDLE                 ImageHandle,
+  IN EFI_SYSTEM_TABLE           *SystemTable
+  )
+{
+  if (mExitBootServicesEvent != NULL) {
+    SystemTable->BootServices->CloseEvent (mExitBootServicesEvent);
+  }
+
+  if (mDebugLogRingInstalledEvent != NULL) {
+    SystemTable->BootServices->CloseEvent (mDebugLogRingInstalledEvent);
+  }
+
+  return EFI_SUCCESS;
+}
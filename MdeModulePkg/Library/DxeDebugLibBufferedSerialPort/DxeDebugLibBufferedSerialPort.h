@@ -0,0 +1,55 @@
+/** @file
+  Internal definitions of the DXE Debug library instance that buffers DEBUG()
+  messages in the debug log ring.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __DXE_DEBUG_LIB_BUFFERED_SERIAL_PORT_H__
+#define __DXE_DEBUG_LIB_BUFFERED_SERIAL_PORT_H__
+
+#include <Uefi.h>
+
+#include <Guid/DebugLogRing.h>
+
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/PrintLib.h>
+#include <Library/PcdLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SerialPortLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/DebugPrintErrorLevelLib.h>
+
+/**
+  Append a message to the debug log ring.
+
+  If the ring is full, the message is dropped and counted in the ring.
+
+  @param  Message   The message to append. It does not need to be
+                    Null-terminated.
+  @param  Length    The number of characters in Message.
+
+  @retval TRUE      The message was appended to the ring, or dropped.
+  @retval FALSE     There is no ring to use. The caller must send the message
+                    to the serial port itself.
+
+**/
+BOOLEAN
+DebugLogRingWrite (
+  IN CONST CHAR8  *Message,
+  IN UINTN        Length
+  );
+
+/**
+  Send all messages in the debug log ring to the serial port, if there is a
+  ring to use.
+
+**/
+VOID
+DebugLogRingFlush (
+  VOID
+  );
+
+#endif
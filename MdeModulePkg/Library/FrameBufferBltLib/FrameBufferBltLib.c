@@ -81,6 +81,50 @@ FrameBufferBltLibConfigurePixelFormat (
   DEBUG ((DEBUG_INFO, "Bytes per pixel: %d\n", *BytesPerPixel));
 }
 
+/**
+  Convert pixels between PixelRedGreenBlueReserved8BitPerColor and
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL (blue-green-red) layout.
+
+  The conversion only swaps the red and the blue byte, so it works in both
+  directions. The reserved byte is cleared, like the generic conversion does.
+  Two pixels are converted per 64-bit operation when both buffers are 8-byte
+  aligned.
+
+  @param[out] Destination  The converted pixels.
+  @param[in]  Source       The pixels to convert.
+  @param[in]  Count        The number of pixels to convert.
+**/
+STATIC
+VOID
+FrameBufferBltLibSwapRedBlue (
+  OUT UINT32                      *Destination,
+  IN  CONST UINT32                *Source,
+  IN  UINTN                       Count
+  )
+{
+  UINT64                          Pixels;
+  UINT32                          Pixel;
+
+  if ((((UINTN) Destination | (UINTN) Source) & 7) == 0) {
+    for (; Count >= 2; Count -= 2) {
+      Pixels = *(CONST UINT64 *) Source;
+      *(UINT64 *) Destination =
+        ((Pixels & 0x000000ff000000ffULL) << 16) |
+        (Pixels & 0x0000ff000000ff00ULL) |
+        ((Pixels >> 16) & 0x000000ff000000ffULL);
+      Source      += 2;
+      Destination += 2;
+    }
+  }
+
+  for (; Count > 0; Count--) {
+    Pixel = *Source++;
+    *Destination++ = ((Pixel & 0x000000ff) << 16) |
+                     (Pixel & 0x0000ff00) |
+                     ((Pixel >> 16) & 0x000000ff);
+  }
+}
+
 /**
   Create the configuration for a video frame buffer.
 
@@ -387,6 +431,21 @@ FrameBufferBltLibVideoToBltBuffer (
 
   WidthInBytes = Width * Configure->BytesPerPixel;
 
+  Offset = (SourceY * Configure->PixelsPerScanLine) + SourceX;
+  Offset = Configure->BytesPerPixel * Offset;
+  Source = Configure->FrameBuffer + Offset;
+
+  if (Configure->PixelFormat == PixelBlueGreenRedReserved8BitPerColor &&
+      Width == Configure->PixelsPerScanLine && Delta == WidthInBytes) {
+    //
+    // Both sides are made of whole, identically formatted lines, so the
+    // rectangle is contiguous and a single copy moves all of it.
+    //
+    Destination = (UINT8 *) BltBuffer + (DestinationY * Delta) + (DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    CopyMem (Destination, Source, WidthInBytes * Height);
+    return RETURN_SUCCESS;
+  }
+
   //
   // Video to BltBuffer: Source is Video, destination is BltBuffer
   //
@@ -404,9 +463,20 @@ FrameBufferBltLibVideoToBltBuffer (
       Destination = Configure->LineBuffer;
     }
 
+    //
+    // Reading the frame buffer is slow, so fetch the whole line with one copy
+    // before converting it.
+    //
     CopyMem (Destination, Source, WidthInBytes);
 
-    if (Configure->PixelFormat != PixelBlueGreenRedReserved8BitPerColor) {
+    if (Configure->PixelFormat == PixelRedGreenBlueReserved8BitPerColor) {
+      FrameBufferBltLibSwapRedBlue (
+        (UINT32 *) ((UINT8 *) BltBuffer + (DstY * Delta) +
+                    DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)),
+        (UINT32 *) Configure->LineBuffer,
+        Width
+        );
+    } else if (Configure->PixelFormat != PixelBlueGreenRedReserved8BitPerColor) {
       for (IndexX = 0; IndexX < Width; IndexX++) {
         Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)
           ((UINT8 *) BltBuffer + (DstY * Delta) +
@@ -495,6 +565,21 @@ FrameBufferBltLibBufferToVideo (
 
   WidthInBytes = Width * Configure->BytesPerPixel;
 
+  if (Configure->PixelFormat == PixelBlueGreenRedReserved8BitPerColor &&
+      Width == Configure->PixelsPerScanLine && Delta == WidthInBytes) {
+    //
+    // Both sides are made of whole, identically formatted lines, so the
+    // rectangle is contiguous. A single large copy lets CopyMem () stream it
+    // into the (usually write-combining) frame buffer.
+    //
+    Offset = DestinationY * Configure->PixelsPerScanLine;
+    Offset = Configure->BytesPerPixel * Offset;
+    Destination = Configure->FrameBuffer + Offset;
+    Source = (UINT8 *) BltBuffer + (SourceY * Delta) + SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    CopyMem (Destination, Source, WidthInBytes * Height);
+    return RETURN_SUCCESS;
+  }
+
   for (SrcY = SourceY, DstY = DestinationY;
        SrcY < (Height + SourceY);
        SrcY++, DstY++) {
@@ -505,6 +590,14 @@ FrameBufferBltLibBufferToVideo (
 
     if (Configure->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
       Source = (UINT8 *) BltBuffer + (SrcY * Delta) + SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+    } else if (Configure->PixelFormat == PixelRedGreenBlueReserved8BitPerColor) {
+      FrameBufferBltLibSwapRedBlue (
+        (UINT32 *) Configure->LineBuffer,
+        (UINT32 *) ((UINT8 *) BltBuffer + (SrcY * Delta) +
+                    SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)),
+        Width
+        );
+      Source = Configure->LineBuffer;
     } else {
       for (IndexX = 0; IndexX < Width; IndexX++) {
         Blt =
@@ -527,6 +620,10 @@ FrameBufferBltLibBufferToVideo (
       Source = Configure->LineBuffer;
     }
 
+    //
+    // The line is converted in cached memory first, so the frame buffer only
+    // sees one sequential write per line.
+    //
     CopyMem (Destination, Source, WidthInBytes);
   }
 
@@ -599,12 +696,21 @@ FrameBufferBltLibVideoToVideo (
   Destination = Configure->FrameBuffer + Offset;
 
   LineStride = Configure->BytesPerPixel * Configure->PixelsPerScanLine;
+  if (Width == Configure->PixelsPerScanLine) {
+    //
+    // Whole lines, e.g. scrolling the console: the rectangles are contiguous
+    // and CopyMem () handles the overlap.
+    //
+    CopyMem (Destination, Source, WidthInBytes * Height);
+    return RETURN_SUCCESS;
+  }
+
   if (Destination > Source) {
     //
     // Copy from last line to avoid source is corrupted by copying
     //
-    Source += Height * LineStride;
-    Destination += Height * LineStride;
+    Source += (Height - 1) * LineStride;
+    Destination += (Height - 1) * LineStride;
     LineStride = -LineStride;
   }
 
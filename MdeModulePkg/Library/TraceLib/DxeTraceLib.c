@@ -0,0 +1,163 @@
+/** @file
+  DXE instance of TraceLib.
+
+  The first module that starts with this library allocates the DXE trace log
+  in runtime memory, copies the PEI trace log out of its HOB next to it, and
+  publishes both in the EFI System Configuration Table. Later modules find
+  them there.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "TraceLibInternal.h"
+
+#include <Protocol/LoadedImage.h>
+
+#include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+TRACE_LOG_HEADER  *mTraceLog;
+
+/**
+  Returns the trace log of the current boot phase, creating it if needed.
+
+  @return The trace log, or NULL if there is none and it cannot be created
+          now.
+
+**/
+TRACE_LOG_HEADER *
+InternalGetTraceLog (
+  VOID
+  )
+{
+  //
+  // The log is found or created by the constructor, which is the only place
+  // known to run at a TPL that can allocate memory.
+  //
+  return mTraceLog;
+}
+
+/**
+  Finds the DXE trace log in the EFI System Configuration Table, or creates it
+  and the table.
+
+  @return The DXE trace log, or NULL if it could not be created.
+
+**/
+STATIC
+TRACE_LOG_HEADER *
+DxeTraceLibFindOrCreateLog (
+  VOID
+  )
+{
+  EFI_STATUS         Status;
+  TRACE_LOG_TABLE    *Table;
+  TRACE_LOG_HEADER   *Log;
+  EFI_HOB_GUID_TYPE  *GuidHob;
+  UINT32             ModuleCount;
+  UINT32             RecordCount;
+  EFI_TPL            OldTpl;
+
+  //
+  // Keep drivers started from events from creating a second table while this
+  // one is being set up.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  Log    = NULL;
+  Status = EfiGetSystemConfigurationTable (&gEdkiiTraceLogTableGuid, (VOID **) &Table);
+  if (!EFI_ERROR (Status)) {
+    Log = (TRACE_LOG_HEADER *) (UINTN) Table->Log[TRACE_LOG_PHASE_DXE];
+    goto Done;
+  }
+
+  ModuleCount = PcdGet32 (PcdTraceLogDxeModuleCount);
+  RecordCount = PcdGet32 (PcdTraceLogDxeRecordCount);
+  if (RecordCount == 0) {
+    goto Done;
+  }
+
+  Table = AllocateRuntimeZeroPool (sizeof (*Table));
+  Log   = AllocateRuntimePool (TRACE_LOG_SIZE (ModuleCount, RecordCount));
+  if (Table == NULL || Log == NULL) {
+    goto Error;
+  }
+  InternalInitTraceLog (Log, TRACE_LOG_PHASE_DXE, ModuleCount, RecordCount);
+
+  Table->Signature                = TRACE_LOG_TABLE_SIGNATURE;
+  Table->LogCount                 = TRACE_LOG_PHASE_COUNT;
+  Table->Log[TRACE_LOG_PHASE_DXE] = (UINTN) Log;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiTraceLogHobGuid);
+  if (GuidHob != NULL) {
+    Table->Log[TRACE_LOG_PHASE_PEI] = (UINTN) AllocateRuntimeCopyPool (
+                                                GET_GUID_HOB_DATA_SIZE (GuidHob),
+                                                GET_GUID_HOB_DATA (GuidHob)
+                                                );
+  }
+
+  Status = gBS->InstallConfigurationTable (&gEdkiiTraceLogTableGuid, Table);
+  if (!EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+Error:
+  if (Table != NULL) {
+    if (Table->Log[TRACE_LOG_PHASE_PEI] != 0) {
+      FreePool ((VOID *) (UINTN) Table->Log[TRACE_LOG_PHASE_PEI]);
+    }
+    FreePool (Table);
+  }
+  if (Log != NULL) {
+    FreePool (Log);
+  }
+  Log = NULL;
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Log;
+}
+
+/**
+  The constructor finds or creates the DXE trace log, and adds the calling
+  module to its module table.
+
+  @param  ImageHandle   The firmware allocated handle for the EFI image.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   The constructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+DxeTraceLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+
+  if (!TraceLogEnabled ()) {
+    return EFI_SUCCESS;
+  }
+
+  mTraceLog = DxeTraceLibFindOrCreateLog ();
+  if (mTraceLog == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiLoadedImageProtocolGuid,
+                  (VOID **) &LoadedImage
+                  );
+  if (!EFI_ERROR (Status)) {
+    InternalAddTraceLogModule (mTraceLog, (UINTN) LoadedImage->ImageBase);
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/** @file
+  PEI instance of TraceLib. The PEI trace log lives in a GUIDed HOB, so it is
+  carried over to DXE with the rest of the HOB list.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "TraceLibInternal.h"
+
+#include <Library/HobLib.h>
+
+//
+// Images in a firmware volume are aligned on at least this many bytes.
+//
+#define PEI_TRACE_LIB_IMAGE_ALIGN_SIZE  4
+
+/**
+  Returns the trace log of the current boot phase, creating it if needed.
+
+  PEIMs may run from flash, where global variables cannot be written, so the
+  HOB is looked up on each call.
+
+  @return The trace log, or NULL if there is none and it cannot be created
+          now.
+
+**/
+TRACE_LOG_HEADER *
+InternalGetTraceLog (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE  *GuidHob;
+  TRACE_LOG_HEADER   *Log;
+  UINT32             ModuleCount;
+  UINT32             RecordCount;
+
+  GuidHob = GetFirstGuidHob (&gEdkiiTraceLogHobGuid);
+  if (GuidHob != NULL) {
+    return GET_GUID_HOB_DATA (GuidHob);
+  }
+
+  ModuleCount = PcdGet32 (PcdTraceLogPeiModuleCount);
+  RecordCount = PcdGet32 (PcdTraceLogPeiRecordCount);
+  if (RecordCount == 0) {
+    return NULL;
+  }
+
+  Log = BuildGuidHob (&gEdkiiTraceLogHobGuid, TRACE_LOG_SIZE (ModuleCount, RecordCount));
+  if (Log == NULL) {
+    return NULL;
+  }
+
+  InternalInitTraceLog (Log, TRACE_LOG_PHASE_PEI, ModuleCount, RecordCount);
+  return Log;
+}
+
+/**
+  Searches backwards from an address in the calling module for the start of
+  its image.
+
+  This is the same search as PeCoffSearchImageBase(), which is only available
+  in DEBUG builds.
+
+  @param  Address  An address in the calling module.
+
+  @return The start of the image, or 0 if it was not found.
+
+**/
+STATIC
+UINTN
+PeiTraceLibSearchImage (
+  IN UINTN  Address
+  )
+{
+  UINTN                                Image;
+  EFI_IMAGE_DOS_HEADER                 *DosHdr;
+  EFI_IMAGE_OPTIONAL_HEADER_PTR_UNION  Hdr;
+
+  for (Image = Address & ~(PEI_TRACE_LIB_IMAGE_ALIGN_SIZE - 1);
+       Image != 0;
+       Image -= PEI_TRACE_LIB_IMAGE_ALIGN_SIZE) {
+    DosHdr = (EFI_IMAGE_DOS_HEADER *) Image;
+    if (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) {
+      Hdr.Pe32 = (EFI_IMAGE_NT_HEADERS32 *) (Image + (UINTN) (DosHdr->e_lfanew & 0x0ffff));
+      if ((UINTN) Hdr.Pe32 > Image && (UINTN) Hdr.Pe32 < Address &&
+          Hdr.Pe32->Signature == EFI_IMAGE_NT_SIGNATURE) {
+        return Image;
+      }
+    } else {
+      Hdr.Te = (EFI_TE_IMAGE_HEADER *) Image;
+      if (Hdr.Te->Signature == EFI_TE_IMAGE_HEADER_SIGNATURE &&
+          (Hdr.Te->Machine == IMAGE_FILE_MACHINE_I386  || Hdr.Te->Machine == IMAGE_FILE_MACHINE_X64 ||
+           Hdr.Te->Machine == IMAGE_FILE_MACHINE_EBC   || Hdr.Te->Machine == IMAGE_FILE_MACHINE_ARM64 ||
+           Hdr.Te->Machine == IMAGE_FILE_MACHINE_ARMTHUMB_MIXED)) {
+        return Image;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+  The constructor adds the calling PEIM to the module table of the PEI trace
+  log. A PEIM that is shadowed to memory runs its constructor again, and is
+  added again with its new address.
+
+  @param  FileHandle   The handle of FFS header the loaded driver.
+  @param  PeiServices  The pointer to the PEI services.
+
+  @retval EFI_SUCCESS  The constructor always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+PeiTraceLibConstructor (
+  IN EFI_PEI_FILE_HANDLE     FileHandle,
+  IN CONST EFI_PEI_SERVICES  **PeiServices
+  )
+{
+  TRACE_LOG_HEADER  *Log;
+  UINTN             Image;
+
+  if (!TraceLogEnabled ()) {
+    return EFI_SUCCESS;
+  }
+
+  Log = InternalGetTraceLog ();
+  if (Log == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // gEfiCallerIdGuid is defined by every module, in its own image.
+  //
+  Image = PeiTraceLibSearchImage ((UINTN) &gEfiCallerIdGuid);
+  if (Image != 0) {
+    InternalAddTraceLogModule (Log, Image);
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/** @file
+  Writes records to the binary trace log. This part is common to the PEI and
+  DXE instances of TraceLib.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "TraceLibInternal.h"
+
+/**
+  Copies the arguments that a format string consumes into a record.
+
+  The arguments are read the same way as BasePrintLib reads them, so that the
+  decoder can render the message exactly as DebugPrint() would have.
+
+  @param  Format  Null-terminated ASCII format string.
+  @param  Marker  VA_LIST marker for the variable argument list.
+  @param  Args    Receives the first TRACE_LOG_MAX_ARGS arguments.
+
+  @return The number of arguments that Format consumes.
+
+**/
+STATIC
+UINTN
+TraceLogCopyArgs (
+  IN  CONST CHAR8  *Format,
+  IN  VA_LIST      Marker,
+  OUT UINT64       *Args
+  )
+{
+  UINTN    Count;
+  UINT64   Value;
+  BOOLEAN  Long;
+  CHAR8    Character;
+
+  Count = 0;
+  while (*Format != '\0') {
+    if (*Format++ != '%') {
+      continue;
+    }
+
+    //
+    // Skip the flags, width and precision. A '*' consumes a UINTN argument.
+    //
+    Long = FALSE;
+    for (Character = *Format; Character != '\0'; Character = *++Format) {
+      if (Character == '*') {
+        Value = VA_ARG (Marker, UINTN);
+        if (Count < TRACE_LOG_MAX_ARGS) {
+          Args[Count] = Value;
+        }
+        Count++;
+      } else if (Character == 'l' || Character == 'L') {
+        Long = TRUE;
+      } else if (Character != '.' && Character != '-' && Character != '+' &&
+                 Character != ' ' && Character != ',' &&
+                 (Character < '0' || Character > '9')) {
+        break;
+      }
+    }
+    if (Character == '\0') {
+      break;
+    }
+    Format++;
+
+    switch (Character) {
+    case 'd':
+    case 'u':
+    case 'x':
+    case 'X':
+      if (Long) {
+        Value = VA_ARG (Marker, INT64);
+      } else {
+        Value = (UINT64) (INT64) VA_ARG (Marker, int);
+      }
+      break;
+
+    case 'p':
+    case 'a':
+    case 's':
+    case 'S':
+    case 'g':
+    case 't':
+      Value = (UINTN) VA_ARG (Marker, VOID *);
+      break;
+
+    case 'c':
+      Value = VA_ARG (Marker, UINTN);
+      break;
+
+    case 'r':
+      Value = VA_ARG (Marker, RETURN_STATUS);
+      break;
+
+    default:
+      //
+      // "%%" and unknown types do not consume an argument.
+      //
+      continue;
+    }
+
+    if (Count < TRACE_LOG_MAX_ARGS) {
+      Args[Count] = Value;
+    }
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Initializes an empty trace log.
+
+  @param  Log          The memory for the log, TRACE_LOG_SIZE (ModuleCount,
+                       RecordCount) bytes.
+  @param  Phase        The boot phase of the log, TRACE_LOG_PHASE_*.
+  @param  ModuleCount  The number of entries in the module table.
+  @param  RecordCount  The number of records in the log.
+
+**/
+VOID
+InternalInitTraceLog (
+  OUT TRACE_LOG_HEADER  *Log,
+  IN  UINT32            Phase,
+  IN  UINT32            ModuleCount,
+  IN  UINT32            RecordCount
+  )
+{
+  ZeroMem (Log, TRACE_LOG_SIZE (ModuleCount, RecordCount));
+  Log->Phase                       = Phase;
+  Log->ModuleCount                 = ModuleCount;
+  Log->RecordCount                 = RecordCount;
+  Log->PerformanceCounterFrequency = GetPerformanceCounterProperties (NULL, NULL);
+  Log->Signature                   = TRACE_LOG_SIGNATURE;
+}
+
+/**
+  Adds the calling module to the module table of a trace log.
+
+  @param  Log    The trace log.
+  @param  Image  The start of the calling module's image in memory, where its
+                 DOS, PE or TE header is.
+
+**/
+VOID
+InternalAddTraceLogModule (
+  IN TRACE_LOG_HEADER  *Log,
+  IN UINTN             Image
+  )
+{
+  EFI_TE_IMAGE_HEADER  *TeHeader;
+  TRACE_LOG_MODULE     *Module;
+  UINT32               Index;
+
+  Index = InterlockedIncrement (&Log->ModuleHead) - 1;
+  if (Index >= Log->ModuleCount) {
+    return;
+  }
+
+  Module = (TRACE_LOG_MODULE *) (Log + 1) + Index;
+  CopyGuid (&Module->ModuleGuid, &gEfiCallerIdGuid);
+
+  //
+  // A TE image is the PE/COFF image with its first StrippedSize bytes
+  // replaced by the TE header, so offsets in the .efi file are shifted by
+  // the difference.
+  //
+  TeHeader = (EFI_TE_IMAGE_HEADER *) Image;
+  if (TeHeader->Signature == EFI_TE_IMAGE_HEADER_SIGNATURE) {
+    Module->ImageBase = Image + sizeof (EFI_TE_IMAGE_HEADER) - TeHeader->StrippedSize;
+  } else {
+    Module->ImageBase = Image;
+  }
+}
+
+/**
+  Returns TRUE if TRACE() records messages.
+
+  @retval  TRUE    The trace log is enabled.
+  @retval  FALSE   The trace log is disabled.
+
+**/
+BOOLEAN
+EFIAPI
+TraceLogEnabled (
+  VOID
+  )
+{
+  return (BOOLEAN) (PcdGet32 (PcdTraceLogErrorLevel) != 0);
+}
+
+/**
+  Records a message in the trace log of the current boot phase.
+
+  The message is recorded only if ErrorLevel has a bit set in
+  PcdTraceLogErrorLevel. Format must be a literal string in the calling module
+  because only its address is kept.
+
+  @param  ErrorLevel  The error level of the message.
+  @param  Format      Format string for the message, as for DebugPrint().
+  @param  ...         Variable argument list whose contents are accessed
+                      based on the format string specified by Format.
+
+**/
+VOID
+EFIAPI
+TraceLogWrite (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+  TRACE_LOG_HEADER  *Log;
+  TRACE_LOG_RECORD  *Record;
+  UINT32            Sequence;
+  VA_LIST           Marker;
+
+  if ((ErrorLevel & PcdGet32 (PcdTraceLogErrorLevel)) == 0) {
+    return;
+  }
+
+  Log = InternalGetTraceLog ();
+  if (Log == NULL) {
+    return;
+  }
+
+  Sequence = InterlockedIncrement (&Log->Head);
+  Record   = (TRACE_LOG_RECORD *) ((TRACE_LOG_MODULE *) (Log + 1) + Log->ModuleCount);
+  Record  += (Sequence - 1) % Log->RecordCount;
+
+  Record->Sequence = 0;
+  MemoryFence ();
+
+  Record->ErrorLevel = (UINT32) ErrorLevel;
+  CopyGuid (&Record->ModuleGuid, &gEfiCallerIdGuid);
+  Record->Format     = (UINTN) Format;
+  Record->TimeStamp  = GetPerformanceCounter ();
+  VA_START (Marker, Format);
+  Record->ArgCount   = (UINT32) TraceLogCopyArgs (Format, Marker, Record->Args);
+  VA_END (Marker);
+
+  MemoryFence ();
+  Record->Sequence = Sequence;
+}
@@ -0,0 +1,69 @@
+/** @file
+  Internal definitions shared by the PEI and DXE instances of TraceLib.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TRACE_LIB_INTERNAL_H__
+#define __TRACE_LIB_INTERNAL_H__
+
+#include <PiPei.h>
+
+#include <IndustryStandard/PeImage.h>
+
+#include <Guid/TraceLog.h>
+
+#include <Library/TraceLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+
+/**
+  Returns the trace log of the current boot phase, creating it if needed.
+
+  @return The trace log, or NULL if there is none and it cannot be created
+          now.
+
+**/
+TRACE_LOG_HEADER *
+InternalGetTraceLog (
+  VOID
+  );
+
+/**
+  Initializes an empty trace log.
+
+  @param  Log          The memory for the log, TRACE_LOG_SIZE (ModuleCount,
+                       RecordCount) bytes.
+  @param  Phase        The boot phase of the log, TRACE_LOG_PHASE_*.
+  @param  ModuleCount  The number of entries in the module table.
+  @param  RecordCount  The number of records in the log.
+
+**/
+VOID
+InternalInitTraceLog (
+  OUT TRACE_LOG_HEADER  *Log,
+  IN  UINT32            Phase,
+  IN  UINT32            ModuleCount,
+  IN  UINT32            RecordCount
+  );
+
+/**
+  Adds the calling module to the module table of a trace log.
+
+  @param  Log    The trace log.
+  @param  Image  The start of the calling module's image in memory, where its
+                 DOS, PE or TE header is.
+
+**/
+VOID
+InternalAddTraceLogModule (
+  IN TRACE_LOG_HEADER  *Log,
+  IN UINTN             Image
+  );
+
+#endif
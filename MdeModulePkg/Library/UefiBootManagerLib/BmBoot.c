@@ -625,9 +625,301 @@ BmExpandUsbDevicePath (
   return NextFullPath;
 }
 
+/**
+  Return the size of the device path in front of a short-form device path at
+  the end of a full device path.
+
+  @param FullPath      The full device path, single instance.
+  @param ShortForm     The short-form device path.
+
+  @return The size of the device path in front of ShortForm, or 0 if FullPath
+          doesn't end with ShortForm.
+**/
+UINTN
+BmGetShortFormPrefixSize (
+  IN EFI_DEVICE_PATH_PROTOCOL     *FullPath,
+  IN EFI_DEVICE_PATH_PROTOCOL     *ShortForm
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL        *Node;
+  UINTN                           FullPathSize;
+  UINTN                           ShortFormSize;
+  UINTN                           PrefixSize;
+
+  FullPathSize  = GetDevicePathSize (FullPath) - END_DEVICE_PATH_LENGTH;
+  ShortFormSize = GetDevicePathSize (ShortForm) - END_DEVICE_PATH_LENGTH;
+  if (FullPathSize <= ShortFormSize) {
+    return 0;
+  }
+
+  //
+  // The prefix must end on a node boundary.
+  //
+  PrefixSize = FullPathSize - ShortFormSize;
+  for (Node = FullPath; !IsDevicePathEnd (Node); Node = NextDevicePathNode (Node)) {
+    if ((UINTN) Node - (UINTN) FullPath >= PrefixSize) {
+      break;
+    }
+  }
+
+  if (((UINTN) Node - (UINTN) FullPath != PrefixSize) ||
+      (CompareMem (Node, ShortForm, ShortFormSize) != 0)) {
+    return 0;
+  }
+
+  return PrefixSize;
+}
+
+/**
+  Return the full device path a short-form device path was expanded to when
+  the load option was last loaded from it. The full paths are saved in the
+  'SFDP' variable, most recent first.
+
+  @param ShortForm     The short-form device path.
+  @param Prefix        Return the device path in front of ShortForm in the full
+                       device path. Caller is responsible to free the memory.
+
+  @return The cached full device path, or NULL if there is none.
+          Caller is responsible to free the memory.
+**/
+EFI_DEVICE_PATH_PROTOCOL *
+BmGetCachedShortFormFullPath (
+  IN  EFI_DEVICE_PATH_PROTOCOL    *ShortForm,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **Prefix
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL        *CachedDevicePath;
+  UINTN                           CachedDevicePathSize;
+  EFI_DEVICE_PATH_PROTOCOL        *TempDevicePath;
+  EFI_DEVICE_PATH_PROTOCOL        *Instance;
+  UINTN                           Size;
+  UINTN                           PrefixSize;
+
+  *Prefix = NULL;
+  GetVariable2 (L"SFDP", &mBmHardDriveBootVariableGuid, (VOID **) &CachedDevicePath, &CachedDevicePathSize);
+  if (CachedDevicePath == NULL) {
+    return NULL;
+  }
+
+  //
+  // Delete the invalid 'SFDP' variable.
+  //
+  if (!IsDevicePathValid (CachedDevicePath, CachedDevicePathSize)) {
+    FreePool (CachedDevicePath);
+    gRT->SetVariable (L"SFDP", &mBmHardDriveBootVariableGuid, 0, 0, NULL);
+    return NULL;
+  }
+
+  TempDevicePath = CachedDevicePath;
+  do {
+    Instance = GetNextDevicePathInstance (&TempDevicePath, &Size);
+    if (Instance == NULL) {
+      break;
+    }
+
+    PrefixSize = BmGetShortFormPrefixSize (Instance, ShortForm);
+    if (PrefixSize != 0) {
+      *Prefix = AllocatePool (PrefixSize + END_DEVICE_PATH_LENGTH);
+      if (*Prefix != NULL) {
+        CopyMem (*Prefix, Instance, PrefixSize);
+        SetDevicePathEndNode ((UINT8 *) *Prefix + PrefixSize);
+        break;
+      }
+    }
+
+    FreePool (Instance);
+    Instance = NULL;
+  } while (TempDevicePath != NULL);
+
+  FreePool (CachedDevicePath);
+  return Instance;
+}
+
+/**
+  Save the full device path a short-form device path was expanded to, as the
+  most recent one, so the next boot can try it first.
+
+  The variable is only written when FullPath is not already the most recent
+  full path, and keeps at most 8 full paths.
+
+  @param ShortForm     The short-form device path.
+  @param FullPath      The full device path, ending with ShortForm.
+**/
+VOID
+BmCacheShortFormFullPath (
+  IN EFI_DEVICE_PATH_PROTOCOL     *ShortForm,
+  IN EFI_DEVICE_PATH_PROTOCOL     *FullPath
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL        *CachedDevicePath;
+  UINTN                           CachedDevicePathSize;
+  EFI_DEVICE_PATH_PROTOCOL        *NewDevicePath;
+  EFI_DEVICE_PATH_PROTOCOL        *TempDevicePath;
+  EFI_DEVICE_PATH_PROTOCOL        *Instance;
+  UINTN                           Size;
+  UINTN                           Count;
+
+  if (BmGetShortFormPrefixSize (FullPath, ShortForm) == 0) {
+    return;
+  }
+
+  GetVariable2 (L"SFDP", &mBmHardDriveBootVariableGuid, (VOID **) &CachedDevicePath, &CachedDevicePathSize);
+  if ((CachedDevicePath != NULL) && !IsDevicePathValid (CachedDevicePath, CachedDevicePathSize)) {
+    FreePool (CachedDevicePath);
+    CachedDevicePath = NULL;
+  }
+
+  NewDevicePath = DuplicateDevicePath (FullPath);
+  Count         = 1;
+  TempDevicePath = CachedDevicePath;
+  while ((TempDevicePath != NULL) && (NewDevicePath != NULL) && (Count < 8)) {
+    Instance = GetNextDevicePathInstance (&TempDevicePath, &Size);
+    if (Instance == NULL) {
+      break;
+    }
+
+    if (BmGetShortFormPrefixSize (Instance, ShortForm) == 0) {
+      Count++;
+      TempDevicePath = NewDevicePath;
+      NewDevicePath  = AppendDevicePathInstance (NewDevicePath, Instance);
+      FreePool (TempDevicePath);
+    } else if ((Count == 1) && (Size == GetDevicePathSize (FullPath)) &&
+               (CompareMem (Instance, FullPath, Size) == 0)) {
+      //
+      // FullPath is already the most recent full path.
+      //
+      FreePool (Instance);
+      FreePool (NewDevicePath);
+      NewDevicePath = NULL;
+      break;
+    }
+    FreePool (Instance);
+  }
+
+  //
+  // Failing to save only impacts performance next time expanding the short-form device path
+  //
+  if (NewDevicePath != NULL) {
+    gRT->SetVariable (
+           L"SFDP",
+           &mBmHardDriveBootVariableGuid,
+           EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_NON_VOLATILE,
+           GetDevicePathSize (NewDevicePath),
+           NewDevicePath
+           );
+    FreePool (NewDevicePath);
+  }
+
+  if (CachedDevicePath != NULL) {
+    FreePool (CachedDevicePath);
+  }
+}
+
+/**
+  Save the full device path a File-path or URI load option was loaded from,
+  so the next boot can try it first.
+
+  @param FilePath      The device path of the load option.
+  @param FullPath      The full device path the load option was loaded from.
+**/
+VOID
+BmCacheLoadOptionFullPath (
+  IN EFI_DEVICE_PATH_PROTOCOL     *FilePath,
+  IN EFI_DEVICE_PATH_PROTOCOL     *FullPath
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_DEVICE_PATH_PROTOCOL        *Node;
+  EFI_HANDLE                      Handle;
+  EFI_DEVICE_PATH_PROTOCOL        *LoadFileFullPath;
+
+  if ((DevicePathType (FilePath) == MEDIA_DEVICE_PATH) &&
+      (DevicePathSubType (FilePath) == MEDIA_FILEPATH_DP)) {
+    BmCacheShortFormFullPath (FilePath, FullPath);
+  } else if ((DevicePathType (FilePath) == MESSAGING_DEVICE_PATH) &&
+             (DevicePathSubType (FilePath) == MSG_URI_DP)) {
+    //
+    // FullPath is the Load File instance, or the RAM disk the Load File
+    // instance downloaded the load option to.
+    //
+    Node   = FullPath;
+    Status = gBS->LocateDevicePath (&gEfiLoadFileProtocolGuid, &Node, &Handle);
+    if (!EFI_ERROR (Status)) {
+      LoadFileFullPath = AppendDevicePath (DevicePathFromHandle (Handle), FilePath);
+      if (LoadFileFullPath != NULL) {
+        BmCacheShortFormFullPath (FilePath, LoadFileFullPath);
+        FreePool (LoadFileFullPath);
+      }
+    }
+  }
+}
+
+/**
+  Connect the device path in front of a cached full device path, and check
+  that it leads to an instance of the protocol the short-form device path is
+  expanded with.
+
+  @param Prefix        The device path in front of the short-form device path.
+  @param Protocol      The protocol the device path must point to.
+  @param Handle        Return the handle of the protocol instance.
+
+  @retval TRUE   Prefix points to an instance of Protocol.
+  @retval FALSE  Prefix doesn't point to an instance of Protocol.
+**/
+BOOLEAN
+BmConnectShortFormPrefix (
+  IN  EFI_DEVICE_PATH_PROTOCOL    *Prefix,
+  IN  EFI_GUID                    *Protocol,
+  OUT EFI_HANDLE                  *Handle
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_DEVICE_PATH_PROTOCOL        *Node;
+
+  Status = EfiBootManagerConnectDevicePath (Prefix, NULL);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  Node   = Prefix;
+  Status = gBS->LocateDevicePath (Protocol, &Node, Handle);
+  return (BOOLEAN) (!EFI_ERROR (Status) && IsDevicePathEnd (Node));
+}
+
+/**
+  Return the class of a file system in the order the file systems are tried
+  in: removable media first, then fixed media, then the file systems that
+  don't layer on Block IO.
+
+  @param Handle        The handle of the file system.
+
+  @return 0 for removable media, 1 for fixed media, 2 without Block IO.
+**/
+UINTN
+BmGetFileSystemMediaType (
+  IN EFI_HANDLE                   Handle
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_BLOCK_IO_PROTOCOL           *BlockIo;
+
+  Status = gBS->HandleProtocol (Handle, &gEfiBlockIoProtocolGuid, (VOID *) &BlockIo);
+  if (EFI_ERROR (Status)) {
+    return 2;
+  }
+
+  return BlockIo->Media->RemovableMedia ? 0 : 1;
+}
+
 /**
   Expand File-path device path node to be full device path in platform.
 
+  The file systems are tried on removable media first, then on fixed media,
+  then the ones that don't layer on Block IO. The full path the load option
+  was last loaded from keeps that precedence: it is tried first among the
+  file systems of its own class. Only when it is on removable media, which
+  nothing comes before, is it tried without a connect all.
+
   @param FilePath      The device path pointing to a load option.
                        It could be a short-form device path.
   @param FullPath      The full path returned by the routine in last call.
@@ -646,10 +938,30 @@ BmExpandFileDevicePath (
   UINTN                           Index;
   UINTN                           HandleCount;
   EFI_HANDLE                      *Handles;
-  EFI_BLOCK_IO_PROTOCOL           *BlockIo;
   UINTN                           MediaType;
   EFI_DEVICE_PATH_PROTOCOL        *NextFullPath;
   BOOLEAN                         GetNext;
+  EFI_DEVICE_PATH_PROTOCOL        *CachedFullPath;
+  UINTN                           CachedMediaType;
+  EFI_DEVICE_PATH_PROTOCOL        *Prefix;
+  EFI_HANDLE                      Handle;
+
+  //
+  // MediaType 3 matches no class, so a cached full path that no longer
+  // leads to a file system is not tried.
+  //
+  CachedMediaType = 3;
+  CachedFullPath  = BmGetCachedShortFormFullPath (FilePath, &Prefix);
+  if (CachedFullPath != NULL) {
+    if (BmConnectShortFormPrefix (Prefix, &gEfiSimpleFileSystemProtocolGuid, &Handle)) {
+      CachedMediaType = BmGetFileSystemMediaType (Handle);
+    }
+    FreePool (Prefix);
+
+    if ((FullPath == NULL) && (CachedMediaType == 0)) {
+      return CachedFullPath;
+    }
+  }
 
   EfiBootManagerConnectAll ();
   Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiSimpleFileSystemProtocolGuid, NULL, &HandleCount, &Handles);
@@ -665,16 +977,27 @@ BmExpandFileDevicePath (
   //   followed by media devices which don't layer on block io.
   //
   for (MediaType = 0; MediaType < 3; MediaType++) {
-    for (Index = 0; Index < HandleCount; Index++) {
-      Status = gBS->HandleProtocol (Handles[Index], &gEfiBlockIoProtocolGuid, (VOID *) &BlockIo);
-      if (EFI_ERROR (Status)) {
-        BlockIo = NULL;
+    if (MediaType == CachedMediaType) {
+      if (GetNext) {
+        NextFullPath = DuplicateDevicePath (CachedFullPath);
+        break;
       }
-      if ((MediaType == 0 && BlockIo != NULL && BlockIo->Media->RemovableMedia) ||
-          (MediaType == 1 && BlockIo != NULL && !BlockIo->Media->RemovableMedia) ||
-          (MediaType == 2 && BlockIo == NULL)
-          ) {
+      GetNext = (BOOLEAN)((GetDevicePathSize (FullPath) == GetDevicePathSize (CachedFullPath)) &&
+                          (CompareMem (FullPath, CachedFullPath, GetDevicePathSize (FullPath)) == 0));
+    }
+    for (Index = 0; Index < HandleCount; Index++) {
+      if (BmGetFileSystemMediaType (Handles[Index]) == MediaType) {
         NextFullPath = AppendDevicePath (DevicePathFromHandle (Handles[Index]), FilePath);
+        if ((MediaType == CachedMediaType) && (NextFullPath != NULL) &&
+            (GetDevicePathSize (NextFullPath) == GetDevicePathSize (CachedFullPath)) &&
+            (CompareMem (NextFullPath, CachedFullPath, GetDevicePathSize (NextFullPath)) == 0)) {
+          //
+          // Already tried first in its class.
+          //
+          FreePool (NextFullPath);
+          NextFullPath = NULL;
+          continue;
+        }
         if (GetNext) {
           break;
         } else {
@@ -693,12 +1016,20 @@ BmExpandFileDevicePath (
     FreePool (Handles);
   }
 
+  if (CachedFullPath != NULL) {
+    FreePool (CachedFullPath);
+  }
+
   return NextFullPath;
 }
 
 /**
   Expand URI device path node to be full device path in platform.
 
+  The Load File instance the load option was last downloaded with is tried
+  first, without a connect all. When it doesn't work, all the Load File
+  instances are tried.
+
   @param FilePath      The device path pointing to a load option.
                        It could be a short-form device path.
   @param FullPath      The full path returned by the routine in last call.
@@ -720,6 +1051,35 @@ BmExpandUriDevicePath (
   EFI_DEVICE_PATH_PROTOCOL        *NextFullPath;
   EFI_DEVICE_PATH_PROTOCOL        *RamDiskDevicePath;
   BOOLEAN                         GetNext;
+  EFI_DEVICE_PATH_PROTOCOL        *CachedFullPath;
+  EFI_DEVICE_PATH_PROTOCOL        *Prefix;
+  EFI_HANDLE                      SkipHandle;
+
+  SkipHandle     = NULL;
+  CachedFullPath = BmGetCachedShortFormFullPath (FilePath, &Prefix);
+  if (CachedFullPath != NULL) {
+    if (BmConnectShortFormPrefix (Prefix, &gEfiLoadFileProtocolGuid, &SkipHandle)) {
+      if (FullPath == NULL) {
+        NextFullPath = BmExpandLoadFile (SkipHandle, FilePath);
+        if (NextFullPath != NULL) {
+          FreePool (Prefix);
+          FreePool (CachedFullPath);
+          return NextFullPath;
+        }
+      } else if ((GetDevicePathSize (FullPath) >= GetDevicePathSize (Prefix)) &&
+                 (CompareMem (FullPath, Prefix, GetDevicePathSize (Prefix) - END_DEVICE_PATH_LENGTH) == 0)) {
+        //
+        // The cached Load File instance was tried first and didn't work.
+        // Try all the Load File instances from the beginning, except that one.
+        //
+        FullPath = NULL;
+      }
+    } else {
+      SkipHandle = NULL;
+    }
+    FreePool (Prefix);
+    FreePool (CachedFullPath);
+  }
 
   EfiBootManagerConnectAll ();
   Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiLoadFileProtocolGuid, NULL, &HandleCount, &Handles);
@@ -731,6 +1091,10 @@ BmExpandUriDevicePath (
   NextFullPath = NULL;
   GetNext = (BOOLEAN)(FullPath == NULL);
   for (Index = 0; Index < HandleCount; Index++) {
+    if (Handles[Index] == SkipHandle) {
+      continue;
+    }
+
     NextFullPath = BmExpandLoadFile (Handles[Index], FilePath);
 
     if (NextFullPath == NULL) {
@@ -1323,6 +1323,8 @@ BmGetNextLoadOptionBuffer (
   if (FileBuffer == NULL) {
     CurFullPath = NULL;
     LocalFileSize = 0;
+  } else {
+    BmCacheLoadOptionFullPath (FilePath, CurFullPath);
   }
 
   DEBUG ((DEBUG_INFO, "[Bds] Expand "));
@@ -421,6 +421,19 @@ BmDestroyRamDisk (
   IN EFI_DEVICE_PATH_PROTOCOL *RamDiskDevicePath
   );
 
+/**
+  Save the full device path a File-path or URI load option was loaded from,
+  so the next boot can try it without a connect all.
+
+  @param FilePath      The device path of the load option.
+  @param FullPath      The full device path the load option was loaded from.
+**/
+VOID
+BmCacheLoadOptionFullPath (
+  IN EFI_DEVICE_PATH_PROTOCOL     *FilePath,
+  IN EFI_DEVICE_PATH_PROTOCOL     *FullPath
+  );
+
 /**
   Get the next possible full path pointing to the load option.
 
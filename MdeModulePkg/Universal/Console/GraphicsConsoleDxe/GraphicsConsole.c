@@ -36,7 +36,12 @@ GRAPHICS_CONSOLE_DEV    mGraphicsConsoleDevTemplate = {
     FALSE
   },
   (GRAPHICS_CONSOLE_MODE_DATA *) NULL,
-  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL,
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) NULL,
+  (BOOLEAN *) NULL,
+  FALSE,
+  (EFI_EVENT) NULL,
+  (EFI_EVENT) NULL
 };
 
 GRAPHICS_CONSOLE_MODE_DATA mGraphicsConsoleModeData[] = {
@@ -600,6 +605,36 @@ GraphicsConsoleControllerDriverStart (
   Private->SimpleTextOutput.Mode->Mode = (INT32)PreferMode;
   DEBUG ((DEBUG_INFO, "Graphics Console Started, Mode: %d\n", PreferMode));
 
+  if ((Private->GraphicsOutput != NULL) && (PcdGet32 (PcdGraphicsConsoleShadowFlushPeriod) != 0)) {
+    //
+    // Text is drawn into a shadow buffer that SetMode() allocates, and the
+    // changed rows are copied to the screen by FlushEvent. At ReadyToBoot the
+    // pending rows are copied and the console goes back to drawing straight
+    // to the screen, so the last output before the OS loader takes over is
+    // visible without calling Blt() from an ExitBootServices notification.
+    //
+    Status = gBS->CreateEvent (
+                    EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                    TPL_NOTIFY,
+                    GraphicsConsoleFlushNotify,
+                    Private,
+                    &Private->FlushEvent
+                    );
+    if (EFI_ERROR (Status)) {
+      goto Error;
+    }
+
+    Status = EfiCreateEventReadyToBootEx (
+               TPL_NOTIFY,
+               GraphicsConsoleReadyToBootNotify,
+               Private,
+               &Private->ReadyToBootEvent
+               );
+    if (EFI_ERROR (Status)) {
+      goto Error;
+    }
+  }
+
   //
   // Install protocol interfaces for the Graphics Console device.
   //
@@ -631,10 +666,20 @@ Error:
              );
     }
 
+    if (Private->FlushEvent != NULL) {
+      gBS->CloseEvent (Private->FlushEvent);
+    }
+
+    if (Private->ReadyToBootEvent != NULL) {
+      gBS->CloseEvent (Private->ReadyToBootEvent);
+    }
+
     if (Private->LineBuffer != NULL) {
       FreePool (Private->LineBuffer);
     }
 
+    FreeShadowBuffer (Private);
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -700,6 +745,19 @@ GraphicsConsoleControllerDriverStop (
                   );
 
   if (!EFI_ERROR (Status)) {
+    //
+    // Stop the flush timer, then put the rows that have not reached the
+    // screen yet there before the shadow buffer goes away.
+    //
+    if (Private->FlushEvent != NULL) {
+      gBS->CloseEvent (Private->FlushEvent);
+      FlushShadowBuffer (Private);
+    }
+
+    if (Private->ReadyToBootEvent != NULL) {
+      gBS->CloseEvent (Private->ReadyToBootEvent);
+    }
+
     //
     // Close the GOP or UGA IO Protocol
     //
@@ -723,6 +781,8 @@ GraphicsConsoleControllerDriverStop (
       FreePool (Private->LineBuffer);
     }
 
+    FreeShadowBuffer (Private);
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -997,7 +1057,19 @@ GraphicsConsoleConOutOutputString (
       // down one row.
       //
       if (This->Mode->CursorRow == (INT32) (MaxRow - 1)) {
-        if (GraphicsOutput != NULL) {
+        if (Private->ShadowBuffer != NULL) {
+          //
+          // Scroll the shadow buffer up one row and blank the last line. The
+          // whole text area is copied to the screen on the next flush.
+          //
+          CopyMem (
+            Private->ShadowBuffer,
+            Private->ShadowBuffer + Width * EFI_GLYPH_HEIGHT,
+            Height * Delta
+            );
+          FillShadowRows (Private, MaxRow - 1, 1, &Background);
+          MarkShadowRowsDirty (Private, 0, MaxRow);
+        } else if (GraphicsOutput != NULL) {
           //
           // Scroll Screen Up One Row
           //
@@ -1448,6 +1520,24 @@ GraphicsConsoleConOutSetMode (
     }
   }
 
+  if (Private->FlushEvent != NULL) {
+    //
+    // The display has just been cleared to black, which is all zero pixels,
+    // so the shadow buffer of the new mode starts out matching the screen.
+    // Without one, text is drawn straight to the screen.
+    //
+    FreeShadowBuffer (Private);
+    Private->ShadowBuffer = AllocateZeroPool (
+                              sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) *
+                              ModeData->Columns * EFI_GLYPH_WIDTH *
+                              ModeData->Rows * EFI_GLYPH_HEIGHT
+                              );
+    Private->DirtyRow     = AllocateZeroPool (sizeof (BOOLEAN) * ModeData->Rows);
+    if ((Private->ShadowBuffer == NULL) || (Private->DirtyRow == NULL)) {
+      FreeShadowBuffer (Private);
+    }
+  }
+
   //
   // The new mode is valid, so commit the mode change
   //
@@ -1589,6 +1679,14 @@ GraphicsConsoleConOutClearScreen (
     Status = EFI_UNSUPPORTED;
   }
 
+  if (Private->ShadowBuffer != NULL) {
+    //
+    // The screen was filled directly, so no row is left to flush.
+    //
+    FillShadowRows (Private, 0, ModeData->Rows, &Background);
+    ZeroMem (Private->DirtyRow, sizeof (BOOLEAN) * ModeData->Rows);
+  }
+
   This->Mode->CursorColumn  = 0;
   This->Mode->CursorRow     = 0;
 
@@ -1761,25 +1859,20 @@ DrawUnicodeWeightAtCursorN (
 {
   EFI_STATUS                        Status;
   GRAPHICS_CONSOLE_DEV              *Private;
+  GRAPHICS_CONSOLE_MODE_DATA        *ModeData;
+  EFI_IMAGE_OUTPUT                  Image;
   EFI_IMAGE_OUTPUT                  *Blt;
   EFI_STRING                        String;
-  EFI_FONT_DISPLAY_INFO             *FontInfo;
+  EFI_FONT_DISPLAY_INFO             FontInfo;
   EFI_UGA_DRAW_PROTOCOL             *UgaDraw;
   EFI_HII_ROW_INFO                  *RowInfoArray;
   UINTN                             RowInfoArraySize;
 
-  Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
-  Blt = (EFI_IMAGE_OUTPUT *) AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
-  if (Blt == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  Blt->Width        = (UINT16) (Private->ModeData[This->Mode->Mode].GopWidth);
-  Blt->Height       = (UINT16) (Private->ModeData[This->Mode->Mode].GopHeight);
+  Private  = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
+  ModeData = &Private->ModeData[This->Mode->Mode];
 
   String = AllocateCopyPool ((Count + 1) * sizeof (CHAR16), UnicodeWeight);
   if (String == NULL) {
-    FreePool (Blt);
     return EFI_OUT_OF_RESOURCES;
   }
   //
@@ -1787,31 +1880,59 @@ DrawUnicodeWeightAtCursorN (
   //
   *(String + Count) = L'\0';
 
-  FontInfo = (EFI_FONT_DISPLAY_INFO *) AllocateZeroPool (sizeof (EFI_FONT_DISPLAY_INFO));
-  if (FontInfo == NULL) {
-    FreePool (Blt);
-    FreePool (String);
-    return EFI_OUT_OF_RESOURCES;
-  }
   //
   // Get current foreground and background colors.
   //
-  GetTextColors (This, &FontInfo->ForegroundColor, &FontInfo->BackgroundColor);
+  ZeroMem (&FontInfo, sizeof (FontInfo));
+  GetTextColors (This, &FontInfo.ForegroundColor, &FontInfo.BackgroundColor);
 
-  if (Private->GraphicsOutput != NULL) {
+  //
+  // StringToImage () draws into an existing image without freeing it, so the
+  // image descriptor lives on the stack.
+  //
+  ZeroMem (&Image, sizeof (Image));
+  Blt = &Image;
+
+  if (Private->ShadowBuffer != NULL) {
+    //
+    // Draw into the shadow buffer, the row reaches the screen on the next flush.
+    //
+    Image.Width        = (UINT16) (ModeData->Columns * EFI_GLYPH_WIDTH);
+    Image.Height       = (UINT16) (ModeData->Rows * EFI_GLYPH_HEIGHT);
+    Image.Image.Bitmap = Private->ShadowBuffer;
+
+    Status = mHiiFont->StringToImage (
+                         mHiiFont,
+                         EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_IGNORE_LINE_BREAK,
+                         String,
+                         &FontInfo,
+                         &Blt,
+                         This->Mode->CursorColumn * EFI_GLYPH_WIDTH,
+                         This->Mode->CursorRow * EFI_GLYPH_HEIGHT,
+                         NULL,
+                         NULL,
+                         NULL
+                         );
+    if (!EFI_ERROR (Status)) {
+      MarkShadowRowsDirty (Private, This->Mode->CursorRow, 1);
+    }
+
+  } else if (Private->GraphicsOutput != NULL) {
     //
     // If Graphics Output protocol exists, using HII Font protocol to draw.
     //
-    Blt->Image.Screen = Private->GraphicsOutput;
+    Image.Width        = (UINT16) ModeData->GopWidth;
+    Image.Height       = (UINT16) ModeData->GopHeight;
+    Image.Image.Screen = Private->GraphicsOutput;
 
     Status = mHiiFont->StringToImage (
                          mHiiFont,
                          EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_DIRECT_TO_SCREEN | EFI_HII_IGNORE_LINE_BREAK,
                          String,
-                         FontInfo,
+                         &FontInfo,
                          &Blt,
-                         This->Mode->CursorColumn * EFI_GLYPH_WIDTH + Private->ModeData[This->Mode->Mode].DeltaX,
-                         This->Mode->CursorRow * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
+                         This->Mode->CursorColumn * EFI_GLYPH_WIDTH + ModeData->DeltaX,
+                         This->Mode->CursorRow * EFI_GLYPH_HEIGHT + ModeData->DeltaY,
                          NULL,
                          NULL,
                          NULL
@@ -1826,12 +1947,13 @@ DrawUnicodeWeightAtCursorN (
 
     UgaDraw = Private->UgaDraw;
 
-    Blt->Image.Bitmap = AllocateZeroPool (Blt->Width * Blt->Height * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-    if (Blt->Image.Bitmap == NULL) {
-      FreePool (Blt);
-      FreePool (String);
-      return EFI_OUT_OF_RESOURCES;
-    }
+    //
+    // The string never extends past the last column, so it is drawn into the
+    // one text line high LineBuffer instead of a bitmap of the whole screen.
+    //
+    Image.Width        = (UINT16) (ModeData->Columns * EFI_GLYPH_WIDTH);
+    Image.Height       = EFI_GLYPH_HEIGHT;
+    Image.Image.Bitmap = Private->LineBuffer;
 
     RowInfoArray = NULL;
     //
@@ -1842,10 +1964,10 @@ DrawUnicodeWeightAtCursorN (
                           mHiiFont,
                           EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_IGNORE_LINE_BREAK,
                           String,
-                          FontInfo,
+                          &FontInfo,
                           &Blt,
-                          This->Mode->CursorColumn * EFI_GLYPH_WIDTH + Private->ModeData[This->Mode->Mode].DeltaX,
-                          This->Mode->CursorRow * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
+                          0,
+                          0,
                           &RowInfoArray,
                           &RowInfoArraySize,
                           NULL
@@ -1860,33 +1982,24 @@ DrawUnicodeWeightAtCursorN (
 
       Status = UgaDraw->Blt (
                           UgaDraw,
-                          (EFI_UGA_PIXEL *) Blt->Image.Bitmap,
+                          (EFI_UGA_PIXEL *) Image.Image.Bitmap,
                           EfiUgaBltBufferToVideo,
-                          This->Mode->CursorColumn * EFI_GLYPH_WIDTH  + Private->ModeData[This->Mode->Mode].DeltaX,
-                          (This->Mode->CursorRow) * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
-                          This->Mode->CursorColumn * EFI_GLYPH_WIDTH  + Private->ModeData[This->Mode->Mode].DeltaX,
-                          (This->Mode->CursorRow) * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
+                          0,
+                          0,
+                          This->Mode->CursorColumn * EFI_GLYPH_WIDTH  + ModeData->DeltaX,
+                          (This->Mode->CursorRow) * EFI_GLYPH_HEIGHT + ModeData->DeltaY,
                           RowInfoArray[0].LineWidth,
                           RowInfoArray[0].LineHeight,
-                          Blt->Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                          Image.Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
                           );
     }
 
     FreePool (RowInfoArray);
-    FreePool (Blt->Image.Bitmap);
   } else {
     Status = EFI_UNSUPPORTED;
   }
 
-  if (Blt != NULL) {
-    FreePool (Blt);
-  }
-  if (String != NULL) {
-    FreePool (String);
-  }
-  if (FontInfo != NULL) {
-    FreePool (FontInfo);
-  }
+  FreePool (String);
   return Status;
 }
 
@@ -1917,6 +2030,8 @@ FlushCursor (
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Foreground;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Background;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION BltChar[EFI_GLYPH_HEIGHT][EFI_GLYPH_WIDTH];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION *Shadow;
+  UINTN                               Width;
   UINTN                               PosX;
   UINTN                               PosY;
 
@@ -1930,6 +2045,34 @@ FlushCursor (
   GraphicsOutput = Private->GraphicsOutput;
   UgaDraw = Private->UgaDraw;
 
+  if (Private->ShadowBuffer != NULL) {
+    //
+    // Toggle the cursor in the shadow buffer rather than reading the
+    // character cell back from video memory. OutputString() briefly leaves
+    // the cursor one column past the end of a full line, and always toggles
+    // it there twice, so that cell can be skipped.
+    //
+    Width = Private->ModeData[CurrentMode->Mode].Columns * EFI_GLYPH_WIDTH;
+    if ((UINTN) CurrentMode->CursorColumn * EFI_GLYPH_WIDTH >= Width) {
+      return EFI_SUCCESS;
+    }
+
+    GetTextColors (This, &Foreground.Pixel, &Background.Pixel);
+    Shadow = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION *) Private->ShadowBuffer +
+             CurrentMode->CursorRow * EFI_GLYPH_HEIGHT * Width +
+             CurrentMode->CursorColumn * EFI_GLYPH_WIDTH;
+    for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+      for (PosX = 0; PosX < EFI_GLYPH_WIDTH; PosX++) {
+        if ((mCursorGlyph.GlyphCol1[PosY] & (BIT0 << PosX)) != 0) {
+          Shadow[PosY * Width + EFI_GLYPH_WIDTH - PosX - 1].Raw ^= Foreground.Raw;
+        }
+      }
+    }
+
+    MarkShadowRowsDirty (Private, CurrentMode->CursorRow, 1);
+    return EFI_SUCCESS;
+  }
+
   //
   // In this driver, only narrow character was supported.
   //
@@ -2010,6 +2153,196 @@ FlushCursor (
   return EFI_SUCCESS;
 }
 
+/**
+  Fill rows of text in the shadow buffer with one color.
+
+  @param  Private               Graphics Console device with a shadow buffer.
+  @param  Row                   The first row of text to fill.
+  @param  Count                 The number of rows of text to fill.
+  @param  Color                 The color to fill the rows with.
+
+**/
+VOID
+FillShadowRows (
+  IN  GRAPHICS_CONSOLE_DEV                 *Private,
+  IN  UINTN                                Row,
+  IN  UINTN                                Count,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Color
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Fill;
+  UINTN                                Width;
+
+  Fill.Pixel = *Color;
+  Width      = Private->ModeData[Private->SimpleTextOutputMode.Mode].Columns * EFI_GLYPH_WIDTH;
+  SetMem32 (
+    Private->ShadowBuffer + Row * EFI_GLYPH_HEIGHT * Width,
+    Count * EFI_GLYPH_HEIGHT * Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL),
+    Fill.Raw
+    );
+}
+
+/**
+  Record that rows of text in the shadow buffer differ from the screen.
+
+  The flush timer is started by the first change after a flush, so the rows
+  reach the screen at most PcdGraphicsConsoleShadowFlushPeriod later, and an
+  idle console does not wake up to check for changes.
+
+  @param  Private               Graphics Console device with a shadow buffer.
+  @param  Row                   The first row of text that changed.
+  @param  Count                 The number of rows of text that changed.
+
+**/
+VOID
+MarkShadowRowsDirty (
+  IN  GRAPHICS_CONSOLE_DEV  *Private,
+  IN  UINTN                 Row,
+  IN  UINTN                 Count
+  )
+{
+  SetMem (&Private->DirtyRow[Row], sizeof (BOOLEAN) * Count, TRUE);
+
+  if (!Private->FlushPending) {
+    Private->FlushPending = TRUE;
+    gBS->SetTimer (
+           Private->FlushEvent,
+           TimerRelative,
+           PcdGet32 (PcdGraphicsConsoleShadowFlushPeriod)
+           );
+  }
+}
+
+/**
+  Copy the rows of text that changed since the last flush from the shadow
+  buffer to the screen.
+
+  Adjacent changed rows are copied with a single Blt() call.
+
+  @param  Private               Graphics Console device.
+
+**/
+VOID
+FlushShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV  *Private
+  )
+{
+  GRAPHICS_CONSOLE_MODE_DATA    *ModeData;
+  UINTN                         Width;
+  UINTN                         Row;
+  UINTN                         FirstRow;
+
+  Private->FlushPending = FALSE;
+  if (Private->ShadowBuffer == NULL) {
+    return;
+  }
+
+  ModeData = &Private->ModeData[Private->SimpleTextOutputMode.Mode];
+  Width    = ModeData->Columns * EFI_GLYPH_WIDTH;
+
+  Row = 0;
+  while (Row < ModeData->Rows) {
+    if (!Private->DirtyRow[Row]) {
+      Row++;
+      continue;
+    }
+
+    FirstRow = Row;
+    while ((Row < ModeData->Rows) && Private->DirtyRow[Row]) {
+      Private->DirtyRow[Row] = FALSE;
+      Row++;
+    }
+
+    Private->GraphicsOutput->Blt (
+                               Private->GraphicsOutput,
+                               Private->ShadowBuffer,
+                               EfiBltBufferToVideo,
+                               0,
+                               FirstRow * EFI_GLYPH_HEIGHT,
+                               ModeData->DeltaX,
+                               ModeData->DeltaY + FirstRow * EFI_GLYPH_HEIGHT,
+                               Width,
+                               (Row - FirstRow) * EFI_GLYPH_HEIGHT,
+                               Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                               );
+  }
+}
+
+/**
+  Free the shadow buffer of the current mode.
+
+  Text is then drawn straight to the screen.
+
+  @param  Private               Graphics Console device.
+
+**/
+VOID
+FreeShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV  *Private
+  )
+{
+  if (Private->ShadowBuffer != NULL) {
+    FreePool (Private->ShadowBuffer);
+    Private->ShadowBuffer = NULL;
+  }
+
+  if (Private->DirtyRow != NULL) {
+    FreePool (Private->DirtyRow);
+    Private->DirtyRow = NULL;
+  }
+}
+
+/**
+  Flush the shadow buffer when the flush timer expires.
+
+  @param[in] Event    Event whose notification function is being invoked.
+  @param[in] Context  The Graphics Console device.
+**/
+VOID
+EFIAPI
+GraphicsConsoleFlushNotify (
+  IN  EFI_EVENT       Event,
+  IN  VOID            *Context
+  )
+{
+  FlushShadowBuffer ((GRAPHICS_CONSOLE_DEV *) Context);
+}
+
+/**
+  Flush the shadow buffer at ReadyToBoot and draw straight to the screen
+  from then on.
+
+  The OS loader may take over the screen without giving the flush timer
+  another chance to run, and GOP must not be used from an ExitBootServices
+  notification. Drawing straight to the screen from ReadyToBoot on makes
+  every OutputString() and SetMode() before the hand-off visible at once.
+
+  @param[in] Event    Event whose notification function is being invoked.
+  @param[in] Context  The Graphics Console device.
+**/
+VOID
+EFIAPI
+GraphicsConsoleReadyToBootNotify (
+  IN  EFI_EVENT       Event,
+  IN  VOID            *Context
+  )
+{
+  GRAPHICS_CONSOLE_DEV  *Private;
+
+  Private = (GRAPHICS_CONSOLE_DEV *) Context;
+  if (Private->FlushEvent == NULL) {
+    return;
+  }
+
+  //
+  // Without FlushEvent, SetMode() does not allocate a new shadow buffer.
+  //
+  gBS->CloseEvent (Private->FlushEvent);
+  Private->FlushEvent = NULL;
+  FlushShadowBuffer (Private);
+  FreeShadowBuffer (Private);
+}
+
 /**
   HII Database Protocol notification event handler.
 
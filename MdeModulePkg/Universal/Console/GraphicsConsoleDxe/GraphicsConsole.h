@@ -65,6 +65,18 @@ typedef struct {
   EFI_SIMPLE_TEXT_OUTPUT_MODE      SimpleTextOutputMode;
   GRAPHICS_CONSOLE_MODE_DATA       *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *LineBuffer;
+  //
+  // Copy of the text area of the current mode, used instead of drawing on
+  // the screen when PcdGraphicsConsoleShadowFlushPeriod is not zero. Rows of
+  // text that differ from the screen are set in DirtyRow and copied to the
+  // screen when FlushEvent is signaled. ReadyToBootEvent flushes them and
+  // frees the shadow buffer for good.
+  //
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *ShadowBuffer;
+  BOOLEAN                          *DirtyRow;
+  BOOLEAN                          FlushPending;
+  EFI_EVENT                        FlushEvent;
+  EFI_EVENT                        ReadyToBootEvent;
 } GRAPHICS_CONSOLE_DEV;
 
 #define GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS(a) \
@@ -564,6 +576,96 @@ FlushCursor (
   IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This
   );
 
+/**
+  Fill rows of text in the shadow buffer with one color.
+
+  @param  Private               Graphics Console device with a shadow buffer.
+  @param  Row                   The first row of text to fill.
+  @param  Count                 The number of rows of text to fill.
+  @param  Color                 The color to fill the rows with.
+
+**/
+VOID
+FillShadowRows (
+  IN  GRAPHICS_CONSOLE_DEV                 *Private,
+  IN  UINTN                                Row,
+  IN  UINTN                                Count,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Color
+  );
+
+/**
+  Record that rows of text in the shadow buffer differ from the screen.
+
+  The flush timer is started by the first change after a flush, so the rows
+  reach the screen at most PcdGraphicsConsoleShadowFlushPeriod later, and an
+  idle console does not wake up to check for changes.
+
+  @param  Private               Graphics Console device with a shadow buffer.
+  @param  Row                   The first row of text that changed.
+  @param  Count                 The number of rows of text that changed.
+
+**/
+VOID
+MarkShadowRowsDirty (
+  IN  GRAPHICS_CONSOLE_DEV  *Private,
+  IN  UINTN                 Row,
+  IN  UINTN                 Count
+  );
+
+/**
+  Copy the rows of text that changed since the last flush from the shadow
+  buffer to the screen.
+
+  Adjacent changed rows are copied with a single Blt() call.
+
+  @param  Private               Graphics Console device.
+
+**/
+VOID
+FlushShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV  *Private
+  );
+
+/**
+  Free the shadow buffer of the current mode.
+
+  Text is then drawn straight to the screen.
+
+  @param  Private               Graphics Console device.
+
+**/
+VOID
+FreeShadowBuffer (
+  IN  GRAPHICS_CONSOLE_DEV  *Private
+  );
+
+/**
+  Flush the shadow buffer when the flush timer expires.
+
+  @param[in] Event    Event whose notification function is being invoked.
+  @param[in] Context  The Graphics Console device.
+**/
+VOID
+EFIAPI
+GraphicsConsoleFlushNotify (
+  IN  EFI_EVENT       Event,
+  IN  VOID            *Context
+  );
+
+/**
+  Flush the shadow buffer at ReadyToBoot and draw straight to the screen
+  from then on.
+
+  @param[in] Event    Event whose notification function is being invoked.
+  @param[in] Context  The Graphics Console device.
+**/
+VOID
+EFIAPI
+GraphicsConsoleReadyToBootNotify (
+  IN  EFI_EVENT       Event,
+  IN  VOID            *Context
+  );
+
 /**
   Check if the current specific mode supported the user defined resolution
   for the Graphics Console device based on Graphics Output Protocol.
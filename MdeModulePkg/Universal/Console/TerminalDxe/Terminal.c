@@ -111,7 +111,8 @@ TERMINAL_DEV  mTerminalDevTemplate = {
     NULL,
     NULL,
   },
-  NULL // KeyNotifyProcessEvent
+  NULL, // KeyNotifyProcessEvent
+  FALSE // CursorSynced
 };
 
 TERMINAL_CONSOLE_MODE_DATA mTerminalConsoleModeData[] = {
@@ -65,6 +65,13 @@ typedef struct {
 
 #define KEYBOARD_TIMER_INTERVAL         200000  // 0.02s
 
+//
+// Size of the buffer in which OutputString() collects the bytes for the
+// serial device, so that a string is written in a few large writes instead
+// of one write per character.
+//
+#define TERMINAL_OUTPUT_BUFFER_SIZE     256
+
 #define TERMINAL_DEV_SIGNATURE  SIGNATURE_32 ('t', 'm', 'n', 'l')
 
 #define TERMINAL_CONSOLE_IN_EX_NOTIFY_SIGNATURE SIGNATURE_32 ('t', 'm', 'e', 'n')
@@ -122,6 +129,12 @@ typedef struct {
   EFI_SIMPLE_TEXT_INPUT_EX_PROTOCOL   SimpleInputEx;
   LIST_ENTRY                          NotifyList;
   EFI_EVENT                           KeyNotifyProcessEvent;
+  //
+  // TRUE if the cursor of the terminal is known to be at the position in
+  // SimpleTextOutputMode, so that SetCursorPosition() to that position need
+  // not send anything.
+  //
+  BOOLEAN                             CursorSynced;
 } TERMINAL_DEV;
 
 #define INPUT_STATE_DEFAULT               0x00
@@ -574,6 +587,49 @@ TerminalConOutSetCursorPosition (
   IN  UINTN                            Row
   );
 
+/**
+  Write the bytes collected in an output buffer to the serial device.
+
+  @param  TerminalDevice  The terminal device.
+  @param  Buffer          The output buffer.
+  @param  Length          On input, the number of bytes in Buffer.
+                          On output, zero.
+
+  @retval EFI_SUCCESS     The bytes were written.
+  @retval Others          The serial device failed to write the bytes.
+
+**/
+EFI_STATUS
+TerminalFlushOutput (
+  IN     TERMINAL_DEV  *TerminalDevice,
+  IN     UINT8         *Buffer,
+  IN OUT UINTN         *Length
+  );
+
+/**
+  Append bytes to an output buffer of TERMINAL_OUTPUT_BUFFER_SIZE bytes,
+  and write the buffer to the serial device first if they do not fit.
+
+  @param  TerminalDevice  The terminal device.
+  @param  Buffer          The output buffer.
+  @param  Length          The number of bytes in Buffer.
+  @param  Data            The bytes to append.
+  @param  DataLength      The number of bytes to append, at most
+                          TERMINAL_OUTPUT_BUFFER_SIZE.
+
+  @retval EFI_SUCCESS     The bytes were appended.
+  @retval Others          The serial device failed to write the buffer.
+
+**/
+EFI_STATUS
+TerminalBufferOutput (
+  IN     TERMINAL_DEV  *TerminalDevice,
+  IN     UINT8         *Buffer,
+  IN OUT UINTN         *Length,
+  IN     CONST VOID    *Data,
+  IN     UINTN         DataLength
+  );
+
 /**
   Implements SIMPLE_TEXT_OUTPUT.EnableCursor().
   In this driver, the cursor cannot be hidden.
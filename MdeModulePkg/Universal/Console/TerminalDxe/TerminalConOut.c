@@ -147,6 +147,80 @@ TerminalConOutReset (
   return Status;
 }
 
+/**
+  Write the bytes collected in an output buffer to the serial device.
+
+  @param  TerminalDevice  The terminal device.
+  @param  Buffer          The output buffer.
+  @param  Length          On input, the number of bytes in Buffer.
+                          On output, zero.
+
+  @retval EFI_SUCCESS     The bytes were written.
+  @retval Others          The serial device failed to write the bytes.
+
+**/
+EFI_STATUS
+TerminalFlushOutput (
+  IN     TERMINAL_DEV  *TerminalDevice,
+  IN     UINT8         *Buffer,
+  IN OUT UINTN         *Length
+  )
+{
+  EFI_STATUS  Status;
+
+  if (*Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Status = TerminalDevice->SerialIo->Write (
+                                      TerminalDevice->SerialIo,
+                                      Length,
+                                      Buffer
+                                      );
+  *Length = 0;
+  return Status;
+}
+
+/**
+  Append bytes to an output buffer of TERMINAL_OUTPUT_BUFFER_SIZE bytes,
+  and write the buffer to the serial device first if they do not fit.
+
+  @param  TerminalDevice  The terminal device.
+  @param  Buffer          The output buffer.
+  @param  Length          The number of bytes in Buffer.
+  @param  Data            The bytes to append.
+  @param  DataLength      The number of bytes to append, at most
+                          TERMINAL_OUTPUT_BUFFER_SIZE.
+
+  @retval EFI_SUCCESS     The bytes were appended.
+  @retval Others          The serial device failed to write the buffer.
+
+**/
+EFI_STATUS
+TerminalBufferOutput (
+  IN     TERMINAL_DEV  *TerminalDevice,
+  IN     UINT8         *Buffer,
+  IN OUT UINTN         *Length,
+  IN     CONST VOID    *Data,
+  IN     UINTN         DataLength
+  )
+{
+  EFI_STATUS  Status;
+
+  ASSERT (DataLength <= TERMINAL_OUTPUT_BUFFER_SIZE);
+
+  if (*Length + DataLength > TERMINAL_OUTPUT_BUFFER_SIZE) {
+    Status = TerminalFlushOutput (TerminalDevice, Buffer, Length);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  CopyMem (Buffer + *Length, Data, DataLength);
+  *Length += DataLength;
+  return EFI_SUCCESS;
+}
+
 
 /**
   Implements EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL.OutputString().
@@ -176,7 +250,6 @@ TerminalConOutOutputString (
   EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode;
   UINTN                       MaxColumn;
   UINTN                       MaxRow;
-  UINTN                       Length;
   UTF8_CHAR                   Utf8Char;
   CHAR8                       GraphicChar;
   CHAR8                       AsciiChar;
@@ -188,10 +261,13 @@ TerminalConOutOutputString (
   //  return EFI_WARN_UNKNOWN_GLYPH
   //
   BOOLEAN                     Warning;
+  UINT8                       OutputBuffer[TERMINAL_OUTPUT_BUFFER_SIZE];
+  UINTN                       OutputLength;
 
-  ValidBytes  = 0;
-  Warning     = FALSE;
-  AsciiChar   = 0;
+  ValidBytes   = 0;
+  Warning      = FALSE;
+  AsciiChar    = 0;
+  OutputLength = 0;
 
   //
   //  get Terminal device data structure pointer.
@@ -255,13 +331,13 @@ TerminalConOutOutputString (
         GraphicChar = AsciiChar;
       }
 
-      Length = 1;
-
-      Status = TerminalDevice->SerialIo->Write (
-                                          TerminalDevice->SerialIo,
-                                          &Length,
-                                          &GraphicChar
-                                          );
+      Status = TerminalBufferOutput (
+                 TerminalDevice,
+                 OutputBuffer,
+                 &OutputLength,
+                 &GraphicChar,
+                 1
+                 );
 
       if (EFI_ERROR (Status)) {
         goto OutputError;
@@ -271,15 +347,23 @@ TerminalConOutOutputString (
 
     case TerminalTypeVtUtf8:
       UnicodeToUtf8 (*WString, &Utf8Char, &ValidBytes);
-      Length = ValidBytes;
-      Status = TerminalDevice->SerialIo->Write (
-                                          TerminalDevice->SerialIo,
-                                          &Length,
-                                          (UINT8 *) &Utf8Char
-                                          );
+      Status = TerminalBufferOutput (
+                 TerminalDevice,
+                 OutputBuffer,
+                 &OutputLength,
+                 &Utf8Char,
+                 ValidBytes
+                 );
       if (EFI_ERROR (Status)) {
         goto OutputError;
       }
+      //
+      // The terminal may draw a character that is not ASCII in more or
+      // fewer than one column.
+      //
+      if (*WString > 0x7F && !TerminalDevice->OutputEscChar) {
+        TerminalDevice->CursorSynced = FALSE;
+      }
       break;
     }
     //
@@ -304,6 +388,13 @@ TerminalConOutOutputString (
       break;
 
     default:
+      if (*WString == CHAR_TAB && !TerminalDevice->OutputEscChar) {
+        //
+        // The terminal moves the cursor to its next tab stop.
+        //
+        TerminalDevice->CursorSynced = FALSE;
+      }
+
       if (Mode->CursorColumn < (INT32) (MaxColumn - 1)) {
 
         Mode->CursorColumn++;
@@ -315,6 +406,15 @@ TerminalConOutOutputString (
           Mode->CursorRow++;
         }
 
+        if (TerminalDevice->TerminalType != TerminalTypeTtyTerm &&
+            !TerminalDevice->OutputEscChar) {
+          //
+          // Whether and when the terminal wraps its cursor after the last
+          // column depends on the terminal.
+          //
+          TerminalDevice->CursorSynced = FALSE;
+        }
+
         if (TerminalDevice->TerminalType == TerminalTypeTtyTerm &&
             !TerminalDevice->OutputEscChar) {
           //
@@ -328,13 +428,13 @@ TerminalConOutOutputString (
           CrLfStr[0] = '\r';
           CrLfStr[1] = '\n';
 
-          Length = sizeof(CrLfStr);
-
-          Status = TerminalDevice->SerialIo->Write (
-                                                TerminalDevice->SerialIo,
-                                                &Length,
-                                                CrLfStr
-                                                );
+          Status = TerminalBufferOutput (
+                     TerminalDevice,
+                     OutputBuffer,
+                     &OutputLength,
+                     CrLfStr,
+                     sizeof (CrLfStr)
+                     );
 
           if (EFI_ERROR (Status)) {
             goto OutputError;
@@ -347,6 +447,11 @@ TerminalConOutOutputString (
 
   }
 
+  Status = TerminalFlushOutput (TerminalDevice, OutputBuffer, &OutputLength);
+  if (EFI_ERROR (Status)) {
+    goto OutputError;
+  }
+
   if (Warning) {
     return EFI_WARN_UNKNOWN_GLYPH;
   }
@@ -725,6 +830,10 @@ TerminalConOutClearScreen (
     return EFI_DEVICE_ERROR;
   }
 
+  //
+  // Not every terminal homes the cursor when it clears the screen.
+  //
+  TerminalDevice->CursorSynced = FALSE;
   Status = This->SetCursorPosition (This, 0, 0);
 
   return Status;
@@ -782,6 +891,17 @@ TerminalConOutSetCursorPosition (
   if (Column >= MaxColumn || Row >= MaxRow) {
     return EFI_UNSUPPORTED;
   }
+
+  //
+  // Skip the control sequence if the cursor of the terminal is already at
+  // the requested position.
+  //
+  if (TerminalDevice->CursorSynced &&
+      (UINTN) Mode->CursorColumn == Column &&
+      (UINTN) Mode->CursorRow == Row) {
+    return EFI_SUCCESS;
+  }
+
   //
   // control sequence to move the cursor
   //
@@ -826,6 +946,9 @@ TerminalConOutSetCursorPosition (
   //
   Mode->CursorColumn  = (INT32) Column;
   Mode->CursorRow     = (INT32) Row;
+  if (String == mSetCursorPositionString) {
+    TerminalDevice->CursorSynced = TRUE;
+  }
 
   return EFI_SUCCESS;
 }
@@ -0,0 +1,424 @@
+/** @file
+  Publishes the debug log ring that DxeDebugLibBufferedSerialPort appends
+  DEBUG() messages to, and copies the ring to the serial port.
+
+  The ring is drained from a periodic TPL_CALLBACK timer, and whenever the DXE
+  core is idle. Each drain sends what the serial port transmit FIFO holds plus
+  what the line carries in the time since the previous drain, so the ring
+  keeps up with the line rate while a drain waits for the serial port for at
+  most about the time between two drains. The whole ring is sent at once on
+  ExitBootServices(), on ResetSystem(), and before an ASSERT() message.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Guid/DebugLogRing.h>
+#include <Guid/IdleLoopEvent.h>
+#include <Protocol/ResetNotification.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PrintLib.h>
+#include <Library/SerialPortLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+//
+// 16550 FIFO Control Register bits, to find the transmit FIFO size the way
+// BaseSerialPortLib16550 does.
+//
+#define B_UART_FCR_FIFOE   BIT0
+#define B_UART_FCR_FIFO64  BIT5
+
+EDKII_DEBUG_LOG_RING  *mDebugLogRing;
+
+//
+// Number of bytes of the message in the record at Tail that have already
+// been sent to the serial port.
+//
+UINT32                mDrainedLength;
+
+//
+// Number of bytes per second that the serial port sends, and number of bytes
+// its transmit FIFO accepts at once.
+//
+UINT32                mSerialBytesPerSecond;
+UINT32                mSerialFifoSize;
+
+//
+// Performance counter value at the previous drain.
+//
+UINT64                mLastDrainCounter;
+
+VOID                  *mResetNotificationRegistration;
+
+/**
+  Send up to Budget bytes of the messages in the debug log ring to the serial
+  port.
+
+  A message is removed from the ring only once it has been sent completely.
+  If the ring is already being drained, this returns at once.
+
+  @param  Budget    The maximum number of bytes to send.
+
+**/
+VOID
+DrainDebugLogRing (
+  IN UINT32  Budget
+  )
+{
+  EDKII_DEBUG_LOG_RING  *Ring;
+  UINT8                 *Data;
+  UINT32                Mask;
+  UINT32                Tail;
+  UINT32                Header;
+  UINT32                Length;
+  UINT32                RecordSize;
+  UINT32                Offset;
+  UINT32                Chunk;
+  UINT32                Dropped;
+  CHAR8                 Buffer[64];
+
+  Ring = mDebugLogRing;
+  if (InterlockedCompareExchange32 (&Ring->Draining, 0, 1) != 0) {
+    return;
+  }
+
+  Data = (UINT8 *) (Ring + 1);
+  Mask = Ring->Size - 1;
+
+  while ((Budget != 0) && (Ring->Tail != Ring->Head)) {
+    Tail   = Ring->Tail;
+    Header = *(volatile UINT32 *) (Data + (Tail & Mask));
+    if ((Header & EDKII_DEBUG_LOG_RING_RECORD_VALID) == 0) {
+      //
+      // The record has been reserved but its message is still being copied.
+      //
+      break;
+    }
+
+    MemoryFence ();
+    Length = Header & ~EDKII_DEBUG_LOG_RING_RECORD_VALID;
+
+    //
+    // Send the next part of the message, which may wrap around the end of
+    // the ring.
+    //
+    Offset = (Tail + sizeof (UINT32) + mDrainedLength) & Mask;
+    Chunk  = MIN (Length - mDrainedLength, Budget);
+    Chunk  = MIN (Chunk, Ring->Size - Offset);
+    if (Chunk != 0) {
+      SerialPortWrite (Data + Offset, Chunk);
+    }
+    mDrainedLength += Chunk;
+    Budget         -= Chunk;
+    if (mDrainedLength < Length) {
+      continue;
+    }
+
+    //
+    // Clear the record, so that its bytes are not taken for a header later,
+    // and then hand the space back to the writers.
+    //
+    RecordSize = (UINT32) ALIGN_VALUE (sizeof (UINT32) + Length, EDKII_DEBUG_LOG_RING_ALIGNMENT);
+    Offset     = Tail & Mask;
+    Chunk      = MIN (RecordSize, Ring->Size - Offset);
+    ZeroMem (Data + Offset, Chunk);
+    ZeroMem (Data, RecordSize - Chunk);
+    mDrainedLength = 0;
+
+    MemoryFence ();
+    Ring->Tail = Tail + RecordSize;
+  }
+
+  //
+  // Report the messages that did not fit in the ring once everything that
+  // was queued before them has been sent.
+  //
+  Dropped = Ring->Dropped;
+  if ((Dropped != 0) && (Ring->Tail == Ring->Head) &&
+      (InterlockedCompareExchange32 (&Ring->Dropped, Dropped, 0) == Dropped)) {
+    AsciiSPrint (Buffer, sizeof (Buffer), "DebugLogRing: %d messages dropped\n", Dropped);
+    SerialPortWrite ((UINT8 *) Buffer, AsciiStrLen (Buffer));
+  }
+
+  InterlockedCompareExchange32 (&Ring->Draining, 1, 0);
+}
+
+/**
+  Send all messages in the debug log ring to the serial port.
+
+  If the ring is already being drained, this returns at once.
+
+**/
+VOID
+EFIAPI
+FlushDebugLogRing (
+  VOID
+  )
+{
+  DrainDebugLogRing (MAX_UINT32);
+}
+
+/**
+  Return the number of bytes that the serial port can send since the previous
+  drain.
+
+  That is the transmit FIFO, which may be filled at once, plus the bytes that
+  the line carries in the time since the previous drain.
+
+  @return The number of bytes to send.
+
+**/
+UINT32
+GetDebugLogRingDrainBudget (
+  VOID
+  )
+{
+  UINT64  Counter;
+  UINT64  StartValue;
+  UINT64  EndValue;
+  UINT64  Ticks;
+  UINT64  Bytes;
+
+  Counter = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (StartValue < EndValue) {
+    if (Counter >= mLastDrainCounter) {
+      Ticks = Counter - mLastDrainCounter;
+    } else {
+      Ticks = (EndValue - mLastDrainCounter) + (Counter - StartValue);
+    }
+  } else {
+    if (Counter <= mLastDrainCounter) {
+      Ticks = mLastDrainCounter - Counter;
+    } else {
+      Ticks = (mLastDrainCounter - EndValue) + (StartValue - Counter);
+    }
+  }
+  mLastDrainCounter = Counter;
+
+  Bytes = DivU64x32 (
+            MultU64x32 (GetTimeInNanoSecond (Ticks), mSerialBytesPerSecond),
+            1000000000
+            ) + mSerialFifoSize;
+  return (UINT32) MIN (Bytes, MAX_UINT32);
+}
+
+/**
+  Send the next part of the debug log ring to the serial port on each tick
+  of the drain timer, and whenever the DXE core is idle.
+
+  While the system is idle the DXE core signals the idle event over and over,
+  so the ring is drained until it is empty.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+DebugLogRingDrainNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DrainDebugLogRing (GetDebugLogRingDrainBudget ());
+}
+
+/**
+  Send all messages in the debug log ring to the serial port, and stop using
+  the ring, when boot services are about to end.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+DebugLogRingExitBootServicesNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  FlushDebugLogRing ();
+  mDebugLogRing->Enabled = FALSE;
+}
+
+/**
+  Send all messages in the debug log ring to the serial port before the
+  system is reset.
+
+  @param[in] ResetType      The type of reset to perform.
+  @param[in] ResetStatus    The status code for the reset.
+  @param[in] DataSize       The size, in bytes, of ResetData.
+  @param[in] ResetData      Optional element used to introduce a platform
+                            specific reset.
+
+**/
+VOID
+EFIAPI
+DebugLogRingResetNotify (
+  IN EFI_RESET_TYPE  ResetType,
+  IN EFI_STATUS      ResetStatus,
+  IN UINTN           DataSize,
+  IN VOID            *ResetData OPTIONAL
+  )
+{
+  FlushDebugLogRing ();
+}
+
+/**
+  Register DebugLogRingResetNotify() once the Reset Notification Protocol is
+  installed.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      Pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+DebugLogRingResetNotificationInstalled (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_RESET_NOTIFICATION_PROTOCOL  *ResetNotify;
+
+  Status = gBS->LocateProtocol (&gEfiResetNotificationProtocolGuid, NULL, (VOID **) &ResetNotify);
+  if (!EFI_ERROR (Status)) {
+    ResetNotify->RegisterResetNotify (ResetNotify, DebugLogRingResetNotify);
+    gBS->CloseEvent (Event);
+  }
+}
+
+/**
+  The entry point allocates the debug log ring, publishes it in the EFI System
+  Configuration Table, and starts draining it to the serial port.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS           The debug log ring is in use.
+  @retval EFI_OUT_OF_RESOURCES  The debug log ring could not be allocated.
+  @return other                 The debug log ring could not be published or
+                                drained.
+
+**/
+EFI_STATUS
+EFIAPI
+DebugLogRingDxeEntryPoint (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Size;
+  EFI_EVENT   TimerEvent;
+  EFI_EVENT   IdleLoopEvent;
+  EFI_EVENT   ExitBootServicesEvent;
+
+  Size = PcdGet32 (PcdDebugLogRingSize);
+  if ((Size < SIZE_4KB) || ((Size & (Size - 1)) != 0)) {
+    DEBUG ((DEBUG_ERROR, "DebugLogRing: ring size 0x%x is not a power of two of at least 4KB\n", Size));
+    return EFI_UNSUPPORTED;
+  }
+
+  mDebugLogRing = AllocateZeroPool (sizeof (EDKII_DEBUG_LOG_RING) + Size);
+  if (mDebugLogRing == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mDebugLogRing->Signature = EDKII_DEBUG_LOG_RING_SIGNATURE;
+  mDebugLogRing->Size      = Size;
+  mDebugLogRing->Flush     = FlushDebugLogRing;
+  mDebugLogRing->Enabled   = TRUE;
+
+  //
+  // A character takes ten bits on the line: start bit, eight data bits and
+  // stop bit.
+  //
+  mSerialBytesPerSecond = PcdGet32 (PcdSerialBaudRate) / 10;
+  mSerialFifoSize       = 1;
+  if ((PcdGet8 (PcdSerialFifoControl) & B_UART_FCR_FIFOE) != 0) {
+    if ((PcdGet8 (PcdSerialFifoControl) & B_UART_FCR_FIFO64) == 0) {
+      mSerialFifoSize = 16;
+    } else {
+      mSerialFifoSize = PcdGet32 (PcdSerialExtendedTxFifoSize);
+    }
+  }
+  mLastDrainCounter = GetPerformanceCounter ();
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  DebugLogRingDrainNotify,
+                  NULL,
+                  &TimerEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    goto FreeRing;
+  }
+
+  Status = gBS->SetTimer (TimerEvent, TimerPeriodic, PcdGet32 (PcdDebugLogRingDrainPeriod));
+  if (EFI_ERROR (Status)) {
+    goto CloseTimer;
+  }
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  DebugLogRingDrainNotify,
+                  NULL,
+                  &gIdleLoopEventGuid,
+                  &IdleLoopEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    goto CloseTimer;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_SIGNAL_EXIT_BOOT_SERVICES,
+                  TPL_CALLBACK,
+                  DebugLogRingExitBootServicesNotify,
+                  NULL,
+                  &ExitBootServicesEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    goto CloseIdleLoopEvent;
+  }
+
+  Status = gBS->InstallConfigurationTable (&gEdkiiDebugLogRingGuid, mDebugLogRing);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (ExitBootServicesEvent);
+    goto CloseIdleLoopEvent;
+  }
+
+  EfiCreateProtocolNotifyEvent (
+    &gEfiResetNotificationProtocolGuid,
+    TPL_CALLBACK,
+    DebugLogRingResetNotificationInstalled,
+    NULL,
+    &mResetNotificationRegistration
+    );
+
+  return EFI_SUCCESS;
+
+CloseIdleLoopEvent:
+  gBS->CloseEvent (IdleLoopEvent);
+CloseTimer:
+  gBS->CloseEvent (TimerEvent);
+FreeRing:
+  FreePool (mDebugLogRing);
+  mDebugLogRing = NULL;
+  return Status;
+}
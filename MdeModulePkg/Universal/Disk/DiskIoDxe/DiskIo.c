@@ -185,6 +185,8 @@ DiskIoDriverBindingStart (
     goto ErrorExit;
   }
 
+  DiskIoCacheCreate (Instance);
+
   //
   // Install protocol interfaces for the Disk IO device.
   //
@@ -205,6 +207,10 @@ DiskIoDriverBindingStart (
 
 ErrorExit:
   if (EFI_ERROR (Status)) {
+    if (Instance != NULL) {
+      DiskIoCacheDestroy (Instance);
+    }
+
     if (Instance != NULL && Instance->SharedWorkingBuffer != NULL) {
       FreeAlignedPages (
         Instance->SharedWorkingBuffer,
@@ -316,6 +322,8 @@ DiskIoDriverBindingStop (
       EfiReleaseLock (&Instance->TaskQueueLock);
     } while (!AllTaskDone);
 
+    DiskIoCacheDestroy (Instance);
+
     FreeAlignedPages (
       Instance->SharedWorkingBuffer,
       EFI_SIZE_TO_PAGES (PcdGet32 (PcdDiskIoDataBufferBlockNum) * Instance->BlockIo->Media->BlockSize)
@@ -833,6 +841,17 @@ DiskIo2ReadWriteDisk (
     //
     while (!DiskIo2RemoveCompletedTask (Instance));
 
+    //
+    // Small reads are served from the block cache of the disk, if it has one.
+    //
+    if (!Write && (Instance->Cache != NULL)) {
+      Status = DiskIoCacheRead (Instance, MediaId, Offset, BufferSize, Buffer);
+      if (Status != EFI_UNSUPPORTED) {
+        return Status;
+      }
+      Status = EFI_SUCCESS;
+    }
+
     SubtasksPtr = &Subtasks;
   } else {
     DiskIo2RemoveCompletedTask (Instance);
@@ -853,6 +872,13 @@ DiskIo2ReadWriteDisk (
     SubtasksPtr = &Task->Subtasks;
   }
 
+  //
+  // The cache is write-through, so a write only has to drop the lines it overlaps.
+  //
+  if (Write && (Instance->Cache != NULL)) {
+    DiskIoCacheInvalidate (Instance, Offset, BufferSize);
+  }
+
   InitializeListHead (SubtasksPtr);
   if (!DiskIoCreateSubtaskList (Instance, Write, Offset, BufferSize, Buffer, Blocking, Instance->SharedWorkingBuffer, SubtasksPtr)) {
     if (Task != NULL) {
@@ -24,6 +24,45 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 
+#define DISK_IO_CACHE_LINE_SIZE     SIZE_4KB
+#define DISK_IO_CACHE_BUCKET_COUNT  64
+#define DISK_IO_CACHE_INVALID_LBA   MAX_UINT64
+
+#define DISK_IO_CACHE_BUCKET(Cache, Lba) \
+  ((UINTN) DivU64x32 ((Lba), (Cache)->LineBlocks) & (DISK_IO_CACHE_BUCKET_COUNT - 1))
+
+typedef struct {
+  LIST_ENTRY                      Link;       /// < link in the LRU list
+  LIST_ENTRY                      BucketLink; /// < link in the hash bucket, if Lba is valid
+  UINT64                          Lba;        /// < first block of the line, or DISK_IO_CACHE_INVALID_LBA
+  UINT8                           *Data;
+} DISK_IO_CACHE_LINE;
+
+typedef struct {
+  UINT64                          Hits;          /// < lines read from the cache
+  UINT64                          Misses;        /// < lines read from the device
+  UINT64                          ReadAheads;    /// < lines read ahead of a miss
+  UINT64                          DeviceReads;   /// < device reads issued by the cache
+  UINT64                          Bypasses;      /// < reads sent to the device directly
+  UINT64                          Invalidations; /// < lines dropped by writes
+} DISK_IO_CACHE_STATS;
+
+typedef struct {
+  UINT32                          MediaId;
+  UINT32                          LineBlocks;
+  UINTN                           LineSize;
+  UINTN                           LineCount;
+  UINTN                           MaxWindow;  /// < maximum number of lines read at a time
+  UINTN                           Window;     /// < number of lines read on the next miss
+  UINT64                          NextLba;    /// < line after the last line read
+  DISK_IO_CACHE_LINE              *Lines;
+  UINT8                           *Data;
+  LIST_ENTRY                      Lru;        /// < most recently used line first
+  LIST_ENTRY                      Buckets[DISK_IO_CACHE_BUCKET_COUNT];
+  EFI_EVENT                       ReadyToBootEvent;
+  DISK_IO_CACHE_STATS             Stats;
+} DISK_IO_CACHE;
+
 #define DISK_IO_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('d', 's', 'k', 'I')
 typedef struct {
   UINT32                          Signature;
@@ -37,6 +76,8 @@ typedef struct {
 
   EFI_LOCK                        TaskQueueLock;
   LIST_ENTRY                      TaskQueue;
+
+  DISK_IO_CACHE                   *Cache;     /// < NULL if the disk isn't cached
 } DISK_IO_PRIVATE_DATA;
 #define DISK_IO_PRIVATE_DATA_FROM_DISK_IO(a)  CR (a, DISK_IO_PRIVATE_DATA, DiskIo,  DISK_IO_PRIVATE_DATA_SIGNATURE)
 #define DISK_IO_PRIVATE_DATA_FROM_DISK_IO2(a) CR (a, DISK_IO_PRIVATE_DATA, DiskIo2, DISK_IO_PRIVATE_DATA_SIGNATURE)
@@ -334,6 +375,68 @@ DiskIo2FlushDiskEx (
   IN OUT EFI_DISK_IO2_TOKEN       *Token
   );
 
+//
+// Block cache
+//
+/**
+  Create the block cache of a disk, if PcdDiskIoCacheSize enables it and the
+  disk is a whole disk with fixed media. Instance->Cache stays NULL otherwise.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA. The shared working
+                     buffer must be allocated.
+**/
+VOID
+DiskIoCacheCreate (
+  IN DISK_IO_PRIVATE_DATA     *Instance
+  );
+
+/**
+  Free the block cache of a disk.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+DiskIoCacheDestroy (
+  IN DISK_IO_PRIVATE_DATA     *Instance
+  );
+
+/**
+  Read from the block cache, filling it from the device on a miss.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+  @param MediaId     ID of the medium to read.
+  @param Offset      The starting byte offset on the device to read from.
+  @param BufferSize  The number of bytes to read.
+  @param Buffer      A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS      The data is read.
+  @retval EFI_UNSUPPORTED  The read isn't handled by the cache, and must be
+                           sent to the device.
+  @retval Others           The device read failed.
+**/
+EFI_STATUS
+DiskIoCacheRead (
+  IN DISK_IO_PRIVATE_DATA     *Instance,
+  IN UINT32                   MediaId,
+  IN UINT64                   Offset,
+  IN UINTN                    BufferSize,
+  OUT UINT8                   *Buffer
+  );
+
+/**
+  Drop the lines of the block cache that a write overlaps.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+  @param Offset      The starting byte offset on the device of the write.
+  @param BufferSize  The number of bytes written.
+**/
+VOID
+DiskIoCacheInvalidate (
+  IN DISK_IO_PRIVATE_DATA     *Instance,
+  IN UINT64                   Offset,
+  IN UINTN                    BufferSize
+  );
+
 //
 // EFI Component Name Functions
 //
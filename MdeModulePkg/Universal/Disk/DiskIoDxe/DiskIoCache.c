@@ -0,0 +1,470 @@
+/** @file
+  Block cache of the DiskIo driver.
+
+  Small blocking reads of a whole disk are served from a write-through cache
+  of fixed size lines, evicted in least recently used order. A miss that
+  continues the previous read is treated as sequential access, and reads
+  ahead a growing number of lines with a single device read. Writes drop the
+  lines they overlap.
+
+  Only disks with fixed media get a cache. Partitions are left uncached
+  because their I/O already goes through the Disk I/O protocol of the whole
+  disk.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DiskIo.h"
+
+/**
+  Print the statistics of the block cache.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+DiskIoCacheDumpStats (
+  IN DISK_IO_PRIVATE_DATA     *Instance
+  )
+{
+  DISK_IO_CACHE_STATS         *Stats;
+
+  Stats = &Instance->Cache->Stats;
+  DEBUG ((
+    EFI_D_INFO,
+    "DiskIo: Cache %p: Hits/Misses/ReadAheads/DeviceReads/Bypasses/Invalidations = %ld/%ld/%ld/%ld/%ld/%ld\n",
+    Instance->BlockIo,
+    Stats->Hits,
+    Stats->Misses,
+    Stats->ReadAheads,
+    Stats->DeviceReads,
+    Stats->Bypasses,
+    Stats->Invalidations
+    ));
+}
+
+/**
+  Print the statistics of the block cache when the boot manager is about to
+  boot an option.
+
+  @param  Event                 Event whose notification function is being invoked.
+  @param  Context               The pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+EFIAPI
+DiskIoCacheOnReadyToBoot (
+  IN EFI_EVENT                Event,
+  IN VOID                     *Context
+  )
+{
+  DiskIoCacheDumpStats ((DISK_IO_PRIVATE_DATA *) Context);
+}
+
+/**
+  Find the line holding a block in the block cache.
+
+  @param Cache       Pointer to the DISK_IO_CACHE.
+  @param Lba         The first block of the line.
+
+  @return The line, or NULL if the block isn't cached.
+**/
+DISK_IO_CACHE_LINE *
+DiskIoCacheLookup (
+  IN DISK_IO_CACHE            *Cache,
+  IN UINT64                   Lba
+  )
+{
+  LIST_ENTRY                  *Bucket;
+  LIST_ENTRY                  *Link;
+  DISK_IO_CACHE_LINE          *Line;
+
+  Bucket = &Cache->Buckets[DISK_IO_CACHE_BUCKET (Cache, Lba)];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    Line = BASE_CR (Link, DISK_IO_CACHE_LINE, BucketLink);
+    if (Line->Lba == Lba) {
+      return Line;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Drop a line from the block cache, and make it the first to be reused.
+
+  @param Cache       Pointer to the DISK_IO_CACHE.
+  @param Line        The line to drop.
+**/
+VOID
+DiskIoCacheDropLine (
+  IN DISK_IO_CACHE            *Cache,
+  IN DISK_IO_CACHE_LINE       *Line
+  )
+{
+  if (Line->Lba != DISK_IO_CACHE_INVALID_LBA) {
+    RemoveEntryList (&Line->BucketLink);
+    Line->Lba = DISK_IO_CACHE_INVALID_LBA;
+  }
+
+  RemoveEntryList (&Line->Link);
+  InsertTailList (&Cache->Lru, &Line->Link);
+}
+
+/**
+  Drop all the lines of the block cache.
+
+  @param Cache       Pointer to the DISK_IO_CACHE.
+**/
+VOID
+DiskIoCacheDropAll (
+  IN DISK_IO_CACHE            *Cache
+  )
+{
+  UINTN                       Index;
+
+  for (Index = 0; Index < Cache->LineCount; Index++) {
+    DiskIoCacheDropLine (Cache, &Cache->Lines[Index]);
+  }
+
+  Cache->Window  = 1;
+  Cache->NextLba = DISK_IO_CACHE_INVALID_LBA;
+}
+
+/**
+  Read lines from the device into the block cache.
+
+  The lines are read with a single device read in the shared working buffer,
+  and replace the least recently used lines. Reading stops at the first line
+  that is already cached, or at the end of the disk.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+  @param MediaId     ID of the medium to read.
+  @param Lba         The first block of the first line to read.
+  @param LineCount   The number of lines to read.
+
+  @retval EFI_SUCCESS  The lines are cached.
+  @retval Others       The device read failed.
+**/
+EFI_STATUS
+DiskIoCacheFill (
+  IN DISK_IO_PRIVATE_DATA     *Instance,
+  IN UINT32                   MediaId,
+  IN UINT64                   Lba,
+  IN UINTN                    LineCount
+  )
+{
+  DISK_IO_CACHE               *Cache;
+  EFI_BLOCK_IO_MEDIA          *Media;
+  DISK_IO_CACHE_LINE          *Line;
+  UINT64                      BlockCount;
+  UINTN                       Length;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  Cache = Instance->Cache;
+  Media = Instance->BlockIo->Media;
+
+  for (Index = 1; Index < LineCount; Index++) {
+    if (DiskIoCacheLookup (Cache, Lba + MultU64x32 (Index, Cache->LineBlocks)) != NULL) {
+      break;
+    }
+  }
+
+  BlockCount = MIN (MultU64x32 (Index, Cache->LineBlocks), Media->LastBlock + 1 - Lba);
+  Length     = (UINTN) MultU64x32 (BlockCount, Media->BlockSize);
+
+  Status = Instance->BlockIo->ReadBlocks (
+                                Instance->BlockIo,
+                                MediaId,
+                                Lba,
+                                Length,
+                                Instance->SharedWorkingBuffer
+                                );
+  Cache->Stats.DeviceReads++;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Cache->Stats.ReadAheads += Index - 1;
+
+  for (Index = 0; Index * Cache->LineSize < Length; Index++) {
+    Line = BASE_CR (GetPreviousNode (&Cache->Lru, &Cache->Lru), DISK_IO_CACHE_LINE, Link);
+    DiskIoCacheDropLine (Cache, Line);
+
+    CopyMem (
+      Line->Data,
+      Instance->SharedWorkingBuffer + Index * Cache->LineSize,
+      MIN (Cache->LineSize, Length - Index * Cache->LineSize)
+      );
+    Line->Lba = Lba + MultU64x32 (Index, Cache->LineBlocks);
+    InsertTailList (&Cache->Buckets[DISK_IO_CACHE_BUCKET (Cache, Line->Lba)], &Line->BucketLink);
+    RemoveEntryList (&Line->Link);
+    InsertHeadList (&Cache->Lru, &Line->Link);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Read from the block cache, filling it from the device on a miss.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+  @param MediaId     ID of the medium to read.
+  @param Offset      The starting byte offset on the device to read from.
+  @param BufferSize  The number of bytes to read.
+  @param Buffer      A pointer to the destination buffer for the data.
+
+  @retval EFI_SUCCESS      The data is read.
+  @retval EFI_UNSUPPORTED  The read isn't handled by the cache, and must be
+                           sent to the device.
+  @retval Others           The device read failed.
+**/
+EFI_STATUS
+DiskIoCacheRead (
+  IN DISK_IO_PRIVATE_DATA     *Instance,
+  IN UINT32                   MediaId,
+  IN UINT64                   Offset,
+  IN UINTN                    BufferSize,
+  OUT UINT8                   *Buffer
+  )
+{
+  DISK_IO_CACHE               *Cache;
+  EFI_BLOCK_IO_MEDIA          *Media;
+  DISK_IO_CACHE_LINE          *Line;
+  UINT64                      Lba;
+  UINT32                      LineOffset;
+  UINTN                       Length;
+  EFI_TPL                     OldTpl;
+  EFI_STATUS                  Status;
+
+  Cache = Instance->Cache;
+  Media = Instance->BlockIo->Media;
+
+  //
+  // Leave the errors to the device, and the large reads too, so that they
+  // don't push everything else out of the cache.
+  //
+  if (!Media->MediaPresent || (MediaId != Media->MediaId) ||
+      (BufferSize == 0) || (BufferSize > Cache->MaxWindow * Cache->LineSize) ||
+      (Offset + BufferSize < Offset) ||
+      (Offset + BufferSize > MultU64x32 (Media->LastBlock + 1, Media->BlockSize))) {
+    Cache->Stats.Bypasses++;
+    return EFI_UNSUPPORTED;
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (Cache->MediaId != Media->MediaId) {
+    DiskIoCacheDropAll (Cache);
+    Cache->MediaId = Media->MediaId;
+  }
+
+  Status = EFI_SUCCESS;
+  while (BufferSize != 0) {
+    Lba    = MultU64x32 (DivU64x32Remainder (Offset, (UINT32) Cache->LineSize, &LineOffset), Cache->LineBlocks);
+    Length = MIN (BufferSize, Cache->LineSize - LineOffset);
+
+    Line = DiskIoCacheLookup (Cache, Lba);
+    if (Line == NULL) {
+      //
+      // Double the read-ahead window while the misses follow each other.
+      //
+      if (Lba == Cache->NextLba) {
+        Cache->Window = MIN (Cache->Window * 2, Cache->MaxWindow);
+      } else {
+        Cache->Window = 1;
+      }
+
+      Status = DiskIoCacheFill (Instance, MediaId, Lba, Cache->Window);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      Line = DiskIoCacheLookup (Cache, Lba);
+      ASSERT (Line != NULL);
+      Cache->Stats.Misses++;
+    } else {
+      RemoveEntryList (&Line->Link);
+      InsertHeadList (&Cache->Lru, &Line->Link);
+      Cache->Stats.Hits++;
+    }
+
+    CopyMem (Buffer, Line->Data + LineOffset, Length);
+    Cache->NextLba = Lba + Cache->LineBlocks;
+
+    Buffer     += Length;
+    Offset     += Length;
+    BufferSize -= Length;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Drop the lines of the block cache that a write overlaps.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+  @param Offset      The starting byte offset on the device of the write.
+  @param BufferSize  The number of bytes written.
+**/
+VOID
+DiskIoCacheInvalidate (
+  IN DISK_IO_PRIVATE_DATA     *Instance,
+  IN UINT64                   Offset,
+  IN UINTN                    BufferSize
+  )
+{
+  DISK_IO_CACHE               *Cache;
+  DISK_IO_CACHE_LINE          *Line;
+  UINT64                      FirstLba;
+  UINT64                      LastLba;
+  UINT64                      Lba;
+  UINTN                       Index;
+  EFI_TPL                     OldTpl;
+
+  Cache = Instance->Cache;
+  if ((BufferSize == 0) || (Offset + BufferSize < Offset)) {
+    return;
+  }
+
+  FirstLba = MultU64x32 (DivU64x32 (Offset, (UINT32) Cache->LineSize), Cache->LineBlocks);
+  LastLba  = MultU64x32 (DivU64x32 (Offset + BufferSize - 1, (UINT32) Cache->LineSize), Cache->LineBlocks);
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  if (DivU64x32 (LastLba - FirstLba, Cache->LineBlocks) >= Cache->LineCount) {
+    //
+    // The write is larger than the cache, so look at each line instead.
+    //
+    for (Index = 0; Index < Cache->LineCount; Index++) {
+      Line = &Cache->Lines[Index];
+      if ((Line->Lba != DISK_IO_CACHE_INVALID_LBA) && (Line->Lba >= FirstLba) && (Line->Lba <= LastLba)) {
+        DiskIoCacheDropLine (Cache, Line);
+        Cache->Stats.Invalidations++;
+      }
+    }
+  } else {
+    for (Lba = FirstLba; Lba <= LastLba; Lba += Cache->LineBlocks) {
+      Line = DiskIoCacheLookup (Cache, Lba);
+      if (Line != NULL) {
+        DiskIoCacheDropLine (Cache, Line);
+        Cache->Stats.Invalidations++;
+      }
+    }
+  }
+
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Create the block cache of a disk, if PcdDiskIoCacheSize enables it and the
+  disk is a whole disk with fixed media. Instance->Cache stays NULL otherwise.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA. The shared working
+                     buffer must be allocated.
+**/
+VOID
+DiskIoCacheCreate (
+  IN DISK_IO_PRIVATE_DATA     *Instance
+  )
+{
+  DISK_IO_CACHE               *Cache;
+  EFI_BLOCK_IO_MEDIA          *Media;
+  UINT32                      LineBlocks;
+  UINTN                       LineCount;
+  UINTN                       Index;
+
+  Media = Instance->BlockIo->Media;
+  if ((PcdGet32 (PcdDiskIoCacheSize) == 0) || Media->LogicalPartition || Media->RemovableMedia ||
+      (Media->BlockSize == 0)) {
+    return;
+  }
+
+  LineBlocks = MAX (DISK_IO_CACHE_LINE_SIZE / Media->BlockSize, 1);
+  LineCount  = PcdGet32 (PcdDiskIoCacheSize) / (LineBlocks * Media->BlockSize);
+
+  //
+  // Read-ahead uses the shared working buffer, and is bounded to a quarter of
+  // the cache so that one sequential read can't flush it.
+  //
+  if ((PcdGet32 (PcdDiskIoDataBufferBlockNum) < LineBlocks) || (LineCount < 4)) {
+    return;
+  }
+
+  Cache = AllocateZeroPool (sizeof (DISK_IO_CACHE) + LineCount * sizeof (DISK_IO_CACHE_LINE));
+  if (Cache == NULL) {
+    return;
+  }
+
+  Cache->LineBlocks = LineBlocks;
+  Cache->LineSize   = LineBlocks * Media->BlockSize;
+  Cache->LineCount  = LineCount;
+  Cache->MaxWindow  = MIN (PcdGet32 (PcdDiskIoDataBufferBlockNum) / LineBlocks, LineCount / 4);
+  Cache->Window     = 1;
+  Cache->NextLba    = DISK_IO_CACHE_INVALID_LBA;
+  Cache->MediaId    = Media->MediaId;
+  Cache->Lines      = (DISK_IO_CACHE_LINE *) (Cache + 1);
+  Cache->Data       = AllocatePages (EFI_SIZE_TO_PAGES (LineCount * Cache->LineSize));
+  if (Cache->Data == NULL) {
+    FreePool (Cache);
+    return;
+  }
+
+  InitializeListHead (&Cache->Lru);
+  for (Index = 0; Index < DISK_IO_CACHE_BUCKET_COUNT; Index++) {
+    InitializeListHead (&Cache->Buckets[Index]);
+  }
+
+  for (Index = 0; Index < LineCount; Index++) {
+    Cache->Lines[Index].Lba  = DISK_IO_CACHE_INVALID_LBA;
+    Cache->Lines[Index].Data = Cache->Data + Index * Cache->LineSize;
+    InsertTailList (&Cache->Lru, &Cache->Lines[Index].Link);
+  }
+
+  Instance->Cache = Cache;
+
+  EfiCreateEventReadyToBootEx (
+    TPL_CALLBACK,
+    DiskIoCacheOnReadyToBoot,
+    Instance,
+    &Cache->ReadyToBootEvent
+    );
+
+  DEBUG ((
+    EFI_D_INFO,
+    "DiskIo: Cache %p: %d lines of %d bytes, read-ahead up to %d lines\n",
+    Instance->BlockIo,
+    LineCount,
+    Cache->LineSize,
+    Cache->MaxWindow
+    ));
+}
+
+/**
+  Free the block cache of a disk.
+
+  @param Instance    Pointer to the DISK_IO_PRIVATE_DATA.
+**/
+VOID
+DiskIoCacheDestroy (
+  IN DISK_IO_PRIVATE_DATA     *Instance
+  )
+{
+  DISK_IO_CACHE               *Cache;
+
+  Cache = Instance->Cache;
+  if (Cache == NULL) {
+    return;
+  }
+
+  DiskIoCacheDumpStats (Instance);
+
+  if (Cache->ReadyToBootEvent != NULL) {
+    gBS->CloseEvent (Cache->ReadyToBootEvent);
+  }
+
+  FreePages (Cache->Data, EFI_SIZE_TO_PAGES (Cache->LineCount * Cache->LineSize));
+  FreePool (Cache);
+  Instance->Cache = NULL;
+}
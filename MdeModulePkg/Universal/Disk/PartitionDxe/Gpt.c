@@ -10,8 +10,9 @@
   PartitionInstallGptChildHandles() routine will read disk partition content and
   do basic validation before PartitionInstallChildHandle().
 
-  PartitionValidGptTable(), PartitionCheckGptEntry() routine will accept disk
-  partition content and validate the GPT table and GPT entry.
+  PartitionValidGptTable() routine will accept disk partition content and
+  validate the GPT table. The GPT entries are validated by
+  PartitionCheckGptEntry() in GptCheck.c.
 
 Copyright (c) 2018 Qualcomm Datacenter Technologies, Inc.
 Copyright (c) 2006 - 2019, Intel Corporation. All rights reserved.<BR>
@@ -33,6 +34,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
   @param[in]  DiskIo      Disk Io protocol.
   @param[in]  Lba         The starting Lba of the Partition Table
   @param[out] PartHeader  Stores the partition table that is read
+  @param[out] PartEntry   Optionally returns the partition entry array read to
+                          check its CRC, when the partition table is valid.
+                          Free it with PartitionFreeGptEntryArray().
 
   @retval TRUE      The partition table is valid
   @retval FALSE     The partition table is not valid
@@ -43,16 +47,55 @@ PartitionValidGptTable (
   IN  EFI_BLOCK_IO_PROTOCOL       *BlockIo,
   IN  EFI_DISK_IO_PROTOCOL        *DiskIo,
   IN  EFI_LBA                     Lba,
-  OUT EFI_PARTITION_TABLE_HEADER  *PartHeader
+  OUT EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  OUT EFI_PARTITION_ENTRY         **PartEntry OPTIONAL
+  );
+
+/**
+  Read the partition entry array of a partition table with a single read.
+
+  The buffer is aligned on the IoAlign of the parent BlockIo, so the read
+  goes to the device in one request without a bounce buffer.
+
+  @param[in]  BlockIo     Parent BlockIo interface.
+  @param[in]  DiskIo      Disk Io Protocol.
+  @param[in]  PartHeader  Partition table header structure.
+  @param[out] PartEntry   Returns the partition entry array.
+                          Free it with PartitionFreeGptEntryArray().
+
+  @retval EFI_SUCCESS           The partition entry array is read.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the array.
+  @retval Others                The partition entry array can't be read.
+
+**/
+EFI_STATUS
+PartitionReadGptEntryArray (
+  IN  EFI_BLOCK_IO_PROTOCOL       *BlockIo,
+  IN  EFI_DISK_IO_PROTOCOL        *DiskIo,
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  OUT EFI_PARTITION_ENTRY         **PartEntry
+  );
+
+/**
+  Free a partition entry array read by PartitionReadGptEntryArray().
+
+  @param[in]  PartHeader  Partition table header structure the array was
+                          read with.
+  @param[in]  PartEntry   The partition entry array.
+
+**/
+VOID
+PartitionFreeGptEntryArray (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry
   );
 
 /**
   Check if the CRC field in the Partition table header is valid
   for Partition entry array.
 
-  @param[in]  BlockIo     Parent BlockIo interface
-  @param[in]  DiskIo      Disk Io Protocol.
   @param[in]  PartHeader  Partition table header structure
+  @param[in]  PartEntry   The partition entry array
 
   @retval TRUE      the CRC is valid
   @retval FALSE     the CRC is invalid
@@ -60,9 +103,8 @@ PartitionValidGptTable (
 **/
 BOOLEAN
 PartitionCheckGptEntryArrayCRC (
-  IN  EFI_BLOCK_IO_PROTOCOL       *BlockIo,
-  IN  EFI_DISK_IO_PROTOCOL        *DiskIo,
-  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry
   );
 
 
@@ -86,27 +128,6 @@ PartitionRestoreGptTable (
   );
 
 
-/**
-  This routine will check GPT partition entry and return entry status.
-
-  Caution: This function may receive untrusted input.
-  The GPT partition entry is external input, so this routine
-  will do basic validation for GPT partition entry and report status.
-
-  @param[in]    PartHeader    Partition table header structure
-  @param[in]    PartEntry     The partition entry array
-  @param[out]   PEntryStatus  the partition entry status array
-                              recording the status of each partition
-
-**/
-VOID
-PartitionCheckGptEntry (
-  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
-  IN  EFI_PARTITION_ENTRY         *PartEntry,
-  OUT EFI_PARTITION_ENTRY_STATUS  *PEntryStatus
-  );
-
-
 /**
   Checks the CRC32 value in the table header.
 
@@ -214,6 +235,7 @@ PartitionInstallGptChildHandles (
   HARDDRIVE_DEVICE_PATH        HdDev;
   UINT32                       MediaId;
   EFI_PARTITION_INFO_PROTOCOL  PartitionInfo;
+  BOOLEAN                      PrimaryValid;
 
   ProtectiveMbr = NULL;
   PrimaryHeader = NULL;
@@ -289,12 +311,16 @@ PartitionInstallGptChildHandles (
   }
 
   //
-  // Check primary and backup partition tables
+  // Check primary and backup partition tables. The partition entry array
+  // read to check the CRC of the primary partition table is kept, and the
+  // backup partition table is only checked here when the primary one is not
+  // valid.
   //
-  if (!PartitionValidGptTable (BlockIo, DiskIo, PRIMARY_PART_HEADER_LBA, PrimaryHeader)) {
+  PrimaryValid = PartitionValidGptTable (BlockIo, DiskIo, PRIMARY_PART_HEADER_LBA, PrimaryHeader, &PartEntry);
+  if (!PrimaryValid) {
     DEBUG ((EFI_D_INFO, " Not Valid primary partition table\n"));
 
-    if (!PartitionValidGptTable (BlockIo, DiskIo, LastBlock, BackupHeader)) {
+    if (!PartitionValidGptTable (BlockIo, DiskIo, LastBlock, BackupHeader, NULL)) {
       DEBUG ((EFI_D_INFO, " Not Valid backup partition table\n"));
       goto Done;
     } else {
@@ -304,45 +330,25 @@ PartitionInstallGptChildHandles (
         DEBUG ((EFI_D_INFO, " Restore primary partition table error\n"));
       }
 
-      if (PartitionValidGptTable (BlockIo, DiskIo, BackupHeader->AlternateLBA, PrimaryHeader)) {
+      if (PartitionValidGptTable (BlockIo, DiskIo, BackupHeader->AlternateLBA, PrimaryHeader, &PartEntry)) {
         DEBUG ((EFI_D_INFO, " Restore backup partition table success\n"));
       }
     }
-  } else if (!PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader)) {
-    DEBUG ((EFI_D_INFO, " Valid primary and !Valid backup partition table\n"));
-    DEBUG ((EFI_D_INFO, " Restore backup partition table by the primary\n"));
-    if (!PartitionRestoreGptTable (BlockIo, DiskIo, PrimaryHeader)) {
-      DEBUG ((EFI_D_INFO, " Restore backup partition table error\n"));
-    }
-
-    if (PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader)) {
-      DEBUG ((EFI_D_INFO, " Restore backup partition table success\n"));
-    }
-
   }
 
-  DEBUG ((EFI_D_INFO, " Valid primary and Valid backup partition table\n"));
-
   //
-  // Read the EFI Partition Entries
+  // Read the EFI Partition Entries, unless they were read with the primary
+  // partition table
   //
-  PartEntry = AllocatePool (PrimaryHeader->NumberOfPartitionEntries * PrimaryHeader->SizeOfPartitionEntry);
   if (PartEntry == NULL) {
-    DEBUG ((EFI_D_ERROR, "Allocate pool error\n"));
-    goto Done;
-  }
-
-  Status = DiskIo->ReadDisk (
-                     DiskIo,
-                     MediaId,
-                     MultU64x32(PrimaryHeader->PartitionEntryLBA, BlockSize),
-                     PrimaryHeader->NumberOfPartitionEntries * (PrimaryHeader->SizeOfPartitionEntry),
-                     PartEntry
-                     );
-  if (EFI_ERROR (Status)) {
-    GptValidStatus = Status;
-    DEBUG ((EFI_D_ERROR, " Partition Entry ReadDisk error\n"));
-    goto Done;
+    Status = PartitionReadGptEntryArray (BlockIo, DiskIo, PrimaryHeader, &PartEntry);
+    if (EFI_ERROR (Status)) {
+      if (Status != EFI_OUT_OF_RESOURCES) {
+        GptValidStatus = Status;
+      }
+      DEBUG ((EFI_D_ERROR, " Partition Entry ReadDisk error\n"));
+      goto Done;
+    }
   }
 
   DEBUG ((EFI_D_INFO, " Partition entries read block success\n"));
@@ -426,21 +432,42 @@ PartitionInstallGptChildHandles (
                );
   }
 
+  //
+  // Check the backup partition table once the partitions are installed. It
+  // sits at the end of the disk, and is not needed to install them when the
+  // primary partition table is valid.
+  //
+  if (PrimaryValid) {
+    if (!PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader, NULL)) {
+      DEBUG ((EFI_D_INFO, " Valid primary and !Valid backup partition table\n"));
+      DEBUG ((EFI_D_INFO, " Restore backup partition table by the primary\n"));
+      if (!PartitionRestoreGptTable (BlockIo, DiskIo, PrimaryHeader)) {
+        DEBUG ((EFI_D_INFO, " Restore backup partition table error\n"));
+      }
+
+      if (PartitionValidGptTable (BlockIo, DiskIo, PrimaryHeader->AlternateLBA, BackupHeader, NULL)) {
+        DEBUG ((EFI_D_INFO, " Restore backup partition table success\n"));
+      }
+    } else {
+      DEBUG ((EFI_D_INFO, " Valid primary and Valid backup partition table\n"));
+    }
+  }
+
   DEBUG ((EFI_D_INFO, "Prepare to Free Pool\n"));
 
 Done:
   if (ProtectiveMbr != NULL) {
     FreePool (ProtectiveMbr);
   }
+  if (PartEntry != NULL) {
+    PartitionFreeGptEntryArray (PrimaryHeader, PartEntry);
+  }
   if (PrimaryHeader != NULL) {
     FreePool (PrimaryHeader);
   }
   if (BackupHeader != NULL) {
     FreePool (BackupHeader);
   }
-  if (PartEntry != NULL) {
-    FreePool (PartEntry);
-  }
   if (PEntryStatus != NULL) {
     FreePool (PEntryStatus);
   }
@@ -459,6 +486,9 @@ Done:
   @param[in]  DiskIo      Disk Io protocol.
   @param[in]  Lba         The starting Lba of the Partition Table
   @param[out] PartHeader  Stores the partition table that is read
+  @param[out] PartEntry   Optionally returns the partition entry array read to
+                          check its CRC, when the partition table is valid.
+                          Free it with PartitionFreeGptEntryArray().
 
   @retval TRUE      The partition table is valid
   @retval FALSE     The partition table is not valid
@@ -469,13 +499,15 @@ PartitionValidGptTable (
   IN  EFI_BLOCK_IO_PROTOCOL       *BlockIo,
   IN  EFI_DISK_IO_PROTOCOL        *DiskIo,
   IN  EFI_LBA                     Lba,
-  OUT EFI_PARTITION_TABLE_HEADER  *PartHeader
+  OUT EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  OUT EFI_PARTITION_ENTRY         **PartEntry OPTIONAL
   )
 {
   EFI_STATUS                  Status;
   UINT32                      BlockSize;
   EFI_PARTITION_TABLE_HEADER  *PartHdr;
   UINT32                      MediaId;
+  EFI_PARTITION_ENTRY         *Entries;
 
   BlockSize = BlockIo->Media->BlockSize;
   MediaId   = BlockIo->Media->MediaId;
@@ -519,72 +551,133 @@ PartitionValidGptTable (
   }
 
   CopyMem (PartHeader, PartHdr, sizeof (EFI_PARTITION_TABLE_HEADER));
-  if (!PartitionCheckGptEntryArrayCRC (BlockIo, DiskIo, PartHeader)) {
-    FreePool (PartHdr);
+  FreePool (PartHdr);
+
+  Status = PartitionReadGptEntryArray (BlockIo, DiskIo, PartHeader, &Entries);
+  if (EFI_ERROR (Status)) {
     return FALSE;
   }
 
+  if (!PartitionCheckGptEntryArrayCRC (PartHeader, Entries)) {
+    PartitionFreeGptEntryArray (PartHeader, Entries);
+    return FALSE;
+  }
+
+  if (PartEntry != NULL) {
+    *PartEntry = Entries;
+  } else {
+    PartitionFreeGptEntryArray (PartHeader, Entries);
+  }
+
   DEBUG ((EFI_D_INFO, " Valid efi partition table header\n"));
-  FreePool (PartHdr);
   return TRUE;
 }
 
 /**
-  Check if the CRC field in the Partition table header is valid
-  for Partition entry array.
+  Read the partition entry array of a partition table with a single read.
 
-  @param[in]  BlockIo     Parent BlockIo interface
+  The buffer is aligned on the IoAlign of the parent BlockIo, so the read
+  goes to the device in one request without a bounce buffer.
+
+  @param[in]  BlockIo     Parent BlockIo interface.
   @param[in]  DiskIo      Disk Io Protocol.
-  @param[in]  PartHeader  Partition table header structure
+  @param[in]  PartHeader  Partition table header structure.
+  @param[out] PartEntry   Returns the partition entry array.
+                          Free it with PartitionFreeGptEntryArray().
 
-  @retval TRUE      the CRC is valid
-  @retval FALSE     the CRC is invalid
+  @retval EFI_SUCCESS           The partition entry array is read.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the array.
+  @retval Others                The partition entry array can't be read.
 
 **/
-BOOLEAN
-PartitionCheckGptEntryArrayCRC (
+EFI_STATUS
+PartitionReadGptEntryArray (
   IN  EFI_BLOCK_IO_PROTOCOL       *BlockIo,
   IN  EFI_DISK_IO_PROTOCOL        *DiskIo,
-  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  OUT EFI_PARTITION_ENTRY         **PartEntry
   )
 {
   EFI_STATUS  Status;
-  UINT8       *Ptr;
-  UINT32      Crc;
   UINTN       Size;
+  UINT8       *Ptr;
 
   //
-  // Read the EFI Partition Entries
+  // An empty array still takes a page, so that it is not mistaken for a
+  // failed allocation.
   //
-  Ptr = AllocatePool (PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry);
+  Size = (UINTN) PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry;
+  Ptr  = AllocateAlignedPages (EFI_SIZE_TO_PAGES (MAX (Size, 1)), BlockIo->Media->IoAlign);
   if (Ptr == NULL) {
     DEBUG ((EFI_D_ERROR, " Allocate pool error\n"));
-    return FALSE;
+    return EFI_OUT_OF_RESOURCES;
   }
 
   Status = DiskIo->ReadDisk (
-                    DiskIo,
-                    BlockIo->Media->MediaId,
-                    MultU64x32(PartHeader->PartitionEntryLBA, BlockIo->Media->BlockSize),
-                    PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry,
-                    Ptr
-                    );
+                     DiskIo,
+                     BlockIo->Media->MediaId,
+                     MultU64x32 (PartHeader->PartitionEntryLBA, BlockIo->Media->BlockSize),
+                     Size,
+                     Ptr
+                     );
   if (EFI_ERROR (Status)) {
-    FreePool (Ptr);
-    return FALSE;
+    FreeAlignedPages (Ptr, EFI_SIZE_TO_PAGES (MAX (Size, 1)));
+    return Status;
   }
 
-  Size    = PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry;
+  *PartEntry = (EFI_PARTITION_ENTRY *) Ptr;
+  return EFI_SUCCESS;
+}
+
+/**
+  Free a partition entry array read by PartitionReadGptEntryArray().
+
+  @param[in]  PartHeader  Partition table header structure the array was
+                          read with.
+  @param[in]  PartEntry   The partition entry array.
+
+**/
+VOID
+PartitionFreeGptEntryArray (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry
+  )
+{
+  UINTN       Size;
+
+  Size = (UINTN) PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry;
+  FreeAlignedPages (PartEntry, EFI_SIZE_TO_PAGES (MAX (Size, 1)));
+}
+
+/**
+  Check if the CRC field in the Partition table header is valid
+  for Partition entry array.
+
+  @param[in]  PartHeader  Partition table header structure
+  @param[in]  PartEntry   The partition entry array
+
+  @retval TRUE      the CRC is valid
+  @retval FALSE     the CRC is invalid
 
-  Status  = gBS->CalculateCrc32 (Ptr, Size, &Crc);
+**/
+BOOLEAN
+PartitionCheckGptEntryArrayCRC (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Crc;
+  UINTN       Size;
+
+  Size    = (UINTN) PartHeader->NumberOfPartitionEntries * PartHeader->SizeOfPartitionEntry;
+
+  Status  = gBS->CalculateCrc32 (PartEntry, Size, &Crc);
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "CheckPEntryArrayCRC: Crc calculation failed\n"));
-    FreePool (Ptr);
     return FALSE;
   }
 
-  FreePool (Ptr);
-
   return (BOOLEAN) (PartHeader->PartitionEntryArrayCRC32 == Crc);
 }
 
@@ -690,79 +783,6 @@ Done:
   return TRUE;
 }
 
-/**
-  This routine will check GPT partition entry and return entry status.
-
-  Caution: This function may receive untrusted input.
-  The GPT partition entry is external input, so this routine
-  will do basic validation for GPT partition entry and report status.
-
-  @param[in]    PartHeader    Partition table header structure
-  @param[in]    PartEntry     The partition entry array
-  @param[out]   PEntryStatus  the partition entry status array
-                              recording the status of each partition
-
-**/
-VOID
-PartitionCheckGptEntry (
-  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
-  IN  EFI_PARTITION_ENTRY         *PartEntry,
-  OUT EFI_PARTITION_ENTRY_STATUS  *PEntryStatus
-  )
-{
-  EFI_LBA              StartingLBA;
-  EFI_LBA              EndingLBA;
-  EFI_PARTITION_ENTRY  *Entry;
-  UINTN                Index1;
-  UINTN                Index2;
-
-  DEBUG ((EFI_D_INFO, " start check partition entries\n"));
-  for (Index1 = 0; Index1 < PartHeader->NumberOfPartitionEntries; Index1++) {
-    Entry = (EFI_PARTITION_ENTRY *) ((UINT8 *) PartEntry + Index1 * PartHeader->SizeOfPartitionEntry);
-    if (CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid)) {
-      continue;
-    }
-
-    StartingLBA = Entry->StartingLBA;
-    EndingLBA   = Entry->EndingLBA;
-    if (StartingLBA > EndingLBA ||
-        StartingLBA < PartHeader->FirstUsableLBA ||
-        StartingLBA > PartHeader->LastUsableLBA ||
-        EndingLBA < PartHeader->FirstUsableLBA ||
-        EndingLBA > PartHeader->LastUsableLBA
-        ) {
-      PEntryStatus[Index1].OutOfRange = TRUE;
-      continue;
-    }
-
-    if ((Entry->Attributes & BIT1) != 0) {
-      //
-      // If Bit 1 is set, this indicate that this is an OS specific GUID partition.
-      //
-      PEntryStatus[Index1].OsSpecific = TRUE;
-    }
-
-    for (Index2 = Index1 + 1; Index2 < PartHeader->NumberOfPartitionEntries; Index2++) {
-      Entry = (EFI_PARTITION_ENTRY *) ((UINT8 *) PartEntry + Index2 * PartHeader->SizeOfPartitionEntry);
-      if (CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid)) {
-        continue;
-      }
-
-      if (Entry->EndingLBA >= StartingLBA && Entry->StartingLBA <= EndingLBA) {
-        //
-        // This region overlaps with the Index1'th region
-        //
-        PEntryStatus[Index1].Overlap  = TRUE;
-        PEntryStatus[Index2].Overlap  = TRUE;
-        continue;
-      }
-    }
-  }
-
-  DEBUG ((EFI_D_INFO, " End check partition entries\n"));
-}
-
-
 /**
   Updates the CRC32 value in the table header.
 
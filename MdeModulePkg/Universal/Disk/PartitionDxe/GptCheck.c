@@ -0,0 +1,220 @@
+/** @file
+  Check the entries of a GPT partition entry array.
+
+  Caution: This file requires additional review when modified.
+  This file will have external input - disk partition.
+  This external input must be validated carefully to avoid security issue like
+  buffer overflow, integer overflow.
+
+  PartitionCheckGptEntry() routine will accept disk partition content and
+  validate the GPT entries.
+
+  The routine doesn't depend on boot services, so that it can be built into
+  host-based unit tests.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Partition.h"
+
+/**
+  Return the partition entry at an index of the partition entry array.
+
+  @param[in]  PartHeader  Partition table header structure
+  @param[in]  PartEntry   The partition entry array
+  @param[in]  Index       The index of the entry
+
+  @return The partition entry.
+
+**/
+EFI_PARTITION_ENTRY *
+PartitionGetGptEntry (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry,
+  IN  UINTN                       Index
+  )
+{
+  return (EFI_PARTITION_ENTRY *) ((UINT8 *) PartEntry + Index * PartHeader->SizeOfPartitionEntry);
+}
+
+/**
+  Sift an entry down the heap of PartitionSortGptEntries().
+
+  @param[in]      PartHeader  Partition table header structure
+  @param[in]      PartEntry   The partition entry array
+  @param[in, out] Indexes     The heap of entry indexes
+  @param[in]      Root        The position of the entry to sift down
+  @param[in]      Count       The number of entries in the heap
+
+**/
+VOID
+PartitionSiftGptEntry (
+  IN     EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN     EFI_PARTITION_ENTRY         *PartEntry,
+  IN OUT UINTN                       *Indexes,
+  IN     UINTN                       Root,
+  IN     UINTN                       Count
+  )
+{
+  UINTN    Child;
+  UINTN    Index;
+
+  while (Root * 2 + 1 < Count) {
+    Child = Root * 2 + 1;
+    if ((Child + 1 < Count) &&
+        (PartitionGetGptEntry (PartHeader, PartEntry, Indexes[Child])->StartingLBA <
+         PartitionGetGptEntry (PartHeader, PartEntry, Indexes[Child + 1])->StartingLBA)) {
+      Child++;
+    }
+
+    if (PartitionGetGptEntry (PartHeader, PartEntry, Indexes[Root])->StartingLBA >=
+        PartitionGetGptEntry (PartHeader, PartEntry, Indexes[Child])->StartingLBA) {
+      break;
+    }
+
+    Index          = Indexes[Root];
+    Indexes[Root]  = Indexes[Child];
+    Indexes[Child] = Index;
+    Root           = Child;
+  }
+}
+
+/**
+  Sort entry indexes by the starting LBA of the entries, with a heap sort.
+  The sort needs no memory besides the indexes, and takes O(n log n) time
+  whatever the order of the entries on disk is.
+
+  @param[in]      PartHeader  Partition table header structure
+  @param[in]      PartEntry   The partition entry array
+  @param[in, out] Indexes     The entry indexes to sort
+  @param[in]      Count       The number of entry indexes
+
+**/
+VOID
+PartitionSortGptEntries (
+  IN     EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN     EFI_PARTITION_ENTRY         *PartEntry,
+  IN OUT UINTN                       *Indexes,
+  IN     UINTN                       Count
+  )
+{
+  UINTN    Position;
+  UINTN    Index;
+
+  for (Position = Count / 2; Position > 0; Position--) {
+    PartitionSiftGptEntry (PartHeader, PartEntry, Indexes, Position - 1, Count);
+  }
+
+  for (Position = Count; Position > 1; Position--) {
+    Index                 = Indexes[0];
+    Indexes[0]            = Indexes[Position - 1];
+    Indexes[Position - 1] = Index;
+    PartitionSiftGptEntry (PartHeader, PartEntry, Indexes, 0, Position - 1);
+  }
+}
+
+/**
+  This routine will check GPT partition entry and return entry status.
+
+  The entries in the usable LBA range are sorted by their starting LBA, and
+  swept once in that order: an entry overlaps an entry before it when it
+  starts before the highest ending LBA seen so far. This takes O(n log n)
+  time instead of comparing every pair of entries.
+
+  Caution: This function may receive untrusted input.
+  The GPT partition entry is external input, so this routine
+  will do basic validation for GPT partition entry and report status.
+
+  @param[in]    PartHeader    Partition table header structure
+  @param[in]    PartEntry     The partition entry array
+  @param[out]   PEntryStatus  the partition entry status array
+                              recording the status of each partition
+
+**/
+VOID
+PartitionCheckGptEntry (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *PartEntry,
+  OUT EFI_PARTITION_ENTRY_STATUS  *PEntryStatus
+  )
+{
+  EFI_LBA              StartingLBA;
+  EFI_LBA              EndingLBA;
+  EFI_LBA              MaxEndingLBA;
+  EFI_PARTITION_ENTRY  *Entry;
+  UINTN                *Indexes;
+  UINTN                Count;
+  UINTN                Index;
+  UINTN                MaxEndingIndex;
+
+  DEBUG ((EFI_D_INFO, " start check partition entries\n"));
+  Indexes = AllocatePool (PartHeader->NumberOfPartitionEntries * sizeof (UINTN));
+  Count   = 0;
+  for (Index = 0; Index < PartHeader->NumberOfPartitionEntries; Index++) {
+    Entry = PartitionGetGptEntry (PartHeader, PartEntry, Index);
+    if (CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid)) {
+      continue;
+    }
+
+    StartingLBA = Entry->StartingLBA;
+    EndingLBA   = Entry->EndingLBA;
+    if (StartingLBA > EndingLBA ||
+        StartingLBA < PartHeader->FirstUsableLBA ||
+        StartingLBA > PartHeader->LastUsableLBA ||
+        EndingLBA < PartHeader->FirstUsableLBA ||
+        EndingLBA > PartHeader->LastUsableLBA
+        ) {
+      PEntryStatus[Index].OutOfRange = TRUE;
+      continue;
+    }
+
+    if ((Entry->Attributes & BIT1) != 0) {
+      //
+      // If Bit 1 is set, this indicate that this is an OS specific GUID partition.
+      //
+      PEntryStatus[Index].OsSpecific = TRUE;
+    }
+
+    if (Indexes == NULL) {
+      //
+      // Without memory for the sort, the entries can't be told apart from
+      // overlapping ones. Don't use any of them.
+      //
+      PEntryStatus[Index].Overlap = TRUE;
+      continue;
+    }
+
+    Indexes[Count++] = Index;
+  }
+
+  if (Indexes == NULL) {
+    DEBUG ((EFI_D_ERROR, "Allocate pool error\n"));
+    return;
+  }
+
+  PartitionSortGptEntries (PartHeader, PartEntry, Indexes, Count);
+
+  MaxEndingLBA   = 0;
+  MaxEndingIndex = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Entry = PartitionGetGptEntry (PartHeader, PartEntry, Indexes[Index]);
+    if ((Index != 0) && (Entry->StartingLBA <= MaxEndingLBA)) {
+      //
+      // This region overlaps with the region ending the highest so far.
+      // Any other earlier region it overlaps with also overlaps with that
+      // region, so it is already marked.
+      //
+      PEntryStatus[Indexes[Index]].Overlap = TRUE;
+      PEntryStatus[MaxEndingIndex].Overlap = TRUE;
+    }
+
+    if ((Index == 0) || (Entry->EndingLBA > MaxEndingLBA)) {
+      MaxEndingLBA   = Entry->EndingLBA;
+      MaxEndingIndex = Indexes[Index];
+    }
+  }
+
+  FreePool (Indexes);
+  DEBUG ((EFI_D_INFO, " End check partition entries\n"));
+}
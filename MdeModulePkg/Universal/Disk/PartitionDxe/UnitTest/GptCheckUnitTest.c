@@ -0,0 +1,271 @@
+/** @file
+  Unit tests of the GPT partition entry checks of PartitionDxe.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../Partition.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "PartitionDxe GPT Check Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define GPT_TEST_FIRST_USABLE_LBA  34
+#define GPT_TEST_LAST_USABLE_LBA   0x100000
+
+typedef struct {
+  UINTN      EntryCount;
+  BOOLEAN    Random;
+} GPT_CHECK_TEST_CONTEXT;
+
+GPT_CHECK_TEST_CONTEXT  mGptCheck128Adjacent  = { 128,  FALSE };
+GPT_CHECK_TEST_CONTEXT  mGptCheck1024Adjacent = { 1024, FALSE };
+GPT_CHECK_TEST_CONTEXT  mGptCheck128Random    = { 128,  TRUE };
+GPT_CHECK_TEST_CONTEXT  mGptCheck1024Random   = { 1024, TRUE };
+
+UINT32  mGptTestSeed;
+
+/**
+  Return the next number of a linear congruential generator, so that the
+  random partition tables are the same on every run.
+
+  @return A pseudo-random number.
+**/
+UINT32
+GptTestRandom (
+  VOID
+  )
+{
+  mGptTestSeed = mGptTestSeed * 1103515245 + 12345;
+  return mGptTestSeed >> 8;
+}
+
+/**
+  Fill a partition entry array.
+
+  Adjacent tables hold partitions that follow each other on the disk, stored
+  in a shuffled order, with every fourth entry unused. Random tables hold
+  partitions of random place and size, some of them out of the usable range.
+
+  @param[in]  Context     The test context.
+  @param[out] PartHeader  The partition table header.
+  @param[out] PartEntry   The partition entry array.
+**/
+VOID
+GptTestFillTable (
+  IN  GPT_CHECK_TEST_CONTEXT      *Context,
+  OUT EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  OUT EFI_PARTITION_ENTRY         *PartEntry
+  )
+{
+  UINTN                Index;
+  UINTN                Other;
+  EFI_PARTITION_ENTRY  Entry;
+
+  ZeroMem (PartHeader, sizeof (*PartHeader));
+  PartHeader->NumberOfPartitionEntries = (UINT32) Context->EntryCount;
+  PartHeader->SizeOfPartitionEntry     = sizeof (EFI_PARTITION_ENTRY);
+  PartHeader->FirstUsableLBA           = GPT_TEST_FIRST_USABLE_LBA;
+  PartHeader->LastUsableLBA            = GPT_TEST_LAST_USABLE_LBA;
+
+  ZeroMem (PartEntry, Context->EntryCount * sizeof (EFI_PARTITION_ENTRY));
+  mGptTestSeed = (UINT32) Context->EntryCount;
+  for (Index = 0; Index < Context->EntryCount; Index++) {
+    if (Context->Random) {
+      if (GptTestRandom () % 8 == 0) {
+        continue;
+      }
+      PartEntry[Index].StartingLBA = GptTestRandom () % (GPT_TEST_LAST_USABLE_LBA + 0x100);
+      PartEntry[Index].EndingLBA   = PartEntry[Index].StartingLBA + GptTestRandom () % 0x400;
+    } else {
+      if (Index % 4 == 3) {
+        continue;
+      }
+      PartEntry[Index].StartingLBA = GPT_TEST_FIRST_USABLE_LBA + Index * 0x100;
+      PartEntry[Index].EndingLBA   = PartEntry[Index].StartingLBA + 0xFF;
+    }
+    CopyGuid (&PartEntry[Index].PartitionTypeGUID, &gEfiPartTypeSystemPartGuid);
+  }
+
+  if (!Context->Random) {
+    for (Index = Context->EntryCount - 1; Index > 0; Index--) {
+      Other = GptTestRandom () % (Index + 1);
+      CopyMem (&Entry, &PartEntry[Index], sizeof (Entry));
+      CopyMem (&PartEntry[Index], &PartEntry[Other], sizeof (Entry));
+      CopyMem (&PartEntry[Other], &Entry, sizeof (Entry));
+    }
+  }
+}
+
+/**
+  Check that a partition entry is used and in the usable range.
+
+  @param[in]  PartHeader  The partition table header.
+  @param[in]  Entry       The partition entry.
+
+  @retval TRUE   The entry is used and in range.
+  @retval FALSE  The entry is unused or out of range.
+**/
+BOOLEAN
+GptTestEntryInRange (
+  IN  EFI_PARTITION_TABLE_HEADER  *PartHeader,
+  IN  EFI_PARTITION_ENTRY         *Entry
+  )
+{
+  return (BOOLEAN) (!CompareGuid (&Entry->PartitionTypeGUID, &gEfiPartTypeUnusedGuid) &&
+                    (Entry->StartingLBA <= Entry->EndingLBA) &&
+                    (Entry->StartingLBA >= PartHeader->FirstUsableLBA) &&
+                    (Entry->EndingLBA <= PartHeader->LastUsableLBA));
+}
+
+/**
+  Check the entries of a partition table against a pairwise comparison of
+  the entries.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+GptCheckEntryShouldFindOverlaps (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  GPT_CHECK_TEST_CONTEXT      *TestContext;
+  EFI_PARTITION_TABLE_HEADER  PartHeader;
+  EFI_PARTITION_ENTRY         *PartEntry;
+  EFI_PARTITION_ENTRY_STATUS  *PEntryStatus;
+  UINTN                       Index1;
+  UINTN                       Index2;
+  BOOLEAN                     Overlap;
+  UINTN                       OverlapCount;
+
+  TestContext  = (GPT_CHECK_TEST_CONTEXT *) Context;
+  PartEntry    = AllocatePool (TestContext->EntryCount * sizeof (EFI_PARTITION_ENTRY));
+  PEntryStatus = AllocateZeroPool (TestContext->EntryCount * sizeof (EFI_PARTITION_ENTRY_STATUS));
+  UT_ASSERT_NOT_NULL (PartEntry);
+  UT_ASSERT_NOT_NULL (PEntryStatus);
+
+  GptTestFillTable (TestContext, &PartHeader, PartEntry);
+  PartitionCheckGptEntry (&PartHeader, PartEntry, PEntryStatus);
+
+  OverlapCount = 0;
+  for (Index1 = 0; Index1 < TestContext->EntryCount; Index1++) {
+    if (!GptTestEntryInRange (&PartHeader, &PartEntry[Index1])) {
+      UT_ASSERT_FALSE (PEntryStatus[Index1].Overlap);
+      continue;
+    }
+
+    Overlap = FALSE;
+    for (Index2 = 0; Index2 < TestContext->EntryCount; Index2++) {
+      if ((Index2 != Index1) &&
+          GptTestEntryInRange (&PartHeader, &PartEntry[Index2]) &&
+          (PartEntry[Index2].EndingLBA >= PartEntry[Index1].StartingLBA) &&
+          (PartEntry[Index2].StartingLBA <= PartEntry[Index1].EndingLBA)) {
+        Overlap = TRUE;
+        break;
+      }
+    }
+
+    UT_ASSERT_FALSE (PEntryStatus[Index1].OutOfRange);
+    UT_ASSERT_EQUAL (PEntryStatus[Index1].Overlap, Overlap);
+    if (Overlap) {
+      OverlapCount++;
+    }
+  }
+
+  if (!TestContext->Random) {
+    UT_ASSERT_EQUAL (OverlapCount, 0);
+  } else {
+    UT_ASSERT_TRUE (OverlapCount != 0);
+  }
+
+  FreePool (PartEntry);
+  FreePool (PEntryStatus);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialze the unit test framework, suite, and unit tests for the GPT
+  partition entry checks and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      GptCheckTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the GPT Check Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&GptCheckTests, Framework, "PartitionDxe GPT Entry Check Tests", "PartitionDxe.GptCheck", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for GptCheckTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (GptCheckTests, "128 adjacent entries should not overlap", "Adjacent128", GptCheckEntryShouldFindOverlaps, NULL, NULL, &mGptCheck128Adjacent);
+  AddTestCase (GptCheckTests, "1024 adjacent entries should not overlap", "Adjacent1024", GptCheckEntryShouldFindOverlaps, NULL, NULL, &mGptCheck1024Adjacent);
+  AddTestCase (GptCheckTests, "128 random entries should overlap as compared pairwise", "Random128", GptCheckEntryShouldFindOverlaps, NULL, NULL, &mGptCheck128Random);
+  AddTestCase (GptCheckTests, "1024 random entries should overlap as compared pairwise", "Random1024", GptCheckEntryShouldFindOverlaps, NULL, NULL, &mGptCheck1024Random);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -136,6 +136,7 @@ RamDiskBlkIoReadBlocks (
   OUT VOID                        *Buffer
   )
 {
+  EFI_STATUS                      Status;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   UINTN                           NumberOfBlocks;
 
@@ -166,6 +167,30 @@ RamDiskBlkIoReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Incomplete) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (PrivateData->Producer != NULL) {
+    Status = PrivateData->Producer->Fill (
+                                      PrivateData->Producer,
+                                      MultU64x32 (Lba, PrivateData->Media.BlockSize),
+                                      BufferSize
+                                      );
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (PrivateData->Store != NULL) {
+    return RamDiskStoreRead (
+             PrivateData->Store,
+             MultU64x32 (Lba, PrivateData->Media.BlockSize),
+             BufferSize,
+             Buffer
+             );
+  }
+
   CopyMem (
     Buffer,
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
@@ -211,6 +236,7 @@ RamDiskBlkIoWriteBlocks (
   IN VOID                         *Buffer
   )
 {
+  EFI_STATUS                      Status;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   UINTN                           NumberOfBlocks;
 
@@ -245,6 +271,30 @@ RamDiskBlkIoWriteBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Incomplete) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (PrivateData->Producer != NULL) {
+    Status = PrivateData->Producer->Fill (
+                                      PrivateData->Producer,
+                                      MultU64x32 (Lba, PrivateData->Media.BlockSize),
+                                      BufferSize
+                                      );
+    if (EFI_ERROR (Status)) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  if (PrivateData->Store != NULL) {
+    return RamDiskStoreWrite (
+             PrivateData->Store,
+             MultU64x32 (Lba, PrivateData->Media.BlockSize),
+             BufferSize,
+             Buffer
+             );
+  }
+
   CopyMem (
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
     Buffer,
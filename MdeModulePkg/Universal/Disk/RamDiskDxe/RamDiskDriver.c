@@ -23,6 +23,24 @@ EFI_RAM_DISK_PROTOCOL  mRamDiskProtocol = {
   RamDiskUnregister
 };
 
+//
+// The EDKII_RAM_DISK_STREAM_PROTOCOL instance that is installed onto the
+// driver handle
+//
+EDKII_RAM_DISK_STREAM_PROTOCOL  mRamDiskStreamProtocol = {
+  RamDiskRegisterStream,
+  RamDiskEndStream
+};
+
+//
+// The EDKII_PACKED_RAM_DISK_PROTOCOL instance that is installed onto the
+// driver handle
+//
+EDKII_PACKED_RAM_DISK_PROTOCOL  mPackedRamDiskProtocol = {
+  RamDiskRegisterPacked,
+  RamDiskWritePacked
+};
+
 //
 // RamDiskDxe driver maintains a list of registered RAM disks.
 //
@@ -162,6 +180,10 @@ RamDiskDxeEntryPoint (
                   &mRamDiskHandle,
                   &gEfiRamDiskProtocolGuid,
                   &mRamDiskProtocol,
+                  &gEdkiiRamDiskStreamProtocolGuid,
+                  &mRamDiskStreamProtocol,
+                  &gEdkiiPackedRamDiskProtocolGuid,
+                  &mPackedRamDiskProtocol,
                   &gEfiCallerIdGuid,
                   ConfigPrivate,
                   NULL
@@ -233,6 +255,10 @@ RamDiskDxeUnload (
          mRamDiskHandle,
          &gEfiRamDiskProtocolGuid,
          &mRamDiskProtocol,
+         &gEdkiiRamDiskStreamProtocolGuid,
+         &mRamDiskStreamProtocol,
+         &gEdkiiPackedRamDiskProtocolGuid,
+         &mPackedRamDiskProtocol,
          &gEfiCallerIdGuid,
          ConfigPrivate,
          NULL
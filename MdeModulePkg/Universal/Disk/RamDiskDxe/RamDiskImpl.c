@@ -169,6 +169,8 @@ UnregisterAllRamDisks (
     BASE_LIST_FOR_EACH_SAFE (Entry, NextEntry, &RegisteredRamDisks) {
       PrivateData = RAM_DISK_PRIVATE_FROM_THIS (Entry);
 
+      RamDiskReleaseProducer (PrivateData);
+
       gBS->UninstallMultipleProtocolInterfaces (
              PrivateData->Handle,
              &gEfiBlockIoProtocolGuid,
@@ -182,7 +184,9 @@ UnregisterAllRamDisks (
 
       RemoveEntryList (&PrivateData->ThisInstance);
 
-      if (RamDiskCreateHii == PrivateData->CreateMethod) {
+      if (PrivateData->Store != NULL) {
+        RamDiskStoreFree (PrivateData->Store);
+      } else if (RamDiskCreateHii == PrivateData->CreateMethod) {
         //
         // If a RAM disk is created within HII, then the RamDiskDxe driver
         // driver is responsible for freeing the allocated memory for the
@@ -278,10 +282,84 @@ RamDiskRouteConfig (
 }
 
 
+/**
+  Register a packed RAM disk created within RamDiskDxe driver HII, and copy
+  the file content to it.
+
+  @param[in]  Size           The size of the RAM disk to create.
+  @param[in]  FileHandle     If creating raw, NULL. If creating from file, the
+                             file handle.
+  @param[out] PrivateData    On return, points to the private data of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             RAM disk is created and registered.
+  @retval EFI_OUT_OF_RESOURCES    Not enough storage is available to hold the
+                                  RAM disk.
+  @retval EFI_DEVICE_ERROR        The file content could not be read.
+
+**/
+EFI_STATUS
+HiiCreatePackedRamDisk (
+  IN  UINT64                                Size,
+  IN  EFI_FILE_HANDLE                       FileHandle,
+  OUT RAM_DISK_PRIVATE_DATA                 **PrivateData
+  )
+{
+  EFI_STATUS                      Status;
+  UINT8                           *Buffer;
+  UINTN                           BufferSize;
+  UINT64                          Offset;
+
+  Status = RamDiskCreatePacked (Size, &gEfiVirtualDiskGuid, NULL, PrivateData);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (FileHandle != NULL) {
+    //
+    // Copy the file content to the RAM disk, one piece at a time, so that
+    // the file never needs a flat copy in memory.
+    //
+    Buffer = AllocatePool (RAM_DISK_FILE_READ_SIZE);
+    if (Buffer == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    }
+
+    for (Offset = 0; !EFI_ERROR (Status) && (Offset < Size); Offset += BufferSize) {
+      BufferSize = (UINTN) MIN (Size - Offset, RAM_DISK_FILE_READ_SIZE);
+      Status     = FileHandle->Read (FileHandle, &BufferSize, Buffer);
+      if (EFI_ERROR (Status) || (BufferSize == 0)) {
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      Status = RamDiskStoreWrite ((*PrivateData)->Store, Offset, BufferSize, Buffer);
+    }
+
+    if (Buffer != NULL) {
+      FreePool (Buffer);
+    }
+
+    if (EFI_ERROR (Status)) {
+      RamDiskUnregister ((*PrivateData)->DevicePath);
+      return Status;
+    }
+  }
+
+  gBS->ConnectController ((*PrivateData)->Handle, NULL, NULL, TRUE);
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Allocate memory and register the RAM disk created within RamDiskDxe
   driver HII.
 
+  A RAM disk in boot services data is gone once the OS loader calls
+  ExitBootServices(), so it is packed: blocks that are all zero take no
+  memory, and the other blocks are compressed.
+
   @param[in] Size            If creating raw, size of the RAM disk to create.
                              If creating from file, zero.
   @param[in] FileHandle      If creating raw, NULL. If creating from file, the
@@ -355,12 +433,28 @@ HiiCreateRamDisk (
   }
 
   if (MemoryType == RAM_DISK_BOOT_SERVICE_DATA_MEMORY) {
-    Status = gBS->AllocatePool (
-                    EfiBootServicesData,
-                    (UINTN)Size,
-                    (VOID**)&StartingAddr
-                    );
-  } else if (MemoryType == RAM_DISK_RESERVED_MEMORY) {
+    Status = HiiCreatePackedRamDisk (Size, FileHandle, &PrivateData);
+    if (EFI_ERROR (Status)) {
+      do {
+        CreatePopUp (
+          EFI_LIGHTGRAY | EFI_BACKGROUND_BLUE,
+          &Key,
+          L"",
+          (Status == EFI_DEVICE_ERROR) ? L"File content read error!" : L"Not enough memory to create the RAM disk!",
+          L"Press ENTER to continue ...",
+          L"",
+          NULL
+          );
+      } while (Key.UnicodeChar != CHAR_CARRIAGE_RETURN);
+
+      return Status;
+    }
+
+    PrivateData->CreateMethod = RamDiskCreateHii;
+    return EFI_SUCCESS;
+  }
+
+  if (MemoryType == RAM_DISK_RESERVED_MEMORY) {
     Status = gBS->AllocatePool (
                     EfiReservedMemoryType,
                     (UINTN)Size,
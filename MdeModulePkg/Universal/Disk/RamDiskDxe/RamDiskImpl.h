@@ -26,6 +26,8 @@
 #include <Library/PcdLib.h>
 #include <Library/DxeServicesLib.h>
 #include <Protocol/RamDisk.h>
+#include <Protocol/RamDiskStream.h>
+#include <Protocol/PackedRamDisk.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/BlockIo2.h>
 #include <Protocol/HiiConfigAccess.h>
@@ -59,6 +61,51 @@ extern  LIST_ENTRY                RegisteredRamDisks;
 extern  EFI_ACPI_TABLE_PROTOCOL   *mAcpiTableProtocol;
 extern  EFI_ACPI_SDT_PROTOCOL     *mAcpiSdtProtocol;
 
+//
+// The content of a packed RAM disk is kept in chunks of this size. A chunk
+// that is all zero takes no memory; the others are stored compressed when
+// that saves at least an eighth of the chunk.
+//
+// RAM disks created from the HII in boot services data are packed: they are
+// gone once the OS loader calls ExitBootServices(), so they are never handed
+// off to the OS and don't need a flat copy of their content.
+//
+#define RAM_DISK_CHUNK_SIZE         SIZE_16KB
+
+//
+// Size of the pieces a file is read in to fill a packed RAM disk
+//
+#define RAM_DISK_FILE_READ_SIZE     SIZE_1MB
+
+//
+// Size of the hash table of the chunk compressor, in entries
+//
+#define RAM_DISK_LZ4_HASH_BITS      12
+#define RAM_DISK_LZ4_HASH_SIZE      (1 << RAM_DISK_LZ4_HASH_BITS)
+
+typedef struct {
+  VOID                            *Data;        ///< NULL if the chunk is all zero
+  UINT32                          Length;       ///< Stored length; the chunk length if not compressed
+} RAM_DISK_CHUNK;
+
+typedef struct {
+  UINT64                          Size;
+  UINTN                           ChunkCount;
+  RAM_DISK_CHUNK                  *Chunks;
+  UINT64                          StoredBytes;  ///< Memory used by the chunk data
+  //
+  // The last compressed chunk that was read, kept decompressed
+  //
+  UINTN                           CachedChunk;
+  UINT8                           *Cache;
+  //
+  // Working buffers to update and compress a chunk
+  //
+  UINT8                           *Scratch;
+  UINT8                           *Packed;
+  UINT16                          *HashTable;
+} RAM_DISK_STORE;
+
 //
 // RAM Disk create method.
 //
@@ -90,6 +137,9 @@ typedef struct {
   BOOLEAN                         InNfit;
   EFI_QUESTION_ID                 CheckBoxId;
   BOOLEAN                         CheckBoxChecked;
+  RAM_DISK_STORE                  *Store;       ///< NULL unless the RAM disk is packed
+  EDKII_RAM_DISK_PRODUCER         *Producer;    ///< NULL unless the content is still produced
+  BOOLEAN                         Incomplete;   ///< The producer ended before the content was complete
 
   LIST_ENTRY                      ThisInstance;
 } RAM_DISK_PRIVATE_DATA;
@@ -190,6 +240,158 @@ RamDiskUnregister (
   IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath
   );
 
+/**
+  Create a packed RAM disk of the specified size and type.
+
+  The RAM disk reads as all zeros and is not connected: the caller writes its
+  content with RamDiskStoreWrite(), then connects its handle. A packed RAM
+  disk is only visible to boot services and is never published in the NFIT.
+
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[out] PrivateData    On return, points to the private data of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+RamDiskCreatePacked (
+  IN  UINT64                      RamDiskSize,
+  IN  EFI_GUID                    *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL    *ParentDevicePath     OPTIONAL,
+  OUT RAM_DISK_PRIVATE_DATA       **PrivateData
+  );
+
+/**
+  Register a packed RAM disk of the specified size and type.
+
+  @param[in]  This           The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[out] DevicePath     On return, points to the device path of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL, or
+                                  RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegisterPacked (
+  IN  EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  );
+
+/**
+  Write data to a packed RAM disk.
+
+  @param[in] This            The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param[in] DevicePath      The device path of the RAM disk.
+  @param[in] Offset          The offset in the RAM disk to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data is written.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, or the data goes past
+                                  the end of the RAM disk.
+  @retval EFI_NOT_FOUND           DevicePath is not a packed RAM disk.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to hold the data.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskWritePacked (
+  IN EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN UINT64                          Offset,
+  IN UINTN                           Length,
+  IN VOID                            *Buffer
+  );
+
+/**
+  Register a flat RAM disk whose content is still being produced.
+
+  @param[in]  This           The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param[in]  RamDiskBase    The base address of the RAM disk.
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[in]  Producer       The producer of the content of the RAM disk.
+  @param[out] DevicePath     On return, points to the device path of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, or RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegisterStream (
+  IN  EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN  UINT64                          RamDiskBase,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  IN  EDKII_RAM_DISK_PRODUCER         *Producer,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  );
+
+/**
+  Detach the producer from a streamed RAM disk, and publish the RAM disk in
+  the NFIT if its content is complete.
+
+  @param[in] This            The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param[in] DevicePath      The device path of the RAM disk.
+  @param[in] Complete        TRUE if the whole content has been produced.
+
+  @retval EFI_SUCCESS             The producer is detached.
+  @retval EFI_INVALID_PARAMETER   DevicePath is NULL.
+  @retval EFI_NOT_FOUND           DevicePath is not a streamed RAM disk.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskEndStream (
+  IN EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN BOOLEAN                         Complete
+  );
+
+/**
+  Detach the producer of a streamed RAM disk before the RAM disk goes away,
+  so that it stops writing to the memory of the RAM disk.
+
+  @param[in] PrivateData     Points to RAM disk private data.
+
+**/
+VOID
+RamDiskReleaseProducer (
+  IN RAM_DISK_PRIVATE_DATA        *PrivateData
+  );
+
 /**
   Initialize the BlockIO protocol of a RAM disk device.
 
@@ -601,4 +803,110 @@ RamDiskPublishNfit (
   IN RAM_DISK_PRIVATE_DATA        *PrivateData
   );
 
+/**
+  Compress a chunk in the LZ4 block format.
+
+  @param[in]  Src            The data to compress.
+  @param[in]  SrcLength      The length of the data, at most 64KB.
+  @param[out] Dst            The buffer to receive the compressed data.
+  @param[in]  DstLength      The length of the buffer.
+  @param[in]  HashTable      A table of RAM_DISK_LZ4_HASH_SIZE entries.
+
+  @return The length of the compressed data, or 0 if it doesn't fit in Dst.
+
+**/
+UINTN
+RamDiskLz4Compress (
+  IN  CONST UINT8                 *Src,
+  IN  UINTN                       SrcLength,
+  OUT UINT8                       *Dst,
+  IN  UINTN                       DstLength,
+  IN  UINT16                      *HashTable
+  );
+
+/**
+  Decompress a chunk in the LZ4 block format.
+
+  @param[in]  Src            The compressed data.
+  @param[in]  SrcLength      The length of the compressed data.
+  @param[out] Dst            The buffer to receive the data.
+  @param[in]  DstLength      The length of the data.
+
+  @retval TRUE               The data is decompressed.
+  @retval FALSE              The compressed data is corrupted.
+
+**/
+BOOLEAN
+RamDiskLz4Decompress (
+  IN  CONST UINT8                 *Src,
+  IN  UINTN                       SrcLength,
+  OUT UINT8                       *Dst,
+  IN  UINTN                       DstLength
+  );
+
+/**
+  Create the store of a packed RAM disk. The RAM disk reads as all zeros.
+
+  @param[in] Size            The size of the RAM disk, in bytes.
+
+  @return The store, or NULL if it could not be allocated.
+
+**/
+RAM_DISK_STORE *
+RamDiskStoreCreate (
+  IN UINT64                       Size
+  );
+
+/**
+  Free the store of a packed RAM disk.
+
+  @param[in] Store           The store of the RAM disk.
+
+**/
+VOID
+RamDiskStoreFree (
+  IN RAM_DISK_STORE               *Store
+  );
+
+/**
+  Read data from the store of a packed RAM disk.
+
+  @param[in]  Store          The store of the RAM disk.
+  @param[in]  Offset         The offset in the RAM disk to read from.
+  @param[in]  Length         The number of bytes to read.
+  @param[out] Buffer         The buffer to receive the data.
+
+  @retval EFI_SUCCESS             The data is read.
+  @retval EFI_DEVICE_ERROR        A compressed chunk is corrupted.
+
+**/
+EFI_STATUS
+RamDiskStoreRead (
+  IN  RAM_DISK_STORE              *Store,
+  IN  UINT64                      Offset,
+  IN  UINTN                       Length,
+  OUT VOID                        *Buffer
+  );
+
+/**
+  Write data to the store of a packed RAM disk.
+
+  @param[in] Store           The store of the RAM disk.
+  @param[in] Offset          The offset in the RAM disk to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data is written.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to hold the data.
+  @retval EFI_DEVICE_ERROR        A compressed chunk is corrupted.
+
+**/
+EFI_STATUS
+RamDiskStoreWrite (
+  IN RAM_DISK_STORE               *Store,
+  IN UINT64                       Offset,
+  IN UINTN                        Length,
+  IN CONST VOID                   *Buffer
+  );
+
 #endif
@@ -153,6 +153,15 @@ RamDiskPublishNfit (
   UINT8                                         Checksum;
   BOOLEAN                                       MemoryFound;
 
+  //
+  // A packed RAM disk has no flat content that the OS could use. A streamed
+  // RAM disk is published by RamDiskEndStream() once its content is complete.
+  //
+  if ((PrivateData->Store != NULL) || (PrivateData->Producer != NULL) ||
+      PrivateData->Incomplete) {
+    return EFI_NOT_FOUND;
+  }
+
   //
   // Get the EFI memory map.
   //
@@ -555,82 +564,38 @@ RamDiskUnpublishNfit (
 
 
 /**
-  Register a RAM disk with specified address, size and type.
+  Create the device path of a RAM disk, and install the EFI_DEVICE_PATH_PROTOCOL
+  and EFI_BLOCK_IO(2)_PROTOCOL of the RAM disk on a new handle.
 
-  @param[in]  RamDiskBase    The base address of registered RAM disk.
-  @param[in]  RamDiskSize    The size of registered RAM disk.
-  @param[in]  RamDiskType    The type of registered RAM disk. The GUID can be
-                             any of the values defined in section 9.3.6.9, or a
-                             vendor defined GUID.
+  @param[in]  PrivateData    Points to RAM disk private data.
   @param[in]  ParentDevicePath
                              Pointer to the parent device path. If there is no
                              parent device path then ParentDevicePath is NULL.
   @param[out] DevicePath     On return, points to a pointer to the device path
                              of the RAM disk device.
-                             If ParentDevicePath is not NULL, the returned
-                             DevicePath is created by appending a RAM disk node
-                             to the parent device path. If ParentDevicePath is
-                             NULL, the returned DevicePath is a RAM disk device
-                             path without appending. This function is
-                             responsible for allocating the buffer DevicePath
-                             with the boot service AllocatePool().
+  @param[in]  Connect        Whether to connect the RAM disk once installed.
 
-  @retval EFI_SUCCESS             The RAM disk is registered successfully.
-  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL.
-                                  RamDiskSize is 0.
+  @retval EFI_SUCCESS             The RAM disk is installed.
   @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
                                   is already present in the handle database.
-  @retval EFI_OUT_OF_RESOURCES    The RAM disk register operation fails due to
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be installed due to
                                   resource limitation.
 
 **/
 EFI_STATUS
-EFIAPI
-RamDiskRegister (
-  IN UINT64                       RamDiskBase,
-  IN UINT64                       RamDiskSize,
-  IN EFI_GUID                     *RamDiskType,
-  IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
-  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+RamDiskInstall (
+  IN  RAM_DISK_PRIVATE_DATA       *PrivateData,
+  IN  EFI_DEVICE_PATH_PROTOCOL    *ParentDevicePath     OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath,
+  IN  BOOLEAN                     Connect
   )
 {
   EFI_STATUS                      Status;
-  RAM_DISK_PRIVATE_DATA           *PrivateData;
   RAM_DISK_PRIVATE_DATA           *RegisteredPrivateData;
   MEDIA_RAM_DISK_DEVICE_PATH      *RamDiskDevNode;
   UINTN                           DevicePathSize;
   LIST_ENTRY                      *Entry;
 
-  if ((0 == RamDiskSize) || (NULL == RamDiskType) || (NULL == DevicePath)) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  //
-  // Add check to prevent data read across the memory boundary
-  //
-  if ((RamDiskSize > MAX_UINTN) ||
-      (RamDiskBase > MAX_UINTN - RamDiskSize + 1)) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  RamDiskDevNode = NULL;
-
-  //
-  // Create a new RAM disk instance and initialize its private data
-  //
-  PrivateData = AllocateCopyPool (
-                  sizeof (RAM_DISK_PRIVATE_DATA),
-                  &mRamDiskPrivateDataTemplate
-                  );
-  if (NULL == PrivateData) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  PrivateData->StartingAddr = RamDiskBase;
-  PrivateData->Size         = RamDiskSize;
-  CopyGuid (&PrivateData->TypeGuid, RamDiskType);
-  InitializeListHead (&PrivateData->ThisInstance);
-
   //
   // Generate device path information for the registered RAM disk
   //
@@ -709,7 +674,9 @@ RamDiskRegister (
   //
   InsertTailList (&RegisteredRamDisks, &PrivateData->ThisInstance);
 
-  gBS->ConnectController (PrivateData->Handle, NULL, NULL, TRUE);
+  if (Connect) {
+    gBS->ConnectController (PrivateData->Handle, NULL, NULL, TRUE);
+  }
 
   FreePool (RamDiskDevNode);
 
@@ -724,11 +691,83 @@ ErrorExit:
     FreePool (RamDiskDevNode);
   }
 
-  if (PrivateData != NULL) {
-    if (PrivateData->DevicePath) {
-      FreePool (PrivateData->DevicePath);
-    }
+  if (PrivateData->DevicePath != NULL) {
+    FreePool (PrivateData->DevicePath);
+    PrivateData->DevicePath = NULL;
+  }
+
+  return Status;
+}
+
+
+/**
+  Register and connect a RAM disk whose content is in memory, or is being
+  produced into memory by Producer.
 
+  @param[in]  RamDiskBase    The base address of the RAM disk.
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[in]  Producer       The producer of the content of the RAM disk, or
+                             NULL if the content is already in memory.
+  @param[out] DevicePath     On return, points to the device path of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL,
+                                  RamDiskSize is 0, or the RAM disk is out of
+                                  the address space.
+  @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
+                                  is already present in the handle database.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+RamDiskRegisterFlat (
+  IN  UINT64                      RamDiskBase,
+  IN  UINT64                      RamDiskSize,
+  IN  EFI_GUID                    *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL    *ParentDevicePath     OPTIONAL,
+  IN  EDKII_RAM_DISK_PRODUCER     *Producer             OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *PrivateData;
+
+  if ((0 == RamDiskSize) || (NULL == RamDiskType) || (NULL == DevicePath)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Add check to prevent data read across the memory boundary
+  //
+  if ((RamDiskSize > MAX_UINTN) ||
+      (RamDiskBase > MAX_UINTN - RamDiskSize + 1)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Create a new RAM disk instance and initialize its private data
+  //
+  PrivateData = AllocateCopyPool (
+                  sizeof (RAM_DISK_PRIVATE_DATA),
+                  &mRamDiskPrivateDataTemplate
+                  );
+  if (NULL == PrivateData) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PrivateData->StartingAddr = RamDiskBase;
+  PrivateData->Size         = RamDiskSize;
+  PrivateData->Producer     = Producer;
+  CopyGuid (&PrivateData->TypeGuid, RamDiskType);
+  InitializeListHead (&PrivateData->ThisInstance);
+
+  Status = RamDiskInstall (PrivateData, ParentDevicePath, DevicePath, TRUE);
+  if (EFI_ERROR (Status)) {
     FreePool (PrivateData);
   }
 
@@ -737,38 +776,82 @@ ErrorExit:
 
 
 /**
-  Unregister a RAM disk specified by DevicePath.
+  Register a RAM disk with specified address, size and type.
 
-  @param[in] DevicePath      A pointer to the device path that describes a RAM
+  @param[in]  RamDiskBase    The base address of registered RAM disk.
+  @param[in]  RamDiskSize    The size of registered RAM disk.
+  @param[in]  RamDiskType    The type of registered RAM disk. The GUID can be
+                             any of the values defined in section 9.3.6.9, or a
+                             vendor defined GUID.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path. If there is no
+                             parent device path then ParentDevicePath is NULL.
+  @param[out] DevicePath     On return, points to a pointer to the device path
+                             of the RAM disk device.
+                             If ParentDevicePath is not NULL, the returned
+                             DevicePath is created by appending a RAM disk node
+                             to the parent device path. If ParentDevicePath is
+                             NULL, the returned DevicePath is a RAM disk device
+                             path without appending. This function is
+                             responsible for allocating the buffer DevicePath
+                             with the boot service AllocatePool().
+
+  @retval EFI_SUCCESS             The RAM disk is registered successfully.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL.
+                                  RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A Device Path Protocol instance to be created
+                                  is already present in the handle database.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk register operation fails due to
+                                  resource limitation.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegister (
+  IN UINT64                       RamDiskBase,
+  IN UINT64                       RamDiskSize,
+  IN EFI_GUID                     *RamDiskType,
+  IN EFI_DEVICE_PATH              *ParentDevicePath     OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL    **DevicePath
+  )
+{
+  return RamDiskRegisterFlat (
+           RamDiskBase,
+           RamDiskSize,
+           RamDiskType,
+           ParentDevicePath,
+           NULL,
+           DevicePath
+           );
+}
+
+
+/**
+  Find the registered RAM disk specified by DevicePath.
+
+  @param[in]  DevicePath     A pointer to the device path that describes a RAM
                              Disk device.
+  @param[out] PrivateData    Returns the private data of the RAM disk.
 
-  @retval EFI_SUCCESS             The RAM disk is unregistered successfully.
-  @retval EFI_INVALID_PARAMETER   DevicePath is NULL.
+  @retval EFI_SUCCESS             The RAM disk is found.
   @retval EFI_UNSUPPORTED         The device specified by DevicePath is not a
-                                  valid ramdisk device path and not supported
-                                  by the driver.
+                                  valid ramdisk device path.
   @retval EFI_NOT_FOUND           The RAM disk pointed by DevicePath doesn't
                                   exist.
 
 **/
 EFI_STATUS
-EFIAPI
-RamDiskUnregister (
-  IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath
+RamDiskFind (
+  IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath,
+  OUT RAM_DISK_PRIVATE_DATA       **PrivateData
   )
 {
   LIST_ENTRY                      *Entry;
-  LIST_ENTRY                      *NextEntry;
-  BOOLEAN                         Found;
   UINT64                          StartingAddr;
   UINT64                          EndingAddr;
   EFI_DEVICE_PATH_PROTOCOL        *Header;
   MEDIA_RAM_DISK_DEVICE_PATH      *RamDiskDevNode;
-  RAM_DISK_PRIVATE_DATA           *PrivateData;
-
-  if (NULL == DevicePath) {
-    return EFI_INVALID_PARAMETER;
-  }
+  RAM_DISK_PRIVATE_DATA           *RegisteredPrivateData;
 
   //
   // Locate the RAM disk device node.
@@ -793,65 +876,381 @@ RamDiskUnregister (
     return EFI_UNSUPPORTED;
   }
 
-  Found          = FALSE;
   StartingAddr   = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->StartingAddr[0]));
   EndingAddr     = ReadUnaligned64 ((UINT64 *) &(RamDiskDevNode->EndingAddr[0]));
 
-  if (!IsListEmpty(&RegisteredRamDisks)) {
-    BASE_LIST_FOR_EACH_SAFE (Entry, NextEntry, &RegisteredRamDisks) {
-      PrivateData = RAM_DISK_PRIVATE_FROM_THIS (Entry);
-
-      //
-      // Unregister the RAM disk given by its starting address, ending address
-      // and type guid.
-      //
-      if ((StartingAddr == PrivateData->StartingAddr) &&
-          (EndingAddr == PrivateData->StartingAddr + PrivateData->Size - 1) &&
-          (CompareGuid (&RamDiskDevNode->TypeGuid, &PrivateData->TypeGuid))) {
-        //
-        // Remove the content for this RAM disk in NFIT.
-        //
-        if (PrivateData->InNfit) {
-          RamDiskUnpublishNfit (PrivateData);
-        }
+  BASE_LIST_FOR_EACH (Entry, &RegisteredRamDisks) {
+    RegisteredPrivateData = RAM_DISK_PRIVATE_FROM_THIS (Entry);
 
-        //
-        // Uninstall the EFI_DEVICE_PATH_PROTOCOL & EFI_BLOCK_IO(2)_PROTOCOL
-        //
-        gBS->UninstallMultipleProtocolInterfaces (
-               PrivateData->Handle,
-               &gEfiBlockIoProtocolGuid,
-               &PrivateData->BlockIo,
-               &gEfiBlockIo2ProtocolGuid,
-               &PrivateData->BlockIo2,
-               &gEfiDevicePathProtocolGuid,
-               (EFI_DEVICE_PATH_PROTOCOL *) PrivateData->DevicePath,
-               NULL
-               );
+    //
+    // The RAM disk is given by its starting address, ending address and type
+    // guid.
+    //
+    if ((StartingAddr == RegisteredPrivateData->StartingAddr) &&
+        (EndingAddr == RegisteredPrivateData->StartingAddr + RegisteredPrivateData->Size - 1) &&
+        (CompareGuid (&RamDiskDevNode->TypeGuid, &RegisteredPrivateData->TypeGuid))) {
+      *PrivateData = RegisteredPrivateData;
+      return EFI_SUCCESS;
+    }
+  }
 
-        RemoveEntryList (&PrivateData->ThisInstance);
+  return EFI_NOT_FOUND;
+}
 
-        if (RamDiskCreateHii == PrivateData->CreateMethod) {
-          //
-          // If a RAM disk is created within HII, then the RamDiskDxe driver
-          // driver is responsible for freeing the allocated memory for the
-          // RAM disk.
-          //
-          FreePool ((VOID *)(UINTN) PrivateData->StartingAddr);
-        }
 
-        FreePool (PrivateData->DevicePath);
-        FreePool (PrivateData);
-        Found = TRUE;
+/**
+  Detach the producer of a streamed RAM disk before the RAM disk goes away,
+  so that it stops writing to the memory of the RAM disk.
 
-        break;
-      }
-    }
+  @param[in] PrivateData     Points to RAM disk private data.
+
+**/
+VOID
+RamDiskReleaseProducer (
+  IN RAM_DISK_PRIVATE_DATA        *PrivateData
+  )
+{
+  EDKII_RAM_DISK_PRODUCER         *Producer;
+
+  Producer = PrivateData->Producer;
+  if (Producer != NULL) {
+    PrivateData->Producer = NULL;
+    Producer->Release (Producer);
   }
+}
 
-  if (TRUE == Found) {
-    return EFI_SUCCESS;
-  } else {
+
+/**
+  Unregister a RAM disk specified by DevicePath.
+
+  @param[in] DevicePath      A pointer to the device path that describes a RAM
+                             Disk device.
+
+  @retval EFI_SUCCESS             The RAM disk is unregistered successfully.
+  @retval EFI_INVALID_PARAMETER   DevicePath is NULL.
+  @retval EFI_UNSUPPORTED         The device specified by DevicePath is not a
+                                  valid ramdisk device path and not supported
+                                  by the driver.
+  @retval EFI_NOT_FOUND           The RAM disk pointed by DevicePath doesn't
+                                  exist.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskUnregister (
+  IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *PrivateData;
+
+  if (NULL == DevicePath) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RamDiskFind (DevicePath, &PrivateData);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  RamDiskReleaseProducer (PrivateData);
+
+  //
+  // Remove the content for this RAM disk in NFIT.
+  //
+  if (PrivateData->InNfit) {
+    RamDiskUnpublishNfit (PrivateData);
+  }
+
+  //
+  // Uninstall the EFI_DEVICE_PATH_PROTOCOL & EFI_BLOCK_IO(2)_PROTOCOL
+  //
+  gBS->UninstallMultipleProtocolInterfaces (
+         PrivateData->Handle,
+         &gEfiBlockIoProtocolGuid,
+         &PrivateData->BlockIo,
+         &gEfiBlockIo2ProtocolGuid,
+         &PrivateData->BlockIo2,
+         &gEfiDevicePathProtocolGuid,
+         (EFI_DEVICE_PATH_PROTOCOL *) PrivateData->DevicePath,
+         NULL
+         );
+
+  RemoveEntryList (&PrivateData->ThisInstance);
+
+  if (PrivateData->Store != NULL) {
+    RamDiskStoreFree (PrivateData->Store);
+  } else if (RamDiskCreateHii == PrivateData->CreateMethod) {
+    //
+    // If a RAM disk is created within HII, then the RamDiskDxe driver
+    // driver is responsible for freeing the allocated memory for the
+    // RAM disk.
+    //
+    FreePool ((VOID *)(UINTN) PrivateData->StartingAddr);
+  }
+
+  FreePool (PrivateData->DevicePath);
+  FreePool (PrivateData);
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Create a packed RAM disk of the specified size and type.
+
+  The RAM disk reads as all zeros and is not connected. Since a packed RAM
+  disk has no flat content in memory, its device path uses the address of its
+  store, which is unique while the RAM disk is registered.
+
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[out] PrivateData    On return, points to the private data of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+RamDiskCreatePacked (
+  IN  UINT64                      RamDiskSize,
+  IN  EFI_GUID                    *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL    *ParentDevicePath     OPTIONAL,
+  OUT RAM_DISK_PRIVATE_DATA       **PrivateData
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *NewPrivateData;
+  EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
+
+  if (0 == RamDiskSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  NewPrivateData = AllocateCopyPool (
+                     sizeof (RAM_DISK_PRIVATE_DATA),
+                     &mRamDiskPrivateDataTemplate
+                     );
+  if (NULL == NewPrivateData) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewPrivateData->Store = RamDiskStoreCreate (RamDiskSize);
+  if (NULL == NewPrivateData->Store) {
+    FreePool (NewPrivateData);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewPrivateData->StartingAddr = (UINTN) NewPrivateData->Store;
+  NewPrivateData->Size         = RamDiskSize;
+  CopyGuid (&NewPrivateData->TypeGuid, RamDiskType);
+  InitializeListHead (&NewPrivateData->ThisInstance);
+
+  Status = RamDiskInstall (NewPrivateData, ParentDevicePath, &DevicePath, FALSE);
+  if (EFI_ERROR (Status)) {
+    RamDiskStoreFree (NewPrivateData->Store);
+    FreePool (NewPrivateData);
+    return Status;
+  }
+
+  *PrivateData = NewPrivateData;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Register a packed RAM disk of the specified size and type.
+
+  @param[in]  This           The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[out] DevicePath     On return, points to the device path of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   DevicePath or RamDiskType is NULL, or
+                                  RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegisterPacked (
+  IN  EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *PrivateData;
+
+  if ((NULL == RamDiskType) || (NULL == DevicePath)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RamDiskCreatePacked (RamDiskSize, RamDiskType, ParentDevicePath, &PrivateData);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *DevicePath = PrivateData->DevicePath;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Write data to a packed RAM disk.
+
+  @param[in] This            The EDKII_PACKED_RAM_DISK_PROTOCOL instance.
+  @param[in] DevicePath      The device path of the RAM disk.
+  @param[in] Offset          The offset in the RAM disk to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data is written.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, or the data goes past
+                                  the end of the RAM disk.
+  @retval EFI_NOT_FOUND           DevicePath is not a packed RAM disk.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to hold the data.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskWritePacked (
+  IN EDKII_PACKED_RAM_DISK_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN UINT64                          Offset,
+  IN UINTN                           Length,
+  IN VOID                            *Buffer
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *PrivateData;
+
+  if ((NULL == DevicePath) || (NULL == Buffer)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RamDiskFind (DevicePath, &PrivateData);
+  if (EFI_ERROR (Status) || (NULL == PrivateData->Store)) {
     return EFI_NOT_FOUND;
   }
+
+  if ((Offset > PrivateData->Size) || (Length > PrivateData->Size - Offset)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return RamDiskStoreWrite (PrivateData->Store, Offset, Length, Buffer);
+}
+
+
+/**
+  Register a flat RAM disk whose content is still being produced.
+
+  @param[in]  This           The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param[in]  RamDiskBase    The base address of the RAM disk.
+  @param[in]  RamDiskSize    The size of the RAM disk, in bytes.
+  @param[in]  RamDiskType    The type of the RAM disk.
+  @param[in]  ParentDevicePath
+                             Pointer to the parent device path, or NULL if
+                             there is no parent device path.
+  @param[in]  Producer       The producer of the content of the RAM disk.
+  @param[out] DevicePath     On return, points to the device path of the RAM
+                             disk.
+
+  @retval EFI_SUCCESS             The RAM disk is registered.
+  @retval EFI_INVALID_PARAMETER   A parameter is NULL, or RamDiskSize is 0.
+  @retval EFI_ALREADY_STARTED     A RAM disk with the same device path is
+                                  already registered.
+  @retval EFI_OUT_OF_RESOURCES    The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskRegisterStream (
+  IN  EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN  UINT64                          RamDiskBase,
+  IN  UINT64                          RamDiskSize,
+  IN  EFI_GUID                        *RamDiskType,
+  IN  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath OPTIONAL,
+  IN  EDKII_RAM_DISK_PRODUCER         *Producer,
+  OUT EFI_DEVICE_PATH_PROTOCOL        **DevicePath
+  )
+{
+  if ((NULL == Producer) || (NULL == Producer->Fill) ||
+      (NULL == Producer->Release)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return RamDiskRegisterFlat (
+           RamDiskBase,
+           RamDiskSize,
+           RamDiskType,
+           ParentDevicePath,
+           Producer,
+           DevicePath
+           );
+}
+
+
+/**
+  Detach the producer from a streamed RAM disk, and publish the RAM disk in
+  the NFIT if its content is complete.
+
+  @param[in] This            The EDKII_RAM_DISK_STREAM_PROTOCOL instance.
+  @param[in] DevicePath      The device path of the RAM disk.
+  @param[in] Complete        TRUE if the whole content has been produced.
+
+  @retval EFI_SUCCESS             The producer is detached.
+  @retval EFI_INVALID_PARAMETER   DevicePath is NULL.
+  @retval EFI_NOT_FOUND           DevicePath is not a streamed RAM disk.
+
+**/
+EFI_STATUS
+EFIAPI
+RamDiskEndStream (
+  IN EDKII_RAM_DISK_STREAM_PROTOCOL  *This,
+  IN EFI_DEVICE_PATH_PROTOCOL        *DevicePath,
+  IN BOOLEAN                         Complete
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_PRIVATE_DATA           *PrivateData;
+
+  if (NULL == DevicePath) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = RamDiskFind (DevicePath, &PrivateData);
+  if (EFI_ERROR (Status) || (NULL == PrivateData->Producer)) {
+    return EFI_NOT_FOUND;
+  }
+
+  PrivateData->Producer = NULL;
+
+  if (!Complete) {
+    DEBUG ((EFI_D_WARN, "RamDiskEndStream: RAM disk content is incomplete, fail its I/O.\n"));
+    PrivateData->Incomplete = TRUE;
+    return EFI_SUCCESS;
+  }
+
+  if ((mAcpiTableProtocol != NULL) && (mAcpiSdtProtocol != NULL)) {
+    RamDiskPublishNfit (PrivateData);
+  }
+
+  return EFI_SUCCESS;
 }
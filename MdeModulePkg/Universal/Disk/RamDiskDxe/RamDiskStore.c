@@ -0,0 +1,631 @@
+/** @file
+  The store of packed RAM disks.
+
+  The content of a packed RAM disk is split in chunks of RAM_DISK_CHUNK_SIZE.
+  A chunk that is all zero has no data. The other chunks are kept either as is,
+  or compressed in the LZ4 block format when that saves memory. The block
+  format is simple enough to compress and decompress a chunk much faster than
+  a file system or the network delivers it.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "RamDiskImpl.h"
+
+//
+// LZ4 block format: a match is at least 4 bytes, the last 5 bytes of a
+// block are literals, and the last match starts at least 12 bytes before the
+// end of the block.
+//
+#define RAM_DISK_LZ4_MIN_MATCH      4
+#define RAM_DISK_LZ4_LAST_LITERALS  5
+#define RAM_DISK_LZ4_MF_LIMIT       12
+#define RAM_DISK_LZ4_MAX_OFFSET     0xFFFF
+
+//
+// Miss count after which the compressor starts skipping ahead, so that
+// incompressible data goes through quickly.
+//
+#define RAM_DISK_LZ4_SKIP_TRIGGER   6
+
+/**
+  Store a length that does not fit in the 4 bits of a token.
+
+  @param[in]      Dst        The destination buffer.
+  @param[in, out] Index      The position in the destination buffer.
+  @param[in]      Length     The length minus 15.
+
+**/
+VOID
+RamDiskLz4PutLength (
+  IN     UINT8                    *Dst,
+  IN OUT UINTN                    *Index,
+  IN     UINTN                    Length
+  )
+{
+  while (Length >= 255) {
+    Dst[(*Index)++] = 255;
+    Length         -= 255;
+  }
+  Dst[(*Index)++] = (UINT8) Length;
+}
+
+/**
+  Compress a chunk in the LZ4 block format.
+
+  @param[in]  Src            The data to compress.
+  @param[in]  SrcLength      The length of the data, at most 64KB.
+  @param[out] Dst            The buffer to receive the compressed data.
+  @param[in]  DstLength      The length of the buffer.
+  @param[in]  HashTable      A table of RAM_DISK_LZ4_HASH_SIZE entries.
+
+  @return The length of the compressed data, or 0 if it doesn't fit in Dst.
+
+**/
+UINTN
+RamDiskLz4Compress (
+  IN  CONST UINT8                 *Src,
+  IN  UINTN                       SrcLength,
+  OUT UINT8                       *Dst,
+  IN  UINTN                       DstLength,
+  IN  UINT16                      *HashTable
+  )
+{
+  UINTN                           Ip;
+  UINTN                           Anchor;
+  UINTN                           Op;
+  UINTN                           Ref;
+  UINTN                           Hash;
+  UINTN                           MatchLength;
+  UINTN                           MatchLimit;
+  UINTN                           LiteralLength;
+  UINTN                           Misses;
+  UINT32                          Sequence;
+  UINT8                           *Token;
+
+  ASSERT (SrcLength <= RAM_DISK_LZ4_MAX_OFFSET + 1);
+
+  ZeroMem (HashTable, RAM_DISK_LZ4_HASH_SIZE * sizeof (UINT16));
+  Ip     = 0;
+  Anchor = 0;
+  Op     = 0;
+  Misses = 0;
+
+  if (SrcLength > RAM_DISK_LZ4_MF_LIMIT) {
+    while (Ip < SrcLength - RAM_DISK_LZ4_MF_LIMIT) {
+      Sequence        = ReadUnaligned32 ((CONST UINT32 *) (Src + Ip));
+      Hash            = (UINT32) (Sequence * 2654435761U) >> (32 - RAM_DISK_LZ4_HASH_BITS);
+      Ref             = HashTable[Hash];
+      HashTable[Hash] = (UINT16) Ip;
+
+      if ((Ref >= Ip) || (ReadUnaligned32 ((CONST UINT32 *) (Src + Ref)) != Sequence)) {
+        Misses++;
+        Ip += 1 + (Misses >> RAM_DISK_LZ4_SKIP_TRIGGER);
+        continue;
+      }
+      Misses = 0;
+
+      //
+      // Extend the match, leaving the last literals alone.
+      //
+      MatchLimit  = SrcLength - RAM_DISK_LZ4_LAST_LITERALS;
+      MatchLength = RAM_DISK_LZ4_MIN_MATCH;
+      while ((Ip + MatchLength < MatchLimit) && (Src[Ref + MatchLength] == Src[Ip + MatchLength])) {
+        MatchLength++;
+      }
+
+      //
+      // Emit the literals before the match, then the match.
+      //
+      LiteralLength = Ip - Anchor;
+      if (Op + 1 + LiteralLength / 255 + 1 + LiteralLength + 2 +
+          (MatchLength - RAM_DISK_LZ4_MIN_MATCH) / 255 + 1 > DstLength) {
+        return 0;
+      }
+
+      Token = &Dst[Op++];
+      if (LiteralLength >= 15) {
+        *Token = 15 << 4;
+        RamDiskLz4PutLength (Dst, &Op, LiteralLength - 15);
+      } else {
+        *Token = (UINT8) (LiteralLength << 4);
+      }
+      CopyMem (&Dst[Op], &Src[Anchor], LiteralLength);
+      Op += LiteralLength;
+
+      Dst[Op++] = (UINT8) (Ip - Ref);
+      Dst[Op++] = (UINT8) ((Ip - Ref) >> 8);
+
+      if (MatchLength - RAM_DISK_LZ4_MIN_MATCH >= 15) {
+        *Token |= 15;
+        RamDiskLz4PutLength (Dst, &Op, MatchLength - RAM_DISK_LZ4_MIN_MATCH - 15);
+      } else {
+        *Token |= (UINT8) (MatchLength - RAM_DISK_LZ4_MIN_MATCH);
+      }
+
+      Ip    += MatchLength;
+      Anchor = Ip;
+    }
+  }
+
+  //
+  // The last sequence only has literals.
+  //
+  LiteralLength = SrcLength - Anchor;
+  if (Op + 1 + LiteralLength / 255 + 1 + LiteralLength > DstLength) {
+    return 0;
+  }
+
+  Token = &Dst[Op++];
+  if (LiteralLength >= 15) {
+    *Token = 15 << 4;
+    RamDiskLz4PutLength (Dst, &Op, LiteralLength - 15);
+  } else {
+    *Token = (UINT8) (LiteralLength << 4);
+  }
+  CopyMem (&Dst[Op], &Src[Anchor], LiteralLength);
+  Op += LiteralLength;
+
+  return Op;
+}
+
+/**
+  Read a length that does not fit in the 4 bits of a token.
+
+  @param[in]      Src        The compressed data.
+  @param[in]      SrcLength  The length of the compressed data.
+  @param[in, out] Index      The position in the compressed data.
+  @param[in, out] Length     The length to add to.
+
+  @retval TRUE               The length is read.
+  @retval FALSE              The compressed data is truncated.
+
+**/
+BOOLEAN
+RamDiskLz4GetLength (
+  IN     CONST UINT8              *Src,
+  IN     UINTN                    SrcLength,
+  IN OUT UINTN                    *Index,
+  IN OUT UINTN                    *Length
+  )
+{
+  UINT8                           Byte;
+
+  do {
+    if (*Index >= SrcLength) {
+      return FALSE;
+    }
+    Byte     = Src[(*Index)++];
+    *Length += Byte;
+  } while (Byte == 255);
+
+  return TRUE;
+}
+
+/**
+  Decompress a chunk in the LZ4 block format.
+
+  @param[in]  Src            The compressed data.
+  @param[in]  SrcLength      The length of the compressed data.
+  @param[out] Dst            The buffer to receive the data.
+  @param[in]  DstLength      The length of the data.
+
+  @retval TRUE               The data is decompressed.
+  @retval FALSE              The compressed data is corrupted.
+
+**/
+BOOLEAN
+RamDiskLz4Decompress (
+  IN  CONST UINT8                 *Src,
+  IN  UINTN                       SrcLength,
+  OUT UINT8                       *Dst,
+  IN  UINTN                       DstLength
+  )
+{
+  UINTN                           Ip;
+  UINTN                           Op;
+  UINTN                           Offset;
+  UINTN                           Length;
+  UINT8                           Token;
+
+  Ip = 0;
+  Op = 0;
+  while (Ip < SrcLength) {
+    Token  = Src[Ip++];
+    Length = Token >> 4;
+    if ((Length == 15) && !RamDiskLz4GetLength (Src, SrcLength, &Ip, &Length)) {
+      return FALSE;
+    }
+    if ((Length > SrcLength - Ip) || (Length > DstLength - Op)) {
+      return FALSE;
+    }
+    CopyMem (&Dst[Op], &Src[Ip], Length);
+    Ip += Length;
+    Op += Length;
+
+    if (Ip == SrcLength) {
+      break;
+    }
+
+    if (SrcLength - Ip < 2) {
+      return FALSE;
+    }
+    Offset = Src[Ip] | (Src[Ip + 1] << 8);
+    Ip    += 2;
+    if ((Offset == 0) || (Offset > Op)) {
+      return FALSE;
+    }
+
+    Length = Token & 15;
+    if ((Length == 15) && !RamDiskLz4GetLength (Src, SrcLength, &Ip, &Length)) {
+      return FALSE;
+    }
+    Length += RAM_DISK_LZ4_MIN_MATCH;
+    if (Length > DstLength - Op) {
+      return FALSE;
+    }
+
+    if (Offset >= Length) {
+      CopyMem (&Dst[Op], &Dst[Op - Offset], Length);
+      Op += Length;
+    } else {
+      //
+      // The match overlaps the data it produces.
+      //
+      while (Length-- > 0) {
+        Dst[Op] = Dst[Op - Offset];
+        Op++;
+      }
+    }
+  }
+
+  return (BOOLEAN) (Op == DstLength);
+}
+
+/**
+  Get the length of a chunk of a packed RAM disk. The last chunk may be
+  shorter than RAM_DISK_CHUNK_SIZE.
+
+  @param[in] Store           The store of the RAM disk.
+  @param[in] Index           The index of the chunk.
+
+  @return The length of the chunk.
+
+**/
+UINTN
+RamDiskStoreChunkLength (
+  IN RAM_DISK_STORE               *Store,
+  IN UINTN                        Index
+  )
+{
+  UINT64                          Start;
+
+  Start = MultU64x32 (Index, RAM_DISK_CHUNK_SIZE);
+  if (Store->Size - Start < RAM_DISK_CHUNK_SIZE) {
+    return (UINTN) (Store->Size - Start);
+  }
+  return RAM_DISK_CHUNK_SIZE;
+}
+
+/**
+  Get the whole content of a chunk.
+
+  @param[in]  Store          The store of the RAM disk.
+  @param[in]  Index          The index of the chunk.
+  @param[out] Buffer         The buffer to receive the chunk.
+
+  @retval EFI_SUCCESS             The chunk is read.
+  @retval EFI_DEVICE_ERROR        The compressed chunk is corrupted.
+
+**/
+EFI_STATUS
+RamDiskStoreLoadChunk (
+  IN  RAM_DISK_STORE              *Store,
+  IN  UINTN                       Index,
+  OUT UINT8                       *Buffer
+  )
+{
+  RAM_DISK_CHUNK                  *Chunk;
+  UINTN                           ChunkLength;
+
+  Chunk       = &Store->Chunks[Index];
+  ChunkLength = RamDiskStoreChunkLength (Store, Index);
+
+  if (Chunk->Data == NULL) {
+    ZeroMem (Buffer, ChunkLength);
+  } else if (Chunk->Length == ChunkLength) {
+    CopyMem (Buffer, Chunk->Data, ChunkLength);
+  } else if (!RamDiskLz4Decompress (Chunk->Data, Chunk->Length, Buffer, ChunkLength)) {
+    DEBUG ((EFI_D_ERROR, "RamDiskStoreLoadChunk: Chunk %ld is corrupted\n", (UINT64) Index));
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Replace the whole content of a chunk.
+
+  @param[in] Store           The store of the RAM disk.
+  @param[in] Index           The index of the chunk.
+  @param[in] Buffer          The new content of the chunk.
+
+  @retval EFI_SUCCESS             The chunk is saved.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory for the chunk.
+
+**/
+EFI_STATUS
+RamDiskStoreSaveChunk (
+  IN RAM_DISK_STORE               *Store,
+  IN UINTN                        Index,
+  IN CONST UINT8                  *Buffer
+  )
+{
+  RAM_DISK_CHUNK                  *Chunk;
+  UINTN                           ChunkLength;
+  CONST UINT8                     *Data;
+  UINTN                           Length;
+  VOID                            *NewData;
+
+  Chunk       = &Store->Chunks[Index];
+  ChunkLength = RamDiskStoreChunkLength (Store, Index);
+
+  if (Store->CachedChunk == Index) {
+    Store->CachedChunk = MAX_UINTN;
+  }
+
+  if (IsZeroBuffer (Buffer, ChunkLength)) {
+    if (Chunk->Data != NULL) {
+      Store->StoredBytes -= Chunk->Length;
+      FreePool (Chunk->Data);
+      Chunk->Data   = NULL;
+      Chunk->Length = 0;
+    }
+    return EFI_SUCCESS;
+  }
+
+  Data   = Store->Packed;
+  Length = RamDiskLz4Compress (
+             Buffer,
+             ChunkLength,
+             Store->Packed,
+             ChunkLength - ChunkLength / 8,
+             Store->HashTable
+             );
+  if (Length == 0) {
+    Data   = Buffer;
+    Length = ChunkLength;
+  }
+
+  if ((Chunk->Data == NULL) || (Chunk->Length != Length)) {
+    NewData = AllocatePool (Length);
+    if (NewData == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    if (Chunk->Data != NULL) {
+      Store->StoredBytes -= Chunk->Length;
+      FreePool (Chunk->Data);
+    }
+    Chunk->Data         = NewData;
+    Chunk->Length       = (UINT32) Length;
+    Store->StoredBytes += Length;
+  }
+  CopyMem (Chunk->Data, Data, Length);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Create the store of a packed RAM disk. The RAM disk reads as all zeros.
+
+  @param[in] Size            The size of the RAM disk, in bytes.
+
+  @return The store, or NULL if it could not be allocated.
+
+**/
+RAM_DISK_STORE *
+RamDiskStoreCreate (
+  IN UINT64                       Size
+  )
+{
+  RAM_DISK_STORE                  *Store;
+  UINT64                          ChunkCount;
+
+  ChunkCount = DivU64x32 (Size + RAM_DISK_CHUNK_SIZE - 1, RAM_DISK_CHUNK_SIZE);
+  if (ChunkCount > MAX_UINTN / sizeof (RAM_DISK_CHUNK)) {
+    return NULL;
+  }
+
+  Store = AllocateZeroPool (sizeof (RAM_DISK_STORE));
+  if (Store == NULL) {
+    return NULL;
+  }
+
+  Store->Size        = Size;
+  Store->ChunkCount  = (UINTN) ChunkCount;
+  Store->CachedChunk = MAX_UINTN;
+  Store->Chunks      = AllocateZeroPool (Store->ChunkCount * sizeof (RAM_DISK_CHUNK));
+  Store->Cache       = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Store->Scratch     = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Store->Packed      = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Store->HashTable   = AllocatePool (RAM_DISK_LZ4_HASH_SIZE * sizeof (UINT16));
+  if ((Store->Chunks == NULL) || (Store->Cache == NULL) || (Store->Scratch == NULL) ||
+      (Store->Packed == NULL) || (Store->HashTable == NULL)) {
+    RamDiskStoreFree (Store);
+    return NULL;
+  }
+
+  return Store;
+}
+
+/**
+  Free the store of a packed RAM disk.
+
+  @param[in] Store           The store of the RAM disk.
+
+**/
+VOID
+RamDiskStoreFree (
+  IN RAM_DISK_STORE               *Store
+  )
+{
+  UINTN                           Index;
+
+  if (Store->Chunks != NULL) {
+    DEBUG ((
+      EFI_D_INFO,
+      "RamDiskStore: %ld bytes stored in %ld bytes for %ld chunks\n",
+      Store->Size,
+      Store->StoredBytes,
+      (UINT64) Store->ChunkCount
+      ));
+
+    for (Index = 0; Index < Store->ChunkCount; Index++) {
+      if (Store->Chunks[Index].Data != NULL) {
+        FreePool (Store->Chunks[Index].Data);
+      }
+    }
+    FreePool (Store->Chunks);
+  }
+
+  if (Store->Cache != NULL) {
+    FreePool (Store->Cache);
+  }
+  if (Store->Scratch != NULL) {
+    FreePool (Store->Scratch);
+  }
+  if (Store->Packed != NULL) {
+    FreePool (Store->Packed);
+  }
+  if (Store->HashTable != NULL) {
+    FreePool (Store->HashTable);
+  }
+
+  FreePool (Store);
+}
+
+/**
+  Read data from the store of a packed RAM disk.
+
+  @param[in]  Store          The store of the RAM disk.
+  @param[in]  Offset         The offset in the RAM disk to read from.
+  @param[in]  Length         The number of bytes to read.
+  @param[out] Buffer         The buffer to receive the data.
+
+  @retval EFI_SUCCESS             The data is read.
+  @retval EFI_DEVICE_ERROR        A compressed chunk is corrupted.
+
+**/
+EFI_STATUS
+RamDiskStoreRead (
+  IN  RAM_DISK_STORE              *Store,
+  IN  UINT64                      Offset,
+  IN  UINTN                       Length,
+  OUT VOID                        *Buffer
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_CHUNK                  *Chunk;
+  UINTN                           Index;
+  UINT32                          ChunkOffset;
+  UINTN                           ChunkLength;
+  UINTN                           Count;
+  UINT8                           *Data;
+
+  ASSERT (Offset + Length <= Store->Size);
+
+  Data = Buffer;
+  while (Length > 0) {
+    Index       = (UINTN) DivU64x32Remainder (Offset, RAM_DISK_CHUNK_SIZE, &ChunkOffset);
+    Chunk       = &Store->Chunks[Index];
+    ChunkLength = RamDiskStoreChunkLength (Store, Index);
+    Count       = MIN (Length, ChunkLength - ChunkOffset);
+
+    if (Chunk->Data == NULL) {
+      ZeroMem (Data, Count);
+    } else if (Chunk->Length == ChunkLength) {
+      CopyMem (Data, (UINT8 *) Chunk->Data + ChunkOffset, Count);
+    } else {
+      //
+      // Keep the last compressed chunk decompressed, since the blocks of a
+      // chunk are usually read one after the other.
+      //
+      if (Store->CachedChunk != Index) {
+        Store->CachedChunk = MAX_UINTN;
+        Status = RamDiskStoreLoadChunk (Store, Index, Store->Cache);
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+        Store->CachedChunk = Index;
+      }
+      CopyMem (Data, Store->Cache + ChunkOffset, Count);
+    }
+
+    Data   += Count;
+    Offset += Count;
+    Length -= Count;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write data to the store of a packed RAM disk.
+
+  @param[in] Store           The store of the RAM disk.
+  @param[in] Offset          The offset in the RAM disk to write to.
+  @param[in] Length          The number of bytes to write.
+  @param[in] Buffer          The data to write.
+
+  @retval EFI_SUCCESS             The data is written.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory to hold the data.
+  @retval EFI_DEVICE_ERROR        A compressed chunk is corrupted.
+
+**/
+EFI_STATUS
+RamDiskStoreWrite (
+  IN RAM_DISK_STORE               *Store,
+  IN UINT64                       Offset,
+  IN UINTN                        Length,
+  IN CONST VOID                   *Buffer
+  )
+{
+  EFI_STATUS                      Status;
+  UINTN                           Index;
+  UINT32                          ChunkOffset;
+  UINTN                           ChunkLength;
+  UINTN                           Count;
+  CONST UINT8                     *Data;
+
+  ASSERT (Offset + Length <= Store->Size);
+
+  Data = Buffer;
+  while (Length > 0) {
+    Index       = (UINTN) DivU64x32Remainder (Offset, RAM_DISK_CHUNK_SIZE, &ChunkOffset);
+    ChunkLength = RamDiskStoreChunkLength (Store, Index);
+    Count       = MIN (Length, ChunkLength - ChunkOffset);
+
+    if (Count == ChunkLength) {
+      Status = RamDiskStoreSaveChunk (Store, Index, Data);
+    } else {
+      //
+      // Merge the data into the current content of the chunk.
+      //
+      Status = RamDiskStoreLoadChunk (Store, Index, Store->Scratch);
+      if (!EFI_ERROR (Status)) {
+        CopyMem (Store->Scratch + ChunkOffset, Data, Count);
+        Status = RamDiskStoreSaveChunk (Store, Index, Store->Scratch);
+      }
+    }
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Data   += Count;
+    Offset += Count;
+    Length -= Count;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,382 @@
+/** @file
+  Unit tests of the store of packed RAM disks of RamDiskDxe.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "../RamDiskImpl.h"
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "RamDiskDxe Store Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// A RAM disk that ends with a partial chunk
+//
+#define STORE_TEST_DISK_SIZE   (5 * RAM_DISK_CHUNK_SIZE + 1234)
+#define STORE_TEST_WRITES      400
+
+typedef enum {
+  StoreTestText,
+  StoreTestRandom,
+  StoreTestMixed
+} STORE_TEST_PATTERN;
+
+STORE_TEST_PATTERN  mStoreTestText   = StoreTestText;
+STORE_TEST_PATTERN  mStoreTestRandom = StoreTestRandom;
+STORE_TEST_PATTERN  mStoreTestMixed  = StoreTestMixed;
+
+UINTN  mStoreTestLengths[] = { 1, 5, 13, 100, 4097, RAM_DISK_CHUNK_SIZE };
+
+UINT32  mStoreTestSeed;
+
+/**
+  Return the next number of a linear congruential generator, so that the
+  test data is the same on every run.
+
+  @return A pseudo-random number.
+**/
+UINT32
+StoreTestNext (
+  VOID
+  )
+{
+  mStoreTestSeed = mStoreTestSeed * 1103515245 + 12345;
+  return mStoreTestSeed >> 8;
+}
+
+/**
+  Fill a buffer with test data.
+
+  Text data repeats words, so it compresses well. Random data doesn't
+  compress. Mixed data alternates runs of text, random bytes and zeros.
+
+  @param[in]  Pattern  The kind of data.
+  @param[out] Buffer   The buffer to fill.
+  @param[in]  Size     The size of the buffer.
+**/
+VOID
+StoreTestFill (
+  IN  STORE_TEST_PATTERN  Pattern,
+  OUT UINT8               *Buffer,
+  IN  UINTN               Size
+  )
+{
+  STATIC CONST CHAR8  *Words[] = { "boot ", "loader ", "kernel ", "initrd ", "EFI ", "disk " };
+  CONST CHAR8         *Word;
+  UINTN               Index;
+  UINTN               Length;
+  UINTN               Run;
+  STORE_TEST_PATTERN  RunPattern;
+
+  Index = 0;
+  while (Index < Size) {
+    RunPattern = Pattern;
+    Run        = Size - Index;
+    if (Pattern == StoreTestMixed) {
+      RunPattern = (STORE_TEST_PATTERN) (StoreTestNext () % 3);
+      Length     = 1 + StoreTestNext () % 3000;
+      Run        = MIN (Run, Length);
+    }
+
+    while (Run > 0) {
+      if (RunPattern == StoreTestText) {
+        for (Word = Words[StoreTestNext () % ARRAY_SIZE (Words)]; (*Word != '\0') && (Run > 0); Word++, Run--) {
+          Buffer[Index++] = *Word;
+        }
+      } else if (RunPattern == StoreTestRandom) {
+        Buffer[Index++] = (UINT8) StoreTestNext ();
+        Run--;
+      } else {
+        Buffer[Index++] = 0;
+        Run--;
+      }
+    }
+  }
+}
+
+/**
+  Compress and decompress data of several lengths, and compare the result
+  with the data.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Lz4RoundTripShouldMatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STORE_TEST_PATTERN  Pattern;
+  UINT8               *Data;
+  UINT8               *Packed;
+  UINT8               *Unpacked;
+  UINT16              *HashTable;
+  UINTN               PackedSize;
+  UINTN               PackedLength;
+  UINTN               Index;
+  UINTN               Length;
+
+  Pattern    = *(STORE_TEST_PATTERN *) Context;
+  PackedSize = RAM_DISK_CHUNK_SIZE + RAM_DISK_CHUNK_SIZE / 255 + 16;
+  Data       = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Packed     = AllocatePool (PackedSize);
+  Unpacked   = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  HashTable  = AllocatePool (RAM_DISK_LZ4_HASH_SIZE * sizeof (UINT16));
+  UT_ASSERT_NOT_NULL (Data);
+  UT_ASSERT_NOT_NULL (Packed);
+  UT_ASSERT_NOT_NULL (Unpacked);
+  UT_ASSERT_NOT_NULL (HashTable);
+
+  mStoreTestSeed = (UINT32) Pattern;
+  for (Index = 0; Index < ARRAY_SIZE (mStoreTestLengths); Index++) {
+    Length = mStoreTestLengths[Index];
+    StoreTestFill (Pattern, Data, Length);
+
+    PackedLength = RamDiskLz4Compress (Data, Length, Packed, PackedSize, HashTable);
+    UT_ASSERT_TRUE (PackedLength != 0);
+    if ((Pattern == StoreTestText) && (Length == RAM_DISK_CHUNK_SIZE)) {
+      UT_ASSERT_TRUE (PackedLength < Length / 2);
+    }
+
+    SetMem (Unpacked, Length, 0xAA);
+    UT_ASSERT_TRUE (RamDiskLz4Decompress (Packed, PackedLength, Unpacked, Length));
+    UT_ASSERT_MEM_EQUAL (Unpacked, Data, Length);
+  }
+
+  FreePool (Data);
+  FreePool (Packed);
+  FreePool (Unpacked);
+  FreePool (HashTable);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Decompress truncated data, and check that it is rejected without writing
+  past the end of the output buffer.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Lz4TruncatedDataShouldFail (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8   *Data;
+  UINT8   *Packed;
+  UINT8   *Unpacked;
+  UINT16  *HashTable;
+  UINTN   PackedLength;
+  UINTN   Truncated;
+
+  Data      = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Packed    = AllocatePool (RAM_DISK_CHUNK_SIZE);
+  Unpacked  = AllocatePool (RAM_DISK_CHUNK_SIZE + 16);
+  HashTable = AllocatePool (RAM_DISK_LZ4_HASH_SIZE * sizeof (UINT16));
+  UT_ASSERT_NOT_NULL (Data);
+  UT_ASSERT_NOT_NULL (Packed);
+  UT_ASSERT_NOT_NULL (Unpacked);
+  UT_ASSERT_NOT_NULL (HashTable);
+
+  mStoreTestSeed = 1;
+  StoreTestFill (StoreTestMixed, Data, RAM_DISK_CHUNK_SIZE);
+  PackedLength = RamDiskLz4Compress (Data, RAM_DISK_CHUNK_SIZE, Packed, RAM_DISK_CHUNK_SIZE, HashTable);
+  UT_ASSERT_TRUE (PackedLength != 0);
+
+  for (Truncated = 0; Truncated < PackedLength; Truncated += 1 + Truncated / 8) {
+    SetMem (Unpacked, RAM_DISK_CHUNK_SIZE + 16, 0x5A);
+    UT_ASSERT_FALSE (RamDiskLz4Decompress (Packed, Truncated, Unpacked, RAM_DISK_CHUNK_SIZE));
+    UT_ASSERT_TRUE (IsZeroBuffer (Unpacked + RAM_DISK_CHUNK_SIZE, 0) || (Unpacked[RAM_DISK_CHUNK_SIZE] == 0x5A));
+  }
+
+  FreePool (Data);
+  FreePool (Packed);
+  FreePool (Unpacked);
+  FreePool (HashTable);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Write data at random offsets of a packed RAM disk, and check that the whole
+  RAM disk and random ranges of it read back as the same writes to a flat
+  buffer.
+
+  @param[in]  Context    [Optional] An optional parameter that enables:
+                         1) test-case reuse with varied parameters and
+                         2) test-case re-entry for Target tests that need a
+                         reboot.  This parameter is a VOID* and it is the
+                         responsibility of the test author to ensure that the
+                         contents are well understood by all test cases that may
+                         consume it.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StoreShouldReadBackWrites (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STORE_TEST_PATTERN  Pattern;
+  RAM_DISK_STORE      *Store;
+  UINT8               *Flat;
+  UINT8               *Data;
+  UINT8               *ReadBack;
+  UINTN               Index;
+  UINTN               Offset;
+  UINTN               Length;
+
+  Pattern  = *(STORE_TEST_PATTERN *) Context;
+  Store    = RamDiskStoreCreate (STORE_TEST_DISK_SIZE);
+  Flat     = AllocateZeroPool (STORE_TEST_DISK_SIZE);
+  Data     = AllocatePool (2 * RAM_DISK_CHUNK_SIZE);
+  ReadBack = AllocatePool (STORE_TEST_DISK_SIZE);
+  UT_ASSERT_NOT_NULL (Store);
+  UT_ASSERT_NOT_NULL (Flat);
+  UT_ASSERT_NOT_NULL (Data);
+  UT_ASSERT_NOT_NULL (ReadBack);
+
+  //
+  // A new RAM disk reads as zeros and takes no memory.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (RamDiskStoreRead (Store, 0, STORE_TEST_DISK_SIZE, ReadBack));
+  UT_ASSERT_TRUE (IsZeroBuffer (ReadBack, STORE_TEST_DISK_SIZE));
+  UT_ASSERT_EQUAL (Store->StoredBytes, 0);
+
+  mStoreTestSeed = 100 + (UINT32) Pattern;
+  for (Index = 0; Index < STORE_TEST_WRITES; Index++) {
+    Offset = StoreTestNext () % STORE_TEST_DISK_SIZE;
+    Length = 1 + StoreTestNext () % (2 * RAM_DISK_CHUNK_SIZE);
+    Length = MIN (Length, STORE_TEST_DISK_SIZE - Offset);
+    StoreTestFill (Pattern, Data, Length);
+    CopyMem (Flat + Offset, Data, Length);
+    UT_ASSERT_NOT_EFI_ERROR (RamDiskStoreWrite (Store, Offset, Length, Data));
+
+    Offset = StoreTestNext () % STORE_TEST_DISK_SIZE;
+    Length = 1 + StoreTestNext () % (2 * RAM_DISK_CHUNK_SIZE);
+    Length = MIN (Length, STORE_TEST_DISK_SIZE - Offset);
+    UT_ASSERT_NOT_EFI_ERROR (RamDiskStoreRead (Store, Offset, Length, ReadBack));
+    UT_ASSERT_MEM_EQUAL (ReadBack, Flat + Offset, Length);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (RamDiskStoreRead (Store, 0, STORE_TEST_DISK_SIZE, ReadBack));
+  UT_ASSERT_MEM_EQUAL (ReadBack, Flat, STORE_TEST_DISK_SIZE);
+  if (Pattern == StoreTestText) {
+    UT_ASSERT_TRUE (Store->StoredBytes < STORE_TEST_DISK_SIZE / 2);
+  }
+
+  //
+  // Chunks that become all zero take no memory again.
+  //
+  ZeroMem (Flat, STORE_TEST_DISK_SIZE);
+  UT_ASSERT_NOT_EFI_ERROR (RamDiskStoreWrite (Store, 0, STORE_TEST_DISK_SIZE, Flat));
+  UT_ASSERT_EQUAL (Store->StoredBytes, 0);
+
+  RamDiskStoreFree (Store);
+  FreePool (Flat);
+  FreePool (Data);
+  FreePool (ReadBack);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialze the unit test framework, suite, and unit tests for the store of
+  packed RAM disks and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      StoreTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the RAM Disk Store Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&StoreTests, Framework, "RamDiskDxe Packed Store Tests", "RamDiskDxe.Store", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for StoreTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (StoreTests, "Text should round-trip through LZ4", "Lz4Text", Lz4RoundTripShouldMatch, NULL, NULL, &mStoreTestText);
+  AddTestCase (StoreTests, "Random data should round-trip through LZ4", "Lz4Random", Lz4RoundTripShouldMatch, NULL, NULL, &mStoreTestRandom);
+  AddTestCase (StoreTests, "Mixed data should round-trip through LZ4", "Lz4Mixed", Lz4RoundTripShouldMatch, NULL, NULL, &mStoreTestMixed);
+  AddTestCase (StoreTests, "Truncated LZ4 data should be rejected", "Lz4Truncated", Lz4TruncatedDataShouldFail, NULL, NULL, NULL);
+  AddTestCase (StoreTests, "Text writes should read back", "StoreText", StoreShouldReadBackWrites, NULL, NULL, &mStoreTestText);
+  AddTestCase (StoreTests, "Random writes should read back", "StoreRandom", StoreShouldReadBackWrites, NULL, NULL, &mStoreTestRandom);
+  AddTestCase (StoreTests, "Mixed writes should read back", "StoreMixed", StoreShouldReadBackWrites, NULL, NULL, &mStoreTestMixed);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -10,6 +10,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "HiiDatabase.h"
 extern HII_DATABASE_PRIVATE_DATA mPrivate;
 
+//
+// Character of a routing key, compared without case: the values in a
+// <ConfigHdr> are hex digits, which callers may send in either case.
+//
+#define CONFIG_ROUTING_CHAR(c)  (((c) >= L'A' && (c) <= L'Z') ? (CHAR16) ((c) - L'A' + L'a') : (c))
+
 /**
   Calculate the number of Unicode characters of the incoming Configuration string,
   not including NULL terminator.
@@ -1599,143 +1605,6 @@ GetFormPackageData (
 }
 
 
-/**
-  This function parses Form Package to get the efi varstore info according to the request ConfigHdr.
-
-  @param  DataBaseRecord        The DataBaseRecord instance contains the found Hii handle and package.
-  @param  ConfigHdr             Request string ConfigHdr. If it is NULL,
-                                the first found varstore will be as ConfigHdr.
-  @param  IsEfiVarstore         Whether the request storage type is efi varstore type.
-  @param  EfiVarStore           The efi varstore info which will return.
-**/
-EFI_STATUS
-GetVarStoreType (
-  IN     HII_DATABASE_RECORD        *DataBaseRecord,
-  IN     EFI_STRING                 ConfigHdr,
-  OUT    BOOLEAN                    *IsEfiVarstore,
-  OUT    EFI_IFR_VARSTORE_EFI       **EfiVarStore
-  )
-{
-  EFI_STATUS               Status;
-  UINTN                    IfrOffset;
-  UINTN                    PackageOffset;
-  EFI_IFR_OP_HEADER        *IfrOpHdr;
-  CHAR16                   *VarStoreName;
-  UINTN                    NameSize;
-  EFI_STRING               GuidStr;
-  EFI_STRING               NameStr;
-  EFI_STRING               TempStr;
-  UINTN                    LengthString;
-  UINT8                    *HiiFormPackage;
-  UINTN                    PackageSize;
-  EFI_IFR_VARSTORE_EFI     *IfrEfiVarStore;
-  EFI_HII_PACKAGE_HEADER   *PackageHeader;
-
-  HiiFormPackage = NULL;
-  LengthString     = 0;
-  Status           = EFI_SUCCESS;
-  GuidStr          = NULL;
-  NameStr          = NULL;
-  TempStr          = NULL;
-  *IsEfiVarstore   = FALSE;
-
-  Status = GetFormPackageData(DataBaseRecord, &HiiFormPackage, &PackageSize);
-  if (EFI_ERROR (Status)) {
-    return Status;
-  }
-
-  IfrOffset     = sizeof (EFI_HII_PACKAGE_HEADER);
-  PackageOffset = IfrOffset;
-  PackageHeader = (EFI_HII_PACKAGE_HEADER *) HiiFormPackage;
-
-  while (IfrOffset < PackageSize) {
-    //
-    // More than one form packages exist.
-    //
-    if (PackageOffset >= PackageHeader->Length) {
-        //
-        // Process the new form package.
-        //
-        PackageOffset = sizeof (EFI_HII_PACKAGE_HEADER);
-        IfrOffset    += PackageOffset;
-        PackageHeader = (EFI_HII_PACKAGE_HEADER *) (HiiFormPackage + IfrOffset);
-    }
-
-    IfrOpHdr  = (EFI_IFR_OP_HEADER *) (HiiFormPackage + IfrOffset);
-    IfrOffset += IfrOpHdr->Length;
-    PackageOffset += IfrOpHdr->Length;
-
-    if (IfrOpHdr->OpCode == EFI_IFR_VARSTORE_EFI_OP ) {
-      IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *) IfrOpHdr;
-      //
-      // If the length is small than the structure, this is from old efi
-      // varstore definition. Old efi varstore get config directly from
-      // GetVariable function.
-      //
-      if (IfrOpHdr->Length < sizeof (EFI_IFR_VARSTORE_EFI)) {
-        continue;
-      }
-
-      NameSize = AsciiStrSize ((CHAR8 *)IfrEfiVarStore->Name);
-      VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
-      if (VarStoreName == NULL) {
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
-      }
-      AsciiStrToUnicodeStrS ((CHAR8 *) IfrEfiVarStore->Name, VarStoreName, NameSize);
-
-      GenerateSubStr (L"GUID=", sizeof (EFI_GUID), (VOID *) &IfrEfiVarStore->Guid, 1, &GuidStr);
-      GenerateSubStr (L"NAME=", StrLen (VarStoreName) * sizeof (CHAR16), (VOID *) VarStoreName, 2, &NameStr);
-      LengthString = StrLen (GuidStr);
-      LengthString = LengthString + StrLen (NameStr) + 1;
-      TempStr = AllocateZeroPool (LengthString * sizeof (CHAR16));
-      if (TempStr == NULL) {
-        FreePool (GuidStr);
-        FreePool (NameStr);
-        FreePool (VarStoreName);
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Done;
-      }
-      StrCpyS (TempStr, LengthString, GuidStr);
-      StrCatS (TempStr, LengthString, NameStr);
-      if (ConfigHdr == NULL || StrnCmp (ConfigHdr, TempStr, StrLen (TempStr)) == 0) {
-        *EfiVarStore = (EFI_IFR_VARSTORE_EFI *) AllocateZeroPool (IfrOpHdr->Length);
-        if (*EfiVarStore == NULL) {
-          FreePool (VarStoreName);
-          FreePool (GuidStr);
-          FreePool (NameStr);
-          FreePool (TempStr);
-          Status = EFI_OUT_OF_RESOURCES;
-          goto Done;
-        }
-        *IsEfiVarstore = TRUE;
-        CopyMem (*EfiVarStore, IfrEfiVarStore, IfrOpHdr->Length);
-      }
-
-      //
-      // Free allocated temp string.
-      //
-      FreePool (VarStoreName);
-      FreePool (GuidStr);
-      FreePool (NameStr);
-      FreePool (TempStr);
-
-      //
-      // Already found the varstore, break;
-      //
-      if (*IsEfiVarstore) {
-        break;
-      }
-    }
-  }
-Done:
-  if (HiiFormPackage != NULL) {
-    FreePool (HiiFormPackage);
-  }
-
-  return Status;
-}
-
 /**
   Check whether the ConfigRequest string has the request elements.
   For EFI_HII_VARSTORE_BUFFER type, the request has "&OFFSET=****&WIDTH=****..." format.
@@ -1835,137 +1704,6 @@ Done:
   return RetVal;
 }
 
-/**
-  This function parses Form Package to get the efi varstore info according to the request ConfigHdr.
-
-  @param  DataBaseRecord        The DataBaseRecord instance contains the found Hii handle and package.
-  @param  ConfigHdr             Request string ConfigHdr. If it is NULL,
-                                the first found varstore will be as ConfigHdr.
-  @retval  TRUE                 This hii package is the request one.
-  @retval  FALSE                This hii package is not the request one.
-**/
-BOOLEAN
-IsThisPackageList (
-  IN     HII_DATABASE_RECORD        *DataBaseRecord,
-  IN     EFI_STRING                 ConfigHdr
-  )
-{
-  EFI_STATUS               Status;
-  UINTN                    IfrOffset;
-  UINTN                    PackageOffset;
-  EFI_IFR_OP_HEADER        *IfrOpHdr;
-  CHAR16                   *VarStoreName;
-  UINTN                    NameSize;
-  UINT8                    *HiiFormPackage;
-  UINTN                    PackageSize;
-  EFI_IFR_VARSTORE_EFI     *IfrEfiVarStore;
-  EFI_HII_PACKAGE_HEADER   *PackageHeader;
-  EFI_IFR_VARSTORE         *IfrVarStore;
-  EFI_IFR_VARSTORE_NAME_VALUE *IfrNameValueVarStore;
-  BOOLEAN                  FindVarstore;
-
-  HiiFormPackage   = NULL;
-  VarStoreName     = NULL;
-  Status           = EFI_SUCCESS;
-  FindVarstore     = FALSE;
-
-  Status = GetFormPackageData(DataBaseRecord, &HiiFormPackage, &PackageSize);
-  if (EFI_ERROR (Status)) {
-    return FALSE;
-  }
-
-  IfrOffset     = sizeof (EFI_HII_PACKAGE_HEADER);
-  PackageOffset = IfrOffset;
-  PackageHeader = (EFI_HII_PACKAGE_HEADER *) HiiFormPackage;
-
-  while (IfrOffset < PackageSize) {
-    //
-    // More than one form packages exist.
-    //
-    if (PackageOffset >= PackageHeader->Length) {
-        //
-        // Process the new form package.
-        //
-        PackageOffset = sizeof (EFI_HII_PACKAGE_HEADER);
-        IfrOffset    += PackageOffset;
-        PackageHeader = (EFI_HII_PACKAGE_HEADER *) (HiiFormPackage + IfrOffset);
-    }
-
-    IfrOpHdr  = (EFI_IFR_OP_HEADER *) (HiiFormPackage + IfrOffset);
-    IfrOffset += IfrOpHdr->Length;
-    PackageOffset += IfrOpHdr->Length;
-
-    switch (IfrOpHdr->OpCode) {
-
-    case EFI_IFR_VARSTORE_OP:
-      IfrVarStore = (EFI_IFR_VARSTORE *) IfrOpHdr;
-
-      NameSize = AsciiStrSize ((CHAR8 *)IfrVarStore->Name);
-      VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
-      if (VarStoreName == NULL) {
-        goto Done;
-      }
-      AsciiStrToUnicodeStrS ((CHAR8 *)IfrVarStore->Name, VarStoreName, NameSize);
-
-      if (IsThisVarstore((VOID *)&IfrVarStore->Guid, VarStoreName, ConfigHdr)) {
-        FindVarstore = TRUE;
-        goto Done;
-      } else {
-        FreePool (VarStoreName);
-        VarStoreName = NULL;
-      }
-      break;
-
-    case EFI_IFR_VARSTORE_EFI_OP:
-      IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *) IfrOpHdr;
-      NameSize = AsciiStrSize ((CHAR8 *)IfrEfiVarStore->Name);
-      VarStoreName = AllocateZeroPool (NameSize * sizeof (CHAR16));
-      if (VarStoreName == NULL) {
-        goto Done;
-      }
-      AsciiStrToUnicodeStrS ((CHAR8 *)IfrEfiVarStore->Name, VarStoreName, NameSize);
-
-      if (IsThisVarstore (&IfrEfiVarStore->Guid, VarStoreName, ConfigHdr)) {
-        FindVarstore = TRUE;
-        goto Done;
-      } else {
-        FreePool (VarStoreName);
-        VarStoreName = NULL;
-      }
-      break;
-
-    case EFI_IFR_VARSTORE_NAME_VALUE_OP:
-      IfrNameValueVarStore = (EFI_IFR_VARSTORE_NAME_VALUE *) IfrOpHdr;
-
-      if (IsThisVarstore (&IfrNameValueVarStore->Guid, NULL, ConfigHdr)) {
-        FindVarstore = TRUE;
-        goto Done;
-      }
-      break;
-
-    case EFI_IFR_FORM_OP:
-    case EFI_IFR_FORM_MAP_OP:
-      //
-      // No matched varstore is found and directly return.
-      //
-      goto Done;
-
-    default:
-      break;
-    }
-  }
-Done:
-  if (HiiFormPackage != NULL) {
-    FreePool (HiiFormPackage);
-  }
-
-  if (VarStoreName != NULL) {
-    FreePool (VarStoreName);
-  }
-
-  return FindVarstore;
-}
-
 /**
   Check whether the this op code is required.
 
@@ -3795,6 +3533,10 @@ UpdateBlockDataArray (
 /**
   Generate ConfigAltResp string base on the varstore info.
 
+  VarStorageData is not modified, so the parsed IFR data kept in the routing
+  index can be used for any number of requests. The default values of bit
+  field questions have already been converted by ParseFormPackageData ().
+
   @param      HiiHandle             Hii Handle for this hii package.
   @param      ConfigHdr             The config header for this varstore.
   @param      VarStorageData        The varstore info.
@@ -3836,8 +3578,6 @@ GenerateAltConfigResp (
   //
   Length = StrLen (ConfigHdr) + 1;
 
-  UpdateBlockDataArray (&VarStorageData->BlockEntry);
-
   for (Link = DefaultIdArray->Entry.ForwardLink; Link != &DefaultIdArray->Entry; Link = Link->ForwardLink) {
     DefaultId = BASE_CR (Link, IFR_DEFAULT_DATA, Entry);
     //
@@ -3986,67 +3726,748 @@ GenerateAltConfigResp (
 }
 
 /**
-  This function gets the full request string and full default value string by
-  parsing IFR data in HII form packages.
+  Free the block and default value lists that ParseIfrData () built.
 
-  When Request points to NULL string, the request string and default value string
-  for each varstore in form package will return.
-
-  @param  DataBaseRecord         The DataBaseRecord instance contains the found Hii handle and package.
-  @param  DevicePath             Device Path which Hii Config Access Protocol is registered.
-  @param  Request                Pointer to a null-terminated Unicode string in
-                                 <ConfigRequest> format. When it doesn't contain
-                                 any RequestElement, it will be updated to return
-                                 the full RequestElement retrieved from IFR data.
-                                 If it points to NULL, the request string for the first
-                                 varstore in form package will be merged into a
-                                 <MultiConfigRequest> format string and return.
-  @param  AltCfgResp             Pointer to a null-terminated Unicode string in
-                                 <ConfigAltResp> format. When the pointer is to NULL,
-                                 the full default value string retrieved from IFR data
-                                 will return. When the pinter is to a string, the
-                                 full default value string retrieved from IFR data
-                                 will be merged into the input string and return.
-                                 When Request points to NULL, the default value string
-                                 for each varstore in form package will be merged into
-                                 a <MultiConfigAltResp> format string and return.
-  @param  PointerProgress        Optional parameter, it can be NULL.
-                                 When it is not NULL, if Request is NULL, it returns NULL.
-                                 On return, points to a character in the Request
-                                 string. Points to the string's null terminator if
-                                 request was successful. Points to the most recent
-                                 & before the first failing name / value pair (or
-                                 the beginning of the string if the failure is in
-                                 the first name / value pair) if the request was
-                                 not successful.
-  @retval EFI_SUCCESS            The Results string is set to the full request string.
-                                 And AltCfgResp contains all default value string.
-  @retval EFI_OUT_OF_RESOURCES   Not enough memory for the return string.
-  @retval EFI_NOT_FOUND          The varstore (Guid and Name) in Request string
-                                 can't be found in Form package.
-  @retval EFI_NOT_FOUND          HiiPackage can't be got on the input HiiHandle.
-  @retval EFI_INVALID_PARAMETER  Request points to NULL.
+  @param  VarStorageData         The varstore data structure, or NULL.
+  @param  DefaultIdArray         The DefaultId array, or NULL.
 
 **/
-EFI_STATUS
-EFIAPI
-GetFullStringFromHiiFormPackages (
-  IN     HII_DATABASE_RECORD        *DataBaseRecord,
-  IN     EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
-  IN OUT EFI_STRING                 *Request,
-  IN OUT EFI_STRING                 *AltCfgResp,
-  OUT    EFI_STRING                 *PointerProgress OPTIONAL
+VOID
+FreeIfrVarStorageData (
+  IN IFR_VARSTORAGE_DATA      *VarStorageData,
+  IN IFR_DEFAULT_DATA         *DefaultIdArray
   )
 {
-  EFI_STATUS                   Status;
-  UINT8                        *HiiFormPackage;
-  UINTN                        PackageSize;
-  IFR_BLOCK_DATA               *RequestBlockArray;
   IFR_BLOCK_DATA               *BlockData;
   IFR_DEFAULT_DATA             *DefaultValueData;
   IFR_DEFAULT_DATA             *DefaultId;
+
+  if (VarStorageData != NULL) {
+    //
+    // Free link array VarStorageData
+    //
+    while (!IsListEmpty (&VarStorageData->BlockEntry)) {
+      BlockData = BASE_CR (VarStorageData->BlockEntry.ForwardLink, IFR_BLOCK_DATA, Entry);
+      RemoveEntryList (&BlockData->Entry);
+      if (BlockData->Name != NULL) {
+        FreePool (BlockData->Name);
+      }
+      //
+      // Free default value link array
+      //
+      while (!IsListEmpty (&BlockData->DefaultValueEntry)) {
+        DefaultValueData = BASE_CR (BlockData->DefaultValueEntry.ForwardLink, IFR_DEFAULT_DATA, Entry);
+        RemoveEntryList (&DefaultValueData->Entry);
+        FreePool (DefaultValueData);
+      }
+      FreePool (BlockData);
+    }
+    if (VarStorageData ->Name != NULL) {
+      FreePool (VarStorageData ->Name);
+      VarStorageData ->Name = NULL;
+    }
+    FreePool (VarStorageData);
+  }
+
+  if (DefaultIdArray != NULL) {
+    //
+    // Free DefaultId Array
+    //
+    while (!IsListEmpty (&DefaultIdArray->Entry)) {
+      DefaultId = BASE_CR (DefaultIdArray->Entry.ForwardLink, IFR_DEFAULT_DATA, Entry);
+      RemoveEntryList (&DefaultId->Entry);
+      FreePool (DefaultId);
+    }
+    FreePool (DefaultIdArray);
+  }
+}
+
+/**
+  Parse the form packages of a package list to get the block array and
+  default value of the requested varstore.
+
+  The default values of bit field questions are converted to values of the
+  blocks that hold them, once, so GenerateAltConfigResp () only reads the
+  result.
+
+  @param  DataBaseRecord         The package list.
+  @param  ConfigHdr              The request, or NULL for the first varstore.
+  @param  RequestBlockArray      The elements of the request, or NULL for every
+                                 question of the varstore.
+  @param  VarStorageData         Returns the question offsets of the varstore.
+  @param  DefaultIdArray         Returns the default stores of the varstore.
+
+  @retval EFI_SUCCESS            The IFR data is parsed.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory.
+  @retval Others                 The form package can't be got or parsed.
+
+**/
+EFI_STATUS
+ParseFormPackageData (
+  IN  HII_DATABASE_RECORD      *DataBaseRecord,
+  IN  EFI_STRING               ConfigHdr,
+  IN  IFR_BLOCK_DATA           *RequestBlockArray,
+  OUT IFR_VARSTORAGE_DATA      **VarStorageData,
+  OUT IFR_DEFAULT_DATA         **DefaultIdArray
+  )
+{
+  EFI_STATUS                   Status;
+  UINT8                        *HiiFormPackage;
+  UINTN                        PackageSize;
+
+  *DefaultIdArray = NULL;
+  HiiFormPackage  = NULL;
+
+  *VarStorageData = (IFR_VARSTORAGE_DATA *) AllocateZeroPool (sizeof (IFR_VARSTORAGE_DATA));
+  if (*VarStorageData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  InitializeListHead (&(*VarStorageData)->Entry);
+  InitializeListHead (&(*VarStorageData)->BlockEntry);
+
+  *DefaultIdArray = (IFR_DEFAULT_DATA *) AllocateZeroPool (sizeof (IFR_DEFAULT_DATA));
+  if (*DefaultIdArray == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+  InitializeListHead (&(*DefaultIdArray)->Entry);
+
+  Status = GetFormPackageData (DataBaseRecord, &HiiFormPackage, &PackageSize);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  Status = ParseIfrData (
+             DataBaseRecord->Handle,
+             HiiFormPackage,
+             (UINT32) PackageSize,
+             ConfigHdr,
+             RequestBlockArray,
+             *VarStorageData,
+             *DefaultIdArray
+             );
+  FreePool (HiiFormPackage);
+  if (!EFI_ERROR (Status)) {
+    UpdateBlockDataArray (&(*VarStorageData)->BlockEntry);
+  }
+
+Done:
+  if (EFI_ERROR (Status)) {
+    FreeIfrVarStorageData (*VarStorageData, *DefaultIdArray);
+    *VarStorageData = NULL;
+    *DefaultIdArray = NULL;
+  }
+
+  return Status;
+}
+
+/**
+  Free a routing tree.
+
+  @param  Node                   The root of the tree, or NULL.
+
+**/
+VOID
+FreeConfigRoutingTree (
+  IN HII_CONFIG_ROUTING_NODE  *Node
+  )
+{
+  HII_CONFIG_ROUTING_NODE  *Sibling;
+
+  while (Node != NULL) {
+    FreeConfigRoutingTree (Node->Child);
+    Sibling = Node->Sibling;
+    FreePool (Node);
+    Node = Sibling;
+  }
+}
+
+/**
+  Free the routing index of a package list and the routing tree of the
+  database. Must be called whenever packages are added to or removed from
+  the package list, and before the package list itself is freed.
+
+  @param  Private                 Hii database private structure.
+  @param  DatabaseRecord          The package list whose packages change.
+
+**/
+VOID
+InvalidateConfigRoutingIndex (
+  IN OUT HII_DATABASE_PRIVATE_DATA   *Private,
+  IN OUT HII_DATABASE_RECORD         *DatabaseRecord
+  )
+{
+  HII_CONFIG_VARSTORE  *VarStore;
+
+  //
+  // The labels of the tree point into the strings freed below.
+  //
+  FreeConfigRoutingTree (Private->ConfigRoutingTree);
+  Private->ConfigRoutingTree = NULL;
+
+  while (!IsListEmpty (&DatabaseRecord->ConfigVarStoreList)) {
+    VarStore = CR (
+                 DatabaseRecord->ConfigVarStoreList.ForwardLink,
+                 HII_CONFIG_VARSTORE,
+                 Entry,
+                 HII_CONFIG_VARSTORE_SIGNATURE
+                 );
+    RemoveEntryList (&VarStore->Entry);
+    FreeIfrVarStorageData (VarStore->VarStorageData, VarStore->DefaultIdArray);
+    if (VarStore->EfiVarStore != NULL) {
+      FreePool (VarStore->EfiVarStore);
+    }
+    FreePool (VarStore->ConfigHdr);
+    FreePool (VarStore);
+  }
+
+  if (DatabaseRecord->ConfigPathHdr != NULL) {
+    FreePool (DatabaseRecord->ConfigPathHdr);
+    DatabaseRecord->ConfigPathHdr = NULL;
+  }
+
+  DatabaseRecord->ConfigIndexValid = FALSE;
+}
+
+/**
+  Add a varstore to the routing index of a package list.
+
+  @param  DataBaseRecord         The package list.
+  @param  DevicePath             The device path of the package list.
+  @param  Type                   The varstore type.
+  @param  Guid                   The varstore GUID.
+  @param  AsciiName              The varstore name, or NULL for a name/value
+                                 varstore.
+  @param  IfrEfiVarStore         The EFI varstore opcode, or NULL.
+
+  @retval EFI_SUCCESS            The varstore is added.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory.
+
+**/
+EFI_STATUS
+AddConfigVarStore (
+  IN HII_DATABASE_RECORD       *DataBaseRecord,
+  IN EFI_DEVICE_PATH_PROTOCOL  *DevicePath,
+  IN UINT8                     Type,
+  IN EFI_GUID                  *Guid,
+  IN CHAR8                     *AsciiName,
+  IN EFI_IFR_VARSTORE_EFI      *IfrEfiVarStore
+  )
+{
+  EFI_STATUS           Status;
+  HII_CONFIG_VARSTORE  *VarStore;
+  IFR_VARSTORAGE_DATA  VarStorageData;
+  UINTN                NameSize;
+
+  ZeroMem (&VarStorageData, sizeof (VarStorageData));
+  CopyGuid (&VarStorageData.Guid, Guid);
+  if (AsciiName != NULL) {
+    NameSize = AsciiStrSize (AsciiName);
+    VarStorageData.Name = AllocateZeroPool (NameSize * sizeof (CHAR16));
+    if (VarStorageData.Name == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    AsciiStrToUnicodeStrS (AsciiName, VarStorageData.Name, NameSize);
+  }
+
+  VarStore = AllocateZeroPool (sizeof (HII_CONFIG_VARSTORE));
+  if (VarStore == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+  VarStore->Signature = HII_CONFIG_VARSTORE_SIGNATURE;
+  VarStore->Database  = DataBaseRecord;
+  VarStore->Type      = Type;
+
+  if (IfrEfiVarStore != NULL) {
+    VarStore->EfiVarStore = AllocateCopyPool (IfrEfiVarStore->Header.Length, IfrEfiVarStore);
+    if (VarStore->EfiVarStore == NULL) {
+      FreePool (VarStore);
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Done;
+    }
+  }
+
+  Status = GenerateHdr (&VarStorageData, DevicePath, &VarStore->ConfigHdr);
+  if (EFI_ERROR (Status)) {
+    if (VarStore->EfiVarStore != NULL) {
+      FreePool (VarStore->EfiVarStore);
+    }
+    FreePool (VarStore);
+    goto Done;
+  }
+
+  InsertTailList (&DataBaseRecord->ConfigVarStoreList, &VarStore->Entry);
+
+Done:
+  if (VarStorageData.Name != NULL) {
+    FreePool (VarStorageData.Name);
+  }
+
+  return Status;
+}
+
+/**
+  Build the routing index of a package list: the PATH=... of its device path
+  package, and the <ConfigHdr> of every varstore declared before the first
+  form. Varstores declared after a form are not routed by their header.
+
+  @param  DataBaseRecord         The package list.
+
+  @retval EFI_SUCCESS            The index is built. A package list without
+                                 device path package has an empty index.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory.
+
+**/
+EFI_STATUS
+BuildConfigRoutingIndex (
+  IN HII_DATABASE_RECORD        *DataBaseRecord
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_DEVICE_PATH_PROTOCOL    *DevicePath;
+  UINTN                       IfrOffset;
+  UINTN                       PackageOffset;
+  EFI_IFR_OP_HEADER           *IfrOpHdr;
+  UINT8                       *HiiFormPackage;
+  UINTN                       PackageSize;
+  EFI_HII_PACKAGE_HEADER      *PackageHeader;
+  EFI_IFR_VARSTORE            *IfrVarStore;
+  EFI_IFR_VARSTORE_EFI        *IfrEfiVarStore;
+  EFI_IFR_VARSTORE_NAME_VALUE *IfrNameValueVarStore;
+  BOOLEAN                     FormFound;
+
+  if (DataBaseRecord->ConfigIndexValid) {
+    return EFI_SUCCESS;
+  }
+
+  if (DataBaseRecord->PackageList->DevicePathPkg == NULL) {
+    DataBaseRecord->ConfigIndexValid = TRUE;
+    return EFI_SUCCESS;
+  }
+
+  DevicePath = (EFI_DEVICE_PATH_PROTOCOL *) (DataBaseRecord->PackageList->DevicePathPkg + sizeof (EFI_HII_PACKAGE_HEADER));
+  GenerateSubStr (L"PATH=", GetDevicePathSize (DevicePath), (VOID *) DevicePath, 1, &DataBaseRecord->ConfigPathHdr);
+  //
+  // Remove the last character L'&'
+  //
+  *(DataBaseRecord->ConfigPathHdr + StrLen (DataBaseRecord->ConfigPathHdr) - 1) = L'\0';
+
+  if (IsListEmpty (&DataBaseRecord->PackageList->FormPkgHdr)) {
+    DataBaseRecord->ConfigIndexValid = TRUE;
+    return EFI_SUCCESS;
+  }
+
+  HiiFormPackage = NULL;
+  Status = GetFormPackageData (DataBaseRecord, &HiiFormPackage, &PackageSize);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  IfrOffset     = sizeof (EFI_HII_PACKAGE_HEADER);
+  PackageOffset = IfrOffset;
+  PackageHeader = (EFI_HII_PACKAGE_HEADER *) HiiFormPackage;
+  FormFound     = FALSE;
+
+  while (IfrOffset < PackageSize && !FormFound && !EFI_ERROR (Status)) {
+    //
+    // More than one form packages exist.
+    //
+    if (PackageOffset >= PackageHeader->Length) {
+        //
+        // Process the new form package.
+        //
+        PackageOffset = sizeof (EFI_HII_PACKAGE_HEADER);
+        IfrOffset    += PackageOffset;
+        PackageHeader = (EFI_HII_PACKAGE_HEADER *) (HiiFormPackage + IfrOffset);
+    }
+
+    IfrOpHdr  = (EFI_IFR_OP_HEADER *) (HiiFormPackage + IfrOffset);
+    IfrOffset += IfrOpHdr->Length;
+    PackageOffset += IfrOpHdr->Length;
+
+    switch (IfrOpHdr->OpCode) {
+
+    case EFI_IFR_VARSTORE_OP:
+      IfrVarStore = (EFI_IFR_VARSTORE *) IfrOpHdr;
+      Status = AddConfigVarStore (
+                 DataBaseRecord,
+                 DevicePath,
+                 EFI_HII_VARSTORE_BUFFER,
+                 &IfrVarStore->Guid,
+                 (CHAR8 *) IfrVarStore->Name,
+                 NULL
+                 );
+      break;
+
+    case EFI_IFR_VARSTORE_EFI_OP:
+      //
+      // An EFI varstore shorter than the structure is from the old
+      // definition, which has no name to route by.
+      //
+      IfrEfiVarStore = (EFI_IFR_VARSTORE_EFI *) IfrOpHdr;
+      if (IfrOpHdr->Length >= sizeof (EFI_IFR_VARSTORE_EFI)) {
+        Status = AddConfigVarStore (
+                   DataBaseRecord,
+                   DevicePath,
+                   EFI_HII_VARSTORE_EFI_VARIABLE_BUFFER,
+                   &IfrEfiVarStore->Guid,
+                   (CHAR8 *) IfrEfiVarStore->Name,
+                   IfrEfiVarStore
+                   );
+      }
+      break;
+
+    case EFI_IFR_VARSTORE_NAME_VALUE_OP:
+      IfrNameValueVarStore = (EFI_IFR_VARSTORE_NAME_VALUE *) IfrOpHdr;
+      Status = AddConfigVarStore (
+                 DataBaseRecord,
+                 DevicePath,
+                 EFI_HII_VARSTORE_NAME_VALUE,
+                 &IfrNameValueVarStore->Guid,
+                 NULL,
+                 NULL
+                 );
+      break;
+
+    case EFI_IFR_FORM_OP:
+    case EFI_IFR_FORM_MAP_OP:
+      FormFound = TRUE;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  FreePool (HiiFormPackage);
+
+  if (EFI_ERROR (Status)) {
+    InvalidateConfigRoutingIndex (&mPrivate, DataBaseRecord);
+    return Status;
+  }
+
+  DataBaseRecord->ConfigIndexValid = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Insert a key into the routing tree. If the key is already in the tree, the
+  first package list that was inserted keeps it, as the linear search over
+  the database list used to find that one first.
+
+  @param  Root                   The root of the routing tree.
+  @param  Key                    The key, which must stay allocated while it
+                                 is in the tree.
+  @param  Database               The package list the key routes to.
+  @param  VarStore               The varstore the key routes to, or NULL.
+
+  @retval EFI_SUCCESS            The key is inserted.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory.
+
+**/
+EFI_STATUS
+InsertConfigRoutingKey (
+  IN HII_CONFIG_ROUTING_NODE  *Root,
+  IN CONST CHAR16             *Key,
+  IN HII_DATABASE_RECORD      *Database,
+  IN HII_CONFIG_VARSTORE      *VarStore
+  )
+{
+  HII_CONFIG_ROUTING_NODE  *Node;
+  HII_CONFIG_ROUTING_NODE  **Link;
+  HII_CONFIG_ROUTING_NODE  *Child;
+  HII_CONFIG_ROUTING_NODE  *Split;
+  UINTN                    Match;
+
+  Node = Root;
+  while (*Key != L'\0') {
+    //
+    // Find the edge that starts with the next character of the key.
+    //
+    for (Link = &Node->Child; *Link != NULL; Link = &(*Link)->Sibling) {
+      if (CONFIG_ROUTING_CHAR ((*Link)->Label[0]) == CONFIG_ROUTING_CHAR (*Key)) {
+        break;
+      }
+    }
+
+    Child = *Link;
+    if (Child == NULL) {
+      //
+      // The rest of the key becomes a new leaf.
+      //
+      Child = AllocateZeroPool (sizeof (HII_CONFIG_ROUTING_NODE));
+      if (Child == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+      Child->Label       = Key;
+      Child->LabelLength = StrLen (Key);
+      Child->Sibling     = Node->Child;
+      Node->Child        = Child;
+      Node               = Child;
+      break;
+    }
+
+    for (Match = 1; Match < Child->LabelLength && Key[Match] != L'\0'; Match++) {
+      if (CONFIG_ROUTING_CHAR (Child->Label[Match]) != CONFIG_ROUTING_CHAR (Key[Match])) {
+        break;
+      }
+    }
+
+    if (Match < Child->LabelLength) {
+      //
+      // The key leaves the edge in the middle, so split it.
+      //
+      Split = AllocateZeroPool (sizeof (HII_CONFIG_ROUTING_NODE));
+      if (Split == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+      Split->Label        = Child->Label;
+      Split->LabelLength  = Match;
+      Split->Child        = Child;
+      Split->Sibling      = Child->Sibling;
+      Child->Label       += Match;
+      Child->LabelLength -= Match;
+      Child->Sibling      = NULL;
+      *Link               = Split;
+      Child               = Split;
+    }
+
+    Node = Child;
+    Key += Match;
+  }
+
+  if (Node->Database == NULL) {
+    Node->Database = Database;
+    Node->VarStore = VarStore;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the routing tree of the database, and build it first if a package list
+  changed since the last routing call.
+
+  @param  Private                Hii database private structure.
+
+  @return The root of the routing tree, or NULL if there is not enough memory.
+
+**/
+HII_CONFIG_ROUTING_NODE *
+GetConfigRoutingTree (
+  IN HII_DATABASE_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS               Status;
+  HII_CONFIG_ROUTING_NODE  *Root;
+  LIST_ENTRY               *Link;
+  LIST_ENTRY               *VarStoreLink;
+  HII_DATABASE_RECORD      *Database;
+  HII_CONFIG_VARSTORE      *VarStore;
+
+  if (Private->ConfigRoutingTree != NULL) {
+    return Private->ConfigRoutingTree;
+  }
+
+  Root = AllocateZeroPool (sizeof (HII_CONFIG_ROUTING_NODE));
+  if (Root == NULL) {
+    return NULL;
+  }
+
+  Status = EFI_SUCCESS;
+  for (Link = Private->DatabaseList.ForwardLink;
+       Link != &Private->DatabaseList && !EFI_ERROR (Status);
+       Link = Link->ForwardLink
+      ) {
+    Database = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
+    Status = BuildConfigRoutingIndex (Database);
+    if (EFI_ERROR (Status) || Database->ConfigPathHdr == NULL) {
+      continue;
+    }
+
+    Status = InsertConfigRoutingKey (Root, Database->ConfigPathHdr, Database, NULL);
+    for (VarStoreLink = Database->ConfigVarStoreList.ForwardLink;
+         VarStoreLink != &Database->ConfigVarStoreList && !EFI_ERROR (Status);
+         VarStoreLink = VarStoreLink->ForwardLink
+        ) {
+      VarStore = CR (VarStoreLink, HII_CONFIG_VARSTORE, Entry, HII_CONFIG_VARSTORE_SIGNATURE);
+      Status = InsertConfigRoutingKey (Root, VarStore->ConfigHdr, Database, VarStore);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreeConfigRoutingTree (Root);
+    return NULL;
+  }
+
+  Private->ConfigRoutingTree = Root;
+  return Root;
+}
+
+/**
+  Find the key in the routing tree that the string starts with, followed by
+  '&' or the end of the string. Hex digits match in either case.
+
+  @param  Private                Hii database private structure.
+  @param  String                 A <ConfigHdr>, or a PATH=... string.
+
+  @return The node where the key ends, or NULL if there is none.
+
+**/
+HII_CONFIG_ROUTING_NODE *
+LookupConfigRoutingKey (
+  IN HII_DATABASE_PRIVATE_DATA  *Private,
+  IN CONST CHAR16               *String
+  )
+{
+  HII_CONFIG_ROUTING_NODE  *Node;
+  UINTN                    Index;
+
+  Node = GetConfigRoutingTree (Private);
+  while (Node != NULL) {
+    if (Node->Database != NULL && (*String == L'&' || *String == L'\0')) {
+      return Node;
+    }
+
+    for (Node = Node->Child; Node != NULL; Node = Node->Sibling) {
+      if (CONFIG_ROUTING_CHAR (Node->Label[0]) == CONFIG_ROUTING_CHAR (*String)) {
+        break;
+      }
+    }
+    if (Node == NULL) {
+      break;
+    }
+
+    for (Index = 1; Index < Node->LabelLength; Index++) {
+      if (CONFIG_ROUTING_CHAR (Node->Label[Index]) != CONFIG_ROUTING_CHAR (String[Index])) {
+        return NULL;
+      }
+    }
+    String += Node->LabelLength;
+  }
+
+  return NULL;
+}
+
+/**
+  Find the varstore that a <ConfigRequest> or <ConfigResp> is routed to.
+
+  @param  Private                Hii database private structure.
+  @param  ConfigHdr              A string that starts with a <ConfigHdr>.
+
+  @return The varstore, or NULL if no package list declares it on the device
+          path of the request.
+
+**/
+HII_CONFIG_VARSTORE *
+FindConfigVarStore (
+  IN HII_DATABASE_PRIVATE_DATA  *Private,
+  IN CONST CHAR16               *ConfigHdr
+  )
+{
+  HII_CONFIG_ROUTING_NODE  *Node;
+
+  Node = LookupConfigRoutingKey (Private, ConfigHdr);
+  if (Node == NULL) {
+    return NULL;
+  }
+
+  return Node->VarStore;
+}
+
+/**
+  Get the EFI varstore that a <ConfigRequest> or <ConfigResp> is routed to.
+  Requests to other varstores go to the Config Access Protocol of the driver.
+
+  @param  VarStore              The varstore of the request, or NULL.
+  @param  IsEfiVarstore         Whether the request storage type is efi varstore type.
+  @param  EfiVarStore           The efi varstore info which will return.
+
+  @retval EFI_SUCCESS            The varstore type is returned.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory.
+
+**/
+EFI_STATUS
+GetConfigVarStoreType (
+  IN  HII_CONFIG_VARSTORE      *VarStore,
+  OUT BOOLEAN                  *IsEfiVarstore,
+  OUT EFI_IFR_VARSTORE_EFI     **EfiVarStore
+  )
+{
+  *IsEfiVarstore = FALSE;
+  if (VarStore == NULL || VarStore->EfiVarStore == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  *EfiVarStore = AllocateCopyPool (VarStore->EfiVarStore->Header.Length, VarStore->EfiVarStore);
+  if (*EfiVarStore == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *IsEfiVarstore = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  This function gets the full request string and full default value string by
+  parsing IFR data in HII form packages.
+
+  When Request points to NULL string, the request string and default value string
+  for each varstore in form package will return.
+
+  @param  DataBaseRecord         The DataBaseRecord instance contains the found Hii handle and package.
+  @param  DevicePath             Device Path which Hii Config Access Protocol is registered.
+  @param  Request                Pointer to a null-terminated Unicode string in
+                                 <ConfigRequest> format. When it doesn't contain
+                                 any RequestElement, it will be updated to return
+                                 the full RequestElement retrieved from IFR data.
+                                 If it points to NULL, the request string for the first
+                                 varstore in form package will be merged into a
+                                 <MultiConfigRequest> format string and return.
+  @param  AltCfgResp             Pointer to a null-terminated Unicode string in
+                                 <ConfigAltResp> format. When the pointer is to NULL,
+                                 the full default value string retrieved from IFR data
+                                 will return. When the pinter is to a string, the
+                                 full default value string retrieved from IFR data
+                                 will be merged into the input string and return.
+                                 When Request points to NULL, the default value string
+                                 for each varstore in form package will be merged into
+                                 a <MultiConfigAltResp> format string and return.
+  @param  PointerProgress        Optional parameter, it can be NULL.
+                                 When it is not NULL, if Request is NULL, it returns NULL.
+                                 On return, points to a character in the Request
+                                 string. Points to the string's null terminator if
+                                 request was successful. Points to the most recent
+                                 & before the first failing name / value pair (or
+                                 the beginning of the string if the failure is in
+                                 the first name / value pair) if the request was
+                                 not successful.
+  @retval EFI_SUCCESS            The Results string is set to the full request string.
+                                 And AltCfgResp contains all default value string.
+  @retval EFI_OUT_OF_RESOURCES   Not enough memory for the return string.
+  @retval EFI_NOT_FOUND          The varstore (Guid and Name) in Request string
+                                 can't be found in Form package.
+  @retval EFI_NOT_FOUND          HiiPackage can't be got on the input HiiHandle.
+  @retval EFI_INVALID_PARAMETER  Request points to NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+GetFullStringFromHiiFormPackages (
+  IN     HII_DATABASE_RECORD        *DataBaseRecord,
+  IN     EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+  IN OUT EFI_STRING                 *Request,
+  IN OUT EFI_STRING                 *AltCfgResp,
+  OUT    EFI_STRING                 *PointerProgress OPTIONAL
+  )
+{
+  EFI_STATUS                   Status;
+  IFR_BLOCK_DATA               *RequestBlockArray;
+  IFR_BLOCK_DATA               *BlockData;
   IFR_DEFAULT_DATA             *DefaultIdArray;
   IFR_VARSTORAGE_DATA          *VarStorageData;
+  HII_CONFIG_VARSTORE          *VarStore;
   EFI_STRING                   DefaultAltCfgResp;
   EFI_STRING                   ConfigHdr;
   EFI_STRING                   StringPtr;
@@ -4062,17 +4483,11 @@ GetFullStringFromHiiFormPackages (
   RequestBlockArray = NULL;
   DefaultIdArray    = NULL;
   VarStorageData    = NULL;
+  VarStore          = NULL;
   DefaultAltCfgResp = NULL;
   ConfigHdr         = NULL;
-  HiiFormPackage    = NULL;
-  PackageSize       = 0;
   Progress          = *Request;
 
-  Status = GetFormPackageData (DataBaseRecord, &HiiFormPackage, &PackageSize);
-  if (EFI_ERROR (Status)) {
-    goto Done;
-  }
-
   //
   // 1. Get the request block array by Request String when Request string contains the block array.
   //
@@ -4132,42 +4547,33 @@ GetFullStringFromHiiFormPackages (
   }
 
   //
-  // Initialize DefaultIdArray to store the map between DeaultId and DefaultName
-  //
-  DefaultIdArray   = (IFR_DEFAULT_DATA *) AllocateZeroPool (sizeof (IFR_DEFAULT_DATA));
-  if (DefaultIdArray == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Done;
-  }
-  InitializeListHead (&DefaultIdArray->Entry);
-
-  //
-  // Initialize VarStorageData to store the var store Block and Default value information.
+  // A request for a whole varstore other than name/value is answered from
+  // the question offsets and defaults parsed on the first such request.
   //
-  VarStorageData = (IFR_VARSTORAGE_DATA *) AllocateZeroPool (sizeof (IFR_VARSTORAGE_DATA));
-  if (VarStorageData == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-    goto Done;
+  if (RequestBlockArray == NULL && *Request != NULL) {
+    VarStore = FindConfigVarStore (&mPrivate, *Request);
+    if (VarStore != NULL && (VarStore->Database != DataBaseRecord || VarStore->Type == EFI_HII_VARSTORE_NAME_VALUE)) {
+      VarStore = NULL;
+    }
   }
-  InitializeListHead (&VarStorageData->Entry);
-  InitializeListHead (&VarStorageData->BlockEntry);
-
-  //
-  // 2. Parse FormPackage to get BlockArray and DefaultId Array for the request BlockArray.
-  //
 
-  //
-  // Parse the opcode in form package to get the default setting.
-  //
-  Status = ParseIfrData (DataBaseRecord->Handle,
-                         HiiFormPackage,
-                         (UINT32) PackageSize,
-                         *Request,
-                         RequestBlockArray,
-                         VarStorageData,
-                         DefaultIdArray);
-  if (EFI_ERROR (Status)) {
-    goto Done;
+  if (VarStore != NULL) {
+    if (VarStore->VarStorageData == NULL) {
+      Status = ParseFormPackageData (DataBaseRecord, VarStore->ConfigHdr, NULL, &VarStore->VarStorageData, &VarStore->DefaultIdArray);
+      if (EFI_ERROR (Status)) {
+        goto Done;
+      }
+    }
+    VarStorageData = VarStore->VarStorageData;
+    DefaultIdArray = VarStore->DefaultIdArray;
+  } else {
+    //
+    // 2. Parse FormPackage to get BlockArray and DefaultId Array for the request BlockArray.
+    //
+    Status = ParseFormPackageData (DataBaseRecord, *Request, RequestBlockArray, &VarStorageData, &DefaultIdArray);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
   }
 
   //
@@ -4229,43 +4635,11 @@ Done:
     FreePool (RequestBlockArray);
   }
 
-  if (VarStorageData != NULL) {
-    //
-    // Free link array VarStorageData
-    //
-    while (!IsListEmpty (&VarStorageData->BlockEntry)) {
-      BlockData = BASE_CR (VarStorageData->BlockEntry.ForwardLink, IFR_BLOCK_DATA, Entry);
-      RemoveEntryList (&BlockData->Entry);
-      if (BlockData->Name != NULL) {
-        FreePool (BlockData->Name);
-      }
-      //
-      // Free default value link array
-      //
-      while (!IsListEmpty (&BlockData->DefaultValueEntry)) {
-        DefaultValueData = BASE_CR (BlockData->DefaultValueEntry.ForwardLink, IFR_DEFAULT_DATA, Entry);
-        RemoveEntryList (&DefaultValueData->Entry);
-        FreePool (DefaultValueData);
-      }
-      FreePool (BlockData);
-    }
-    if (VarStorageData ->Name != NULL) {
-      FreePool (VarStorageData ->Name);
-      VarStorageData ->Name = NULL;
-    }
-    FreePool (VarStorageData);
-  }
-
-  if (DefaultIdArray != NULL) {
-    //
-    // Free DefaultId Array
-    //
-    while (!IsListEmpty (&DefaultIdArray->Entry)) {
-      DefaultId = BASE_CR (DefaultIdArray->Entry.ForwardLink, IFR_DEFAULT_DATA, Entry);
-      RemoveEntryList (&DefaultId->Entry);
-      FreePool (DefaultId);
-    }
-    FreePool (DefaultIdArray);
+  //
+  // The parsed IFR data of a whole varstore stays in the routing index.
+  //
+  if (VarStore == NULL) {
+    FreeIfrVarStorageData (VarStorageData, DefaultIdArray);
   }
 
   //
@@ -4275,13 +4649,6 @@ Done:
     FreePool (ConfigHdr);
   }
 
-  //
-  // Free Package data
-  //
-  if (HiiFormPackage != NULL) {
-    FreePool (HiiFormPackage);
-  }
-
   if (PointerProgress != NULL) {
     if (*Request == NULL) {
       *PointerProgress = NULL;
@@ -4665,10 +5032,8 @@ HiiConfigRoutingExtractConfig (
   EFI_DEVICE_PATH_PROTOCOL            *DevicePath;
   EFI_DEVICE_PATH_PROTOCOL            *TempDevicePath;
   EFI_STATUS                          Status;
-  LIST_ENTRY                          *Link;
   HII_DATABASE_RECORD                 *Database;
-  UINT8                               *DevicePathPkg;
-  UINT8                               *CurrentDevicePath;
+  HII_CONFIG_VARSTORE                 *VarStore;
   EFI_HANDLE                          DriverHandle;
   EFI_HII_HANDLE                      HiiHandle;
   EFI_HII_CONFIG_ACCESS_PROTOCOL      *ConfigAccess;
@@ -4682,7 +5047,6 @@ HiiConfigRoutingExtractConfig (
   BOOLEAN                             IsEfiVarStore;
   EFI_IFR_VARSTORE_EFI                *EfiVarStoreInfo;
   EFI_STRING                          ErrorPtr;
-  UINTN                               DevicePathSize;
   UINTN                               ConigStringSize;
   UINTN                               ConigStringSizeNewsize;
   EFI_STRING                          ConfigStringPtr;
@@ -4766,20 +5130,11 @@ HiiConfigRoutingExtractConfig (
     DriverHandle     = NULL;
     HiiHandle        = NULL;
     Database         = NULL;
-    for (Link = Private->DatabaseList.ForwardLink;
-         Link != &Private->DatabaseList;
-         Link = Link->ForwardLink
-        ) {
-      Database = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
-      if ((DevicePathPkg = Database->PackageList->DevicePathPkg) != NULL) {
-        CurrentDevicePath = DevicePathPkg + sizeof (EFI_HII_PACKAGE_HEADER);
-        DevicePathSize    = GetDevicePathSize ((EFI_DEVICE_PATH_PROTOCOL *) CurrentDevicePath);
-        if ((CompareMem (DevicePath,CurrentDevicePath,DevicePathSize) == 0) && IsThisPackageList(Database, ConfigRequest)) {
-          DriverHandle = Database->DriverHandle;
-          HiiHandle    = Database->Handle;
-          break;
-        }
-      }
+    VarStore         = FindConfigVarStore (Private, ConfigRequest);
+    if (VarStore != NULL) {
+      Database     = VarStore->Database;
+      DriverHandle = Database->DriverHandle;
+      HiiHandle    = Database->Handle;
     }
 
     //
@@ -4844,7 +5199,7 @@ HiiConfigRoutingExtractConfig (
     //
     // Check whether this ConfigRequest is search from Efi varstore type storage.
     //
-    Status = GetVarStoreType(Database, ConfigRequest, &IsEfiVarStore, &EfiVarStoreInfo);
+    Status = GetConfigVarStoreType (VarStore, &IsEfiVarStore, &EfiVarStoreInfo);
     if (EFI_ERROR (Status)) {
       goto Done;
     }
@@ -5061,10 +5416,9 @@ HiiConfigRoutingExportConfig (
   EFI_HII_HANDLE                      HiiHandle;
   EFI_STRING                          DefaultResults;
   HII_DATABASE_PRIVATE_DATA           *Private;
-  LIST_ENTRY                          *Link;
   HII_DATABASE_RECORD                 *Database;
-  UINT8                               *DevicePathPkg;
-  UINT8                               *CurrentDevicePath;
+  HII_CONFIG_ROUTING_NODE             *Node;
+  EFI_STRING                          PathHdr;
   BOOLEAN                             IfrDataParsedFlag;
 
   if (This == NULL || Results == NULL) {
@@ -5117,22 +5471,12 @@ HiiConfigRoutingExportConfig (
     ConfigRequest    = NULL;
     DevicePath       = DevicePathFromHandle (ConfigAccessHandles[Index]);
     if (DevicePath != NULL) {
-      for (Link = Private->DatabaseList.ForwardLink;
-           Link != &Private->DatabaseList;
-           Link = Link->ForwardLink
-          ) {
-        Database = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
-        if ((DevicePathPkg = Database->PackageList->DevicePathPkg) != NULL) {
-          CurrentDevicePath = DevicePathPkg + sizeof (EFI_HII_PACKAGE_HEADER);
-          if (CompareMem (
-                DevicePath,
-                CurrentDevicePath,
-                GetDevicePathSize ((EFI_DEVICE_PATH_PROTOCOL *) CurrentDevicePath)
-                ) == 0) {
-            HiiHandle = Database->Handle;
-            break;
-          }
-        }
+      GenerateSubStr (L"PATH=", GetDevicePathSize (DevicePath), (VOID *) DevicePath, 1, &PathHdr);
+      Node = LookupConfigRoutingKey (Private, PathHdr);
+      FreePool (PathHdr);
+      if (Node != NULL) {
+        Database  = Node->Database;
+        HiiHandle = Database->Handle;
       }
     }
 
@@ -5257,16 +5601,12 @@ HiiConfigRoutingRouteConfig (
   EFI_STATUS                          Status;
   EFI_DEVICE_PATH_PROTOCOL            *DevicePath;
   EFI_DEVICE_PATH_PROTOCOL            *TempDevicePath;
-  LIST_ENTRY                          *Link;
-  HII_DATABASE_RECORD                 *Database;
-  UINT8                               *DevicePathPkg;
-  UINT8                               *CurrentDevicePath;
+  HII_CONFIG_VARSTORE                 *VarStore;
   EFI_HANDLE                          DriverHandle;
   EFI_HII_CONFIG_ACCESS_PROTOCOL      *ConfigAccess;
   EFI_STRING                          AccessProgress;
   EFI_IFR_VARSTORE_EFI                *EfiVarStoreInfo;
   BOOLEAN                             IsEfiVarstore;
-  UINTN                               DevicePathSize;
 
   if (This == NULL || Progress == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -5280,7 +5620,6 @@ HiiConfigRoutingRouteConfig (
   Private   = CONFIG_ROUTING_DATABASE_PRIVATE_DATA_FROM_THIS (This);
   StringPtr = Configuration;
   *Progress = StringPtr;
-  Database       = NULL;
   AccessProgress = NULL;
   EfiVarStoreInfo= NULL;
   IsEfiVarstore  = FALSE;
@@ -5330,20 +5669,9 @@ HiiConfigRoutingRouteConfig (
     // Find driver which matches the routing data.
     //
     DriverHandle     = NULL;
-    for (Link = Private->DatabaseList.ForwardLink;
-         Link != &Private->DatabaseList;
-         Link = Link->ForwardLink
-        ) {
-      Database = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
-
-      if ((DevicePathPkg = Database->PackageList->DevicePathPkg) != NULL) {
-        CurrentDevicePath = DevicePathPkg + sizeof (EFI_HII_PACKAGE_HEADER);
-        DevicePathSize    = GetDevicePathSize ((EFI_DEVICE_PATH_PROTOCOL *) CurrentDevicePath);
-        if ((CompareMem (DevicePath,CurrentDevicePath,DevicePathSize) == 0) && IsThisPackageList(Database, ConfigResp)) {
-          DriverHandle = Database->DriverHandle;
-          break;
-        }
-      }
+    VarStore         = FindConfigVarStore (Private, ConfigResp);
+    if (VarStore != NULL) {
+      DriverHandle = VarStore->Database->DriverHandle;
     }
 
     //
@@ -5373,8 +5701,9 @@ HiiConfigRoutingRouteConfig (
     //
     // Check whether this ConfigRequest is search from Efi varstore type storage.
     //
-    Status = GetVarStoreType(Database, ConfigResp, &IsEfiVarstore, &EfiVarStoreInfo);
+    Status = GetConfigVarStoreType (VarStore, &IsEfiVarstore, &EfiVarStoreInfo);
     if (EFI_ERROR (Status)) {
+      FreePool (ConfigResp);
       return Status;
     }
 
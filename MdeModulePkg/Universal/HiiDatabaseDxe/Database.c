@@ -75,6 +75,7 @@ GenerateHiiDatabaseRecord (
   InitializeListHead (&PackageList->SimpleFontPkgHdr);
   PackageList->ImagePkg      = NULL;
   PackageList->DevicePathPkg = NULL;
+  InitializeListHead (&DatabaseRecord->ConfigVarStoreList);
 
   //
   // Create a new hii handle
@@ -1497,6 +1498,7 @@ AdjustStringPackage (
       *BlockPtr = EFI_HII_SIBT_END;
       FreePool (StringPackage->StringBlock);
       StringPackage->StringBlock = StringBlock;
+      FreeStringIdIndex (StringPackage);
       StringPackage->StringPkgHdr->Header.Length += Skip2BlockSize;
       PackageList->PackageListHdr.PackageLength += Skip2BlockSize;
       StringPackage->MaxStringId = MaxStringId;
@@ -1636,6 +1638,7 @@ RemoveStringPackages (
 
     RemoveEntryList (&Package->StringEntry);
     PackageList->PackageListHdr.PackageLength -= Package->StringPkgHdr->Header.Length;
+    FreeStringIdIndex (Package);
     FreePool (Package->StringBlock);
     FreePool (Package->StringPkgHdr);
     //
@@ -2460,6 +2463,7 @@ RemoveSimpleFontPackages (
     PackageList->PackageListHdr.PackageLength -= Package->SimpleFontPkgHdr->Header.Length;
     FreePool (Package->SimpleFontPkgHdr);
     FreePool (Package);
+    FreeSimpleGlyphCache (Private);
   }
 
   return EFI_SUCCESS;
@@ -3124,6 +3128,7 @@ AddPackages (
       if (EFI_ERROR (Status)) {
         return Status;
       }
+      FreeSimpleGlyphCache (Private);
       Status = InvokeRegisteredFunction (
                  Private,
                  NotifyType,
@@ -3520,6 +3525,7 @@ HiiNewPackageList (
     EfiReleaseLock (&mHiiDatabaseLock);
     return Status;
   }
+  InvalidateConfigRoutingIndex (Private, DatabaseRecord);
 
   //
   // Fill in information of the created Package List node
@@ -3627,6 +3633,7 @@ HiiRemovePackageList (
     if (Node->Handle == Handle) {
       PackageList = (HII_DATABASE_PACKAGE_LIST_INSTANCE *) (Node->PackageList);
       ASSERT (PackageList != NULL);
+      InvalidateConfigRoutingIndex (Private, Node);
 
       //
       // Call registered functions with REMOVE_PACK before removing packages
@@ -3778,6 +3785,7 @@ HiiUpdatePackageList (
     Node = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
     if (Node->Handle == Handle) {
       OldPackageList = Node->PackageList;
+      InvalidateConfigRoutingIndex (Private, Node);
       //
       // Remove the package if its type matches one of the package types which is
       // contained in the new package list.
@@ -130,6 +130,134 @@ GetCell (
 }
 
 
+/**
+  Free the simple font glyph lookup pages and the glyphs rendered from them.
+  Must be called whenever a simple font package is added or removed.
+
+  @param  Private                 Hii database private structure.
+
+**/
+VOID
+FreeSimpleGlyphCache (
+  IN OUT HII_DATABASE_PRIVATE_DATA   *Private
+  )
+{
+  HII_SIMPLE_GLYPH                   *Glyphs;
+  UINTN                              Page;
+  UINTN                              Index;
+  UINTN                              Color;
+
+  for (Page = 0; Page < HII_SIMPLE_GLYPH_PAGE_COUNT; Page++) {
+    Glyphs = Private->SimpleGlyphPage[Page];
+    if (Glyphs == NULL) {
+      continue;
+    }
+    for (Index = 0; Index < HII_SIMPLE_GLYPH_PAGE_SIZE; Index++) {
+      for (Color = 0; Color < HII_GLYPH_ATLAS_COLOR_COUNT; Color++) {
+        if (Glyphs[Index].Rendered[Color] != NULL) {
+          FreePool (Glyphs[Index].Rendered[Color]);
+        }
+      }
+    }
+    FreePool (Glyphs);
+    Private->SimpleGlyphPage[Page] = NULL;
+  }
+
+  ZeroMem (Private->GlyphAtlasColor, sizeof (Private->GlyphAtlasColor));
+}
+
+
+/**
+  Find the glyph of a character in the simple font packages.
+
+  The narrow and wide glyphs of all simple font packages are searched in
+  database order and the first glyph of the character is used. The glyphs of
+  the HII_SIMPLE_GLYPH_PAGE_SIZE characters around Char are collected in a
+  single pass on first use, so later lookups don't walk the packages.
+
+  This is a internal function.
+
+  @param  Private                 HII database driver private data.
+  @param  Char                    Character to retrieve.
+  @param  SimpleGlyph             Output the glyph of Char.
+
+  @retval EFI_SUCCESS             The glyph was found.
+  @retval EFI_NOT_FOUND           No simple font package has a glyph for Char.
+  @retval EFI_OUT_OF_RESOURCES    There is no memory for the lookup page.
+
+**/
+EFI_STATUS
+GetSimpleGlyph (
+  IN  HII_DATABASE_PRIVATE_DATA      *Private,
+  IN  CHAR16                         Char,
+  OUT HII_SIMPLE_GLYPH               **SimpleGlyph
+  )
+{
+  HII_SIMPLE_GLYPH                   *Glyphs;
+  HII_SIMPLE_GLYPH                   *Entry;
+  UINTN                              Page;
+  HII_DATABASE_RECORD                *Node;
+  LIST_ENTRY                         *Link;
+  HII_SIMPLE_FONT_PACKAGE_INSTANCE   *SimpleFont;
+  LIST_ENTRY                         *Link1;
+  UINT16                             Index;
+  CHAR16                             UnicodeWeight;
+  EFI_NARROW_GLYPH                   *NarrowPtr;
+  EFI_WIDE_GLYPH                     *WidePtr;
+
+  Page   = Char >> HII_SIMPLE_GLYPH_PAGE_SHIFT;
+  Glyphs = Private->SimpleGlyphPage[Page];
+  if (Glyphs == NULL) {
+    Glyphs = AllocateZeroPool (HII_SIMPLE_GLYPH_PAGE_SIZE * sizeof (HII_SIMPLE_GLYPH));
+    if (Glyphs == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    for (Link = Private->DatabaseList.ForwardLink; Link != &Private->DatabaseList; Link = Link->ForwardLink) {
+      Node = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
+      for (Link1 = Node->PackageList->SimpleFontPkgHdr.ForwardLink;
+           Link1 != &Node->PackageList->SimpleFontPkgHdr;
+           Link1 = Link1->ForwardLink
+          ) {
+        SimpleFont = CR (Link1, HII_SIMPLE_FONT_PACKAGE_INSTANCE, SimpleFontEntry, HII_S_FONT_PACKAGE_SIGNATURE);
+        NarrowPtr  = (EFI_NARROW_GLYPH *) (SimpleFont->SimpleFontPkgHdr + 1);
+        for (Index = 0; Index < SimpleFont->SimpleFontPkgHdr->NumberOfNarrowGlyphs; Index++) {
+          CopyMem (&UnicodeWeight, &NarrowPtr[Index].UnicodeWeight, sizeof (CHAR16));
+          if ((UINTN) (UnicodeWeight >> HII_SIMPLE_GLYPH_PAGE_SHIFT) == Page) {
+            Entry = &Glyphs[UnicodeWeight & (HII_SIMPLE_GLYPH_PAGE_SIZE - 1)];
+            if (Entry->Glyph == NULL) {
+              Entry->Glyph = (UINT8 *) (NarrowPtr + Index);
+              Entry->Wide  = FALSE;
+            }
+          }
+        }
+        WidePtr = (EFI_WIDE_GLYPH *) (NarrowPtr + SimpleFont->SimpleFontPkgHdr->NumberOfNarrowGlyphs);
+        for (Index = 0; Index < SimpleFont->SimpleFontPkgHdr->NumberOfWideGlyphs; Index++) {
+          CopyMem (&UnicodeWeight, &WidePtr[Index].UnicodeWeight, sizeof (CHAR16));
+          if ((UINTN) (UnicodeWeight >> HII_SIMPLE_GLYPH_PAGE_SHIFT) == Page) {
+            Entry = &Glyphs[UnicodeWeight & (HII_SIMPLE_GLYPH_PAGE_SIZE - 1)];
+            if (Entry->Glyph == NULL) {
+              Entry->Glyph = (UINT8 *) (WidePtr + Index);
+              Entry->Wide  = TRUE;
+            }
+          }
+        }
+      }
+    }
+
+    Private->SimpleGlyphPage[Page] = Glyphs;
+  }
+
+  Entry = &Glyphs[Char & (HII_SIMPLE_GLYPH_PAGE_SIZE - 1)];
+  if (Entry->Glyph == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *SimpleGlyph = Entry;
+  return EFI_SUCCESS;
+}
+
+
 /**
   Convert the glyph for a single character into a bitmap.
 
@@ -160,17 +288,11 @@ GetGlyphBuffer (
   OUT UINT8                          *Attributes OPTIONAL
   )
 {
-  HII_DATABASE_RECORD                *Node;
-  LIST_ENTRY                         *Link;
-  HII_SIMPLE_FONT_PACKAGE_INSTANCE   *SimpleFont;
-  LIST_ENTRY                         *Link1;
-  UINT16                             Index;
+  EFI_STATUS                         Status;
+  HII_SIMPLE_GLYPH                   *SimpleGlyph;
   EFI_NARROW_GLYPH                   Narrow;
   EFI_WIDE_GLYPH                     Wide;
   HII_GLOBAL_FONT_INFO               *GlobalFont;
-  UINTN                              HeaderSize;
-  EFI_NARROW_GLYPH                   *NarrowPtr;
-  EFI_WIDE_GLYPH                     *WidePtr;
 
   if (GlyphBuffer == NULL || Cell == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -195,64 +317,43 @@ GetGlyphBuffer (
       *Attributes = PROPORTIONAL_GLYPH;
     }
     return FindGlyphBlock (GlobalFont->FontPackage, Char, GlyphBuffer, Cell, NULL);
-  } else {
-    HeaderSize = sizeof (EFI_HII_SIMPLE_FONT_PACKAGE_HDR);
+  }
 
-    for (Link = Private->DatabaseList.ForwardLink; Link != &Private->DatabaseList; Link = Link->ForwardLink) {
-      Node = CR (Link, HII_DATABASE_RECORD, DatabaseEntry, HII_DATABASE_RECORD_SIGNATURE);
-      for (Link1 = Node->PackageList->SimpleFontPkgHdr.ForwardLink;
-           Link1 != &Node->PackageList->SimpleFontPkgHdr;
-           Link1 = Link1->ForwardLink
-          ) {
-        SimpleFont = CR (Link1, HII_SIMPLE_FONT_PACKAGE_INSTANCE, SimpleFontEntry, HII_S_FONT_PACKAGE_SIGNATURE);
-        //
-        // Search the narrow glyph array
-        //
-        NarrowPtr = (EFI_NARROW_GLYPH *) ((UINT8 *) (SimpleFont->SimpleFontPkgHdr) + HeaderSize);
-        for (Index = 0; Index < SimpleFont->SimpleFontPkgHdr->NumberOfNarrowGlyphs; Index++) {
-          CopyMem (&Narrow, NarrowPtr + Index,sizeof (EFI_NARROW_GLYPH));
-          if (Narrow.UnicodeWeight == Char) {
-            *GlyphBuffer = (UINT8 *) AllocateZeroPool (EFI_GLYPH_HEIGHT);
-            if (*GlyphBuffer == NULL) {
-              return EFI_OUT_OF_RESOURCES;
-            }
-            Cell->Width    = EFI_GLYPH_WIDTH;
-            Cell->Height   = EFI_GLYPH_HEIGHT;
-            Cell->AdvanceX = Cell->Width;
-            CopyMem (*GlyphBuffer, Narrow.GlyphCol1, Cell->Height);
-            if (Attributes != NULL) {
-              *Attributes = (UINT8) (Narrow.Attributes | NARROW_GLYPH);
-            }
-            return EFI_SUCCESS;
-          }
-        }
-        //
-        // Search the wide glyph array
-        //
-        WidePtr = (EFI_WIDE_GLYPH *) (NarrowPtr + SimpleFont->SimpleFontPkgHdr->NumberOfNarrowGlyphs);
-        for (Index = 0; Index < SimpleFont->SimpleFontPkgHdr->NumberOfWideGlyphs; Index++) {
-          CopyMem (&Wide, WidePtr + Index, sizeof (EFI_WIDE_GLYPH));
-          if (Wide.UnicodeWeight == Char) {
-            *GlyphBuffer    = (UINT8 *) AllocateZeroPool (EFI_GLYPH_HEIGHT * 2);
-            if (*GlyphBuffer == NULL) {
-              return EFI_OUT_OF_RESOURCES;
-            }
-            Cell->Width    = EFI_GLYPH_WIDTH * 2;
-            Cell->Height   = EFI_GLYPH_HEIGHT;
-            Cell->AdvanceX = Cell->Width;
-            CopyMem (*GlyphBuffer, Wide.GlyphCol1, EFI_GLYPH_HEIGHT);
-            CopyMem (*GlyphBuffer + EFI_GLYPH_HEIGHT, Wide.GlyphCol2, EFI_GLYPH_HEIGHT);
-            if (Attributes != NULL) {
-              *Attributes = (UINT8) (Wide.Attributes | EFI_GLYPH_WIDE);
-            }
-            return EFI_SUCCESS;
-          }
-        }
-      }
+  Status = GetSimpleGlyph (Private, Char, &SimpleGlyph);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (SimpleGlyph->Wide) {
+    CopyMem (&Wide, SimpleGlyph->Glyph, sizeof (EFI_WIDE_GLYPH));
+    *GlyphBuffer = (UINT8 *) AllocateZeroPool (EFI_GLYPH_HEIGHT * 2);
+    if (*GlyphBuffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Cell->Width    = EFI_GLYPH_WIDTH * 2;
+    Cell->Height   = EFI_GLYPH_HEIGHT;
+    Cell->AdvanceX = Cell->Width;
+    CopyMem (*GlyphBuffer, Wide.GlyphCol1, EFI_GLYPH_HEIGHT);
+    CopyMem (*GlyphBuffer + EFI_GLYPH_HEIGHT, Wide.GlyphCol2, EFI_GLYPH_HEIGHT);
+    if (Attributes != NULL) {
+      *Attributes = (UINT8) (Wide.Attributes | EFI_GLYPH_WIDE);
     }
+    return EFI_SUCCESS;
   }
 
-  return EFI_NOT_FOUND;
+  CopyMem (&Narrow, SimpleGlyph->Glyph, sizeof (EFI_NARROW_GLYPH));
+  *GlyphBuffer = (UINT8 *) AllocateZeroPool (EFI_GLYPH_HEIGHT);
+  if (*GlyphBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Cell->Width    = EFI_GLYPH_WIDTH;
+  Cell->Height   = EFI_GLYPH_HEIGHT;
+  Cell->AdvanceX = Cell->Width;
+  CopyMem (*GlyphBuffer, Narrow.GlyphCol1, Cell->Height);
+  if (Attributes != NULL) {
+    *Attributes = (UINT8) (Narrow.Attributes | NARROW_GLYPH);
+  }
+  return EFI_SUCCESS;
 }
 
 /**
@@ -576,6 +677,194 @@ GlyphToImage (
 }
 
 
+/**
+  Get the glyph atlas color slot of a foreground/background color pair.
+
+  If the pair has no slot yet, the least recently used slot is taken over and
+  the glyphs rendered in its previous colors are freed.
+
+  This is a internal function.
+
+  @param  Private                 HII database driver private data.
+  @param  Foreground              The color of the "on" pixels of the glyphs.
+  @param  Background              The color of the "off" pixels of the glyphs.
+
+  @return Index of the slot in Private->GlyphAtlasColor.
+
+**/
+UINTN
+GetGlyphAtlasColor (
+  IN  HII_DATABASE_PRIVATE_DATA      *Private,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Foreground,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Background
+  )
+{
+  HII_GLYPH_ATLAS_COLOR              *AtlasColor;
+  UINTN                              Color;
+  UINTN                              Oldest;
+  UINTN                              Page;
+  UINTN                              Index;
+
+  Private->GlyphAtlasTick++;
+  if (Private->GlyphAtlasTick == 0) {
+    Private->GlyphAtlasTick = 1;
+  }
+
+  Oldest = 0;
+  for (Color = 0; Color < HII_GLYPH_ATLAS_COLOR_COUNT; Color++) {
+    AtlasColor = &Private->GlyphAtlasColor[Color];
+    if (AtlasColor->LastUsed != 0 &&
+        CompareMem (&AtlasColor->Foreground, &Foreground, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) == 0 &&
+        CompareMem (&AtlasColor->Background, &Background, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) == 0) {
+      AtlasColor->LastUsed = Private->GlyphAtlasTick;
+      return Color;
+    }
+    if (AtlasColor->LastUsed < Private->GlyphAtlasColor[Oldest].LastUsed) {
+      Oldest = Color;
+    }
+  }
+
+  for (Page = 0; Page < HII_SIMPLE_GLYPH_PAGE_COUNT; Page++) {
+    if (Private->SimpleGlyphPage[Page] == NULL) {
+      continue;
+    }
+    for (Index = 0; Index < HII_SIMPLE_GLYPH_PAGE_SIZE; Index++) {
+      if (Private->SimpleGlyphPage[Page][Index].Rendered[Oldest] != NULL) {
+        FreePool (Private->SimpleGlyphPage[Page][Index].Rendered[Oldest]);
+        Private->SimpleGlyphPage[Page][Index].Rendered[Oldest] = NULL;
+      }
+    }
+  }
+
+  AtlasColor             = &Private->GlyphAtlasColor[Oldest];
+  AtlasColor->Foreground = Foreground;
+  AtlasColor->Background = Background;
+  AtlasColor->LastUsed   = Private->GlyphAtlasTick;
+  return Oldest;
+}
+
+
+/**
+  Draw a narrow or wide glyph of the system font by copying its rows from the
+  glyph atlas, rendering it into the atlas first if needed.
+
+  The result is the same as GlyphToImage () drawing the glyph with the colors
+  of the atlas slot and Transparent being FALSE. Glyphs that GlyphToImage ()
+  would clip, and non-spacing glyphs, are left to GlyphToImage ().
+
+  This is a internal function.
+
+  @param  Private                 HII database driver private data.
+  @param  Char                    Character whose glyph is drawn. The glyph of
+                                  REPLACE_UNKNOWN_GLYPH is drawn if Char has none.
+  @param  AtlasColor              Glyph atlas color slot from GetGlyphAtlasColor ().
+  @param  ImageWidth              Width of the whole image in pixels.
+  @param  RowWidth                The width of the text on the line, in pixels.
+  @param  RowHeight               The height of the line, in pixels.
+  @param  Attributes              The attribute of the glyph from GetGlyphBuffer ().
+  @param  Origin                  On input, points to the origin of the to be
+                                  displayed character, on output, points to the
+                                  next glyph's origin.
+
+  @retval TRUE                    The glyph was drawn.
+  @retval FALSE                   The glyph was not drawn and Origin is unchanged.
+
+**/
+BOOLEAN
+GlyphAtlasToImage (
+  IN     HII_DATABASE_PRIVATE_DATA     *Private,
+  IN     CHAR16                        Char,
+  IN     UINTN                         AtlasColor,
+  IN     UINT16                        ImageWidth,
+  IN     UINTN                         RowWidth,
+  IN     UINTN                         RowHeight,
+  IN     UINT8                         Attributes,
+  IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL **Origin
+  )
+{
+  EFI_STATUS                           Status;
+  HII_SIMPLE_GLYPH                     *SimpleGlyph;
+  BOOLEAN                              Wide;
+  UINT16                               Width;
+  UINT16                               Ypos;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Rendered;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *Buffer;
+
+  ASSERT (Origin != NULL && *Origin != NULL && AtlasColor < HII_GLYPH_ATLAS_COLOR_COUNT);
+
+  if ((Attributes & EFI_GLYPH_NON_SPACING) == EFI_GLYPH_NON_SPACING ||
+      (Attributes & (EFI_GLYPH_WIDE | NARROW_GLYPH)) == 0 ||
+      RowWidth < EFI_GLYPH_WIDTH || RowHeight < EFI_GLYPH_HEIGHT) {
+    return FALSE;
+  }
+
+  Status = GetSimpleGlyph (Private, Char, &SimpleGlyph);
+  if (Status == EFI_NOT_FOUND) {
+    Status = GetSimpleGlyph (Private, REPLACE_UNKNOWN_GLYPH, &SimpleGlyph);
+  }
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  //
+  // GlyphToImage () takes the glyph size from Attributes. Leave a narrow glyph
+  // carrying EFI_GLYPH_WIDE to it.
+  //
+  Wide = (BOOLEAN) ((Attributes & EFI_GLYPH_WIDE) == EFI_GLYPH_WIDE);
+  if (Wide != SimpleGlyph->Wide) {
+    return FALSE;
+  }
+  Width = (UINT16) (Wide ? EFI_GLYPH_WIDTH * 2 : EFI_GLYPH_WIDTH);
+
+  Rendered = SimpleGlyph->Rendered[AtlasColor];
+  if (Rendered == NULL) {
+    Rendered = AllocatePool (Width * EFI_GLYPH_HEIGHT * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    if (Rendered == NULL) {
+      return FALSE;
+    }
+    Buffer = Rendered + EFI_GLYPH_HEIGHT * Width;
+    NarrowGlyphToBlt (
+      SimpleGlyph->Glyph + OFFSET_OF (EFI_NARROW_GLYPH, GlyphCol1),
+      Private->GlyphAtlasColor[AtlasColor].Foreground,
+      Private->GlyphAtlasColor[AtlasColor].Background,
+      Width,
+      EFI_GLYPH_WIDTH,
+      EFI_GLYPH_HEIGHT,
+      FALSE,
+      &Buffer
+      );
+    if (Wide) {
+      NarrowGlyphToBlt (
+        SimpleGlyph->Glyph + OFFSET_OF (EFI_WIDE_GLYPH, GlyphCol2),
+        Private->GlyphAtlasColor[AtlasColor].Foreground,
+        Private->GlyphAtlasColor[AtlasColor].Background,
+        Width,
+        EFI_GLYPH_WIDTH,
+        EFI_GLYPH_HEIGHT,
+        FALSE,
+        &Buffer
+        );
+    }
+    SimpleGlyph->Rendered[AtlasColor] = Rendered;
+  }
+
+  //
+  // Move position to the left-top corner of char.
+  //
+  Buffer = *Origin - EFI_GLYPH_HEIGHT * ImageWidth;
+  for (Ypos = 0; Ypos < EFI_GLYPH_HEIGHT; Ypos++) {
+    CopyMem (
+      Buffer + Ypos * ImageWidth,
+      Rendered + Ypos * Width,
+      Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+      );
+  }
+
+  *Origin = *Origin + Width;
+  return TRUE;
+}
+
+
 /**
   Write the output parameters of FindGlyphBlock().
 
@@ -1621,6 +1910,7 @@ HiiStringToImage (
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL       *RowBufferPtr;
   HII_GLOBAL_FONT_INFO                *GlobalFont;
   UINT32                              PreInitBkgnd;
+  UINTN                               AtlasColor;
 
   //
   // Check incoming parameters.
@@ -1861,6 +2151,15 @@ HiiStringToImage (
   //
   Transparent = (BOOLEAN) ((Flags & EFI_HII_OUT_FLAG_TRANSPARENT) == EFI_HII_OUT_FLAG_TRANSPARENT ? TRUE : FALSE);
 
+  //
+  // Opaque glyphs of the system font are copied from the glyph atlas instead of
+  // being rendered pixel by pixel for every character.
+  //
+  AtlasColor = HII_GLYPH_ATLAS_COLOR_COUNT;
+  if (SysFontFlag && !Transparent) {
+    AtlasColor = GetGlyphAtlasColor (Private, Foreground, Background);
+  }
+
   for (RowIndex = 0, Index = 0; RowIndex < MaxRowNum && StringPtr[Index] != 0; ) {
     LineWidth      = 0;
     LineBreak      = FALSE;
@@ -2071,19 +2370,31 @@ HiiStringToImage (
           //
           // Only BLT these character which have corresponding glyph in font database.
           //
-          GlyphToImage (
-            GlyphBuf[Index1],
-            Foreground,
-            Background,
-            (UINT16) RowInfo[RowIndex].LineWidth,
-            BaseLine,
-            RowInfo[RowIndex].LineWidth - LineOffset,
-            RowInfo[RowIndex].LineHeight,
-            Transparent,
-            &Cell[Index1],
-            Attributes[Index1],
-            &BufferPtr
-          );
+          if (AtlasColor == HII_GLYPH_ATLAS_COLOR_COUNT || GlyphBuf[Index1] == NULL ||
+              !GlyphAtlasToImage (
+                 Private,
+                 StringPtr[Index1],
+                 AtlasColor,
+                 (UINT16) RowInfo[RowIndex].LineWidth,
+                 RowInfo[RowIndex].LineWidth - LineOffset,
+                 RowInfo[RowIndex].LineHeight,
+                 Attributes[Index1],
+                 &BufferPtr
+                 )) {
+            GlyphToImage (
+              GlyphBuf[Index1],
+              Foreground,
+              Background,
+              (UINT16) RowInfo[RowIndex].LineWidth,
+              BaseLine,
+              RowInfo[RowIndex].LineWidth - LineOffset,
+              RowInfo[RowIndex].LineHeight,
+              Transparent,
+              &Cell[Index1],
+              Attributes[Index1],
+              &BufferPtr
+            );
+          }
         }
         if (ColumnInfoArray != NULL) {
           if ((GlyphBuf[Index1] == NULL && Cell[Index1].AdvanceX == 0)
@@ -2131,19 +2442,31 @@ HiiStringToImage (
           //
           // Only BLT these character which have corresponding glyph in font database.
           //
-          GlyphToImage (
-            GlyphBuf[Index1],
-            Foreground,
-            Background,
-            Image->Width,
-            BaseLine,
-            RowInfo[RowIndex].LineWidth - LineOffset,
-            RowInfo[RowIndex].LineHeight,
-            Transparent,
-            &Cell[Index1],
-            Attributes[Index1],
-            &BufferPtr
-          );
+          if (AtlasColor == HII_GLYPH_ATLAS_COLOR_COUNT || GlyphBuf[Index1] == NULL ||
+              !GlyphAtlasToImage (
+                 Private,
+                 StringPtr[Index1],
+                 AtlasColor,
+                 Image->Width,
+                 RowInfo[RowIndex].LineWidth - LineOffset,
+                 RowInfo[RowIndex].LineHeight,
+                 Attributes[Index1],
+                 &BufferPtr
+                 )) {
+            GlyphToImage (
+              GlyphBuf[Index1],
+              Foreground,
+              Background,
+              Image->Width,
+              BaseLine,
+              RowInfo[RowIndex].LineWidth - LineOffset,
+              RowInfo[RowIndex].LineHeight,
+              Transparent,
+              &Cell[Index1],
+              Attributes[Index1],
+              &BufferPtr
+            );
+          }
         }
         if (ColumnInfoArray != NULL) {
           if ((GlyphBuf[Index1] == NULL && Cell[Index1].AdvanceX == 0)
@@ -152,6 +152,18 @@ typedef struct {
 // String Package definitions
 //
 #define HII_STRING_PACKAGE_SIGNATURE    SIGNATURE_32 ('h','i','s','p')
+//
+// Location of a string within the string blocks of a string package. The
+// offsets are used instead of pointers so that an entry can be checked
+// against the current string blocks.
+//
+#define HII_STRING_ID_INDEX_NOT_FOUND   MAX_UINT32
+#define HII_STRING_ID_INDEX_DUPLICATE   (MAX_UINT32 - 1)
+typedef struct {
+  UINT32                                BlockOffset;   // string block, relative to StringBlock
+  UINT32                                TextOffset;    // string text, relative to the string block
+} HII_STRING_ID_INDEX_ENTRY;
+
 typedef struct _HII_STRING_PACKAGE_INSTANCE {
   UINTN                                 Signature;
   EFI_HII_STRING_PACKAGE_HDR            *StringPkgHdr;
@@ -160,6 +172,12 @@ typedef struct _HII_STRING_PACKAGE_INSTANCE {
   LIST_ENTRY                            FontInfoList;  // local font info list
   UINT8                                 FontId;
   EFI_STRING_ID                         MaxStringId;   // record StringId
+  //
+  // StringId -> string block lookup table, built on demand by
+  // FindStringBlock () and freed whenever StringBlock changes.
+  //
+  HII_STRING_ID_INDEX_ENTRY             *StringIdIndex;
+  UINTN                                 StringIdIndexCount;
 } HII_STRING_PACKAGE_INSTANCE;
 
 //
@@ -222,6 +240,34 @@ typedef struct _HII_GLOBAL_FONT_INFO {
   EFI_FONT_INFO                         *FontInfo;
 } HII_GLOBAL_FONT_INFO;
 
+//
+// Glyphs of the simple font packages (the system font), looked up by
+// character value through pages of HII_SIMPLE_GLYPH_PAGE_SIZE characters.
+// A page is filled on first use and all pages are dropped when a simple font
+// package is added or removed.
+//
+#define HII_SIMPLE_GLYPH_PAGE_SHIFT     8
+#define HII_SIMPLE_GLYPH_PAGE_SIZE      (1 << HII_SIMPLE_GLYPH_PAGE_SHIFT)
+#define HII_SIMPLE_GLYPH_PAGE_COUNT     (0x10000 >> HII_SIMPLE_GLYPH_PAGE_SHIFT)
+
+//
+// Number of foreground/background color pairs the glyph atlas keeps rendered
+// glyphs for. The least recently used pair is dropped when a new one is needed.
+//
+#define HII_GLYPH_ATLAS_COLOR_COUNT     4
+
+typedef struct _HII_SIMPLE_GLYPH {
+  UINT8                                 *Glyph;        // EFI_NARROW_GLYPH or EFI_WIDE_GLYPH in a package, NULL if none
+  BOOLEAN                               Wide;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *Rendered[HII_GLYPH_ATLAS_COLOR_COUNT];
+} HII_SIMPLE_GLYPH;
+
+typedef struct _HII_GLYPH_ATLAS_COLOR {
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL         Foreground;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL         Background;
+  UINT32                                LastUsed;      // 0 if the slot is free
+} HII_GLYPH_ATLAS_COLOR;
+
 //
 // Image Package definitions
 //
@@ -288,8 +334,53 @@ typedef struct _HII_DATABASE_RECORD {
   EFI_HANDLE                            DriverHandle;
   EFI_HII_HANDLE                        Handle;
   LIST_ENTRY                            DatabaseEntry;
+  //
+  // Routing index of the package list, built on demand by ConfigRouting.c
+  // and freed by InvalidateConfigRoutingIndex () whenever the packages change.
+  //
+  BOOLEAN                               ConfigIndexValid;
+  EFI_STRING                            ConfigPathHdr;      // PATH=... of the device path package, or NULL
+  LIST_ENTRY                            ConfigVarStoreList; // HII_CONFIG_VARSTORE
 } HII_DATABASE_RECORD;
 
+//
+// A varstore that a package list declares before its first form, which is
+// where ExtractConfig () and RouteConfig () look for the storage of a request.
+//
+#define HII_CONFIG_VARSTORE_SIGNATURE   SIGNATURE_32 ('h','c','v','s')
+
+typedef struct {
+  UINTN                                 Signature;
+  LIST_ENTRY                            Entry;
+  HII_DATABASE_RECORD                   *Database;
+  UINT8                                 Type;            // EFI_HII_VARSTORE_BUFFER, EFI_HII_VARSTORE_NAME_VALUE, EFI_HII_VARSTORE_EFI_VARIABLE_BUFFER
+  EFI_IFR_VARSTORE_EFI                  *EfiVarStore;    // copy of the EFI varstore opcode, or NULL
+  EFI_STRING                            ConfigHdr;       // GUID=...&NAME=...&PATH=...
+  //
+  // Question offsets and defaults of the whole varstore, parsed from the IFR
+  // on the first request that has no elements. Not used for name/value
+  // varstores, whose element names depend on the platform language.
+  //
+  IFR_VARSTORAGE_DATA                   *VarStorageData;
+  IFR_DEFAULT_DATA                      *DefaultIdArray;
+} HII_CONFIG_VARSTORE;
+
+//
+// Radix tree over the <ConfigHdr> of every varstore and the PATH=... of
+// every device path package, so that a request is routed in time
+// proportional to its header. Labels point into the ConfigHdr or
+// ConfigPathHdr strings of the package lists, so the tree is freed before
+// any of them.
+//
+typedef struct _HII_CONFIG_ROUTING_NODE {
+  struct _HII_CONFIG_ROUTING_NODE       *Child;
+  struct _HII_CONFIG_ROUTING_NODE       *Sibling;
+  CONST CHAR16                          *Label;
+  UINTN                                 LabelLength;
+  HII_DATABASE_RECORD                   *Database;       // set where a key ends
+  HII_CONFIG_VARSTORE                   *VarStore;       // set where a <ConfigHdr> ends
+} HII_CONFIG_ROUTING_NODE;
+
 #define HII_DATABASE_NOTIFY_SIGNATURE   SIGNATURE_32 ('h','i','d','n')
 
 typedef struct _HII_DATABASE_NOTIFY {
@@ -321,6 +412,10 @@ typedef struct _HII_DATABASE_PRIVATE_DATA {
   UINTN                                 Attribute;     // default system color
   EFI_GUID                              CurrentLayoutGuid;
   EFI_HII_KEYBOARD_LAYOUT               *CurrentLayout;
+  HII_SIMPLE_GLYPH                      *SimpleGlyphPage[HII_SIMPLE_GLYPH_PAGE_COUNT];
+  HII_GLYPH_ATLAS_COLOR                 GlyphAtlasColor[HII_GLYPH_ATLAS_COLOR_COUNT];
+  UINT32                                GlyphAtlasTick;
+  HII_CONFIG_ROUTING_NODE               *ConfigRoutingTree; // NULL until the next routing call
 } HII_DATABASE_PRIVATE_DATA;
 
 #define HII_FONT_DATABASE_PRIVATE_DATA_FROM_THIS(a) \
@@ -539,6 +634,20 @@ FindStringBlock (
   OUT EFI_STRING_ID                   *StartStringId OPTIONAL
   );
 
+/**
+  Free the StringId lookup table of a string package.
+
+  This must be called whenever the string blocks of the package change, so
+  that FindStringBlock () does not return stale locations.
+
+  @param  StringPackage           Hii string package instance.
+
+**/
+VOID
+FreeStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  );
+
 
 /**
   Parse all glyph blocks to find a glyph block specified by CharValue.
@@ -570,6 +679,33 @@ FindGlyphBlock (
   OUT UINTN                          *GlyphBufferLen OPTIONAL
   );
 
+/**
+  Free the simple font glyph lookup pages and the glyphs rendered from them.
+  Must be called whenever a simple font package is added or removed.
+
+  @param  Private                 Hii database private structure.
+
+**/
+VOID
+FreeSimpleGlyphCache (
+  IN OUT HII_DATABASE_PRIVATE_DATA   *Private
+  );
+
+/**
+  Free the routing index of a package list and the routing tree of the
+  database. Must be called whenever packages are added to or removed from
+  the package list, and before the package list itself is freed.
+
+  @param  Private                 Hii database private structure.
+  @param  DatabaseRecord          The package list whose packages change.
+
+**/
+VOID
+InvalidateConfigRoutingIndex (
+  IN OUT HII_DATABASE_PRIVATE_DATA   *Private,
+  IN OUT HII_DATABASE_RECORD         *DatabaseRecord
+  );
+
 /**
   This function exports Form packages to a buffer.
   This is a internal function.
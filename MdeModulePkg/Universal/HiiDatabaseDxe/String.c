@@ -227,6 +227,219 @@ GetStringFontInfo (
 }
 
 
+/**
+  Free the StringId lookup table of a string package.
+
+  This must be called whenever the string blocks of the package change, so
+  that FindStringBlock () does not return stale locations.
+
+  @param  StringPackage           Hii string package instance.
+
+**/
+VOID
+FreeStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  )
+{
+  if (StringPackage->StringIdIndex != NULL) {
+    FreePool (StringPackage->StringIdIndex);
+    StringPackage->StringIdIndex      = NULL;
+    StringPackage->StringIdIndexCount = 0;
+  }
+}
+
+/**
+  Parse all string blocks once and record where the text of each string ID
+  is, so FindStringBlock () does not have to parse the blocks from the start
+  for every lookup.
+
+  String IDs that are skipped, or whose block cannot be used, are recorded as
+  HII_STRING_ID_INDEX_NOT_FOUND. EFI_HII_SIBT_DUPLICATE blocks are resolved to
+  the block of the string they duplicate.
+
+  @param  StringPackage           Hii string package instance.
+
+  @retval EFI_SUCCESS             The lookup table was built.
+  @retval EFI_UNSUPPORTED         The string blocks contain an unknown block
+                                  type.
+  @retval EFI_OUT_OF_RESOURCES    The system is out of resources to accomplish the
+                                  task.
+
+**/
+STATIC
+EFI_STATUS
+BuildStringIdIndex (
+  IN OUT HII_STRING_PACKAGE_INSTANCE  *StringPackage
+  )
+{
+  HII_STRING_ID_INDEX_ENTRY            *Index;
+  UINTN                                IndexCount;
+  UINT8                                *BlockHdr;
+  UINT8                                *StringTextPtr;
+  UINTN                                BlockSize;
+  UINTN                                Offset;
+  UINTN                                StringSize;
+  UINTN                                CurrentStringId;
+  UINTN                                Count;
+  UINTN                                Hops;
+  UINT16                               StringCount;
+  UINT16                               SkipCount;
+  UINT8                                Length8;
+  UINT32                               Length32;
+  EFI_STRING_ID                        DuplicateId;
+  EFI_HII_SIBT_EXT2_BLOCK              Ext2;
+  BOOLEAN                              Ucs2;
+
+  IndexCount = (UINTN) StringPackage->MaxStringId + 1;
+  Index = AllocatePool (IndexCount * sizeof (HII_STRING_ID_INDEX_ENTRY));
+  if (Index == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  SetMem (Index, IndexCount * sizeof (HII_STRING_ID_INDEX_ENTRY), 0xFF);
+
+  CurrentStringId = 1;
+  BlockHdr        = StringPackage->StringBlock;
+  while (*BlockHdr != EFI_HII_SIBT_END) {
+    StringCount = 1;
+    Ucs2        = FALSE;
+    switch (*BlockHdr) {
+    case EFI_HII_SIBT_STRING_SCSU:
+      Offset = sizeof (EFI_HII_STRING_BLOCK);
+      break;
+
+    case EFI_HII_SIBT_STRING_SCSU_FONT:
+      Offset = sizeof (EFI_HII_SIBT_STRING_SCSU_FONT_BLOCK) - sizeof (UINT8);
+      break;
+
+    case EFI_HII_SIBT_STRINGS_SCSU:
+      CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+      Offset = sizeof (EFI_HII_SIBT_STRINGS_SCSU_BLOCK) - sizeof (UINT8);
+      break;
+
+    case EFI_HII_SIBT_STRINGS_SCSU_FONT:
+      CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT16));
+      Offset = sizeof (EFI_HII_SIBT_STRINGS_SCSU_FONT_BLOCK) - sizeof (UINT8);
+      break;
+
+    case EFI_HII_SIBT_STRING_UCS2:
+      Offset = sizeof (EFI_HII_STRING_BLOCK);
+      Ucs2   = TRUE;
+      break;
+
+    case EFI_HII_SIBT_STRING_UCS2_FONT:
+      Offset = sizeof (EFI_HII_SIBT_STRING_UCS2_FONT_BLOCK) - sizeof (CHAR16);
+      Ucs2   = TRUE;
+      break;
+
+    case EFI_HII_SIBT_STRINGS_UCS2:
+      CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+      Offset = sizeof (EFI_HII_SIBT_STRINGS_UCS2_BLOCK) - sizeof (CHAR16);
+      Ucs2   = TRUE;
+      break;
+
+    case EFI_HII_SIBT_STRINGS_UCS2_FONT:
+      CopyMem (&StringCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT16));
+      Offset = sizeof (EFI_HII_SIBT_STRINGS_UCS2_FONT_BLOCK) - sizeof (CHAR16);
+      Ucs2   = TRUE;
+      break;
+
+    case EFI_HII_SIBT_DUPLICATE:
+      CopyMem (&DuplicateId, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (EFI_STRING_ID));
+      if (CurrentStringId < IndexCount) {
+        Index[CurrentStringId].BlockOffset = HII_STRING_ID_INDEX_DUPLICATE;
+        Index[CurrentStringId].TextOffset  = DuplicateId;
+      }
+      CurrentStringId++;
+      BlockHdr += sizeof (EFI_HII_SIBT_DUPLICATE_BLOCK);
+      continue;
+
+    case EFI_HII_SIBT_SKIP1:
+      CurrentStringId += *(BlockHdr + sizeof (EFI_HII_STRING_BLOCK));
+      BlockHdr        += sizeof (EFI_HII_SIBT_SKIP1_BLOCK);
+      continue;
+
+    case EFI_HII_SIBT_SKIP2:
+      CopyMem (&SkipCount, BlockHdr + sizeof (EFI_HII_STRING_BLOCK), sizeof (UINT16));
+      CurrentStringId += SkipCount;
+      BlockHdr        += sizeof (EFI_HII_SIBT_SKIP2_BLOCK);
+      continue;
+
+    case EFI_HII_SIBT_EXT1:
+      CopyMem (&Length8, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT8));
+      BlockHdr += Length8;
+      continue;
+
+    case EFI_HII_SIBT_EXT2:
+      CopyMem (&Ext2, BlockHdr, sizeof (EFI_HII_SIBT_EXT2_BLOCK));
+      BlockHdr += Ext2.Length;
+      continue;
+
+    case EFI_HII_SIBT_EXT4:
+      CopyMem (&Length32, BlockHdr + sizeof (EFI_HII_STRING_BLOCK) + sizeof (UINT8), sizeof (UINT32));
+      BlockHdr += Length32;
+      continue;
+
+    default:
+      //
+      // The size of an unknown block cannot be determined; leave such
+      // packages to the full parse in FindStringBlock ().
+      //
+      FreePool (Index);
+      return EFI_UNSUPPORTED;
+    }
+
+    //
+    // Record every string of a string block.
+    //
+    StringTextPtr = BlockHdr + Offset;
+    for (Count = 0; Count < StringCount; Count++) {
+      if (CurrentStringId < IndexCount) {
+        Index[CurrentStringId].BlockOffset = (UINT32) (BlockHdr - StringPackage->StringBlock);
+        Index[CurrentStringId].TextOffset  = (UINT32) (StringTextPtr - BlockHdr);
+      }
+      if (Ucs2) {
+        GetUnicodeStringTextOrSize (NULL, StringTextPtr, &StringSize);
+      } else {
+        StringSize = AsciiStrSize ((CHAR8 *) StringTextPtr);
+      }
+      StringTextPtr += StringSize;
+      CurrentStringId++;
+    }
+    BlockSize = StringTextPtr - BlockHdr;
+    BlockHdr += BlockSize;
+  }
+
+  //
+  // Point duplicates at the string they duplicate. Chains are followed, and a
+  // chain that does not end at a string within MaxStringId hops is treated as
+  // not found.
+  //
+  for (CurrentStringId = 1; CurrentStringId < IndexCount; CurrentStringId++) {
+    if (Index[CurrentStringId].BlockOffset != HII_STRING_ID_INDEX_DUPLICATE) {
+      continue;
+    }
+    DuplicateId = (EFI_STRING_ID) CurrentStringId;
+    for (Hops = 0;
+         Hops < IndexCount && Index[DuplicateId].BlockOffset == HII_STRING_ID_INDEX_DUPLICATE;
+         Hops++) {
+      DuplicateId = (EFI_STRING_ID) Index[DuplicateId].TextOffset;
+      if (DuplicateId == 0 || DuplicateId >= IndexCount) {
+        break;
+      }
+    }
+    if (DuplicateId == 0 || DuplicateId >= IndexCount ||
+        Index[DuplicateId].BlockOffset == HII_STRING_ID_INDEX_DUPLICATE) {
+      Index[CurrentStringId].BlockOffset = HII_STRING_ID_INDEX_NOT_FOUND;
+    } else {
+      Index[CurrentStringId] = Index[DuplicateId];
+    }
+  }
+
+  StringPackage->StringIdIndex      = Index;
+  StringPackage->StringIdIndexCount = IndexCount;
+  return EFI_SUCCESS;
+}
+
 /**
   Parse all string blocks to find a String block specified by StringId.
   If StringId = (EFI_STRING_ID) (-1), find out all EFI_HII_SIBT_FONT blocks
@@ -297,6 +510,27 @@ FindStringBlock (
     if (StringId > StringPackage->MaxStringId) {
       return EFI_NOT_FOUND;
     }
+
+    //
+    // Callers that do not need StartStringId only care about the block of
+    // an existing string, which the lookup table provides directly. Fall
+    // back to parsing the blocks if the table cannot be built.
+    //
+    if (StartStringId == NULL) {
+      if (StringPackage->StringIdIndex == NULL) {
+        BuildStringIdIndex (StringPackage);
+      }
+      if (StringPackage->StringIdIndex != NULL &&
+          StringId < StringPackage->StringIdIndexCount) {
+        if (StringPackage->StringIdIndex[StringId].BlockOffset == HII_STRING_ID_INDEX_NOT_FOUND) {
+          return EFI_NOT_FOUND;
+        }
+        *StringBlockAddr  = StringPackage->StringBlock + StringPackage->StringIdIndex[StringId].BlockOffset;
+        *BlockType        = **StringBlockAddr;
+        *StringTextOffset = StringPackage->StringIdIndex[StringId].TextOffset;
+        return EFI_SUCCESS;
+      }
+    }
   } else {
     ASSERT (Private != NULL && Private->Signature == HII_DATABASE_PRIVATE_DATA_SIGNATURE);
     if (StringId == 0 && LastStringId != NULL) {
@@ -841,6 +1075,7 @@ InsertLackStringBlock (
   }
   FreePool (StringPackage->StringBlock);
   StringPackage->StringBlock = StringBlock;
+  FreeStringIdIndex (StringPackage);
   StringPackage->StringPkgHdr->Header.Length += NewBlockSize - OldBlockSize;
 
   return EFI_SUCCESS;
@@ -1009,6 +1244,7 @@ SetStringWorker (
     ZeroMem (StringPackage->StringBlock, OldBlockSize);
     FreePool (StringPackage->StringBlock);
     StringPackage->StringBlock = Block;
+    FreeStringIdIndex (StringPackage);
     StringPackage->StringPkgHdr->Header.Length += (UINT32) (BlockSize - OldBlockSize);
     break;
 
@@ -1043,6 +1279,7 @@ SetStringWorker (
     ZeroMem (StringPackage->StringBlock, OldBlockSize);
     FreePool (StringPackage->StringBlock);
     StringPackage->StringBlock = Block;
+    FreeStringIdIndex (StringPackage);
     StringPackage->StringPkgHdr->Header.Length += (UINT32) (BlockSize - OldBlockSize);
     break;
 
@@ -1095,6 +1332,7 @@ SetStringWorker (
   ZeroMem (StringPackage->StringBlock, OldBlockSize);
   FreePool (StringPackage->StringBlock);
   StringPackage->StringBlock = Block;
+  FreeStringIdIndex (StringPackage);
   StringPackage->StringPkgHdr->Header.Length += Ext2.Length;
 
   return EFI_SUCCESS;
@@ -1281,6 +1519,7 @@ HiiNewString (
       ZeroMem (StringPackage->StringBlock, OldBlockSize);
       FreePool (StringPackage->StringBlock);
       StringPackage->StringBlock = StringBlock;
+      FreeStringIdIndex (StringPackage);
       StringPackage->StringPkgHdr->Header.Length += Ucs2BlockSize;
       PackageListNode->PackageListHdr.PackageLength += Ucs2BlockSize;
     }
@@ -1413,6 +1652,7 @@ HiiNewString (
     ZeroMem (StringPackage->StringBlock, OldBlockSize);
     FreePool (StringPackage->StringBlock);
     StringPackage->StringBlock = StringBlock;
+    FreeStringIdIndex (StringPackage);
     StringPackage->StringPkgHdr->Header.Length += Ucs2BlockSize;
     PackageListNode->PackageListHdr.PackageLength += Ucs2BlockSize;
 
@@ -1456,6 +1696,7 @@ HiiNewString (
       ZeroMem (StringPackage->StringBlock, OldBlockSize);
       FreePool (StringPackage->StringBlock);
       StringPackage->StringBlock = StringBlock;
+      FreeStringIdIndex (StringPackage);
       StringPackage->StringPkgHdr->Header.Length += Ucs2FontBlockSize;
       PackageListNode->PackageListHdr.PackageLength += Ucs2FontBlockSize;
 
@@ -1518,6 +1759,7 @@ HiiNewString (
       ZeroMem (StringPackage->StringBlock, OldBlockSize);
       FreePool (StringPackage->StringBlock);
       StringPackage->StringBlock = StringBlock;
+      FreeStringIdIndex (StringPackage);
       StringPackage->StringPkgHdr->Header.Length += FontBlockSize + Ucs2FontBlockSize;
       PackageListNode->PackageListHdr.PackageLength += FontBlockSize + Ucs2FontBlockSize;
 
@@ -0,0 +1,864 @@
+/** @file
+  Unit tests and benchmark of the HII Config Routing Protocol in HiiDatabaseDxe.
+
+  A set of formsets of production size is registered through the HII Database
+  Protocol, each on its own driver handle with a device path and a Config
+  Access Protocol. The tests check that ExtractConfig () and RouteConfig ()
+  reach the driver of the <ConfigHdr>, including after a package list is
+  removed and added again, and report how long it takes to extract the whole
+  configuration of every formset and to export the whole database.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Protocol/DevicePath.h>
+#include <Protocol/HiiConfigAccess.h>
+#include <Protocol/HiiConfigRouting.h>
+#include <Protocol/HiiDatabase.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "HII Config Routing Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Number of formsets, each with its own package list and driver handle; a
+// server platform has this many setup pages with all its devices.
+//
+#define HII_CONFIG_TEST_FORMSET_COUNT   64
+
+//
+// Number of UINT16 numeric questions in the varstore of each formset.
+//
+#define HII_CONFIG_TEST_QUESTION_COUNT  64
+
+#define HII_CONFIG_TEST_VARSTORE_ID     1
+#define HII_CONFIG_TEST_VARSTORE_NAME   "HiiConfigTestData"
+#define HII_CONFIG_TEST_VARSTORE_SIZE   (HII_CONFIG_TEST_QUESTION_COUNT * sizeof (UINT16))
+
+//
+// Maximum size of the IFR of a formset.
+//
+#define HII_CONFIG_TEST_IFR_SIZE        (0x100 + HII_CONFIG_TEST_QUESTION_COUNT * 0x40)
+
+#pragma pack (1)
+typedef struct {
+  VENDOR_DEVICE_PATH        Vendor;
+  UINT32                    Index;
+  EFI_DEVICE_PATH_PROTOCOL  End;
+} HII_CONFIG_TEST_DEVICE_PATH;
+#pragma pack ()
+
+typedef struct {
+  EFI_HII_CONFIG_ACCESS_PROTOCOL  ConfigAccess;
+  HII_CONFIG_TEST_DEVICE_PATH     DevicePath;
+  EFI_HANDLE                      DriverHandle;
+  EFI_HII_HANDLE                  HiiHandle;
+  EFI_STRING                      ConfigHdr;
+  EFI_STRING                      LastRequest;
+  UINT16                          Storage[HII_CONFIG_TEST_QUESTION_COUNT];
+} HII_CONFIG_TEST_FORMSET;
+
+EFI_GUID  mHiiConfigTestFormSetGuid = {
+  0x2b6a3c51, 0x8e0d, 0x4f7c, { 0xa4, 0x19, 0x5d, 0x63, 0xe2, 0x0b, 0x97, 0x1c }
+};
+
+EFI_GUID  mHiiConfigTestVarStoreGuid = {
+  0xd0e4f7a2, 0x3c19, 0x4b85, { 0x8f, 0x6e, 0x21, 0xa9, 0x4d, 0x70, 0xbc, 0x35 }
+};
+
+EFI_HII_DATABASE_PROTOCOL        *mHiiDatabase;
+EFI_HII_CONFIG_ROUTING_PROTOCOL  *mHiiConfigRouting;
+HII_CONFIG_TEST_FORMSET          *mFormSets;
+
+/**
+  Return the default value of a question of a formset.
+
+  @param  Index     The index of the formset.
+  @param  Question  The index of the question.
+
+  @return The default value.
+**/
+UINT16
+GetTestDefault (
+  IN UINTN  Index,
+  IN UINTN  Question
+  )
+{
+  return (UINT16) (0x100 * Index + Question);
+}
+
+/**
+  Append an opcode to the IFR of a formset.
+
+  @param  Ifr       The end of the IFR, updated past the opcode.
+  @param  OpCode    The opcode.
+  @param  Length    The length of the opcode.
+  @param  Scope     Whether the opcode opens a scope.
+
+  @return The opcode, zeroed except for its header.
+**/
+VOID *
+AppendIfrOpCode (
+  IN OUT UINT8  **Ifr,
+  IN     UINT8  OpCode,
+  IN     UINTN  Length,
+  IN     UINT8  Scope
+  )
+{
+  EFI_IFR_OP_HEADER  *Header;
+
+  Header = (EFI_IFR_OP_HEADER *) *Ifr;
+  ZeroMem (Header, Length);
+  Header->OpCode = OpCode;
+  Header->Length = (UINT8) Length;
+  Header->Scope  = Scope;
+  *Ifr += Length;
+  return Header;
+}
+
+/**
+  Build a package list with a form package of one formset. The formset has
+  a buffer varstore of UINT16 numeric questions, each with a standard
+  default.
+
+  @param  Index     The index of the formset.
+
+  @return The package list, or NULL on allocation failure.
+**/
+EFI_HII_PACKAGE_LIST_HEADER *
+CreateTestPackageList (
+  IN UINTN  Index
+  )
+{
+  EFI_HII_PACKAGE_LIST_HEADER  *PackageList;
+  EFI_HII_PACKAGE_HEADER       *FormPackage;
+  EFI_HII_PACKAGE_HEADER       *EndPackage;
+  UINT8                        *Ifr;
+  EFI_IFR_FORM_SET             *FormSet;
+  EFI_IFR_VARSTORE             *VarStore;
+  EFI_IFR_DEFAULTSTORE         *DefaultStore;
+  EFI_IFR_FORM                 *Form;
+  EFI_IFR_NUMERIC              *Numeric;
+  EFI_IFR_DEFAULT              *Default;
+  UINTN                        Question;
+
+  PackageList = AllocateZeroPool (
+                  sizeof (EFI_HII_PACKAGE_LIST_HEADER) + sizeof (EFI_HII_PACKAGE_HEADER) +
+                  HII_CONFIG_TEST_IFR_SIZE + sizeof (EFI_HII_PACKAGE_HEADER)
+                  );
+  if (PackageList == NULL) {
+    return NULL;
+  }
+
+  CopyGuid (&PackageList->PackageListGuid, &mHiiConfigTestFormSetGuid);
+
+  FormPackage       = (EFI_HII_PACKAGE_HEADER *) (PackageList + 1);
+  FormPackage->Type = EFI_HII_PACKAGE_FORMS;
+  Ifr               = (UINT8 *) (FormPackage + 1);
+
+  FormSet = AppendIfrOpCode (&Ifr, EFI_IFR_FORM_SET_OP, sizeof (EFI_IFR_FORM_SET), 1);
+  CopyGuid (&FormSet->Guid, &mHiiConfigTestFormSetGuid);
+
+  VarStore = AppendIfrOpCode (
+               &Ifr,
+               EFI_IFR_VARSTORE_OP,
+               OFFSET_OF (EFI_IFR_VARSTORE, Name) + sizeof (HII_CONFIG_TEST_VARSTORE_NAME),
+               0
+               );
+  CopyGuid (&VarStore->Guid, &mHiiConfigTestVarStoreGuid);
+  VarStore->VarStoreId = HII_CONFIG_TEST_VARSTORE_ID;
+  VarStore->Size       = HII_CONFIG_TEST_VARSTORE_SIZE;
+  CopyMem (VarStore->Name, HII_CONFIG_TEST_VARSTORE_NAME, sizeof (HII_CONFIG_TEST_VARSTORE_NAME));
+
+  DefaultStore = AppendIfrOpCode (&Ifr, EFI_IFR_DEFAULTSTORE_OP, sizeof (EFI_IFR_DEFAULTSTORE), 0);
+  DefaultStore->DefaultId = EFI_HII_DEFAULT_CLASS_STANDARD;
+
+  Form = AppendIfrOpCode (&Ifr, EFI_IFR_FORM_OP, sizeof (EFI_IFR_FORM), 1);
+  Form->FormId = 1;
+
+  for (Question = 0; Question < HII_CONFIG_TEST_QUESTION_COUNT; Question++) {
+    Numeric = AppendIfrOpCode (
+                &Ifr,
+                EFI_IFR_NUMERIC_OP,
+                OFFSET_OF (EFI_IFR_NUMERIC, data) + sizeof (Numeric->data.u16),
+                1
+                );
+    Numeric->Question.QuestionId             = (EFI_QUESTION_ID) (Question + 1);
+    Numeric->Question.VarStoreId             = HII_CONFIG_TEST_VARSTORE_ID;
+    Numeric->Question.VarStoreInfo.VarOffset = (UINT16) (Question * sizeof (UINT16));
+    Numeric->Flags                           = EFI_IFR_NUMERIC_SIZE_2;
+    Numeric->data.u16.MaxValue               = MAX_UINT16;
+    Numeric->data.u16.Step                   = 1;
+
+    Default = AppendIfrOpCode (
+                &Ifr,
+                EFI_IFR_DEFAULT_OP,
+                OFFSET_OF (EFI_IFR_DEFAULT, Value) + sizeof (UINT16),
+                0
+                );
+    Default->DefaultId = EFI_HII_DEFAULT_CLASS_STANDARD;
+    Default->Type      = EFI_IFR_TYPE_NUM_SIZE_16;
+    Default->Value.u16 = GetTestDefault (Index, Question);
+
+    AppendIfrOpCode (&Ifr, EFI_IFR_END_OP, sizeof (EFI_IFR_END), 0);
+  }
+
+  AppendIfrOpCode (&Ifr, EFI_IFR_END_OP, sizeof (EFI_IFR_END), 0);
+  AppendIfrOpCode (&Ifr, EFI_IFR_END_OP, sizeof (EFI_IFR_END), 0);
+  FormPackage->Length = (UINT32) (Ifr - (UINT8 *) FormPackage);
+
+  EndPackage = (EFI_HII_PACKAGE_HEADER *) Ifr;
+  EndPackage->Type   = EFI_HII_PACKAGE_END;
+  EndPackage->Length = sizeof (EFI_HII_PACKAGE_HEADER);
+
+  PackageList->PackageLength = (UINT32) ((UINT8 *) (EndPackage + 1) - (UINT8 *) PackageList);
+  return PackageList;
+}
+
+/**
+  Append the hex string of a buffer, in byte order, to a <ConfigHdr>.
+
+  @param  String    The end of the string, updated past the hex digits.
+  @param  Buffer    The buffer.
+  @param  Size      The size of the buffer in bytes.
+**/
+VOID
+AppendHexString (
+  IN OUT CHAR16       **String,
+  IN     CONST UINT8  *Buffer,
+  IN     UINTN        Size
+  )
+{
+  for (; Size > 0; Size--, Buffer++) {
+    UnicodeSPrint (*String, 3 * sizeof (CHAR16), L"%02x", *Buffer);
+    *String += 2;
+  }
+}
+
+/**
+  Build the <ConfigHdr> of the varstore of a formset.
+
+  @param  FormSet   The formset.
+
+  @return The <ConfigHdr>, or NULL on allocation failure.
+**/
+EFI_STRING
+CreateTestConfigHdr (
+  IN HII_CONFIG_TEST_FORMSET  *FormSet
+  )
+{
+  EFI_STRING   ConfigHdr;
+  CHAR16       *String;
+  CONST CHAR8  *Name;
+
+  ConfigHdr = AllocateZeroPool (
+                (5 + 2 * sizeof (EFI_GUID) + 6 + 4 * sizeof (HII_CONFIG_TEST_VARSTORE_NAME) +
+                 6 + 2 * sizeof (FormSet->DevicePath) + 1) * sizeof (CHAR16)
+                );
+  if (ConfigHdr == NULL) {
+    return NULL;
+  }
+
+  String = ConfigHdr;
+  StrCpyS (String, 6, L"GUID=");
+  String += 5;
+  AppendHexString (&String, (UINT8 *) &mHiiConfigTestVarStoreGuid, sizeof (EFI_GUID));
+  StrCpyS (String, 7, L"&NAME=");
+  String += 6;
+  for (Name = HII_CONFIG_TEST_VARSTORE_NAME; *Name != '\0'; Name++) {
+    UnicodeSPrint (String, 5 * sizeof (CHAR16), L"%04x", *Name);
+    String += 4;
+  }
+  StrCpyS (String, 7, L"&PATH=");
+  String += 6;
+  AppendHexString (&String, (UINT8 *) &FormSet->DevicePath, sizeof (FormSet->DevicePath));
+
+  return ConfigHdr;
+}
+
+/**
+  This function allows a caller to extract the current configuration for one
+  or more named elements from the varstore of a test formset.
+
+  A request without elements is refused, so the HII database has to complete
+  it from the IFR before the driver is called.
+
+  @param  This       Points to the EFI_HII_CONFIG_ACCESS_PROTOCOL.
+  @param  Request    A null-terminated Unicode string in <ConfigRequest>
+                     format, or NULL for the whole varstore.
+  @param  Progress   On return, points to a character in the Request string.
+  @param  Results    A null-terminated Unicode string in <ConfigAltResp>
+                     format.
+
+  @retval EFI_SUCCESS            The Results is filled with the requested values.
+  @retval EFI_NOT_FOUND          The request has no elements.
+  @retval Others                 The request can't be converted.
+**/
+EFI_STATUS
+EFIAPI
+TestExtractConfig (
+  IN  CONST EFI_HII_CONFIG_ACCESS_PROTOCOL  *This,
+  IN  CONST EFI_STRING                      Request,
+  OUT EFI_STRING                            *Progress,
+  OUT EFI_STRING                            *Results
+  )
+{
+  HII_CONFIG_TEST_FORMSET  *FormSet;
+  EFI_STRING               FullRequest;
+  UINTN                    Size;
+  EFI_STATUS               Status;
+
+  FormSet = BASE_CR (This, HII_CONFIG_TEST_FORMSET, ConfigAccess);
+
+  if (FormSet->LastRequest != NULL) {
+    FreePool (FormSet->LastRequest);
+    FormSet->LastRequest = NULL;
+  }
+
+  if (Request == NULL) {
+    //
+    // Export the whole varstore as one block.
+    //
+    Size = StrSize (FormSet->ConfigHdr) + 64 * sizeof (CHAR16);
+    FullRequest = AllocateZeroPool (Size);
+    if (FullRequest == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    UnicodeSPrint (FullRequest, Size, L"%s&OFFSET=0&WIDTH=%x", FormSet->ConfigHdr, HII_CONFIG_TEST_VARSTORE_SIZE);
+    Status = mHiiConfigRouting->BlockToConfig (
+                                  mHiiConfigRouting,
+                                  FullRequest,
+                                  (UINT8 *) FormSet->Storage,
+                                  HII_CONFIG_TEST_VARSTORE_SIZE,
+                                  Results,
+                                  Progress
+                                  );
+    FreePool (FullRequest);
+    *Progress = NULL;
+    return Status;
+  }
+
+  FormSet->LastRequest = AllocateCopyPool (StrSize (Request), Request);
+  *Progress = Request;
+  if (StrStr (Request, L"&OFFSET=") == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  return mHiiConfigRouting->BlockToConfig (
+                              mHiiConfigRouting,
+                              Request,
+                              (UINT8 *) FormSet->Storage,
+                              HII_CONFIG_TEST_VARSTORE_SIZE,
+                              Results,
+                              Progress
+                              );
+}
+
+/**
+  This function applies changes in a driver's configuration to the varstore
+  of a test formset.
+
+  @param  This           Points to the EFI_HII_CONFIG_ACCESS_PROTOCOL.
+  @param  Configuration  A null-terminated Unicode string in <ConfigResp>
+                         format.
+  @param  Progress       A pointer to a string filled in with the offset of
+                         the most recent '&' before the first failing
+                         name/value pair.
+
+  @retval EFI_SUCCESS    The results have been distributed.
+  @retval Others         The configuration can't be converted.
+**/
+EFI_STATUS
+EFIAPI
+TestRouteConfig (
+  IN  CONST EFI_HII_CONFIG_ACCESS_PROTOCOL  *This,
+  IN  CONST EFI_STRING                      Configuration,
+  OUT EFI_STRING                            *Progress
+  )
+{
+  HII_CONFIG_TEST_FORMSET  *FormSet;
+  UINTN                    Size;
+
+  FormSet = BASE_CR (This, HII_CONFIG_TEST_FORMSET, ConfigAccess);
+  Size    = HII_CONFIG_TEST_VARSTORE_SIZE;
+  return mHiiConfigRouting->ConfigToBlock (
+                              mHiiConfigRouting,
+                              Configuration,
+                              (UINT8 *) FormSet->Storage,
+                              &Size,
+                              Progress
+                              );
+}
+
+/**
+  The test formsets have no interactive questions.
+
+  @param  This           Points to the EFI_HII_CONFIG_ACCESS_PROTOCOL.
+  @param  Action         Specifies the type of action taken by the browser.
+  @param  QuestionId     A unique value which is sent to the original
+                         exporting driver.
+  @param  Type           The type of value for the question.
+  @param  Value          A pointer to the data being sent to the original
+                         exporting driver.
+  @param  ActionRequest  On return, points to the action requested by the
+                         callback function.
+
+  @retval EFI_UNSUPPORTED  The callback is not supported.
+**/
+EFI_STATUS
+EFIAPI
+TestCallback (
+  IN  CONST EFI_HII_CONFIG_ACCESS_PROTOCOL  *This,
+  IN  EFI_BROWSER_ACTION                    Action,
+  IN  EFI_QUESTION_ID                       QuestionId,
+  IN  UINT8                                 Type,
+  IN  EFI_IFR_TYPE_VALUE                    *Value,
+  OUT EFI_BROWSER_ACTION_REQUEST            *ActionRequest
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Register the package list of a test formset on its driver handle.
+
+  @param  Index     The index of the formset.
+
+  @retval EFI_SUCCESS    The package list is registered.
+  @retval Others         The package list can't be built or registered.
+**/
+EFI_STATUS
+AddTestPackageList (
+  IN UINTN  Index
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_HII_PACKAGE_LIST_HEADER  *PackageList;
+
+  PackageList = CreateTestPackageList (Index);
+  if (PackageList == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = mHiiDatabase->NewPackageList (
+                           mHiiDatabase,
+                           PackageList,
+                           mFormSets[Index].DriverHandle,
+                           &mFormSets[Index].HiiHandle
+                           );
+  FreePool (PackageList);
+  return Status;
+}
+
+/**
+  Free the test formsets.
+
+  @param[in]  Context  Unused.
+**/
+VOID
+EFIAPI
+RemoveTestFormSets (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN                    Index;
+  HII_CONFIG_TEST_FORMSET  *FormSet;
+
+  if (mFormSets == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < HII_CONFIG_TEST_FORMSET_COUNT; Index++) {
+    FormSet = &mFormSets[Index];
+    if (FormSet->HiiHandle != NULL) {
+      mHiiDatabase->RemovePackageList (mHiiDatabase, FormSet->HiiHandle);
+    }
+    if (FormSet->DriverHandle != NULL) {
+      gBS->UninstallMultipleProtocolInterfaces (
+             FormSet->DriverHandle,
+             &gEfiDevicePathProtocolGuid,
+             &FormSet->DevicePath,
+             &gEfiHiiConfigAccessProtocolGuid,
+             &FormSet->ConfigAccess,
+             NULL
+             );
+    }
+    if (FormSet->ConfigHdr != NULL) {
+      FreePool (FormSet->ConfigHdr);
+    }
+    if (FormSet->LastRequest != NULL) {
+      FreePool (FormSet->LastRequest);
+    }
+  }
+
+  FreePool (mFormSets);
+  mFormSets = NULL;
+}
+
+/**
+  Register the test formsets, each on a driver handle with a vendor device
+  path and a Config Access Protocol.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The formsets were registered.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The HII protocols are missing
+                                         or the registration failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RegisterTestFormSets (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS               Status;
+  UINTN                    Index;
+  HII_CONFIG_TEST_FORMSET  *FormSet;
+
+  Status = gBS->LocateProtocol (&gEfiHiiDatabaseProtocolGuid, NULL, (VOID **) &mHiiDatabase);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  Status = gBS->LocateProtocol (&gEfiHiiConfigRoutingProtocolGuid, NULL, (VOID **) &mHiiConfigRouting);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  mFormSets = AllocateZeroPool (HII_CONFIG_TEST_FORMSET_COUNT * sizeof (HII_CONFIG_TEST_FORMSET));
+  if (mFormSets == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  for (Index = 0; Index < HII_CONFIG_TEST_FORMSET_COUNT; Index++) {
+    FormSet = &mFormSets[Index];
+    FormSet->ConfigAccess.ExtractConfig = TestExtractConfig;
+    FormSet->ConfigAccess.RouteConfig   = TestRouteConfig;
+    FormSet->ConfigAccess.Callback      = TestCallback;
+
+    FormSet->DevicePath.Vendor.Header.Type    = HARDWARE_DEVICE_PATH;
+    FormSet->DevicePath.Vendor.Header.SubType = HW_VENDOR_DP;
+    SetDevicePathNodeLength (&FormSet->DevicePath.Vendor.Header, sizeof (VENDOR_DEVICE_PATH) + sizeof (UINT32));
+    CopyGuid (&FormSet->DevicePath.Vendor.Guid, &mHiiConfigTestFormSetGuid);
+    FormSet->DevicePath.Index = (UINT32) Index;
+    SetDevicePathEndNode (&FormSet->DevicePath.End);
+
+    FormSet->ConfigHdr = CreateTestConfigHdr (FormSet);
+    if (FormSet->ConfigHdr == NULL) {
+      goto Error;
+    }
+
+    Status = gBS->InstallMultipleProtocolInterfaces (
+                    &FormSet->DriverHandle,
+                    &gEfiDevicePathProtocolGuid,
+                    &FormSet->DevicePath,
+                    &gEfiHiiConfigAccessProtocolGuid,
+                    &FormSet->ConfigAccess,
+                    NULL
+                    );
+    if (EFI_ERROR (Status)) {
+      FormSet->DriverHandle = NULL;
+      goto Error;
+    }
+
+    Status = AddTestPackageList (Index);
+    if (EFI_ERROR (Status)) {
+      FormSet->HiiHandle = NULL;
+      goto Error;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+
+Error:
+  RemoveTestFormSets (NULL);
+  return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+}
+
+/**
+  Extract the whole configuration of a formset by its <ConfigHdr> and check
+  that every question is returned with its current value and its default.
+
+  @param  Index     The index of the formset.
+
+  @retval UNIT_TEST_PASSED               The configuration is complete.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A value or default is missing.
+**/
+UNIT_TEST_STATUS
+CheckExtractConfig (
+  IN UINTN  Index
+  )
+{
+  EFI_STATUS  Status;
+  EFI_STRING  Progress;
+  EFI_STRING  Results;
+  CHAR16      Expected[64];
+  UINTN       Question;
+
+  Status = mHiiConfigRouting->ExtractConfig (
+                                mHiiConfigRouting,
+                                mFormSets[Index].ConfigHdr,
+                                &Progress,
+                                &Results
+                                );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // The driver was called with the questions of the IFR.
+  //
+  UT_ASSERT_NOT_NULL (mFormSets[Index].LastRequest);
+  UT_ASSERT_NOT_NULL (StrStr (mFormSets[Index].LastRequest, L"&OFFSET="));
+
+  UT_ASSERT_NOT_NULL (StrStr (Results, L"&ALTCFG=0000"));
+  for (Question = 0; Question < HII_CONFIG_TEST_QUESTION_COUNT; Question++) {
+    UnicodeSPrint (
+      Expected,
+      sizeof (Expected),
+      L"&OFFSET=%04x&WIDTH=0002&VALUE=%04x",
+      Question * sizeof (UINT16),
+      GetTestDefault (Index, Question)
+      );
+    UT_ASSERT_NOT_NULL (StrStr (Results, Expected));
+  }
+
+  FreePool (Results);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Extract every formset by its <ConfigHdr> twice and export the database
+  twice, and log the time each pass took. The first passes include building
+  the routing index.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               Every configuration was complete.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A value or default was missing.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ExtractAllConfigTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+  EFI_STATUS        Status;
+  UINTN             Pass;
+  UINTN             Index;
+  UINT64            Start;
+  UINT64            ExtractNs[2];
+  UINT64            ExportNs[2];
+  EFI_STRING        Results;
+
+  for (Pass = 0; Pass < 2; Pass++) {
+    Start = GetPerformanceCounter ();
+    for (Index = 0; Index < HII_CONFIG_TEST_FORMSET_COUNT; Index++) {
+      TestStatus = CheckExtractConfig (Index);
+      if (TestStatus != UNIT_TEST_PASSED) {
+        return TestStatus;
+      }
+    }
+    ExtractNs[Pass] = GetTimeInNanoSecond (GetPerformanceCounter () - Start);
+  }
+
+  for (Pass = 0; Pass < 2; Pass++) {
+    Start  = GetPerformanceCounter ();
+    Status = mHiiConfigRouting->ExportConfig (mHiiConfigRouting, &Results);
+    ExportNs[Pass] = GetTimeInNanoSecond (GetPerformanceCounter () - Start);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    for (Index = 0; Index < HII_CONFIG_TEST_FORMSET_COUNT; Index++) {
+      UT_ASSERT_NOT_NULL (StrStr (Results, mFormSets[Index].ConfigHdr));
+    }
+    FreePool (Results);
+  }
+
+  UT_LOG_INFO (
+    "%d formsets of %d questions: ExtractConfig %ld us then %ld us, ExportConfig %ld us then %ld us\n",
+    HII_CONFIG_TEST_FORMSET_COUNT,
+    HII_CONFIG_TEST_QUESTION_COUNT,
+    DivU64x32 (ExtractNs[0], 1000),
+    DivU64x32 (ExtractNs[1], 1000),
+    DivU64x32 (ExportNs[0], 1000),
+    DivU64x32 (ExportNs[1], 1000)
+    );
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Route a new value to one formset and check that only its varstore changes.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The value reached the right driver.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    The value was lost or misrouted.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RouteConfigTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_STRING  Progress;
+  EFI_STRING  ConfigResp;
+  UINTN       Size;
+  UINTN       Target;
+  UINTN       Index;
+
+  Target = HII_CONFIG_TEST_FORMSET_COUNT / 2 + 1;
+  Size   = StrSize (mFormSets[Target].ConfigHdr) + 64 * sizeof (CHAR16);
+  ConfigResp = AllocateZeroPool (Size);
+  UT_ASSERT_NOT_NULL (ConfigResp);
+  UnicodeSPrint (ConfigResp, Size, L"%s&OFFSET=0002&WIDTH=0002&VALUE=5a5a", mFormSets[Target].ConfigHdr);
+
+  Status = mHiiConfigRouting->RouteConfig (mHiiConfigRouting, ConfigResp, &Progress);
+  FreePool (ConfigResp);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  for (Index = 0; Index < HII_CONFIG_TEST_FORMSET_COUNT; Index++) {
+    UT_ASSERT_EQUAL (mFormSets[Index].Storage[1], (Index == Target) ? 0x5a5a : 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Remove the package list of a formset, check that requests to it reach the
+  driver without the questions of the IFR, then add it back and check that
+  they are completed again.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               Routing followed the package lists.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A stale package list was used.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PackageListUpdateTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+  EFI_STATUS        Status;
+  EFI_STRING        Progress;
+  EFI_STRING        Results;
+  UINTN             Target;
+
+  //
+  // Warm the routing index up, so that the removal has to invalidate it.
+  //
+  Target = 3;
+  TestStatus = CheckExtractConfig (Target);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  Status = mHiiDatabase->RemovePackageList (mHiiDatabase, mFormSets[Target].HiiHandle);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  mFormSets[Target].HiiHandle = NULL;
+
+  //
+  // Without IFR, the driver gets the bare header and refuses it.
+  //
+  Results = NULL;
+  Status  = mHiiConfigRouting->ExtractConfig (
+                                 mHiiConfigRouting,
+                                 mFormSets[Target].ConfigHdr,
+                                 &Progress,
+                                 &Results
+                                 );
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+  UT_ASSERT_NOT_NULL (mFormSets[Target].LastRequest);
+  UT_ASSERT_TRUE (StrStr (mFormSets[Target].LastRequest, L"&OFFSET=") == NULL);
+
+  TestStatus = CheckExtractConfig (Target + 1);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  Status = AddTestPackageList (Target);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  return CheckExtractConfig (Target);
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the HII
+  Config Routing Protocol and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      RoutingTests;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the HII Config Routing Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&RoutingTests, Fw, "HII Config Routing", "HiiDatabaseDxe.ConfigRouting", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RoutingTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite--------Description-------------------------------------Class Name-----Function---------------Pre-------------------Post----------------Context
+  AddTestCase (RoutingTests, "Extract and export the config of all formsets", "ExtractAll",  ExtractAllConfigTest,  RegisterTestFormSets, RemoveTestFormSets, NULL);
+  AddTestCase (RoutingTests, "RouteConfig reaches the driver of the header",  "RouteConfig", RouteConfigTest,       RegisterTestFormSets, RemoveTestFormSets, NULL);
+  AddTestCase (RoutingTests, "Routing follows package list changes",          "Update",      PackageListUpdateTest, RegisterTestFormSets, RemoveTestFormSets, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework (Fw);
+  }
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+HiiConfigRoutingUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,428 @@
+/** @file
+  Unit tests and benchmark of the HII string lookup in HiiDatabaseDxe.
+
+  A string package of production size is registered through the HII Database
+  Protocol. Every string ID is then read back with the HII String Protocol,
+  which checks the StringId lookup table of FindStringBlock () and reports how
+  long the enumeration of the whole language takes.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Protocol/HiiDatabase.h>
+#include <Protocol/HiiString.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME     "HII String Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Number of string IDs in the test package; large setup menus have several
+// thousand strings per language.
+//
+#define HII_STRING_TEST_COUNT        8192
+
+//
+// Every HII_STRING_TEST_SKIP_PERIOD-th string ID is left untranslated, as in
+// a partially translated package.
+//
+#define HII_STRING_TEST_SKIP_PERIOD  16
+
+#define HII_STRING_TEST_LANGUAGE     "en-US"
+#define HII_STRING_TEST_MAX_LENGTH   32
+
+EFI_GUID  mHiiStringTestPackageListGuid = {
+  0x6c1f8a4e, 0x5b37, 0x4d29, { 0x9e, 0x42, 0x1a, 0x7b, 0x3c, 0x80, 0xd5, 0x6f }
+};
+
+EFI_HII_DATABASE_PROTOCOL  *mHiiDatabase;
+EFI_HII_STRING_PROTOCOL    *mHiiString;
+EFI_HII_HANDLE             mHiiHandle;
+
+/**
+  Return whether the test package leaves a string ID untranslated.
+
+  @param  StringId  The string ID.
+
+  @retval TRUE   The string ID is covered by a SKIP block.
+  @retval FALSE  The string ID has a string.
+**/
+BOOLEAN
+IsSkippedStringId (
+  IN EFI_STRING_ID  StringId
+  )
+{
+  return (BOOLEAN) (StringId > 1 && (StringId % HII_STRING_TEST_SKIP_PERIOD) == 0);
+}
+
+/**
+  Format the text the test package holds for a string ID.
+
+  @param  StringId  The string ID.
+  @param  Buffer    Receives the string, HII_STRING_TEST_MAX_LENGTH characters.
+**/
+VOID
+FormatTestString (
+  IN  EFI_STRING_ID  StringId,
+  OUT CHAR16         *Buffer
+  )
+{
+  if (StringId == 1) {
+    StrCpyS (Buffer, HII_STRING_TEST_MAX_LENGTH, L"English");
+  } else {
+    UnicodeSPrint (
+      Buffer,
+      HII_STRING_TEST_MAX_LENGTH * sizeof (CHAR16),
+      L"Setup string %d",
+      StringId
+      );
+  }
+}
+
+/**
+  Build a package list with one string package.
+
+  String ID 1 is the language name. The other IDs are
+  EFI_HII_SIBT_STRING_UCS2 blocks, except for the skipped ones.
+
+  @return The package list, or NULL on allocation failure.
+**/
+EFI_HII_PACKAGE_LIST_HEADER *
+CreateTestPackageList (
+  VOID
+  )
+{
+  EFI_HII_PACKAGE_LIST_HEADER  *PackageList;
+  EFI_HII_STRING_PACKAGE_HDR   *StringPackage;
+  EFI_HII_PACKAGE_HEADER       *EndPackage;
+  UINT8                        *Block;
+  UINTN                        HdrSize;
+  UINTN                        Size;
+  UINTN                        TextSize;
+  EFI_STRING_ID                StringId;
+  CHAR16                       Text[HII_STRING_TEST_MAX_LENGTH];
+
+  HdrSize = sizeof (EFI_HII_STRING_PACKAGE_HDR) - sizeof (CHAR8) +
+            sizeof (HII_STRING_TEST_LANGUAGE);
+  Size    = sizeof (EFI_HII_PACKAGE_LIST_HEADER) + HdrSize +
+            HII_STRING_TEST_COUNT * (sizeof (EFI_HII_STRING_BLOCK) + sizeof (Text)) +
+            sizeof (EFI_HII_STRING_BLOCK) + sizeof (EFI_HII_PACKAGE_HEADER);
+  PackageList = AllocateZeroPool (Size);
+  if (PackageList == NULL) {
+    return NULL;
+  }
+
+  CopyGuid (&PackageList->PackageListGuid, &mHiiStringTestPackageListGuid);
+
+  StringPackage = (EFI_HII_STRING_PACKAGE_HDR *) (PackageList + 1);
+  StringPackage->Header.Type      = EFI_HII_PACKAGE_STRINGS;
+  StringPackage->HdrSize          = (UINT32) HdrSize;
+  StringPackage->StringInfoOffset = (UINT32) HdrSize;
+  StringPackage->LanguageName     = 1;
+  CopyMem (StringPackage->Language, HII_STRING_TEST_LANGUAGE, sizeof (HII_STRING_TEST_LANGUAGE));
+
+  Block = (UINT8 *) StringPackage + HdrSize;
+  for (StringId = 1; StringId <= HII_STRING_TEST_COUNT; StringId++) {
+    if (IsSkippedStringId (StringId)) {
+      *Block++ = EFI_HII_SIBT_SKIP1;
+      *Block++ = 1;
+      continue;
+    }
+    FormatTestString (StringId, Text);
+    TextSize = StrSize (Text);
+    *Block++ = EFI_HII_SIBT_STRING_UCS2;
+    CopyMem (Block, Text, TextSize);
+    Block += TextSize;
+  }
+  *Block++ = EFI_HII_SIBT_END;
+  StringPackage->Header.Length = (UINT32) (Block - (UINT8 *) StringPackage);
+
+  EndPackage = (EFI_HII_PACKAGE_HEADER *) Block;
+  EndPackage->Type   = EFI_HII_PACKAGE_END;
+  EndPackage->Length = sizeof (EFI_HII_PACKAGE_HEADER);
+
+  PackageList->PackageLength = (UINT32) ((UINT8 *) (EndPackage + 1) - (UINT8 *) PackageList);
+  return PackageList;
+}
+
+/**
+  Read back every string ID of the test package and compare it with the
+  expected text.
+
+  @param  ChangedStringId  A string ID that has been set to ChangedString,
+                           or 0.
+  @param  ChangedString    The text of ChangedStringId.
+  @param  ElapsedNs        Receives the time the enumeration took.
+
+  @retval UNIT_TEST_PASSED               All strings matched.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A string did not match.
+**/
+UNIT_TEST_STATUS
+EnumerateTestStrings (
+  IN  EFI_STRING_ID  ChangedStringId,
+  IN  CONST CHAR16   *ChangedString,
+  OUT UINT64         *ElapsedNs
+  )
+{
+  EFI_STATUS     Status;
+  EFI_STRING_ID  StringId;
+  CHAR16         Expected[HII_STRING_TEST_MAX_LENGTH];
+  CHAR16         Actual[HII_STRING_TEST_MAX_LENGTH];
+  UINTN          ActualSize;
+  UINT64         Start;
+
+  Start = GetPerformanceCounter ();
+  for (StringId = 1; StringId <= HII_STRING_TEST_COUNT; StringId++) {
+    ActualSize = sizeof (Actual);
+    Status = mHiiString->GetString (
+                           mHiiString,
+                           HII_STRING_TEST_LANGUAGE,
+                           mHiiHandle,
+                           StringId,
+                           Actual,
+                           &ActualSize,
+                           NULL
+                           );
+    if (StringId == ChangedStringId) {
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_MEM_EQUAL (Actual, ChangedString, StrSize (ChangedString));
+    } else if (IsSkippedStringId (StringId)) {
+      UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+    } else {
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      FormatTestString (StringId, Expected);
+      UT_ASSERT_MEM_EQUAL (Actual, Expected, StrSize (Expected));
+    }
+  }
+  *ElapsedNs = GetTimeInNanoSecond (GetPerformanceCounter () - Start);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Register the test package list.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               The package list was registered.
+  @retval UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  The HII protocols are missing
+                                         or the registration failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RegisterTestPackageList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_HII_PACKAGE_LIST_HEADER  *PackageList;
+
+  Status = gBS->LocateProtocol (&gEfiHiiDatabaseProtocolGuid, NULL, (VOID **) &mHiiDatabase);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  Status = gBS->LocateProtocol (&gEfiHiiStringProtocolGuid, NULL, (VOID **) &mHiiString);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  PackageList = CreateTestPackageList ();
+  if (PackageList == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  Status = mHiiDatabase->NewPackageList (mHiiDatabase, PackageList, NULL, &mHiiHandle);
+  FreePool (PackageList);
+  if (EFI_ERROR (Status)) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Remove the test package list.
+
+  @param[in]  Context  Unused.
+**/
+VOID
+EFIAPI
+RemoveTestPackageList (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mHiiHandle != NULL) {
+    mHiiDatabase->RemovePackageList (mHiiDatabase, mHiiHandle);
+    mHiiHandle = NULL;
+  }
+}
+
+/**
+  Enumerate all strings of the language twice and log the time each pass
+  took. The first pass includes building the lookup table.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               All strings matched.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A string did not match.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+GetAllStringsTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  Status;
+  UINT64            FirstNs;
+  UINT64            SecondNs;
+
+  Status = EnumerateTestStrings (0, NULL, &FirstNs);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+  Status = EnumerateTestStrings (0, NULL, &SecondNs);
+  if (Status != UNIT_TEST_PASSED) {
+    return Status;
+  }
+
+  UT_LOG_INFO (
+    "%d strings: first pass %ld us, second pass %ld us\n",
+    HII_STRING_TEST_COUNT,
+    DivU64x32 (FirstNs, 1000),
+    DivU64x32 (SecondNs, 1000)
+    );
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Change a translated and an untranslated string, which moves the string
+  blocks around, and check that every string is still found.
+
+  @param[in]  Context  Unused.
+
+  @retval UNIT_TEST_PASSED               All strings matched.
+  @retval UNIT_TEST_ERROR_TEST_FAILED    A string did not match.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetStringTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS        Status;
+  UNIT_TEST_STATUS  TestStatus;
+  EFI_STRING_ID     StringId;
+  UINT64            ElapsedNs;
+  CHAR16            *NewString;
+
+  //
+  // Warm the lookup table up, so the following SetString () calls have to
+  // invalidate it.
+  //
+  TestStatus = EnumerateTestStrings (0, NULL, &ElapsedNs);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  //
+  // A longer text for a string near the start shifts every block after it.
+  //
+  NewString = L"A much longer replacement text";
+  StringId  = 3;
+  Status = mHiiString->SetString (mHiiString, mHiiHandle, StringId, HII_STRING_TEST_LANGUAGE, NewString, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  TestStatus = EnumerateTestStrings (StringId, NewString, &ElapsedNs);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  //
+  // Setting an untranslated string splits its SKIP block.
+  //
+  NewString = L"Translated late";
+  StringId  = HII_STRING_TEST_SKIP_PERIOD * 2;
+  ASSERT (IsSkippedStringId (StringId));
+  Status = mHiiString->SetString (mHiiString, mHiiHandle, StringId, HII_STRING_TEST_LANGUAGE, NewString, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  return EnumerateTestStrings (StringId, NewString, &ElapsedNs);
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the HII
+  string lookup and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      StringTests;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the HII String Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&StringTests, Fw, "HII String Lookup", "HiiDatabaseDxe.String", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for StringTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  // --------------Suite-------Description--------------------------Class Name-----Function-----------Pre----------------------Post-------------------Context
+  AddTestCase (StringTests, "Enumerate all strings of a language", "GetAll",       GetAllStringsTest, RegisterTestPackageList, RemoveTestPackageList, NULL);
+  AddTestCase (StringTests, "Strings are found after SetString",   "SetString",    SetStringTest,     RegisterTestPackageList, RemoveTestPackageList, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework (Fw);
+  }
+
+  return Status;
+}
+
+/**
+  Standard UEFI entry point for target based unit test execution from UEFI Shell.
+**/
+EFI_STATUS
+EFIAPI
+HiiStringUnitTestAppEntry (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  return UnitTestingEntry ();
+}
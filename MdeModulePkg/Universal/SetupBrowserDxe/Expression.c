@@ -843,6 +843,57 @@ IdToQuestion2 (
 }
 
 
+/**
+  Search a Question in FormSet->QuestionHash using its QuestionId.
+
+  A Question of the form is preferred, then the first Question in the order of
+  the forms, like IdToQuestion () without the hash.
+
+  @param  FormSet                The formset which contains this form.
+  @param  Form                   The form which contains this Question.
+  @param  QuestionId             Id of this Question.
+
+  @retval Pointer                The Question.
+  @retval NULL                   Specified Question not found in the formset.
+
+**/
+FORM_BROWSER_STATEMENT *
+LookupQuestion (
+  IN FORM_BROWSER_FORMSET  *FormSet,
+  IN FORM_BROWSER_FORM     *Form,
+  IN UINT16                QuestionId
+  )
+{
+  FORM_BROWSER_STATEMENT  *Question;
+  FORM_BROWSER_STATEMENT  *FirstQuestion;
+
+  if (QuestionId == 0) {
+    //
+    // The value of zero is reserved
+    //
+    return NULL;
+  }
+
+  FirstQuestion = NULL;
+  Question      = FormSet->QuestionHash[QuestionId & (FormSet->QuestionHashSize - 1)];
+  while (Question != NULL) {
+    if (Question->QuestionId == QuestionId) {
+      if (Question->ParentForm == Form) {
+        return Question;
+      }
+
+      if (FirstQuestion == NULL) {
+        FirstQuestion = Question;
+      }
+    }
+
+    Question = Question->NextQuestion;
+  }
+
+  return FirstQuestion;
+}
+
+
 /**
   Search a Question in Formset scope using its QuestionId.
 
@@ -864,6 +915,23 @@ IdToQuestion (
   LIST_ENTRY              *Link;
   FORM_BROWSER_STATEMENT  *Question;
 
+  if (FormSet->QuestionHash != NULL) {
+    Question = LookupQuestion (FormSet, Form, QuestionId);
+    if (Question == NULL || Question->ParentForm == Form) {
+      return Question;
+    }
+
+    //
+    // EFI variable storage may be updated by Callback() asynchronous,
+    // to keep synchronous, always reload the Question Value.
+    //
+    if (Question->Storage->Type == EFI_HII_VARSTORE_EFI_VARIABLE) {
+      GetQuestionValue (FormSet, Question->ParentForm, Question, GetSetValueWithHiiDriver);
+    }
+
+    return Question;
+  }
+
   //
   // Search in the form scope first
   //
@@ -899,6 +967,447 @@ IdToQuestion (
 }
 
 
+/**
+  Get the Questions which an expression reads.
+
+  Only expressions made of constants, arithmetic and logical operators and
+  direct references to Questions with a scalar HiiValue are supported. Their
+  result only changes when the HiiValue of one of these Questions changes.
+
+  @param  FormSet                FormSet associated with this expression.
+  @param  Form                   Form associated with this expression.
+  @param  Expression             The expression.
+  @param  Question               Buffer which receives one entry per reference
+                                 to a Question, or NULL to only count them.
+  @param  Count                  On return, the number of references.
+
+  @retval TRUE                   The result only depends on the Questions.
+  @retval FALSE                  The expression reads storage, strings or other
+                                 state, and has to be evaluated every time.
+
+**/
+BOOLEAN
+GetExpressionDependency (
+  IN  FORM_BROWSER_FORMSET    *FormSet,
+  IN  FORM_BROWSER_FORM       *Form,
+  IN  FORM_EXPRESSION         *Expression,
+  OUT FORM_BROWSER_STATEMENT  **Question, OPTIONAL
+  OUT UINTN                   *Count
+  )
+{
+  LIST_ENTRY              *Link;
+  EXPRESSION_OPCODE       *OpCode;
+  EFI_QUESTION_ID         QuestionId[2];
+  FORM_BROWSER_STATEMENT  *Target;
+  UINTN                   Index;
+
+  *Count = 0;
+
+  Link = GetFirstNode (&Expression->OpCodeListHead);
+  while (!IsNull (&Expression->OpCodeListHead, Link)) {
+    OpCode = EXPRESSION_OPCODE_FROM_LINK (Link);
+    Link = GetNextNode (&Expression->OpCodeListHead, Link);
+
+    QuestionId[0] = 0;
+    QuestionId[1] = 0;
+
+    switch (OpCode->Operand) {
+    case EFI_IFR_EQ_ID_ID_OP:
+      QuestionId[1] = OpCode->QuestionId2;
+      QuestionId[0] = OpCode->QuestionId;
+      break;
+
+    case EFI_IFR_EQ_ID_VAL_OP:
+    case EFI_IFR_EQ_ID_VAL_LIST_OP:
+    case EFI_IFR_QUESTION_REF1_OP:
+    case EFI_IFR_THIS_OP:
+      QuestionId[0] = OpCode->QuestionId;
+      break;
+
+    case EFI_IFR_TRUE_OP:
+    case EFI_IFR_FALSE_OP:
+    case EFI_IFR_ONE_OP:
+    case EFI_IFR_ONES_OP:
+    case EFI_IFR_UINT8_OP:
+    case EFI_IFR_UINT16_OP:
+    case EFI_IFR_UINT32_OP:
+    case EFI_IFR_UINT64_OP:
+    case EFI_IFR_UNDEFINED_OP:
+    case EFI_IFR_VERSION_OP:
+    case EFI_IFR_ZERO_OP:
+    case EFI_IFR_DUP_OP:
+    case EFI_IFR_NOT_OP:
+    case EFI_IFR_TO_BOOLEAN_OP:
+    case EFI_IFR_TO_UINT_OP:
+    case EFI_IFR_BITWISE_NOT_OP:
+    case EFI_IFR_ADD_OP:
+    case EFI_IFR_SUBTRACT_OP:
+    case EFI_IFR_MULTIPLY_OP:
+    case EFI_IFR_DIVIDE_OP:
+    case EFI_IFR_MODULO_OP:
+    case EFI_IFR_BITWISE_AND_OP:
+    case EFI_IFR_BITWISE_OR_OP:
+    case EFI_IFR_SHIFT_LEFT_OP:
+    case EFI_IFR_SHIFT_RIGHT_OP:
+    case EFI_IFR_AND_OP:
+    case EFI_IFR_OR_OP:
+    case EFI_IFR_EQUAL_OP:
+    case EFI_IFR_NOT_EQUAL_OP:
+    case EFI_IFR_GREATER_EQUAL_OP:
+    case EFI_IFR_GREATER_THAN_OP:
+    case EFI_IFR_LESS_EQUAL_OP:
+    case EFI_IFR_LESS_THAN_OP:
+    case EFI_IFR_CONDITIONAL_OP:
+      break;
+
+    default:
+      return FALSE;
+    }
+
+    for (Index = 0; Index < ARRAY_SIZE (QuestionId); Index++) {
+      Target = LookupQuestion (FormSet, Form, QuestionId[Index]);
+      if (Target == NULL) {
+        continue;
+      }
+
+      //
+      // The value of string, password, ordered list and action Questions is
+      // not held in HiiValue, and EFI variable Questions of other forms are
+      // reloaded on every reference.
+      //
+      if ((Target->Operand == EFI_IFR_STRING_OP) ||
+          (Target->Operand == EFI_IFR_PASSWORD_OP) ||
+          (Target->Operand == EFI_IFR_ORDERED_LIST_OP) ||
+          (Target->Operand == EFI_IFR_ACTION_OP) ||
+          ((Target->ParentForm != Form) && (Target->Storage != NULL) &&
+           (Target->Storage->Type == EFI_HII_VARSTORE_EFI_VARIABLE))) {
+        return FALSE;
+      }
+
+      if (Question != NULL) {
+        Question[*Count] = Target;
+      }
+      (*Count)++;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/**
+  Tell whether an expression is evaluated by EvaluateFormExpressions () and
+  can skip the evaluation when the Questions it reads did not change.
+
+  @param  Expression             The expression.
+
+  @retval TRUE                   The expression is a SuppressIf, GrayOutIf or
+                                 DisableIf of the form.
+  @retval FALSE                  The expression is evaluated on demand.
+
+**/
+BOOLEAN
+IsIncrementalExpressionType (
+  IN FORM_EXPRESSION  *Expression
+  )
+{
+  return (BOOLEAN) ((Expression->Type == EFI_HII_EXPRESSION_SUPPRESS_IF) ||
+                    (Expression->Type == EFI_HII_EXPRESSION_GRAY_OUT_IF) ||
+                    (Expression->Type == EFI_HII_EXPRESSION_DISABLE_IF));
+}
+
+
+/**
+  Free the expression dependency graph of a FormSet, so that all expressions
+  are evaluated every time.
+
+  @param  FormSet                The formset.
+
+**/
+VOID
+FreeExpressionDependency (
+  IN OUT FORM_BROWSER_FORMSET  *FormSet
+  )
+{
+  LIST_ENTRY              *FormLink;
+  LIST_ENTRY              *Link;
+  FORM_BROWSER_FORM       *Form;
+  FORM_BROWSER_STATEMENT  *Question;
+  FORM_EXPRESSION         *Expression;
+
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+
+    if (Form->DependencyQuestion != NULL) {
+      FreePool (Form->DependencyQuestion);
+      Form->DependencyQuestion = NULL;
+    }
+    Form->DependencyCount = 0;
+
+    Link = GetFirstNode (&Form->StatementListHead);
+    while (!IsNull (&Form->StatementListHead, Link)) {
+      Question = FORM_BROWSER_STATEMENT_FROM_LINK (Link);
+      Link = GetNextNode (&Form->StatementListHead, Link);
+
+      if (Question->DependentExpression != NULL) {
+        FreePool (Question->DependentExpression);
+        Question->DependentExpression = NULL;
+      }
+      Question->DependentCount = 0;
+      Question->DependencyForm = NULL;
+    }
+
+    Link = GetFirstNode (&Form->ExpressionListHead);
+    while (!IsNull (&Form->ExpressionListHead, Link)) {
+      Expression = FORM_EXPRESSION_FROM_LINK (Link);
+      Link = GetNextNode (&Form->ExpressionListHead, Link);
+
+      Expression->Incremental = FALSE;
+    }
+  }
+}
+
+
+/**
+  Add the Questions read by the Incremental expressions of a form to the
+  dependency graph.
+
+  When Fill is FALSE, only the number of entries is computed, as an upper
+  bound of the size of the arrays. When Fill is TRUE, the arrays are filled
+  without duplicates.
+
+  @param  FormSet                The formset.
+  @param  Form                   The form.
+  @param  Buffer                 Scratch buffer for the references of one
+                                 expression.
+  @param  Fill                   Whether the arrays are allocated.
+
+**/
+VOID
+AddFormExpressionDependency (
+  IN     FORM_BROWSER_FORMSET    *FormSet,
+  IN OUT FORM_BROWSER_FORM       *Form,
+  IN     FORM_BROWSER_STATEMENT  **Buffer,
+  IN     BOOLEAN                 Fill
+  )
+{
+  LIST_ENTRY              *Link;
+  FORM_EXPRESSION         *Expression;
+  FORM_BROWSER_STATEMENT  *Question;
+  UINTN                   Count;
+  UINTN                   Index;
+
+  Link = GetFirstNode (&Form->ExpressionListHead);
+  while (!IsNull (&Form->ExpressionListHead, Link)) {
+    Expression = FORM_EXPRESSION_FROM_LINK (Link);
+    Link = GetNextNode (&Form->ExpressionListHead, Link);
+
+    if (!Expression->Incremental) {
+      continue;
+    }
+
+    GetExpressionDependency (FormSet, Form, Expression, Buffer, &Count);
+    for (Index = 0; Index < Count; Index++) {
+      Question = Buffer[Index];
+
+      if (Question->DependencyForm != Form) {
+        Question->DependencyForm = Form;
+        if (Fill) {
+          Form->DependencyQuestion[Form->DependencyCount] = Question;
+        }
+        Form->DependencyCount++;
+      }
+
+      if (!Fill) {
+        Question->DependentCount++;
+      } else if ((Question->DependentCount == 0) ||
+                 (Question->DependentExpression[Question->DependentCount - 1] != Expression)) {
+        Question->DependentExpression[Question->DependentCount] = Expression;
+        Question->DependentCount++;
+      }
+    }
+  }
+}
+
+
+/**
+  Build the Question index and the expression dependency graph of a FormSet.
+
+  FormSet->QuestionHash finds a Question by its QuestionId without walking
+  every form. Each SuppressIf, GrayOutIf and DisableIf expression of a form
+  which only reads the HiiValue of Questions is marked Incremental, and each
+  of these Questions gets the list of expressions which read it, so that
+  EvaluateFormExpressions () only evaluates them again when one of their
+  Questions changed.
+
+  If there is not enough memory, the FormSet is left without index or graph,
+  and every expression is evaluated every time.
+
+  @param  FormSet                The formset, after its IFR is parsed.
+
+**/
+VOID
+BuildExpressionDependency (
+  IN OUT FORM_BROWSER_FORMSET  *FormSet
+  )
+{
+  LIST_ENTRY              *FormLink;
+  LIST_ENTRY              *Link;
+  FORM_BROWSER_FORM       *Form;
+  FORM_BROWSER_STATEMENT  *Question;
+  FORM_BROWSER_STATEMENT  **Bucket;
+  FORM_BROWSER_STATEMENT  **Buffer;
+  FORM_EXPRESSION         *Expression;
+  UINTN                   QuestionCount;
+  UINTN                   Count;
+  UINTN                   MaxCount;
+
+  //
+  // Hash all Questions, in the order of the forms and of their Statements.
+  //
+  QuestionCount = 0;
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+
+    Link = GetFirstNode (&Form->StatementListHead);
+    while (!IsNull (&Form->StatementListHead, Link)) {
+      Question = FORM_BROWSER_STATEMENT_FROM_LINK (Link);
+      Link = GetNextNode (&Form->StatementListHead, Link);
+      if (Question->QuestionId != 0) {
+        QuestionCount++;
+      }
+    }
+  }
+
+  if (QuestionCount == 0) {
+    return;
+  }
+
+  FormSet->QuestionHashSize = 1;
+  while (FormSet->QuestionHashSize < QuestionCount && FormSet->QuestionHashSize <= MAX_UINT16) {
+    FormSet->QuestionHashSize <<= 1;
+  }
+  FormSet->QuestionHash = AllocateZeroPool (FormSet->QuestionHashSize * sizeof (FORM_BROWSER_STATEMENT *));
+  if (FormSet->QuestionHash == NULL) {
+    return;
+  }
+
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+
+    Link = GetFirstNode (&Form->StatementListHead);
+    while (!IsNull (&Form->StatementListHead, Link)) {
+      Question = FORM_BROWSER_STATEMENT_FROM_LINK (Link);
+      Link = GetNextNode (&Form->StatementListHead, Link);
+      if (Question->QuestionId == 0) {
+        continue;
+      }
+
+      Bucket = &FormSet->QuestionHash[Question->QuestionId & (FormSet->QuestionHashSize - 1)];
+      while (*Bucket != NULL) {
+        Bucket = &(*Bucket)->NextQuestion;
+      }
+      *Bucket = Question;
+    }
+  }
+
+  //
+  // Find the Incremental expressions, and the largest number of references
+  // to Questions in one of them.
+  //
+  MaxCount = 0;
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+
+    Link = GetFirstNode (&Form->ExpressionListHead);
+    while (!IsNull (&Form->ExpressionListHead, Link)) {
+      Expression = FORM_EXPRESSION_FROM_LINK (Link);
+      Link = GetNextNode (&Form->ExpressionListHead, Link);
+
+      if (IsIncrementalExpressionType (Expression) &&
+          GetExpressionDependency (FormSet, Form, Expression, NULL, &Count)) {
+        Expression->Incremental = TRUE;
+        MaxCount = MAX (MaxCount, Count);
+      }
+    }
+  }
+
+  if (MaxCount == 0) {
+    //
+    // The Incremental expressions are constant, and evaluated once.
+    //
+    return;
+  }
+
+  Buffer = AllocatePool (MaxCount * sizeof (FORM_BROWSER_STATEMENT *));
+  if (Buffer == NULL) {
+    FreeExpressionDependency (FormSet);
+    return;
+  }
+
+  //
+  // Size the arrays of the graph, then fill them.
+  //
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+    AddFormExpressionDependency (FormSet, Form, Buffer, FALSE);
+  }
+
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+
+    if (Form->DependencyCount != 0) {
+      Form->DependencyQuestion = AllocatePool (Form->DependencyCount * sizeof (FORM_BROWSER_STATEMENT *));
+      if (Form->DependencyQuestion == NULL) {
+        goto Error;
+      }
+      Form->DependencyCount = 0;
+    }
+
+    Link = GetFirstNode (&Form->StatementListHead);
+    while (!IsNull (&Form->StatementListHead, Link)) {
+      Question = FORM_BROWSER_STATEMENT_FROM_LINK (Link);
+      Link = GetNextNode (&Form->StatementListHead, Link);
+
+      Question->DependencyForm = NULL;
+      if (Question->DependentCount != 0) {
+        Question->DependentExpression = AllocatePool (Question->DependentCount * sizeof (FORM_EXPRESSION *));
+        if (Question->DependentExpression == NULL) {
+          goto Error;
+        }
+        Question->DependentCount = 0;
+      }
+    }
+  }
+
+  FormLink = GetFirstNode (&FormSet->FormListHead);
+  while (!IsNull (&FormSet->FormListHead, FormLink)) {
+    Form = FORM_BROWSER_FORM_FROM_LINK (FormLink);
+    FormLink = GetNextNode (&FormSet->FormListHead, FormLink);
+    AddFormExpressionDependency (FormSet, Form, Buffer, TRUE);
+  }
+
+  FreePool (Buffer);
+  return;
+
+Error:
+  FreePool (Buffer);
+  FreeExpressionDependency (FormSet);
+}
+
+
 /**
   Get Expression given its RuleId.
 
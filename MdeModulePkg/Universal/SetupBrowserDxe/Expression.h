@@ -240,6 +240,27 @@ EvaluateExpressionList (
   IN FORM_BROWSER_FORM    *Form OPTIONAL
   );
 
+/**
+  Build the Question index and the expression dependency graph of a FormSet.
+
+  FormSet->QuestionHash finds a Question by its QuestionId without walking
+  every form. Each SuppressIf, GrayOutIf and DisableIf expression of a form
+  which only reads the HiiValue of Questions is marked Incremental, and each
+  of these Questions gets the list of expressions which read it, so that
+  EvaluateFormExpressions () only evaluates them again when one of their
+  Questions changed.
+
+  If there is not enough memory, the FormSet is left without index or graph,
+  and every expression is evaluated every time.
+
+  @param  FormSet                The formset, after its IFR is parsed.
+
+**/
+VOID
+BuildExpressionDependency (
+  IN OUT FORM_BROWSER_FORMSET  *FormSet
+  );
+
 /**
   Get Form given its FormId.
 
@@ -81,6 +81,7 @@ CreateStatement (
   } else {
     InsertTailList (&Form->StatementListHead, &Statement->Link);
   }
+  Statement->ParentForm = Form;
   return Statement;
 }
 
@@ -215,6 +216,7 @@ CreateExpression (
   Expression->Signature = FORM_EXPRESSION_SIGNATURE;
   InitializeListHead (&Expression->OpCodeListHead);
   Expression->OpCode = (EFI_IFR_OP_HEADER *) OpCode;
+  Expression->Stale  = TRUE;
 
   return Expression;
 }
@@ -843,6 +845,10 @@ DestroyStatement (
     FreePool (Statement->Expression);
   }
 
+  if (Statement->DependentExpression != NULL) {
+    FreePool (Statement->DependentExpression);
+  }
+
   if (Statement->VariableName != NULL) {
     FreePool (Statement->VariableName);
   }
@@ -914,6 +920,10 @@ DestroyForm (
     FreePool (Form->SuppressExpression);
   }
 
+  if (Form->DependencyQuestion != NULL) {
+    FreePool (Form->DependencyQuestion);
+  }
+
   UiFreeMenuList (&Form->FormViewListHead);
 
   //
@@ -1009,6 +1019,9 @@ DestroyFormSet (
   if (FormSet->ExpressionBuffer != NULL) {
     FreePool (FormSet->ExpressionBuffer);
   }
+  if (FormSet->QuestionHash != NULL) {
+    FreePool (FormSet->QuestionHash);
+  }
 
   FreePool (FormSet);
 }
@@ -2690,5 +2703,11 @@ ParseOpCodes (
     }
   }
 
+  //
+  // Index the Questions and link them to the expressions which read them, so
+  // that a Form only evaluates the expressions whose Questions changed.
+  //
+  BuildExpressionDependency (FormSet);
+
   return EFI_SUCCESS;
 }
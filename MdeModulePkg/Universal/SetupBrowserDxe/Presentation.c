@@ -56,6 +56,9 @@ CheckConfigAccess(
 /**
   Evaluate all expressions in a Form.
 
+  An Incremental expression is only evaluated again when the HiiValue of a
+  Question it reads changed since its last evaluation.
+
   @param  FormSet        FormSet this Form belongs to.
   @param  Form           The Form.
 
@@ -68,9 +71,30 @@ EvaluateFormExpressions (
   IN FORM_BROWSER_FORM     *Form
   )
 {
-  EFI_STATUS       Status;
-  LIST_ENTRY       *Link;
-  FORM_EXPRESSION  *Expression;
+  EFI_STATUS              Status;
+  LIST_ENTRY              *Link;
+  FORM_EXPRESSION         *Expression;
+  FORM_BROWSER_STATEMENT  *Question;
+  UINTN                   Index;
+  UINTN                   DependentIndex;
+
+  //
+  // Mark the expressions which read a changed Question as stale, in all forms.
+  //
+  for (Index = 0; Index < Form->DependencyCount; Index++) {
+    Question = Form->DependencyQuestion[Index];
+    if (Question->DependencyValueValid &&
+        (Question->DependencyValue.Type == Question->HiiValue.Type) &&
+        (CompareMem (&Question->DependencyValue.Value, &Question->HiiValue.Value, sizeof (EFI_IFR_TYPE_VALUE)) == 0)) {
+      continue;
+    }
+
+    CopyMem (&Question->DependencyValue, &Question->HiiValue, sizeof (EFI_HII_VALUE));
+    Question->DependencyValueValid = TRUE;
+    for (DependentIndex = 0; DependentIndex < Question->DependentCount; DependentIndex++) {
+      Question->DependentExpression[DependentIndex]->Stale = TRUE;
+    }
+  }
 
   Link = GetFirstNode (&Form->ExpressionListHead);
   while (!IsNull (&Form->ExpressionListHead, Link)) {
@@ -88,10 +112,15 @@ EvaluateFormExpressions (
       continue;
     }
 
+    if (Expression->Incremental && !Expression->Stale) {
+      continue;
+    }
+
     Status = EvaluateExpression (FormSet, Form, Expression);
     if (EFI_ERROR (Status)) {
       return Status;
     }
+    Expression->Stale = FALSE;
   }
 
   return EFI_SUCCESS;
@@ -234,6 +234,9 @@ typedef struct {
   EFI_IFR_OP_HEADER *OpCode;         // Save the opcode buffer.
 
   LIST_ENTRY        OpCodeListHead;  // OpCodes consist of this expression (EXPRESSION_OPCODE)
+
+  BOOLEAN           Incremental;     // Result only depends on the HiiValue of Questions, see BuildExpressionDependency()
+  BOOLEAN           Stale;           // A Question read by an Incremental expression changed since it was evaluated
 } FORM_EXPRESSION;
 
 #define FORM_EXPRESSION_FROM_LINK(a)  CR (a, FORM_EXPRESSION, Link, FORM_EXPRESSION_SIGNATURE)
@@ -293,6 +296,7 @@ typedef enum {
 } EXPRESS_LEVEL;
 
 typedef struct _FORM_BROWSER_STATEMENT FORM_BROWSER_STATEMENT;
+typedef struct _FORM_BROWSER_FORM FORM_BROWSER_FORM;
 
 #define FORM_BROWSER_STATEMENT_SIGNATURE  SIGNATURE_32 ('F', 'S', 'T', 'A')
 
@@ -371,6 +375,18 @@ struct _FORM_BROWSER_STATEMENT{
 
   FORM_EXPRESSION       *ReadExpression;     // nested EFI_IFR_READ, provide this question value by read expression.
   FORM_EXPRESSION       *WriteExpression;    // nested EFI_IFR_WRITE, evaluate write expression after this question value is set.
+
+  FORM_BROWSER_FORM     *ParentForm;         // The Form of this Statement, NULL for Statement out side of the form.
+
+  //
+  // Expression dependency graph, see BuildExpressionDependency()
+  //
+  FORM_BROWSER_STATEMENT *NextQuestion;      // Next Question in the same FormSet->QuestionHash bucket
+  FORM_EXPRESSION       **DependentExpression; // Incremental expressions which read the HiiValue of this Question
+  UINTN                 DependentCount;
+  EFI_HII_VALUE         DependencyValue;     // HiiValue when DependentExpression were last marked stale
+  BOOLEAN               DependencyValueValid;
+  FORM_BROWSER_FORM     *DependencyForm;     // Last Form which added this Question to its DependencyQuestion
 };
 
 #define FORM_BROWSER_STATEMENT_FROM_LINK(a)  CR (a, FORM_BROWSER_STATEMENT, Link, FORM_BROWSER_STATEMENT_SIGNATURE)
@@ -397,7 +413,7 @@ typedef struct {
 #define FORM_BROWSER_FORM_SIGNATURE  SIGNATURE_32 ('F', 'F', 'R', 'M')
 #define STANDARD_MAP_FORM_TYPE 0x01
 
-typedef struct {
+struct _FORM_BROWSER_FORM {
   UINTN                Signature;
   LIST_ENTRY           Link;
 
@@ -416,7 +432,10 @@ typedef struct {
   LIST_ENTRY           StatementListHead;    // List of Statements and Questions (FORM_BROWSER_STATEMENT)
   LIST_ENTRY           ConfigRequestHead;    // List of configreques for all storage.
   FORM_EXPRESSION_LIST *SuppressExpression;  // nesting inside of SuppressIf
-} FORM_BROWSER_FORM;
+
+  FORM_BROWSER_STATEMENT **DependencyQuestion; // Questions read by the Incremental expressions of this Form
+  UINTN                DependencyCount;
+};
 
 #define FORM_BROWSER_FORM_FROM_LINK(a)  CR (a, FORM_BROWSER_FORM, Link, FORM_BROWSER_FORM_SIGNATURE)
 
@@ -469,6 +488,9 @@ typedef struct {
   LIST_ENTRY                      DefaultStoreListHead; // DefaultStore list (FORMSET_DEFAULTSTORE)
   LIST_ENTRY                      FormListHead;         // Form list (FORM_BROWSER_FORM)
   LIST_ENTRY                      ExpressionListHead;   // List of Expressions (FORM_EXPRESSION)
+
+  FORM_BROWSER_STATEMENT          **QuestionHash;       // Questions of all Forms hashed by QuestionId, NULL if not built
+  UINTN                           QuestionHashSize;     // Number of buckets, a power of two
 } FORM_BROWSER_FORMSET;
 #define FORM_BROWSER_FORMSET_FROM_LINK(a)  CR (a, FORM_BROWSER_FORMSET, Link, FORM_BROWSER_FORMSET_SIGNATURE)
 
@@ -0,0 +1,43 @@
+/** @file
+  CRC32 computation for AArch64, using the CRC32 instructions when the
+  processor implements them.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+//
+// ID_AA64ISAR0_EL1.CRC32, bits [19:16]
+//
+#define ID_AA64ISAR0_CRC32_SHIFT  16
+#define ID_AA64ISAR0_CRC32_MASK   0xF
+
+/**
+  Updates a CRC32 value with the contents of a buffer, using the fastest
+  implementation the processor supports.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  if (FeaturePcdGet (PcdArmCrc32InstructionProbe) &&
+      ((RShiftU64 (InternalArmReadIdAa64Isar0 (), ID_AA64ISAR0_CRC32_SHIFT) & ID_AA64ISAR0_CRC32_MASK) != 0)) {
+    return InternalCrc32Armv8 (Crc, Buffer, Length);
+  }
+
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
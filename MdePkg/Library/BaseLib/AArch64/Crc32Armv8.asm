@@ -0,0 +1,95 @@
+;------------------------------------------------------------------------------
+;
+; CRC32 for AArch64 using the CRC32 instructions
+;
+;
+; SPDX-License-Identifier: BSD-2-Clause-Patent
+;
+;------------------------------------------------------------------------------
+
+  EXPORT InternalArmReadIdAa64Isar0
+  EXPORT InternalCrc32Armv8
+  AREA BaseLib_LowLevel, CODE, READONLY
+
+;/**
+;  Reads the ID_AA64ISAR0_EL1 register.
+;
+;  @return The value of ID_AA64ISAR0_EL1.
+;
+;**/
+;UINT64
+;EFIAPI
+;InternalArmReadIdAa64Isar0 (
+;  VOID
+;  );
+;
+InternalArmReadIdAa64Isar0
+    mrs   x0, id_aa64isar0_el1
+    ret
+
+;/**
+;  Updates a CRC32 value with the contents of a buffer using the AArch64 CRC32
+;  instructions.
+;
+;  @param[in]  Crc          The CRC32 value before the buffer is processed,
+;                           without the final inversion.
+;  @param[in]  Buffer       A pointer to the buffer.
+;  @param[in]  Length       The number of bytes in the buffer.
+;
+;  @return The CRC32 value after the buffer is processed, without the final
+;          inversion.
+;
+;**/
+;UINT32
+;EFIAPI
+;InternalCrc32Armv8 (
+;  IN UINT32       Crc,
+;  IN CONST UINT8  *Buffer,
+;  IN UINTN        Length
+;  );
+;
+InternalCrc32Armv8
+    ; Process the leading bytes until Buffer is 64-bit aligned
+AlignLoop
+    cbz   x2, Done
+    tst   x1, #7
+    b.eq  Loop32
+    ldrb  w3, [x1], #1
+    crc32b w0, w0, w3
+    sub   x2, x2, #1
+    b     AlignLoop
+
+    ; Process 32 bytes per iteration
+Loop32
+    cmp   x2, #32
+    b.lo  Loop8
+    ldp   x3, x4, [x1], #16
+    ldp   x5, x6, [x1], #16
+    crc32x w0, w0, x3
+    crc32x w0, w0, x4
+    crc32x w0, w0, x5
+    crc32x w0, w0, x6
+    sub   x2, x2, #32
+    b     Loop32
+
+    ; Process the remaining 64-bit words
+Loop8
+    cmp   x2, #8
+    b.lo  Loop1
+    ldr   x3, [x1], #8
+    crc32x w0, w0, x3
+    sub   x2, x2, #8
+    b     Loop8
+
+    ; Process the trailing bytes
+Loop1
+    cbz   x2, Done
+    ldrb  w3, [x1], #1
+    crc32b w0, w0, w3
+    sub   x2, x2, #1
+    b     Loop1
+
+Done
+    ret
+
+  END
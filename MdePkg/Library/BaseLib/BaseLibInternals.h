@@ -568,6 +568,105 @@ InternalAsciiHexCharToUintn (
 //
 // Ia32 and x64 specific functions
 //
+/**
+  Updates a CRC32 value with the contents of a buffer, eight bytes at a time.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+InternalCrc32SliceBy8 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+/**
+  Updates a CRC32 value with the contents of a buffer, using the fastest
+  implementation the processor supports.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
+#if defined (MDE_CPU_X64)
+/**
+  Updates a CRC32 value with the contents of a buffer using PCLMULQDQ.
+
+  Buffer must be 16-byte aligned, and Length must be a multiple of 16 and at
+  least 64.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Pclmul (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+#endif
+
+#if defined (MDE_CPU_AARCH64)
+/**
+  Reads the ID_AA64ISAR0_EL1 register.
+
+  @return The value of ID_AA64ISAR0_EL1.
+
+**/
+UINT64
+EFIAPI
+InternalArmReadIdAa64Isar0 (
+  VOID
+  );
+
+/**
+  Updates a CRC32 value with the contents of a buffer using the AArch64 CRC32
+  instructions.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+EFIAPI
+InternalCrc32Armv8 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+#endif
+
 #if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
 
 /**
@@ -0,0 +1,31 @@
+/** @file
+  CRC32 computation for processors without CRC32 acceleration.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+/**
+  Updates a CRC32 value with the contents of a buffer, using the fastest
+  implementation the processor supports.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
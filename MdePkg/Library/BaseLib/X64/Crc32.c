@@ -0,0 +1,61 @@
+/** @file
+  CRC32 computation for X64, using PCLMULQDQ when the processor supports it.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "BaseLibInternals.h"
+
+//
+// Buffers shorter than this are processed with the tables, as the CPUID
+// query would cost more than it saves (CPUID traps under virtualization).
+//
+#define CRC32_PCLMUL_MIN_LENGTH   1024
+
+/**
+  Updates a CRC32 value with the contents of a buffer, using the fastest
+  implementation the processor supports.
+
+  @param[in]  Crc          The CRC32 value before the buffer is processed,
+                           without the final inversion.
+  @param[in]  Buffer       A pointer to the buffer.
+  @param[in]  Length       The number of bytes in the buffer.
+
+  @return The CRC32 value after the buffer is processed, without the final
+          inversion.
+
+**/
+UINT32
+InternalCalculateCrc32 (
+  IN UINT32       Crc,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT32  RegEcx;
+  UINTN   Size;
+
+  if (Length >= CRC32_PCLMUL_MIN_LENGTH) {
+    //
+    // PCLMULQDQ is reported in CPUID.01h:ECX[1] and PEXTRD (SSE4.1) in
+    // CPUID.01h:ECX[19].  SSE is always enabled on X64 (the UEFI calling
+    // convention uses the XMM registers), so CPUID is enough. CR4 can't be
+    // read here: BaseLib also runs in ring 3, as in EmulatorPkg.
+    //
+    AsmCpuid (0x01, NULL, NULL, &RegEcx, NULL);
+    if ((RegEcx & (BIT1 | BIT19)) == (BIT1 | BIT19)) {
+      Size    = (16 - ((UINTN)Buffer & 15)) & 15;
+      Crc     = InternalCrc32SliceBy8 (Crc, Buffer, Size);
+      Buffer += Size;
+      Length -= Size;
+
+      Size    = Length & ~(UINTN)15;
+      Crc     = InternalCrc32Pclmul (Crc, Buffer, Size);
+      Buffer += Size;
+      Length -= Size;
+    }
+  }
+
+  return InternalCrc32SliceBy8 (Crc, Buffer, Length);
+}
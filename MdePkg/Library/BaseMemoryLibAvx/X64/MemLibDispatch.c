@@ -0,0 +1,306 @@
+/** @file
+  Run time selection of the CopyMem(), SetMem() and ZeroMem() implementations.
+
+  The processor is probed on first use. AVX2 is only used when the processor
+  supports it and the OS (or firmware) has enabled the YMM state through
+  XCR0, otherwise the SSE2 code from BaseMemoryLibSse2 is used. Processors
+  that report Enhanced REP MOVSB/STOSB use "rep movsb" / "rep stosb" for
+  medium sized buffers.
+
+  The probe result is cached in a global variable. In modules that execute
+  in place from read-only memory the cache cannot be written and the probe
+  runs on every call, so this instance is meant for modules that run from
+  RAM.
+
+  The AVX2 code keeps data in the upper halves of the YMM registers, and
+  ends with VZEROUPPER. The CPU exception handlers only save the state that
+  FXSAVE covers, which does not include those upper halves. If an interrupt
+  handler or an event notification function that runs from the timer
+  interrupt called CopyMem() or SetMem() while an AVX2 copy was interrupted,
+  it would corrupt that copy. The AVX2 code therefore runs with interrupts
+  disabled, in chunks of at most MEM_LIB_AVX2_CHUNK_SIZE bytes to bound the
+  interrupt latency. It is only used for buffers of MEM_LIB_AVX2_MIN_LENGTH
+  bytes or more that ERMSB doesn't handle, so the common small calls never
+  change the interrupt state. The SSE2 and ERMSB code only uses state that
+  is saved, and runs with interrupts enabled.
+
+  AVX-512 is not used. The exception handlers don't save the ZMM state
+  either, and the buffers that are large enough to pay for disabling
+  interrupts are already bound by memory bandwidth with AVX2 or ERMSB.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MemLibInternals.h"
+#include "MemLibDispatch.h"
+
+#include <Library/PcdLib.h>
+#include <Register/Intel/Cpuid.h>
+
+UINT32  mMemLibFeatures = 0;
+
+/**
+  Return the processor features used to select an implementation.
+
+  @return A combination of the MEM_LIB_FEATURE_* bits.
+
+**/
+STATIC
+UINT32
+InternalMemLibGetFeatures (
+  VOID
+  )
+{
+  UINT32                                       Features;
+  UINT32                                       MaxLeaf;
+  CPUID_VERSION_INFO_ECX                       VersionEcx;
+  CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_EBX  ExtendedEbx;
+
+  Features = mMemLibFeatures;
+  if (Features != 0) {
+    return Features;
+  }
+
+  Features = MEM_LIB_FEATURE_PROBED;
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf >= CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS) {
+    AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionEcx.Uint32, NULL);
+    AsmCpuidEx (
+      CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS,
+      CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS_SUB_LEAF_INFO,
+      NULL,
+      &ExtendedEbx.Uint32,
+      NULL,
+      NULL
+      );
+
+    if (ExtendedEbx.Bits.EnhancedRepMovsbStosb != 0) {
+      Features |= MEM_LIB_FEATURE_ERMSB;
+    }
+
+    //
+    // XCR0 bit 1 (SSE) and bit 2 (AVX) must both be set for the upper halves
+    // of the YMM registers to be usable.
+    //
+    if ((VersionEcx.Bits.OSXSAVE != 0) &&
+        (VersionEcx.Bits.AVX != 0) &&
+        (ExtendedEbx.Bits.AVX2 != 0) &&
+        ((AsmXGetBv (0) & (BIT1 | BIT2)) == (BIT1 | BIT2))) {
+      Features |= MEM_LIB_FEATURE_AVX2;
+    }
+  }
+
+  mMemLibFeatures = Features;
+  return Features;
+}
+
+/**
+  Copy Length bytes from Source to Destination using AVX2 registers, with
+  interrupts disabled.
+
+  Copies larger than MEM_LIB_AVX2_CHUNK_SIZE are split into chunks, and
+  interrupts are enabled between the chunks if they were enabled on entry.
+  The chunks are copied in the order that keeps an overlapping copy correct.
+
+  @param  DestinationBuffer    The target of the copy request.
+  @param  SourceBuffer         The place to copy from.
+  @param  Length               The number of bytes to copy.
+  @param  NonTemporalThreshold The smallest copy that uses non-temporal
+                               stores.
+
+  @return Destination
+
+**/
+STATIC
+VOID *
+InternalMemCopyMemAvx2Chunked (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length,
+  IN      UINTN                     NonTemporalThreshold
+  )
+{
+  BOOLEAN InterruptState;
+  UINTN   Offset;
+  UINTN   Size;
+
+  //
+  // The chunks must use non-temporal stores if and only if the whole copy
+  // would.
+  //
+  NonTemporalThreshold = (Length >= NonTemporalThreshold) ? 0 : MAX_UINTN;
+
+  if ((UINTN)DestinationBuffer - (UINTN)SourceBuffer >= Length) {
+    for (Offset = 0; Offset < Length; Offset += Size) {
+      Size           = MIN (Length - Offset, MEM_LIB_AVX2_CHUNK_SIZE);
+      InterruptState = SaveAndDisableInterrupts ();
+      InternalMemCopyMemAvx2 (
+        (UINT8 *)DestinationBuffer + Offset,
+        (CONST UINT8 *)SourceBuffer + Offset,
+        Size,
+        NonTemporalThreshold
+        );
+      SetInterruptState (InterruptState);
+    }
+  } else {
+    for (Offset = Length; Offset > 0; Offset -= Size) {
+      Size           = MIN (Offset, MEM_LIB_AVX2_CHUNK_SIZE);
+      InterruptState = SaveAndDisableInterrupts ();
+      InternalMemCopyMemAvx2 (
+        (UINT8 *)DestinationBuffer + Offset - Size,
+        (CONST UINT8 *)SourceBuffer + Offset - Size,
+        Size,
+        NonTemporalThreshold
+        );
+      SetInterruptState (InterruptState);
+    }
+  }
+
+  return DestinationBuffer;
+}
+
+/**
+  Set Buffer to Value for Length bytes using AVX2 registers, with interrupts
+  disabled.
+
+  Buffers larger than MEM_LIB_AVX2_CHUNK_SIZE are split into chunks, and
+  interrupts are enabled between the chunks if they were enabled on entry.
+
+  @param  Buffer               The memory to set.
+  @param  Length               The number of bytes to set.
+  @param  Value                The value of the set operation.
+  @param  NonTemporalThreshold The smallest buffer that uses non-temporal
+                               stores.
+
+  @return Buffer
+
+**/
+STATIC
+VOID *
+InternalMemSetMemAvx2Chunked (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value,
+  IN      UINTN                     NonTemporalThreshold
+  )
+{
+  BOOLEAN InterruptState;
+  UINTN   Offset;
+  UINTN   Size;
+
+  NonTemporalThreshold = (Length >= NonTemporalThreshold) ? 0 : MAX_UINTN;
+
+  for (Offset = 0; Offset < Length; Offset += Size) {
+    Size           = MIN (Length - Offset, MEM_LIB_AVX2_CHUNK_SIZE);
+    InterruptState = SaveAndDisableInterrupts ();
+    InternalMemSetMemAvx2 ((UINT8 *)Buffer + Offset, Size, Value, NonTemporalThreshold);
+    SetInterruptState (InterruptState);
+  }
+
+  return Buffer;
+}
+
+/**
+  Copy Length bytes from Source to Destination.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMem (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  )
+{
+  UINT32  Features;
+  UINTN   Threshold;
+  BOOLEAN Forward;
+
+  Features  = InternalMemLibGetFeatures ();
+  Threshold = PcdGet32 (PcdMemoryLibNonTemporalThreshold);
+
+  //
+  // A forward copy is safe unless Destination starts inside Source.
+  //
+  Forward = (BOOLEAN)((UINTN)DestinationBuffer - (UINTN)SourceBuffer >= Length);
+
+  if (((Features & MEM_LIB_FEATURE_ERMSB) != 0) && Forward &&
+      (Length >= MEM_LIB_ERMSB_MIN_LENGTH) && (Length < Threshold)) {
+    return InternalMemCopyMemErms (DestinationBuffer, SourceBuffer, Length);
+  }
+
+  if (((Features & MEM_LIB_FEATURE_AVX2) != 0) && (Length >= MEM_LIB_AVX2_MIN_LENGTH)) {
+    return InternalMemCopyMemAvx2Chunked (DestinationBuffer, SourceBuffer, Length, Threshold);
+  }
+
+  return InternalMemCopyMemSse2 (DestinationBuffer, SourceBuffer, Length);
+}
+
+/**
+  Set Buffer to Value for Size bytes.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMem (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  )
+{
+  UINT32  Features;
+  UINTN   Threshold;
+
+  Features  = InternalMemLibGetFeatures ();
+  Threshold = PcdGet32 (PcdMemoryLibNonTemporalThreshold);
+
+  if (((Features & MEM_LIB_FEATURE_ERMSB) != 0) &&
+      (Length >= MEM_LIB_ERMSB_MIN_LENGTH) && (Length < Threshold)) {
+    return InternalMemSetMemErms (Buffer, Length, Value);
+  }
+
+  if (((Features & MEM_LIB_FEATURE_AVX2) != 0) && (Length >= MEM_LIB_AVX2_MIN_LENGTH)) {
+    return InternalMemSetMemAvx2Chunked (Buffer, Length, Value, Threshold);
+  }
+
+  return InternalMemSetMemSse2 (Buffer, Length, Value);
+}
+
+/**
+  Set Buffer to 0 for Size bytes.
+
+  @param  Buffer Memory to set.
+  @param  Length The number of bytes to set
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemZeroMem (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length
+  )
+{
+  UINT32  Features;
+
+  Features = InternalMemLibGetFeatures ();
+  if ((Features & (MEM_LIB_FEATURE_AVX2 | MEM_LIB_FEATURE_ERMSB)) != 0) {
+    return InternalMemSetMem (Buffer, Length, 0);
+  }
+
+  return InternalMemZeroMemSse2 (Buffer, Length);
+}
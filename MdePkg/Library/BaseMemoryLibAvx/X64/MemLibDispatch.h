@@ -0,0 +1,176 @@
+/** @file
+  Declaration of the CopyMem(), SetMem() and ZeroMem() implementations that
+  BaseMemoryLibAvx chooses between at run time.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __MEM_LIB_DISPATCH_H__
+#define __MEM_LIB_DISPATCH_H__
+
+//
+// Set once the processor has been probed, so a zero value means "not probed
+// yet" even on processors without any of the optional features.
+//
+#define MEM_LIB_FEATURE_PROBED  BIT0
+#define MEM_LIB_FEATURE_AVX2    BIT1
+#define MEM_LIB_FEATURE_ERMSB   BIT2
+
+//
+// Buffers of at least this many bytes, and below the non-temporal threshold,
+// are moved with "rep movsb" / "rep stosb" on processors that support ERMSB.
+//
+#define MEM_LIB_ERMSB_MIN_LENGTH  2048
+
+//
+// The AVX2 code runs with interrupts disabled, on at most this many bytes at
+// a time. That is below 0.1 ms even for non-temporal stores to DRAM. Smaller
+// chunks slow down large non-temporal copies, because every chunk ends with
+// SFENCE.
+//
+#define MEM_LIB_AVX2_CHUNK_SIZE  SIZE_1MB
+
+//
+// Smaller buffers never use the AVX2 code, so they never disable interrupts.
+// From this size on, disabling interrupts once per chunk costs far less than
+// 1% of the copy.
+//
+#define MEM_LIB_AVX2_MIN_LENGTH  SIZE_64KB
+
+/**
+  Copy Length bytes from Source to Destination using SSE2 non-temporal stores.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemSse2 (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Copy Length bytes from Source to Destination using AVX2 registers.
+
+  The buffers may overlap in any way.
+
+  @param  DestinationBuffer     The target of the copy request.
+  @param  SourceBuffer          The place to copy from.
+  @param  Length                The number of bytes to copy.
+  @param  NonTemporalThreshold  Forward copies of at least this many bytes use
+                                non-temporal stores.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemAvx2 (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length,
+  IN      UINTN                     NonTemporalThreshold
+  );
+
+/**
+  Copy Length bytes from Source to Destination using "rep movsb".
+
+  The copy is done forward, so DestinationBuffer must not overlap the part
+  of SourceBuffer that follows it.
+
+  @param  DestinationBuffer The target of the copy request.
+  @param  SourceBuffer      The place to copy from.
+  @param  Length            The number of bytes to copy.
+
+  @return Destination
+
+**/
+VOID *
+EFIAPI
+InternalMemCopyMemErms (
+  OUT     VOID                      *DestinationBuffer,
+  IN      CONST VOID                *SourceBuffer,
+  IN      UINTN                     Length
+  );
+
+/**
+  Set Buffer to Value for Size bytes using SSE2 non-temporal stores.
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemSse2 (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  );
+
+/**
+  Set Buffer to Value for Size bytes using AVX2 registers.
+
+  @param  Buffer                The memory to set.
+  @param  Length                The number of bytes to set.
+  @param  Value                 The value of the set operation.
+  @param  NonTemporalThreshold  Buffers of at least this many bytes are set
+                                with non-temporal stores.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemAvx2 (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value,
+  IN      UINTN                     NonTemporalThreshold
+  );
+
+/**
+  Set Buffer to Value for Size bytes using "rep stosb".
+
+  @param  Buffer   The memory to set.
+  @param  Length   The number of bytes to set.
+  @param  Value    The value of the set operation.
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemSetMemErms (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length,
+  IN      UINT8                     Value
+  );
+
+/**
+  Set Buffer to 0 for Size bytes using SSE2 non-temporal stores.
+
+  @param  Buffer Memory to set.
+  @param  Length The number of bytes to set
+
+  @return Buffer
+
+**/
+VOID *
+EFIAPI
+InternalMemZeroMemSse2 (
+  OUT     VOID                      *Buffer,
+  IN      UINTN                     Length
+  );
+
+#endif
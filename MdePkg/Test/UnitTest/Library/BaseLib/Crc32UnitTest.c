@@ -0,0 +1,487 @@
+/** @file
+  Host based unit tests and throughput benchmark of CalculateCrc32 in BaseLib.
+
+  CalculateCrc32 selects its implementation at run time.  The tests run each
+  implementation the host can execute by changing what the UnitTestHostBaseLib
+  CPUID and CR4 mocks report, and compare them with a bit at a time reference
+  and with each other.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+#include <Library/UnitTestHostBaseLib.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#define UNIT_TEST_APP_NAME     "CalculateCrc32 Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// The tests run every length below CRC32_TEST_SMALL_LENGTH, and the lengths
+// from CRC32_TEST_LARGE_LENGTH on both sides of the 1KB threshold of the X64
+// PCLMULQDQ path, at every buffer alignment below CRC32_TEST_OFFSETS.
+//
+#define CRC32_TEST_SMALL_LENGTH  160
+#define CRC32_TEST_LARGE_LENGTH  960
+#define CRC32_TEST_OFFSETS       16
+#define CRC32_TEST_BUFFER_SIZE   SIZE_64KB
+
+//
+// Number of bytes each benchmark measurement processes in total.
+//
+#define BENCHMARK_TOTAL_BYTES  SIZE_256MB
+
+STATIC CONST UINTN  mLargeLengths[] = {
+  4095, 4096, 4099, 32768, 65521
+};
+
+STATIC CONST UINTN  mBenchmarkLengths[] = {
+  64, SIZE_1KB, SIZE_4KB, SIZE_64KB, SIZE_1MB
+};
+
+STATIC UINT8  *mBuffer;
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+/**
+  Execute the real CPUID instruction, so that CalculateCrc32 sees the
+  features of the host processor.
+
+  @param[in]  Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out] Eax    The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx    The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx    The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx    The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+
+**/
+STATIC
+UINT32
+EFIAPI
+HostAsmCpuid (
+  IN      UINT32                    Index,
+  OUT     UINT32                    *Eax,  OPTIONAL
+  OUT     UINT32                    *Ebx,  OPTIONAL
+  OUT     UINT32                    *Ecx,  OPTIONAL
+  OUT     UINT32                    *Edx   OPTIONAL
+  )
+{
+  UINT32  Registers[4];
+
+#if defined (_MSC_VER)
+  __cpuid ((int *)Registers, (int)Index);
+#else
+  __cpuid (Index, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+  if (Eax != NULL) {
+    *Eax = Registers[0];
+  }
+  if (Ebx != NULL) {
+    *Ebx = Registers[1];
+  }
+  if (Ecx != NULL) {
+    *Ecx = Registers[2];
+  }
+  if (Edx != NULL) {
+    *Edx = Registers[3];
+  }
+  return Index;
+}
+#endif
+
+/**
+  Select the CRC32 implementation CalculateCrc32 uses.
+
+  The X64 PCLMULQDQ path also requires CR4.OSFXSR, which the CR4 mock reports
+  as clear by default.  Setting it selects the PCLMULQDQ path on a host that
+  supports it, and clearing it selects the table driven path.
+
+  @param[in]  Accelerated  TRUE to select the PCLMULQDQ path.
+
+  @retval TRUE   The implementation was selected.
+  @retval FALSE  The host cannot run the PCLMULQDQ path.
+
+**/
+STATIC
+BOOLEAN
+SelectCrc32Implementation (
+  IN BOOLEAN  Accelerated
+  )
+{
+#if defined (MDE_CPU_X64)
+  UINT32  RegEcx;
+
+  if (Accelerated) {
+    AsmCpuid (0x01, NULL, NULL, &RegEcx, NULL);
+    if ((RegEcx & (BIT1 | BIT19)) != (BIT1 | BIT19)) {
+      return FALSE;
+    }
+    AsmWriteCr4 (AsmReadCr4 () | BIT9);
+  } else {
+    AsmWriteCr4 (AsmReadCr4 () & ~(UINTN)BIT9);
+  }
+  return TRUE;
+#else
+  return !Accelerated;
+#endif
+}
+
+/**
+  Bit-at-a-time CRC32 used as the reference for CalculateCrc32 ().
+
+  @param[in]  Buffer  Data to checksum.
+  @param[in]  Length  Number of bytes in Buffer.
+
+  @return  The CRC32 of Buffer.
+**/
+STATIC
+UINT32
+ReferenceCrc32 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  UINT32  Crc;
+  UINTN   Bit;
+
+  Crc = 0xffffffff;
+  while (Length-- != 0) {
+    Crc ^= *Buffer++;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = (Crc >> 1) ^ (0xedb88320 & (0 - (Crc & 1)));
+    }
+  }
+  return Crc ^ 0xffffffff;
+}
+
+/**
+  Check the CRC32 of one buffer with the table driven path, the PCLMULQDQ
+  path if the host supports it, and the reference.
+
+  @param[in]  Buffer       Data to checksum.
+  @param[in]  Length       Number of bytes in Buffer.
+  @param[in]  Accelerated  TRUE if the host can run the PCLMULQDQ path.
+
+  @retval TRUE   All the results match.
+  @retval FALSE  A result does not match.
+**/
+STATIC
+BOOLEAN
+CheckCrc32 (
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length,
+  IN BOOLEAN      Accelerated
+  )
+{
+  UINT32  Expected;
+  UINT32  Table;
+  UINT32  Pclmul;
+
+  Expected = ReferenceCrc32 (Buffer, Length);
+
+  SelectCrc32Implementation (FALSE);
+  Table = CalculateCrc32 ((VOID *)Buffer, Length);
+  if (Table != Expected) {
+    DEBUG ((DEBUG_ERROR, "Table CRC32 %08x, expected %08x, length %Lu\n", Table, Expected, (UINT64)Length));
+    return FALSE;
+  }
+
+  if (Accelerated) {
+    SelectCrc32Implementation (TRUE);
+    Pclmul = CalculateCrc32 ((VOID *)Buffer, Length);
+    SelectCrc32Implementation (FALSE);
+    if (Pclmul != Table) {
+      DEBUG ((DEBUG_ERROR, "PCLMULQDQ CRC32 %08x, expected %08x, length %Lu\n", Pclmul, Table, (UINT64)Length));
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Check the CRC32 of the test buffer at every alignment and at the lengths
+  around the thresholds of the implementations.
+
+  @param[in]  Accelerated  TRUE if the PCLMULQDQ path is checked as well.
+
+  @retval TRUE   All the results match.
+  @retval FALSE  A result does not match.
+**/
+STATIC
+BOOLEAN
+CheckAllLengths (
+  IN BOOLEAN  Accelerated
+  )
+{
+  UINTN  Offset;
+  UINTN  Length;
+  UINTN  Index;
+
+  for (Offset = 0; Offset < CRC32_TEST_OFFSETS; Offset++) {
+    for (Length = 0; Length < CRC32_TEST_SMALL_LENGTH; Length++) {
+      if (!CheckCrc32 (mBuffer + Offset, Length, Accelerated)) {
+        return FALSE;
+      }
+    }
+    for (Length = CRC32_TEST_LARGE_LENGTH; Length < CRC32_TEST_LARGE_LENGTH + 160; Length++) {
+      if (!CheckCrc32 (mBuffer + Offset, Length, Accelerated)) {
+        return FALSE;
+      }
+    }
+    for (Index = 0; Index < ARRAY_SIZE (mLargeLengths); Index++) {
+      if (!CheckCrc32 (mBuffer + Offset, mLargeLengths[Index], Accelerated)) {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32CheckValueTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // Standard check value for CRC-32/ISO-HDLC.
+  //
+  SelectCrc32Implementation (FALSE);
+  UT_ASSERT_EQUAL (CalculateCrc32 ("123456789", 9), 0xCBF43926);
+  UT_ASSERT_EQUAL (CalculateCrc32 ("", 0), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32TableTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_TRUE (CheckAllLengths (FALSE));
+
+  return UNIT_TEST_PASSED;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32PclmulPrerequisite (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (!SelectCrc32Implementation (TRUE)) {
+    return UNIT_TEST_SKIPPED;
+  }
+  SelectCrc32Implementation (FALSE);
+
+  return UNIT_TEST_PASSED;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+Crc32PclmulTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_TRUE (CheckAllLengths (TRUE));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the throughput of CalculateCrc32 for one length.
+
+  @param[in]  Length    The number of bytes each call processes.
+
+  @return The throughput in MB/s.
+
+**/
+STATIC
+UINT64
+MeasureThroughput (
+  IN UINTN  Length
+  )
+{
+  UINTN    Iterations;
+  UINTN    Index;
+  UINT32   Crc;
+  clock_t  Start;
+  clock_t  Elapsed;
+
+  Iterations = BENCHMARK_TOTAL_BYTES / Length;
+  Crc        = 0;
+  Start      = clock ();
+  for (Index = 0; Index < Iterations; Index++) {
+    //
+    // Use a misaligned buffer, so the PCLMULQDQ path also runs its head.
+    //
+    Crc ^= CalculateCrc32 (mBuffer + 1, Length);
+  }
+  Elapsed = clock () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  //
+  // Keep the compiler from dropping the calls.
+  //
+  mBuffer[0] = (UINT8)Crc;
+
+  return DivU64x64Remainder (
+           MultU64x32 (BENCHMARK_TOTAL_BYTES / SIZE_1MB, CLOCKS_PER_SEC),
+           (UINT64)Elapsed,
+           NULL
+           );
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN    Index;
+  UINT64   Table;
+  UINT64   Pclmul;
+  BOOLEAN  Accelerated;
+
+  Accelerated = SelectCrc32Implementation (TRUE);
+  SelectCrc32Implementation (FALSE);
+
+  DEBUG ((DEBUG_INFO, "%a: throughput in MB/s\n", gEfiCallerBaseName));
+  DEBUG ((DEBUG_INFO, "%10a %10a %10a\n", "Length", "Table", "PCLMULQDQ"));
+  for (Index = 0; Index < ARRAY_SIZE (mBenchmarkLengths); Index++) {
+    SelectCrc32Implementation (FALSE);
+    Table  = MeasureThroughput (mBenchmarkLengths[Index]);
+    Pclmul = 0;
+    if (Accelerated) {
+      SelectCrc32Implementation (TRUE);
+      Pclmul = MeasureThroughput (mBenchmarkLengths[Index]);
+      SelectCrc32Implementation (FALSE);
+    }
+    DEBUG ((
+      DEBUG_INFO,
+      "%10Lu %10Lu %10Lu\n",
+      (UINT64)mBenchmarkLengths[Index],
+      Table,
+      Pclmul
+      ));
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for
+  CalculateCrc32 and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      Crc32Tests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+  UINTN                       Index;
+  UINT32                      Seed;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  gUnitTestHostBaseLib.X86->AsmCpuid = HostAsmCpuid;
+#endif
+
+  mBuffer = AllocatePool (MAX (CRC32_TEST_BUFFER_SIZE, SIZE_1MB) + CRC32_TEST_OFFSETS);
+  if (mBuffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  Seed = 0x12345678;
+  for (Index = 0; Index < MAX (CRC32_TEST_BUFFER_SIZE, SIZE_1MB) + CRC32_TEST_OFFSETS; Index++) {
+    Seed = Seed * 1103515245 + 12345;
+    mBuffer[Index] = (UINT8)(Seed >> 16);
+  }
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&Crc32Tests, Fw, "CRC32", "BaseLib.Crc32", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for Crc32Tests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (Crc32Tests, "CRC-32 check value", "CheckValue", Crc32CheckValueTest, NULL, NULL, NULL);
+  AddTestCase (Crc32Tests, "Table driven CRC32 matches bitwise reference", "Table", Crc32TableTest, NULL, NULL, NULL);
+  AddTestCase (Crc32Tests, "PCLMULQDQ CRC32 matches table driven CRC32", "Pclmul", Crc32PclmulTest, Crc32PclmulPrerequisite, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Fw, "Throughput", "BaseLib.Crc32Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "CalculateCrc32 throughput", "Benchmark", BenchmarkTest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework (Fw);
+  }
+  if (mBuffer != NULL) {
+    FreePool (mBuffer);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
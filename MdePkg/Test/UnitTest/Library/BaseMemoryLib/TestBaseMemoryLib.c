@@ -0,0 +1,506 @@
+/** @file
+  Host based unit tests and throughput benchmark of BaseMemoryLib.
+
+  The same source is built once for every BaseMemoryLib instance in MdePkg,
+  so the tests check that each instance behaves like a byte at a time
+  reference and the benchmark results of the instances can be compared.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+#include <Library/UnitTestHostBaseLib.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#define UNIT_TEST_APP_NAME     "BaseMemoryLib Unit Test Application"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// The correctness tests run every length below TEST_SMALL_LENGTH, plus a few
+// larger lengths, at every source and destination offset below TEST_OFFSETS.
+//
+#define TEST_SMALL_LENGTH   300
+#define TEST_OFFSETS        40
+#define TEST_BUFFER_SIZE    SIZE_256KB
+
+//
+// Number of bytes each benchmark measurement moves in total.
+//
+#define BENCHMARK_TOTAL_BYTES  SIZE_256MB
+
+STATIC CONST UINTN  mLargeLengths[] = {
+  1000, 4095, 4096, 4099, 65537
+};
+
+STATIC CONST UINTN  mBenchmarkLengths[] = {
+  64, 256, SIZE_4KB, SIZE_64KB, SIZE_1MB, SIZE_8MB
+};
+
+STATIC UINT8  *mBuffer;
+STATIC UINT8  *mReference;
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+/**
+  Execute the real CPUID instruction, so that BaseMemoryLib instances that
+  select code based on processor features pick the same code as on hardware.
+
+  @param[in]  Index     The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[in]  SubIndex  The 32-bit value to load into ECX prior to invoking the CPUID instruction.
+  @param[out] Eax       The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx       The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx       The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx       The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+
+**/
+STATIC
+UINT32
+EFIAPI
+HostAsmCpuidEx (
+  IN      UINT32                    Index,
+  IN      UINT32                    SubIndex,
+  OUT     UINT32                    *Eax,  OPTIONAL
+  OUT     UINT32                    *Ebx,  OPTIONAL
+  OUT     UINT32                    *Ecx,  OPTIONAL
+  OUT     UINT32                    *Edx   OPTIONAL
+  )
+{
+  UINT32  Registers[4];
+
+#if defined (_MSC_VER)
+  __cpuidex ((int *)Registers, (int)Index, (int)SubIndex);
+#else
+  __cpuid_count (Index, SubIndex, Registers[0], Registers[1], Registers[2], Registers[3]);
+#endif
+  if (Eax != NULL) {
+    *Eax = Registers[0];
+  }
+  if (Ebx != NULL) {
+    *Ebx = Registers[1];
+  }
+  if (Ecx != NULL) {
+    *Ecx = Registers[2];
+  }
+  if (Edx != NULL) {
+    *Edx = Registers[3];
+  }
+  return Index;
+}
+
+/**
+  Execute the real CPUID instruction with a sub-leaf of zero.
+
+  @param[in]  Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out] Eax    The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx    The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx    The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx    The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+
+**/
+STATIC
+UINT32
+EFIAPI
+HostAsmCpuid (
+  IN      UINT32                    Index,
+  OUT     UINT32                    *Eax,  OPTIONAL
+  OUT     UINT32                    *Ebx,  OPTIONAL
+  OUT     UINT32                    *Ecx,  OPTIONAL
+  OUT     UINT32                    *Edx   OPTIONAL
+  )
+{
+  return HostAsmCpuidEx (Index, 0, Eax, Ebx, Ecx, Edx);
+}
+#endif
+
+/**
+  Fill a buffer with a pseudo random pattern.
+
+  @param[out] Buffer  The buffer to fill.
+  @param[in]  Length  The size of Buffer in bytes.
+  @param[in]  Seed    The seed of the pattern.
+
+**/
+STATIC
+VOID
+FillPattern (
+  OUT UINT8   *Buffer,
+  IN  UINTN   Length,
+  IN  UINT32  Seed
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    Seed = Seed * 1103515245 + 12345;
+    Buffer[Index] = (UINT8)(Seed >> 16);
+  }
+}
+
+/**
+  Copy one range of mBuffer over another and compare the result with
+  the same copy done a byte at a time on mReference.
+
+  @param[in]  SourceOffset       The offset of the source in the buffer.
+  @param[in]  DestinationOffset  The offset of the destination in the buffer.
+  @param[in]  Length             The number of bytes to copy.
+
+  @retval TRUE   CopyMem() produced the expected buffer.
+  @retval FALSE  CopyMem() corrupted the buffer or returned the wrong value.
+
+**/
+STATIC
+BOOLEAN
+CheckCopy (
+  IN UINTN  SourceOffset,
+  IN UINTN  DestinationOffset,
+  IN UINTN  Length
+  )
+{
+  UINTN  Index;
+  UINTN  Window;
+  VOID   *Result;
+
+  //
+  // Only the part of the buffer that the copy could have touched, plus a
+  // guard band, is compared.
+  //
+  Window = MAX (SourceOffset, DestinationOffset) + Length + 64;
+  FillPattern (mBuffer, Window, (UINT32)(Length + SourceOffset));
+  for (Index = 0; Index < Window; Index++) {
+    mReference[Index] = mBuffer[Index];
+  }
+
+  Result = CopyMem (mBuffer + DestinationOffset, mBuffer + SourceOffset, Length);
+
+  if (DestinationOffset < SourceOffset) {
+    for (Index = 0; Index < Length; Index++) {
+      mReference[DestinationOffset + Index] = mReference[SourceOffset + Index];
+    }
+  } else {
+    for (Index = Length; Index > 0; Index--) {
+      mReference[DestinationOffset + Index - 1] = mReference[SourceOffset + Index - 1];
+    }
+  }
+
+  for (Index = 0; Index < Window; Index++) {
+    if (mBuffer[Index] != mReference[Index]) {
+      return FALSE;
+    }
+  }
+  return (BOOLEAN)(Result == mBuffer + DestinationOffset);
+}
+
+/**
+  Set a range of mBuffer and compare the result with the same range set
+  a byte at a time on mReference.
+
+  @param[in]  Offset  The offset of the range in the buffer.
+  @param[in]  Length  The number of bytes to set.
+  @param[in]  Zero    TRUE to use ZeroMem(), FALSE to use SetMem().
+
+  @retval TRUE   The function produced the expected buffer.
+  @retval FALSE  The function corrupted the buffer or returned the wrong value.
+
+**/
+STATIC
+BOOLEAN
+CheckSet (
+  IN UINTN    Offset,
+  IN UINTN    Length,
+  IN BOOLEAN  Zero
+  )
+{
+  UINTN  Index;
+  UINTN  Window;
+  UINT8  Value;
+  VOID   *Result;
+
+  Window = Offset + Length + 64;
+  FillPattern (mBuffer, Window, (UINT32)(Length + Offset));
+  for (Index = 0; Index < Window; Index++) {
+    mReference[Index] = mBuffer[Index];
+  }
+
+  Value = Zero ? 0 : (UINT8)(0xA5 ^ Length);
+  if (Zero) {
+    Result = ZeroMem (mBuffer + Offset, Length);
+  } else {
+    Result = SetMem (mBuffer + Offset, Length, Value);
+  }
+
+  for (Index = 0; Index < Length; Index++) {
+    mReference[Offset + Index] = Value;
+  }
+
+  for (Index = 0; Index < Window; Index++) {
+    if (mBuffer[Index] != mReference[Index]) {
+      return FALSE;
+    }
+  }
+  return (BOOLEAN)(Result == mBuffer + Offset);
+}
+
+/**
+  Return the lengths exercised by the correctness tests.
+
+  @param[in]  Index  Index of the length.
+
+  @return The length, or MAX_UINTN when Index is past the last length.
+
+**/
+STATIC
+UINTN
+TestLength (
+  IN UINTN  Index
+  )
+{
+  if (Index < TEST_SMALL_LENGTH) {
+    return Index;
+  }
+  Index -= TEST_SMALL_LENGTH;
+  if (Index < ARRAY_SIZE (mLargeLengths)) {
+    return mLargeLengths[Index];
+  }
+  return MAX_UINTN;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+CopyMemTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  LengthIndex;
+  UINTN  Length;
+  UINTN  Source;
+  UINTN  Destination;
+
+  //
+  // Source and destination are placed both in separate and in overlapping
+  // parts of the buffer, in both orders.
+  //
+  for (LengthIndex = 0; (Length = TestLength (LengthIndex)) != MAX_UINTN; LengthIndex++) {
+    for (Source = 0; Source < TEST_OFFSETS; Source += 3) {
+      for (Destination = 0; Destination < TEST_OFFSETS; Destination++) {
+        UT_ASSERT_TRUE (CheckCopy (Source, Length + 64 + Destination, Length));
+        UT_ASSERT_TRUE (CheckCopy (Length + 64 + Source, Destination, Length));
+        UT_ASSERT_TRUE (CheckCopy (TEST_OFFSETS + Source, Destination * 2, Length));
+      }
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+SetMemTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  LengthIndex;
+  UINTN  Length;
+  UINTN  Offset;
+
+  for (LengthIndex = 0; (Length = TestLength (LengthIndex)) != MAX_UINTN; LengthIndex++) {
+    for (Offset = 0; Offset < TEST_OFFSETS; Offset++) {
+      UT_ASSERT_TRUE (CheckSet (Offset, Length, FALSE));
+      UT_ASSERT_TRUE (CheckSet (Offset, Length, TRUE));
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Return the throughput of one BaseMemoryLib function in MB/s.
+
+  @param[in]  Function  0 for CopyMem(), 1 for SetMem() and 2 for ZeroMem().
+  @param[in]  Buffer    A buffer of at least twice Length bytes.
+  @param[in]  Length    The number of bytes each call operates on.
+
+  @return The throughput in MB/s.
+
+**/
+STATIC
+UINT64
+MeasureThroughput (
+  IN UINTN  Function,
+  IN UINT8  *Buffer,
+  IN UINTN  Length
+  )
+{
+  UINTN    Iterations;
+  UINTN    Index;
+  clock_t  Start;
+  clock_t  Elapsed;
+
+  Iterations = BENCHMARK_TOTAL_BYTES / Length;
+  Start      = clock ();
+  for (Index = 0; Index < Iterations; Index++) {
+    switch (Function) {
+      case 0:
+        //
+        // Use a misaligned source, which is the common case for decompression
+        // and frame buffer blits.
+        //
+        CopyMem (Buffer, Buffer + Length + 1, Length);
+        break;
+      case 1:
+        SetMem (Buffer, Length, (UINT8)Index);
+        break;
+      default:
+        ZeroMem (Buffer, Length);
+        break;
+    }
+  }
+  Elapsed = clock () - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  return DivU64x64Remainder (
+           MultU64x32 (BENCHMARK_TOTAL_BYTES / SIZE_1MB, CLOCKS_PER_SEC),
+           (UINT64)Elapsed,
+           NULL
+           );
+}
+
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkTest (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  *Buffer;
+  UINTN  Index;
+
+  Buffer = AllocatePool (2 * SIZE_8MB + 1);
+  UT_ASSERT_NOT_NULL (Buffer);
+
+  DEBUG ((DEBUG_INFO, "%a: throughput in MB/s\n", gEfiCallerBaseName));
+  DEBUG ((DEBUG_INFO, "%10a %10a %10a %10a\n", "Length", "CopyMem", "SetMem", "ZeroMem"));
+  for (Index = 0; Index < ARRAY_SIZE (mBenchmarkLengths); Index++) {
+    DEBUG ((
+      DEBUG_INFO,
+      "%10Lu %10Lu %10Lu %10Lu\n",
+      (UINT64)mBenchmarkLengths[Index],
+      MeasureThroughput (0, Buffer, mBenchmarkLengths[Index]),
+      MeasureThroughput (1, Buffer, mBenchmarkLengths[Index]),
+      MeasureThroughput (2, Buffer, mBenchmarkLengths[Index])
+      ));
+  }
+
+  FreePool (Buffer);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  BaseMemoryLib instance and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Fw;
+  UNIT_TEST_SUITE_HANDLE      MemoryTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Fw = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+#if defined (MDE_CPU_IA32) || defined (MDE_CPU_X64)
+  gUnitTestHostBaseLib.X86->AsmCpuid   = HostAsmCpuid;
+  gUnitTestHostBaseLib.X86->AsmCpuidEx = HostAsmCpuidEx;
+#endif
+
+  mBuffer    = AllocatePool (TEST_BUFFER_SIZE);
+  mReference = AllocatePool (TEST_BUFFER_SIZE);
+  if ((mBuffer == NULL) || (mReference == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&MemoryTests, Fw, "Memory functions", "BaseMemoryLib.Memory", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MemoryTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (MemoryTests, "CopyMem matches byte copy for all overlaps", "CopyMem", CopyMemTest, NULL, NULL, NULL);
+  AddTestCase (MemoryTests, "SetMem and ZeroMem match byte stores", "SetMem", SetMemTest, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Fw, "Throughput", "BaseMemoryLib.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "CopyMem, SetMem and ZeroMem throughput", "Benchmark", BenchmarkTest, NULL, NULL, NULL);
+
+  Status = RunAllTestSuites (Fw);
+
+EXIT:
+  if (Fw) {
+    FreeUnitTestFramework (Fw);
+  }
+  if (mBuffer != NULL) {
+    FreePool (mBuffer);
+  }
+  if (mReference != NULL) {
+    FreePool (mReference);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -1156,7 +1156,18 @@ HttpBootGetBootFile (
     // is handled in different path here.
     //
     ZeroMem (&ResponseBody, sizeof (HTTP_IO_RESPONSE_DATA));
-    if (IdentityMode) {
+    if (IdentityMode && Private->Stream.Requested &&
+        ((*ImageType == ImageTypeVirtualCd) || (*ImageType == ImageTypeVirtualDisk)) &&
+        (ContentLength != 0) && (ContentLength <= *BufferSize)) {
+      //
+      // Leave the message-body to the stream, which receives it in the
+      // background once the RAM disk is registered.
+      //
+      Status = HttpBootStreamStart (Private, Buffer, ContentLength);
+      if (EFI_ERROR (Status)) {
+        goto ERROR_6;
+      }
+    } else if (IdentityMode) {
       //
       // In identity transfer-coding there is no need to parse the message body,
       // just download the message body to the user provided buffer directly.
@@ -53,6 +53,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Ip4Config2.h>
 #include <Protocol/Ip6Config.h>
 #include <Protocol/RamDisk.h>
+#include <Protocol/RamDiskStream.h>
 #include <Protocol/AdapterInformation.h>
 
 //
@@ -108,6 +109,7 @@ typedef enum  {
 #include "HttpBootImpl.h"
 #include "HttpBootSupport.h"
 #include "HttpBootClient.h"
+#include "HttpBootStream.h"
 #include "HttpBootConfig.h"
 
 typedef union {
@@ -223,6 +225,11 @@ struct _HTTP_BOOT_PRIVATE_DATA {
   //
   LIST_ENTRY                                CacheList;
 
+  //
+  // Boot file received in the background into its RAM disk
+  //
+  HTTP_BOOT_STREAM                          Stream;
+
   //
   // Cached DHCP offer
   //
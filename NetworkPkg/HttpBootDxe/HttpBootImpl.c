@@ -384,6 +384,7 @@ HttpBootLoadFile (
   //
   // Load the boot file into Buffer
   //
+  Private->Stream.Requested = HttpBootStreamEnabled (Private);
   Status = HttpBootGetBootFile (
              Private,
              FALSE,
@@ -391,6 +392,7 @@ HttpBootLoadFile (
              Buffer,
              ImageType
              );
+  Private->Stream.Requested = FALSE;
 
 ON_EXIT:
   HttpBootUninstallCallback (Private);
@@ -442,6 +444,8 @@ HttpBootStop (
     return EFI_NOT_STARTED;
   }
 
+  HttpBootStreamStop (Private);
+
   if (Private->HttpCreated) {
     HttpIoDestroyIo (&Private->HttpIo);
     Private->HttpCreated = FALSE;
@@ -621,9 +625,12 @@ HttpBootDxeLoadFile (
   }
 
   //
-  // Stop the HTTP Boot service after the boot image is downloaded.
+  // Stop the HTTP Boot service after the boot image is downloaded. A boot
+  // image that is still received into its RAM disk keeps it running.
   //
-  HttpBootStop (Private);
+  if (Private->Stream.RamDiskDevicePath == NULL) {
+    HttpBootStop (Private);
+  }
   return Status;
 }
 
@@ -0,0 +1,432 @@
+/** @file
+  Background download of RAM disk boot files.
+
+  A boot file that is a RAM disk image can be received straight into the
+  RAM disk allocated by the boot manager. The RAM disk is registered as soon
+  as the response headers are in, and its reads and writes wait only for the
+  ranges of the image that have not arrived yet. This lets the boot loader
+  on the image start while the rest of the image is still downloaded.
+
+  The OS only gets the RAM disk through the NFIT, which the RAM disk driver
+  publishes when the stream ends with the whole image. If the boot loader
+  leaves boot services before that, the RAM disk is never published, so the
+  OS doesn't get a partial image.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "HttpBootDxe.h"
+
+/**
+  Queue a receive for the rest of the message-body.
+
+  @param[in]  Stream          The stream of the boot file.
+
+**/
+VOID
+HttpBootStreamReceive (
+  IN HTTP_BOOT_STREAM             *Stream
+  )
+{
+  EFI_HTTP_PROTOCOL               *Http;
+  EFI_STATUS                      Status;
+
+  Stream->Message.Data.Response = NULL;
+  Stream->Message.HeaderCount   = 0;
+  Stream->Message.Headers       = NULL;
+  Stream->Message.BodyLength    = Stream->Size - Stream->Received;
+  Stream->Message.Body          = Stream->Buffer + Stream->Received;
+  Stream->Token.Message         = &Stream->Message;
+  Stream->Token.Status          = EFI_NOT_READY;
+
+  Http   = Stream->Private->HttpIo.Http;
+  Status = Http->Response (Http, &Stream->Token);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "HTTP Boot: Failed to receive the boot file - %r\n", Status));
+    Stream->Status = Status;
+  }
+}
+
+/**
+  Account for a completed receive, and queue the next one until the whole
+  message-body is received.
+
+  @param[in]  Stream          The stream of the boot file.
+
+**/
+VOID
+HttpBootStreamProcess (
+  IN HTTP_BOOT_STREAM             *Stream
+  )
+{
+  //
+  // The completion may be processed in HttpBootStreamFill() before the
+  // notification function of the token gets to run.
+  //
+  if ((Stream->Status != EFI_NOT_READY) || (Stream->Token.Status == EFI_NOT_READY)) {
+    return;
+  }
+
+  if (EFI_ERROR (Stream->Token.Status)) {
+    DEBUG ((DEBUG_ERROR, "HTTP Boot: Failed to receive the boot file - %r\n", Stream->Token.Status));
+    Stream->Status = Stream->Token.Status;
+    return;
+  }
+
+  Stream->Received += Stream->Message.BodyLength;
+  if (Stream->Received >= Stream->Size) {
+    DEBUG ((DEBUG_INFO, "HTTP Boot: Boot file of %ld bytes received\n", (UINT64) Stream->Size));
+    Stream->Status = EFI_SUCCESS;
+    return;
+  }
+
+  HttpBootStreamReceive (Stream);
+}
+
+/**
+  Notification function of the response token of the stream.
+
+  @param[in]  Event           The event signaled.
+  @param[in]  Context         The stream of the boot file.
+
+**/
+VOID
+EFIAPI
+HttpBootStreamNotify (
+  IN EFI_EVENT                    Event,
+  IN VOID                         *Context
+  )
+{
+  HttpBootStreamProcess ((HTTP_BOOT_STREAM *) Context);
+}
+
+/**
+  Cancel the receive of the stream, if it is still going on.
+
+  @param[in]  Stream          The stream of the boot file.
+  @param[in]  Status          The status to leave the stream in.
+
+**/
+VOID
+HttpBootStreamCancel (
+  IN HTTP_BOOT_STREAM             *Stream,
+  IN EFI_STATUS                   Status
+  )
+{
+  EFI_HTTP_PROTOCOL               *Http;
+
+  if (Stream->Status != EFI_NOT_READY) {
+    return;
+  }
+
+  Stream->Status = Status;
+  if (Stream->Token.Status == EFI_NOT_READY) {
+    Http = Stream->Private->HttpIo.Http;
+    Http->Cancel (Http, &Stream->Token);
+  }
+}
+
+/**
+  Wait until a range of the RAM disk is received.
+
+  @param[in]  This            The producer of the RAM disk.
+  @param[in]  Offset          The offset of the range in the RAM disk.
+  @param[in]  Length          The length of the range, in bytes.
+
+  @retval EFI_SUCCESS         The range is received.
+  @retval EFI_TIMEOUT         The server stopped sending the boot file.
+  @retval Others              The boot file could not be received.
+
+**/
+EFI_STATUS
+EFIAPI
+HttpBootStreamFill (
+  IN EDKII_RAM_DISK_PRODUCER      *This,
+  IN UINT64                       Offset,
+  IN UINT64                       Length
+  )
+{
+  HTTP_BOOT_STREAM                *Stream;
+  EFI_HTTP_PROTOCOL               *Http;
+  EFI_EVENT                       TimeoutEvent;
+  EFI_TPL                         OldTpl;
+  UINT64                          End;
+  UINTN                           Received;
+
+  Stream = HTTP_BOOT_STREAM_FROM_PRODUCER (This);
+  End    = Offset + Length;
+  if (End <= Stream->Received) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The notification function of the token can't run when the caller is at
+  // TPL_CALLBACK, so the completion of a receive is processed here instead.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+
+  Http         = Stream->Private->HttpIo.Http;
+  TimeoutEvent = Stream->TimeoutEvent;
+  Received     = Stream->Received;
+  gBS->SetTimer (TimeoutEvent, TimerRelative, Stream->Private->HttpIo.Timeout * TICKS_PER_MS);
+
+  while ((End > Stream->Received) && (Stream->Status == EFI_NOT_READY)) {
+    Http->Poll (Http);
+    if (OldTpl >= TPL_CALLBACK) {
+      HttpBootStreamProcess (Stream);
+    }
+
+    if (Stream->Received != Received) {
+      Received = Stream->Received;
+      gBS->SetTimer (TimeoutEvent, TimerRelative, Stream->Private->HttpIo.Timeout * TICKS_PER_MS);
+    } else if (!EFI_ERROR (gBS->CheckEvent (TimeoutEvent))) {
+      DEBUG ((DEBUG_ERROR, "HTTP Boot: Boot file receive timeout at %ld bytes\n", (UINT64) Stream->Received));
+      HttpBootStreamCancel (Stream, EFI_TIMEOUT);
+    }
+  }
+
+  gBS->SetTimer (TimeoutEvent, TimerCancel, 0);
+
+  if (End <= Stream->Received) {
+    return EFI_SUCCESS;
+  }
+
+  return EFI_ERROR (Stream->Status) ? Stream->Status : EFI_DEVICE_ERROR;
+}
+
+/**
+  Called when the RAM disk of the stream is unregistered.
+
+  @param[in]  This            The producer of the RAM disk.
+
+**/
+VOID
+EFIAPI
+HttpBootStreamRelease (
+  IN EDKII_RAM_DISK_PRODUCER      *This
+  )
+{
+  HTTP_BOOT_STREAM                *Stream;
+  BOOLEAN                         Received;
+
+  Stream = HTTP_BOOT_STREAM_FROM_PRODUCER (This);
+
+  //
+  // The RAM disk driver already detached the producer.
+  //
+  FreePool (Stream->RamDiskDevicePath);
+  Stream->RamDiskDevicePath = NULL;
+
+  Received = (BOOLEAN) (Stream->Status == EFI_SUCCESS);
+  HttpBootStreamStop (Stream->Private);
+
+  //
+  // The HTTP connection is left in the middle of a message-body, so the
+  // next boot attempt has to start over.
+  //
+  if (!Received) {
+    HttpBootStop (Stream->Private);
+  }
+}
+
+/**
+  Check whether the RAM disk boot file of the next download can be received
+  in the background.
+
+  @param[in]  Private         The pointer to the driver's private data.
+
+  @retval TRUE                The boot file can be streamed to the RAM disk.
+  @retval FALSE               The boot file must be downloaded first.
+
+**/
+BOOLEAN
+HttpBootStreamEnabled (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private
+  )
+{
+  EDKII_RAM_DISK_STREAM_PROTOCOL  *RamDiskStream;
+
+  if (!PcdGetBool (PcdHttpBootRamDiskStreaming)) {
+    return FALSE;
+  }
+
+  if ((Private->ImageType != ImageTypeVirtualCd) &&
+      (Private->ImageType != ImageTypeVirtualDisk)) {
+    return FALSE;
+  }
+
+  return (BOOLEAN) !EFI_ERROR (
+                     gBS->LocateProtocol (
+                            &gEdkiiRamDiskStreamProtocolGuid,
+                            NULL,
+                            (VOID **) &RamDiskStream
+                            )
+                     );
+}
+
+/**
+  Start receiving the message-body of the boot file in the background, once
+  its response headers are received.
+
+  @param[in]  Private         The pointer to the driver's private data.
+  @param[in]  Buffer          The buffer to receive the message-body into.
+  @param[in]  Size            The length of the message-body, in bytes.
+
+  @retval EFI_SUCCESS         The message-body is being received.
+  @retval Others              The receive could not be started.
+
+**/
+EFI_STATUS
+HttpBootStreamStart (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private,
+  IN UINT8                        *Buffer,
+  IN UINTN                        Size
+  )
+{
+  HTTP_BOOT_STREAM                *Stream;
+  EFI_STATUS                      Status;
+
+  HttpBootStreamStop (Private);
+
+  Stream = &Private->Stream;
+  ZeroMem (&Stream->Token, sizeof (Stream->Token));
+  ZeroMem (&Stream->Message, sizeof (Stream->Message));
+
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  HttpBootStreamNotify,
+                  Stream,
+                  &Stream->Token.Event
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER,
+                  TPL_CALLBACK,
+                  NULL,
+                  NULL,
+                  &Stream->TimeoutEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Stream->Token.Event);
+    return Status;
+  }
+
+  Stream->Producer.Fill    = HttpBootStreamFill;
+  Stream->Producer.Release = HttpBootStreamRelease;
+  Stream->Private          = Private;
+  Stream->Buffer           = Buffer;
+  Stream->Size             = Size;
+  Stream->Received         = 0;
+  Stream->Status           = EFI_NOT_READY;
+  Stream->Started          = TRUE;
+
+  HttpBootStreamReceive (Stream);
+  if (EFI_ERROR (Stream->Status) && (Stream->Status != EFI_NOT_READY)) {
+    Status = Stream->Status;
+    HttpBootStreamStop (Private);
+  }
+
+  return Status;
+}
+
+/**
+  Register the RAM disk of a boot file that is still being received.
+
+  @param[in]  Private         The pointer to the driver's private data.
+  @param[in]  BufferSize      The size of Buffer in bytes.
+  @param[in]  Buffer          The base address of the RAM disk.
+  @param[in]  RamDiskType     The type of the RAM disk.
+
+  @retval EFI_SUCCESS         The RAM disk has been registered.
+  @retval Others              The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+HttpBootStreamRegisterRamDisk (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private,
+  IN UINTN                        BufferSize,
+  IN VOID                         *Buffer,
+  IN EFI_GUID                     *RamDiskType
+  )
+{
+  EDKII_RAM_DISK_STREAM_PROTOCOL  *RamDiskStream;
+  EFI_STATUS                      Status;
+
+  ASSERT (Private->Stream.Started);
+
+  Status = gBS->LocateProtocol (
+                  &gEdkiiRamDiskStreamProtocolGuid,
+                  NULL,
+                  (VOID **) &RamDiskStream
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return RamDiskStream->RegisterStream (
+                          RamDiskStream,
+                          (UINTN) Buffer,
+                          (UINT64) BufferSize,
+                          RamDiskType,
+                          Private->UsingIpv6 ? Private->Ip6Nic->DevicePath : Private->Ip4Nic->DevicePath,
+                          &Private->Stream.Producer,
+                          &Private->Stream.RamDiskDevicePath
+                          );
+}
+
+/**
+  Stop receiving the boot file in the background, and detach it from its
+  RAM disk.
+
+  @param[in]  Private         The pointer to the driver's private data.
+
+**/
+VOID
+HttpBootStreamStop (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private
+  )
+{
+  HTTP_BOOT_STREAM                *Stream;
+  EDKII_RAM_DISK_STREAM_PROTOCOL  *RamDiskStream;
+  EFI_STATUS                      Status;
+
+  Stream = &Private->Stream;
+  if (!Stream->Started) {
+    return;
+  }
+
+  HttpBootStreamCancel (Stream, EFI_ABORTED);
+
+  if (Stream->RamDiskDevicePath != NULL) {
+    if (Stream->Status != EFI_SUCCESS) {
+      DEBUG ((DEBUG_WARN, "HTTP Boot: RAM disk left with %ld of %ld bytes\n", (UINT64) Stream->Received, (UINT64) Stream->Size));
+    }
+
+    Status = gBS->LocateProtocol (
+                    &gEdkiiRamDiskStreamProtocolGuid,
+                    NULL,
+                    (VOID **) &RamDiskStream
+                    );
+    if (!EFI_ERROR (Status)) {
+      RamDiskStream->EndStream (
+                       RamDiskStream,
+                       Stream->RamDiskDevicePath,
+                       (BOOLEAN) (Stream->Status == EFI_SUCCESS)
+                       );
+    }
+
+    FreePool (Stream->RamDiskDevicePath);
+    Stream->RamDiskDevicePath = NULL;
+  }
+
+  gBS->SetTimer (Stream->TimeoutEvent, TimerCancel, 0);
+  gBS->CloseEvent (Stream->TimeoutEvent);
+  gBS->CloseEvent (Stream->Token.Event);
+  Stream->Started = FALSE;
+}
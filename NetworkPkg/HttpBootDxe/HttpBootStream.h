@@ -0,0 +1,98 @@
+/** @file
+  Declaration of the background download of RAM disk boot files.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __EFI_HTTP_BOOT_STREAM_H__
+#define __EFI_HTTP_BOOT_STREAM_H__
+
+//
+// A boot file whose message-body is received in the background, straight
+// into the memory of the RAM disk that the boot loader already uses.
+//
+typedef struct {
+  EDKII_RAM_DISK_PRODUCER    Producer;            // Given to the RAM disk driver
+  HTTP_BOOT_PRIVATE_DATA     *Private;
+  BOOLEAN                    Requested;           // Stream the next message-body
+  BOOLEAN                    Started;             // Token and events are created
+  EFI_STATUS                 Status;              // EFI_NOT_READY while receiving
+  UINT8                      *Buffer;
+  UINTN                      Size;
+  UINTN                      Received;
+  EFI_HTTP_TOKEN             Token;
+  EFI_HTTP_MESSAGE           Message;
+  EFI_EVENT                  TimeoutEvent;
+  EFI_DEVICE_PATH_PROTOCOL   *RamDiskDevicePath;  // Non-NULL while attached to a RAM disk
+} HTTP_BOOT_STREAM;
+
+#define HTTP_BOOT_STREAM_FROM_PRODUCER(a)  BASE_CR (a, HTTP_BOOT_STREAM, Producer)
+
+/**
+  Check whether the RAM disk boot file of the next download can be received
+  in the background.
+
+  @param[in]  Private         The pointer to the driver's private data.
+
+  @retval TRUE                The boot file can be streamed to the RAM disk.
+  @retval FALSE               The boot file must be downloaded first.
+
+**/
+BOOLEAN
+HttpBootStreamEnabled (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private
+  );
+
+/**
+  Start receiving the message-body of the boot file in the background, once
+  its response headers are received.
+
+  @param[in]  Private         The pointer to the driver's private data.
+  @param[in]  Buffer          The buffer to receive the message-body into.
+  @param[in]  Size            The length of the message-body, in bytes.
+
+  @retval EFI_SUCCESS         The message-body is being received.
+  @retval Others              The receive could not be started.
+
+**/
+EFI_STATUS
+HttpBootStreamStart (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private,
+  IN UINT8                        *Buffer,
+  IN UINTN                        Size
+  );
+
+/**
+  Register the RAM disk of a boot file that is still being received.
+
+  @param[in]  Private         The pointer to the driver's private data.
+  @param[in]  BufferSize      The size of Buffer in bytes.
+  @param[in]  Buffer          The base address of the RAM disk.
+  @param[in]  RamDiskType     The type of the RAM disk.
+
+  @retval EFI_SUCCESS         The RAM disk has been registered.
+  @retval Others              The RAM disk could not be registered.
+
+**/
+EFI_STATUS
+HttpBootStreamRegisterRamDisk (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private,
+  IN UINTN                        BufferSize,
+  IN VOID                         *Buffer,
+  IN EFI_GUID                     *RamDiskType
+  );
+
+/**
+  Stop receiving the boot file in the background, and detach it from its
+  RAM disk.
+
+  @param[in]  Private         The pointer to the driver's private data.
+
+**/
+VOID
+HttpBootStreamStop (
+  IN HTTP_BOOT_PRIVATE_DATA       *Private
+  );
+
+#endif
@@ -741,13 +741,20 @@ HttpBootRegisterRamDisk (
     return EFI_UNSUPPORTED;
   }
 
-  Status = RamDisk->Register (
-             (UINTN)Buffer,
-             (UINT64)BufferSize,
-             RamDiskType,
-             Private->UsingIpv6 ? Private->Ip6Nic->DevicePath : Private->Ip4Nic->DevicePath,
-             &DevicePath
-             );
+  if (Private->Stream.Started) {
+    //
+    // The boot file is still being received into Buffer.
+    //
+    Status = HttpBootStreamRegisterRamDisk (Private, BufferSize, Buffer, RamDiskType);
+  } else {
+    Status = RamDisk->Register (
+               (UINTN)Buffer,
+               (UINT64)BufferSize,
+               RamDiskType,
+               Private->UsingIpv6 ? Private->Ip6Nic->DevicePath : Private->Ip4Nic->DevicePath,
+               &DevicePath
+               );
+  }
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "HTTP Boot: Failed to register RAM Disk - %r\n", Status));
   }
@@ -44,6 +44,17 @@ EFI_TIMER_NOTIFY mTimerNotifyFunction;
 //
 volatile UINT64           mTimerPeriod = 0;
 
+//
+// The counter value programmed into Timer #0, 0 means 65536
+//
+UINT16                    mTimerCount = 0;
+
+//
+// TRUE if the pending Timer #0 interrupt was already reported by
+// TimerDriverSetTimerPeriod(), so the interrupt handler must not report it
+//
+BOOLEAN                   mTimerTickReported = FALSE;
+
 //
 // Worker Functions
 //
@@ -62,6 +73,61 @@ SetPitCount (
   IoWrite8 (TIMER0_COUNT_PORT, (UINT8)((Count >> 8) & 0xff));
 }
 
+/**
+  Returns the time elapsed in the current period of Timer #0.
+
+  Timer #0 runs in mode 3 (square wave), where the counter is decremented by
+  two and runs down twice per period, with OUT high during the first half of
+  the period and low during the second half.
+
+  @return The elapsed time in 100 ns units.
+**/
+UINT64
+GetPitElapsedTime (
+  VOID
+  )
+{
+  UINT8   PitStatus;
+  UINT32  Count;
+  UINT32  Period;
+  UINT32  Elapsed;
+
+  Period = (mTimerCount == 0) ? 65536 : mTimerCount;
+
+  //
+  // Read-back command latching both status and count of Timer #0
+  //
+  IoWrite8 (TIMER_CONTROL_PORT, 0xC2);
+  PitStatus = IoRead8 (TIMER0_COUNT_PORT);
+  Count     = IoRead8 (TIMER0_COUNT_PORT);
+  Count    |= (UINT32)IoRead8 (TIMER0_COUNT_PORT) << 8;
+  if (Count == 0 || Count > Period) {
+    Count = Period;
+  }
+
+  Elapsed = (Period - Count) / 2;
+  if ((PitStatus & BIT7) == 0) {
+    Elapsed += Period / 2;
+  }
+
+  return DivU64x32 (MultU64x32 (10000000, Elapsed), TIMER_FREQUENCY);
+}
+
+/**
+  Checks whether the Timer #0 interrupt is pending in the master 8259.
+
+  @retval TRUE    IRQ 0 is pending.
+  @retval FALSE   IRQ 0 is not pending.
+**/
+BOOLEAN
+IsPitInterruptPending (
+  VOID
+  )
+{
+  IoWrite8 (PIC_MASTER_CONTROL_PORT, PIC_OCW3_READ_IRR);
+  return (BOOLEAN)((IoRead8 (PIC_MASTER_CONTROL_PORT) & BIT0) != 0);
+}
+
 /**
   8254 Timer #0 Interrupt Handler.
 
@@ -79,7 +145,9 @@ TimerInterruptHandler (
 
   OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
 
-  if (mTimerNotifyFunction != NULL) {
+  if (mTimerTickReported) {
+    mTimerTickReported = FALSE;
+  } else if (mTimerNotifyFunction != NULL) {
     //
     // @bug : This does not handle missed timer interrupts
     //
@@ -182,6 +250,27 @@ TimerDriverSetTimerPeriod (
   )
 {
   UINT64  TimerCount;
+  UINT64  Elapsed;
+  EFI_TPL OriginalTPL;
+
+  //
+  // Reprogramming the counter restarts the current period, so report the time
+  // already elapsed in it to keep the DXE core system time accurate when the
+  // period is changed frequently, e.g. around idle.
+  //
+  // If a period has ended while interrupts were disabled, its interrupt is
+  // still pending and the counter has started over. That period is reported
+  // here as well, and the interrupt handler skips the pending interrupt, so
+  // it is not counted twice.
+  //
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mTimerPeriod != 0 && mTimerNotifyFunction != NULL) {
+    Elapsed = GetPitElapsedTime ();
+    if (!mTimerTickReported && IsPitInterruptPending ()) {
+      Elapsed += mTimerPeriod;
+    }
+    mTimerNotifyFunction (Elapsed);
+  }
 
   //
   //  The basic clock is 1.19318 MHz or 0.119318 ticks per 100 ns.
@@ -220,6 +309,7 @@ TimerDriverSetTimerPeriod (
     // Program the 8254 timer with the new count value
     //
     SetPitCount ((UINT16) TimerCount);
+    mTimerCount = (UINT16) TimerCount;
 
     //
     // Enable timer interrupt
@@ -231,6 +321,15 @@ TimerDriverSetTimerPeriod (
   //
   mTimerPeriod = TimerPeriod;
 
+  //
+  // Writing the control word raises OUT, which latches a new edge in the
+  // 8259 if OUT was low. Either way the pending interrupt is not the end of
+  // the new period.
+  //
+  mTimerTickReported = IsPitInterruptPending ();
+
+  gBS->RestoreTPL (OriginalTPL);
+
   return EFI_SUCCESS;
 }
 
@@ -39,6 +39,15 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define DEFAULT_TIMER_TICK_DURATION 100000
 #define TIMER_CONTROL_PORT          0x43
 #define TIMER0_COUNT_PORT           0x40
+//
+// The 8254 input clock frequency in Hz
+//
+#define TIMER_FREQUENCY             1193182
+//
+// The master 8259 and the OCW3 command to read its interrupt request register
+//
+#define PIC_MASTER_CONTROL_PORT     0x20
+#define PIC_OCW3_READ_IRR           0x0A
 
 //
 // Function Prototypes
@@ -26,8 +26,8 @@
                          be nonzero.)
 
                          On output, resources will be released, and
-                         VgpuGop->BackingStore and VgpuGop->ResourceId will be
-                         nulled.
+                         VgpuGop->BackingStore, VgpuGop->FrameBufferBltConfigure
+                         and VgpuGop->ResourceId will be nulled.
 
   param[in] DisableHead  Whether this head (scanout) currently references the
                          resource identified by VgpuGop->ResourceId. Only pass
@@ -120,6 +120,10 @@ ReleaseGopResources (
   VgpuGop->NumberOfPages = 0;
   VgpuGop->BackingStoreMap = NULL;
 
+  FreePool (VgpuGop->FrameBufferBltConfigure);
+  VgpuGop->FrameBufferBltConfigure     = NULL;
+  VgpuGop->FrameBufferBltConfigureSize = 0;
+
   //
   // Destroy the currently used 2D host resource.
   //
@@ -237,6 +241,9 @@ GopSetMode (
   VOID                 *NewBackingStore;
   EFI_PHYSICAL_ADDRESS NewBackingStoreDeviceAddress;
   VOID                 *NewBackingStoreMap;
+  EFI_GRAPHICS_OUTPUT_MODE_INFORMATION NewBltModeInfo;
+  FRAME_BUFFER_CONFIGURE               *NewFrameBufferBltConfigure;
+  UINTN                                NewFrameBufferBltConfigureSize;
 
   EFI_STATUS Status;
   EFI_STATUS Status2;
@@ -313,6 +320,41 @@ GopSetMode (
     goto DestroyHostResource;
   }
 
+  //
+  // Configure FrameBufferBltLib for rendering into the new backing store. We
+  // can avoid pixel format conversion in the guest because the internal
+  // representation of EFI_GRAPHICS_OUTPUT_BLT_PIXEL and that of
+  // VirtioGpuFormatB8G8R8X8Unorm are identical.
+  //
+  ZeroMem (&NewBltModeInfo, sizeof NewBltModeInfo);
+  NewBltModeInfo.HorizontalResolution = mGopResolutions[ModeNumber].Width;
+  NewBltModeInfo.VerticalResolution   = mGopResolutions[ModeNumber].Height;
+  NewBltModeInfo.PixelFormat          = PixelBlueGreenRedReserved8BitPerColor;
+  NewBltModeInfo.PixelsPerScanLine    = mGopResolutions[ModeNumber].Width;
+
+  NewFrameBufferBltConfigureSize = 0;
+  Status = FrameBufferBltConfigure (
+             NewBackingStore,
+             &NewBltModeInfo,
+             NULL,
+             &NewFrameBufferBltConfigureSize
+             );
+  ASSERT (Status == RETURN_BUFFER_TOO_SMALL);
+  NewFrameBufferBltConfigure = AllocatePool (NewFrameBufferBltConfigureSize);
+  if (NewFrameBufferBltConfigure == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto UnmapAndFreeBackingStore;
+  }
+  Status = FrameBufferBltConfigure (
+             NewBackingStore,
+             &NewBltModeInfo,
+             NewFrameBufferBltConfigure,
+             &NewFrameBufferBltConfigureSize
+             );
+  if (EFI_ERROR (Status)) {
+    goto FreeFrameBufferBltConfigure;
+  }
+
   //
   // Attach backing store to the host resource.
   //
@@ -323,7 +365,7 @@ GopSetMode (
              NewNumberOfPages              // NumberOfPages
              );
   if (EFI_ERROR (Status)) {
-    goto UnmapAndFreeBackingStore;
+    goto FreeFrameBufferBltConfigure;
   }
 
   //
@@ -392,11 +434,14 @@ GopSetMode (
   //
   ASSERT (VgpuGop->ResourceId == 0);
   ASSERT (VgpuGop->BackingStore == NULL);
+  ASSERT (VgpuGop->FrameBufferBltConfigure == NULL);
 
   VgpuGop->ResourceId = NewResourceId;
   VgpuGop->BackingStore = NewBackingStore;
   VgpuGop->NumberOfPages = NewNumberOfPages;
   VgpuGop->BackingStoreMap = NewBackingStoreMap;
+  VgpuGop->FrameBufferBltConfigure = NewFrameBufferBltConfigure;
+  VgpuGop->FrameBufferBltConfigureSize = NewFrameBufferBltConfigureSize;
 
   //
   // Populate Mode and ModeInfo (mutable fields only).
@@ -415,6 +460,9 @@ DetachBackingStore:
     CpuDeadLoop ();
   }
 
+FreeFrameBufferBltConfigure:
+  FreePool (NewFrameBufferBltConfigure);
+
 UnmapAndFreeBackingStore:
   VirtioGpuUnmapAndFreeBackingStore (
     VgpuGop->ParentBus, // VgpuDev
@@ -452,8 +500,6 @@ GopBlt (
   VGPU_GOP   *VgpuGop;
   UINT32     CurrentHorizontal;
   UINT32     CurrentVertical;
-  UINTN      SegmentSize;
-  UINTN      Y;
   UINTN      ResourceOffset;
   EFI_STATUS Status;
 
@@ -461,28 +507,6 @@ GopBlt (
   CurrentHorizontal = VgpuGop->GopModeInfo.HorizontalResolution;
   CurrentVertical   = VgpuGop->GopModeInfo.VerticalResolution;
 
-  //
-  // We can avoid pixel format conversion in the guest because the internal
-  // representation of EFI_GRAPHICS_OUTPUT_BLT_PIXEL and that of
-  // VirtioGpuFormatB8G8R8X8Unorm are identical.
-  //
-  SegmentSize = Width * sizeof (UINT32);
-
-  //
-  // Delta is relevant for operations that read a rectangle from, or write a
-  // rectangle to, BltBuffer.
-  //
-  // In these cases, Delta is the stride of BltBuffer, in bytes. If Delta is
-  // zero, then Width is the entire width of BltBuffer, and the stride is
-  // supposed to be calculated from Width.
-  //
-  if (BltOperation == EfiBltVideoToBltBuffer ||
-      BltOperation == EfiBltBufferToVideo) {
-    if (Delta == 0) {
-      Delta = SegmentSize;
-    }
-  }
-
   //
   // For operations that write to the display, check if the destination fits
   // onto the display.
@@ -513,103 +537,30 @@ GopBlt (
   }
 
   //
-  // Render the request. For requests that do not modify the display, there
-  // won't be further steps.
+  // Render the request into the backing store.
   //
-  switch (BltOperation) {
-  case EfiBltVideoFill:
-    //
-    // Write data from the BltBuffer pixel (0, 0) directly to every pixel of
-    // the video display rectangle (DestinationX, DestinationY) (DestinationX +
-    // Width, DestinationY + Height). Only one pixel will be used from the
-    // BltBuffer. Delta is NOT used.
-    //
-    for (Y = 0; Y < Height; ++Y) {
-      SetMem32 (
-        VgpuGop->BackingStore +
-          (DestinationY + Y) * CurrentHorizontal + DestinationX,
-        SegmentSize,
-        *(UINT32 *)BltBuffer
-        );
-    }
-    break;
+  Status = FrameBufferBlt (
+             VgpuGop->FrameBufferBltConfigure,
+             BltBuffer,
+             BltOperation,
+             SourceX,
+             SourceY,
+             DestinationX,
+             DestinationY,
+             Width,
+             Height,
+             Delta
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
 
-  case EfiBltVideoToBltBuffer:
-    //
-    // Read data from the video display rectangle (SourceX, SourceY) (SourceX +
-    // Width, SourceY + Height) and place it in the BltBuffer rectangle
-    // (DestinationX, DestinationY ) (DestinationX + Width, DestinationY +
-    // Height). If DestinationX or DestinationY is not zero then Delta must be
-    // set to the length in bytes of a row in the BltBuffer.
-    //
-    for (Y = 0; Y < Height; ++Y) {
-      CopyMem (
-        (UINT8 *)BltBuffer +
-          (DestinationY + Y) * Delta + DestinationX * sizeof *BltBuffer,
-        VgpuGop->BackingStore +
-          (SourceY + Y) * CurrentHorizontal + SourceX,
-        SegmentSize
-        );
-    }
+  //
+  // For requests that do not modify the display, there won't be further
+  // steps.
+  //
+  if (BltOperation == EfiBltVideoToBltBuffer) {
     return EFI_SUCCESS;
-
-  case EfiBltBufferToVideo:
-    //
-    // Write data from the BltBuffer rectangle (SourceX, SourceY) (SourceX +
-    // Width, SourceY + Height) directly to the video display rectangle
-    // (DestinationX, DestinationY) (DestinationX + Width, DestinationY +
-    // Height). If SourceX or SourceY is not zero then Delta must be set to the
-    // length in bytes of a row in the BltBuffer.
-    //
-    for (Y = 0; Y < Height; ++Y) {
-      CopyMem (
-        VgpuGop->BackingStore +
-          (DestinationY + Y) * CurrentHorizontal + DestinationX,
-        (UINT8 *)BltBuffer +
-          (SourceY + Y) * Delta + SourceX * sizeof *BltBuffer,
-        SegmentSize
-        );
-    }
-    break;
-
-  case EfiBltVideoToVideo:
-    //
-    // Copy from the video display rectangle (SourceX, SourceY) (SourceX +
-    // Width, SourceY + Height) to the video display rectangle (DestinationX,
-    // DestinationY) (DestinationX + Width, DestinationY + Height). The
-    // BltBuffer and Delta are not used in this mode.
-    //
-    // A single invocation of CopyMem() handles overlap between source and
-    // destination (that is, within a single line), but for multiple
-    // invocations, we must handle overlaps.
-    //
-    if (SourceY < DestinationY) {
-      Y = Height;
-      while (Y > 0) {
-        --Y;
-        CopyMem (
-          VgpuGop->BackingStore +
-            (DestinationY + Y) * CurrentHorizontal + DestinationX,
-          VgpuGop->BackingStore +
-            (SourceY + Y) * CurrentHorizontal + SourceX,
-          SegmentSize
-          );
-      }
-    } else {
-      for (Y = 0; Y < Height; ++Y) {
-        CopyMem (
-          VgpuGop->BackingStore +
-            (DestinationY + Y) * CurrentHorizontal + DestinationX,
-          VgpuGop->BackingStore +
-            (SourceY + Y) * CurrentHorizontal + SourceX,
-          SegmentSize
-          );
-      }
-    }
-    break;
-
-  default:
-    return EFI_INVALID_PARAMETER;
   }
 
   //
@@ -14,6 +14,7 @@
 #include <IndustryStandard/VirtioGpu.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/FrameBufferBltLib.h>
 #include <Library/UefiLib.h>
 #include <Protocol/GraphicsOutput.h>
 #include <Protocol/VirtioDevice.h>
@@ -151,6 +152,16 @@ struct VGPU_GOP_STRUCT {
   // BackingStore is non-NULL.
   //
   VOID                                 *BackingStoreMap;
+
+  //
+  // FrameBufferBltLib configuration that renders Blt() requests into
+  // BackingStore. The library keeps no record of the changed area; GopBlt()
+  // transfers and flushes the destination rectangle of each writing Blt()
+  // itself, and GopSetMode() flushes the full frame. FrameBufferBltConfigure
+  // is non-NULL if, and only if, BackingStore is non-NULL.
+  //
+  FRAME_BUFFER_CONFIGURE               *FrameBufferBltConfigure;
+  UINTN                                FrameBufferBltConfigureSize;
 };
 
 //
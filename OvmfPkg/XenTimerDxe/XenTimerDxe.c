@@ -41,9 +41,39 @@ EFI_TIMER_NOTIFY mTimerNotifyFunction;
 //
 volatile UINT64           mTimerPeriod = 0;
 
+//
+// TRUE if the pending timer interrupt was already reported by
+// TimerDriverSetTimerPeriod(), so the interrupt handler must not report it
+//
+BOOLEAN                   mTimerTickReported = FALSE;
+
 //
 // Worker Functions
 //
+/**
+  Checks whether the timer interrupt is pending in the local APIC.
+
+  @retval TRUE    LOCAL_APIC_TIMER_VECTOR is pending.
+  @retval FALSE   LOCAL_APIC_TIMER_VECTOR is not pending.
+**/
+BOOLEAN
+IsApicTimerInterruptPending (
+  VOID
+  )
+{
+  UINT32  Irr;
+
+  if (GetApicMode () == LOCAL_APIC_MODE_X2APIC) {
+    Irr = (UINT32)AsmReadMsr64 (MSR_IA32_X2APIC_IRR0 + LOCAL_APIC_TIMER_VECTOR / 32);
+  } else {
+    Irr = MmioRead32 (
+            GetLocalApicBaseAddress () + XAPIC_IRR_OFFSET + (LOCAL_APIC_TIMER_VECTOR / 32) * 0x10
+            );
+  }
+
+  return (BOOLEAN)((Irr & (1u << (LOCAL_APIC_TIMER_VECTOR % 32))) != 0);
+}
+
 /**
   Interrupt Handler.
 
@@ -61,7 +91,9 @@ TimerInterruptHandler (
 
   OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
 
-  if (mTimerNotifyFunction != NULL) {
+  if (mTimerTickReported) {
+    mTimerTickReported = FALSE;
+  } else if (mTimerNotifyFunction != NULL) {
     //
     // @bug : This does not handle missed timer interrupts
     //
@@ -166,6 +198,32 @@ TimerDriverSetTimerPeriod (
   UINT64  TimerCount;
   UINT32  TimerFrequency;
   UINTN   DivideValue = 1;
+  UINT32  ElapsedCount;
+  UINT64  Elapsed;
+  EFI_TPL OriginalTPL;
+
+  //
+  // Reprogramming the local APIC timer restarts the current period, so report
+  // the time already elapsed in it to keep the DXE core system time accurate
+  // when the period is changed frequently, e.g. around idle.
+  //
+  // If a period has ended while interrupts were disabled, its interrupt is
+  // still pending and the periodic timer has started over. That period is
+  // reported here as well, and the interrupt handler skips the pending
+  // interrupt, so it is not counted twice.
+  //
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mTimerPeriod != 0 && mTimerNotifyFunction != NULL) {
+    ElapsedCount = GetApicTimerInitCount () - GetApicTimerCurrentCount ();
+    Elapsed      = DivU64x32 (
+                     MultU64x32 (10000000, ElapsedCount),
+                     PcdGet32 (PcdFSBClock) / DivideValue
+                     );
+    if (!mTimerTickReported && IsApicTimerInterruptPending ()) {
+      Elapsed += mTimerPeriod;
+    }
+    mTimerNotifyFunction (Elapsed);
+  }
 
   if (TimerPeriod == 0) {
     //
@@ -205,6 +263,14 @@ TimerDriverSetTimerPeriod (
   //
   mTimerPeriod = TimerPeriod;
 
+  //
+  // Reprogramming does not clear a pending interrupt, and it is not the end
+  // of the new period.
+  //
+  mTimerTickReported = IsApicTimerInterruptPending ();
+
+  gBS->RestoreTPL (OriginalTPL);
+
   return EFI_SUCCESS;
 }
 
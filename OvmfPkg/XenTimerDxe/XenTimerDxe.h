@@ -16,10 +16,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Timer.h>
 
 #include <Register/LocalApic.h>
+#include <Register/Intel/ArchitecturalMsr.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
+#include <Library/IoLib.h>
 #include <Library/LocalApicLib.h>
 #include <Library/PcdLib.h>
 
@@ -32,6 +34,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 //
 #define LOCAL_APIC_TIMER_VECTOR 32
 
+//
+// The offset of the first interrupt request register in xAPIC mode
+//
+#define XAPIC_IRR_OFFSET        0x200
+
 //
 // Function Prototypes
 //
@@ -0,0 +1,390 @@
+/** @file
+  Statistical sampling profiler for the DXE and BDS phases.
+
+  The local APIC timer interrupts the boot processor at a fixed rate, and the
+  interrupt handler records the instruction pointer that was interrupted. At
+  ReadyToBoot, the samples are counted per address and written to the debug
+  log together with the load address and PDB path of each loaded image, found
+  in the EFI Debug Image Info Table. BaseTools/Scripts/SymbolizeProfile.py
+  turns the debug log into a profile by function.
+
+  Code that runs with interrupts disabled, at TPL_HIGH_LEVEL, is not sampled.
+  The profiler does not start if the local APIC timer is already in use, for
+  example as the timer tick or by a TimerLib instance.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+
+#include <Protocol/Cpu.h>
+#include <Guid/DebugImageInfoTable.h>
+#include <Guid/EventGroup.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/LocalApicLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PeCoffGetEntryPointLib.h>
+#include <Library/SortLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+//
+// Time over which the local APIC timer frequency is measured.
+//
+#define SAMPLING_PROFILER_CALIBRATION_US  10000
+
+EFI_CPU_ARCH_PROTOCOL  *mCpu;
+UINT8                  mVector;
+UINT64                 *mSamples;
+UINTN                  mSampleCount;
+UINTN                  mMaxSampleCount;
+UINTN                  mLostSampleCount;
+BOOLEAN                mSampling;
+
+/**
+  Records the interrupted instruction pointer.
+
+  @param  InterruptType    Defines the type of interrupt or exception that
+                           occurred on the processor.
+  @param  SystemContext    Pointer to the processor context when the interrupt
+                           occurred on the processor.
+
+**/
+VOID
+EFIAPI
+SamplingProfilerInterruptHandler (
+  IN EFI_EXCEPTION_TYPE  InterruptType,
+  IN EFI_SYSTEM_CONTEXT  SystemContext
+  )
+{
+  if (mSampleCount < mMaxSampleCount) {
+#if defined (MDE_CPU_IA32)
+    mSamples[mSampleCount++] = SystemContext.SystemContextIa32->Eip;
+#else
+    mSamples[mSampleCount++] = SystemContext.SystemContextX64->Rip;
+#endif
+  } else {
+    mLostSampleCount++;
+  }
+
+  SendApicEoi ();
+}
+
+/**
+  Stops the local APIC timer.
+
+**/
+VOID
+SamplingProfilerStop (
+  VOID
+  )
+{
+  if (!mSampling) {
+    return;
+  }
+
+  //
+  // An initial count of zero stops the timer.
+  //
+  DisableApicTimerInterrupt ();
+  InitializeApicTimer (0, 0, FALSE, mVector);
+  DisableApicTimerInterrupt ();
+  mSampling = FALSE;
+}
+
+/**
+  Starts the local APIC timer at the sampling rate.
+
+  @param  Rate   The number of samples per second.
+
+  @retval EFI_SUCCESS          The timer was started.
+  @retval EFI_ALREADY_STARTED  The local APIC timer is already in use.
+  @retval EFI_UNSUPPORTED      The rate cannot be reached with the local APIC
+                               timer.
+
+**/
+EFI_STATUS
+SamplingProfilerStart (
+  IN UINT32  Rate
+  )
+{
+  UINT64   Frequency;
+  UINT64   InitCount;
+  UINTN    DivideValue;
+  BOOLEAN  InterruptState;
+
+  //
+  // An unmasked or counting timer belongs to someone else, such as a timer
+  // driver or a TimerLib instance. Reprogramming it would break them.
+  //
+  if (GetApicTimerInterruptState () || (GetApicTimerCurrentCount () != 0)) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  //
+  // The local APIC timer frequency is not architectural, so count its ticks
+  // over a known delay. The timer is masked, as the delay is much shorter
+  // than the largest count.
+  //
+  InterruptState = SaveAndDisableInterrupts ();
+  InitializeApicTimer (1, MAX_UINT32, FALSE, mVector);
+  DisableApicTimerInterrupt ();
+  MicroSecondDelay (SAMPLING_PROFILER_CALIBRATION_US);
+  Frequency = MultU64x32 (
+                MAX_UINT32 - GetApicTimerCurrentCount (),
+                1000000 / SAMPLING_PROFILER_CALIBRATION_US
+                );
+  InitializeApicTimer (0, 0, FALSE, mVector);
+  DisableApicTimerInterrupt ();
+  SetInterruptState (InterruptState);
+
+  DEBUG ((DEBUG_INFO, "SamplingProfiler: Local APIC timer frequency %ld Hz\n", Frequency));
+
+  for (DivideValue = 1; DivideValue <= 128; DivideValue *= 2) {
+    InitCount = DivU64x32 (Frequency, (UINT32) (DivideValue * Rate));
+    if (InitCount <= MAX_UINT32) {
+      break;
+    }
+  }
+  if (InitCount == 0 || InitCount > MAX_UINT32) {
+    return EFI_UNSUPPORTED;
+  }
+
+  mSampling = TRUE;
+  InitializeApicTimer (DivideValue, (UINT32) InitCount, TRUE, mVector);
+  return EFI_SUCCESS;
+}
+
+/**
+  Compares two samples for PerformQuickSort().
+
+  @param  Buffer1   The first sample.
+  @param  Buffer2   The second sample.
+
+  @retval  <0   Buffer1 is lower than Buffer2.
+  @retval   0   The samples are equal.
+  @retval  >0   Buffer1 is higher than Buffer2.
+
+**/
+INTN
+EFIAPI
+SamplingProfilerCompareSamples (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  UINT64  Sample1;
+  UINT64  Sample2;
+
+  Sample1 = *(CONST UINT64 *) Buffer1;
+  Sample2 = *(CONST UINT64 *) Buffer2;
+  if (Sample1 < Sample2) {
+    return -1;
+  }
+  return (Sample1 > Sample2) ? 1 : 0;
+}
+
+/**
+  Writes the loaded images, from the EFI Debug Image Info Table, to the debug
+  log.
+
+**/
+VOID
+SamplingProfilerDumpImages (
+  VOID
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_DEBUG_IMAGE_INFO_TABLE_HEADER  *Header;
+  EFI_DEBUG_IMAGE_INFO_NORMAL        *NormalImage;
+  EFI_LOADED_IMAGE_PROTOCOL          *LoadedImage;
+  CHAR8                              *PdbPath;
+  UINTN                              Index;
+
+  Status = EfiGetSystemConfigurationTable (&gEfiDebugImageInfoTableGuid, (VOID **) &Header);
+  if (EFI_ERROR (Status) || Header->EfiDebugImageInfoTable == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < Header->TableSize; Index++) {
+    NormalImage = Header->EfiDebugImageInfoTable[Index].NormalImage;
+    if (NormalImage == NULL || NormalImage->ImageInfoType != EFI_DEBUG_IMAGE_INFO_TYPE_NORMAL) {
+      continue;
+    }
+    LoadedImage = NormalImage->LoadedImageProtocolInstance;
+    PdbPath     = PeCoffLoaderGetPdbPointer (LoadedImage->ImageBase);
+    DEBUG ((
+      DEBUG_INFO,
+      "SamplingProfiler: Image 0x%lx 0x%lx %a\n",
+      (UINT64) (UINTN) LoadedImage->ImageBase,
+      LoadedImage->ImageSize,
+      (PdbPath != NULL) ? PdbPath : "?"
+      ));
+  }
+}
+
+/**
+  Writes the number of samples at each address to the debug log.
+
+**/
+VOID
+SamplingProfilerDumpSamples (
+  VOID
+  )
+{
+  UINTN  Index;
+  UINTN  Start;
+
+  PerformQuickSort (mSamples, mSampleCount, sizeof (*mSamples), SamplingProfilerCompareSamples);
+
+  for (Start = 0; Start < mSampleCount; Start = Index) {
+    for (Index = Start + 1; Index < mSampleCount && mSamples[Index] == mSamples[Start]; Index++) {
+    }
+    DEBUG ((DEBUG_INFO, "SamplingProfiler: Sample 0x%lx %d\n", mSamples[Start], Index - Start));
+  }
+}
+
+/**
+  Stops sampling and writes the profile to the debug log.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      The pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SamplingProfilerOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+
+  SamplingProfilerStop ();
+
+  DEBUG ((
+    DEBUG_INFO,
+    "SamplingProfiler: Begin %d samples at %d Hz, %d lost\n",
+    mSampleCount,
+    PcdGet32 (PcdSamplingProfilerRate),
+    mLostSampleCount
+    ));
+  SamplingProfilerDumpImages ();
+  SamplingProfilerDumpSamples ();
+  DEBUG ((DEBUG_INFO, "SamplingProfiler: End\n"));
+
+  mMaxSampleCount = 0;
+  mSampleCount    = 0;
+  FreePool (mSamples);
+  mSamples        = NULL;
+}
+
+/**
+  Stops sampling if the OS is booted without ReadyToBoot.
+
+  @param  Event        Event whose notification function is being invoked.
+  @param  Context      The pointer to the notification function's context.
+
+**/
+VOID
+EFIAPI
+SamplingProfilerOnExitBootServices (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  SamplingProfilerStop ();
+}
+
+/**
+  The entry point allocates the sample buffer and starts sampling.
+
+  @param  ImageHandle   The firmware allocated handle for the EFI image.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   Sampling was started.
+  @retval other         Sampling is disabled or could not be started.
+
+**/
+EFI_STATUS
+EFIAPI
+SamplingProfilerDxeEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   ReadyToBootEvent;
+  EFI_EVENT   ExitBootServicesEvent;
+  UINT32      Rate;
+
+  Rate = PcdGet32 (PcdSamplingProfilerRate);
+  if (Rate == 0 || PcdGet32 (PcdSamplingProfilerSampleCount) == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  mMaxSampleCount = PcdGet32 (PcdSamplingProfilerSampleCount);
+  mSamples        = AllocatePool (mMaxSampleCount * sizeof (*mSamples));
+  if (mSamples == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->LocateProtocol (&gEfiCpuArchProtocolGuid, NULL, (VOID **) &mCpu);
+  ASSERT_EFI_ERROR (Status);
+
+  mVector = PcdGet8 (PcdSamplingProfilerVector);
+  Status  = mCpu->RegisterInterruptHandler (mCpu, mVector, SamplingProfilerInterruptHandler);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "SamplingProfiler: Vector 0x%x is in use\n", mVector));
+    goto FreeSamples;
+  }
+
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             SamplingProfilerOnReadyToBoot,
+             NULL,
+             &ReadyToBootEvent
+             );
+  if (EFI_ERROR (Status)) {
+    goto UnregisterHandler;
+  }
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  SamplingProfilerOnExitBootServices,
+                  NULL,
+                  &gEfiEventExitBootServicesGuid,
+                  &ExitBootServicesEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    goto CloseReadyToBootEvent;
+  }
+
+  Status = SamplingProfilerStart (Rate);
+  if (Status == EFI_ALREADY_STARTED) {
+    DEBUG ((DEBUG_ERROR, "SamplingProfiler: The local APIC timer is in use\n"));
+    goto CloseExitBootServicesEvent;
+  }
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "SamplingProfiler: %d Hz is out of the local APIC timer range\n", Rate));
+    goto CloseExitBootServicesEvent;
+  }
+
+  return EFI_SUCCESS;
+
+CloseExitBootServicesEvent:
+  gBS->CloseEvent (ExitBootServicesEvent);
+CloseReadyToBootEvent:
+  gBS->CloseEvent (ReadyToBootEvent);
+UnregisterHandler:
+  mCpu->RegisterInterruptHandler (mCpu, mVector, NULL);
+FreeSamples:
+  FreePool (mSamples);
+  return Status;
+}